@@ -0,0 +1,181 @@
+#!/usr/bin/perl -w
+
+# Generates mojoshader_hlsl_keywords.h, the perfect hash table that
+#  mojoshader_compiler.c uses to classify identifiers. Run it from the root
+#  of the source tree after changing the word lists below:
+#
+#    perl misc/hlsl_keywords.pl > mojoshader_hlsl_keywords.h
+#
+# The hash is hash-and-displace: FNV-1a over the word, the low bits pick a
+#  bucket, and that bucket's displacement moves every word in it into its
+#  own slot. hlsl_keyword_class() in mojoshader_compiler.c has to hash
+#  exactly the way fnv1a() and slot() do here.
+
+use warnings;
+use strict;
+
+my $buckets = 64;
+my $slots = 256;
+
+# Identifiers that the parser treats specially.
+my @keywords = (
+    [ 'else', 'TOKEN_HLSL_ELSE' ],
+    [ 'inline', 'TOKEN_HLSL_INLINE' ],
+    [ 'void', 'TOKEN_HLSL_VOID' ],
+    [ 'in', 'TOKEN_HLSL_IN' ],
+    [ 'inout', 'TOKEN_HLSL_INOUT' ],
+    [ 'out', 'TOKEN_HLSL_OUT' ],
+    [ 'uniform', 'TOKEN_HLSL_UNIFORM' ],
+    [ 'linear', 'TOKEN_HLSL_LINEAR' ],
+    [ 'centroid', 'TOKEN_HLSL_CENTROID' ],
+    [ 'nointerpolation', 'TOKEN_HLSL_NOINTERPOLATION' ],
+    [ 'noperspective', 'TOKEN_HLSL_NOPERSPECTIVE' ],
+    [ 'sample', 'TOKEN_HLSL_SAMPLE' ],
+    [ 'struct', 'TOKEN_HLSL_STRUCT' ],
+    [ 'typedef', 'TOKEN_HLSL_TYPEDEF' ],
+    [ 'const', 'TOKEN_HLSL_CONST' ],
+    [ 'packoffset', 'TOKEN_HLSL_PACKOFFSET' ],
+    [ 'register', 'TOKEN_HLSL_REGISTER' ],
+    [ 'extern', 'TOKEN_HLSL_EXTERN' ],
+    [ 'shared', 'TOKEN_HLSL_SHARED' ],
+    [ 'static', 'TOKEN_HLSL_STATIC' ],
+    [ 'volatile', 'TOKEN_HLSL_VOLATILE' ],
+    [ 'row_major', 'TOKEN_HLSL_ROWMAJOR' ],
+    [ 'column_major', 'TOKEN_HLSL_COLUMNMAJOR' ],
+    [ 'bool', 'TOKEN_HLSL_BOOL' ],
+    [ 'int', 'TOKEN_HLSL_INT' ],
+    [ 'uint', 'TOKEN_HLSL_UINT' ],
+    [ 'half', 'TOKEN_HLSL_HALF' ],
+    [ 'float', 'TOKEN_HLSL_FLOAT' ],
+    [ 'double', 'TOKEN_HLSL_DOUBLE' ],
+    [ 'string', 'TOKEN_HLSL_STRING' ],
+    [ 'snorm', 'TOKEN_HLSL_SNORM' ],
+    [ 'unorm', 'TOKEN_HLSL_UNORM' ],
+    [ 'buffer', 'TOKEN_HLSL_BUFFER' ],
+    [ 'vector', 'TOKEN_HLSL_VECTOR' ],
+    [ 'matrix', 'TOKEN_HLSL_MATRIX' ],
+    [ 'break', 'TOKEN_HLSL_BREAK' ],
+    [ 'continue', 'TOKEN_HLSL_CONTINUE' ],
+    [ 'discard', 'TOKEN_HLSL_DISCARD' ],
+    [ 'return', 'TOKEN_HLSL_RETURN' ],
+    [ 'while', 'TOKEN_HLSL_WHILE' ],
+    [ 'for', 'TOKEN_HLSL_FOR' ],
+    [ 'unroll', 'TOKEN_HLSL_UNROLL' ],
+    [ 'loop', 'TOKEN_HLSL_LOOP' ],
+    [ 'do', 'TOKEN_HLSL_DO' ],
+    [ 'if', 'TOKEN_HLSL_IF' ],
+    [ 'branch', 'TOKEN_HLSL_BRANCH' ],
+    [ 'flatten', 'TOKEN_HLSL_FLATTEN' ],
+    [ 'switch', 'TOKEN_HLSL_SWITCH' ],
+    [ 'forcecase', 'TOKEN_HLSL_FORCECASE' ],
+    [ 'call', 'TOKEN_HLSL_CALL' ],
+    [ 'case', 'TOKEN_HLSL_CASE' ],
+    [ 'default', 'TOKEN_HLSL_DEFAULT' ],
+    [ 'sampler', 'TOKEN_HLSL_SAMPLER' ],
+    [ 'sampler1D', 'TOKEN_HLSL_SAMPLER1D' ],
+    [ 'sampler2D', 'TOKEN_HLSL_SAMPLER2D' ],
+    [ 'sampler3D', 'TOKEN_HLSL_SAMPLER3D' ],
+    [ 'samplerCUBE', 'TOKEN_HLSL_SAMPLERCUBE' ],
+    [ 'sampler_state', 'TOKEN_HLSL_SAMPLER_STATE' ],
+    [ 'SamplerState', 'TOKEN_HLSL_SAMPLERSTATE' ],
+    [ 'true', 'TOKEN_HLSL_TRUE' ],
+    [ 'false', 'TOKEN_HLSL_FALSE' ],
+    [ 'SamplerComparisonState', 'TOKEN_HLSL_SAMPLERCOMPARISONSTATE' ],
+    [ 'isolate', 'TOKEN_HLSL_ISOLATE' ],
+    [ 'maxInstructionCount', 'TOKEN_HLSL_MAXINSTRUCTIONCOUNT' ],
+    [ 'noExpressionOptimizations', 'TOKEN_HLSL_NOEXPRESSIONOPTIMIZATIONS' ],
+    [ 'unused', 'TOKEN_HLSL_UNUSED' ],
+    [ 'xps', 'TOKEN_HLSL_XPS' ],
+);
+
+# The vector and matrix typedefs that init_builtins() adds, which are
+#  always user types to the parser ("float4", "half3x3", etc).
+foreach my $type (qw( bool int uint half float double )) {
+    for (my $j = 1; $j <= 4; $j++) {
+        push @keywords, [ "$type$j", 'TOKEN_HLSL_USERTYPE' ];
+        for (my $k = 1; $k <= 4; $k++) {
+            push @keywords, [ "$type${j}x$k", 'TOKEN_HLSL_USERTYPE' ];
+        }
+    }
+}
+
+sub fnv1a {
+    my $hash = 2166136261;
+    foreach my $ch (unpack('C*', $_[0])) {
+        $hash = (($hash ^ $ch) * 16777619) & 0xFFFFFFFF;
+    }
+    return $hash;
+}
+
+sub slot {
+    my ($hash, $displace) = @_;
+    return (($hash >> 16) + $displace) & ($slots - 1);
+}
+
+my @bucketwords = map { [] } (1..$buckets);
+my $maxlen = 0;
+my $minlen = 1000;
+foreach my $kw (@keywords) {
+    my $word = $kw->[0];
+    my $hash = fnv1a($word);
+    push @{$bucketwords[$hash & ($buckets - 1)]}, [ @$kw, $hash ];
+    $maxlen = length($word) if length($word) > $maxlen;
+    $minlen = length($word) if length($word) < $minlen;
+}
+
+# Place the biggest buckets first, while there's still room.
+my @order = sort { scalar(@{$bucketwords[$b]}) <=> scalar(@{$bucketwords[$a]}) or $a <=> $b } (0..$buckets-1);
+my @displace = (0) x $buckets;
+my @table = (undef) x $slots;
+foreach my $bucket (@order) {
+    my $words = $bucketwords[$bucket];
+    next if not @$words;
+    my $placed = 0;
+    for (my $d = 0; ($d < $slots) && (not $placed); $d++) {
+        my %used = ();
+        my $ok = 1;
+        foreach my $w (@$words) {
+            my $s = slot($w->[2], $d);
+            if (defined $table[$s] or defined $used{$s}) {
+                $ok = 0;
+                last;
+            }
+            $used{$s} = 1;
+        }
+        next if not $ok;
+        $table[slot($_->[2], $d)] = $_ foreach (@$words);
+        $displace[$bucket] = $d;
+        $placed = 1;
+    }
+    die("Couldn't place bucket $bucket; raise \$slots or \$buckets.\n") if not $placed;
+}
+
+print("// This file was generated by misc/hlsl_keywords.pl. Don't edit it by hand;\n");
+print("//  change the word lists in that script and run it again.\n\n");
+print("#define HLSL_KEYWORD_MINLEN $minlen\n");
+print("#define HLSL_KEYWORD_MAXLEN $maxlen\n");
+print("#define HLSL_KEYWORD_BUCKETS $buckets\n");
+print("#define HLSL_KEYWORD_SLOTS $slots\n\n");
+
+print("static const uint8 hlsl_keyword_displace[HLSL_KEYWORD_BUCKETS] = {\n");
+for (my $i = 0; $i < $buckets; $i += 16) {
+    my $last = ($i + 15 < $buckets) ? $i + 15 : $buckets - 1;
+    print('    ' . join(', ', @displace[$i..$last]) . ",\n");
+}
+print("};\n\n");
+
+print("static const HlslKeyword hlsl_keyword_slots[HLSL_KEYWORD_SLOTS] = {\n");
+foreach my $w (@table) {
+    if (not defined $w) {
+        print("    { NULL, 0, 0 },\n");
+    } else {
+        my ($word, $tokenclass) = @$w;
+        printf("    { \"%s\", %d, %s },\n", $word, length($word), $tokenclass);
+    }
+}
+print("};\n\n");
+
+print("// end of mojoshader_hlsl_keywords.h ...\n\n");
+
+# end of hlsl_keywords.pl ...
+
@@ -2179,10 +2179,12 @@ static int parse_ctab_typeinfo(Context *ctx, const uint8 *start,
     } // if
 
     const unsigned int member_count = (unsigned int) SWAP16(typeptr[5]);
+    const uint32 memberpos = (uint32) SWAP16(typeptr[6]);
     info->member_count = 0;
     info->members = NULL;
 
-    if ((pos + 16 + (member_count * 8)) >= bytes)
+    // the member list can be anywhere in the table, not just after us.
+    if ((member_count > 0) && ((memberpos + (member_count * 8)) > bytes))
         return 0;  // corrupt CTAB.
 
     if (member_count > 0)
@@ -2202,7 +2204,7 @@ static int parse_ctab_typeinfo(Context *ctx, const uint8 *start,
     } // else
 
     unsigned int i;
-    const uint32 *member = (const uint32 *) (start + typeptr[6]);
+    const uint32 *member = (const uint32 *) (start + memberpos);
     for (i = 0; i < member_count; i++)
     {
         MOJOSHADER_symbolStructMember *mbr = &info->members[i];
@@ -1063,6 +1063,228 @@ DECLSPEC const MOJOSHADER_preprocessData *MOJOSHADER_preprocess(const char *file
 DECLSPEC void MOJOSHADER_freePreprocessData(const MOJOSHADER_preprocessData *data);
 
 
+/*
+ * An include cache holds on to the contents of #included files, so that
+ *  preprocessing the same headers over and over (for example, when building
+ *  thousands of permutations of a shader) only has to open and read each
+ *  header once. Files are keyed by what your open callback gets to resolve
+ *  them with: the include type, the name on the #include line, and the
+ *  file doing the #including. A header that #includes something is
+ *  identified by its contents, so "common.h" from "a.h" is one entry for
+ *  every shader that uses the cache, while "common.h" from "b.h" is
+ *  another, since your callback might find that one in a different place.
+ *  Your callback never sees the filename of the top-level source, so we
+ *  assume it resolves #includes from there the same way for every source
+ *  in the same directory: "common.h" from any source named "fx/..." is one
+ *  entry. The contents are deduplicated by hash, so entries that resolve to
+ *  identical bytes share a single copy.
+ *
+ * (include_open) and (include_close) are used to load files that aren't
+ *  cached yet, and to release them when the cache is destroyed. They work
+ *  exactly like they do for MOJOSHADER_preprocess(), and can be NULL to use
+ *  the default filesystem callbacks. Note that the cache never calls
+ *  (include_open) a second time for a key it has already seen, so if a
+ *  file changes on disk, you need to destroy the cache and make a new one.
+ *
+ * (m), (f), and (d) are the allocator used for the cache itself, and they
+ *  are also what gets passed to your include callbacks. They can be NULL.
+ *
+ * Returns NULL if we're out of memory.
+ *
+ * An include cache is thread safe: you may use the same one with several
+ *  concurrent MOJOSHADER_preprocessWithCache() (etc) calls, so long as your
+ *  include callbacks and allocator are thread safe, too.
+ */
+typedef struct MOJOSHADER_includeCache MOJOSHADER_includeCache;
+DECLSPEC MOJOSHADER_includeCache *MOJOSHADER_createIncludeCache(
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
+/*
+ * Release an include cache and everything in it. Nothing may be using the
+ *  cache when you call this. Passing a NULL here is a safe no-op.
+ */
+DECLSPEC void MOJOSHADER_destroyIncludeCache(MOJOSHADER_includeCache *cache);
+
+/*
+ * This is the same as MOJOSHADER_preprocess(), but #includes are resolved
+ *  through (cache) instead of a pair of include callbacks. (cache) must
+ *  not be NULL, and must stay alive until this function returns.
+ */
+DECLSPEC const MOJOSHADER_preprocessData *MOJOSHADER_preprocessWithCache(
+                             const char *filename,
+                             const char *source, unsigned int sourcelen,
+                             const MOJOSHADER_preprocessorDefine *defines,
+                             unsigned int define_count,
+                             MOJOSHADER_includeCache *cache,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
+
+/*
+ * A pair of include callbacks that memory-map files read-only instead of
+ *  reading them into an allocated buffer, so the lexer works directly on
+ *  the file's pages and nothing gets copied. You can pass these anywhere
+ *  that takes a MOJOSHADER_includeOpen and MOJOSHADER_includeClose,
+ *  including MOJOSHADER_createIncludeCache(). Like the default callbacks,
+ *  (fname) is used as-is, relative to the current working directory.
+ *
+ * Don't truncate a file while it's mapped; the system is allowed to crash
+ *  the process if we touch a page that no longer exists. The allocator
+ *  arguments are ignored.
+ *
+ * On platforms without a memory-mapping implementation, these just read
+ *  the file like the default callbacks do.
+ */
+DECLSPEC int MOJOSHADER_mmapIncludeOpen(MOJOSHADER_includeType inctype,
+                             const char *fname, const char *parent,
+                             const char **outdata, unsigned int *outbytes,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+DECLSPEC void MOJOSHADER_mmapIncludeClose(const char *data,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
+/*
+ * This is the same as MOJOSHADER_preprocess(), but the source comes from
+ *  (filename), which is memory-mapped with MOJOSHADER_mmapIncludeOpen()
+ *  instead of you loading it. If (include_open) and (include_close) are
+ *  both NULL, #includes are memory-mapped, too; otherwise they work like
+ *  they do in MOJOSHADER_preprocess().
+ *
+ * If (filename) can't be opened, you get back a MOJOSHADER_preprocessData
+ *  with a single error in it.
+ */
+DECLSPEC const MOJOSHADER_preprocessData *MOJOSHADER_preprocessFile(
+                             const char *filename,
+                             const MOJOSHADER_preprocessorDefine *defines,
+                             unsigned int define_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
+
+/*
+ * A file that a shader #included, as reported by MOJOSHADER_scanDependencies().
+ */
+typedef struct MOJOSHADER_includeDependency
+{
+    /*
+     * The filename exactly as it appeared on the #include line, which is
+     *  also what your MOJOSHADER_includeOpen callback was handed. It's up to
+     *  you to map this to a real path, the same way your callback did.
+     */
+    const char *filename;
+
+    /*
+     * Whether this was #include "blah.h" or #include <blah.h>.
+     */
+    MOJOSHADER_includeType include_type;
+
+    /*
+     * The index in MOJOSHADER_dependencyData::dependencies of the file that
+     *  did the #including, or -1 if it was the source you passed in. This
+     *  is always less than this dependency's own index, so you can resolve
+     *  (filename) relative to its parent, like your callback did, in order.
+     */
+    int parent;
+} MOJOSHADER_includeDependency;
+
+/*
+ * Structure used to return data from a dependency scan of a shader...
+ */
+typedef struct MOJOSHADER_dependencyData
+{
+    /*
+     * The number of elements pointed to by (errors).
+     */
+    int error_count;
+
+    /*
+     * (error_count) elements of data that specify errors that were generated
+     *  while scanning this shader. A file that couldn't be #included shows
+     *  up here, too.
+     * This can be NULL if there were no errors or if (error_count) is zero.
+     */
+    MOJOSHADER_error *errors;
+
+    /*
+     * The number of elements pointed to by (dependencies).
+     */
+    int dependency_count;
+
+    /*
+     * (dependency_count) elements, one for each distinct #include, directly
+     *  or indirectly, in the order they were first seen. An #include is
+     *  distinct if it has a different name or type, or comes from a
+     *  different parent, since your callback might resolve the same name
+     *  to different files for each of those. So the same file can show up
+     *  more than once, and two entries with the same name can be different
+     *  files. Resolve each against its (parent) to tell them apart.
+     * This can be NULL if (dependency_count) is zero.
+     */
+    MOJOSHADER_includeDependency *dependencies;
+
+    /*
+     * This is the malloc implementation you passed to
+     *  MOJOSHADER_scanDependencies().
+     */
+    MOJOSHADER_malloc malloc;
+
+    /*
+     * This is the free implementation you passed to
+     *  MOJOSHADER_scanDependencies().
+     */
+    MOJOSHADER_free free;
+
+    /*
+     * This is the pointer you passed as opaque data for your allocator.
+     */
+    void *malloc_data;
+} MOJOSHADER_dependencyData;
+
+
+/*
+ * Find every file that a shader #includes, like "gcc -M" does, so a build
+ *  system can decide what needs rebuilding.
+ *
+ * This takes the same arguments as MOJOSHADER_preprocess(), and walks the
+ *  source the same way, so conditional compilation, #define and #undef are
+ *  all honored and an #include inside an "#if 0" block isn't reported. It
+ *  is much cheaper than a full preprocess, though: macros outside of
+ *  directives are never expanded and no output text is generated.
+ *
+ * This will return a MOJOSHADER_dependencyData. You should pass this
+ *  return value to MOJOSHADER_freeDependencyData() when you are done with
+ *  it.
+ *
+ * This function will never return NULL, even if the system is completely
+ *  out of memory upon entry (in which case, this function returns a static
+ *  MOJOSHADER_dependencyData object, which is still safe to pass to
+ *  MOJOSHADER_freeDependencyData()).
+ *
+ * This function is thread safe, so long as any allocator you passed into
+ *  it is, too.
+ */
+DECLSPEC const MOJOSHADER_dependencyData *MOJOSHADER_scanDependencies(
+                             const char *filename,
+                             const char *source, unsigned int sourcelen,
+                             const MOJOSHADER_preprocessorDefine *defines,
+                             unsigned int define_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
+/*
+ * Call this to dispose of dependency scan results when you are done with
+ *  them. This will call the MOJOSHADER_free function you provided to
+ *  MOJOSHADER_scanDependencies() multiple times, if you provided one.
+ *  Passing a NULL here is a safe no-op.
+ *
+ * This function is thread safe, so long as any allocator you passed into
+ *  MOJOSHADER_scanDependencies() is, too.
+ */
+DECLSPEC void MOJOSHADER_freeDependencyData(const MOJOSHADER_dependencyData *data);
+
+
 /* Assembler interface... */
 
 /*
@@ -1133,6 +1355,98 @@ DECLSPEC const MOJOSHADER_parseData *MOJOSHADER_assemble(const char *filename,
                              MOJOSHADER_includeClose include_close,
                              MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
 
+/*
+ * This is the same as MOJOSHADER_assemble(), but #includes are resolved
+ *  through (cache) instead of a pair of include callbacks. See
+ *  MOJOSHADER_createIncludeCache() for details.
+ */
+DECLSPEC const MOJOSHADER_parseData *MOJOSHADER_assembleWithCache(
+                             const char *filename,
+                             const char *source, unsigned int sourcelen,
+                             const char **comments, unsigned int comment_count,
+                             const MOJOSHADER_symbol *symbols,
+                             unsigned int symbol_count,
+                             const MOJOSHADER_preprocessorDefine *defines,
+                             unsigned int define_count,
+                             MOJOSHADER_includeCache *cache,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
+/*
+ * This is the same as MOJOSHADER_assemble(), but the source comes from
+ *  (filename), which is memory-mapped instead of you loading it. See
+ *  MOJOSHADER_preprocessFile() for how #includes and errors are handled.
+ */
+DECLSPEC const MOJOSHADER_parseData *MOJOSHADER_assembleFile(
+                             const char *filename,
+                             const char **comments, unsigned int comment_count,
+                             const MOJOSHADER_symbol *symbols,
+                             unsigned int symbol_count,
+                             const MOJOSHADER_preprocessorDefine *defines,
+                             unsigned int define_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
+
+/*
+ * One shader for MOJOSHADER_assembleBatch(). The fields mean the same thing
+ *  as the matching arguments to MOJOSHADER_assemble().
+ */
+typedef struct MOJOSHADER_assembleJob
+{
+    const char *filename;
+    const char *source;
+    unsigned int sourcelen;
+    const char **comments;
+    unsigned int comment_count;
+    const MOJOSHADER_symbol *symbols;
+    unsigned int symbol_count;
+    const MOJOSHADER_preprocessorDefine *defines;
+    unsigned int define_count;
+} MOJOSHADER_assembleJob;
+
+/*
+ * Assemble a pile of shaders at once, spread over several threads.
+ *
+ * (jobs) points to (job_count) shaders to assemble. When this returns,
+ *  (results)[i] holds what MOJOSHADER_assemble() would have returned for
+ *  (jobs)[i]; (results) must have room for (job_count) pointers. Every
+ *  entry is filled in, even if we run out of memory, and each one must be
+ *  freed with MOJOSHADER_freeParseData() when you're done with it. The
+ *  order that jobs actually run in is unspecified, but results always land
+ *  in the slot matching their job.
+ *
+ * Up to (thread_count) threads work on the batch, including the calling
+ *  thread, which does its share and returns when everything is finished.
+ *  Zero or one means everything is assembled on the calling thread. If a
+ *  thread can't be started, the others do its jobs.
+ *
+ * All jobs in the batch share an include cache (see
+ *  MOJOSHADER_createIncludeCache()), so each distinct #include is opened
+ *  and read once for the whole batch, through (include_open) and
+ *  (include_close), no matter how many jobs use it. An #include is
+ *  distinct per the include cache's rules: "common.h" from every job
+ *  whose filename is in the same directory is one open, and so is "common.h" from a header that
+ *  every job #includes, but "common.h" from both of those places is two
+ *  opens, since your callback might resolve them differently. Identical
+ *  files are still only kept in memory once. These callbacks work like
+ *  they do for MOJOSHADER_assemble(), and can both be NULL for the
+ *  defaults. Files are closed before this function returns.
+ *
+ * (m), (f), and (d) are used for the results and for all the temporary
+ *  memory, from several threads at once, so they must be thread safe. Your
+ *  include callbacks only need to be thread safe if (thread_count) is
+ *  greater than one. The jobs, and everything they point to, must remain
+ *  intact until this function returns.
+ */
+DECLSPEC void MOJOSHADER_assembleBatch(const MOJOSHADER_assembleJob *jobs,
+                             unsigned int job_count,
+                             unsigned int thread_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             const MOJOSHADER_parseData **results,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
 
 /* High level shading language support... */
 
@@ -1589,6 +1903,7 @@ typedef struct MOJOSHADER_astFunctionParameters
     const char *semantic;
     MOJOSHADER_astInterpolationModifier interpolation_modifier;
     MOJOSHADER_astExpression *initializer;
+    int index;  /* Never set by parseAst()! */
     struct MOJOSHADER_astFunctionParameters *next;
 } MOJOSHADER_astFunctionParameters;
 
@@ -1661,6 +1976,7 @@ typedef struct MOJOSHADER_astVariableDeclaration
     MOJOSHADER_astAnnotations *annotations;
     MOJOSHADER_astExpression *initializer;
     MOJOSHADER_astVariableLowLevel *lowlevel;
+    int index;  /* Never set by parseAst()! */
     struct MOJOSHADER_astVariableDeclaration *next;
 } MOJOSHADER_astVariableDeclaration;
 
@@ -1968,6 +2284,11 @@ typedef struct MOJOSHADER_astData
  *  If your allocator needs instance-specific data, you may supply it with the
  *  (d) parameter. This pointer is passed as-is to your (m) and (f) functions.
  *
+ * The builtin typedefs and intrinsic functions are built once, the first time
+ *  you parse or compile HLSL, and shared by every call after that. That one
+ *  table uses the C runtime's malloc(), not your allocator, and is never
+ *  freed.
+ *
  * This function is thread safe, so long as the various callback functions
  *  are, too, and that the parameters remains intact for the duration of the
  *  call. This allows you to parse several shaders on separate CPU cores
@@ -2014,6 +2335,7 @@ typedef enum MOJOSHADER_irNodeType
     MOJOSHADER_IR_CONVERT,
     MOJOSHADER_IR_SWIZZLE,
     MOJOSHADER_IR_CONSTRUCT,
+    MOJOSHADER_IR_SELECT,
     MOJOSHADER_IR_END_RANGE_EXPR,
 
     MOJOSHADER_IR_START_RANGE_STMT,
@@ -2156,6 +2478,7 @@ typedef struct MOJOSHADER_irConvert  /* casting between datatypes */
 {
     MOJOSHADER_irExprInfo info;  /* Always MOJOSHADER_IR_CONVERT */
     MOJOSHADER_irExpression *expr;
+    int columns;  /* for matrix targets, else 0. */
 } MOJOSHADER_irConvert;
 
 typedef struct MOJOSHADER_irSwizzle  /* vector swizzle */
@@ -2171,6 +2494,14 @@ typedef struct MOJOSHADER_irConstruct  /* vector construct from discrete items *
     MOJOSHADER_irExprList *args;
 } MOJOSHADER_irConstruct;
 
+typedef struct MOJOSHADER_irSelect  /* pick iftrue if cond, else iffalse. */
+{
+    MOJOSHADER_irExprInfo info;  /* Always MOJOSHADER_IR_SELECT */
+    MOJOSHADER_irExpression *cond;  /* scalar bool. */
+    MOJOSHADER_irExpression *iftrue;
+    MOJOSHADER_irExpression *iffalse;
+} MOJOSHADER_irSelect;
+
 /* Wrap the whole category in a union for type "safety." */
 union MOJOSHADER_irExpression
 {
@@ -2186,6 +2517,7 @@ union MOJOSHADER_irExpression
     MOJOSHADER_irConvert convert;
     MOJOSHADER_irSwizzle swizzle;
     MOJOSHADER_irConstruct construct;
+    MOJOSHADER_irSelect select;
 };
 
 /* MOJOSHADER_irStatement types. */
@@ -2219,6 +2551,7 @@ typedef struct MOJOSHADER_irCJump  /* conditional jump */
     MOJOSHADER_irExpression *right;
     int iftrue;  /* label id for true case. */
     int iffalse; /* label id for false case. */
+    int branch;  /* non-zero for a [branch] if: keep it a real branch. */
 } MOJOSHADER_irCJump;
 
 typedef struct MOJOSHADER_irSeq  /* statement without side effects */
@@ -2285,6 +2618,25 @@ union MOJOSHADER_irNode
  * Structure used to return data from parsing of a shader...
  */
 /* !!! FIXME: most of these ints should be unsigned. */
+/*
+ * What one pass of the HLSL compiler's IR optimizer did, summed over all of
+ *  a shader's functions. See MOJOSHADER_compileWithIrStats(). The passes
+ *  run again when dead code elimination merges basic blocks; then the
+ *  "before" counts are from the first time a pass ran on a function, and
+ *  the "after" counts add up what that pass changed every time it ran.
+ */
+typedef struct MOJOSHADER_irPassStats
+{
+    const char *name;  /* "fold constants", etc. Static data; don't free. */
+    int instructions_before;
+    int instructions_after;
+    int nodes_before;
+    int nodes_after;
+    int temps_before;
+    int temps_after;
+    int changes;  /* things the pass folded, replaced or removed. */
+} MOJOSHADER_irPassStats;
+
 typedef struct MOJOSHADER_compileData
 {
     /*
@@ -2329,6 +2681,18 @@ typedef struct MOJOSHADER_compileData
      */
     int output_len;
 
+    /*
+     * The shader bytecode that (output) assembles to, with a CTAB that
+     *  describes (symbols). You can hand this straight to MOJOSHADER_parse().
+     *  Will be NULL on error.
+     */
+    const unsigned char *bytecode;
+
+    /*
+     * Byte count for bytecode. Will be 0 on error.
+     */
+    int bytecode_len;
+
     /*
      * The number of elements pointed to by (symbols).
      */
@@ -2343,6 +2707,18 @@ typedef struct MOJOSHADER_compileData
      */
     MOJOSHADER_symbol *symbols;
 
+    /*
+     * The number of elements pointed to by (ir_passes).
+     */
+    int ir_pass_count;
+
+    /*
+     * (ir_pass_count) elements, one for each IR optimizer pass, in the order
+     *  they ran. Only MOJOSHADER_compileWithIrStats() fills these in; they
+     *  are NULL and zero otherwise.
+     */
+    MOJOSHADER_irPassStats *ir_passes;
+
     /*
      * This is the malloc implementation you passed to MOJOSHADER_parse().
      */
@@ -2408,6 +2784,11 @@ typedef struct MOJOSHADER_compileData
  *  If your allocator needs instance-specific data, you may supply it with the
  *  (d) parameter. This pointer is passed as-is to your (m) and (f) functions.
  *
+ * The builtin typedefs and intrinsic functions are built once, the first time
+ *  you parse or compile HLSL, and shared by every call after that. That one
+ *  table uses the C runtime's malloc(), not your allocator, and is never
+ *  freed.
+ *
  * This function is thread safe, so long as the various callback functions
  *  are, too, and that the parameters remains intact for the duration of the
  *  call. This allows you to compile several shaders on separate CPU cores
@@ -2424,6 +2805,250 @@ DECLSPEC const MOJOSHADER_compileData *MOJOSHADER_compile(const char *srcprofile
                                     void *d);
 
 
+/*
+ * This is the same as MOJOSHADER_compile(), but #includes are resolved
+ *  through (cache) instead of a pair of include callbacks. See
+ *  MOJOSHADER_createIncludeCache() for details.
+ */
+DECLSPEC const MOJOSHADER_compileData *MOJOSHADER_compileWithCache(
+                                    const char *srcprofile,
+                                    const char *filename, const char *source,
+                                    unsigned int sourcelen,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeCache *cache,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d);
+
+
+/*
+ * This is the same as MOJOSHADER_compile(), but it also reports what each
+ *  pass of the IR optimizer did, in (ir_passes) in the returned data. This
+ *  is for looking at how well the optimizer does on your shaders; counting
+ *  takes extra walks over the IR, so the other entry points don't do it.
+ */
+DECLSPEC const MOJOSHADER_compileData *MOJOSHADER_compileWithIrStats(
+                                    const char *srcprofile,
+                                    const char *filename, const char *source,
+                                    unsigned int sourcelen,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeOpen include_open,
+                                    MOJOSHADER_includeClose include_close,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d);
+
+
+/*
+ * This is the same as MOJOSHADER_compile(), but the source comes from
+ *  (filename), which is memory-mapped instead of you loading it. See
+ *  MOJOSHADER_preprocessFile() for how #includes and errors are handled.
+ */
+DECLSPEC const MOJOSHADER_compileData *MOJOSHADER_compileFile(
+                                    const char *srcprofile,
+                                    const char *filename,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeOpen include_open,
+                                    MOJOSHADER_includeClose include_close,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d);
+
+
+/*
+ * An AST cache holds the results of parsing and semantic analysis, so
+ *  compiling a shader whose preprocessed source hasn't changed can skip
+ *  straight to code generation. This is useful when you rebuild lots of
+ *  shaders that share big headers, but only a few of them actually changed.
+ *
+ * Entries are keyed by a 64-bit hash of the preprocessor's output (every
+ *  token, and which file and line it came from), so a change to a header,
+ *  a #define, or the shader itself just makes a new entry. Nothing is ever
+ *  evicted; destroy the cache to get the memory back.
+ *
+ * (m), (f), and (d) are the allocator used for the cache itself. They can
+ *  be NULL.
+ *
+ * Returns NULL if we're out of memory.
+ *
+ * An AST cache is thread safe: you may use the same one with several
+ *  concurrent MOJOSHADER_compileWithAstCache() calls.
+ */
+typedef struct MOJOSHADER_astCache MOJOSHADER_astCache;
+DECLSPEC MOJOSHADER_astCache *MOJOSHADER_createAstCache(MOJOSHADER_malloc m,
+                                                        MOJOSHADER_free f,
+                                                        void *d);
+
+/*
+ * Release an AST cache and everything in it. Nothing may be using the
+ *  cache when you call this. Passing a NULL here is a safe no-op.
+ */
+DECLSPEC void MOJOSHADER_destroyAstCache(MOJOSHADER_astCache *cache);
+
+/*
+ * This is the same as MOJOSHADER_compile(), but parsing and semantic
+ *  analysis are skipped if (cache) already has the results for this
+ *  shader, and the results are added to (cache) if they weren't there and
+ *  the shader had no errors. (cache) must not be NULL. The compile data you
+ *  get back is the same either way.
+ */
+DECLSPEC const MOJOSHADER_compileData *MOJOSHADER_compileWithAstCache(
+                                    const char *srcprofile,
+                                    const char *filename, const char *source,
+                                    unsigned int sourcelen,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeOpen include_open,
+                                    MOJOSHADER_includeClose include_close,
+                                    MOJOSHADER_astCache *cache,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d);
+
+/*
+ * Write everything in an AST cache to one block of memory, so you can put
+ *  it on disk and give it to MOJOSHADER_loadAstCache() in a later run.
+ *  The block is allocated with the cache's allocator; free it with that,
+ *  too (or with free(), if the cache uses the default allocator). (*len)
+ *  is set to the block's size in bytes.
+ *
+ * Returns NULL if we're out of memory.
+ *
+ * The data is only good for the same build of MojoShader on a machine
+ *  with the same byte order; loading it anywhere else fails cleanly.
+ */
+DECLSPEC void *MOJOSHADER_saveAstCache(MOJOSHADER_astCache *cache,
+                                       unsigned int *len);
+
+/*
+ * Add the entries from a block that MOJOSHADER_saveAstCache() made to
+ *  (cache). Entries that (cache) already has are skipped.
+ *
+ * Returns the number of entries added, or -1 if (data) isn't a saved AST
+ *  cache from this build, or we ran out of memory.
+ *
+ * This checks that the data is well-formed and undamaged, but it trusts
+ *  what's in it: don't load AST caches from sources you don't trust.
+ */
+DECLSPEC int MOJOSHADER_loadAstCache(MOJOSHADER_astCache *cache,
+                                     const void *data, unsigned int len);
+
+
+/*
+ * One permutation for MOJOSHADER_compileBatch(): the #defines to compile
+ *  the batch's source with. These mean the same thing as the matching
+ *  arguments to MOJOSHADER_compile().
+ */
+typedef struct MOJOSHADER_compilePermutation
+{
+    const MOJOSHADER_preprocessorDefine *defines;
+    unsigned int define_count;
+} MOJOSHADER_compilePermutation;
+
+/*
+ * Compile several permutations of one shader at once, spread over several
+ *  threads.
+ *
+ * (srcprofile), (filename), (source) and (sourcelen) are the same as for
+ *  MOJOSHADER_compile(). (permutations) points to (permutation_count) sets
+ *  of #defines. When this returns, (results)[i] holds what
+ *  MOJOSHADER_compile() would have returned for (permutations)[i];
+ *  (results) must have room for (permutation_count) pointers. Every entry
+ *  is filled in, even if we run out of memory, and each one must be freed
+ *  with MOJOSHADER_freeCompileData() when you're done with it.
+ *
+ * Up to (thread_count) threads work on the batch, including the calling
+ *  thread, which does its share and returns when everything is finished.
+ *  Zero or one means everything is compiled on the calling thread. If a
+ *  thread can't be started, the others do its permutations.
+ *
+ * The permutations share an include cache (see
+ *  MOJOSHADER_createIncludeCache()), so each distinct #include, by that
+ *  cache's rules, is opened and read once for the whole batch, through
+ *  (include_open) and (include_close). These work like they do for MOJOSHADER_compile(), and
+ *  can both be NULL for the defaults. They also share an AST cache (see
+ *  MOJOSHADER_createAstCache()), so permutations whose #defines don't
+ *  change the preprocessed source are only parsed and checked once. The
+ *  builtin intrinsics are shared by every compile anyhow.
+ *
+ * (m), (f), and (d) are used for the results and for all the temporary
+ *  memory, from several threads at once, so they must be thread safe. Your
+ *  include callbacks only need to be thread safe if (thread_count) is
+ *  greater than one. The source and permutations, and everything they
+ *  point to, must remain intact until this function returns.
+ */
+DECLSPEC void MOJOSHADER_compileBatch(const char *srcprofile,
+                             const char *filename, const char *source,
+                             unsigned int sourcelen,
+                             const MOJOSHADER_compilePermutation *permutations,
+                             unsigned int permutation_count,
+                             unsigned int thread_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             const MOJOSHADER_compileData **results,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
+
+/*
+ * A compile session recompiles one shader, over and over, as it changes.
+ *  See MOJOSHADER_createCompileSession().
+ */
+typedef struct MOJOSHADER_compileSession MOJOSHADER_compileSession;
+
+/*
+ * Start a compile session. This is for tools that compile a new version of
+ *  the same shader every time someone changes it, like an editor with a
+ *  live preview: each compile reuses what it can from the last one.
+ *
+ * (srcprofile), (filename), (defs), (define_count), (include_open),
+ *  (include_close), (m), (f), and (d) mean the same thing they do for
+ *  MOJOSHADER_compile(), and they apply to every compile in the session.
+ *  (filename) and (defs) are copied, but (srcprofile) has to stay valid
+ *  until the session is destroyed (the MOJOSHADER_SRC_PROFILE_* strings
+ *  always are).
+ *
+ * The session uses an include cache (see MOJOSHADER_createIncludeCache()),
+ *  so each distinct #include, by that cache's rules, is only opened and
+ *  read once for the life of the session. If one of those files changes, start a new session.
+ *
+ * Returns NULL if we're out of memory.
+ */
+DECLSPEC MOJOSHADER_compileSession *MOJOSHADER_createCompileSession(
+                             const char *srcprofile, const char *filename,
+                             const MOJOSHADER_preprocessorDefine *defs,
+                             unsigned int define_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+
+/*
+ * Compile (source), which is (sourcelen) bytes, in (session). This returns
+ *  exactly what MOJOSHADER_compile() would, and you free it the same way,
+ *  with MOJOSHADER_freeCompileData().
+ *
+ * The session holds on to the last version of the shader that compiled far
+ *  enough to generate code. If the new source only differs from it inside
+ *  one function's body, only that function is parsed, checked and turned
+ *  into intermediate code again before we generate the shader. The lines
+ *  after that function are allowed to move, so adding and removing lines
+ *  in the body is fine. Anything else, like changing a function's
+ *  signature or a global, gets a full compile.
+ *
+ * A session isn't thread safe: only compile one thing in it at a time.
+ *  Different sessions can compile on different threads, so long as your
+ *  allocator and include callbacks are thread safe.
+ */
+DECLSPEC const MOJOSHADER_compileData *MOJOSHADER_compileWithSession(
+                                    MOJOSHADER_compileSession *session,
+                                    const char *source, unsigned int sourcelen);
+
+/*
+ * Release a compile session, and everything it holds on to. Results from
+ *  MOJOSHADER_compileWithSession() stay valid until you free them.
+ *  Passing a NULL here is a safe no-op.
+ */
+DECLSPEC void MOJOSHADER_destroyCompileSession(MOJOSHADER_compileSession *session);
+
+
 /*
  * Call this to dispose of compile results when you are done with them.
  *  This will call the MOJOSHADER_free function you provided to
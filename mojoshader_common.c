@@ -1,6 +1,15 @@
 #define __MOJOSHADER_INTERNAL__ 1
 #include "mojoshader_internal.h"
 #include <math.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 // Convenience functions for allocators...
 #if !MOJOSHADER_FORCE_ALLOCATOR
@@ -38,6 +47,7 @@ struct HashTable
 {
     HashItem **table;
     uint32 table_len;
+    uint32 item_count;
     int stackable;
     void *data;
     HashTable_HashFn hash;
@@ -139,6 +149,53 @@ int hash_iter_keys(const HashTable *table, const void **_key, void **iter)
     return 1;
 } // hash_iter_keys
 
+// Double the bucket count once the chains average more than two items.
+//  Each old chain is moved front-to-back onto the tail of its new chain, so
+//  items sharing a key keep their order (stackable tables depend on that).
+//  If we can't get the memory, we just keep the saturated table.
+static void hash_grow(HashTable *table)
+{
+    const uint32 new_len = table->table_len * 2;
+    HashItem **new_table = (HashItem **) table->m(sizeof (HashItem *) * new_len, table->d);
+    HashItem **tails;
+    uint32 i;
+
+    if (new_table == NULL)
+        return;
+
+    tails = (HashItem **) table->m(sizeof (HashItem *) * new_len, table->d);
+    if (tails == NULL)
+    {
+        table->f(new_table, table->d);
+        return;
+    } // if
+
+    memset(new_table, '\0', sizeof (HashItem *) * new_len);
+    memset(tails, '\0', sizeof (HashItem *) * new_len);
+
+    for (i = 0; i < table->table_len; i++)
+    {
+        HashItem *item = table->table[i];
+        while (item != NULL)
+        {
+            HashItem *next = item->next;
+            const uint32 hash = table->hash(item->key, table->data) & (new_len-1);
+            item->next = NULL;
+            if (tails[hash] == NULL)
+                new_table[hash] = item;
+            else
+                tails[hash]->next = item;
+            tails[hash] = item;
+            item = next;
+        } // while
+    } // for
+
+    table->f(tails, table->d);
+    table->f(table->table, table->d);
+    table->table = new_table;
+    table->table_len = new_len;
+} // hash_grow
+
 int hash_insert(HashTable *table, const void *key, const void *value)
 {
     HashItem *item = NULL;
@@ -146,7 +203,6 @@ int hash_insert(HashTable *table, const void *key, const void *value)
     if ( (!table->stackable) && (hash_find(table, key, NULL)) )
         return 0;
 
-    // !!! FIXME: grow and rehash table if it gets too saturated.
     item = (HashItem *) table->m(sizeof (HashItem), table->d);
     if (item == NULL)
         return -1;
@@ -156,6 +212,9 @@ int hash_insert(HashTable *table, const void *key, const void *value)
     item->next = table->table[hash];
     table->table[hash] = item;
 
+    if (++table->item_count > (table->table_len * 2))
+        hash_grow(table);
+
     return 1;
 } // hash_insert
 
@@ -231,6 +290,7 @@ int hash_remove(HashTable *table, const void *key)
 
             table->nuke(item->key, item->value, data);
             table->f(item, table->d);
+            table->item_count--;
             return 1;
         } // if
 
@@ -267,6 +327,11 @@ int hash_keymatch_string(const void *a, const void *b, void *data)
     return (strcmp((const char *) a, (const char *) b) == 0);
 } // hash_keymatch_string
 
+uint32 hash_bytes(const void *data, const size_t len)
+{
+    return hash_string((const char *) data, len);
+} // hash_bytes
+
 
 // string -> string map...
 
@@ -674,6 +739,22 @@ void errorlist_destroy(ErrorList *list)
 } // errorlist_destroy
 
 
+MOJOSHADER_error *errorlist_single(const char *fname, const int errpos,
+                                   const char *str, MOJOSHADER_malloc m,
+                                   MOJOSHADER_free f, void *d)
+{
+    MOJOSHADER_error *retval = NULL;
+    ErrorList *list = errorlist_create(m, f, d);
+    if (list != NULL)
+    {
+        if (errorlist_add(list, fname, errpos, str))
+            retval = errorlist_flatten(list);
+        errorlist_destroy(list);
+    } // if
+    return retval;
+} // errorlist_single
+
+
 typedef struct BufferBlock
 {
     uint8 *data;
@@ -1037,6 +1118,284 @@ ssize_t buffer_find(Buffer *buffer, const size_t start,
 } // buffer_find
 
 
+// Region allocators...
+
+// every allocation is aligned to this, which is enough for doubles, int64s
+//  and pointers, which is all our structs hold.
+#define ARENA_ALIGN 8
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;
+    size_t used;
+    size_t bytes;
+    double data[1];  // (force alignment.) Actually (bytes) long.
+} ArenaBlock;
+
+struct Arena
+{
+    ArenaBlock *head;  // current block is always the head.
+    size_t block_size;
+    MOJOSHADER_malloc m;
+    MOJOSHADER_free f;
+    void *d;
+};
+
+Arena *arena_create(size_t blksz, MOJOSHADER_malloc m,
+                    MOJOSHADER_free f, void *d)
+{
+    Arena *arena = (Arena *) m(sizeof (Arena), d);
+    if (arena != NULL)
+    {
+        memset(arena, '\0', sizeof (Arena));
+        arena->block_size = blksz;
+        arena->m = m;
+        arena->f = f;
+        arena->d = d;
+    } // if
+    return arena;
+} // arena_create
+
+void *arena_alloc(Arena *arena, const size_t _len)
+{
+    const size_t len = (_len + (ARENA_ALIGN - 1)) & ~((size_t) (ARENA_ALIGN - 1));
+    ArenaBlock *block = arena->head;
+
+    if ((block == NULL) || ((block->bytes - block->used) < len))
+    {
+        // oversized allocations get a block to themselves, slotted in
+        //  behind the current one, so we don't waste what's left of it.
+        const int oversized = (len > (arena->block_size / 4));
+        const size_t bytes = oversized ? len : arena->block_size;
+        const size_t hdr = offsetof(ArenaBlock, data);
+        ArenaBlock *item = (ArenaBlock *) arena->m((int) (hdr + bytes), arena->d);
+        if (item == NULL)
+            return NULL;
+
+        item->used = 0;
+        item->bytes = bytes;
+        if ((oversized) && (block != NULL))
+        {
+            item->next = block->next;
+            block->next = item;
+        } // if
+        else
+        {
+            item->next = block;
+            arena->head = item;
+        } // else
+        block = item;
+    } // if
+
+    void *retval = ((uint8 *) block->data) + block->used;
+    block->used += len;
+    return retval;
+} // arena_alloc
+
+void arena_destroy(Arena *arena)
+{
+    if (arena != NULL)
+    {
+        ArenaBlock *item = arena->head;
+        while (item != NULL)
+        {
+            ArenaBlock *next = item->next;
+            arena->f(item, arena->d);
+            item = next;
+        } // while
+        arena->f(arena, arena->d);
+    } // if
+} // arena_destroy
+
+
+// Mutexes...
+
+struct Mutex
+{
+#ifdef _WIN32
+    CRITICAL_SECTION cs;
+#else
+    pthread_mutex_t mutex;
+#endif
+    MOJOSHADER_free f;
+    void *d;
+};
+
+Mutex *mutex_create(MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    Mutex *retval = (Mutex *) m(sizeof (Mutex), d);
+    if (retval == NULL)
+        return NULL;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&retval->cs);
+#else
+    if (pthread_mutex_init(&retval->mutex, NULL) != 0)
+    {
+        f(retval, d);
+        return NULL;
+    } // if
+#endif
+
+    retval->f = f;
+    retval->d = d;
+    return retval;
+} // mutex_create
+
+void mutex_lock(Mutex *mutex)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&mutex->cs);
+#else
+    pthread_mutex_lock(&mutex->mutex);
+#endif
+} // mutex_lock
+
+void mutex_unlock(Mutex *mutex)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&mutex->cs);
+#else
+    pthread_mutex_unlock(&mutex->mutex);
+#endif
+} // mutex_unlock
+
+void mutex_destroy(Mutex *mutex)
+{
+    if (mutex != NULL)
+    {
+#ifdef _WIN32
+        DeleteCriticalSection(&mutex->cs);
+#else
+        pthread_mutex_destroy(&mutex->mutex);
+#endif
+        mutex->f(mutex, mutex->d);
+    } // if
+} // mutex_destroy
+
+
+// Threads...
+
+struct Thread
+{
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t thread;
+#endif
+    ThreadEntry fn;
+    void *fndata;
+    MOJOSHADER_free f;
+    void *d;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID arg)
+{
+    Thread *thread = (Thread *) arg;
+    thread->fn(thread->fndata);
+    return 0;
+} // thread_entry
+#else
+static void *thread_entry(void *arg)
+{
+    Thread *thread = (Thread *) arg;
+    thread->fn(thread->fndata);
+    return NULL;
+} // thread_entry
+#endif
+
+Thread *thread_create(ThreadEntry fn, void *fndata,
+                      MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    Thread *retval = (Thread *) m(sizeof (Thread), d);
+    if (retval == NULL)
+        return NULL;
+
+    retval->fn = fn;
+    retval->fndata = fndata;
+    retval->f = f;
+    retval->d = d;
+
+#ifdef _WIN32
+    retval->handle = CreateThread(NULL, 0, thread_entry, retval, 0, NULL);
+    if (retval->handle == NULL)
+    {
+        f(retval, d);
+        return NULL;
+    } // if
+#else
+    if (pthread_create(&retval->thread, NULL, thread_entry, retval) != 0)
+    {
+        f(retval, d);
+        return NULL;
+    } // if
+#endif
+
+    return retval;
+} // thread_create
+
+void thread_join(Thread *thread)
+{
+    if (thread != NULL)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(thread->handle, INFINITE);
+        CloseHandle(thread->handle);
+#else
+        pthread_join(thread->thread, NULL);
+#endif
+        thread->f(thread, thread->d);
+    } // if
+} // thread_join
+
+int cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const int retval = (int) info.dwNumberOfProcessors;
+#else
+    const int retval = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return (retval < 1) ? 1 : retval;
+} // cpu_count
+
+
+// Run-once initialization...
+
+// One lock for every run_once() in the library: it's only held while
+//  checking a flag, or the very first time something gets built.
+#ifdef _WIN32
+static SRWLOCK once_lock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t once_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+int run_once(OnceFlag *flag, OnceEntry fn)
+{
+    int retval;
+
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&once_lock);
+#else
+    pthread_mutex_lock(&once_lock);
+#endif
+
+    if (!*flag)
+        *flag = fn() ? 1 : 0;  // if (fn) fails, the next caller tries again.
+    retval = *flag;
+
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&once_lock);
+#else
+    pthread_mutex_unlock(&once_lock);
+#endif
+
+    return retval;
+} // run_once
+
+
 // Based on SDL_string.c's SDL_PrintFloat function
 size_t MOJOSHADER_printFloat(char *text, size_t maxlen, float arg)
 {
@@ -14,6 +14,8 @@
 #define __MOJOSHADER_INTERNAL__ 1
 #include "mojoshader_internal.h"
 
+#include <math.h>
+
 #if DEBUG_COMPILER_PARSER
 #define LEMON_SUPPORT_TRACING 1
 #endif
@@ -70,15 +72,61 @@ typedef struct SymbolScope
     const MOJOSHADER_astDataType *datatype;
     int index;  // unique positive value within a function, negative if global.
     int referenced;  // non-zero if something looked for this symbol (so we know it's used).
-    struct SymbolScope *next;
+    int depth;  // how many scopes deep it was pushed; zero is global scope.
+    uint32 serial;  // push order, so analysis workers know what they can see.
 } SymbolScope;
 
+// Symbols are kept in push order, in blocks of this many that never move,
+//  so the hash can point right at them. Popping a scope truncates the list
+//  back to where the scope started, and the blocks get reused.
+#define SYMBOL_BLOCK_SIZE 256
+
 typedef struct SymbolMap
 {
-    HashTable *hash;
-    SymbolScope *scope;
+    HashTable *hash;  // newest symbol by name, stacked over older ones.
+    SymbolScope **blocks;
+    int block_count;
+    int blocks_allocated;
+    int count;  // symbols in the map, oldest first.
+    int *scopes;  // (count) when each open scope was pushed...
+    int depth;  // ...and how many of those there are.
+    int scopes_allocated;
+    const HashTable *globals;  // main thread's global scope, in analysis workers.
+    const HashTable *builtins;  // shared, read-only global scope underneath.
 } SymbolMap;
 
+// Every overload of a function with a given name and parameter count,
+//  newest first (the order the symbol map would give them to us). Calls
+//  look these up directly instead of walking everything with the
+//  callee's name. See push_function() and match_func_to_call().
+typedef struct FunctionOverload
+{
+    const MOJOSHADER_astDataType *datatype;  // always a FUNCTION.
+    int index;
+    uint32 serial;  // same as its SymbolScope's.
+    struct FunctionOverload *next;
+} FunctionOverload;
+
+typedef struct FunctionOverloads
+{
+    const char *symbol;
+    int num_params;
+    FunctionOverload *overloads;
+} FunctionOverloads;
+
+// A call's argument datatypes, the overloads it could mean, and which one
+//  it does mean. Datatypes are interned, and adding an overload changes the
+//  head of its list, so the same key always resolves the same way: each
+//  distinct kind of call only gets scored once per compile.
+typedef struct CallResolution
+{
+    const FunctionOverload *overloads[2];  // ours, then the intrinsics.
+    int argcount;
+    const MOJOSHADER_astDataType **argtypes;
+    const FunctionOverload *best;  // NULL if nothing matched.
+    int match;  // more than one if the call is ambiguous.
+} CallResolution;
+
 typedef struct LoopLabels
 {
     int start;  // loop's start label during IR build.
@@ -86,8 +134,91 @@ typedef struct LoopLabels
     struct LoopLabels *prev;
 } LoopLabels;
 
+// What each IR optimization pass did, summed over every function in the
+//  compile. See optimize_ir().
+typedef enum IrPass
+{
+    IR_PASS_CANONICALIZE,
+    IR_PASS_FOLD_CONSTANTS,
+    IR_PASS_PROPAGATE_COPIES,
+    IR_PASS_COMMON_SUBEXPRESSIONS,
+    IR_PASS_DEAD_CODE,
+    IR_PASS_TOTAL
+} IrPass;
+
+typedef struct IrCounts
+{
+    int instructions;  // statements, not counting SEQs and labels.
+    int nodes;  // everything, not counting SEQs and EXPRLISTs.
+    int temps;  // distinct temps, per function.
+} IrCounts;
+
+typedef struct IrPassStats
+{
+    IrCounts before;
+    IrCounts after;
+    int changes;  // things the pass folded, replaced or removed.
+} IrPassStats;
+
+// The builtin datatypes. Every compile shares these, so their addresses are
+//  the interned copies of these types (see intern_datatype()). The buffer
+//  types get their base filled in by build_builtins().
+static const MOJOSHADER_astDataType dt_none = { MOJOSHADER_AST_DATATYPE_NONE };
+static const MOJOSHADER_astDataType dt_bool = { MOJOSHADER_AST_DATATYPE_BOOL };
+static const MOJOSHADER_astDataType dt_int = { MOJOSHADER_AST_DATATYPE_INT };
+static const MOJOSHADER_astDataType dt_uint = { MOJOSHADER_AST_DATATYPE_UINT };
+static const MOJOSHADER_astDataType dt_float = { MOJOSHADER_AST_DATATYPE_FLOAT };
+static const MOJOSHADER_astDataType dt_float_snorm = { MOJOSHADER_AST_DATATYPE_FLOAT_SNORM };
+static const MOJOSHADER_astDataType dt_float_unorm = { MOJOSHADER_AST_DATATYPE_FLOAT_UNORM };
+static const MOJOSHADER_astDataType dt_half = { MOJOSHADER_AST_DATATYPE_HALF };
+static const MOJOSHADER_astDataType dt_double = { MOJOSHADER_AST_DATATYPE_DOUBLE };
+static const MOJOSHADER_astDataType dt_string = { MOJOSHADER_AST_DATATYPE_STRING };
+static const MOJOSHADER_astDataType dt_sampler1d = { MOJOSHADER_AST_DATATYPE_SAMPLER_1D };
+static const MOJOSHADER_astDataType dt_sampler2d = { MOJOSHADER_AST_DATATYPE_SAMPLER_2D };
+static const MOJOSHADER_astDataType dt_sampler3d = { MOJOSHADER_AST_DATATYPE_SAMPLER_3D };
+static const MOJOSHADER_astDataType dt_samplercube = { MOJOSHADER_AST_DATATYPE_SAMPLER_CUBE };
+static const MOJOSHADER_astDataType dt_samplerstate = { MOJOSHADER_AST_DATATYPE_SAMPLER_STATE };
+static const MOJOSHADER_astDataType dt_samplercompstate = { MOJOSHADER_AST_DATATYPE_SAMPLER_COMPARISON_STATE };
+static MOJOSHADER_astDataType dt_buf_bool;
+static MOJOSHADER_astDataType dt_buf_int;
+static MOJOSHADER_astDataType dt_buf_uint;
+static MOJOSHADER_astDataType dt_buf_half;
+static MOJOSHADER_astDataType dt_buf_float;
+static MOJOSHADER_astDataType dt_buf_double;
+static MOJOSHADER_astDataType dt_buf_float_snorm;
+static MOJOSHADER_astDataType dt_buf_float_unorm;
+
 // Compile state, passed around all over the place.
 
+// Function zero runs the static globals' initializers; the rest are the
+//  user's functions, by index. See intermediate_representation().
+typedef struct IrFunction
+{
+    const MOJOSHADER_astCompilationUnitFunction *ast;  // NULL for function 0.
+    int rettemp;  // temp that holds the function's return value, or -1.
+    int first_temp;  // the function's temps are (first_temp) and up...
+    int temp_count;  // ...and there are (temp_count) of them.
+} IrFunction;
+
+// A function's IR once it's built and optimized, packed into parallel arrays
+//  instead of a tree of nodes. Node (i)'s operands are operands[first[i]]
+//  up to operands[first[i+1]], and they're node indices except where
+//  encode_flat_ir() says otherwise. Children always come before their
+//  parents, so the root is the last node. See ir_tree_view().
+typedef struct IrFlat
+{
+    int node_count;
+    int link_count;  // extra SEQ and EXPRLIST nodes a tree view needs.
+    uint8 *types;  // MOJOSHADER_irNodeType
+    uint8 *datatypes;  // MOJOSHADER_astDataTypeType, for expressions.
+    uint8 *ops;  // binop type or cjump condition.
+    uint16 *elements;
+    uint16 *files;  // index into ctx->ir_files.
+    uint32 *lines;
+    uint32 *first;  // (node_count + 1) of these.
+    uint32 *operands;
+} IrFlat;
+
 typedef struct Context
 {
     int isfail;
@@ -105,49 +236,55 @@ typedef struct Context
     MOJOSHADER_astNode *ast;  // Abstract Syntax Tree
     const char *source_profile;
     int is_func_scope; // non-zero if semantic analysis is in function scope.
+    const MOJOSHADER_astDataType *func_retval;  // what "return" must produce.
     int loop_count;
     int switch_count;
     int var_index;  // next variable index for current function.
     int global_var_index;  // next variable index for global scope.
     int user_func_index;  // next function index for user-defined functions.
     int intrinsic_func_index;  // next function index for intrinsic functions.
-
-    MOJOSHADER_irStatement **ir;  // intermediate representation.
+    uint32 symbol_serial;  // last serial push_symbol() handed out.
+    uint32 visible_serial;  // globals pushed after this one aren't in view yet.
+    Mutex *analysis_lock;  // non-NULL if analysis workers share our arena, etc.
+    MOJOSHADER_astDataType **global_usertypes;  // what parsing pushed globally.
+    int global_usertype_count;
+    int max_analysis_threads;  // see semantic_analysis().
+
+    IrFlat *ir;  // intermediate representation, by function index.
+    IrFunction *ir_funcs;  // what each function in (ir) came from.
+    uint32 *ir_constants;  // constant pool for all of (ir); see intern_ir_constant().
+    int ir_constant_count;
+    int ir_constant_alloc;
+    HashTable *ir_constant_map;  // interned pool entries.
+    const char **ir_files;  // filenames (ir) refers to, by index.
+    int ir_file_count;
+    int ir_file_alloc;
     int ir_label_count;  // next unused IR label index.
     int ir_temp_count;  // next unused IR temporary value index.
     int ir_end; // current function's end label during IR build.
     int ir_ret; // temp that holds current function's retval during IR build.
     LoopLabels *ir_loop;  // nested loop boundary labels during IR build.
-
-    // Cache intrinsic types for fast lookup and consistent pointer values.
-    MOJOSHADER_astDataType dt_none;
-    MOJOSHADER_astDataType dt_bool;
-    MOJOSHADER_astDataType dt_int;
-    MOJOSHADER_astDataType dt_uint;
-    MOJOSHADER_astDataType dt_float;
-    MOJOSHADER_astDataType dt_float_snorm;
-    MOJOSHADER_astDataType dt_float_unorm;
-    MOJOSHADER_astDataType dt_half;
-    MOJOSHADER_astDataType dt_double;
-    MOJOSHADER_astDataType dt_string;
-    MOJOSHADER_astDataType dt_sampler1d;
-    MOJOSHADER_astDataType dt_sampler2d;
-    MOJOSHADER_astDataType dt_sampler3d;
-    MOJOSHADER_astDataType dt_samplercube;
-    MOJOSHADER_astDataType dt_samplerstate;
-    MOJOSHADER_astDataType dt_samplercompstate;
-    MOJOSHADER_astDataType dt_buf_bool;
-    MOJOSHADER_astDataType dt_buf_int;
-    MOJOSHADER_astDataType dt_buf_uint;
-    MOJOSHADER_astDataType dt_buf_half;
-    MOJOSHADER_astDataType dt_buf_float;
-    MOJOSHADER_astDataType dt_buf_double;
-    MOJOSHADER_astDataType dt_buf_float_snorm;
-    MOJOSHADER_astDataType dt_buf_float_unorm;
-
-    Buffer *garbage;  // this is sort of hacky.
+    int ir_flatten;  // > 0 while building the branches of a [flatten] if.
+    int want_ir_stats;  // non-zero to fill in (ir_stats).
+    IrPassStats ir_stats[IR_PASS_TOTAL];  // see optimize_ir().
+
+    Arena *arena;  // AST nodes and datatypes; all freed at once.
+    HashTable *datatypes;  // interned datatypes, see intern_datatype().
+    HashTable *functions;  // FunctionOverloads by name and param count.
+    HashTable *calls;  // CallResolutions, see match_func_to_call().
+
+    char *output;  // D3D assembly source from codegen().
+    int output_len;
+    unsigned char *bytecode;  // ...and what MOJOSHADER_assemble() made of it.
+    int bytecode_len;
+    MOJOSHADER_symbol *symbols;  // the uniforms the shader uses.
+    int symbol_count;
 } Context;
 
+// Builtin typedefs, intrinsics and their datatypes. See build_builtins().
+static const Context *builtin_ctx = NULL;
+static OnceFlag builtin_once = 0;
+
 
 // !!! FIXME: cut and paste between every damned source file follows...
 // !!! FIXME: We need to make some sort of ContextBase that applies to all
@@ -168,6 +305,37 @@ static inline void *Malloc(Context *ctx, const size_t len)
     return retval;
 } // Malloc
 
+// Analysis workers share the arena, the interned datatypes and the string
+//  cache with the main thread. See semantic_analysis().
+static inline void lock_shared(Context *ctx)
+{
+    if (ctx->analysis_lock != NULL)
+        mutex_lock(ctx->analysis_lock);
+} // lock_shared
+
+static inline void unlock_shared(Context *ctx)
+{
+    if (ctx->analysis_lock != NULL)
+        mutex_unlock(ctx->analysis_lock);
+} // unlock_shared
+
+// Memory that lives as long as the AST: never Free() this, it all goes
+//  away with the arena in destroy_context().
+static inline void *ArenaMalloc(Context *ctx, const size_t len)
+{
+    void *retval = NULL;
+    if (ctx->arena != NULL)
+    {
+        lock_shared(ctx);
+        retval = arena_alloc(ctx->arena, len);
+        unlock_shared(ctx);
+    } // if
+
+    if (retval == NULL)
+        out_of_memory(ctx);
+    return retval;
+} // ArenaMalloc
+
 static inline char *StrDup(Context *ctx, const char *str)
 {
     char *retval = (char *) Malloc(ctx, strlen(str) + 1);
@@ -237,15 +405,94 @@ static void symbolmap_nuke(const void *k, const void *v, void *d) {/*no-op*/}
 static int create_symbolmap(Context *ctx, SymbolMap *map)
 {
     // !!! FIXME: should compare string pointer, with string in cache.
-    map->scope = NULL;
+    memset(map, '\0', sizeof (SymbolMap));
     map->hash = hash_create(ctx, hash_hash_string, hash_keymatch_string,
                             symbolmap_nuke, 1, MallocBridge, FreeBridge, ctx);
     return (map->hash != NULL);
 } // create_symbolmap
 
-static int datatypes_match(const MOJOSHADER_astDataType *a,
-                           const MOJOSHADER_astDataType *b)
+// Datatypes are interned: every datatype we build goes through
+//  intern_datatype(), so each distinct type exists exactly once per compile
+//  and comparing them is a pointer compare. Since a type's children were
+//  interned before it was, hashing and matching only need to look one level
+//  deep (child pointers, not child contents).
+// The one exception is the USER types that push_usertype() creates: those
+//  are per-declaration, and reduce_datatype() patches them after the fact.
+
+static inline uint32 mix_datatype_hash(const uint32 hash, const size_t val)
+{
+    return (hash * 31) ^ ((uint32) val) ^ ((uint32) (((uint64) val) >> 32));
+} // mix_datatype_hash
+
+static inline uint32 stir_datatype_hash(uint32 hash)
+{
+    // pointers are aligned and the table only looks at the low bits, so
+    //  stir the high bits down before handing this back.
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    return hash;
+} // stir_datatype_hash
+
+static uint32 hash_hash_datatype(const void *key, void *data)
+{
+    const MOJOSHADER_astDataType *dt = (const MOJOSHADER_astDataType *) key;
+    uint32 hash = mix_datatype_hash(5381, (size_t) dt->type);
+    int i;
+
+    switch (dt->type & ~MOJOSHADER_AST_DATATYPE_CONST)
+    {
+        case MOJOSHADER_AST_DATATYPE_STRUCT:
+            hash = mix_datatype_hash(hash, dt->structure.member_count);
+            for (i = 0; i < dt->structure.member_count; i++)
+            {
+                const MOJOSHADER_astDataTypeStructMember *mbr;
+                mbr = &dt->structure.members[i];
+                hash = mix_datatype_hash(hash, (size_t) mbr->datatype);
+                hash = mix_datatype_hash(hash, (size_t) mbr->identifier);
+            } // for
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_ARRAY:
+        case MOJOSHADER_AST_DATATYPE_VECTOR:
+            hash = mix_datatype_hash(hash, (size_t) dt->array.elements);
+            hash = mix_datatype_hash(hash, (size_t) dt->array.base);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_MATRIX:
+            hash = mix_datatype_hash(hash, (size_t) dt->matrix.rows);
+            hash = mix_datatype_hash(hash, (size_t) dt->matrix.columns);
+            hash = mix_datatype_hash(hash, (size_t) dt->matrix.base);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_BUFFER:
+            hash = mix_datatype_hash(hash, (size_t) dt->buffer.base);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_FUNCTION:
+            hash = mix_datatype_hash(hash, (size_t) dt->function.num_params);
+            hash = mix_datatype_hash(hash, (size_t) dt->function.intrinsic);
+            hash = mix_datatype_hash(hash, (size_t) dt->function.retval);
+            for (i = 0; i < dt->function.num_params; i++)
+                hash = mix_datatype_hash(hash, (size_t) dt->function.params[i]);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_USER:
+            hash = mix_datatype_hash(hash, (size_t) dt->user.details);
+            hash = mix_datatype_hash(hash, (size_t) dt->user.name);
+            break;
+
+        default:
+            break;  // scalars, samplers, etc: the type is everything.
+    } // switch
+
+    return stir_datatype_hash(hash);
+} // hash_hash_datatype
+
+static int hash_keymatch_datatype(const void *_a, const void *_b, void *data)
 {
+    const MOJOSHADER_astDataType *a = (const MOJOSHADER_astDataType *) _a;
+    const MOJOSHADER_astDataType *b = (const MOJOSHADER_astDataType *) _b;
     int i;
 
     if (a == b)
@@ -253,15 +500,15 @@ static int datatypes_match(const MOJOSHADER_astDataType *a,
     else if (a->type != b->type)
         return 0;
 
-    switch (a->type)
+    switch (a->type & ~MOJOSHADER_AST_DATATYPE_CONST)
     {
         case MOJOSHADER_AST_DATATYPE_STRUCT:
             if (a->structure.member_count != b->structure.member_count)
                 return 0;
             for (i = 0; i < a->structure.member_count; i++)
             {
-                if (!datatypes_match(a->structure.members[i].datatype,
-                                     b->structure.members[i].datatype))
+                if (a->structure.members[i].datatype !=
+                    b->structure.members[i].datatype)
                     return 0;
                 // stringcache'd, pointer compare is safe.
                 else if (a->structure.members[i].identifier !=
@@ -271,103 +518,202 @@ static int datatypes_match(const MOJOSHADER_astDataType *a,
             return 1;
 
         case MOJOSHADER_AST_DATATYPE_ARRAY:
-            if (a->array.elements != b->array.elements)
-                return 0;
-            else if (!datatypes_match(a->array.base, b->array.base))
-                return 0;
-            return 1;
-
         case MOJOSHADER_AST_DATATYPE_VECTOR:
-            if (a->vector.elements != b->vector.elements)
-                return 0;
-            else if (!datatypes_match(a->vector.base, b->vector.base))
-                return 0;
-            return 1;
+            return ( (a->array.elements == b->array.elements) &&
+                     (a->array.base == b->array.base) );
 
         case MOJOSHADER_AST_DATATYPE_MATRIX:
-            if (a->matrix.rows != b->matrix.rows)
-                return 0;
-            else if (a->matrix.columns != b->matrix.columns)
-                return 0;
-            else if (!datatypes_match(a->matrix.base, b->matrix.base))
-                return 0;
-            return 1;
+            return ( (a->matrix.rows == b->matrix.rows) &&
+                     (a->matrix.columns == b->matrix.columns) &&
+                     (a->matrix.base == b->matrix.base) );
 
         case MOJOSHADER_AST_DATATYPE_BUFFER:
-            return datatypes_match(a->buffer.base, b->buffer.base);
+            return (a->buffer.base == b->buffer.base);
 
         case MOJOSHADER_AST_DATATYPE_FUNCTION:
             if (a->function.num_params != b->function.num_params)
                 return 0;
             else if (a->function.intrinsic != b->function.intrinsic)
                 return 0;
-            else if (!datatypes_match(a->function.retval, b->function.retval))
+            else if (a->function.retval != b->function.retval)
                 return 0;
             for (i = 0; i < a->function.num_params; i++)
             {
-                if (!datatypes_match(a->function.params[i], b->function.params[i]))
+                if (a->function.params[i] != b->function.params[i])
                     return 0;
             } // for
             return 1;
 
         case MOJOSHADER_AST_DATATYPE_USER:
-            return 0;  // pointers must match, this clearly didn't.
+            // stringcache'd, pointer compare is safe.
+            return ( (a->user.details == b->user.details) &&
+                     (a->user.name == b->user.name) );
 
         default:
-            assert(0 && "unexpected case");
-            return 0;
+            return 1;  // same type, and scalars have nothing else to compare.
     } // switch
 
     return 0;
+} // hash_keymatch_datatype
+
+static void datatype_nuke(const void *k, const void *v, void *d) {/*no-op*/}
+
+// Returns the one true copy of (*dt), adding a copy of it (and its params or
+//  members arrays) to ctx->arena if it's new. (dt) can live on the stack.
+static const MOJOSHADER_astDataType *intern_datatype(Context *ctx,
+                                            const MOJOSHADER_astDataType *dt)
+{
+    // These tables are "stackable" only so hash_find() won't reorder them:
+    //  the builtin one is shared between threads and has to stay read-only.
+    const void *value = NULL;
+    int found = 0;
+    if (ctx->datatypes == NULL)  // out of memory in build_context().
+        return NULL;
+    else if ((builtin_ctx != NULL) && (hash_find(builtin_ctx->datatypes, dt, &value)))
+        return (const MOJOSHADER_astDataType *) value;
+
+    lock_shared(ctx);
+    found = hash_find(ctx->datatypes, dt, &value);
+    unlock_shared(ctx);
+    if (found)
+        return (const MOJOSHADER_astDataType *) value;
+
+    MOJOSHADER_astDataType *retval;
+    retval = (MOJOSHADER_astDataType *) ArenaMalloc(ctx, sizeof (*retval));
+    if (retval == NULL)
+        return NULL;
+    memcpy(retval, dt, sizeof (*retval));
+
+    const MOJOSHADER_astDataTypeType type = dt->type & ~MOJOSHADER_AST_DATATYPE_CONST;
+    if ((type == MOJOSHADER_AST_DATATYPE_FUNCTION) && (dt->function.num_params > 0))
+    {
+        const size_t len = sizeof (*dt->function.params) * dt->function.num_params;
+        void *ptr = ArenaMalloc(ctx, len);
+        if (ptr == NULL)
+            return NULL;
+        memcpy(ptr, dt->function.params, len);
+        retval->function.params = (const MOJOSHADER_astDataType **) ptr;
+    } // if
+    else if ((type == MOJOSHADER_AST_DATATYPE_STRUCT) && (dt->structure.member_count > 0))
+    {
+        const size_t len = sizeof (*dt->structure.members) * dt->structure.member_count;
+        void *ptr = ArenaMalloc(ctx, len);
+        if (ptr == NULL)
+            return NULL;
+        memcpy(ptr, dt->structure.members, len);
+        retval->structure.members = (const MOJOSHADER_astDataTypeStructMember *) ptr;
+    } // else if
+
+    // another analysis worker might have beaten us to it while we copied.
+    //  If so, the copy just sits in the arena unused.
+    lock_shared(ctx);
+    if (hash_find(ctx->datatypes, dt, &value))
+        retval = (MOJOSHADER_astDataType *) value;
+    else if (hash_insert(ctx->datatypes, retval, retval) != 1)
+    {
+        out_of_memory(ctx);
+        retval = NULL;
+    } // else if
+    unlock_shared(ctx);
+
+    return retval;
+} // intern_datatype
+
+static inline int datatypes_match(const MOJOSHADER_astDataType *a,
+                                  const MOJOSHADER_astDataType *b)
+{
+    return (a == b);  // they're all interned, see intern_datatype().
 } // datatypes_match
 
+static int grow_array(Context *ctx, void **_array, int *alloc,
+                      const int needed, const size_t len)
+{
+    if (needed <= *alloc)
+        return 1;
+
+    int newalloc = (*alloc == 0) ? 16 : *alloc;
+    while (newalloc < needed)
+        newalloc *= 2;
+
+    void *array = Malloc(ctx, newalloc * len);
+    if (array == NULL)
+        return 0;
+
+    if (*_array != NULL)
+    {
+        memcpy(array, *_array, *alloc * len);
+        Free(ctx, *_array);
+    } // if
+
+    *_array = array;
+    *alloc = newalloc;
+    return 1;
+} // grow_array
+
+static inline SymbolScope *get_symbol(const SymbolMap *map, const int idx)
+{
+    assert((idx >= 0) && (idx < map->count));
+    return &map->blocks[idx / SYMBOL_BLOCK_SIZE][idx % SYMBOL_BLOCK_SIZE];
+} // get_symbol
+
 static void push_symbol(Context *ctx, SymbolMap *map, const char *sym,
                         const MOJOSHADER_astDataType *dt, const int index,
                         const int check_dupes)
 {
-    if (ctx->out_of_memory)
+    if ((ctx->out_of_memory) || (sym == NULL))
         return;
 
     // Decide if this symbol is defined, and if it's in the current scope.
-    SymbolScope *item = NULL;
-    const void *value = NULL;
-    if ((check_dupes) && (sym != NULL) && (hash_find(map->hash, sym, &value)))
+    //  Only the newest symbol with this name could be, and it knows which
+    //  scope it's in.
+    if (check_dupes)
     {
-        // check the current scope for a dupe.
-        // !!! FIXME: note current scope's starting index, see if found
-        // !!! FIXME:  item is < index (and thus, a previous scope).
-        item = map->scope;
-        while ((item) && (item->symbol))
+        const void *value = NULL;
+        if (hash_find(map->hash, sym, &value))
         {
-            if ( ((const void *) item) == value )
+            if (((const SymbolScope *) value)->depth == map->depth)
             {
                 failf(ctx, "Symbol '%s' already defined", sym);
                 return;
             } // if
-            item = item->next;
-        } // while
-    } // if
+        } // if
 
-    // Add the symbol to our map and scope stack.
-    item = (SymbolScope *) Malloc(ctx, sizeof (SymbolScope));
-    if (item == NULL)
-        return;
+        // builtins belong to the global scope, under everything else.
+        else if ( (map->depth == 0) && (map->builtins != NULL) &&
+                  (hash_find(map->builtins, sym, NULL)) )
+        {
+            failf(ctx, "Symbol '%s' already defined", sym);
+            return;
+        } // else if
+    } // if
 
-    if (sym != NULL)  // sym can be NULL if we're pushing a new scope.
+    // Add the symbol to our map.
+    const int block = map->count / SYMBOL_BLOCK_SIZE;
+    if (block >= map->block_count)
     {
-        if (hash_insert(map->hash, sym, item) == -1)
-        {
-            Free(ctx, item);
+        if (!grow_array(ctx, (void **) &map->blocks,
+                        &map->blocks_allocated, block + 1,
+                        sizeof (SymbolScope *)))
             return;
-        } // if
+
+        const size_t len = sizeof (SymbolScope) * SYMBOL_BLOCK_SIZE;
+        map->blocks[block] = (SymbolScope *) Malloc(ctx, len);
+        if (map->blocks[block] == NULL)
+            return;
+        map->block_count++;
     } // if
 
+    SymbolScope *item = &map->blocks[block][map->count % SYMBOL_BLOCK_SIZE];
+    if (hash_insert(map->hash, sym, item) == -1)
+        return;
+
+    map->count++;
     item->symbol = sym;  // cached strings, don't copy.
     item->index = index;
     item->datatype = dt;
     item->referenced = 0;
-    item->next = map->scope;
-    map->scope = item;
+    item->depth = map->depth;
+    item->serial = ++ctx->symbol_serial;
 } // push_symbol
 
 static void push_usertype(Context *ctx, const char *sym, const MOJOSHADER_astDataType *dt)
@@ -375,16 +721,9 @@ static void push_usertype(Context *ctx, const char *sym, const MOJOSHADER_astDat
     if (sym != NULL)
     {
         MOJOSHADER_astDataType *userdt;
-        userdt = (MOJOSHADER_astDataType *) Malloc(ctx, sizeof (*userdt));
+        userdt = (MOJOSHADER_astDataType *) ArenaMalloc(ctx, sizeof (*userdt));
         if (userdt != NULL)
         {
-            // !!! FIXME: this is hacky.
-            if (!buffer_append(ctx->garbage, &userdt, sizeof (userdt)))
-            {
-                Free(ctx, userdt);
-                return;
-            } // if
-
             userdt->type = MOJOSHADER_AST_DATATYPE_USER;
             userdt->user.details = dt;
             userdt->user.name = sym;
@@ -396,15 +735,57 @@ static void push_usertype(Context *ctx, const char *sym, const MOJOSHADER_astDat
     push_symbol(ctx, &ctx->usertypes, sym, dt, 0, 1);
 } // push_usertype
 
-static inline void push_variable(Context *ctx, const char *sym, const MOJOSHADER_astDataType *dt)
+static const MOJOSHADER_astDataType *reduce_datatype(Context *ctx, const MOJOSHADER_astDataType *dt);
+
+// The struct that (dt) is, or is an array of, or NULL.
+static const MOJOSHADER_astDataType *datatype_struct(Context *ctx,
+                                        const MOJOSHADER_astDataType *dt)
+{
+    dt = reduce_datatype(ctx, dt);
+    if ((dt != NULL) && ((dt->type & ~MOJOSHADER_AST_DATATYPE_CONST) == MOJOSHADER_AST_DATATYPE_ARRAY))
+        dt = reduce_datatype(ctx, dt->array.base);
+    if ((dt != NULL) && ((dt->type & ~MOJOSHADER_AST_DATATYPE_CONST) == MOJOSHADER_AST_DATATYPE_STRUCT))
+        return dt;
+    return NULL;
+} // datatype_struct
+
+// How many variable indexes a variable of this type needs. A struct has
+//  one for itself, then its members' after that, so a struct in a struct
+//  has its own, too. An array of structs keeps an array per member, so it
+//  needs as many as its struct does.
+static int datatype_index_count(Context *ctx, const MOJOSHADER_astDataType *dt)
+{
+    int retval = 1;
+    int i;
+
+    dt = datatype_struct(ctx, dt);
+    for (i = 0; (dt != NULL) && (i < dt->structure.member_count); i++)
+        retval += datatype_index_count(ctx, dt->structure.members[i].datatype);
+    return retval;
+} // datatype_index_count
+
+// How far member (member) of a struct (or array of structs) is from it.
+static int datatype_member_offset(Context *ctx,
+                                  const MOJOSHADER_astDataType *dt,
+                                  const int member)
+{
+    int retval = 1;
+    int i;
+
+    dt = datatype_struct(ctx, dt);
+    for (i = 0; (dt != NULL) && (i < member); i++)
+        retval += datatype_index_count(ctx, dt->structure.members[i].datatype);
+    return retval;
+} // datatype_member_offset
+
+// Returns the variable's index, which the IR uses to refer to it.
+static inline int push_variable(Context *ctx, const char *sym, const MOJOSHADER_astDataType *dt)
 {
     int idx = 0;
     if (sym != NULL)
     {
         // leave space for individual member indexes. The IR will need this.
-        int additional = 0;
-        if (dt->type == MOJOSHADER_AST_DATATYPE_STRUCT)
-            additional = dt->structure.member_count;
+        const int additional = datatype_index_count(ctx, dt) - 1;
         if (ctx->is_func_scope)
         {
             idx = ++ctx->var_index;  // these are positive.
@@ -412,101 +793,210 @@ static inline void push_variable(Context *ctx, const char *sym, const MOJOSHADER
         } // if
         else
         {
-            idx = --ctx->global_var_index;  // these are negative.
+            // these are negative, but members still count up from (idx).
             ctx->global_var_index -= additional;
+            idx = --ctx->global_var_index;
         } // else
     } // if
 
     push_symbol(ctx, &ctx->variables, sym, dt, idx, 1);
+    return idx;
 } // push_variable
 
+static uint32 hash_hash_overloads(const void *key, void *data)
+{
+    const FunctionOverloads *fos = (const FunctionOverloads *) key;
+    const uint32 hash = hash_hash_string(fos->symbol, data);
+    return mix_datatype_hash(hash, (size_t) fos->num_params);
+} // hash_hash_overloads
+
+static int hash_keymatch_overloads(const void *_a, const void *_b, void *data)
+{
+    const FunctionOverloads *a = (const FunctionOverloads *) _a;
+    const FunctionOverloads *b = (const FunctionOverloads *) _b;
+    return ( (a->num_params == b->num_params) &&
+             (hash_keymatch_string(a->symbol, b->symbol, data)) );
+} // hash_keymatch_overloads
+
+static void overloads_nuke(const void *k, const void *v, void *d) {/*no-op*/}
+
+// (table) may be the shared builtin one. Like the datatypes, this is only
+//  "stackable" so hash_find() doesn't reorder it behind another thread.
+static const FunctionOverloads *find_overloads(const HashTable *table,
+                                               const char *sym,
+                                               const int num_params)
+{
+    FunctionOverloads key;
+    const void *value = NULL;
+    key.symbol = sym;
+    key.num_params = num_params;
+    if ((table != NULL) && (hash_find(table, &key, &value)))
+        return (const FunctionOverloads *) value;
+    return NULL;
+} // find_overloads
+
+static void add_overload(Context *ctx, const char *sym,
+                         const MOJOSHADER_astDataType *dt, const int index)
+{
+    const int num_params = dt->function.num_params;
+    FunctionOverloads *fos;
+    fos = (FunctionOverloads *) find_overloads(ctx->functions, sym, num_params);
+    if (fos == NULL)
+    {
+        fos = (FunctionOverloads *) ArenaMalloc(ctx, sizeof (FunctionOverloads));
+        if (fos == NULL)
+            return;
+        fos->symbol = sym;  // cached strings, don't copy.
+        fos->num_params = num_params;
+        fos->overloads = NULL;
+        if (hash_insert(ctx->functions, fos, fos) != 1)
+        {
+            out_of_memory(ctx);
+            return;
+        } // if
+    } // if
+
+    FunctionOverload *fo;
+    fo = (FunctionOverload *) ArenaMalloc(ctx, sizeof (FunctionOverload));
+    if (fo == NULL)
+        return;
+    fo->datatype = dt;
+    fo->index = index;
+    fo->serial = ctx->symbol_serial;  // push_function() just pushed it.
+    fo->next = fos->overloads;
+    fos->overloads = fo;
+} // add_overload
+
 static int push_function(Context *ctx, const char *sym,
                           const MOJOSHADER_astDataType *dt,
                           const int just_declare)
 {
+    if ((sym == NULL) || (dt == NULL))
+        return 0;  // out of memory, probably.
+
     // we don't have any reason to support nested functions at the moment,
     //  so this would be a bug.
     assert(!ctx->is_func_scope);
     assert(dt->type == MOJOSHADER_AST_DATATYPE_FUNCTION);
 
     // Functions are always global, so no need to search scopes.
-    //  Functions overload, though, so we have to continue iterating to
-    //  see if it matches anything.
-    const void *value = NULL;
-    void *iter = NULL;
-    while (hash_iter(ctx->variables.hash, sym, &value, &iter))
+    //  Functions overload, though, so we have to check every overload
+    //  that takes this many parameters, intrinsics included, to see if
+    //  it matches anything.
+    const HashTable *table = ctx->functions;
+    while (table != NULL)
     {
-        // !!! FIXME: this breaks if you predeclare a function.
-        // !!! FIXME:  (a declare AFTER defining works, though.)
-        // there's already something called this.
-        SymbolScope *item = (SymbolScope *) value;
-        if (datatypes_match(dt, item->datatype))
+        const FunctionOverloads *fos;
+        fos = find_overloads(table, sym, dt->function.num_params);
+        const FunctionOverload *fo = (fos != NULL) ? fos->overloads : NULL;
+        for (; fo != NULL; fo = fo->next)
         {
-            if (!just_declare)
-                failf(ctx, "Function '%s' already defined.", sym);
-            return item->index;
-        } // if
+            // !!! FIXME: this breaks if you predeclare a function.
+            // !!! FIXME:  (a declare AFTER defining works, though.)
+            // there's already something called this.
+            if (datatypes_match(dt, fo->datatype))
+            {
+                if (!just_declare)
+                    failf(ctx, "Function '%s' already defined.", sym);
+                return fo->index;
+            } // if
+        } // for
+
+        if ((table == ctx->functions) && (builtin_ctx != NULL))
+            table = builtin_ctx->functions;
+        else
+            table = NULL;
     } // while
 
     int idx = 0;
-    if ((sym != NULL) && (dt != NULL))
-    {
-        if (!dt->function.intrinsic)
-            idx = ++ctx->user_func_index;  // these are positive.
-        else
-            idx = --ctx->intrinsic_func_index;  // these are negative.
-    } // if
+    if (!dt->function.intrinsic)
+        idx = ++ctx->user_func_index;  // these are positive.
+    else
+        idx = --ctx->intrinsic_func_index;  // these are negative.
 
     // push_symbol() doesn't check dupes, because we just did.
     push_symbol(ctx, &ctx->variables, sym, dt, idx, 0);
+    add_overload(ctx, sym, dt, idx);
 
     return idx;
 } // push_function
 
+static void push_symbol_scope(Context *ctx, SymbolMap *map)
+{
+    if (grow_array(ctx, (void **) &map->scopes,
+                   &map->scopes_allocated, map->depth + 1, sizeof (int)))
+        map->scopes[map->depth++] = map->count;
+} // push_symbol_scope
+
 static inline void push_scope(Context *ctx)
 {
-    push_usertype(ctx, NULL, NULL);
-    push_variable(ctx, NULL, NULL);
+    push_symbol_scope(ctx, &ctx->usertypes);
+    push_symbol_scope(ctx, &ctx->variables);
 } // push_scope
 
-static void pop_symbol(Context *ctx, SymbolMap *map)
+// Drop everything pushed after the first (count) symbols.
+static void truncate_symbols(SymbolMap *map, const int count)
 {
-    SymbolScope *item = map->scope;
-    if (!item)
-        return;
-    if (item->symbol)
-        hash_remove(map->hash, item->symbol);
-    map->scope = item->next;
-    Free(ctx, item);
-} // pop_symbol
+    while (map->count > count)
+    {
+        const SymbolScope *item = get_symbol(map, map->count - 1);
+        hash_remove(map->hash, item->symbol);  // it's the newest of its name.
+        map->count--;
+    } // while
+} // truncate_symbols
 
 static void pop_symbol_scope(Context *ctx, SymbolMap *map)
 {
-    while ((map->scope) && (map->scope->symbol))
-        pop_symbol(ctx, map);
-
-    assert(map->scope != NULL);
-    assert(map->scope->symbol == NULL);
-    pop_symbol(ctx, map);
+    if (map->depth > 0)  // stray '}' while parsing, otherwise.
+        truncate_symbols(map, map->scopes[--map->depth]);
 } // pop_symbol_scope
 
 static inline void pop_scope(Context *ctx)
 {
     pop_symbol_scope(ctx, &ctx->usertypes);
     pop_symbol_scope(ctx, &ctx->variables);
-} // push_scope
+} // pop_scope
+
+// Finds the newest (sym) in view: our own scopes first, then, in an analysis
+//  worker, the main thread's globals that were pushed before the function we
+//  are checking, then the builtins. (*_shared) is non-zero if it came from
+//  one of the last two, which other threads are reading, too.
+static SymbolScope *lookup_symbol(const Context *ctx, const SymbolMap *map,
+                                  const char *sym, int *_shared)
+{
+    const void *value = NULL;
+    void *iter = NULL;
+
+    *_shared = 0;
+    if (hash_find(map->hash, sym, &value))
+        return (SymbolScope *) value;
+
+    *_shared = 1;
+    if (map->globals != NULL)
+    {
+        while (hash_iter(map->globals, sym, &value, &iter))
+        {
+            const SymbolScope *item = (const SymbolScope *) value;
+            if (item->serial <= ctx->visible_serial)
+                return (SymbolScope *) item;
+        } // while
+    } // if
+
+    if ((map->builtins != NULL) && (hash_find(map->builtins, sym, &value)))
+        return (SymbolScope *) value;
+
+    return NULL;
+} // lookup_symbol
 
 static const MOJOSHADER_astDataType *find_symbol(Context *ctx, SymbolMap *map, const char *sym, int *_index)
 {
-    const void *_item = NULL;
-    hash_find(map->hash, sym, &_item);
-    SymbolScope *item = (SymbolScope *) _item;
-    if (item != NULL)
-    {
+    int shared = 0;
+    SymbolScope *item = lookup_symbol(ctx, map, sym, &shared);
+    if ((item != NULL) && (!shared))  // shared, so don't touch (referenced).
         item->referenced++;
-        if (_index != NULL)
-            *_index = item->index;
-    } // if
+
+    if ((item != NULL) && (_index != NULL))
+        *_index = item->index;
     return item ? item->datatype : NULL;
 } // find_symbol
 
@@ -522,9 +1012,16 @@ static inline const MOJOSHADER_astDataType *find_variable(Context *ctx, const ch
 
 static void destroy_symbolmap(Context *ctx, SymbolMap *map)
 {
-    while (map->scope)
-        pop_symbol(ctx, map);
-    hash_destroy(map->hash);
+    int i;
+    for (i = 0; i < map->block_count; i++)
+        Free(ctx, map->blocks[i]);
+    if (map->blocks != NULL)
+        Free(ctx, map->blocks);
+    if (map->scopes != NULL)
+        Free(ctx, map->scopes);
+    if (map->hash != NULL)
+        hash_destroy(map->hash);
+    memset(map, '\0', sizeof (SymbolMap));
 } // destroy_symbolmap
 
 
@@ -532,69 +1029,47 @@ static const MOJOSHADER_astDataType *new_datatype_vector(Context *ctx,
                                             const MOJOSHADER_astDataType *dt,
                                             const int columns)
 {
-    MOJOSHADER_astDataType *retval;
-    retval = (MOJOSHADER_astDataType *) Malloc(ctx, sizeof (*retval));
-    if (retval == NULL)
-        return NULL;
-
-    // !!! FIXME: this is hacky.
-    // !!! FIXME:  I'd like to cache these anyhow and reuse types.
-    if (!buffer_append(ctx->garbage, &retval, sizeof (retval)))
-    {
-        Free(ctx, retval);
-        return NULL;
-    } // if
-
+    MOJOSHADER_astDataType vec;
     if ((columns < 1) || (columns > 4))
         fail(ctx, "Vector must have between 1 and 4 elements");
 
-    retval->type = MOJOSHADER_AST_DATATYPE_VECTOR;
-    retval->vector.base = dt;
-    retval->vector.elements = columns;
-    return retval;
+    memset(&vec, '\0', sizeof (vec));
+    vec.type = MOJOSHADER_AST_DATATYPE_VECTOR;
+    vec.vector.base = dt;
+    vec.vector.elements = columns;
+    return intern_datatype(ctx, &vec);
 } // new_datatype_vector
 
 static const MOJOSHADER_astDataType *new_datatype_matrix(Context *ctx,
                                             const MOJOSHADER_astDataType *dt,
                                             const int rows, const int columns)
 {
-    MOJOSHADER_astDataType *retval;
-    // !!! FIXME: allocate enough for a matrix, but we need to cleanup things that copy without checking for subsize.
-    retval = (MOJOSHADER_astDataType *) Malloc(ctx, sizeof (*retval));
-    if (retval == NULL)
-        return NULL;
-
-    // !!! FIXME: this is hacky.
-    // !!! FIXME:  I'd like to cache these anyhow and reuse types.
-    if (!buffer_append(ctx->garbage, &retval, sizeof (retval)))
-    {
-        Free(ctx, retval);
-        return NULL;
-    } // if
-
+    MOJOSHADER_astDataType mat;
     if ((rows < 1) || (rows > 4))
         fail(ctx, "Matrix must have between 1 and 4 rows");
     if ((columns < 1) || (columns > 4))
         fail(ctx, "Matrix must have between 1 and 4 columns");
 
-    retval->type = MOJOSHADER_AST_DATATYPE_MATRIX;
-    retval->matrix.base = dt;
-    retval->matrix.rows = rows;
-    retval->matrix.columns = columns;
-    return retval;
+    memset(&mat, '\0', sizeof (mat));
+    mat.type = MOJOSHADER_AST_DATATYPE_MATRIX;
+    mat.matrix.base = dt;
+    mat.matrix.rows = rows;
+    mat.matrix.columns = columns;
+    return intern_datatype(ctx, &mat);
 } // new_datatype_matrix
 
 
 // !!! FIXME: move this to mojoshader_ast.c
-// !!! FIXME: new_* and delete_* should take an allocator, not a context.
+// !!! FIXME: new_* should take an allocator, not a context.
 
-// These functions are mostly for construction and cleanup of nodes in the
-//  parse tree. Mostly this is simple allocation and initialization, so we
-//  can do as little in the lemon code as possible, and then sort it all out
-//  afterwards.
+// These functions are mostly for construction of nodes in the parse tree.
+//  Mostly this is simple allocation and initialization, so we can do as
+//  little in the lemon code as possible, and then sort it all out afterwards.
+//  Nodes come out of ctx->arena, so there's no per-node cleanup: the whole
+//  tree is thrown away at once when the context is destroyed.
 
 #define NEW_AST_NODE(retval, cls, typ) \
-    cls *retval = (cls *) Malloc(ctx, sizeof (cls)); \
+    cls *retval = (cls *) ArenaMalloc(ctx, sizeof (cls)); \
     do { \
         if (retval == NULL) { return NULL; } \
         retval->ast.type = typ; \
@@ -602,13 +1077,6 @@ static const MOJOSHADER_astDataType *new_datatype_matrix(Context *ctx,
         retval->ast.line = ctx->sourceline; \
     } while (0)
 
-#define DELETE_AST_NODE(cls) do { \
-    if (!cls) return; \
-} while (0)
-
-
-static void delete_compilation_unit(Context*, MOJOSHADER_astCompilationUnit*);
-static void delete_statement(Context *ctx, MOJOSHADER_astStatement *stmt);
 
 static MOJOSHADER_astExpression *new_identifier_expr(Context *ctx,
                                                      const char *string)
@@ -688,7 +1156,7 @@ static MOJOSHADER_astExpression *new_ternary_expr(Context *ctx,
     NEW_AST_NODE(retval, MOJOSHADER_astExpressionTernary, op);
     assert(operator_is_ternary(op));
     assert(op == MOJOSHADER_AST_OP_CONDITIONAL);
-    retval->datatype = &ctx->dt_bool;
+    retval->datatype = &dt_bool;
     retval->left = left;
     retval->center = center;
     retval->right = right;
@@ -714,7 +1182,7 @@ static MOJOSHADER_astExpression *new_literal_int_expr(Context *ctx,
 {
     NEW_AST_NODE(retval, MOJOSHADER_astExpressionIntLiteral,
                  MOJOSHADER_AST_OP_INT_LITERAL);
-    retval->datatype = &ctx->dt_int;
+    retval->datatype = &dt_int;
     retval->value = value;
     return (MOJOSHADER_astExpression *) retval;
 } // new_literal_int_expr
@@ -724,7 +1192,7 @@ static MOJOSHADER_astExpression *new_literal_float_expr(Context *ctx,
 {
     NEW_AST_NODE(retval, MOJOSHADER_astExpressionFloatLiteral,
                  MOJOSHADER_AST_OP_FLOAT_LITERAL);
-    retval->datatype = &ctx->dt_float;
+    retval->datatype = &dt_float;
     retval->value = dbl;
     return (MOJOSHADER_astExpression *) retval;
 } // new_literal_float_expr
@@ -734,7 +1202,7 @@ static MOJOSHADER_astExpression *new_literal_string_expr(Context *ctx,
 {
     NEW_AST_NODE(retval, MOJOSHADER_astExpressionStringLiteral,
                  MOJOSHADER_AST_OP_STRING_LITERAL);
-    retval->datatype = &ctx->dt_string;
+    retval->datatype = &dt_string;
     retval->string = string;  // cached; don't copy string.
     return (MOJOSHADER_astExpression *) retval;
 } // new_literal_string_expr
@@ -744,55 +1212,11 @@ static MOJOSHADER_astExpression *new_literal_boolean_expr(Context *ctx,
 {
     NEW_AST_NODE(retval, MOJOSHADER_astExpressionBooleanLiteral,
                  MOJOSHADER_AST_OP_BOOLEAN_LITERAL);
-    retval->datatype = &ctx->dt_bool;
+    retval->datatype = &dt_bool;
     retval->value = value;
     return (MOJOSHADER_astExpression *) retval;
 } // new_literal_boolean_expr
 
-static void delete_arguments(Context *ctx, MOJOSHADER_astArguments *args);
-
-static void delete_expr(Context *ctx, MOJOSHADER_astExpression *_expr)
-{
-    MOJOSHADER_astNode *expr = (MOJOSHADER_astNode *) _expr;
-
-    DELETE_AST_NODE(expr);
-
-    if (expr->ast.type == MOJOSHADER_AST_OP_CAST)
-        delete_expr(ctx, expr->cast.operand);
-
-    else if (expr->ast.type == MOJOSHADER_AST_OP_CONSTRUCTOR)
-        delete_arguments(ctx, expr->constructor.args);
-
-    else if (expr->ast.type == MOJOSHADER_AST_OP_DEREF_STRUCT)
-        delete_expr(ctx, expr->derefstruct.identifier);
-
-    else if (operator_is_unary(expr->ast.type))
-        delete_expr(ctx, expr->unary.operand);
-
-    else if (operator_is_binary(expr->ast.type))
-    {
-        delete_expr(ctx, expr->binary.left);
-        delete_expr(ctx, expr->binary.right);
-    } // else if
-
-    else if (operator_is_ternary(expr->ast.type))
-    {
-        delete_expr(ctx, expr->ternary.left);
-        delete_expr(ctx, expr->ternary.center);
-        delete_expr(ctx, expr->ternary.right);
-    } // else if
-
-    else if (expr->ast.type == MOJOSHADER_AST_OP_CALLFUNC)
-    {
-        delete_expr(ctx, (MOJOSHADER_astExpression*)expr->callfunc.identifier);
-        delete_arguments(ctx, expr->callfunc.args);
-    } // else if
-
-    // rest of operators don't have extra data to free.
-
-    Free(ctx, expr);
-} // delete_expr
-
 static MOJOSHADER_astArguments *new_argument(Context *ctx,
                                              MOJOSHADER_astExpression *arg)
 {
@@ -802,14 +1226,6 @@ static MOJOSHADER_astArguments *new_argument(Context *ctx,
     return retval;
 } // new_argument
 
-static void delete_arguments(Context *ctx, MOJOSHADER_astArguments *args)
-{
-    DELETE_AST_NODE(args);
-    delete_arguments(ctx, args->next);
-    delete_expr(ctx, args->argument);
-    Free(ctx, args);
-} // delete_arguments
-
 static MOJOSHADER_astFunctionParameters *new_function_param(Context *ctx,
                         const MOJOSHADER_astInputModifier inputmod,
                         const MOJOSHADER_astDataType *dt,
@@ -825,19 +1241,11 @@ static MOJOSHADER_astFunctionParameters *new_function_param(Context *ctx,
     retval->semantic = semantic;
     retval->interpolation_modifier = interpmod;
     retval->initializer = initializer;
+    retval->index = 0;  // set during semantic analysis.
     retval->next = NULL;
     return retval;
 } // new_function_param
 
-static void delete_function_params(Context *ctx,
-                                   MOJOSHADER_astFunctionParameters *params)
-{
-    DELETE_AST_NODE(params);
-    delete_function_params(ctx, params->next);
-    delete_expr(ctx, params->initializer);
-    Free(ctx, params);
-} // delete_function_params
-
 static MOJOSHADER_astFunctionSignature *new_function_signature(Context *ctx,
                                     const MOJOSHADER_astDataType *dt,
                                     const char *identifier,
@@ -853,14 +1261,6 @@ static MOJOSHADER_astFunctionSignature *new_function_signature(Context *ctx,
     return retval;
 } // new_function_signature
 
-static void delete_function_signature(Context *ctx,
-                                      MOJOSHADER_astFunctionSignature *sig)
-{
-    DELETE_AST_NODE(sig);
-    delete_function_params(ctx, sig->params);
-    Free(ctx, sig);
-} // delete_function_signature
-
 static MOJOSHADER_astCompilationUnit *new_function(Context *ctx,
                                 MOJOSHADER_astFunctionSignature *declaration,
                                 MOJOSHADER_astStatement *definition)
@@ -874,16 +1274,6 @@ static MOJOSHADER_astCompilationUnit *new_function(Context *ctx,
     return (MOJOSHADER_astCompilationUnit *) retval;
 } // new_function
 
-static void delete_function(Context *ctx,
-                            MOJOSHADER_astCompilationUnitFunction *unitfn)
-{
-    DELETE_AST_NODE(unitfn);
-    delete_compilation_unit(ctx, unitfn->next);
-    delete_function_signature(ctx, unitfn->declaration);
-    delete_statement(ctx, unitfn->definition);
-    Free(ctx, unitfn);
-} // delete_function
-
 static MOJOSHADER_astScalarOrArray *new_scalar_or_array(Context *ctx,
                                           const char *ident, const int isvec,
                                           MOJOSHADER_astExpression *dim)
@@ -896,13 +1286,6 @@ static MOJOSHADER_astScalarOrArray *new_scalar_or_array(Context *ctx,
     return retval;
 } // new_scalar_or_array
 
-static void delete_scalar_or_array(Context *ctx,MOJOSHADER_astScalarOrArray *s)
-{
-    DELETE_AST_NODE(s);
-    delete_expr(ctx, s->dimension);
-    Free(ctx, s);
-} // delete_scalar_or_array
-
 static MOJOSHADER_astTypedef *new_typedef(Context *ctx, const int isconst,
                                           const MOJOSHADER_astDataType *dt,
                                           MOJOSHADER_astScalarOrArray *soa)
@@ -915,13 +1298,6 @@ static MOJOSHADER_astTypedef *new_typedef(Context *ctx, const int isconst,
     return retval;
 } // new_typedef
 
-static void delete_typedef(Context *ctx, MOJOSHADER_astTypedef *td)
-{
-    DELETE_AST_NODE(td);
-    delete_scalar_or_array(ctx, td->details);
-    Free(ctx, td);
-} // delete_typedef
-
 static MOJOSHADER_astPackOffset *new_pack_offset(Context *ctx,
                                                  const char *a, const char *b)
 {
@@ -931,12 +1307,6 @@ static MOJOSHADER_astPackOffset *new_pack_offset(Context *ctx,
     return retval;
 } // new_pack_offset
 
-static void delete_pack_offset(Context *ctx, MOJOSHADER_astPackOffset *o)
-{
-    DELETE_AST_NODE(o);
-    Free(ctx, o);
-} // delete_pack_offset
-
 static MOJOSHADER_astVariableLowLevel *new_variable_lowlevel(Context *ctx,
                                                MOJOSHADER_astPackOffset *po,
                                                const char *reg)
@@ -948,14 +1318,6 @@ static MOJOSHADER_astVariableLowLevel *new_variable_lowlevel(Context *ctx,
     return retval;
 } // new_variable_lowlevel
 
-static void delete_variable_lowlevel(Context *ctx,
-                                     MOJOSHADER_astVariableLowLevel *vll)
-{
-    DELETE_AST_NODE(vll);
-    delete_pack_offset(ctx, vll->packoffset);
-    Free(ctx, vll);
-} // delete_variable_lowlevel
-
 static MOJOSHADER_astAnnotations *new_annotation(Context *ctx,
                                         const MOJOSHADER_astDataType *dt,
                                         MOJOSHADER_astExpression *initializer)
@@ -967,14 +1329,6 @@ static MOJOSHADER_astAnnotations *new_annotation(Context *ctx,
     return retval;
 } // new_annotation
 
-static void delete_annotation(Context *ctx, MOJOSHADER_astAnnotations *annos)
-{
-    DELETE_AST_NODE(annos);
-    delete_annotation(ctx, annos->next);
-    delete_expr(ctx, annos->initializer);
-    Free(ctx, annos);
-} // delete_annotation
-
 static MOJOSHADER_astVariableDeclaration *new_variable_declaration(
                             Context *ctx, MOJOSHADER_astScalarOrArray *soa,
                             const char *semantic,
@@ -992,22 +1346,11 @@ static MOJOSHADER_astVariableDeclaration *new_variable_declaration(
     retval->annotations = annotations;
     retval->initializer = init;
     retval->lowlevel = vll;
+    retval->index = 0;  // set during semantic analysis.
     retval->next = NULL;
     return retval;
 } // new_variable_declaration
 
-static void delete_variable_declaration(Context *ctx,
-                                        MOJOSHADER_astVariableDeclaration *dcl)
-{
-    DELETE_AST_NODE(dcl);
-    delete_variable_declaration(ctx, dcl->next);
-    delete_scalar_or_array(ctx, dcl->details);
-    delete_annotation(ctx, dcl->annotations);
-    delete_expr(ctx, dcl->initializer);
-    delete_variable_lowlevel(ctx, dcl->lowlevel);
-    Free(ctx, dcl);
-} // delete_variable_declaration
-
 static MOJOSHADER_astCompilationUnit *new_global_variable(Context *ctx,
                                       MOJOSHADER_astVariableDeclaration *decl)
 {
@@ -1018,15 +1361,6 @@ static MOJOSHADER_astCompilationUnit *new_global_variable(Context *ctx,
     return (MOJOSHADER_astCompilationUnit *) retval;
 } // new_global_variable
 
-static void delete_global_variable(Context *ctx,
-                                   MOJOSHADER_astCompilationUnitVariable *var)
-{
-    DELETE_AST_NODE(var);
-    delete_compilation_unit(ctx, var->next);
-    delete_variable_declaration(ctx, var->declaration);
-    Free(ctx, var);
-} // delete_global_variable
-
 static MOJOSHADER_astCompilationUnit *new_global_typedef(Context *ctx,
                                                      MOJOSHADER_astTypedef *td)
 {
@@ -1037,15 +1371,6 @@ static MOJOSHADER_astCompilationUnit *new_global_typedef(Context *ctx,
     return (MOJOSHADER_astCompilationUnit *) retval;
 } // new_global_typedef
 
-static void delete_global_typedef(Context *ctx,
-                                  MOJOSHADER_astCompilationUnitTypedef *unit)
-{
-    DELETE_AST_NODE(unit);
-    delete_compilation_unit(ctx, unit->next);
-    delete_typedef(ctx, unit->type_info);
-    Free(ctx, unit);
-} // delete_global_typedef
-
 static MOJOSHADER_astStructMembers *new_struct_member(Context *ctx,
                                             MOJOSHADER_astScalarOrArray *soa,
                                             const char *semantic)
@@ -1060,15 +1385,6 @@ static MOJOSHADER_astStructMembers *new_struct_member(Context *ctx,
     return retval;
 } // new_struct_member
 
-static void delete_struct_member(Context *ctx,
-                                 MOJOSHADER_astStructMembers *member)
-{
-    DELETE_AST_NODE(member);
-    delete_struct_member(ctx, member->next);
-    delete_scalar_or_array(ctx, member->details);
-    Free(ctx, member);
-} // delete_struct_member
-
 static MOJOSHADER_astStructDeclaration *new_struct_declaration(Context *ctx,
                                         const char *name,
                                         MOJOSHADER_astStructMembers *members)
@@ -1081,14 +1397,6 @@ static MOJOSHADER_astStructDeclaration *new_struct_declaration(Context *ctx,
     return retval;
 } // new_struct_declaration
 
-static void delete_struct_declaration(Context *ctx,
-                                      MOJOSHADER_astStructDeclaration *decl)
-{
-    DELETE_AST_NODE(decl);
-    delete_struct_member(ctx, decl->members);
-    Free(ctx, decl);
-} // delete_struct_declaration
-
 static MOJOSHADER_astCompilationUnit *new_global_struct(Context *ctx,
                                            MOJOSHADER_astStructDeclaration *sd)
 {
@@ -1099,53 +1407,6 @@ static MOJOSHADER_astCompilationUnit *new_global_struct(Context *ctx,
     return (MOJOSHADER_astCompilationUnit *) retval;
 } // new_global_struct
 
-static void delete_global_struct(Context *ctx,
-                                 MOJOSHADER_astCompilationUnitStruct *unit)
-{
-    DELETE_AST_NODE(unit);
-    delete_compilation_unit(ctx, unit->next);
-    delete_struct_declaration(ctx, unit->struct_info);
-    Free(ctx, unit);
-} // delete_global_struct
-
-static void delete_compilation_unit(Context *ctx,
-                                    MOJOSHADER_astCompilationUnit *unit)
-{
-    if (!unit) return;
-
-    // it's important to not recurse too deeply here, since you may have
-    //  thousands of items in this linked list (each line of a massive
-    //  function, for example). To avoid this, we iterate the list here,
-    //  deleting all children and making them think they have no reason
-    //  to recurse in their own delete methods.
-    // Please note that everyone should _try_ to delete their "next" member,
-    //  just in case, but hopefully this cleaned it out.
-
-    MOJOSHADER_astCompilationUnit *i = unit->next;
-    unit->next = NULL;
-    while (i)
-    {
-        MOJOSHADER_astCompilationUnit *next = i->next;
-        i->next = NULL;
-        delete_compilation_unit(ctx, i);
-        i = next;
-    } // while
-
-    switch (unit->ast.type)
-    {
-        #define DELETE_UNIT(typ, cls, fn) \
-            case MOJOSHADER_AST_COMPUNIT_##typ: delete_##fn(ctx, (cls *) unit); break;
-        DELETE_UNIT(FUNCTION, MOJOSHADER_astCompilationUnitFunction, function);
-        DELETE_UNIT(TYPEDEF, MOJOSHADER_astCompilationUnitTypedef, global_typedef);
-        DELETE_UNIT(VARIABLE, MOJOSHADER_astCompilationUnitVariable, global_variable);
-        DELETE_UNIT(STRUCT, MOJOSHADER_astCompilationUnitStruct, global_struct);
-        #undef DELETE_UNIT
-        default: assert(0 && "missing cleanup code"); break;
-    } // switch
-
-    // don't free (unit) here, the class-specific functions do it.
-} // delete_compilation_unit
-
 static MOJOSHADER_astStatement *new_typedef_statement(Context *ctx,
                                                       MOJOSHADER_astTypedef *td)
 {
@@ -1156,15 +1417,6 @@ static MOJOSHADER_astStatement *new_typedef_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_typedef_statement
 
-static void delete_typedef_statement(Context *ctx,
-                                     MOJOSHADER_astTypedefStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    delete_typedef(ctx, stmt->type_info);
-    Free(ctx, stmt);
-} // delete_typedef_statement
-
 static MOJOSHADER_astStatement *new_return_statement(Context *ctx,
                                                 MOJOSHADER_astExpression *expr)
 {
@@ -1175,15 +1427,6 @@ static MOJOSHADER_astStatement *new_return_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_return_statement
 
-static void delete_return_statement(Context *ctx,
-                                    MOJOSHADER_astReturnStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    delete_expr(ctx, stmt->expr);
-    Free(ctx, stmt);
-} // delete_return_statement
-
 static MOJOSHADER_astStatement *new_block_statement(Context *ctx,
                                                MOJOSHADER_astStatement *stmts)
 {
@@ -1194,15 +1437,6 @@ static MOJOSHADER_astStatement *new_block_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_block_statement
 
-static void delete_block_statement(Context *ctx,
-                                   MOJOSHADER_astBlockStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->statements);
-    delete_statement(ctx, stmt->next);
-    Free(ctx, stmt);
-} // delete_statement_block
-
 static MOJOSHADER_astStatement *new_for_statement(Context *ctx,
                                     MOJOSHADER_astVariableDeclaration *decl,
                                     MOJOSHADER_astExpression *initializer,
@@ -1222,18 +1456,6 @@ static MOJOSHADER_astStatement *new_for_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_for_statement
 
-static void delete_for_statement(Context *ctx,MOJOSHADER_astForStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    delete_variable_declaration(ctx, stmt->var_decl);
-    delete_expr(ctx, stmt->initializer);
-    delete_expr(ctx, stmt->looptest);
-    delete_expr(ctx, stmt->counter);
-    delete_statement(ctx, stmt->statement);
-    Free(ctx, stmt);
-} // delete_for_statement
-
 static MOJOSHADER_astStatement *new_do_statement(Context *ctx,
                                                 const int unroll,
                                                 MOJOSHADER_astStatement *stmt,
@@ -1247,15 +1469,6 @@ static MOJOSHADER_astStatement *new_do_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_do_statement
 
-static void delete_do_statement(Context *ctx, MOJOSHADER_astDoStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    delete_statement(ctx, stmt->statement);
-    delete_expr(ctx, stmt->expr);
-    Free(ctx, stmt);
-} // delete_do_statement
-
 static MOJOSHADER_astStatement *new_while_statement(Context *ctx,
                                                 const int unroll,
                                                 MOJOSHADER_astExpression *expr,
@@ -1270,16 +1483,6 @@ static MOJOSHADER_astStatement *new_while_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_while_statement
 
-static void delete_while_statement(Context *ctx,
-                                   MOJOSHADER_astWhileStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    delete_statement(ctx, stmt->statement);
-    delete_expr(ctx, stmt->expr);
-    Free(ctx, stmt);
-} // delete_while_statement
-
 static MOJOSHADER_astStatement *new_if_statement(Context *ctx,
                                             const int attr,
                                             MOJOSHADER_astExpression *expr,
@@ -1295,16 +1498,6 @@ static MOJOSHADER_astStatement *new_if_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_if_statement
 
-static void delete_if_statement(Context *ctx, MOJOSHADER_astIfStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    delete_expr(ctx, stmt->expr);
-    delete_statement(ctx, stmt->statement);
-    delete_statement(ctx, stmt->else_statement);
-    Free(ctx, stmt);
-} // delete_if_statement
-
 static MOJOSHADER_astSwitchCases *new_switch_case(Context *ctx,
                                                 MOJOSHADER_astExpression *expr,
                                                 MOJOSHADER_astStatement *stmt)
@@ -1316,15 +1509,6 @@ static MOJOSHADER_astSwitchCases *new_switch_case(Context *ctx,
     return retval;
 } // new_switch_case
 
-static void delete_switch_case(Context *ctx, MOJOSHADER_astSwitchCases *sc)
-{
-    DELETE_AST_NODE(sc);
-    delete_switch_case(ctx, sc->next);
-    delete_expr(ctx, sc->expr);
-    delete_statement(ctx, sc->statement);
-    Free(ctx, sc);
-} // delete_switch_case
-
 static MOJOSHADER_astStatement *new_empty_statement(Context *ctx)
 {
     NEW_AST_NODE(retval, MOJOSHADER_astEmptyStatement,
@@ -1333,14 +1517,6 @@ static MOJOSHADER_astStatement *new_empty_statement(Context *ctx)
     return (MOJOSHADER_astStatement *) retval;
 } // new_empty_statement
 
-static void delete_empty_statement(Context *ctx,
-                                   MOJOSHADER_astEmptyStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    Free(ctx, stmt);
-} // delete_empty_statement
-
 static MOJOSHADER_astStatement *new_break_statement(Context *ctx)
 {
     NEW_AST_NODE(retval, MOJOSHADER_astBreakStatement,
@@ -1349,14 +1525,6 @@ static MOJOSHADER_astStatement *new_break_statement(Context *ctx)
     return (MOJOSHADER_astStatement *) retval;
 } // new_break_statement
 
-static void delete_break_statement(Context *ctx,
-                                   MOJOSHADER_astBreakStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    Free(ctx, stmt);
-} // delete_break_statement
-
 static MOJOSHADER_astStatement *new_continue_statement(Context *ctx)
 {
     NEW_AST_NODE(retval, MOJOSHADER_astContinueStatement,
@@ -1365,14 +1533,6 @@ static MOJOSHADER_astStatement *new_continue_statement(Context *ctx)
     return (MOJOSHADER_astStatement *) retval;
 } // new_continue_statement
 
-static void delete_continue_statement(Context *ctx,
-                                      MOJOSHADER_astContinueStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    Free(ctx, stmt);
-} // delete_continue_statement
-
 static MOJOSHADER_astStatement *new_discard_statement(Context *ctx)
 {
     NEW_AST_NODE(retval, MOJOSHADER_astDiscardStatement,
@@ -1381,14 +1541,6 @@ static MOJOSHADER_astStatement *new_discard_statement(Context *ctx)
     return (MOJOSHADER_astStatement *) retval;
 } // new_discard_statement
 
-static void delete_discard_statement(Context *ctx,
-                                     MOJOSHADER_astDiscardStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    Free(ctx, stmt);
-} // delete_discard_statement
-
 static MOJOSHADER_astStatement *new_expr_statement(Context *ctx,
                                                 MOJOSHADER_astExpression *expr)
 {
@@ -1399,15 +1551,6 @@ static MOJOSHADER_astStatement *new_expr_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_expr_statement
 
-static void delete_expr_statement(Context *ctx,
-                                  MOJOSHADER_astExpressionStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    delete_expr(ctx, stmt->expr);
-    Free(ctx, stmt);
-} // delete_expr_statement
-
 static MOJOSHADER_astStatement *new_switch_statement(Context *ctx,
                                             const int attr,
                                             MOJOSHADER_astExpression *expr,
@@ -1422,15 +1565,6 @@ static MOJOSHADER_astStatement *new_switch_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_switch_statement
 
-static void delete_switch_statement(Context *ctx,
-                                    MOJOSHADER_astSwitchStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_expr(ctx, stmt->expr);
-    delete_switch_case(ctx, stmt->cases);
-    Free(ctx, stmt);
-} // delete_switch_statement
-
 static MOJOSHADER_astStatement *new_struct_statement(Context *ctx,
                                         MOJOSHADER_astStructDeclaration *sd)
 {
@@ -1441,15 +1575,6 @@ static MOJOSHADER_astStatement *new_struct_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_struct_statement
 
-static void delete_struct_statement(Context *ctx,
-                                    MOJOSHADER_astStructStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    delete_struct_declaration(ctx, stmt->struct_info);
-    Free(ctx, stmt);
-} // delete_struct_statement
-
 static MOJOSHADER_astStatement *new_vardecl_statement(Context *ctx,
                                         MOJOSHADER_astVariableDeclaration *vd)
 {
@@ -1460,71 +1585,13 @@ static MOJOSHADER_astStatement *new_vardecl_statement(Context *ctx,
     return (MOJOSHADER_astStatement *) retval;
 } // new_vardecl_statement
 
-static void delete_vardecl_statement(Context *ctx,
-                                     MOJOSHADER_astVarDeclStatement *stmt)
-{
-    DELETE_AST_NODE(stmt);
-    delete_statement(ctx, stmt->next);
-    delete_variable_declaration(ctx, stmt->declaration);
-    Free(ctx, stmt);
-} // delete_vardecl_statement
-
-static void delete_statement(Context *ctx, MOJOSHADER_astStatement *stmt)
-{
-    if (!stmt) return;
-
-    // it's important to not recurse too deeply here, since you may have
-    //  thousands of items in this linked list (each line of a massive
-    //  function, for example). To avoid this, we iterate the list here,
-    //  deleting all children and making them think they have no reason
-    //  to recurse in their own delete methods.
-    // Please note that everyone should _try_ to delete their "next" member,
-    //  just in case, but hopefully this cleaned it out.
-
-    MOJOSHADER_astStatement *i = stmt->next;
-    stmt->next = NULL;
-    while (i)
-    {
-        MOJOSHADER_astStatement *next = i->next;
-        i->next = NULL;
-        delete_statement(ctx, i);
-        i = next;
-    } // while
-
-    switch (stmt->ast.type)
-    {
-        #define DELETE_STATEMENT(typ, cls, fn) \
-            case MOJOSHADER_AST_STATEMENT_##typ: \
-                delete_##fn##_statement(ctx, (cls *) stmt); break;
-        DELETE_STATEMENT(BLOCK, MOJOSHADER_astBlockStatement, block);
-        DELETE_STATEMENT(EMPTY, MOJOSHADER_astEmptyStatement, empty);
-        DELETE_STATEMENT(IF, MOJOSHADER_astIfStatement, if);
-        DELETE_STATEMENT(SWITCH, MOJOSHADER_astSwitchStatement, switch);
-        DELETE_STATEMENT(EXPRESSION, MOJOSHADER_astExpressionStatement, expr);
-        DELETE_STATEMENT(FOR, MOJOSHADER_astForStatement, for);
-        DELETE_STATEMENT(DO, MOJOSHADER_astDoStatement, do);
-        DELETE_STATEMENT(WHILE, MOJOSHADER_astWhileStatement, while);
-        DELETE_STATEMENT(RETURN, MOJOSHADER_astReturnStatement, return);
-        DELETE_STATEMENT(BREAK, MOJOSHADER_astBreakStatement, break);
-        DELETE_STATEMENT(CONTINUE, MOJOSHADER_astContinueStatement, continue);
-        DELETE_STATEMENT(DISCARD, MOJOSHADER_astDiscardStatement, discard);
-        DELETE_STATEMENT(TYPEDEF, MOJOSHADER_astTypedefStatement, typedef);
-        DELETE_STATEMENT(STRUCT, MOJOSHADER_astStructStatement, struct);
-        DELETE_STATEMENT(VARDECL, MOJOSHADER_astVarDeclStatement, vardecl);
-        #undef DELETE_STATEMENT
-        default: assert(0 && "missing cleanup code"); break;
-    } // switch
-    // don't free (stmt) here, the class-specific functions do it.
-} // delete_statement
-
 
 static const MOJOSHADER_astDataType *get_usertype(const Context *ctx,
                                                   const char *token)
 {
-    const void *value;  // search all scopes.
-    if (!hash_find(ctx->usertypes.hash, token, &value))
-        return NULL;
-    return value ? ((SymbolScope *) value)->datatype : NULL;
+    int shared = 0;  // search all scopes, then the builtins.
+    const SymbolScope *item = lookup_symbol(ctx, &ctx->usertypes, token, &shared);
+    return item ? item->datatype : NULL;
 } // get_usertype
 
 
@@ -1568,6 +1635,171 @@ typedef struct AstCalcData
     } value;
 } AstCalcData;
 
+// Applies binary operator (op) to two constants, leaving the result in
+//  (data). Returns 0 if the result isn't a constant. The IR optimizer folds
+//  with this too, so both stages agree on what an expression is worth.
+static int calc_const_binary(Context *ctx, const MOJOSHADER_astNodeType op,
+                             AstCalcData *data, AstCalcData *subdata2)
+{
+    // upgrade to float if either operand is float.
+    if ((data->isflt) || (subdata2->isflt))
+    {
+        if (!data->isflt) data->value.f = (double) data->value.i;
+        if (!subdata2->isflt) subdata2->value.f = (double) subdata2->value.i;
+        data->isflt = subdata2->isflt = 1;
+    } // if
+
+    switch (op)
+    {
+        // gcc doesn't handle commas here, either (fails to parse!).
+        case MOJOSHADER_AST_OP_COMMA:
+        case MOJOSHADER_AST_OP_ASSIGN:
+        case MOJOSHADER_AST_OP_MULASSIGN:
+        case MOJOSHADER_AST_OP_DIVASSIGN:
+        case MOJOSHADER_AST_OP_MODASSIGN:
+        case MOJOSHADER_AST_OP_ADDASSIGN:
+        case MOJOSHADER_AST_OP_SUBASSIGN:
+        case MOJOSHADER_AST_OP_LSHIFTASSIGN:
+        case MOJOSHADER_AST_OP_RSHIFTASSIGN:
+        case MOJOSHADER_AST_OP_ANDASSIGN:
+        case MOJOSHADER_AST_OP_XORASSIGN:
+        case MOJOSHADER_AST_OP_ORASSIGN:
+            return 0;  // assignment is non-constant.
+        default: break;
+    } // switch
+
+    if (data->isflt)
+    {
+        switch (op)
+        {
+            case MOJOSHADER_AST_OP_MULTIPLY:
+                data->value.f *= subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_DIVIDE:
+                data->value.f /= subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_ADD:
+                data->value.f += subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_SUBTRACT:
+                data->value.f -= subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_LESSTHAN:
+                data->isflt = 0;
+                data->value.i = data->value.f < subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_GREATERTHAN:
+                data->isflt = 0;
+                data->value.i = data->value.f > subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_LESSTHANOREQUAL:
+                data->isflt = 0;
+                data->value.i = data->value.f <= subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_GREATERTHANOREQUAL:
+                data->isflt = 0;
+                data->value.i = data->value.f >= subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_EQUAL:
+                data->isflt = 0;
+                data->value.i = data->value.f == subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_NOTEQUAL:
+                data->isflt = 0;
+                data->value.i = data->value.f != subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_LOGICALAND:
+                data->isflt = 0;
+                data->value.i = data->value.f && subdata2->value.f;
+                return 1;
+            case MOJOSHADER_AST_OP_LOGICALOR:
+                data->isflt = 0;
+                data->value.i = data->value.f || subdata2->value.f;
+                return 1;
+
+            case MOJOSHADER_AST_OP_LSHIFT:
+            case MOJOSHADER_AST_OP_RSHIFT:
+            case MOJOSHADER_AST_OP_MODULO:
+            case MOJOSHADER_AST_OP_BINARYAND:
+            case MOJOSHADER_AST_OP_BINARYXOR:
+            case MOJOSHADER_AST_OP_BINARYOR:
+                fail(ctx, "integer operation on floating point value");
+                return 0;
+            default: break;
+        } // switch
+    } // if
+
+    else   // integer version.
+    {
+        // leave a division by zero for runtime instead of crashing on it.
+        if ( ((op == MOJOSHADER_AST_OP_DIVIDE) ||
+              (op == MOJOSHADER_AST_OP_MODULO)) && (subdata2->value.i == 0) )
+            return 0;
+
+        switch (op)
+        {
+            case MOJOSHADER_AST_OP_MULTIPLY:
+                data->value.i *= subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_DIVIDE:
+                data->value.i /= subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_ADD:
+                data->value.i += subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_SUBTRACT:
+                data->value.i -= subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_LESSTHAN:
+                data->value.i = data->value.i < subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_GREATERTHAN:
+                data->value.i = data->value.i > subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_LESSTHANOREQUAL:
+                data->value.i = data->value.i <= subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_GREATERTHANOREQUAL:
+                data->value.i = data->value.i >= subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_EQUAL:
+                data->value.i = data->value.i == subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_NOTEQUAL:
+                data->value.i = data->value.i != subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_LOGICALAND:
+                data->value.i = data->value.i && subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_LOGICALOR:
+                data->value.i = data->value.i || subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_LSHIFT:
+                data->value.i = data->value.i << subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_RSHIFT:
+                data->value.i = data->value.i >> subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_MODULO:
+                data->value.i = data->value.i % subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_BINARYAND:
+                data->value.i = data->value.i & subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_BINARYXOR:
+                data->value.i = data->value.i ^ subdata2->value.i;
+                return 1;
+            case MOJOSHADER_AST_OP_BINARYOR:
+                data->value.i = data->value.i | subdata2->value.i;
+                return 1;
+            default: break;
+        } // switch
+    } // else
+
+    assert(0 && "unhandled operation?");
+    return 0;
+} // calc_const_binary
+
 // returns 0 if this expression is non-constant, 1 if it is.
 //  calculation results land in (data).
 static int calc_ast_const_expr(Context *ctx, void *_expr, AstCalcData *data)
@@ -1635,158 +1867,7 @@ static int calc_ast_const_expr(Context *ctx, void *_expr, AstCalcData *data)
              (!calc_ast_const_expr(ctx, expr->binary.right, &subdata2)) )
             return 0;
 
-        // upgrade to float if either operand is float.
-        if ((data->isflt) || (subdata2.isflt))
-        {
-            if (!data->isflt) data->value.f = (double) data->value.i;
-            if (!subdata2.isflt) subdata2.value.f = (double) subdata2.value.i;
-            data->isflt = subdata2.isflt = 1;
-        } // if
-
-        switch (op)
-        {
-            // gcc doesn't handle commas here, either (fails to parse!).
-            case MOJOSHADER_AST_OP_COMMA:
-            case MOJOSHADER_AST_OP_ASSIGN:
-            case MOJOSHADER_AST_OP_MULASSIGN:
-            case MOJOSHADER_AST_OP_DIVASSIGN:
-            case MOJOSHADER_AST_OP_MODASSIGN:
-            case MOJOSHADER_AST_OP_ADDASSIGN:
-            case MOJOSHADER_AST_OP_SUBASSIGN:
-            case MOJOSHADER_AST_OP_LSHIFTASSIGN:
-            case MOJOSHADER_AST_OP_RSHIFTASSIGN:
-            case MOJOSHADER_AST_OP_ANDASSIGN:
-            case MOJOSHADER_AST_OP_XORASSIGN:
-            case MOJOSHADER_AST_OP_ORASSIGN:
-                return 0;  // assignment is non-constant.
-            default: break;
-        } // switch
-
-        if (data->isflt)
-        {
-            switch (op)
-            {
-                case MOJOSHADER_AST_OP_MULTIPLY:
-                    data->value.f *= subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_DIVIDE:
-                    data->value.f /= subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_ADD:
-                    data->value.f += subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_SUBTRACT:
-                    data->value.f -= subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_LESSTHAN:
-                    data->isflt = 0;
-                    data->value.i = data->value.f < subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_GREATERTHAN:
-                    data->isflt = 0;
-                    data->value.i = data->value.f > subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_LESSTHANOREQUAL:
-                    data->isflt = 0;
-                    data->value.i = data->value.f <= subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_GREATERTHANOREQUAL:
-                    data->isflt = 0;
-                    data->value.i = data->value.f >= subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_EQUAL:
-                    data->isflt = 0;
-                    data->value.i = data->value.f == subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_NOTEQUAL:
-                    data->isflt = 0;
-                    data->value.i = data->value.f != subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_LOGICALAND:
-                    data->isflt = 0;
-                    data->value.i = data->value.f && subdata2.value.f;
-                    return 1;
-                case MOJOSHADER_AST_OP_LOGICALOR:
-                    data->isflt = 0;
-                    data->value.i = data->value.f || subdata2.value.f;
-                    return 1;
-
-                case MOJOSHADER_AST_OP_LSHIFT:
-                case MOJOSHADER_AST_OP_RSHIFT:
-                case MOJOSHADER_AST_OP_MODULO:
-                case MOJOSHADER_AST_OP_BINARYAND:
-                case MOJOSHADER_AST_OP_BINARYXOR:
-                case MOJOSHADER_AST_OP_BINARYOR:
-                    fail(ctx, "integer operation on floating point value");
-                    return 0;
-                default: break;
-            } // switch
-        } // if
-
-        else   // integer version.
-        {
-            switch (op)
-            {
-                case MOJOSHADER_AST_OP_MULTIPLY:
-                    data->value.i *= subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_DIVIDE:
-                    data->value.i /= subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_ADD:
-                    data->value.i += subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_SUBTRACT:
-                    data->value.i -= subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_LESSTHAN:
-                    data->value.i = data->value.i < subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_GREATERTHAN:
-                    data->value.i = data->value.i > subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_LESSTHANOREQUAL:
-                    data->value.i = data->value.i <= subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_GREATERTHANOREQUAL:
-                    data->value.i = data->value.i >= subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_EQUAL:
-                    data->value.i = data->value.i == subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_NOTEQUAL:
-                    data->value.i = data->value.i != subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_LOGICALAND:
-                    data->value.i = data->value.i && subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_LOGICALOR:
-                    data->value.i = data->value.i || subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_LSHIFT:
-                    data->value.i = data->value.i << subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_RSHIFT:
-                    data->value.i = data->value.i >> subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_MODULO:
-                    data->value.i = data->value.i % subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_BINARYAND:
-                    data->value.i = data->value.i & subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_BINARYXOR:
-                    data->value.i = data->value.i ^ subdata2.value.i;
-                    return 1;
-                case MOJOSHADER_AST_OP_BINARYOR:
-                    data->value.i = data->value.i | subdata2.value.i;
-                    return 1;
-                default: break;
-            } // switch
-        } // else
-
-        assert(0 && "unhandled operation?");
-        return 0;
+        return calc_const_binary(ctx, op, data, &subdata2);
     } // else if
 
     else if (operator_is_ternary(op))
@@ -1888,40 +1969,15 @@ static const MOJOSHADER_astDataType *build_function_datatype(Context *ctx,
                                         const MOJOSHADER_astDataType **params,
                                         const int intrinsic)
 {
-    const MOJOSHADER_astDataType **dtparams = NULL;
-    void *ptr;
-
-    if (paramcount > 0)
-    {
-        // !!! FIXME: this is hacky.
-        ptr = Malloc(ctx, sizeof (*params) * paramcount);
-        if (ptr == NULL)
-            return NULL;
-        if (!buffer_append(ctx->garbage, &ptr, sizeof (ptr)))
-        {
-            Free(ctx, ptr);
-            return NULL;
-        } // if
-        dtparams = (const MOJOSHADER_astDataType **) ptr;
-        memcpy(dtparams, params, sizeof (*params) * paramcount);
-    }
-
-    ptr = Malloc(ctx, sizeof (MOJOSHADER_astDataType));
-    if (ptr == NULL)
-        return NULL;
-    if (!buffer_append(ctx->garbage, &ptr, sizeof (ptr)))
-    {
-        Free(ctx, ptr);
-        return NULL;
-    } // if
-
-    MOJOSHADER_astDataType *dt = (MOJOSHADER_astDataType *) ptr;
-    dt->type = MOJOSHADER_AST_DATATYPE_FUNCTION;
-    dt->function.retval = rettype;
-    dt->function.params = dtparams;
-    dt->function.num_params = paramcount;
-    dt->function.intrinsic = intrinsic;
-    return dt;
+    // intern_datatype() copies (params) if this is a new type.
+    MOJOSHADER_astDataType fn;
+    memset(&fn, '\0', sizeof (fn));
+    fn.type = MOJOSHADER_AST_DATATYPE_FUNCTION;
+    fn.function.retval = rettype;
+    fn.function.params = (paramcount > 0) ? params : NULL;
+    fn.function.num_params = paramcount;
+    fn.function.intrinsic = intrinsic;
+    return intern_datatype(ctx, &fn);
 } // build_function_datatype
 
 
@@ -1930,7 +1986,7 @@ static const MOJOSHADER_astDataType *build_datatype(Context *ctx,
                                             const MOJOSHADER_astDataType *dt,
                                             MOJOSHADER_astScalarOrArray *soa)
 {
-    MOJOSHADER_astDataType *retval = NULL;
+    MOJOSHADER_astDataType newdt;
 
     assert( (soa->isarray && soa->dimension) ||
             (!soa->isarray && !soa->dimension) );
@@ -1944,43 +2000,30 @@ static const MOJOSHADER_astDataType *build_datatype(Context *ctx,
         const int c2 = (isconst != 0);
         if (c1 == c2)
             return dt;  // reuse existing datatype!
-    } // if
-
-    retval = (MOJOSHADER_astDataType *) Malloc(ctx, sizeof (*retval));
-    if (retval == NULL)
-        return NULL;
-
-    // !!! FIXME: this is hacky.
-    if (!buffer_append(ctx->garbage, &retval, sizeof (retval)))
-    {
-        Free(ctx, retval);
-        return NULL;
-    } // if
 
-    if (!soa->isarray)
-    {
         assert(soa->dimension == NULL);
-        memcpy(retval, dt, sizeof (MOJOSHADER_astDataType));
+        memcpy(&newdt, dt, sizeof (MOJOSHADER_astDataType));
         if (isconst)
-            retval->type |= MOJOSHADER_AST_DATATYPE_CONST;
+            newdt.type |= MOJOSHADER_AST_DATATYPE_CONST;
         else
-            retval->type &= ~MOJOSHADER_AST_DATATYPE_CONST;
-        return retval;
+            newdt.type &= ~MOJOSHADER_AST_DATATYPE_CONST;
+        return intern_datatype(ctx, &newdt);
     } // if
 
-    retval->type = MOJOSHADER_AST_DATATYPE_ARRAY;
-    retval->array.base = dt;
+    memset(&newdt, '\0', sizeof (newdt));
+    newdt.type = MOJOSHADER_AST_DATATYPE_ARRAY;
+    newdt.array.base = dt;
     if (soa->dimension == NULL)
     {
-        retval->array.elements = -1;
-        return retval;
+        newdt.array.elements = -1;
+        return intern_datatype(ctx, &newdt);
     } // if
 
     // Run the expression to verify it's constant and produces a positive int.
     AstCalcData data;
     data.isflt = 0;
     data.value.i = 0;
-    retval->array.elements = 16;  // sane default for failure.
+    newdt.array.elements = 16;  // sane default for failure.
     const int ok = calc_ast_const_expr(ctx, soa->dimension, &data);
 
     // reset error position.
@@ -1994,9 +2037,9 @@ static const MOJOSHADER_astDataType *build_datatype(Context *ctx,
     else if (data.value.i < 0)
         fail(ctx, "array dimensions negative");
     else
-        retval->array.elements = data.value.i;
+        newdt.array.elements = data.value.i;
 
-    return retval;
+    return intern_datatype(ctx, &newdt);
 } // build_datatype
 
 
@@ -2029,6 +2072,11 @@ static void require_integer_datatype(Context *ctx,
                                      const MOJOSHADER_astDataType *datatype)
 {
     datatype = reduce_datatype(ctx, datatype);
+    if (datatype->type == MOJOSHADER_AST_DATATYPE_VECTOR)
+        datatype = reduce_datatype(ctx, datatype->vector.base);
+    else if (datatype->type == MOJOSHADER_AST_DATATYPE_MATRIX)
+        datatype = reduce_datatype(ctx, datatype->matrix.base);
+
     switch (datatype->type)
     {
         case MOJOSHADER_AST_DATATYPE_INT:
@@ -2050,7 +2098,10 @@ static void require_boolean_datatype(Context *ctx,
         case MOJOSHADER_AST_DATATYPE_BOOL:
         case MOJOSHADER_AST_DATATYPE_INT:
         case MOJOSHADER_AST_DATATYPE_UINT:
-            return;
+        case MOJOSHADER_AST_DATATYPE_HALF:
+        case MOJOSHADER_AST_DATATYPE_FLOAT:
+        case MOJOSHADER_AST_DATATYPE_DOUBLE:
+            return;  // add_bool_coercion() makes these (x != 0).
         default: break;
     } // switch
 
@@ -2230,13 +2281,24 @@ static const MOJOSHADER_astDataType *add_type_coercion(Context *ctx,
     assert(choice == CHOOSE_NEITHER);
     fail(ctx, "incompatible data types");
     // Ditch original (*right), force a literal value that matches
-    //  ldatatype, so further processing is normalized.
+    //  ldatatype, so further processing is normalized. The old node just
+    //  sits in the arena until the context goes away.
     // !!! FIXME: force (right) to match (left).
-    delete_expr(ctx, *right);
     *right = new_cast_expr(ctx, _ldatatype, new_literal_int_expr(ctx, 0));
     return ldatatype;
 } // add_type_coercion
 
+// Tests work on any scalar, like C: "if (flags & 2)" means
+//  "if ((flags & 2) != 0)", so cast anything else to bool.
+static void add_bool_coercion(Context *ctx, MOJOSHADER_astExpression **expr,
+                              const MOJOSHADER_astDataType *datatype)
+{
+    if ((*expr == NULL) || (datatype == NULL))
+        return;
+    else if (reduce_datatype(ctx, datatype)->type != MOJOSHADER_AST_DATATYPE_BOOL)
+        add_type_coercion(ctx, NULL, &dt_bool, expr, datatype);
+} // add_bool_coercion
+
 static int is_swizzle_str(const char *str, const int veclen)
 {
     int i;
@@ -2341,7 +2403,7 @@ static const MOJOSHADER_astDataType *datatype_base(Context *ctx, const MOJOSHADE
             dt = dt->buffer.base;
             break;
         case MOJOSHADER_AST_DATATYPE_ARRAY:
-            dt = dt->array.base;
+            dt = reduce_datatype(ctx, dt->array.base);  // might be a typedef.
             break;
         default: break;
     } // switch
@@ -2444,16 +2506,113 @@ static DatatypeMatch compatible_arg_datatype(Context *ctx,
 
 static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast);
 
-// !!! FIXME: this function sucks.
-static const MOJOSHADER_astDataType *match_func_to_call(Context *ctx,
-                                    MOJOSHADER_astExpressionCallFunction *ast)
+// Scores an overload against a call's argument datatypes, as described in
+//  compatible_arg_datatype(). Zero means it can't be called with these.
+static int score_overload(Context *ctx, const MOJOSHADER_astDataType *dt,
+                          const MOJOSHADER_astDataType **argtypes)
+{
+    const int argcount = dt->function.num_params;
+    const MOJOSHADER_astDataType **params = dt->function.params;
+    int score = 0;
+    int i;
+
+    for (i = 0; i < argcount; i++)
+    {
+        const DatatypeMatch compatible = compatible_arg_datatype(ctx, argtypes[i], params[i]);
+        if (compatible == DT_MATCH_INCOMPATIBLE)
+            return 0;
+        score += (int) compatible;
+    } // for
+
+    return score;
+} // score_overload
+
+static uint32 hash_hash_call(const void *key, void *data)
+{
+    const CallResolution *call = (const CallResolution *) key;
+    uint32 hash = mix_datatype_hash(5381, (size_t) call->overloads[0]);
+    hash = mix_datatype_hash(hash, (size_t) call->overloads[1]);
+    int i;
+    for (i = 0; i < call->argcount; i++)
+        hash = mix_datatype_hash(hash, (size_t) call->argtypes[i]);
+    return stir_datatype_hash(hash);
+} // hash_hash_call
+
+static int hash_keymatch_call(const void *_a, const void *_b, void *data)
 {
-    SymbolScope *best = NULL;  // best choice we find.
+    const CallResolution *a = (const CallResolution *) _a;
+    const CallResolution *b = (const CallResolution *) _b;
+    return ( (a->overloads[0] == b->overloads[0]) &&
+             (a->overloads[1] == b->overloads[1]) &&
+             (a->argcount == b->argcount) &&
+             (memcmp(a->argtypes, b->argtypes,
+                     sizeof (*a->argtypes) * a->argcount) == 0) );
+} // hash_keymatch_call
+
+static void call_nuke(const void *k, const void *v, void *d) {/*no-op*/}
+
+static void resolve_call(Context *ctx, CallResolution *call)
+{
+    const size_t siglen = sizeof (*call->argtypes) * call->argcount;
+    const FunctionOverload *fo;
     int best_score = 0;
+    int i;
+
+    call->best = NULL;
+    call->match = 0;
+
+    // A perfect match of every argument wins outright, and the first one
+    //  we see takes it, so try that first: it's just a pointer compare.
+    for (i = 0; i < STATICARRAYLEN(call->overloads); i++)
+    {
+        for (fo = call->overloads[i]; fo != NULL; fo = fo->next)
+        {
+            const MOJOSHADER_astDataType **params = fo->datatype->function.params;
+            if ((siglen == 0) || (memcmp(params, call->argtypes, siglen) == 0))
+            {
+                call->match = 1;  // ignore all other compatible matches.
+                call->best = fo;
+                return;
+            } // if
+        } // for
+    } // for
+
+    // No such luck, score everything that might take these with promotion.
+    for (i = 0; i < STATICARRAYLEN(call->overloads); i++)
+    {
+        for (fo = call->overloads[i]; fo != NULL; fo = fo->next)
+        {
+            const int score = score_overload(ctx, fo->datatype, call->argtypes);
+            if (score == 0)  // incompatible.
+                continue;
+
+            else if (score == best_score)  // compatible, but not perfect.
+            {
+                call->match++;
+                // !!! FIXME: list each possible function in a fail(),
+                // !!! FIXME:  but you can't actually fail() here, since
+                // !!! FIXME:  this may cease to be ambiguous if we get
+                // !!! FIXME:  a better match on a later overload.
+            } // else if
+
+            else if (score > best_score)
+            {
+                call->match = 1;  // reset the ambiguousness count.
+                call->best = fo;
+                best_score = score;
+            } // else if
+        } // for
+    } // for
+} // resolve_call
+
+static const MOJOSHADER_astDataType *match_func_to_call(Context *ctx,
+                                    MOJOSHADER_astExpressionCallFunction *ast)
+{
     MOJOSHADER_astExpressionIdentifier *ident = ast->identifier;
     const char *sym = ident->identifier;
     const void *value = NULL;
-    void *iter = NULL;
+    int shared = 0;
+    int i;
 
     int argcount = 0;
     MOJOSHADER_astArguments *args = ast->args;
@@ -2464,92 +2623,83 @@ static const MOJOSHADER_astDataType *match_func_to_call(Context *ctx,
         args = args->next;
     } // while;
 
-    // we do some tapdancing to handle function overloading here.
-    int match = 0;
-    while (hash_iter(ctx->variables.hash, sym, &value, &iter))
+    // there's a locally-scoped symbol with this name? It takes precedence.
+    const SymbolScope *item = lookup_symbol(ctx, &ctx->variables, sym, &shared);
+    if (item != NULL)
     {
-        SymbolScope *item = (SymbolScope *) value;
-        const MOJOSHADER_astDataType *dt = item->datatype;
-        dt = reduce_datatype(ctx, dt);
-        // there's a locally-scoped symbol with this name? It takes precedence.
+        const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, item->datatype);
         if (dt->type != MOJOSHADER_AST_DATATYPE_FUNCTION)
             return dt;
+    } // if
 
-        const MOJOSHADER_astDataTypeFunction *dtfn = (MOJOSHADER_astDataTypeFunction *) dt;
-        const int perfect = argcount * ((int) DT_MATCH_PERFECT);
-        int score = 0;
-
-        if (argcount == dtfn->num_params)  // !!! FIXME: default args.
-        {
-            args = ast->args;
-            int i;
-            for (i = 0; i < argcount; i++)
-            {
-                assert(args != NULL);
-                dt = args->argument->datatype;
-                args = args->next;
-                const DatatypeMatch compatible = compatible_arg_datatype(ctx, dt, dtfn->params[i]);
-                if (compatible == DT_MATCH_INCOMPATIBLE)
-                {
-                    args = NULL;
-                    score = 0;
-                    break;
-                } // if
-
-                score += (int) compatible;
-            } // for
+    // Only overloads that take exactly this many arguments can match.
+    //  Ours shadow the intrinsics, so they go first.
+    // !!! FIXME: default args.
+    CallResolution key;
+    //  Analysis workers skip overloads that came after the function they're
+    //  checking; the list is newest first, so that's just moving the head.
+    const FunctionOverloads *fos = find_overloads(ctx->functions, sym, argcount);
+    key.overloads[0] = (fos != NULL) ? fos->overloads : NULL;
+    while ((key.overloads[0] != NULL) && (key.overloads[0]->serial > ctx->visible_serial))
+        key.overloads[0] = key.overloads[0]->next;
+    fos = NULL;
+    if (builtin_ctx != NULL)
+        fos = find_overloads(builtin_ctx->functions, sym, argcount);
+    key.overloads[1] = (fos != NULL) ? fos->overloads : NULL;
+    key.argcount = argcount;
+
+    // Gather the argument datatypes once; they're interned, so this is
+    //  also the call's signature to compare against each overload's params.
+    const MOJOSHADER_astDataType *stackargtypes[16];
+    const size_t siglen = sizeof (*key.argtypes) * argcount;
+    key.argtypes = stackargtypes;
+    if (argcount > STATICARRAYLEN(stackargtypes))
+    {
+        key.argtypes = (const MOJOSHADER_astDataType **) ArenaMalloc(ctx, siglen);
+        if (key.argtypes == NULL)
+            return NULL;
+    } // if
 
-            if (args != NULL)
-                score = 0;  // too many arguments supplied. No match.
-        } // else
+    for (i = 0, args = ast->args; i < argcount; i++, args = args->next)
+        key.argtypes[i] = args->argument->datatype;
 
-        if (score == 0)  // incompatible.
-            continue;
+    const CallResolution *call = &key;
+    if (hash_find(ctx->calls, &key, &value))
+        call = (const CallResolution *) value;
+    else
+    {
+        resolve_call(ctx, &key);
 
-        else if (score == perfect)  // perfection! stop looking!
+        // remember this for the next call that looks just like it.
+        CallResolution *cached;
+        cached = (CallResolution *) ArenaMalloc(ctx, sizeof (*cached));
+        void *argtypes = ArenaMalloc(ctx, siglen);
+        if ((cached != NULL) && (argtypes != NULL))
         {
-            match = 1;  // ignore all other compatible matches.
-            best = item;
-            break;
+            memcpy(cached, &key, sizeof (*cached));
+            memcpy(argtypes, key.argtypes, siglen);
+            cached->argtypes = (const MOJOSHADER_astDataType **) argtypes;
+            if (hash_insert(ctx->calls, cached, cached) != 1)
+                out_of_memory(ctx);
         } // if
+    } // else
 
-        else if (score >= best_score)  // compatible, but not perfect, match.
-        {
-            if (score == best_score)
-            {
-                match++;
-                // !!! FIXME: list each possible function in a fail(),
-                // !!! FIXME:  but you can't actually fail() here, since
-                // !!! FIXME:  this may cease to be ambiguous if we get
-                // !!! FIXME:  a better match on a later overload.
-            } // if
-
-            else if (score > best_score)
-            {
-                match = 1;  // reset the ambiguousness count.
-                best = item;
-                best_score = score;
-            } // if
-        } // else if
-    } // while
-
-    if (match > 1)
+    if (call->match > 1)
     {
-        assert(best != NULL);
+        assert(call->best != NULL);
         failf(ctx, "Ambiguous function call to '%s'", sym);
     } // if
 
-    if (best == NULL)
+    if (call->best == NULL)
     {
-        assert(match == 0);
-        assert(best_score == 0);
+        assert(call->match == 0);
         // !!! FIXME: ident->datatype = ?
         failf(ctx, "No matching function named '%s'", sym);
     } // if
     else
     {
-        ident->datatype = reduce_datatype(ctx, best->datatype);
-        ident->index = best->index;
+        ident->datatype = call->best->datatype;
+        ident->index = call->best->index;
     } // else
 
     return ident->datatype;
@@ -2631,15 +2781,15 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
         case MOJOSHADER_AST_OP_NOT:
             datatype = type_check_ast(ctx, ast->unary.operand);
             require_boolean_datatype(ctx, datatype);
-            // !!! FIXME: coerce to bool here.
-            ast->unary.datatype = &ctx->dt_bool;
-            return datatype;
+            add_bool_coercion(ctx, &ast->unary.operand, datatype);
+            ast->unary.datatype = &dt_bool;
+            return ast->unary.datatype;
 
         case MOJOSHADER_AST_OP_DEREF_ARRAY:
             datatype = type_check_ast(ctx, ast->binary.left);
             datatype2 = type_check_ast(ctx, ast->binary.right);
             require_integer_datatype(ctx, datatype2);
-            add_type_coercion(ctx, NULL, &ctx->dt_int, &ast->binary.right, datatype2);
+            add_type_coercion(ctx, NULL, &dt_int, &ast->binary.right, datatype2);
 
             datatype = reduce_datatype(ctx, datatype);
             if (datatype->type == MOJOSHADER_AST_DATATYPE_VECTOR)
@@ -2675,7 +2825,9 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
                 {
                     fail(ctx, "invalid swizzle on vector");
                     // force this to be sane for further processing.
+                    lock_shared(ctx);
                     const char *sane_swiz = stringcache(ctx->strcache, "xyzw");
+                    unlock_shared(ctx);
                     member = ast->derefstruct.member = sane_swiz;
                 } // if
 
@@ -2753,7 +2905,7 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
             datatype2 = type_check_ast(ctx, ast->binary.right);
             add_type_coercion(ctx, &ast->binary.left, datatype,
                               &ast->binary.right, datatype2);
-            ast->binary.datatype = &ctx->dt_bool;
+            ast->binary.datatype = &dt_bool;
             return ast->binary.datatype;
 
         case MOJOSHADER_AST_OP_BINARYAND:
@@ -2773,10 +2925,9 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
             datatype2 = type_check_ast(ctx, ast->binary.right);
             require_boolean_datatype(ctx, datatype);
             require_boolean_datatype(ctx, datatype2);
-            // !!! FIXME: coerce each to bool here, separately.
-            add_type_coercion(ctx, &ast->binary.left, datatype,
-                              &ast->binary.right, datatype2);
-            ast->binary.datatype = &ctx->dt_bool;
+            add_bool_coercion(ctx, &ast->binary.left, datatype);
+            add_bool_coercion(ctx, &ast->binary.right, datatype2);
+            ast->binary.datatype = &dt_bool;
 
         case MOJOSHADER_AST_OP_ASSIGN:
         case MOJOSHADER_AST_OP_MULASSIGN:
@@ -2801,6 +2952,7 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
             datatype2 = type_check_ast(ctx, ast->ternary.center);
             datatype3 = type_check_ast(ctx, ast->ternary.right);
             require_numeric_datatype(ctx, datatype);
+            add_bool_coercion(ctx, &ast->ternary.left, datatype);
             ast->ternary.datatype = add_type_coercion(ctx, &ast->ternary.center,
                                     datatype2, &ast->ternary.right, datatype3);
             return ast->ternary.datatype;
@@ -2811,7 +2963,7 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
             {
                 fail(ctx, "Unknown identifier");
                 // !!! FIXME: replace with a sane default, move on.
-                datatype = &ctx->dt_int;
+                datatype = &dt_int;
             } // if
             ast->identifier.datatype = datatype;
             return ast->identifier.datatype;
@@ -2834,7 +2986,7 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
             // !!! FIXME: replace AST node with an int if this isn't a func.
             if (!require_function_datatype(ctx, reduced))
             {
-                ast->callfunc.datatype = &ctx->dt_int;
+                ast->callfunc.datatype = &dt_int;
                 return ast->callfunc.datatype;
             } // if
 
@@ -2896,9 +3048,8 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
 
                 default:
                     fail(ctx, "Invalid type for constructor");
-                    delete_arguments(ctx, ast->constructor.args);
                     ast->constructor.args = new_argument(ctx, new_literal_int_expr(ctx, 0));
-                    ast->constructor.datatype = &ctx->dt_int;
+                    ast->constructor.datatype = &dt_int;
                     return ast->constructor.datatype;
             } // switch
 
@@ -2946,7 +3097,6 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
                     type_check_ast(ctx, argi->argument);
                 if (prev != NULL)
                     prev->next = NULL;
-                delete_arguments(ctx, arg);
             } // if
 
             return ast->constructor.datatype;
@@ -2991,8 +3141,10 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
 
         case MOJOSHADER_AST_STATEMENT_IF:
             push_scope(ctx);  // new scope for "if ((int x = blah()) != 0)"
-            type_check_ast(ctx, ast->ifstmt.expr);
+            datatype = type_check_ast(ctx, ast->ifstmt.expr);
+            add_bool_coercion(ctx, &ast->ifstmt.expr, datatype);
             type_check_ast(ctx, ast->ifstmt.statement);
+            type_check_ast(ctx, ast->ifstmt.else_statement);
             pop_scope(ctx);
             type_check_ast(ctx, ast->ifstmt.next);
             return NULL;
@@ -3048,7 +3200,8 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
             push_scope(ctx);  // new scope for "for (int x = 0; ...)"
             type_check_ast(ctx, ast->forstmt.var_decl);
             type_check_ast(ctx, ast->forstmt.initializer);
-            type_check_ast(ctx, ast->forstmt.looptest);
+            datatype = type_check_ast(ctx, ast->forstmt.looptest);
+            add_bool_coercion(ctx, &ast->forstmt.looptest, datatype);
             type_check_ast(ctx, ast->forstmt.counter);
             type_check_ast(ctx, ast->forstmt.statement);
             pop_scope(ctx);
@@ -3061,7 +3214,8 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
             // !!! FIXME: should there be a push_scope() here?
             type_check_ast(ctx, ast->dostmt.statement);
             push_scope(ctx);  // new scope for "while ((int x = blah()) != 0)"
-            type_check_ast(ctx, ast->dostmt.expr);
+            datatype = type_check_ast(ctx, ast->dostmt.expr);
+            add_bool_coercion(ctx, &ast->dostmt.expr, datatype);
             pop_scope(ctx);
             ctx->loop_count--;
             type_check_ast(ctx, ast->dostmt.next);
@@ -3070,7 +3224,8 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
         case MOJOSHADER_AST_STATEMENT_WHILE:
             ctx->loop_count++;
             push_scope(ctx);  // new scope for "while ((int x = blah()) != 0)"
-            type_check_ast(ctx, ast->whilestmt.expr);
+            datatype = type_check_ast(ctx, ast->whilestmt.expr);
+            add_bool_coercion(ctx, &ast->whilestmt.expr, datatype);
             type_check_ast(ctx, ast->whilestmt.statement);
             pop_scope(ctx);
             ctx->loop_count--;
@@ -3078,58 +3233,44 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
             return NULL;
 
         case MOJOSHADER_AST_STATEMENT_RETURN:
-            // !!! FIXME: type coercion to outer function's return type.
             // !!! FIXME: warn if unreachable statements follow?
-            type_check_ast(ctx, ast->returnstmt.expr);
+            datatype = type_check_ast(ctx, ast->returnstmt.expr);
+            if (ast->returnstmt.expr == NULL)
+            {
+                if (ctx->func_retval != NULL)
+                    fail(ctx, "function must return a value");
+            } // if
+            else if (ctx->func_retval == NULL)
+                fail(ctx, "void function can't return a value");
+            else
+            {
+                // convert to the function's return type, like an assignment.
+                add_type_coercion(ctx, NULL, ctx->func_retval,
+                                  &ast->returnstmt.expr, datatype);
+            } // else
             type_check_ast(ctx, ast->returnstmt.next);
             return NULL;
 
+        // semantic_analysis() walks the compilation units itself, and
+        //  checks function bodies later with check_function_body().
         case MOJOSHADER_AST_COMPUNIT_FUNCTION:
             assert(!ctx->is_func_scope);
-
-            // We have to tapdance here to make sure the function is in
-            //  the global scope, but it's parameters are pushed as variables
-            //  in the function's scope.
             datatype = type_check_ast(ctx, ast->funcunit.declaration);
             ast->funcunit.index = push_function(ctx,
                                 ast->funcunit.declaration->identifier,
                                 datatype, ast->funcunit.definition == NULL);
-
-            // not just a declaration, but a full function definition?
-            if (ast->funcunit.definition != NULL)
-            {
-                assert(ctx->loop_count == 0);
-                assert(ctx->switch_count == 0);
-                ctx->is_func_scope = 1;
-                ctx->var_index = 0;  // reset this every function.
-                push_scope(ctx);  // so function params are in function scope.
-                // repush the parameters before checking the actual function.
-                MOJOSHADER_astFunctionParameters *param;
-                for (param = ast->funcunit.declaration->params; param; param = param->next)
-                    push_variable(ctx, param->identifier, param->datatype);
-                type_check_ast(ctx, ast->funcunit.definition);
-                pop_scope(ctx);
-                ctx->is_func_scope = 0;
-                assert(ctx->loop_count == 0);
-                assert(ctx->switch_count == 0);
-            } // else
-
-            type_check_ast(ctx, ast->funcunit.next);
             return NULL;
 
         case MOJOSHADER_AST_COMPUNIT_TYPEDEF:
             type_check_ast(ctx, ast->typedefunit.type_info);
-            type_check_ast(ctx, ast->typedefunit.next);
             return NULL;
 
         case MOJOSHADER_AST_COMPUNIT_STRUCT:
             type_check_ast(ctx, ast->structunit.struct_info);
-            type_check_ast(ctx, ast->structunit.next);
             return NULL;
 
         case MOJOSHADER_AST_COMPUNIT_VARIABLE:
             type_check_ast(ctx, ast->varunit.declaration);
-            type_check_ast(ctx, ast->varunit.next);
             return NULL;
 
         case MOJOSHADER_AST_SCALAR_OR_ARRAY:
@@ -3207,27 +3348,15 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
                 mbrs = mbrs->next;
             } // while
 
-            // !!! FIXME: this is hacky.
-            MOJOSHADER_astDataTypeStructMember *dtmbrs;
-            void *ptr = Malloc(ctx, sizeof (*dtmbrs) * count);
-            if (ptr == NULL)
-                return NULL;
-            if (!buffer_append(ctx->garbage, &ptr, sizeof (ptr)))
-            {
-                Free(ctx, ptr);
-                return NULL;
-            } // if
-            dtmbrs = (MOJOSHADER_astDataTypeStructMember *) ptr;
-
-            ptr = Malloc(ctx, sizeof (MOJOSHADER_astDataType));
-            if (ptr == NULL)
-                return NULL;
-            if (!buffer_append(ctx->garbage, &ptr, sizeof (ptr)))
+            // intern_datatype() keeps its own copy of the members array.
+            MOJOSHADER_astDataTypeStructMember *dtmbrs = NULL;
+            if (count > 0)
             {
-                Free(ctx, ptr);
-                return NULL;
+                dtmbrs = (MOJOSHADER_astDataTypeStructMember *)
+                            Malloc(ctx, sizeof (*dtmbrs) * count);
+                if (dtmbrs == NULL)
+                    return NULL;
             } // if
-            MOJOSHADER_astDataType *dt = (MOJOSHADER_astDataType *) ptr;
 
             mbrs = ast->structdecl.members;
             int i;
@@ -3239,10 +3368,14 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
                 mbrs = mbrs->next;
             } // for
 
-            dt->structure.type = MOJOSHADER_AST_DATATYPE_STRUCT;
-            dt->structure.members = dtmbrs;
-            dt->structure.member_count = count;
-            ast->structdecl.datatype = dt;
+            MOJOSHADER_astDataType dt;
+            memset(&dt, '\0', sizeof (dt));
+            dt.structure.type = MOJOSHADER_AST_DATATYPE_STRUCT;
+            dt.structure.members = dtmbrs;
+            dt.structure.member_count = count;
+            ast->structdecl.datatype = intern_datatype(ctx, &dt);
+            if (dtmbrs != NULL)
+                Free(ctx, dtmbrs);
 
             // !!! FIXME: this shouldn't push for anonymous structs: "struct { int x; } myvar;"
             // !!! FIXME:  but right now, the grammar is wrong and requires a name for the struct.
@@ -3274,7 +3407,7 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
             while (decl != NULL)
             {
                 decl->datatype = datatype;
-                push_variable(ctx, decl->details->identifier, datatype);
+                decl->index = push_variable(ctx, decl->details->identifier, datatype);
                 if (decl->initializer != NULL)
                 {
                     datatype2 = type_check_ast(ctx, decl->initializer);
@@ -3312,9 +3445,424 @@ static const MOJOSHADER_astDataType *type_check_ast(Context *ctx, void *_ast)
 } // type_check_ast
 
 
-static inline void semantic_analysis(Context *ctx)
+// Check a function definition's body. Its signature was already checked
+//  and pushed at global scope, by type_check_ast().
+static void check_function_body(Context *ctx,
+                                MOJOSHADER_astCompilationUnitFunction *ast)
+{
+    assert(!ctx->is_func_scope);
+    assert(ctx->loop_count == 0);
+    assert(ctx->switch_count == 0);
+    assert(ast->definition != NULL);
+
+    // We have to tapdance here to make sure the function is in
+    //  the global scope, but it's parameters are pushed as variables
+    //  in the function's scope. Errors from repushing them are reported on
+    //  the declaration's line, where the parameters are.
+    ctx->sourcefile = ast->declaration->ast.filename;
+    ctx->sourceline = ast->declaration->ast.line;
+    ctx->is_func_scope = 1;
+    ctx->func_retval = ast->declaration->datatype->function.retval;
+    ctx->var_index = 0;  // reset this every function.
+    push_scope(ctx);  // so function params are in function scope.
+    // repush the parameters before checking the actual function.
+    MOJOSHADER_astFunctionParameters *param;
+    for (param = ast->declaration->params; param; param = param->next)
+        param->index = push_variable(ctx, param->identifier, param->datatype);
+    type_check_ast(ctx, ast->definition);
+    pop_scope(ctx);
+    ctx->is_func_scope = 0;
+    ctx->func_retval = NULL;
+    assert(ctx->loop_count == 0);
+    assert(ctx->switch_count == 0);
+} // check_function_body
+
+
+// Function bodies get checked on up to one thread per processor, but only
+//  if each thread gets at least this many of them. Most shaders have a
+//  handful of functions, and starting threads would cost more than it saves.
+#define ANALYSIS_FUNCTIONS_PER_THREAD 32
+
+// A function body that semantic_analysis() checks after everything at
+//  global scope, maybe on another thread. It still only sees the globals
+//  that came before it, as if we'd checked it right where it was.
+typedef struct AnalysisJob
+{
+    MOJOSHADER_astCompilationUnitFunction *ast;
+    uint32 visible_serial;  // last global symbol this function can see.
+    int errors_before;  // main thread's error count when we got here.
+    int warnings_before;  // ...and its warning count.
+    int worker;  // which worker checked it...
+    int first_error;  // ...and where its errors are in that worker's list.
+    int error_count;
+    int first_warning;
+    int warning_count;
+} AnalysisJob;
+
+typedef struct AnalysisBatch
+{
+    Mutex *mutex;  // NULL if there's only one thread.
+    AnalysisJob *jobs;
+    int job_count;
+    int next_job;
+} AnalysisBatch;
+
+// A copy of the main context, with its own scopes, call cache and error
+//  lists. The arena, datatypes, string cache and function overloads are the
+//  main context's; analysis_lock guards the parts of those that change.
+typedef struct AnalysisWorker
+{
+    Context ctx;
+    AnalysisBatch *batch;
+    int id;
+    MOJOSHADER_error *errors;  // flattened after the last job.
+    MOJOSHADER_error *warnings;
+} AnalysisWorker;
+
+static int start_analysis_worker(Context *ctx, AnalysisWorker *worker,
+                                 AnalysisBatch *batch, const int id)
+{
+    Context *wctx = &worker->ctx;
+    memcpy(wctx, ctx, sizeof (Context));
+    worker->batch = batch;
+    worker->id = id;
+    worker->errors = NULL;
+    worker->warnings = NULL;
+
+    wctx->isfail = wctx->out_of_memory = 0;
+    wctx->analysis_lock = batch->mutex;
+    wctx->errors = errorlist_create(MallocBridge, FreeBridge, wctx);
+    wctx->warnings = errorlist_create(MallocBridge, FreeBridge, wctx);
+    wctx->calls = hash_create(wctx, hash_hash_call, hash_keymatch_call,
+                              call_nuke, 0, MallocBridge, FreeBridge, wctx);
+    create_symbolmap(wctx, &wctx->usertypes);
+    create_symbolmap(wctx, &wctx->variables);
+    wctx->usertypes.globals = ctx->usertypes.hash;
+    wctx->variables.globals = ctx->variables.hash;
+    wctx->usertypes.builtins = ctx->usertypes.builtins;
+    wctx->variables.builtins = ctx->variables.builtins;
+
+    if ( (wctx->errors == NULL) || (wctx->warnings == NULL) ||
+         (wctx->calls == NULL) || (wctx->usertypes.hash == NULL) ||
+         (wctx->variables.hash == NULL) )
+    {
+        out_of_memory(wctx);
+        return 0;
+    } // if
+
+    return 1;
+} // start_analysis_worker
+
+// Hands everything the worker found back to the main context, and frees
+//  the worker's own state. The errors stay in the worker until we've merged
+//  them; see merge_analysis_messages().
+static void finish_analysis_worker(Context *ctx, AnalysisWorker *worker)
+{
+    Context *wctx = &worker->ctx;
+    if (wctx->errors != NULL)
+        worker->errors = errorlist_flatten(wctx->errors);
+    if (wctx->warnings != NULL)
+        worker->warnings = errorlist_flatten(wctx->warnings);
+
+    if (wctx->calls != NULL)
+        hash_destroy(wctx->calls);
+    if (wctx->usertypes.hash != NULL)
+        destroy_symbolmap(wctx, &wctx->usertypes);
+    if (wctx->variables.hash != NULL)
+        destroy_symbolmap(wctx, &wctx->variables);
+    errorlist_destroy(wctx->errors);
+    errorlist_destroy(wctx->warnings);
+
+    if (wctx->isfail)
+        ctx->isfail = 1;
+    if (wctx->out_of_memory)
+        out_of_memory(ctx);
+} // finish_analysis_worker
+
+static void analysis_worker(void *data)
+{
+    AnalysisWorker *worker = (AnalysisWorker *) data;
+    AnalysisBatch *batch = worker->batch;
+    Context *ctx = &worker->ctx;
+
+    while (1)
+    {
+        if (batch->mutex != NULL)
+            mutex_lock(batch->mutex);
+        const int idx = batch->next_job++;
+        if (batch->mutex != NULL)
+            mutex_unlock(batch->mutex);
+
+        if (idx >= batch->job_count)
+            break;
+
+        AnalysisJob *job = &batch->jobs[idx];
+        job->worker = worker->id;
+        job->first_error = errorlist_count(ctx->errors);
+        job->first_warning = errorlist_count(ctx->warnings);
+        ctx->visible_serial = job->visible_serial;
+        check_function_body(ctx, job->ast);
+        job->error_count = errorlist_count(ctx->errors) - job->first_error;
+        job->warning_count = errorlist_count(ctx->warnings) - job->first_warning;
+    } // while
+} // analysis_worker
+
+// Put the workers' errors (or warnings) back in the main list, in the same
+//  order we'd have reported them if we'd checked everything in one pass.
+static void merge_analysis_messages(Context *ctx, ErrorList *list,
+                                    const AnalysisBatch *batch,
+                                    const AnalysisWorker *workers,
+                                    const int warnings)
+{
+    int total = 0;
+    int i, j;
+
+    for (i = 0; i < batch->job_count; i++)
+    {
+        const AnalysisJob *job = &batch->jobs[i];
+        total += warnings ? job->warning_count : job->error_count;
+    } // for
+
+    if (total == 0)
+        return;  // nothing to reorder.
+
+    const int count = errorlist_count(list);
+    MOJOSHADER_error *ours = errorlist_flatten(list);
+    if ((count > 0) && (ours == NULL))
+    {
+        out_of_memory(ctx);
+        return;
+    } // if
+
+    int pos = 0;
+    for (i = 0; i <= batch->job_count; i++)
+    {
+        const AnalysisJob *job = (i < batch->job_count) ? &batch->jobs[i] : NULL;
+        const int upto = (job == NULL) ? count :
+                    (warnings ? job->warnings_before : job->errors_before);
+        for (; pos < upto; pos++)
+        {
+            const MOJOSHADER_error *e = &ours[pos];
+            errorlist_add(list, e->filename, e->error_position, e->error);
+        } // for
+
+        if (job == NULL)
+            break;
+
+        const AnalysisWorker *worker = &workers[job->worker];
+        const MOJOSHADER_error *msgs = warnings ? worker->warnings : worker->errors;
+        const int first = warnings ? job->first_warning : job->first_error;
+        const int len = warnings ? job->warning_count : job->error_count;
+        if (msgs == NULL)
+            continue;  // out of memory when we flattened them.
+
+        for (j = first; j < first + len; j++)
+        {
+            const MOJOSHADER_error *e = &msgs[j];
+            errorlist_add(list, e->filename, e->error_position, e->error);
+        } // for
+    } // for
+
+    for (i = 0; i < count; i++)
+    {
+        Free(ctx, (void *) ours[i].error);
+        Free(ctx, (void *) ours[i].filename);
+    } // for
+    Free(ctx, ours);
+} // merge_analysis_messages
+
+static void free_analysis_messages(Context *ctx, MOJOSHADER_error *msgs,
+                                   const AnalysisBatch *batch, const int id,
+                                   const int warnings)
+{
+    int i, j;
+    if (msgs == NULL)
+        return;
+
+    for (i = 0; i < batch->job_count; i++)
+    {
+        const AnalysisJob *job = &batch->jobs[i];
+        if (job->worker != id)
+            continue;
+
+        const int first = warnings ? job->first_warning : job->first_error;
+        const int len = warnings ? job->warning_count : job->error_count;
+        for (j = first; j < first + len; j++)
+        {
+            Free(ctx, (void *) msgs[j].error);
+            Free(ctx, (void *) msgs[j].filename);
+        } // for
+    } // for
+
+    Free(ctx, msgs);
+} // free_analysis_messages
+
+static int analysis_thread_count(const Context *ctx, const int job_count)
+{
+    // We'd be calling the app's allocator from several threads, and it
+    //  never agreed to that.
+    if (ctx->malloc != MOJOSHADER_internal_malloc)
+        return 1;
+
+    int retval = job_count / ANALYSIS_FUNCTIONS_PER_THREAD;
+    const int cpus = cpu_count();
+    if (retval > cpus)
+        retval = cpus;
+    if ((ctx->max_analysis_threads > 0) && (retval > ctx->max_analysis_threads))
+        retval = ctx->max_analysis_threads;
+    return (retval < 1) ? 1 : retval;
+} // analysis_thread_count
+
+// Checks everything at global scope, in order, and fills in (batch) with a
+//  job for each function body, for check_function_bodies().
+static void check_globals(Context *ctx, AnalysisBatch *batch)
+{
+    MOJOSHADER_astCompilationUnit *unit;
+    int i;
+
+    memset(batch, '\0', sizeof (*batch));
+    for (unit = (MOJOSHADER_astCompilationUnit *) ctx->ast; unit; unit = unit->next)
+    {
+        if (unit->ast.type == MOJOSHADER_AST_COMPUNIT_FUNCTION)
+        {
+            const MOJOSHADER_astCompilationUnitFunction *fn;
+            fn = (const MOJOSHADER_astCompilationUnitFunction *) unit;
+            batch->job_count += (fn->definition != NULL);
+        } // if
+    } // for
+
+    if (batch->job_count > 0)
+    {
+        const size_t len = sizeof (AnalysisJob) * batch->job_count;
+        batch->jobs = (AnalysisJob *) Malloc(ctx, len);
+        if (batch->jobs == NULL)
+        {
+            batch->job_count = 0;
+            return;
+        } // if
+        memset(batch->jobs, '\0', len);
+    } // if
+
+    AnalysisJob *job = batch->jobs;
+    for (unit = (MOJOSHADER_astCompilationUnit *) ctx->ast; unit; unit = unit->next)
+    {
+        type_check_ast(ctx, unit);
+        if (unit->ast.type == MOJOSHADER_AST_COMPUNIT_FUNCTION)
+        {
+            MOJOSHADER_astCompilationUnitFunction *fn;
+            fn = (MOJOSHADER_astCompilationUnitFunction *) unit;
+            if (fn->definition != NULL)
+            {
+                job->ast = fn;
+                job->visible_serial = ctx->symbol_serial;
+                job->errors_before = errorlist_count(ctx->errors);
+                job->warnings_before = errorlist_count(ctx->warnings);
+                job++;
+            } // if
+        } // if
+    } // for
+
+    // Every function that uses a global struct shares its parse-time stub.
+    //  Fill them in now, so the workers only ever read them.
+    for (i = 0; i < ctx->global_usertype_count; i++)
+    {
+        MOJOSHADER_astDataType *stub = ctx->global_usertypes[i];
+        if (stub->user.details->type == MOJOSHADER_AST_DATATYPE_NONE)
+        {
+            const MOJOSHADER_astDataType *dt = get_usertype(ctx, stub->user.name);
+            if (dt != NULL)
+                stub->user.details = dt;
+        } // if
+    } // for
+} // check_globals
+
+// Checks the function bodies in (batch), on as many threads as we like, and
+//  puts their errors and warnings where they'd be if we'd checked each one
+//  right where it is in the source.
+static void check_function_bodies(Context *ctx, AnalysisBatch *batch)
+{
+    int i;
+
+    if ((batch->job_count == 0) || (ctx->out_of_memory))
+        return;
+
+    batch->next_job = 0;
+
+    // The calling thread is a worker, too, so start one less thread. If
+    //  some of those fail to start, the rest of us pick up the slack.
+    int worker_count = analysis_thread_count(ctx, batch->job_count);
+    if (worker_count > 1)
+    {
+        batch->mutex = mutex_create(ctx->malloc, ctx->free, ctx->malloc_data);
+        if (batch->mutex == NULL)
+            worker_count = 1;
+    } // if
+
+    AnalysisWorker *workers = (AnalysisWorker *)
+                    Malloc(ctx, sizeof (AnalysisWorker) * worker_count);
+    Thread **threads = NULL;
+    if ((workers != NULL) && (worker_count > 1))
+        threads = (Thread **) Malloc(ctx, sizeof (Thread *) * worker_count);
+
+    int started = 0;
+    if ((workers != NULL) && ((worker_count == 1) || (threads != NULL)))
+    {
+        for (i = 0; i < worker_count; i++, started++)
+        {
+            if (!start_analysis_worker(ctx, &workers[i], batch, i))
+            {
+                finish_analysis_worker(ctx, &workers[i]);
+                break;
+            } // if
+        } // for
+    } // if
+
+    if (started > 0)
+    {
+        for (i = 1; i < started; i++)
+        {
+            threads[i] = thread_create(analysis_worker, &workers[i],
+                                       ctx->malloc, ctx->free, ctx->malloc_data);
+        } // for
+
+        analysis_worker(&workers[0]);
+
+        for (i = 1; i < started; i++)
+            thread_join(threads[i]);  // NULL if it didn't start; that's okay.
+
+        for (i = 0; i < started; i++)
+            finish_analysis_worker(ctx, &workers[i]);
+
+        merge_analysis_messages(ctx, ctx->errors, batch, workers, 0);
+        merge_analysis_messages(ctx, ctx->warnings, batch, workers, 1);
+
+        for (i = 0; i < started; i++)
+        {
+            free_analysis_messages(ctx, workers[i].errors, batch, i, 0);
+            free_analysis_messages(ctx, workers[i].warnings, batch, i, 1);
+        } // for
+    } // if
+
+    if (threads != NULL)
+        Free(ctx, threads);
+    if (workers != NULL)
+        Free(ctx, workers);
+    if (batch->mutex != NULL)
+        mutex_destroy(batch->mutex);
+    batch->mutex = NULL;
+} // check_function_bodies
+
+// Everything at global scope gets checked first, in order. That's what
+//  decides what each function can see, so the function bodies can then be
+//  checked in any order, on as many threads as we like: each one only looks
+//  up the globals that came before it, and only changes its own AST.
+static void semantic_analysis(Context *ctx)
 {
-    type_check_ast(ctx, ctx->ast);
+    AnalysisBatch batch;
+    check_globals(ctx, &batch);
+    check_function_bodies(ctx, &batch);
+    if (batch.jobs != NULL)
+        Free(ctx, batch.jobs);
 } // semantic_analysis
 
 // !!! FIXME: isn't this a cut-and-paste of somewhere else?
@@ -3337,6 +3885,26 @@ static inline int64 strtoi64(const char *str, unsigned int len)
         len--;
     } // if
 
+    // hex literals, like 0xFF; masks for the bitwise operators want these.
+    if ((len > 2) && (str[0] == '0') && ((str[1] == 'x') || (str[1] == 'X')))
+    {
+        for (i = 2; i < len; i++)
+        {
+            const char ch = str[i];
+            int digit;
+            if ((ch >= '0') && (ch <= '9'))
+                digit = ch - '0';
+            else if ((ch >= 'a') && (ch <= 'f'))
+                digit = (ch - 'a') + 10;
+            else if ((ch >= 'A') && (ch <= 'F'))
+                digit = (ch - 'A') + 10;
+            else
+                break;
+            retval = (retval * 16) + digit;
+        } // for
+        return retval * mult;
+    } // if
+
     while (i < len)
     {
         const char ch = str[i];
@@ -3402,8 +3970,53 @@ static int is_semantic(const Context *ctx, const char *token,
 } // is_semantic
 #endif
 
-static int convert_to_lemon_token(Context *ctx, const char *token,
-                                  unsigned int tokenlen, const Token tokenval)
+// Identifiers that the parser treats specially: keywords, plus the vector
+//  and matrix typedefs from init_builtins(), which are always user types.
+//  The table is a perfect hash generated by misc/hlsl_keywords.pl, so
+//  classifying an identifier is one hash and at most one memcmp(). The
+//  preprocessor runs this for us (see preprocessor_set_token_classes()), so
+//  convert_to_lemon_token() never looks at token text.
+typedef struct HlslKeyword
+{
+    const char *str;
+    uint8 len;
+    int tokenclass;
+} HlslKeyword;
+
+#include "mojoshader_hlsl_keywords.h"
+
+static int hlsl_keyword_class(const char *str, const unsigned int len)
+{
+    if ((len < HLSL_KEYWORD_MINLEN) || (len > HLSL_KEYWORD_MAXLEN))
+        return 0;
+
+    // this has to hash the same way misc/hlsl_keywords.pl does.
+    uint32 hash = 2166136261u;
+    unsigned int i;
+    for (i = 0; i < len; i++)
+        hash = (hash ^ ((uint8) str[i])) * 16777619u;
+
+    const uint32 bucket = hash & (HLSL_KEYWORD_BUCKETS - 1);
+    const uint32 slot = ((hash >> 16) + hlsl_keyword_displace[bucket]) &
+                        (HLSL_KEYWORD_SLOTS - 1);
+    const HlslKeyword *kw = &hlsl_keyword_slots[slot];
+    if ((kw->len == len) && (memcmp(kw->str, str, len) == 0))
+        return kw->tokenclass;
+    return 0;
+} // hlsl_keyword_class
+
+// Keywords never need their text again, but the parser holds on to the
+//  names of the builtin types, like any other user type.
+static int classify_hlsl_identifier(const char *str, const unsigned int len,
+                                    int *needtext)
+{
+    const int retval = hlsl_keyword_class(str, len);
+    *needtext = (retval == TOKEN_HLSL_USERTYPE);
+    return retval;
+} // classify_hlsl_identifier
+
+static int convert_to_lemon_token(Context *ctx, const Token tokenval,
+                                  const char *interned, const int tokenclass)
 {
     switch (tokenval)
     {
@@ -3458,82 +4071,12 @@ static int convert_to_lemon_token(Context *ctx, const char *token,
         //case ((Token) '\n'): return TOKEN_HLSL_NEWLINE;
 
         case ((Token) TOKEN_IDENTIFIER):
-            #define tokencmp(t) ((tokenlen == strlen(t)) && (memcmp(token, t, tokenlen) == 0))
             //case ((Token) ''): return TOKEN_HLSL_TYPECAST
             //if (tokencmp("")) return TOKEN_HLSL_TYPE_NAME
             //if (tokencmp("...")) return TOKEN_HLSL_ELIPSIS
-            if (tokencmp("else")) return TOKEN_HLSL_ELSE;
-            if (tokencmp("inline")) return TOKEN_HLSL_INLINE;
-            if (tokencmp("void")) return TOKEN_HLSL_VOID;
-            if (tokencmp("in")) return TOKEN_HLSL_IN;
-            if (tokencmp("inout")) return TOKEN_HLSL_INOUT;
-            if (tokencmp("out")) return TOKEN_HLSL_OUT;
-            if (tokencmp("uniform")) return TOKEN_HLSL_UNIFORM;
-            if (tokencmp("linear")) return TOKEN_HLSL_LINEAR;
-            if (tokencmp("centroid")) return TOKEN_HLSL_CENTROID;
-            if (tokencmp("nointerpolation")) return TOKEN_HLSL_NOINTERPOLATION;
-            if (tokencmp("noperspective")) return TOKEN_HLSL_NOPERSPECTIVE;
-            if (tokencmp("sample")) return TOKEN_HLSL_SAMPLE;
-            if (tokencmp("struct")) return TOKEN_HLSL_STRUCT;
-            if (tokencmp("typedef")) return TOKEN_HLSL_TYPEDEF;
-            if (tokencmp("const")) return TOKEN_HLSL_CONST;
-            if (tokencmp("packoffset")) return TOKEN_HLSL_PACKOFFSET;
-            if (tokencmp("register")) return TOKEN_HLSL_REGISTER;
-            if (tokencmp("extern")) return TOKEN_HLSL_EXTERN;
-            if (tokencmp("shared")) return TOKEN_HLSL_SHARED;
-            if (tokencmp("static")) return TOKEN_HLSL_STATIC;
-            if (tokencmp("volatile")) return TOKEN_HLSL_VOLATILE;
-            if (tokencmp("row_major")) return TOKEN_HLSL_ROWMAJOR;
-            if (tokencmp("column_major")) return TOKEN_HLSL_COLUMNMAJOR;
-            if (tokencmp("bool")) return TOKEN_HLSL_BOOL;
-            if (tokencmp("int")) return TOKEN_HLSL_INT;
-            if (tokencmp("uint")) return TOKEN_HLSL_UINT;
-            if (tokencmp("half")) return TOKEN_HLSL_HALF;
-            if (tokencmp("float")) return TOKEN_HLSL_FLOAT;
-            if (tokencmp("double")) return TOKEN_HLSL_DOUBLE;
-            if (tokencmp("string")) return TOKEN_HLSL_STRING;
-            if (tokencmp("snorm")) return TOKEN_HLSL_SNORM;
-            if (tokencmp("unorm")) return TOKEN_HLSL_UNORM;
-            if (tokencmp("buffer")) return TOKEN_HLSL_BUFFER;
-            if (tokencmp("vector")) return TOKEN_HLSL_VECTOR;
-            if (tokencmp("matrix")) return TOKEN_HLSL_MATRIX;
-            if (tokencmp("break")) return TOKEN_HLSL_BREAK;
-            if (tokencmp("continue")) return TOKEN_HLSL_CONTINUE;
-            if (tokencmp("discard")) return TOKEN_HLSL_DISCARD;
-            if (tokencmp("return")) return TOKEN_HLSL_RETURN;
-            if (tokencmp("while")) return TOKEN_HLSL_WHILE;
-            if (tokencmp("for")) return TOKEN_HLSL_FOR;
-            if (tokencmp("unroll")) return TOKEN_HLSL_UNROLL;
-            if (tokencmp("loop")) return TOKEN_HLSL_LOOP;
-            if (tokencmp("do")) return TOKEN_HLSL_DO;
-            if (tokencmp("if")) return TOKEN_HLSL_IF;
-            if (tokencmp("branch")) return TOKEN_HLSL_BRANCH;
-            if (tokencmp("flatten")) return TOKEN_HLSL_FLATTEN;
-            if (tokencmp("switch")) return TOKEN_HLSL_SWITCH;
-            if (tokencmp("forcecase")) return TOKEN_HLSL_FORCECASE;
-            if (tokencmp("call")) return TOKEN_HLSL_CALL;
-            if (tokencmp("case")) return TOKEN_HLSL_CASE;
-            if (tokencmp("default")) return TOKEN_HLSL_DEFAULT;
-            if (tokencmp("sampler")) return TOKEN_HLSL_SAMPLER;
-            if (tokencmp("sampler1D")) return TOKEN_HLSL_SAMPLER1D;
-            if (tokencmp("sampler2D")) return TOKEN_HLSL_SAMPLER2D;
-            if (tokencmp("sampler3D")) return TOKEN_HLSL_SAMPLER3D;
-            if (tokencmp("samplerCUBE")) return TOKEN_HLSL_SAMPLERCUBE;
-            if (tokencmp("sampler_state")) return TOKEN_HLSL_SAMPLER_STATE;
-            if (tokencmp("SamplerState")) return TOKEN_HLSL_SAMPLERSTATE;
-            if (tokencmp("true")) return TOKEN_HLSL_TRUE;
-            if (tokencmp("false")) return TOKEN_HLSL_FALSE;
-            if (tokencmp("SamplerComparisonState")) return TOKEN_HLSL_SAMPLERCOMPARISONSTATE;
-            if (tokencmp("isolate")) return TOKEN_HLSL_ISOLATE;
-            if (tokencmp("maxInstructionCount")) return TOKEN_HLSL_MAXINSTRUCTIONCOUNT;
-            if (tokencmp("noExpressionOptimizations")) return TOKEN_HLSL_NOEXPRESSIONOPTIMIZATIONS;
-            if (tokencmp("unused")) return TOKEN_HLSL_UNUSED;
-            if (tokencmp("xps")) return TOKEN_HLSL_XPS;
-            #undef tokencmp
-
-            // get a canonical copy of the string now, as we'll need it.
-            token = stringcache_len(ctx->strcache, token, tokenlen);
-            if (get_usertype(ctx, token) != NULL)
+            if (tokenclass != 0)  // from hlsl_keyword_class().
+                return tokenclass;
+            else if (get_usertype(ctx, interned) != NULL)
                 return TOKEN_HLSL_USERTYPE;
             return TOKEN_HLSL_IDENTIFIER;
 
@@ -3547,6 +4090,20 @@ static int convert_to_lemon_token(Context *ctx, const char *token,
 
 static void delete_ir(Context *ctx, void *_ir);  // !!! FIXME: move this code around.
 
+// Struct uniforms' symbols have member names and types hanging off them.
+static void free_symbol_members(MOJOSHADER_free f, void *d,
+                                MOJOSHADER_symbolTypeInfo *info)
+{
+    unsigned int i;
+    for (i = 0; i < info->member_count; i++)
+    {
+        f((void *) info->members[i].name, d);
+        free_symbol_members(f, d, &info->members[i].info);
+    } // for
+    if (info->members != NULL)
+        f(info->members, d);
+} // free_symbol_members
+
 static void destroy_context(Context *ctx)
 {
     if (ctx != NULL)
@@ -3555,21 +4112,17 @@ static void destroy_context(Context *ctx)
         void *d = ctx->malloc_data;
         size_t i = 0;
 
-        // !!! FIXME: this is kinda hacky.
-        const size_t count = buffer_size(ctx->garbage) / sizeof (void *);
-        if (count > 0)
-        {
-            void **garbage = (void **) buffer_flatten(ctx->garbage);
-            if (garbage != NULL)
-            {
-                for (i = 0; i < count; i++)
-                    f(garbage[i], d);
-                f(garbage, d);
-            } // if
-        } // if
-        buffer_destroy(ctx->garbage);
+        // the whole AST and every datatype we built lives in here.
+        if (ctx->datatypes != NULL)
+            hash_destroy(ctx->datatypes);
+        if (ctx->functions != NULL)
+            hash_destroy(ctx->functions);
+        if (ctx->calls != NULL)
+            hash_destroy(ctx->calls);
+        arena_destroy(ctx->arena);
+        ctx->arena = NULL;
+        ctx->ast = NULL;
 
-        delete_compilation_unit(ctx, (MOJOSHADER_astCompilationUnit*)ctx->ast);
         destroy_symbolmap(ctx, &ctx->usertypes);
         destroy_symbolmap(ctx, &ctx->variables);
         stringcache_destroy(ctx->strcache);
@@ -3579,17 +4132,43 @@ static void destroy_context(Context *ctx)
         if (ctx->ir != NULL)
         {
             for (i = 0; i <= ctx->user_func_index; i++)
-                delete_ir(ctx, ctx->ir[i]);
+            {
+                if (ctx->ir[i].first != NULL)
+                    f(ctx->ir[i].first, d);  // see store_ir().
+            } // for
             f(ctx->ir, d);
         } // if
 
+        if (ctx->ir_constant_map != NULL)
+            hash_destroy(ctx->ir_constant_map);
+        if (ctx->ir_constants != NULL)
+            f(ctx->ir_constants, d);
+        if (ctx->ir_files != NULL)
+            f((void *) ctx->ir_files, d);
+
+        if (ctx->ir_funcs != NULL)
+            f(ctx->ir_funcs, d);
+
+        // these are NULL if build_compiledata() took them.
+        if (ctx->symbols != NULL)
+        {
+            for (i = 0; i < (size_t) ctx->symbol_count; i++)
+            {
+                f((void *) ctx->symbols[i].name, d);
+                free_symbol_members(f, d, &ctx->symbols[i].info);
+            } // for
+            f(ctx->symbols, d);
+        } // if
+        f(ctx->output, d);
+        f(ctx->bytecode, d);
+
         // !!! FIXME: more to clean up here, now.
 
         f(ctx, d);
     } // if
 } // destroy_context
 
-static Context *build_context(MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+static Context *create_context(MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
 {
     if (!m) m = MOJOSHADER_internal_malloc;
     if (!f) f = MOJOSHADER_internal_free;
@@ -3602,6 +4181,7 @@ static Context *build_context(MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
     ctx->malloc = m;
     ctx->free = f;
     ctx->malloc_data = d;
+    ctx->visible_serial = 0xFFFFFFFF;  // everything, outside analysis workers.
     //ctx->parse_phase = MOJOSHADER_PARSEPHASE_NOTSTARTED;
     create_symbolmap(ctx, &ctx->usertypes); // !!! FIXME: check for failure.
     create_symbolmap(ctx, &ctx->variables); // !!! FIXME: check for failure.
@@ -3609,41 +4189,29 @@ static Context *build_context(MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
     ctx->errors = errorlist_create(MallocBridge, FreeBridge, ctx);  // !!! FIXME: check for failure.
     ctx->warnings = errorlist_create(MallocBridge, FreeBridge, ctx);  // !!! FIXME: check for failure.
 
-    // !!! FIXME: this feels hacky.
-    ctx->garbage = buffer_create(256*sizeof(void*),MallocBridge,FreeBridge,ctx);  // !!! FIXME: check for failure.
-
-    ctx->dt_none.type = MOJOSHADER_AST_DATATYPE_NONE;
-    ctx->dt_bool.type = MOJOSHADER_AST_DATATYPE_BOOL;
-    ctx->dt_int.type = MOJOSHADER_AST_DATATYPE_INT;
-    ctx->dt_uint.type = MOJOSHADER_AST_DATATYPE_UINT;
-    ctx->dt_float.type = MOJOSHADER_AST_DATATYPE_FLOAT;
-    ctx->dt_float_snorm.type = MOJOSHADER_AST_DATATYPE_FLOAT_SNORM;
-    ctx->dt_float_unorm.type = MOJOSHADER_AST_DATATYPE_FLOAT_UNORM;
-    ctx->dt_half.type = MOJOSHADER_AST_DATATYPE_HALF;
-    ctx->dt_double.type = MOJOSHADER_AST_DATATYPE_DOUBLE;
-    ctx->dt_string.type = MOJOSHADER_AST_DATATYPE_STRING;
-    ctx->dt_sampler1d.type = MOJOSHADER_AST_DATATYPE_SAMPLER_1D;
-    ctx->dt_sampler2d.type = MOJOSHADER_AST_DATATYPE_SAMPLER_2D;
-    ctx->dt_sampler3d.type = MOJOSHADER_AST_DATATYPE_SAMPLER_3D;
-    ctx->dt_samplercube.type = MOJOSHADER_AST_DATATYPE_SAMPLER_CUBE;
-    ctx->dt_samplerstate.type = MOJOSHADER_AST_DATATYPE_SAMPLER_STATE;
-    ctx->dt_samplercompstate.type = MOJOSHADER_AST_DATATYPE_SAMPLER_COMPARISON_STATE;
+    ctx->arena = arena_create(64 * 1024, MallocBridge, FreeBridge, ctx);
+    if (ctx->arena == NULL)
+        out_of_memory(ctx);
 
-    #define INIT_DT_BUFFER(t) \
-        ctx->dt_buf_##t.type = MOJOSHADER_AST_DATATYPE_BUFFER; \
-        ctx->dt_buf_##t.buffer.base = &ctx->dt_##t;
-    INIT_DT_BUFFER(bool);
-    INIT_DT_BUFFER(int);
-    INIT_DT_BUFFER(uint);
-    INIT_DT_BUFFER(half);
-    INIT_DT_BUFFER(float);
-    INIT_DT_BUFFER(double);
-    INIT_DT_BUFFER(float_snorm);
-    INIT_DT_BUFFER(float_unorm);
-    #undef INIT_DT_BUFFER
+    ctx->datatypes = hash_create(ctx, hash_hash_datatype,
+                                 hash_keymatch_datatype, datatype_nuke, 1,
+                                 MallocBridge, FreeBridge, ctx);
+    if (ctx->datatypes == NULL)
+        out_of_memory(ctx);
+
+    ctx->functions = hash_create(ctx, hash_hash_overloads,
+                                 hash_keymatch_overloads, overloads_nuke, 1,
+                                 MallocBridge, FreeBridge, ctx);
+    if (ctx->functions == NULL)
+        out_of_memory(ctx);
+
+    ctx->calls = hash_create(ctx, hash_hash_call, hash_keymatch_call,
+                             call_nuke, 0, MallocBridge, FreeBridge, ctx);
+    if (ctx->calls == NULL)
+        out_of_memory(ctx);
 
     return ctx;
-} // build_context
+} // create_context
 
 
 // This macro salsa is kinda nasty, but it's the smallest, least error-prone
@@ -3716,16 +4284,16 @@ static Context *build_context(MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
 } while (0)
 
 #define ADD_INTRINSIC_ANY_FLOAT(code) do { \
-    ADD_INTRINSIC_ANY(&ctx->dt_double, "double", code); \
-    ADD_INTRINSIC_ANY(&ctx->dt_half, "half", code); \
-    ADD_INTRINSIC_ANY(&ctx->dt_float, "float", code); \
+    ADD_INTRINSIC_ANY(&dt_double, "double", code); \
+    ADD_INTRINSIC_ANY(&dt_half, "half", code); \
+    ADD_INTRINSIC_ANY(&dt_float, "float", code); \
 } while (0)
 #define ADD_INTRINSIC_ANY_INT(code) do { \
-    ADD_INTRINSIC_ANY(&ctx->dt_uint, "uint", code); \
-    ADD_INTRINSIC_ANY(&ctx->dt_int, "int", code); \
+    ADD_INTRINSIC_ANY(&dt_uint, "uint", code); \
+    ADD_INTRINSIC_ANY(&dt_int, "int", code); \
 } while (0)
 
-#define ADD_INTRINSIC_ANY_BOOL(code) ADD_INTRINSIC_ANY(&ctx->dt_bool, "bool", code)
+#define ADD_INTRINSIC_ANY_BOOL(code) ADD_INTRINSIC_ANY(&dt_bool, "bool", code)
 
 static void add_intrinsic1(Context *ctx, const char *fn,
                            const MOJOSHADER_astDataType *ret,
@@ -3782,13 +4350,13 @@ static void add_intrinsic_SAME1_ANYfi(Context *ctx, const char *fn)
 
 static void add_intrinsic_BOOL_ANYf(Context *ctx, const char *fn)
 {
-    ADD_INTRINSIC_ANY_FLOAT(add_intrinsic1(ctx, fn, &ctx->dt_bool, dt));
+    ADD_INTRINSIC_ANY_FLOAT(add_intrinsic1(ctx, fn, &dt_bool, dt));
 } // add_intrinsic_BOOL_ANYf
 
 static void add_intrinsic_BOOL_ANYfib(Context *ctx, const char *fn)
 {
-    ADD_INTRINSIC_ANY_BOOL(add_intrinsic1(ctx, fn, &ctx->dt_bool, dt));
-    ADD_INTRINSIC_ANY_INT(add_intrinsic1(ctx, fn, &ctx->dt_bool, dt));
+    ADD_INTRINSIC_ANY_BOOL(add_intrinsic1(ctx, fn, &dt_bool, dt));
+    ADD_INTRINSIC_ANY_INT(add_intrinsic1(ctx, fn, &dt_bool, dt));
     add_intrinsic_BOOL_ANYf(ctx, fn);
 } // add_intrinsic_BOOL_ANYfib
 
@@ -3848,10 +4416,10 @@ static void add_intrinsic_VOID_ANYf_SAME1_SAME1(Context *ctx, const char *fn)
 
 static void add_intrinsic_f_SQUAREMATRIXf(Context *ctx, const char *fn)
 {
-    add_intrinsic1(ctx, fn, &ctx->dt_float, get_usertype(ctx, "float1x1"));
-    add_intrinsic1(ctx, fn, &ctx->dt_float, get_usertype(ctx, "float2x2"));
-    add_intrinsic1(ctx, fn, &ctx->dt_float, get_usertype(ctx, "float3x3"));
-    add_intrinsic1(ctx, fn, &ctx->dt_float, get_usertype(ctx, "float4x4"));
+    add_intrinsic1(ctx, fn, &dt_float, get_usertype(ctx, "float1x1"));
+    add_intrinsic1(ctx, fn, &dt_float, get_usertype(ctx, "float2x2"));
+    add_intrinsic1(ctx, fn, &dt_float, get_usertype(ctx, "float3x3"));
+    add_intrinsic1(ctx, fn, &dt_float, get_usertype(ctx, "float4x4"));
 } // add_intrinsic_f_SQUAREMATRIXf
 
 static void add_intrinsic_f_Vf(Context *ctx, const char *fn)
@@ -3879,87 +4447,87 @@ static void add_intrinsic_3f_3f_3f(Context *ctx, const char *fn)
 static void add_intrinsic_4f_f_f_f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
-    const MOJOSHADER_astDataType *f = &ctx->dt_float;
+    const MOJOSHADER_astDataType *f = &dt_float;
     add_intrinsic3(ctx, fn, f4, f, f, f);
 } // add_intrinsic_4f_f_f_f
 
 static void add_intrinsic_4f_s1_4f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *dt = get_usertype(ctx, "float4");
-    add_intrinsic2(ctx, fn, dt, &ctx->dt_sampler1d, dt);
+    add_intrinsic2(ctx, fn, dt, &dt_sampler1d, dt);
 } // add_intrinsic_4f_s1_4f
 
 static void add_intrinsic_4f_s1_f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *dt = get_usertype(ctx, "float4");
-    add_intrinsic2(ctx, fn, dt, &ctx->dt_sampler1d, &ctx->dt_float);
+    add_intrinsic2(ctx, fn, dt, &dt_sampler1d, &dt_float);
 } // add_intrinsic_4f_s1_f
 
 static void add_intrinsic_4f_s1_f_f_f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *dt = get_usertype(ctx, "float4");
-    const MOJOSHADER_astDataType *f = &ctx->dt_float;
-    add_intrinsic4(ctx, fn, dt, &ctx->dt_sampler1d, f, f, f);
+    const MOJOSHADER_astDataType *f = &dt_float;
+    add_intrinsic4(ctx, fn, dt, &dt_sampler1d, f, f, f);
 } // add_intrinsic_4f_s1_f_f_f
 
 static void add_intrinsic_4f_s2_2f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
     const MOJOSHADER_astDataType *f2 = get_usertype(ctx, "float2");
-    add_intrinsic2(ctx, fn, f4, &ctx->dt_sampler2d, f2);
+    add_intrinsic2(ctx, fn, f4, &dt_sampler2d, f2);
 } // add_intrinsic_4f_s2_2f
 
 static void add_intrinsic_4f_s2_2f_2f_2f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
     const MOJOSHADER_astDataType *f2 = get_usertype(ctx, "float2");
-    add_intrinsic4(ctx, fn, f4, &ctx->dt_sampler2d, f2, f2, f2);
+    add_intrinsic4(ctx, fn, f4, &dt_sampler2d, f2, f2, f2);
 } // add_intrinsic_4f_s2_2f_2f_2f
 
 static void add_intrinsic_4f_s2_4f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
-    add_intrinsic2(ctx, fn, f4, &ctx->dt_sampler2d, f4);
+    add_intrinsic2(ctx, fn, f4, &dt_sampler2d, f4);
 } // add_intrinsic_4f_s2_4f
 
 static void add_intrinsic_4f_s3_3f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
     const MOJOSHADER_astDataType *f3 = get_usertype(ctx, "float3");
-    add_intrinsic2(ctx, fn, f4, &ctx->dt_sampler3d, f3);
+    add_intrinsic2(ctx, fn, f4, &dt_sampler3d, f3);
 } // add_intrinsic_4f_s3_3f
 
 static void add_intrinsic_4f_s3_3f_3f_3f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
     const MOJOSHADER_astDataType *f3 = get_usertype(ctx, "float3");
-    add_intrinsic4(ctx, fn, f4, &ctx->dt_sampler3d, f3, f3, f3);
+    add_intrinsic4(ctx, fn, f4, &dt_sampler3d, f3, f3, f3);
 } // add_intrinsic_4f_s3_3f_3f_3f
 
 static void add_intrinsic_4f_s3_4f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
-    add_intrinsic2(ctx, fn, f4, &ctx->dt_sampler3d, f4);
+    add_intrinsic2(ctx, fn, f4, &dt_sampler3d, f4);
 } // add_intrinsic_4f_s3_4f
 
 static void add_intrinsic_4f_sc_3f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
     const MOJOSHADER_astDataType *f3 = get_usertype(ctx, "float3");
-    add_intrinsic2(ctx, fn, f4, &ctx->dt_samplercube, f3);
+    add_intrinsic2(ctx, fn, f4, &dt_samplercube, f3);
 } // add_intrinsic_4f_sc_3f
 
 static void add_intrinsic_4f_sc_3f_3f_3f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
     const MOJOSHADER_astDataType *f3 = get_usertype(ctx, "float3");
-    add_intrinsic4(ctx, fn, f4, &ctx->dt_samplercube, f3, f3, f3);
+    add_intrinsic4(ctx, fn, f4, &dt_samplercube, f3, f3, f3);
 } // add_intrinsic_4f_sc_3f_3f_3f
 
 static void add_intrinsic_4f_sc_4f(Context *ctx, const char *fn)
 {
     const MOJOSHADER_astDataType *f4 = get_usertype(ctx, "float4");
-    add_intrinsic2(ctx, fn, f4, &ctx->dt_samplercube, f4);
+    add_intrinsic2(ctx, fn, f4, &dt_samplercube, f4);
 } // add_intrinsic_4f_sc_4f
 
 static void add_intrinsic_4i_4f(Context *ctx, const char *fn)
@@ -3974,8 +4542,8 @@ static void add_intrinsic_mul(Context *ctx, const char *fn)
     // mul() is nasty, since there's a bunch of overloads that aren't just
     //  related to vector size.
     // !!! FIXME: needs half, double, uint...
-    const MOJOSHADER_astDataType *dtf = &ctx->dt_float;
-    const MOJOSHADER_astDataType *dti = &ctx->dt_int;
+    const MOJOSHADER_astDataType *dtf = &dt_float;
+    const MOJOSHADER_astDataType *dti = &dt_int;
     const MOJOSHADER_astDataType *f1 = get_usertype(ctx, "float1");
     const MOJOSHADER_astDataType *f2 = get_usertype(ctx, "float2");
     const MOJOSHADER_astDataType *f3 = get_usertype(ctx, "float3");
@@ -4248,12 +4816,12 @@ static void init_builtins(Context *ctx)
         const char *str;
         const MOJOSHADER_astDataType *datatype;
     } types[] = {
-        { "bool", &ctx->dt_bool },
-        { "int", &ctx->dt_int },
-        { "uint", &ctx->dt_uint },
-        { "half", &ctx->dt_half },
-        { "float", &ctx->dt_float },
-        { "double", &ctx->dt_double },
+        { "bool", &dt_bool },
+        { "int", &dt_int },
+        { "uint", &dt_uint },
+        { "half", &dt_half },
+        { "float", &dt_float },
+        { "double", &dt_double },
     };
 
     int i, j, k;
@@ -4268,12 +4836,14 @@ static void init_builtins(Context *ctx)
             // "float2"
             dt = new_datatype_vector(ctx, types[i].datatype, j);
             len = snprintf(buf, sizeof (buf), "%s%d", types[i].str, j);
+            assert(hlsl_keyword_class(buf, len) == TOKEN_HLSL_USERTYPE);
             push_usertype(ctx, stringcache_len(ctx->strcache, buf, len), dt);
             for (k = 1; k <= 4; k++)
             {
                 // "float2x2"
                 dt = new_datatype_matrix(ctx, types[i].datatype, j, k);
                 len = snprintf(buf, sizeof (buf), "%s%dx%d", types[i].str,j,k);
+                assert(hlsl_keyword_class(buf, len) == TOKEN_HLSL_USERTYPE);
                 push_usertype(ctx, stringcache_len(ctx->strcache,buf,len), dt);
             } // for
         } // for
@@ -4382,48 +4952,227 @@ static void init_builtins(Context *ctx)
 } // init_builtins
 
 
-// parse the source code into an AST.
-static void parse_source(Context *ctx, const char *filename,
+// The builtins live until the process ends, so they can't come from the
+//  app's allocator, which might be torn down before then, or from the C
+//  runtime's, which MOJOSHADER_FORCE_ALLOCATOR builds don't use. They come
+//  out of this static pool instead. Only build_builtins() allocates from
+//  it, under run_once()'s lock. Freeing only gives back the most recent
+//  allocation (a hash table growing, usually); anything else is simply
+//  left in place. The builtins need about 600K on a 64-bit build.
+#define BUILTIN_POOL_SIZE (1024 * 1024)
+static union
+{
+    char bytes[BUILTIN_POOL_SIZE];
+    void *align_ptr;
+    double align_double;
+    long long align_long;
+} builtin_pool;
+static size_t builtin_pool_used = 0;
+static size_t builtin_pool_last = 0;  // offset of the newest allocation.
+
+static void * MOJOSHADERCALL builtin_malloc(int bytes, void *d)
+{
+    const size_t len = (((size_t) bytes) + 15) & ~((size_t) 15);
+    if (len > (sizeof (builtin_pool.bytes) - builtin_pool_used))
+    {
+        assert(!"BUILTIN_POOL_SIZE is too small");
+        return NULL;
+    } // if
+
+    builtin_pool_last = builtin_pool_used;
+    builtin_pool_used += len;
+    return builtin_pool.bytes + builtin_pool_last;
+} // builtin_malloc
+
+static void MOJOSHADERCALL builtin_free(void *ptr, void *d)
+{
+    if (ptr == (void *) (builtin_pool.bytes + builtin_pool_last))
+        builtin_pool_used = builtin_pool_last;
+} // builtin_free
+
+// The builtin typedefs ("float4", etc) and intrinsic functions are the same
+//  for every compile, so we build them once, into a context that lives until
+//  the process ends, and every compile's global scope sits on top of it.
+//  Nothing writes to it after this, so compiles on other threads can read it
+//  without locking. Its memory is in builtin_pool, and is never freed.
+static int build_builtins(void)
+{
+    Context *ctx = create_context(builtin_malloc, builtin_free, NULL);
+    if (ctx == NULL)
+        return 0;
+
+    #define INIT_DT_BUFFER(t) \
+        dt_buf_##t.type = MOJOSHADER_AST_DATATYPE_BUFFER; \
+        dt_buf_##t.buffer.base = &dt_##t;
+    INIT_DT_BUFFER(bool);
+    INIT_DT_BUFFER(int);
+    INIT_DT_BUFFER(uint);
+    INIT_DT_BUFFER(half);
+    INIT_DT_BUFFER(float);
+    INIT_DT_BUFFER(double);
+    INIT_DT_BUFFER(float_snorm);
+    INIT_DT_BUFFER(float_unorm);
+    #undef INIT_DT_BUFFER
+
+    // the builtin datatypes above are the interned copies of themselves.
+    const MOJOSHADER_astDataType *builtins[] = {
+        &dt_none, &dt_bool, &dt_int, &dt_uint, &dt_float, &dt_float_snorm,
+        &dt_float_unorm, &dt_half, &dt_double, &dt_string, &dt_sampler1d,
+        &dt_sampler2d, &dt_sampler3d, &dt_samplercube, &dt_samplerstate,
+        &dt_samplercompstate, &dt_buf_bool, &dt_buf_int, &dt_buf_uint,
+        &dt_buf_half, &dt_buf_float, &dt_buf_double, &dt_buf_float_snorm,
+        &dt_buf_float_unorm
+    };
+
+    int i;
+    for (i = 0; (i < STATICARRAYLEN(builtins)) && (!ctx->isfail); i++)
+    {
+        if (hash_insert(ctx->datatypes, builtins[i], builtins[i]) != 1)
+            out_of_memory(ctx);
+    } // for
+
+    if (!ctx->isfail)
+        init_builtins(ctx);
+
+    if (ctx->isfail)
+    {
+        destroy_context(ctx);
+        builtin_pool_used = builtin_pool_last = 0;  // start over next time.
+        return 0;
+    } // if
+
+    builtin_ctx = ctx;
+    return 1;
+} // build_builtins
+
+static Context *build_context(MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    Context *ctx = create_context(m, f, d);
+    if (ctx == NULL)
+        return NULL;
+    else if (!run_once(&builtin_once, build_builtins))
+        out_of_memory(ctx);
+    else
+    {
+        ctx->usertypes.builtins = builtin_ctx->usertypes.hash;
+        ctx->variables.builtins = builtin_ctx->variables.hash;
+    } // else
+    return ctx;
+} // build_context
+
+
+// Where parse_tokens() gets the preprocessor's output from: the
+//  preprocessor itself, or a recording of it (see record_tokens()).
+typedef struct TokenSource
+{
+    Preprocessor *pp;  // NULL to play back (tape) instead.
+    const char *tape;
+    size_t tapelen;
+    size_t tapepos;
+} TokenSource;
+
+// One recorded token. The token's text and a null terminator follow it.
+typedef struct TapeToken
+{
+    Token tokenval;
+    unsigned int len;
+    unsigned int line;
+    const char *filename;  // in ctx->strcache.
+} TapeToken;
+
+// Reads the token at (pos) in (tape), and returns where the next one is.
+static size_t read_tape_token(const char *tape, const size_t pos,
+                              TapeToken *tt, const char **_token)
+{
+    memcpy(tt, tape + pos, sizeof (*tt));
+    *_token = tape + pos + sizeof (*tt);
+    return pos + sizeof (*tt) + tt->len + 1;
+} // read_tape_token
+
+// The next token, like preprocessor_nexttoken_classified(). This sets
+//  ctx->sourcefile and ctx->sourceline to where the token came from, too.
+static const char *next_source_token(Context *ctx, TokenSource *src,
+                                     unsigned int *_len, Token *_tokenval,
+                                     const char **_interned, int *_tokenclass)
+{
+    if (src->pp != NULL)
+    {
+        const char *token = preprocessor_nexttoken_classified(src->pp,
+                                    _len, _tokenval, _interned, _tokenclass);
+        const char *fname = preprocessor_sourcepos(src->pp, &ctx->sourceline);
+        ctx->sourcefile = fname ? stringcache(ctx->strcache, fname) : 0;
+        return token;
+    } // if
+
+    TapeToken tt;
+    const char *token = NULL;
+    int needtext = 1;
+    assert(src->tapepos + sizeof (tt) <= src->tapelen);
+    src->tapepos = read_tape_token(src->tape, src->tapepos, &tt, &token);
+    ctx->sourcefile = tt.filename;
+    ctx->sourceline = tt.line;
+    *_len = tt.len;
+    *_tokenval = tt.tokenval;
+
+    // a recording outlives the string cache, so classify it like the
+    //  preprocessor would have.
+    *_interned = NULL;
+    *_tokenclass = 0;
+    if (tt.tokenval == TOKEN_IDENTIFIER)
+        *_tokenclass = classify_hlsl_identifier(token, tt.len, &needtext);
+    if ( ((tt.tokenval == TOKEN_IDENTIFIER) &&
+          ((*_tokenclass == 0) || (needtext))) ||
+         (tt.tokenval == TOKEN_STRING_LITERAL) )
+    {
+        *_interned = stringcache_len(ctx->strcache, token, tt.len);
+    } // if
+    return token;
+} // next_source_token
+
+static Preprocessor *start_preprocessor(Context *ctx, const char *filename,
                          const char *source, unsigned int sourcelen,
                          const MOJOSHADER_preprocessorDefine *defines,
                          unsigned int define_count,
                          MOJOSHADER_includeOpen include_open,
-                         MOJOSHADER_includeClose include_close)
+                         MOJOSHADER_includeClose include_close,
+                         MOJOSHADER_includeCache *include_cache)
+{
+    if (!include_open) include_open = MOJOSHADER_internal_include_open;
+    if (!include_close) include_close = MOJOSHADER_internal_include_close;
+
+    Preprocessor *pp = preprocessor_start(filename, source, sourcelen,
+                                          include_open, include_close,
+                                          include_cache, defines,
+                                          define_count, 0,
+                                          MallocBridge, FreeBridge, ctx);
+    if (pp == NULL)
+        assert(ctx->out_of_memory);  // shouldn't fail for any other reason.
+    return pp;
+} // start_preprocessor
+
+// parse the preprocessed source code into an AST.
+static void parse_tokens(Context *ctx, TokenSource *src)
 {
     TokenData data;
     unsigned int tokenlen;
     Token tokenval;
     const char *token;
+    const char *interned;
+    int tokenclass;
     int lemon_token;
-    const char *fname;
-    Preprocessor *pp;
     void *parser;
 
-    if (!include_open) include_open = MOJOSHADER_internal_include_open;
-    if (!include_close) include_close = MOJOSHADER_internal_include_close;
-
-    pp = preprocessor_start(filename, source, sourcelen, include_open,
-                            include_close, defines, define_count, 0,
-                            MallocBridge, FreeBridge, ctx);
-    if (pp == NULL)
-    {
-        assert(ctx->out_of_memory);  // shouldn't fail for any other reason.
-        return;
-    } // if
-
     parser = ParseHLSLAlloc(ctx->malloc, ctx->malloc_data);
     if (parser == NULL)
     {
         assert(ctx->out_of_memory);  // shouldn't fail for any other reason.
-        preprocessor_end(pp);
         return;
     } // if
 
     // !!! FIXME: check if (parser == NULL)...
 
-    init_builtins(ctx);
-
-    SymbolScope *start_scope = ctx->usertypes.scope;
+    const int start_count = ctx->usertypes.count;
+    const int start_depth = ctx->usertypes.depth;
 
     #if DEBUG_COMPILER_PARSER
     ParseHLSLTrace(stdout, "COMPILER: ");
@@ -4433,14 +5182,12 @@ static void parse_source(Context *ctx, const char *filename,
     int is_pragma = 0;   // !!! FIXME: remove this later when we can parse #pragma.
     int skipping = 0; // !!! FIXME: remove this later when we can parse #pragma.
     do {
-        token = preprocessor_nexttoken(pp, &tokenlen, &tokenval);
+        token = next_source_token(ctx, src, &tokenlen, &tokenval,
+                                  &interned, &tokenclass);
 
         if (ctx->out_of_memory)
             break;
 
-        fname = preprocessor_sourcepos(pp, &ctx->sourceline);
-        ctx->sourcefile = fname ? stringcache(ctx->strcache, fname) : 0;
-
         if ((tokenval == TOKEN_HASH) || (tokenval == TOKEN_HASHHASH))
             tokenval = TOKEN_BAD_CHARS;
 
@@ -4478,7 +5225,8 @@ static void parse_source(Context *ctx, const char *filename,
         }
 
         // !!! FIXME: this is a mess, decide who should be doing this stuff, and only do it once.
-        lemon_token = convert_to_lemon_token(ctx, token, tokenlen, tokenval);
+        lemon_token = convert_to_lemon_token(ctx, tokenval, interned,
+                                             tokenclass);
         switch (lemon_token)
         {
             case TOKEN_HLSL_INT_CONSTANT:
@@ -4490,14 +5238,14 @@ static void parse_source(Context *ctx, const char *filename,
                 break;
 
             case TOKEN_HLSL_USERTYPE:
-                data.string = stringcache_len(ctx->strcache, token, tokenlen);
+                data.string = interned;
                 data.datatype = get_usertype(ctx, data.string);  // !!! FIXME: do we need this? It's kind of useless during parsing.
                 assert(data.datatype != NULL);
                 break;
 
             case TOKEN_HLSL_STRING_LITERAL:
             case TOKEN_HLSL_IDENTIFIER:
-                data.string = stringcache_len(ctx->strcache, token, tokenlen);
+                data.string = interned;
                 break;
 
             default:
@@ -4515,1745 +5263,16750 @@ static void parse_source(Context *ctx, const char *filename,
             pop_scope(ctx);
     } while (tokenval != TOKEN_EOI);
 
+    // Hold on to the global structs' dummies: every function that uses one
+    //  of them shares it, so semantic_analysis() fills them in before it
+    //  checks any function bodies, instead of leaving it to reduce_datatype().
+    //  We keep the typedefs, too, so a compile session can parse a function
+    //  again with the same datatypes as the first time.
+    const SymbolMap *map = &ctx->usertypes;
+    int globals = 0;
+    int i;
+    for (i = start_count; i < map->count; i++)
+    {
+        const SymbolScope *item = get_symbol(map, i);
+        globals += ((item->depth == start_depth) && (item->datatype != NULL) &&
+                    (item->datatype->type == MOJOSHADER_AST_DATATYPE_USER));
+    } // for
+
+    if (globals > 0)
+    {
+        const size_t len = sizeof (MOJOSHADER_astDataType *) * globals;
+        ctx->global_usertypes = (MOJOSHADER_astDataType **) ArenaMalloc(ctx, len);
+        for (i = start_count; (ctx->global_usertypes) && (i < map->count); i++)
+        {
+            const SymbolScope *item = get_symbol(map, i);
+            if ((item->depth == start_depth) && (item->datatype != NULL) &&
+                (item->datatype->type == MOJOSHADER_AST_DATATYPE_USER))
+            {
+                // push_usertype() made these in the arena, not const.
+                MOJOSHADER_astDataType *dt = (MOJOSHADER_astDataType *) item->datatype;
+                ctx->global_usertypes[ctx->global_usertype_count++] = dt;
+            } // if
+        } // for
+    } // if
+
     // Clean out extra usertypes; they are dummies until semantic analysis.
-    while (ctx->usertypes.scope != start_scope)
-        pop_symbol(ctx, &ctx->usertypes);
+    //  Unbalanced braces might have left some scopes open, too.
+    ctx->usertypes.depth = start_depth;
+    truncate_symbols(&ctx->usertypes, start_count);
 
     ParseHLSLFree(parser, ctx->free, ctx->malloc_data);
-    preprocessor_end(pp);
-} // parse_source
+} // parse_tokens
 
+// parse the source code into an AST.
+static void parse_source(Context *ctx, const char *filename,
+                         const char *source, unsigned int sourcelen,
+                         const MOJOSHADER_preprocessorDefine *defines,
+                         unsigned int define_count,
+                         MOJOSHADER_includeOpen include_open,
+                         MOJOSHADER_includeClose include_close,
+                         MOJOSHADER_includeCache *include_cache)
+{
+    TokenSource src;
+    memset(&src, '\0', sizeof (src));
+    src.pp = start_preprocessor(ctx, filename, source, sourcelen, defines,
+                                define_count, include_open, include_close,
+                                include_cache);
+    if (src.pp != NULL)
+    {
+        preprocessor_set_token_classes(src.pp, ctx->strcache,
+                                       classify_hlsl_identifier);
+        parse_tokens(ctx, &src);
+        preprocessor_end(src.pp);
+    } // if
+} // parse_source
 
-/* Intermediate representation... */
 
-static inline int generate_ir_label(Context *ctx)
+/* AST cache... */
+
+// MOJOSHADER_compileWithAstCache() records the preprocessor's output and
+//  hashes it. If the cache has a unit with that hash, we load its tree
+//  instead of parsing and checking the source again. Otherwise we parse the
+//  recording, just like we would have parsed the preprocessor's output, and
+//  put the results of semantic analysis in the cache.
+//
+// A unit has no pointers in it: strings, datatypes and AST nodes refer to
+//  each other by index, so units can be saved to disk and loaded into
+//  another process (see MOJOSHADER_saveAstCache()). It's in the saving
+//  machine's byte order, though. A unit is:
+//  - the number of strings, datatypes and AST nodes in it.
+//  - the strings, each a length and that many bytes.
+//  - the datatypes, children before parents.
+//  - the user function and variable index counters.
+//  - the global scope of the usertype and variable symbol maps, newest first.
+//  - the warnings from parsing and semantic analysis.
+//  - the AST, depth first. Nodes are numbered in the order we get to them,
+//    so a node's first appearance has the next number and is followed by
+//    its contents; anything else refers back to a node we already have.
+// Index zero is always NULL.
+
+// Bump this whenever the AST, the datatypes, or what semantic analysis does
+//  to them changes, so saved caches from older builds don't load.
+#define AST_CACHE_VERSION 3
+#define AST_CACHE_MAGIC 0x41534A4D  // "MJSA", in the saver's byte order.
+
+typedef struct AstCacheUnit
 {
-    return ctx->ir_label_count++;
-} // generate_ir_label
+    uint64 key;  // see record_tokens().
+    size_t len;
+    const uint8 *data;
+} AstCacheUnit;
 
-static inline int generate_ir_temp(Context *ctx)
+struct MOJOSHADER_astCache
 {
-    return ctx->ir_temp_count++;
-} // generate_ir_temp
+    Mutex *mutex;
+    HashTable *units;  // AstCacheUnit * by key.
+    MOJOSHADER_malloc malloc;
+    MOJOSHADER_free free;
+    void *malloc_data;
+};
 
-static const LoopLabels *push_ir_loop(Context *ctx, const int isswitch)
+// 64-bit FNV-1a. A cache hit trusts the key, so 32 bits isn't enough.
+#define AST_CACHE_KEY_SEED 0xCBF29CE484222325ULL
+static inline uint64 hash_ast_key(uint64 key, const void *data, size_t len)
 {
-    // !!! FIXME: cache these allocations?
-    LoopLabels *retval = Malloc(ctx, sizeof (LoopLabels));
-    if (retval)
-    {
-        retval->start = (isswitch) ? -1 : generate_ir_label(ctx);
-        retval->end = generate_ir_label(ctx);
-        retval->prev = ctx->ir_loop;
-        ctx->ir_loop = retval;
-    } // if
+    const uint8 *ptr = (const uint8 *) data;
+    while (len--)
+        key = (key ^ *(ptr++)) * 0x100000001B3ULL;
+    return key;
+} // hash_ast_key
+
+// Runs the preprocessor to the end, recording its output in (tape) for
+//  parse_tokens(), and hashing it into (*_key). Where each token came from
+//  is part of the key, since that ends up in the AST (and in errors).
+static void record_tokens(Context *ctx, Preprocessor *pp, Buffer *tape,
+                          uint64 *_key)
+{
+    uint64 key = AST_CACHE_KEY_SEED;
+    const char *prevfname = NULL;
+    const char nul = '\0';
+    const char *token;
+    const char *fname;
+    TapeToken tt;
 
-    return retval;
-} // push_ir_loop
+    memset(&tt, '\0', sizeof (tt));  // no garbage in the padding.
+    do {
+        token = preprocessor_nexttoken(pp, &tt.len, &tt.tokenval);
+        fname = preprocessor_sourcepos(pp, &tt.line);
+        tt.filename = fname ? stringcache(ctx->strcache, fname) : NULL;
+        if (ctx->out_of_memory)
+            break;
 
-static void pop_ir_loop(Context *ctx)
-{
-    assert(ctx->ir_loop != NULL);
-    LoopLabels *labels = ctx->ir_loop;
-    ctx->ir_loop = ctx->ir_loop->prev;
-    Free(ctx, labels);
-} // pop_ir_loop
+        if ((tt.filename != prevfname) || (key == AST_CACHE_KEY_SEED))
+        {
+            const uint8 isnull = (tt.filename == NULL);
+            key = hash_ast_key(key, &isnull, sizeof (isnull));
+            if (!isnull)
+                key = hash_ast_key(key, tt.filename, strlen(tt.filename));
+            prevfname = tt.filename;
+        } // if
 
+        key = hash_ast_key(key, &tt.tokenval, sizeof (tt.tokenval));
+        key = hash_ast_key(key, &tt.line, sizeof (tt.line));
+        key = hash_ast_key(key, &tt.len, sizeof (tt.len));
+        key = hash_ast_key(key, token, tt.len);
 
-#define NEW_IR_NODE(retval, cls, typ) \
-    cls *retval = (cls *) Malloc(ctx, sizeof (cls)); \
-    do { \
-        if (retval == NULL) { return NULL; } \
-        retval->ir.type = typ; \
-        retval->ir.filename = ctx->sourcefile; \
-        retval->ir.line = ctx->sourceline; \
-    } while (0)
+        if ( (!buffer_append(tape, &tt, sizeof (tt))) ||
+             (!buffer_append(tape, token, tt.len)) ||
+             (!buffer_append(tape, &nul, 1)) )
+        {
+            out_of_memory(ctx);
+            break;
+        } // if
+    } while (tt.tokenval != TOKEN_EOI);
 
-#define NEW_IR_EXPR(retval, cls, typ, dt, numelems) \
-    cls *retval = (cls *) Malloc(ctx, sizeof (cls)); \
-    do { \
-        if (retval == NULL) { return NULL; } \
-        retval->info.ir.type = typ; \
-        retval->info.ir.filename = ctx->sourcefile; \
-        retval->info.ir.line = ctx->sourceline; \
-        retval->info.type = dt; \
-        retval->info.elements = numelems; \
-    } while (0)
+    *_key = key;
+} // record_tokens
 
-// syntactic sugar.
-static inline MOJOSHADER_irNode *build_ir(Context *ctx, void *_ast);
-static inline MOJOSHADER_irExpression *build_ir_expr(Context *ctx, void *_ast)
+
+// Serializing goes through the same code in both directions, so the writer
+//  and reader can't disagree about the layout.
+typedef struct AstStream
 {
-    MOJOSHADER_irNode *retval = build_ir(ctx, _ast);
-    assert(!retval || (retval->ir.type > MOJOSHADER_IR_START_RANGE_EXPR));
-    assert(!retval || (retval->ir.type < MOJOSHADER_IR_END_RANGE_EXPR));
-    return (MOJOSHADER_irExpression *) retval;
-} // build_ir_expr
+    Context *ctx;
+    int reading;
+    int isfail;  // out of memory, or (reading) a damaged unit.
+    uint32 string_count;
+    uint32 datatype_count;
+    uint32 node_count;
+
+    // writing...
+    Buffer *strbuf;  // the strings section.
+    Buffer *dtbuf;  // the datatypes section.
+    Buffer *buf;  // everything after that.
+    HashTable *strmap;  // string contents -> index.
+    HashTable *dtmap;  // datatype -> index, or 0 while writing its children.
+    HashTable *nodemap;  // AST node -> index.
+
+    // reading...
+    const uint8 *data;
+    size_t len;
+    size_t pos;
+    const char **strings;
+    const MOJOSHADER_astDataType **datatypes;
+    MOJOSHADER_astNode **nodes;
+    uint32 nodes_read;
+} AstStream;
+
+static uint32 hash_hash_pointer(const void *key, void *data)
+{
+    return stir_datatype_hash(mix_datatype_hash(5381, (size_t) key));
+} // hash_hash_pointer
 
-static inline MOJOSHADER_irStatement *build_ir_stmt(Context *ctx, void *_ast)
+static int hash_keymatch_pointer(const void *a, const void *b, void *data)
 {
-    MOJOSHADER_irNode *retval = build_ir(ctx, _ast);
-    assert(!retval || (retval->ir.type > MOJOSHADER_IR_START_RANGE_STMT));
-    assert(!retval || (retval->ir.type < MOJOSHADER_IR_END_RANGE_STMT));
-    return (MOJOSHADER_irStatement *) retval;
-} // build_ir_stmt
+    return (a == b);
+} // hash_keymatch_pointer
 
+static void stream_nuke(const void *k, const void *v, void *d) {/*no-op*/}
 
-static MOJOSHADER_irExpression *new_ir_binop(Context *ctx,
-                                       const MOJOSHADER_irBinOpType op,
-                                       MOJOSHADER_irExpression *left,
-                                       MOJOSHADER_irExpression *right)
+static void stream_fail(AstStream *s)
 {
-    if ((!left) || (!right)) return NULL;
-    NEW_IR_EXPR(retval, MOJOSHADER_irBinOp, MOJOSHADER_IR_BINOP, left->info.type, left->info.elements);
-    assert(left->info.type == right->info.type);
-    assert(left->info.elements == right->info.elements);
-    retval->op = op;
-    retval->left = left;
-    retval->right = right;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_binop
+    if (!s->reading)
+        out_of_memory(s->ctx);
+    s->isfail = 1;
+} // stream_fail
 
-static MOJOSHADER_irExpression *new_ir_eseq(Context *ctx,
-                                      MOJOSHADER_irStatement *stmt,
-                                      MOJOSHADER_irExpression *expr)
+static void put_bytes(AstStream *s, Buffer *buffer, const void *ptr,
+                      const size_t len)
 {
-    if (!expr) return NULL;
-    NEW_IR_EXPR(retval, MOJOSHADER_irESeq, MOJOSHADER_IR_ESEQ, expr->info.type, expr->info.elements);
-    retval->stmt = stmt;
-    retval->expr = expr;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_eseq
+    if ((!s->isfail) && (!buffer_append(buffer, ptr, len)))
+        stream_fail(s);
+} // put_bytes
 
-static MOJOSHADER_irExpression *new_ir_temp(Context *ctx, const int index,
-                                            const MOJOSHADER_astDataTypeType type,
-                                            const int elements)
+static inline void put_uint32(AstStream *s, Buffer *buffer, const uint32 val)
 {
-    NEW_IR_EXPR(retval, MOJOSHADER_irTemp, MOJOSHADER_IR_TEMP, type, elements);
-    retval->index = index;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_temp
-
-
-
-#define NEW_IR_BINOP(op,l,r) new_ir_binop(ctx, MOJOSHADER_IR_BINOP_##op, l, r)
-#define EASY_IR_BINOP(op) \
-    NEW_IR_BINOP(op, build_ir_expr(ctx, ast->binary.left), \
-                 build_ir_expr(ctx, ast->binary.right))
+    put_bytes(s, buffer, &val, sizeof (val));
+} // put_uint32
 
-// You have to fill in ->value yourself!
-static MOJOSHADER_irExpression *new_ir_constant(Context *ctx,
-                                                const MOJOSHADER_astDataTypeType type,
-                                                const int elements)
+static void stream_bytes(AstStream *s, void *ptr, const size_t len)
 {
-    NEW_IR_EXPR(retval, MOJOSHADER_irConstant, MOJOSHADER_IR_CONSTANT, type, elements);
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_constant
+    if (!s->reading)
+        put_bytes(s, s->buf, ptr, len);
+    else if ((s->isfail) || (len > (s->len - s->pos)))
+    {
+        memset(ptr, '\0', len);
+        s->isfail = 1;
+    } // else if
+    else
+    {
+        memcpy(ptr, s->data + s->pos, len);
+        s->pos += len;
+    } // else
+} // stream_bytes
 
-static MOJOSHADER_irExpression *new_ir_constint(Context *ctx, const int val)
+static inline void stream_uint32(AstStream *s, uint32 *val)
 {
-    NEW_IR_EXPR(retval, MOJOSHADER_irConstant, MOJOSHADER_IR_CONSTANT, MOJOSHADER_AST_DATATYPE_INT, 1);
-    retval->value.ival[0] = val;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_constint
+    stream_bytes(s, val, sizeof (*val));
+} // stream_uint32
 
-static MOJOSHADER_irExpression *new_ir_constfloat(Context *ctx, const float val)
+static inline void stream_int(AstStream *s, int *val)
 {
-    NEW_IR_EXPR(retval, MOJOSHADER_irConstant, MOJOSHADER_IR_CONSTANT, MOJOSHADER_AST_DATATYPE_FLOAT, 1);
-    retval->value.fval[0] = val;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_constfloat
+    stream_bytes(s, val, sizeof (*val));
+} // stream_int
+
+// For enum fields, which might not be an int in size.
+#define STREAM_ENUM(s, field) do { \
+    int streamval = (int) (field); \
+    stream_int(s, &streamval); \
+    (field) = streamval; \
+} while (0)
 
-static MOJOSHADER_irExpression *new_ir_constbool(Context *ctx, const int val)
+// An index into one of the tables, which must be less than (limit) + 1.
+static uint32 read_index(AstStream *s, const uint32 limit)
+{
+    uint32 idx = 0;
+    stream_uint32(s, &idx);
+    if (idx > limit)
+    {
+        s->isfail = 1;
+        idx = 0;
+    } // if
+    return idx;
+} // read_index
+
+// Returns the index of string (str), adding it to the strings section if
+//  it's new.
+static uint32 write_string(AstStream *s, const char *str)
+{
+    const void *value = NULL;
+    if ((str == NULL) || (s->isfail))
+        return 0;
+    else if (hash_find(s->strmap, str, &value))
+        return (uint32) (size_t) value;
+
+    const uint32 len = (uint32) strlen(str);
+    const uint32 idx = ++s->string_count;
+    if (hash_insert(s->strmap, str, (void *) (size_t) idx) != 1)
+        stream_fail(s);
+    put_uint32(s, s->strbuf, len);
+    put_bytes(s, s->strbuf, str, len);
+    return idx;
+} // write_string
+
+static void stream_string(AstStream *s, const char **str)
+{
+    if (s->reading)
+    {
+        const uint32 idx = read_index(s, s->string_count);
+        *str = (idx == 0) ? NULL : s->strings[idx - 1];
+    } // if
+    else
+    {
+        uint32 idx = write_string(s, *str);
+        stream_uint32(s, &idx);
+    } // else
+} // stream_string
+
+// USER datatypes aren't always interned: see push_usertype().
+typedef enum AstUserType
+{
+    AST_USERTYPE_DECLARED,  // made by push_usertype().
+    AST_USERTYPE_INTERNED,  // a copy, with const added or removed.
+    AST_USERTYPE_BUILTIN    // one of builtin_ctx's typedefs.
+} AstUserType;
+
+// Returns the index of datatype (dt), adding it and everything it refers
+//  to to the datatypes section if it's new.
+static uint32 write_datatype(AstStream *s, const MOJOSHADER_astDataType *dt)
+{
+    Context *ctx = s->ctx;
+    const void *value = NULL;
+    uint32 *refs = NULL;
+    uint32 ref_count = 0;
+    uint32 fields[3] = { 0, 0, 0 };
+    uint32 field_count = 0;
+    int i;
+
+    if ((dt == NULL) || (s->isfail))
+        return 0;
+    else if (hash_find(s->dtmap, dt, &value))
+    {
+        if (value == NULL)  // a datatype that contains itself?!
+            stream_fail(s);
+        return (uint32) (size_t) value;
+    } // else if
+    else if (hash_insert(s->dtmap, dt, NULL) != 1)
+    {
+        stream_fail(s);
+        return 0;
+    } // else if
+
+    // write the children first, so the reader always has them already.
+    switch (dt->type & ~MOJOSHADER_AST_DATATYPE_CONST)
+    {
+        case MOJOSHADER_AST_DATATYPE_STRUCT:
+            ref_count = (uint32) dt->structure.member_count * 2;
+            fields[field_count++] = (uint32) dt->structure.member_count;
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_ARRAY:
+        case MOJOSHADER_AST_DATATYPE_VECTOR:
+            fields[field_count++] = write_datatype(s, dt->array.base);
+            fields[field_count++] = (uint32) dt->array.elements;
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_MATRIX:
+            fields[field_count++] = write_datatype(s, dt->matrix.base);
+            fields[field_count++] = (uint32) dt->matrix.rows;
+            fields[field_count++] = (uint32) dt->matrix.columns;
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_BUFFER:
+            fields[field_count++] = write_datatype(s, dt->buffer.base);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_FUNCTION:
+            ref_count = (uint32) dt->function.num_params;
+            fields[field_count++] = write_datatype(s, dt->function.retval);
+            fields[field_count++] = (uint32) dt->function.intrinsic;
+            fields[field_count++] = (uint32) dt->function.num_params;
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_USER:
+        {
+            AstUserType kind = AST_USERTYPE_DECLARED;
+            const SymbolScope *item = NULL;
+            if ((hash_find(builtin_ctx->usertypes.hash, dt->user.name, &value)) &&
+                ((item = (const SymbolScope *) value)->datatype == dt))
+                kind = AST_USERTYPE_BUILTIN;
+            else if ((hash_find(ctx->datatypes, dt, &value)) && (value == dt))
+                kind = AST_USERTYPE_INTERNED;
+            fields[field_count++] = (uint32) kind;
+            fields[field_count++] = write_datatype(s, dt->user.details);
+            fields[field_count++] = write_string(s, dt->user.name);
+            break;
+        } // case
+
+        default:
+            break;  // scalars, samplers, etc: the type is everything.
+    } // switch
+
+    if (ref_count > 0)
+    {
+        refs = (uint32 *) Malloc(ctx, sizeof (uint32) * ref_count);
+        if (refs == NULL)
+            s->isfail = 1;
+        else if ((dt->type & ~MOJOSHADER_AST_DATATYPE_CONST) == MOJOSHADER_AST_DATATYPE_STRUCT)
+        {
+            for (i = 0; i < dt->structure.member_count; i++)
+            {
+                const MOJOSHADER_astDataTypeStructMember *mbr;
+                mbr = &dt->structure.members[i];
+                refs[i * 2] = write_datatype(s, mbr->datatype);
+                refs[i * 2 + 1] = write_string(s, mbr->identifier);
+            } // for
+        } // else if
+        else
+        {
+            for (i = 0; i < dt->function.num_params; i++)
+                refs[i] = write_datatype(s, dt->function.params[i]);
+        } // else
+    } // if
+
+    put_uint32(s, s->dtbuf, (uint32) dt->type);
+    for (i = 0; i < (int) field_count; i++)
+        put_uint32(s, s->dtbuf, fields[i]);
+    if (refs != NULL)
+    {
+        put_bytes(s, s->dtbuf, refs, sizeof (uint32) * ref_count);
+        Free(ctx, refs);
+    } // if
+
+    const uint32 idx = ++s->datatype_count;
+    hash_remove(s->dtmap, dt);
+    if (hash_insert(s->dtmap, dt, (void *) (size_t) idx) != 1)
+        stream_fail(s);
+    return idx;
+} // write_datatype
+
+static void stream_datatype(AstStream *s, const MOJOSHADER_astDataType **dt)
+{
+    if (s->reading)
+    {
+        const uint32 idx = read_index(s, s->datatype_count);
+        *dt = (idx == 0) ? NULL : s->datatypes[idx - 1];
+    } // if
+    else
+    {
+        uint32 idx = write_datatype(s, *dt);
+        stream_uint32(s, &idx);
+    } // else
+} // stream_datatype
+
+// Reads one datatype that write_datatype() wrote. (count) datatypes have
+//  been read so far, and it can only refer to those.
+static const MOJOSHADER_astDataType *read_datatype(AstStream *s,
+                                                   const uint32 count)
+{
+    Context *ctx = s->ctx;
+    MOJOSHADER_astDataType dt;
+    const MOJOSHADER_astDataType **params = NULL;
+    MOJOSHADER_astDataTypeStructMember *members = NULL;
+    const MOJOSHADER_astDataType *retval = NULL;
+    uint32 type = 0;
+    uint32 val = 0;
+    uint32 idx = 0;
+    uint32 i;
+
+    #define READ_DATATYPE(x) do { \
+        idx = read_index(s, count); \
+        x = (idx == 0) ? NULL : s->datatypes[idx - 1]; \
+    } while (0)
+
+    memset(&dt, '\0', sizeof (dt));
+    stream_uint32(s, &type);
+    dt.type = (MOJOSHADER_astDataTypeType) type;
+    switch (type & ~MOJOSHADER_AST_DATATYPE_CONST)
+    {
+        case MOJOSHADER_AST_DATATYPE_STRUCT:
+            stream_uint32(s, &val);
+            if ((s->isfail) || (val > (s->len - s->pos) / (sizeof (uint32) * 2)))
+                break;
+            dt.structure.member_count = (int) val;
+            if (val > 0)
+            {
+                members = (MOJOSHADER_astDataTypeStructMember *) Malloc(ctx, sizeof (*members) * val);
+                if (members == NULL)
+                    break;
+            } // if
+            for (i = 0; i < val; i++)
+            {
+                READ_DATATYPE(members[i].datatype);
+                stream_string(s, &members[i].identifier);
+            } // for
+            dt.structure.members = members;
+            if (!s->isfail)
+                retval = intern_datatype(ctx, &dt);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_ARRAY:
+        case MOJOSHADER_AST_DATATYPE_VECTOR:
+            READ_DATATYPE(dt.array.base);
+            stream_int(s, &dt.array.elements);
+            if (!s->isfail)
+                retval = intern_datatype(ctx, &dt);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_MATRIX:
+            READ_DATATYPE(dt.matrix.base);
+            stream_int(s, &dt.matrix.rows);
+            stream_int(s, &dt.matrix.columns);
+            if (!s->isfail)
+                retval = intern_datatype(ctx, &dt);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_BUFFER:
+            READ_DATATYPE(dt.buffer.base);
+            if (!s->isfail)
+                retval = intern_datatype(ctx, &dt);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_FUNCTION:
+            READ_DATATYPE(dt.function.retval);
+            stream_int(s, &dt.function.intrinsic);
+            stream_uint32(s, &val);
+            if ((s->isfail) || (val > (s->len - s->pos) / sizeof (uint32)))
+                break;
+            dt.function.num_params = (int) val;
+            if (val > 0)
+            {
+                params = (const MOJOSHADER_astDataType **) Malloc(ctx, sizeof (*params) * val);
+                if (params == NULL)
+                    break;
+            } // if
+            for (i = 0; i < val; i++)
+                READ_DATATYPE(params[i]);
+            dt.function.params = params;
+            if (!s->isfail)
+                retval = intern_datatype(ctx, &dt);
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_USER:
+            stream_uint32(s, &val);
+            READ_DATATYPE(dt.user.details);
+            stream_string(s, &dt.user.name);
+            if ((s->isfail) || (dt.user.name == NULL))
+                break;
+            else if (val == AST_USERTYPE_BUILTIN)
+            {
+                const void *value = NULL;
+                if (hash_find(builtin_ctx->usertypes.hash, dt.user.name, &value))
+                    retval = ((const SymbolScope *) value)->datatype;
+            } // else if
+            else if (val == AST_USERTYPE_INTERNED)
+                retval = intern_datatype(ctx, &dt);
+            else if (val == AST_USERTYPE_DECLARED)
+            {
+                MOJOSHADER_astDataType *userdt;
+                userdt = (MOJOSHADER_astDataType *) ArenaMalloc(ctx, sizeof (*userdt));
+                if (userdt != NULL)
+                    memcpy(userdt, &dt, sizeof (dt));
+                retval = userdt;
+            } // else if
+            break;
+
+        default:
+            if ((type & ~MOJOSHADER_AST_DATATYPE_CONST) < MOJOSHADER_AST_DATATYPE_STRUCT)
+                retval = intern_datatype(ctx, &dt);
+            break;
+    } // switch
+
+    #undef READ_DATATYPE
+
+    if (members != NULL)
+        Free(ctx, members);
+    if (params != NULL)
+        Free(ctx, (void *) params);
+    if (retval == NULL)
+        s->isfail = 1;
+    return retval;
+} // read_datatype
+
+static int stream_read_strings(AstStream *s)
+{
+    Context *ctx = s->ctx;
+    uint32 i;
+
+    if (s->string_count > (s->len - s->pos) / sizeof (uint32))
+        return 0;  // can't possibly be this many in here.
+
+    s->strings = (const char **) Malloc(ctx, sizeof (char *) * (s->string_count + 1));
+    if (s->strings == NULL)
+        return 0;
+
+    for (i = 0; (i < s->string_count) && (!s->isfail); i++)
+    {
+        uint32 len = 0;
+        stream_uint32(s, &len);
+        if ((s->isfail) || (len > (s->len - s->pos)))
+            return 0;
+        s->strings[i] = stringcache_len(ctx->strcache,
+                                        (const char *) s->data + s->pos, len);
+        s->pos += len;
+    } // for
+
+    return (!s->isfail) && (!ctx->out_of_memory);
+} // stream_read_strings
+
+static int stream_read_datatypes(AstStream *s)
+{
+    Context *ctx = s->ctx;
+    uint32 i;
+
+    if (s->datatype_count > (s->len - s->pos) / sizeof (uint32))
+        return 0;  // can't possibly be this many in here.
+
+    const size_t len = sizeof (MOJOSHADER_astDataType *) * (s->datatype_count + 1);
+    s->datatypes = (const MOJOSHADER_astDataType **) Malloc(ctx, len);
+    if (s->datatypes == NULL)
+        return 0;
+
+    for (i = 0; (i < s->datatype_count) && (!s->isfail); i++)
+        s->datatypes[i] = read_datatype(s, i);
+
+    return (!s->isfail) && (!ctx->out_of_memory);
+} // stream_read_datatypes
+
+// How big an AST node of type (type) is, or zero if that's not a node type.
+static size_t ast_node_size(const MOJOSHADER_astNodeType type)
+{
+    if (operator_is_unary(type))
+    {
+        if (type == MOJOSHADER_AST_OP_CAST)
+            return sizeof (MOJOSHADER_astExpressionCast);
+        return sizeof (MOJOSHADER_astExpressionUnary);
+    } // if
+    else if (operator_is_binary(type))
+        return sizeof (MOJOSHADER_astExpressionBinary);
+    else if (operator_is_ternary(type))
+        return sizeof (MOJOSHADER_astExpressionTernary);
+
+    switch (type)
+    {
+        case MOJOSHADER_AST_OP_IDENTIFIER:
+            return sizeof (MOJOSHADER_astExpressionIdentifier);
+        case MOJOSHADER_AST_OP_INT_LITERAL:
+            return sizeof (MOJOSHADER_astExpressionIntLiteral);
+        case MOJOSHADER_AST_OP_FLOAT_LITERAL:
+            return sizeof (MOJOSHADER_astExpressionFloatLiteral);
+        case MOJOSHADER_AST_OP_STRING_LITERAL:
+            return sizeof (MOJOSHADER_astExpressionStringLiteral);
+        case MOJOSHADER_AST_OP_BOOLEAN_LITERAL:
+            return sizeof (MOJOSHADER_astExpressionBooleanLiteral);
+        case MOJOSHADER_AST_OP_DEREF_STRUCT:
+            return sizeof (MOJOSHADER_astExpressionDerefStruct);
+        case MOJOSHADER_AST_OP_CALLFUNC:
+            return sizeof (MOJOSHADER_astExpressionCallFunction);
+        case MOJOSHADER_AST_OP_CONSTRUCTOR:
+            return sizeof (MOJOSHADER_astExpressionConstructor);
+        case MOJOSHADER_AST_COMPUNIT_FUNCTION:
+            return sizeof (MOJOSHADER_astCompilationUnitFunction);
+        case MOJOSHADER_AST_COMPUNIT_TYPEDEF:
+            return sizeof (MOJOSHADER_astCompilationUnitTypedef);
+        case MOJOSHADER_AST_COMPUNIT_STRUCT:
+            return sizeof (MOJOSHADER_astCompilationUnitStruct);
+        case MOJOSHADER_AST_COMPUNIT_VARIABLE:
+            return sizeof (MOJOSHADER_astCompilationUnitVariable);
+        case MOJOSHADER_AST_STATEMENT_EMPTY:
+        case MOJOSHADER_AST_STATEMENT_BREAK:
+        case MOJOSHADER_AST_STATEMENT_CONTINUE:
+        case MOJOSHADER_AST_STATEMENT_DISCARD:
+            return sizeof (MOJOSHADER_astStatement);
+        case MOJOSHADER_AST_STATEMENT_BLOCK:
+            return sizeof (MOJOSHADER_astBlockStatement);
+        case MOJOSHADER_AST_STATEMENT_EXPRESSION:
+            return sizeof (MOJOSHADER_astExpressionStatement);
+        case MOJOSHADER_AST_STATEMENT_IF:
+            return sizeof (MOJOSHADER_astIfStatement);
+        case MOJOSHADER_AST_STATEMENT_SWITCH:
+            return sizeof (MOJOSHADER_astSwitchStatement);
+        case MOJOSHADER_AST_STATEMENT_FOR:
+            return sizeof (MOJOSHADER_astForStatement);
+        case MOJOSHADER_AST_STATEMENT_DO:
+            return sizeof (MOJOSHADER_astDoStatement);
+        case MOJOSHADER_AST_STATEMENT_WHILE:
+            return sizeof (MOJOSHADER_astWhileStatement);
+        case MOJOSHADER_AST_STATEMENT_RETURN:
+            return sizeof (MOJOSHADER_astReturnStatement);
+        case MOJOSHADER_AST_STATEMENT_TYPEDEF:
+            return sizeof (MOJOSHADER_astTypedefStatement);
+        case MOJOSHADER_AST_STATEMENT_STRUCT:
+            return sizeof (MOJOSHADER_astStructStatement);
+        case MOJOSHADER_AST_STATEMENT_VARDECL:
+            return sizeof (MOJOSHADER_astVarDeclStatement);
+        case MOJOSHADER_AST_FUNCTION_PARAMS:
+            return sizeof (MOJOSHADER_astFunctionParameters);
+        case MOJOSHADER_AST_FUNCTION_SIGNATURE:
+            return sizeof (MOJOSHADER_astFunctionSignature);
+        case MOJOSHADER_AST_SCALAR_OR_ARRAY:
+            return sizeof (MOJOSHADER_astScalarOrArray);
+        case MOJOSHADER_AST_TYPEDEF:
+            return sizeof (MOJOSHADER_astTypedef);
+        case MOJOSHADER_AST_PACK_OFFSET:
+            return sizeof (MOJOSHADER_astPackOffset);
+        case MOJOSHADER_AST_VARIABLE_LOWLEVEL:
+            return sizeof (MOJOSHADER_astVariableLowLevel);
+        case MOJOSHADER_AST_ANNOTATION:
+            return sizeof (MOJOSHADER_astAnnotations);
+        case MOJOSHADER_AST_VARIABLE_DECLARATION:
+            return sizeof (MOJOSHADER_astVariableDeclaration);
+        case MOJOSHADER_AST_STRUCT_DECLARATION:
+            return sizeof (MOJOSHADER_astStructDeclaration);
+        case MOJOSHADER_AST_STRUCT_MEMBER:
+            return sizeof (MOJOSHADER_astStructMembers);
+        case MOJOSHADER_AST_SWITCH_CASE:
+            return sizeof (MOJOSHADER_astSwitchCases);
+        case MOJOSHADER_AST_ARGUMENTS:
+            return sizeof (MOJOSHADER_astArguments);
+        default:
+            return 0;
+    } // switch
+} // ast_node_size
+
+static void stream_node_fields(AstStream *s, MOJOSHADER_astNode *ast);
+
+// Writes or reads the AST node that (_ptr) points to a pointer to.
+static void stream_node(AstStream *s, void *_ptr)
+{
+    MOJOSHADER_astNode **ptr = (MOJOSHADER_astNode **) _ptr;
+    MOJOSHADER_astNode *ast = *ptr;
+    Context *ctx = s->ctx;
+    const void *value = NULL;
+    uint32 type = 0;
+    uint32 idx = 0;
+
+    if (!s->reading)
+    {
+        int isnew = 0;
+        if ((ast != NULL) && (!s->isfail))
+        {
+            if (hash_find(s->nodemap, ast, &value))
+                idx = (uint32) (size_t) value;
+            else
+            {
+                idx = ++s->node_count;
+                isnew = 1;
+                if (hash_insert(s->nodemap, ast, (void *) (size_t) idx) != 1)
+                    stream_fail(s);
+            } // else
+        } // if
+
+        stream_uint32(s, &idx);
+        if (!isnew)
+            return;
+
+        type = (uint32) ast->ast.type;
+        stream_uint32(s, &type);
+        stream_string(s, &ast->ast.filename);
+        stream_uint32(s, &ast->ast.line);
+        stream_node_fields(s, ast);
+        return;
+    } // if
+
+    *ptr = NULL;
+    idx = read_index(s, s->node_count);
+    if (idx == 0)
+        return;
+    else if (idx <= s->nodes_read)
+    {
+        *ptr = s->nodes[idx - 1];
+        return;
+    } // else if
+    else if (idx != s->nodes_read + 1)
+    {
+        s->isfail = 1;
+        return;
+    } // else if
+
+    stream_uint32(s, &type);
+    const size_t len = ast_node_size((MOJOSHADER_astNodeType) type);
+    if ((len == 0) || (s->isfail))
+    {
+        s->isfail = 1;
+        return;
+    } // if
+
+    ast = (MOJOSHADER_astNode *) ArenaMalloc(ctx, len);
+    if (ast == NULL)
+    {
+        s->isfail = 1;
+        return;
+    } // if
+
+    memset(ast, '\0', len);
+    ast->ast.type = (MOJOSHADER_astNodeType) type;
+    s->nodes[s->nodes_read++] = ast;
+    stream_string(s, &ast->ast.filename);
+    stream_uint32(s, &ast->ast.line);
+    stream_node_fields(s, ast);
+    *ptr = ast;
+} // stream_node
+
+static void stream_node_fields(AstStream *s, MOJOSHADER_astNode *ast)
+{
+    const MOJOSHADER_astNodeType type = ast->ast.type;
+
+    if (s->isfail)
+        return;
+    else if (operator_is_unary(type))
+    {
+        stream_datatype(s, &ast->unary.datatype);
+        stream_node(s, &ast->unary.operand);
+        return;
+    } // else if
+    else if (operator_is_binary(type))
+    {
+        stream_datatype(s, &ast->binary.datatype);
+        stream_node(s, &ast->binary.left);
+        stream_node(s, &ast->binary.right);
+        return;
+    } // else if
+    else if (operator_is_ternary(type))
+    {
+        stream_datatype(s, &ast->ternary.datatype);
+        stream_node(s, &ast->ternary.left);
+        stream_node(s, &ast->ternary.center);
+        stream_node(s, &ast->ternary.right);
+        return;
+    } // else if
+
+    switch (type)
+    {
+        case MOJOSHADER_AST_OP_IDENTIFIER:
+            stream_datatype(s, &ast->identifier.datatype);
+            stream_string(s, &ast->identifier.identifier);
+            stream_int(s, &ast->identifier.index);
+            break;
+
+        case MOJOSHADER_AST_OP_INT_LITERAL:
+            stream_datatype(s, &ast->intliteral.datatype);
+            stream_int(s, &ast->intliteral.value);
+            break;
+
+        case MOJOSHADER_AST_OP_FLOAT_LITERAL:
+            stream_datatype(s, &ast->floatliteral.datatype);
+            stream_bytes(s, &ast->floatliteral.value, sizeof (double));
+            break;
+
+        case MOJOSHADER_AST_OP_STRING_LITERAL:
+            stream_datatype(s, &ast->stringliteral.datatype);
+            stream_string(s, &ast->stringliteral.string);
+            break;
+
+        case MOJOSHADER_AST_OP_BOOLEAN_LITERAL:
+            stream_datatype(s, &ast->boolliteral.datatype);
+            stream_int(s, &ast->boolliteral.value);
+            break;
+
+        case MOJOSHADER_AST_OP_DEREF_STRUCT:
+            stream_datatype(s, &ast->derefstruct.datatype);
+            stream_node(s, &ast->derefstruct.identifier);
+            stream_string(s, &ast->derefstruct.member);
+            stream_int(s, &ast->derefstruct.isswizzle);
+            stream_int(s, &ast->derefstruct.member_index);
+            break;
+
+        case MOJOSHADER_AST_OP_CALLFUNC:
+            stream_datatype(s, &ast->callfunc.datatype);
+            stream_node(s, &ast->callfunc.identifier);
+            stream_node(s, &ast->callfunc.args);
+            break;
+
+        case MOJOSHADER_AST_OP_CONSTRUCTOR:
+            stream_datatype(s, &ast->constructor.datatype);
+            stream_node(s, &ast->constructor.args);
+            break;
+
+        case MOJOSHADER_AST_COMPUNIT_FUNCTION:
+            stream_node(s, &ast->funcunit.declaration);
+            stream_node(s, &ast->funcunit.definition);
+            stream_int(s, &ast->funcunit.index);
+            stream_node(s, &ast->funcunit.next);
+            break;
+
+        case MOJOSHADER_AST_COMPUNIT_TYPEDEF:
+            stream_node(s, &ast->typedefunit.type_info);
+            stream_node(s, &ast->typedefunit.next);
+            break;
+
+        case MOJOSHADER_AST_COMPUNIT_STRUCT:
+            stream_node(s, &ast->structunit.struct_info);
+            stream_node(s, &ast->structunit.next);
+            break;
+
+        case MOJOSHADER_AST_COMPUNIT_VARIABLE:
+            stream_node(s, &ast->varunit.declaration);
+            stream_node(s, &ast->varunit.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_EMPTY:
+        case MOJOSHADER_AST_STATEMENT_BREAK:
+        case MOJOSHADER_AST_STATEMENT_CONTINUE:
+        case MOJOSHADER_AST_STATEMENT_DISCARD:
+            stream_node(s, &ast->stmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_BLOCK:
+            stream_node(s, &ast->blockstmt.statements);
+            stream_node(s, &ast->blockstmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_EXPRESSION:
+            stream_node(s, &ast->exprstmt.expr);
+            stream_node(s, &ast->exprstmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_RETURN:
+            stream_node(s, &ast->returnstmt.expr);
+            stream_node(s, &ast->returnstmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_IF:
+            stream_int(s, &ast->ifstmt.attributes);
+            stream_node(s, &ast->ifstmt.expr);
+            stream_node(s, &ast->ifstmt.statement);
+            stream_node(s, &ast->ifstmt.else_statement);
+            stream_node(s, &ast->ifstmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_SWITCH:
+            stream_int(s, &ast->switchstmt.attributes);
+            stream_node(s, &ast->switchstmt.expr);
+            stream_node(s, &ast->switchstmt.cases);
+            stream_node(s, &ast->switchstmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_FOR:
+            stream_int(s, &ast->forstmt.unroll);
+            stream_node(s, &ast->forstmt.var_decl);
+            stream_node(s, &ast->forstmt.initializer);
+            stream_node(s, &ast->forstmt.looptest);
+            stream_node(s, &ast->forstmt.counter);
+            stream_node(s, &ast->forstmt.statement);
+            stream_node(s, &ast->forstmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_DO:
+        case MOJOSHADER_AST_STATEMENT_WHILE:
+            stream_int(s, &ast->whilestmt.unroll);
+            stream_node(s, &ast->whilestmt.expr);
+            stream_node(s, &ast->whilestmt.statement);
+            stream_node(s, &ast->whilestmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_TYPEDEF:
+            stream_node(s, &ast->typedefstmt.type_info);
+            stream_node(s, &ast->typedefstmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_STRUCT:
+            stream_node(s, &ast->structstmt.struct_info);
+            stream_node(s, &ast->structstmt.next);
+            break;
+
+        case MOJOSHADER_AST_STATEMENT_VARDECL:
+            stream_node(s, &ast->vardeclstmt.declaration);
+            stream_node(s, &ast->vardeclstmt.next);
+            break;
+
+        case MOJOSHADER_AST_FUNCTION_PARAMS:
+            stream_datatype(s, &ast->params.datatype);
+            STREAM_ENUM(s, ast->params.input_modifier);
+            stream_string(s, &ast->params.identifier);
+            stream_string(s, &ast->params.semantic);
+            STREAM_ENUM(s, ast->params.interpolation_modifier);
+            stream_node(s, &ast->params.initializer);
+            stream_int(s, &ast->params.index);
+            stream_node(s, &ast->params.next);
+            break;
+
+        case MOJOSHADER_AST_FUNCTION_SIGNATURE:
+            stream_datatype(s, &ast->funcsig.datatype);
+            stream_string(s, &ast->funcsig.identifier);
+            stream_node(s, &ast->funcsig.params);
+            STREAM_ENUM(s, ast->funcsig.storage_class);
+            stream_string(s, &ast->funcsig.semantic);
+            break;
+
+        case MOJOSHADER_AST_SCALAR_OR_ARRAY:
+            stream_string(s, &ast->soa.identifier);
+            stream_int(s, &ast->soa.isarray);
+            stream_node(s, &ast->soa.dimension);
+            break;
+
+        case MOJOSHADER_AST_TYPEDEF:
+            stream_datatype(s, &ast->typdef.datatype);
+            stream_int(s, &ast->typdef.isconst);
+            stream_node(s, &ast->typdef.details);
+            break;
+
+        case MOJOSHADER_AST_PACK_OFFSET:
+            stream_string(s, &ast->packoffset.ident1);
+            stream_string(s, &ast->packoffset.ident2);
+            break;
+
+        case MOJOSHADER_AST_VARIABLE_LOWLEVEL:
+            stream_node(s, &ast->varlowlevel.packoffset);
+            stream_string(s, &ast->varlowlevel.register_name);
+            break;
+
+        case MOJOSHADER_AST_ANNOTATION:
+            stream_datatype(s, &ast->annotations.datatype);
+            stream_node(s, &ast->annotations.initializer);
+            stream_node(s, &ast->annotations.next);
+            break;
+
+        case MOJOSHADER_AST_VARIABLE_DECLARATION:
+            stream_int(s, &ast->vardecl.attributes);
+            stream_datatype(s, &ast->vardecl.datatype);
+            stream_node(s, &ast->vardecl.anonymous_datatype);
+            stream_node(s, &ast->vardecl.details);
+            stream_string(s, &ast->vardecl.semantic);
+            stream_node(s, &ast->vardecl.annotations);
+            stream_node(s, &ast->vardecl.initializer);
+            stream_node(s, &ast->vardecl.lowlevel);
+            stream_int(s, &ast->vardecl.index);
+            stream_node(s, &ast->vardecl.next);
+            break;
+
+        case MOJOSHADER_AST_STRUCT_DECLARATION:
+            stream_datatype(s, &ast->structdecl.datatype);
+            stream_string(s, &ast->structdecl.name);
+            stream_node(s, &ast->structdecl.members);
+            break;
+
+        case MOJOSHADER_AST_STRUCT_MEMBER:
+            stream_datatype(s, &ast->structmembers.datatype);
+            stream_string(s, &ast->structmembers.semantic);
+            stream_node(s, &ast->structmembers.details);
+            STREAM_ENUM(s, ast->structmembers.interpolation_mod);
+            stream_node(s, &ast->structmembers.next);
+            break;
+
+        case MOJOSHADER_AST_SWITCH_CASE:
+            stream_node(s, &ast->cases.expr);
+            stream_node(s, &ast->cases.statement);
+            stream_node(s, &ast->cases.next);
+            break;
+
+        case MOJOSHADER_AST_ARGUMENTS:
+            stream_node(s, &ast->arguments.argument);
+            stream_node(s, &ast->arguments.next);
+            break;
+
+        default:
+            assert(!s->reading && "unexpected AST node type");
+            s->isfail = 1;
+            break;
+    } // switch
+} // stream_node_fields
+
+// One entry from a symbol map's global scope.
+typedef struct AstSymbol
+{
+    const char *symbol;
+    const MOJOSHADER_astDataType *datatype;
+    int index;
+    int referenced;
+} AstSymbol;
+
+// Everything in a unit after the datatypes. Reading fills this in, and
+//  deserialize_ast() only puts it in the Context once the whole unit
+//  turned out to be sane.
+typedef struct AstUnitBody
+{
+    int user_func_index;
+    int global_var_index;
+    int intrinsic_func_index;
+    uint32 symbol_count[2];  // usertypes, variables.
+    AstSymbol *symbols[2];
+    uint32 warning_count;
+    MOJOSHADER_error *warnings;
+    MOJOSHADER_astNode *ast;
+} AstUnitBody;
+
+// Makes sure (count) items of at least (minsize) bytes each can still be in
+//  the unit, and allocates (count) items of (size) bytes for them.
+static void *stream_read_array(AstStream *s, const uint32 count,
+                               const size_t minsize, const size_t size)
+{
+    void *retval = NULL;
+    if ((s->isfail) || (count > (s->len - s->pos) / minsize))
+        s->isfail = 1;
+    else if (count > 0)
+    {
+        retval = Malloc(s->ctx, size * count);
+        if (retval == NULL)
+            s->isfail = 1;
+        else
+            memset(retval, '\0', size * count);
+    } // else if
+    return retval;
+} // stream_read_array
+
+static void stream_unit_body(AstStream *s, AstUnitBody *body)
+{
+    uint32 i;
+    int j;
+
+    stream_int(s, &body->user_func_index);
+    stream_int(s, &body->global_var_index);
+    stream_int(s, &body->intrinsic_func_index);
+
+    for (j = 0; j < 2; j++)
+    {
+        stream_uint32(s, &body->symbol_count[j]);
+        if (s->reading)
+        {
+            body->symbols[j] = (AstSymbol *) stream_read_array(s,
+                        body->symbol_count[j], sizeof (uint32) * 4,
+                        sizeof (AstSymbol));
+        } // if
+
+        for (i = 0; (i < body->symbol_count[j]) && (!s->isfail); i++)
+        {
+            AstSymbol *sym = &body->symbols[j][i];
+            stream_string(s, &sym->symbol);
+            stream_datatype(s, &sym->datatype);
+            stream_int(s, &sym->index);
+            stream_int(s, &sym->referenced);
+        } // for
+    } // for
+
+    stream_uint32(s, &body->warning_count);
+    if (s->reading)
+    {
+        body->warnings = (MOJOSHADER_error *) stream_read_array(s,
+                    body->warning_count, sizeof (uint32) * 3,
+                    sizeof (MOJOSHADER_error));
+    } // if
+
+    for (i = 0; (i < body->warning_count) && (!s->isfail); i++)
+    {
+        MOJOSHADER_error *warning = &body->warnings[i];
+        stream_string(s, &warning->error);
+        stream_string(s, &warning->filename);
+        stream_int(s, &warning->error_position);
+    } // for
+
+    stream_node(s, &body->ast);
+} // stream_unit_body
+
+// Puts a symbol map's global scope into (*_count) and (*_symbols).
+static int list_symbols(Context *ctx, const SymbolMap *map,
+                        uint32 *_count, AstSymbol **_symbols)
+{
+    AstSymbol *symbols = NULL;
+    uint32 count = (uint32) map->count;
+    int i;
+
+    if (count > 0)
+    {
+        symbols = (AstSymbol *) Malloc(ctx, sizeof (AstSymbol) * count);
+        if (symbols == NULL)
+            return 0;
+    } // if
+
+    // newest first; deserialize_ast() pushes them back oldest first.
+    for (i = map->count - 1, count = 0; i >= 0; i--, count++)
+    {
+        const SymbolScope *item = get_symbol(map, i);
+        symbols[count].symbol = item->symbol;
+        symbols[count].datatype = item->datatype;
+        symbols[count].index = item->index;
+        symbols[count].referenced = item->referenced;
+    } // for
+
+    *_count = count;
+    *_symbols = symbols;
+    return 1;
+} // list_symbols
+
+// Builds a cache unit from a Context that made it through semantic analysis.
+//  Returns NULL if we ran out of memory.
+static AstCacheUnit *serialize_ast(Context *ctx, MOJOSHADER_astCache *cache,
+                                   const uint64 key)
+{
+    MOJOSHADER_malloc m = cache->malloc;
+    MOJOSHADER_free f = cache->free;
+    void *d = cache->malloc_data;
+    AstCacheUnit *retval = NULL;
+    Buffer *buffers[4] = { NULL, NULL, NULL, NULL };
+    AstUnitBody body;
+    AstStream s;
+    int i;
+
+    assert(ctx->ast != NULL);
+    assert(!isfail(ctx));
+
+    memset(&body, '\0', sizeof (body));
+    memset(&s, '\0', sizeof (s));
+    s.ctx = ctx;
+
+    for (i = 0; i < STATICARRAYLEN(buffers); i++)
+    {
+        buffers[i] = buffer_create(4096, m, f, d);
+        if (buffers[i] == NULL)
+            s.isfail = 1;
+    } // for
+
+    s.strbuf = buffers[1];
+    s.dtbuf = buffers[2];
+    s.buf = buffers[3];
+    s.strmap = hash_create(NULL, hash_hash_string, hash_keymatch_string,
+                           stream_nuke, 0, MallocBridge, FreeBridge, ctx);
+    s.dtmap = hash_create(NULL, hash_hash_pointer, hash_keymatch_pointer,
+                          stream_nuke, 0, MallocBridge, FreeBridge, ctx);
+    s.nodemap = hash_create(NULL, hash_hash_pointer, hash_keymatch_pointer,
+                            stream_nuke, 0, MallocBridge, FreeBridge, ctx);
+    if ((!s.strmap) || (!s.dtmap) || (!s.nodemap))
+        s.isfail = 1;
+
+    body.user_func_index = ctx->user_func_index;
+    body.global_var_index = ctx->global_var_index;
+    body.intrinsic_func_index = ctx->intrinsic_func_index;
+    body.ast = ctx->ast;
+    if ( (!list_symbols(ctx, &ctx->usertypes, &body.symbol_count[0], &body.symbols[0])) ||
+         (!list_symbols(ctx, &ctx->variables, &body.symbol_count[1], &body.symbols[1])) )
+        s.isfail = 1;
+
+    // this empties ctx->warnings, so put them back when we're done.
+    body.warning_count = (uint32) errorlist_count(ctx->warnings);
+    body.warnings = errorlist_flatten(ctx->warnings);
+    if ((body.warning_count > 0) && (body.warnings == NULL))
+        s.isfail = 1;
+
+    if (!s.isfail)
+        stream_unit_body(&s, &body);
+
+    if (!s.isfail)
+    {
+        put_uint32(&s, buffers[0], s.string_count);
+        put_uint32(&s, buffers[0], s.datatype_count);
+        put_uint32(&s, buffers[0], s.node_count);
+    } // if
+
+    if (!s.isfail)
+    {
+        retval = (AstCacheUnit *) m(sizeof (AstCacheUnit), d);
+        if (retval != NULL)
+        {
+            size_t len = 0;
+            retval->key = key;
+            retval->data = (const uint8 *) buffer_merge(buffers, 4, &len);
+            retval->len = len;
+            if (retval->data == NULL)
+            {
+                f(retval, d);
+                retval = NULL;
+            } // if
+        } // if
+    } // if
+
+    if (body.warnings != NULL)
+    {
+        for (i = 0; i < (int) body.warning_count; i++)
+        {
+            MOJOSHADER_error *warning = &body.warnings[i];
+            errorlist_add(ctx->warnings, warning->filename,
+                          warning->error_position, warning->error);
+            Free(ctx, (void *) warning->error);
+            Free(ctx, (void *) warning->filename);
+        } // for
+        Free(ctx, body.warnings);
+    } // if
+
+    Free(ctx, body.symbols[0]);
+    Free(ctx, body.symbols[1]);
+    if (s.strmap != NULL)
+        hash_destroy(s.strmap);
+    if (s.dtmap != NULL)
+        hash_destroy(s.dtmap);
+    if (s.nodemap != NULL)
+        hash_destroy(s.nodemap);
+    for (i = 0; i < STATICARRAYLEN(buffers); i++)
+        buffer_destroy(buffers[i]);
+
+    if (retval == NULL)
+        out_of_memory(ctx);
+    return retval;
+} // serialize_ast
+
+// Loads a unit that serialize_ast() built into (ctx), as if we had just
+//  parsed and checked it. Returns zero and leaves the Context's symbols,
+//  warnings and AST alone if the unit is no good.
+static int deserialize_ast(Context *ctx, const uint8 *data, const size_t len)
+{
+    AstUnitBody body;
+    AstStream s;
+    uint32 i;
+    int j;
+
+    memset(&body, '\0', sizeof (body));
+    memset(&s, '\0', sizeof (s));
+    s.ctx = ctx;
+    s.reading = 1;
+    s.data = data;
+    s.len = len;
+
+    stream_uint32(&s, &s.string_count);
+    stream_uint32(&s, &s.datatype_count);
+    stream_uint32(&s, &s.node_count);
+    s.nodes = (MOJOSHADER_astNode **) stream_read_array(&s, s.node_count,
+                        sizeof (uint32) * 3, sizeof (MOJOSHADER_astNode *));
+
+    if ( (!s.isfail) && (stream_read_strings(&s)) &&
+         (stream_read_datatypes(&s)) )
+        stream_unit_body(&s, &body);
+
+    const int retval = ( (!s.isfail) && (!ctx->out_of_memory) &&
+                         (s.pos == s.len) && (body.ast != NULL) );
+    if (retval)
+    {
+        ctx->user_func_index = body.user_func_index;
+        ctx->global_var_index = body.global_var_index;
+        ctx->intrinsic_func_index = body.intrinsic_func_index;
+
+        // these were written newest first, so push them oldest first.
+        for (j = 0; j < 2; j++)
+        {
+            SymbolMap *map = (j == 0) ? &ctx->usertypes : &ctx->variables;
+            for (i = body.symbol_count[j]; i > 0; i--)
+            {
+                const AstSymbol *sym = &body.symbols[j][i - 1];
+                const int count = map->count;
+                push_symbol(ctx, map, sym->symbol, sym->datatype, sym->index, 0);
+                if (map->count > count)
+                    get_symbol(map, count)->referenced = sym->referenced;
+
+                // functions are the only symbols with function datatypes.
+                if ( (j == 1) && (sym->symbol != NULL) &&
+                     (sym->datatype != NULL) &&
+                     (sym->datatype->type == MOJOSHADER_AST_DATATYPE_FUNCTION) )
+                    add_overload(ctx, sym->symbol, sym->datatype, sym->index);
+            } // for
+        } // for
+
+        for (i = 0; i < body.warning_count; i++)
+        {
+            const MOJOSHADER_error *warning = &body.warnings[i];
+            errorlist_add(ctx->warnings, warning->filename,
+                          warning->error_position, warning->error);
+        } // for
+
+        ctx->ast = body.ast;
+    } // if
+
+    Free(ctx, (void *) s.strings);
+    Free(ctx, (void *) s.datatypes);
+    Free(ctx, s.nodes);
+    Free(ctx, body.symbols[0]);
+    Free(ctx, body.symbols[1]);
+    Free(ctx, body.warnings);
+    return retval;
+} // deserialize_ast
+
+static uint32 hash_hash_astcache_unit(const void *key, void *data)
+{
+    const uint64 val = ((const AstCacheUnit *) key)->key;
+    return (uint32) (val ^ (val >> 32));
+} // hash_hash_astcache_unit
+
+static int hash_keymatch_astcache_unit(const void *a, const void *b, void *data)
+{
+    return ( ((const AstCacheUnit *) a)->key ==
+             ((const AstCacheUnit *) b)->key );
+} // hash_keymatch_astcache_unit
+
+static void astcache_nuke_unit(const void *key, const void *value, void *data)
+{
+    MOJOSHADER_astCache *cache = (MOJOSHADER_astCache *) data;
+    AstCacheUnit *unit = (AstCacheUnit *) value;
+    cache->free((void *) unit->data, cache->malloc_data);
+    cache->free(unit, cache->malloc_data);
+} // astcache_nuke_unit
+
+MOJOSHADER_astCache *MOJOSHADER_createAstCache(MOJOSHADER_malloc m,
+                                               MOJOSHADER_free f, void *d)
+{
+    if (!m) m = MOJOSHADER_internal_malloc;
+    if (!f) f = MOJOSHADER_internal_free;
+
+    MOJOSHADER_astCache *cache;
+    cache = (MOJOSHADER_astCache *) m(sizeof (*cache), d);
+    if (cache == NULL)
+        return NULL;
+
+    memset(cache, '\0', sizeof (*cache));
+    cache->malloc = m;
+    cache->free = f;
+    cache->malloc_data = d;
+
+    cache->mutex = mutex_create(m, f, d);
+    cache->units = hash_create(cache, hash_hash_astcache_unit,
+                               hash_keymatch_astcache_unit,
+                               astcache_nuke_unit, 0, m, f, d);
+
+    if ((!cache->mutex) || (!cache->units))
+    {
+        MOJOSHADER_destroyAstCache(cache);
+        return NULL;
+    } // if
+
+    return cache;
+} // MOJOSHADER_createAstCache
+
+void MOJOSHADER_destroyAstCache(MOJOSHADER_astCache *cache)
+{
+    if (cache == NULL)
+        return;
+
+    if (cache->units != NULL)
+        hash_destroy(cache->units);
+    mutex_destroy(cache->mutex);
+    cache->free(cache, cache->malloc_data);
+} // MOJOSHADER_destroyAstCache
+
+// Units are never replaced or removed once they're in the cache, so a
+//  unit we found stays valid without holding the lock. Returns non-zero
+//  if (unit) is in the cache now; otherwise the caller still owns it.
+static int astcache_insert(MOJOSHADER_astCache *cache, AstCacheUnit *unit)
+{
+    mutex_lock(cache->mutex);
+    const int rc = hash_insert(cache->units, unit, unit);
+    mutex_unlock(cache->mutex);
+    return (rc == 1);
+} // astcache_insert
+
+static const AstCacheUnit *astcache_find(MOJOSHADER_astCache *cache,
+                                         const uint64 key)
+{
+    const void *value = NULL;
+    AstCacheUnit unit;
+    unit.key = key;
+    mutex_lock(cache->mutex);
+    if (!hash_find(cache->units, &unit, &value))
+        value = NULL;
+    mutex_unlock(cache->mutex);
+    return (const AstCacheUnit *) value;
+} // astcache_find
+
+// A saved cache is AST_CACHE_MAGIC, AST_CACHE_VERSION and the number of
+//  units, then each unit's 64-bit key, length, checksum and bytes. The
+//  checksum catches a damaged file; the bounds checks in deserialize_ast()
+//  alone would happily load a unit with a flipped bit in some index.
+void *MOJOSHADER_saveAstCache(MOJOSHADER_astCache *cache, unsigned int *_len)
+{
+    const uint32 header[3] = { AST_CACHE_MAGIC, AST_CACHE_VERSION, 0 };
+    Buffer *buffer = buffer_create(64 * 1024, cache->malloc, cache->free,
+                                   cache->malloc_data);
+    const void *key = NULL;
+    void *iter = NULL;
+    uint32 count = 0;
+    char *retval = NULL;
+    int okay = (buffer != NULL);
+
+    *_len = 0;
+    if (!okay)
+        return NULL;
+
+    mutex_lock(cache->mutex);
+    okay = buffer_append(buffer, header, sizeof (header));
+    while ((okay) && (hash_iter_keys(cache->units, &key, &iter)))
+    {
+        const AstCacheUnit *unit = (const AstCacheUnit *) key;
+        const uint32 len = (uint32) unit->len;
+        const uint64 check = hash_ast_key(AST_CACHE_KEY_SEED, unit->data, unit->len);
+        okay = ( (unit->len <= 0xFFFFFFFF) &&
+                 (buffer_append(buffer, &unit->key, sizeof (unit->key))) &&
+                 (buffer_append(buffer, &len, sizeof (len))) &&
+                 (buffer_append(buffer, &check, sizeof (check))) &&
+                 (buffer_append(buffer, unit->data, unit->len)) );
+        count++;
+    } // while
+    mutex_unlock(cache->mutex);
+
+    const size_t len = buffer_size(buffer);
+    if ((okay) && (len <= 0xFFFFFFFF))
+    {
+        retval = buffer_flatten(buffer);
+        if (retval != NULL)
+        {
+            memcpy(retval + (sizeof (uint32) * 2), &count, sizeof (count));
+            *_len = (unsigned int) len;
+        } // if
+    } // if
+
+    buffer_destroy(buffer);
+    return retval;
+} // MOJOSHADER_saveAstCache
+
+int MOJOSHADER_loadAstCache(MOJOSHADER_astCache *cache, const void *_data,
+                            unsigned int len)
+{
+    const uint8 *data = (const uint8 *) _data;
+    const size_t unithdrlen = sizeof (uint64) + sizeof (uint32) + sizeof (uint64);
+    uint32 header[3];
+    size_t pos = sizeof (header);
+    uint32 i;
+    int retval = 0;
+
+    if ((data == NULL) || (len < sizeof (header)))
+        return -1;
+
+    memcpy(header, data, sizeof (header));
+    if ((header[0] != AST_CACHE_MAGIC) || (header[1] != AST_CACHE_VERSION))
+        return -1;
+
+    // check the whole thing first, so we don't add half of a bad file.
+    for (i = 0; i < header[2]; i++)
+    {
+        uint32 unitlen = 0;
+        uint64 check = 0;
+        if ((len - pos) < unithdrlen)
+            return -1;
+        memcpy(&unitlen, data + pos + sizeof (uint64), sizeof (unitlen));
+        memcpy(&check, data + pos + sizeof (uint64) + sizeof (uint32), sizeof (check));
+        pos += unithdrlen;
+        if ((len - pos) < unitlen)
+            return -1;
+        else if (hash_ast_key(AST_CACHE_KEY_SEED, data + pos, unitlen) != check)
+            return -1;
+        pos += unitlen;
+    } // for
+
+    if (pos != len)
+        return -1;
+
+    pos = sizeof (header);
+    for (i = 0; i < header[2]; i++)
+    {
+        AstCacheUnit *unit;
+        uint8 *unitdata;
+        uint32 unitlen = 0;
+
+        unit = (AstCacheUnit *) cache->malloc(sizeof (*unit), cache->malloc_data);
+        if (unit == NULL)
+            return -1;
+
+        memcpy(&unit->key, data + pos, sizeof (uint64));
+        memcpy(&unitlen, data + pos + sizeof (uint64), sizeof (unitlen));
+        pos += unithdrlen;
+
+        unitdata = (uint8 *) cache->malloc(unitlen + 1, cache->malloc_data);
+        if (unitdata == NULL)
+        {
+            cache->free(unit, cache->malloc_data);
+            return -1;
+        } // if
+
+        memcpy(unitdata, data + pos, unitlen);
+        pos += unitlen;
+        unit->data = unitdata;
+        unit->len = unitlen;
+
+        if (astcache_insert(cache, unit))
+            retval++;
+        else  // already had it (or out of memory).
+            astcache_nuke_unit(NULL, unit, cache);
+    } // for
+
+    return retval;
+} // MOJOSHADER_loadAstCache
+
+// Runs the preprocessor over the source, and hands back a tape of its
+//  output for parse_tokens(), plus the tape's key; see record_tokens().
+static char *record_source(Context *ctx, const char *filename,
+                           const char *source, unsigned int sourcelen,
+                           const MOJOSHADER_preprocessorDefine *defines,
+                           unsigned int define_count,
+                           MOJOSHADER_includeOpen include_open,
+                           MOJOSHADER_includeClose include_close,
+                           MOJOSHADER_includeCache *include_cache,
+                           size_t *_len, uint64 *_key)
+{
+    Preprocessor *pp = NULL;
+    Buffer *tape = NULL;
+    char *retval = NULL;
+
+    pp = start_preprocessor(ctx, filename, source, sourcelen, defines,
+                            define_count, include_open, include_close,
+                            include_cache);
+    if (pp == NULL)
+        return NULL;
+
+    tape = buffer_create(16 * 1024, MallocBridge, FreeBridge, ctx);
+    if (tape == NULL)
+    {
+        preprocessor_end(pp);
+        return NULL;
+    } // if
+
+    record_tokens(ctx, pp, tape, _key);
+    preprocessor_end(pp);
+
+    *_len = buffer_size(tape);
+    retval = buffer_flatten(tape);
+    buffer_destroy(tape);
+    if (ctx->out_of_memory)
+    {
+        Free(ctx, retval);
+        return NULL;
+    } // if
+
+    return retval;
+} // record_source
+
+// parse_source() and semantic_analysis(), unless (cache) already has the
+//  results for what the preprocessor gives us.
+static void parse_source_cached(Context *ctx, MOJOSHADER_astCache *cache,
+                         const char *filename,
+                         const char *source, unsigned int sourcelen,
+                         const MOJOSHADER_preprocessorDefine *defines,
+                         unsigned int define_count,
+                         MOJOSHADER_includeOpen include_open,
+                         MOJOSHADER_includeClose include_close,
+                         MOJOSHADER_includeCache *include_cache)
+{
+    const AstCacheUnit *found = NULL;
+    TokenSource src;
+    uint64 key = 0;
+
+    memset(&src, '\0', sizeof (src));
+    src.tape = record_source(ctx, filename, source, sourcelen, defines,
+                             define_count, include_open, include_close,
+                             include_cache, &src.tapelen, &key);
+    if (src.tape == NULL)
+        return;
+
+    found = astcache_find(cache, key);
+    if ((found != NULL) && (deserialize_ast(ctx, found->data, found->len)))
+    {
+        Free(ctx, (void *) src.tape);
+        return;
+    } // if
+
+    parse_tokens(ctx, &src);
+    Free(ctx, (void *) src.tape);
+
+    if (!isfail(ctx))
+        semantic_analysis(ctx);
+
+    // only cache things that worked; failures are cheap to find again.
+    if ((!isfail(ctx)) && (found == NULL))
+    {
+        AstCacheUnit *unit = serialize_ast(ctx, cache, key);
+        if ((unit != NULL) && (!astcache_insert(cache, unit)))
+            astcache_nuke_unit(NULL, unit, cache);
+    } // if
+} // parse_source_cached
+
+
+/* Intermediate representation... */
+
+static inline int generate_ir_label(Context *ctx)
+{
+    return ctx->ir_label_count++;
+} // generate_ir_label
+
+static inline int generate_ir_temp(Context *ctx)
+{
+    return ctx->ir_temp_count++;
+} // generate_ir_temp
+
+static const LoopLabels *push_ir_loop(Context *ctx, const int isswitch)
+{
+    // !!! FIXME: cache these allocations?
+    LoopLabels *retval = Malloc(ctx, sizeof (LoopLabels));
+    if (retval)
+    {
+        retval->start = (isswitch) ? -1 : generate_ir_label(ctx);
+        retval->end = generate_ir_label(ctx);
+        retval->prev = ctx->ir_loop;
+        ctx->ir_loop = retval;
+    } // if
+
+    return retval;
+} // push_ir_loop
+
+static void pop_ir_loop(Context *ctx)
+{
+    assert(ctx->ir_loop != NULL);
+    LoopLabels *labels = ctx->ir_loop;
+    ctx->ir_loop = ctx->ir_loop->prev;
+    Free(ctx, labels);
+} // pop_ir_loop
+
+
+#define NEW_IR_NODE(retval, cls, typ) \
+    cls *retval = (cls *) Malloc(ctx, sizeof (cls)); \
+    do { \
+        if (retval == NULL) { return NULL; } \
+        retval->ir.type = typ; \
+        retval->ir.filename = ctx->sourcefile; \
+        retval->ir.line = ctx->sourceline; \
+    } while (0)
+
+#define NEW_IR_EXPR(retval, cls, typ, dt, numelems) \
+    cls *retval = (cls *) Malloc(ctx, sizeof (cls)); \
+    do { \
+        if (retval == NULL) { return NULL; } \
+        retval->info.ir.type = typ; \
+        retval->info.ir.filename = ctx->sourcefile; \
+        retval->info.ir.line = ctx->sourceline; \
+        retval->info.type = dt; \
+        retval->info.elements = numelems; \
+    } while (0)
+
+// syntactic sugar.
+static inline MOJOSHADER_irNode *build_ir(Context *ctx, void *_ast);
+static inline MOJOSHADER_irExpression *build_ir_expr(Context *ctx, void *_ast)
+{
+    MOJOSHADER_irNode *retval = build_ir(ctx, _ast);
+    assert(!retval || (retval->ir.type > MOJOSHADER_IR_START_RANGE_EXPR));
+    assert(!retval || (retval->ir.type < MOJOSHADER_IR_END_RANGE_EXPR));
+    return (MOJOSHADER_irExpression *) retval;
+} // build_ir_expr
+
+static inline MOJOSHADER_irStatement *build_ir_stmt(Context *ctx, void *_ast)
+{
+    MOJOSHADER_irNode *retval = build_ir(ctx, _ast);
+    assert(!retval || (retval->ir.type > MOJOSHADER_IR_START_RANGE_STMT));
+    assert(!retval || (retval->ir.type < MOJOSHADER_IR_END_RANGE_STMT));
+    return (MOJOSHADER_irStatement *) retval;
+} // build_ir_stmt
+
+
+static MOJOSHADER_irExpression *new_ir_binop(Context *ctx,
+                                       const MOJOSHADER_irBinOpType op,
+                                       MOJOSHADER_irExpression *left,
+                                       MOJOSHADER_irExpression *right)
+{
+    if ((!left) || (!right)) return NULL;
+    NEW_IR_EXPR(retval, MOJOSHADER_irBinOp, MOJOSHADER_IR_BINOP, left->info.type, left->info.elements);
+    assert(left->info.type == right->info.type);
+    assert(left->info.elements == right->info.elements);
+    retval->op = op;
+    retval->left = left;
+    retval->right = right;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_binop
+
+static MOJOSHADER_irExpression *new_ir_eseq(Context *ctx,
+                                      MOJOSHADER_irStatement *stmt,
+                                      MOJOSHADER_irExpression *expr)
+{
+    if (!expr) return NULL;
+    NEW_IR_EXPR(retval, MOJOSHADER_irESeq, MOJOSHADER_IR_ESEQ, expr->info.type, expr->info.elements);
+    retval->stmt = stmt;
+    retval->expr = expr;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_eseq
+
+static MOJOSHADER_irExpression *new_ir_temp(Context *ctx, const int index,
+                                            const MOJOSHADER_astDataTypeType type,
+                                            const int elements)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irTemp, MOJOSHADER_IR_TEMP, type, elements);
+    retval->index = index;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_temp
+
+
+
+#define NEW_IR_BINOP(op,l,r) new_ir_binop(ctx, MOJOSHADER_IR_BINOP_##op, l, r)
+#define EASY_IR_BINOP(op) \
+    NEW_IR_BINOP(op, build_ir_expr(ctx, ast->binary.left), \
+                 build_ir_expr(ctx, ast->binary.right))
+
+// You have to fill in ->value yourself!
+static MOJOSHADER_irExpression *new_ir_constant(Context *ctx,
+                                                const MOJOSHADER_astDataTypeType type,
+                                                const int elements)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irConstant, MOJOSHADER_IR_CONSTANT, type, elements);
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_constant
+
+static MOJOSHADER_irExpression *new_ir_constint(Context *ctx, const int val)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irConstant, MOJOSHADER_IR_CONSTANT, MOJOSHADER_AST_DATATYPE_INT, 1);
+    retval->value.ival[0] = val;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_constint
+
+static MOJOSHADER_irExpression *new_ir_constfloat(Context *ctx, const float val)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irConstant, MOJOSHADER_IR_CONSTANT, MOJOSHADER_AST_DATATYPE_FLOAT, 1);
+    retval->value.fval[0] = val;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_constfloat
+
+static MOJOSHADER_irExpression *new_ir_constbool(Context *ctx, const int val)
 {
     // !!! FIXME: cache true and false in (ctx), ignore in delete_ir().
     NEW_IR_EXPR(retval, MOJOSHADER_irConstant, MOJOSHADER_IR_CONSTANT, MOJOSHADER_AST_DATATYPE_BOOL, 1);
     retval->value.ival[0] = val;
     return (MOJOSHADER_irExpression *) retval;
-} // new_ir_constbool
+} // new_ir_constbool
+
+static MOJOSHADER_irExpression *new_ir_convert(Context *ctx, MOJOSHADER_irExpression *expr,
+                                               const MOJOSHADER_astDataTypeType type,
+                                               const int elements, const int columns)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irConvert, MOJOSHADER_IR_CONVERT, type, elements);
+    retval->expr = expr;
+    retval->columns = columns;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_convert
+
+static MOJOSHADER_irExpression *new_ir_construct(Context *ctx, MOJOSHADER_irExprList *args,
+                                               const MOJOSHADER_astDataTypeType type,
+                                               const int elements)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irConstruct, MOJOSHADER_IR_CONSTRUCT, type, elements);
+    retval->args = args;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_construct
+
+static MOJOSHADER_irExpression *new_ir_call(Context *ctx, const int index,
+                                            MOJOSHADER_irExprList *args,
+                                            const MOJOSHADER_astDataTypeType type,
+                                            const int elements)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irCall, MOJOSHADER_IR_CALL, type, elements);
+    retval->args = args;
+    retval->index = index;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_call
+
+static MOJOSHADER_irExpression *new_ir_swizzle(Context *ctx,
+                                               MOJOSHADER_irExpression *expr,
+                                               const char *channels,
+                                               const MOJOSHADER_astDataTypeType type,
+                                               const int elements)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irSwizzle, MOJOSHADER_IR_SWIZZLE, type, elements);
+    retval->expr = expr;
+    memcpy(retval->channels, channels, sizeof (retval->channels));
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_swizzle
+
+static MOJOSHADER_irExpression *new_ir_memory(Context *ctx, const int index,
+                                              const MOJOSHADER_astDataTypeType type,
+                                              const int elements)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irMemory, MOJOSHADER_IR_MEMORY, type, elements);
+    retval->index = index;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_memory
+
+static MOJOSHADER_irExpression *new_ir_array(Context *ctx,
+                                             MOJOSHADER_irExpression *array,
+                                             MOJOSHADER_irExpression *element,
+                                             const MOJOSHADER_astDataTypeType type,
+                                             const int elements)
+{
+    NEW_IR_EXPR(retval, MOJOSHADER_irArray, MOJOSHADER_IR_ARRAY, type, elements);
+    retval->array = array;
+    retval->element = element;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_array
+
+static MOJOSHADER_irExpression *new_ir_select(Context *ctx,
+                                              MOJOSHADER_irExpression *cond,
+                                              MOJOSHADER_irExpression *iftrue,
+                                              MOJOSHADER_irExpression *iffalse)
+{
+    if ((!cond) || (!iftrue) || (!iffalse)) return NULL;
+    NEW_IR_EXPR(retval, MOJOSHADER_irSelect, MOJOSHADER_IR_SELECT, iftrue->info.type, iftrue->info.elements);
+    assert(cond->info.type == MOJOSHADER_AST_DATATYPE_BOOL);
+    assert(cond->info.elements == 1);
+    assert(iftrue->info.type == iffalse->info.type);
+    assert(iftrue->info.elements == iffalse->info.elements);
+    retval->cond = cond;
+    retval->iftrue = iftrue;
+    retval->iffalse = iffalse;
+    return (MOJOSHADER_irExpression *) retval;
+} // new_ir_select
+
+static MOJOSHADER_irStatement *new_ir_seq(Context *ctx,
+                                     MOJOSHADER_irStatement *first,
+                                     MOJOSHADER_irStatement *next)
+{
+    // either can be NULL (an uninitialized variable, an empty block...).
+    if (first == NULL)  // don't generate a SEQ if unnecessary.
+        return next;
+    else if (next == NULL)
+        return first;
+
+    NEW_IR_NODE(retval, MOJOSHADER_irSeq, MOJOSHADER_IR_SEQ);
+    retval->first = first;
+    retval->next = next;
+    return (MOJOSHADER_irStatement *) retval;
+} // new_ir_seq
+
+static MOJOSHADER_irStatement *new_ir_jump(Context *ctx, const int label)
+{
+    NEW_IR_NODE(retval, MOJOSHADER_irJump, MOJOSHADER_IR_JUMP);
+    retval->label = label;
+    return (MOJOSHADER_irStatement *) retval;
+} // new_ir_jump
+
+static MOJOSHADER_irStatement *new_ir_cjump(Context *ctx,
+                                       const MOJOSHADER_irConditionType cond,
+                                       MOJOSHADER_irExpression *left,
+                                       MOJOSHADER_irExpression *right,
+                                       const int iftrue, const int iffalse)
+{
+    NEW_IR_NODE(retval, MOJOSHADER_irCJump, MOJOSHADER_IR_CJUMP);
+    retval->cond = cond;
+    retval->left = left;
+    retval->right = right;
+    retval->iftrue = iftrue;
+    retval->iffalse = iffalse;
+    retval->branch = 0;
+    return (MOJOSHADER_irStatement *) retval;
+} // new_ir_cjump
+
+static MOJOSHADER_irStatement *new_ir_label(Context *ctx, const int index)
+{
+    NEW_IR_NODE(retval, MOJOSHADER_irLabel, MOJOSHADER_IR_LABEL);
+    retval->index = index;
+    return (MOJOSHADER_irStatement *) retval;
+} // new_ir_label
+
+static MOJOSHADER_irStatement *new_ir_move(Context *ctx,
+                                      MOJOSHADER_irExpression *dst,
+                                      MOJOSHADER_irExpression *src,
+                                      const int writemask)
+{
+    NEW_IR_NODE(retval, MOJOSHADER_irMove, MOJOSHADER_IR_MOVE);
+    assert(dst && src && (dst->info.type == src->info.type));
+    assert(dst && src && (dst->info.elements == src->info.elements));
+    retval->dst = dst;
+    retval->src = src;
+    retval->writemask = writemask;
+    return (MOJOSHADER_irStatement *) retval;
+} // new_ir_move
+
+static MOJOSHADER_irStatement *new_ir_expr_stmt(Context *ctx, MOJOSHADER_irExpression *expr)
+{
+    NEW_IR_NODE(retval, MOJOSHADER_irExprStmt, MOJOSHADER_IR_EXPR_STMT);
+    retval->expr = expr;
+    return (MOJOSHADER_irStatement *) retval;
+} // new_ir_expr_stmt
+
+static MOJOSHADER_irStatement *new_ir_discard(Context *ctx)
+{
+    NEW_IR_NODE(retval, MOJOSHADER_irDiscard, MOJOSHADER_IR_DISCARD);
+    return (MOJOSHADER_irStatement *) retval;
+} // new_ir_discard
+
+static MOJOSHADER_irExprList *new_ir_exprlist(Context *ctx, MOJOSHADER_irExpression *expr)
+{
+    NEW_IR_NODE(retval, MOJOSHADER_irExprList, MOJOSHADER_IR_EXPRLIST);
+    retval->expr = expr;
+    retval->next = NULL;
+    return (MOJOSHADER_irExprList *) retval;
+} // new_ir_exprlist
+
+
+// This handles most comparison operators (less-than, equals, etc...)
+static MOJOSHADER_irExpression *build_ir_compare(Context *ctx,
+                                    const MOJOSHADER_irConditionType operation,
+                                    MOJOSHADER_irExpression *left,
+                                    MOJOSHADER_irExpression *right,
+                                    MOJOSHADER_irExpression *tval,
+                                    MOJOSHADER_irExpression *fval)
+{
+    /* The gist...
+            cjump x < y, t, f  // '<' is whatever operation
+        t:
+            move tmp, tval
+            jump join
+        f:
+            move tmp, fval
+        join:
+    */
+
+    const int t = generate_ir_label(ctx);
+    const int f = generate_ir_label(ctx);
+    const int join = generate_ir_label(ctx);
+    const int tmp = generate_ir_temp(ctx);
+
+    assert(tval && fval && (tval->info.type == fval->info.type));
+    assert(tval && fval && (tval->info.elements == fval->info.elements));
+
+    const MOJOSHADER_astDataTypeType dt = tval->info.type;
+    const int elements = tval->info.elements;
+
+    return new_ir_eseq(ctx,
+                new_ir_seq(ctx, new_ir_cjump(ctx, operation, left, right, t, f),
+                new_ir_seq(ctx, new_ir_label(ctx, t),
+                new_ir_seq(ctx, new_ir_move(ctx, new_ir_temp(ctx, tmp, dt, elements), tval, -1),
+                new_ir_seq(ctx, new_ir_jump(ctx, join),
+                new_ir_seq(ctx, new_ir_label(ctx, f),
+                new_ir_seq(ctx, new_ir_move(ctx, new_ir_temp(ctx, tmp, dt, elements), fval, -1),
+                                new_ir_label(ctx, join))))))),
+                    new_ir_temp(ctx, tmp, dt, elements));
+} // build_ir_compare
+
+#define EASY_IR_COMPARE(op) \
+    build_ir_compare(ctx, MOJOSHADER_IR_COND_##op, \
+                   build_ir_expr(ctx, ast->binary.left), \
+                   build_ir_expr(ctx, ast->binary.right), \
+                   new_ir_constbool(ctx, 1), \
+                   new_ir_constbool(ctx, 0))
+
+
+// This handles && and || operators.
+static MOJOSHADER_irExpression *build_ir_logical_and_or(Context *ctx,
+                                    const MOJOSHADER_astExpressionBinary *ast,
+                                    const int left_testval)
+{
+    /* The gist...
+            cjump left == left_testval, maybe, f
+        maybe:
+            cjump right == true, t, f
+        t:
+            move tmp, 1
+            jump join
+        f:
+            move tmp, 0
+        join:
+    */
+
+    assert(ast->left->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+    assert(ast->right->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+
+    const int t = generate_ir_label(ctx);
+    const int f = generate_ir_label(ctx);
+    const int maybe = generate_ir_label(ctx);
+    const int join = generate_ir_label(ctx);
+    const int tmp = generate_ir_temp(ctx);
+
+    return new_ir_eseq(ctx,
+                new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->left), new_ir_constbool(ctx, left_testval), maybe, f),
+                new_ir_seq(ctx, new_ir_label(ctx, maybe),
+                new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->right), new_ir_constbool(ctx, 1), t, f),
+                new_ir_seq(ctx, new_ir_label(ctx, t),
+                new_ir_seq(ctx, new_ir_move(ctx, new_ir_temp(ctx, tmp, MOJOSHADER_AST_DATATYPE_BOOL, 1), new_ir_constbool(ctx, 1), -1),
+                new_ir_seq(ctx, new_ir_jump(ctx, join),
+                new_ir_seq(ctx, new_ir_label(ctx, f),
+                new_ir_seq(ctx, new_ir_move(ctx, new_ir_temp(ctx, tmp, MOJOSHADER_AST_DATATYPE_BOOL, 1), new_ir_constbool(ctx, 0), -1),
+                                new_ir_label(ctx, join))))))))),
+                    new_ir_temp(ctx, tmp, MOJOSHADER_AST_DATATYPE_BOOL, 1));
+} // build_ir_logical_and_or
+
+static inline MOJOSHADER_irExpression *build_ir_logical_and(Context *ctx,
+                                    const MOJOSHADER_astExpressionBinary *ast)
+{
+    // this needs to not evaluate (right) if (left) is false!
+    return build_ir_logical_and_or(ctx, ast, 1);
+} // build_ir_logical_and
+
+static inline MOJOSHADER_irExpression *build_ir_logical_or(Context *ctx,
+                                    const MOJOSHADER_astExpressionBinary *ast)
+{
+    // this needs to not evaluate (right) if (left) is true!
+    return build_ir_logical_and_or(ctx, ast, 0);
+} // build_ir_logical_or
+
+static inline MOJOSHADER_irStatement *build_ir_no_op(Context *ctx)
+{
+    return new_ir_label(ctx, generate_ir_label(ctx));
+} // build_ir_no_op
+
+static MOJOSHADER_irExpression *copy_ir_lvalue(Context *ctx,
+                                        const MOJOSHADER_irExpression *expr);
+static MOJOSHADER_irExpression *ir_dest_base(MOJOSHADER_irExpression *dst);
+static MOJOSHADER_irStatement *build_ir_vardecl(Context *ctx,
+                                    const MOJOSHADER_astVariableDeclaration *ast);
+
+// Nonzero if (expr) names variable (index), or any variable at all if
+//  (index) is negative, maybe swizzled or indexed.
+static int ir_is_variable(const MOJOSHADER_irExpression *expr, const int index)
+{
+    const MOJOSHADER_irExpression *base = ir_dest_base((MOJOSHADER_irExpression *) expr);
+    return ( (base != NULL) && (base->ir.type == MOJOSHADER_IR_MEMORY) &&
+             ((index < 0) || (base->memory.index == index)) );
+} // ir_is_variable
+
+// The user function signature that (index) refers to, for its parameters'
+//  in/out modifiers. Callees might not have been built yet, so this goes
+//  straight to the AST.
+static const MOJOSHADER_astFunctionSignature *ir_function_signature(Context *ctx,
+                                                                    const int index)
+{
+    const MOJOSHADER_astCompilationUnit *ast = NULL;
+    for (ast = &ctx->ast->compunit; ast != NULL; ast = ast->next)
+    {
+        if (ast->ast.type != MOJOSHADER_AST_COMPUNIT_FUNCTION)
+            continue;
+        const MOJOSHADER_astCompilationUnitFunction *fn = (const MOJOSHADER_astCompilationUnitFunction *) ast;
+        if (fn->index == index)
+            return fn->declaration;
+    } // for
+    return NULL;
+} // ir_function_signature
+
+static int ir_is_intrinsic(const int index, const char *name,
+                           const int num_params)
+{
+    const FunctionOverloads *fos = NULL;
+    const FunctionOverload *fo = NULL;
+    if (builtin_ctx != NULL)
+        fos = find_overloads(builtin_ctx->functions, name, num_params);
+    for (fo = (fos != NULL) ? fos->overloads : NULL; fo != NULL; fo = fo->next)
+    {
+        if (fo->index == index)
+            return 1;
+    } // for
+    return 0;
+} // ir_is_intrinsic
+
+// Nonzero if intrinsic call (call) writes to argument (n). sincos() is the
+//  only void intrinsic that takes more than one argument, and it writes to
+//  everything after the first; modf() and frexp() write to their second.
+static int ir_intrinsic_writes_arg(const MOJOSHADER_irCall *call, const int n)
+{
+    assert(call->index < 0);
+    if (n == 0)
+        return 0;
+    else if (call->info.elements == 0)
+        return 1;
+    return ( (n == 1) && ((ir_is_intrinsic(call->index, "modf", 2)) ||
+                          (ir_is_intrinsic(call->index, "frexp", 2))) );
+} // ir_intrinsic_writes_arg
+
+static int ir_call_writes_variable(Context *ctx, const MOJOSHADER_irCall *call,
+                                   const int index)
+{
+    const MOJOSHADER_irExprList *arg = call->args;
+    int n;
+
+    if (call->index < 0)
+    {
+        for (n = 0; arg != NULL; arg = arg->next, n++)
+        {
+            if ((ir_intrinsic_writes_arg(call, n)) && (ir_is_variable(arg->expr, index)))
+                return 1;
+        } // for
+        return 0;
+    } // if
+
+    const MOJOSHADER_astFunctionSignature *sig = ir_function_signature(ctx, call->index);
+    const MOJOSHADER_astFunctionParameters *param = NULL;
+    if (sig == NULL)
+        return 1;  // play it safe.
+
+    for (param = sig->params; (param != NULL) && (arg != NULL); param = param->next, arg = arg->next)
+    {
+        if ( ((param->input_modifier == MOJOSHADER_AST_INPUTMOD_OUT) ||
+              (param->input_modifier == MOJOSHADER_AST_INPUTMOD_INOUT)) &&
+             (ir_is_variable(arg->expr, index)) )
+            return 1;
+    } // for
+    return 0;
+} // ir_call_writes_variable
+
+// Nonzero if (ir), which can still have SEQs and ESEQs in it, might write
+//  to variable (index), or to any variable at all if (index) is negative.
+static int ir_writes_variable(Context *ctx, const void *_ir, const int index)
+{
+    const MOJOSHADER_irNode *ir = (const MOJOSHADER_irNode *) _ir;
+    const MOJOSHADER_irExprList *args = NULL;
+    const MOJOSHADER_irExpression *dst = NULL;
+
+    // walk down chains of SEQs instead of recursing on them.
+    while ((ir != NULL) && (ir->ir.type == MOJOSHADER_IR_SEQ))
+    {
+        if (ir_writes_variable(ctx, ir->stmt.seq.first, index))
+            return 1;
+        ir = (const MOJOSHADER_irNode *) ir->stmt.seq.next;
+    } // while
+
+    if (ir == NULL)
+        return 0;
+
+    switch (ir->ir.type)
+    {
+        case MOJOSHADER_IR_MOVE:
+            if (ir_is_variable(ir->stmt.move.dst, index))
+                return 1;
+            for (dst = ir->stmt.move.dst; dst != NULL; )
+            {
+                if (dst->ir.type == MOJOSHADER_IR_SWIZZLE)
+                    dst = dst->swizzle.expr;
+                else if (dst->ir.type == MOJOSHADER_IR_ARRAY)
+                {
+                    if (ir_writes_variable(ctx, dst->array.element, index))
+                        return 1;
+                    dst = dst->array.array;
+                } // else if
+                else if (dst->ir.type == MOJOSHADER_IR_ESEQ)
+                {
+                    if (ir_writes_variable(ctx, dst->eseq.stmt, index))
+                        return 1;
+                    dst = dst->eseq.expr;
+                } // else if
+                else
+                    break;
+            } // for
+            return ir_writes_variable(ctx, ir->stmt.move.src, index);
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            return ir_writes_variable(ctx, ir->stmt.expr.expr, index);
+
+        case MOJOSHADER_IR_CJUMP:
+            return ( (ir_writes_variable(ctx, ir->stmt.cjump.left, index)) ||
+                     (ir_writes_variable(ctx, ir->stmt.cjump.right, index)) );
+
+        case MOJOSHADER_IR_ESEQ:
+            return ( (ir_writes_variable(ctx, ir->expr.eseq.stmt, index)) ||
+                     (ir_writes_variable(ctx, ir->expr.eseq.expr, index)) );
+
+        case MOJOSHADER_IR_BINOP:
+            return ( (ir_writes_variable(ctx, ir->expr.binop.left, index)) ||
+                     (ir_writes_variable(ctx, ir->expr.binop.right, index)) );
+
+        case MOJOSHADER_IR_ARRAY:
+            return ( (ir_writes_variable(ctx, ir->expr.array.array, index)) ||
+                     (ir_writes_variable(ctx, ir->expr.array.element, index)) );
+
+        case MOJOSHADER_IR_CONVERT:
+            return ir_writes_variable(ctx, ir->expr.convert.expr, index);
+
+        case MOJOSHADER_IR_SWIZZLE:
+            return ir_writes_variable(ctx, ir->expr.swizzle.expr, index);
+
+        case MOJOSHADER_IR_SELECT:
+            return ( (ir_writes_variable(ctx, ir->expr.select.cond, index)) ||
+                     (ir_writes_variable(ctx, ir->expr.select.iftrue, index)) ||
+                     (ir_writes_variable(ctx, ir->expr.select.iffalse, index)) );
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            args = ir->expr.construct.args;
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            if (ir_call_writes_variable(ctx, &ir->expr.call, index))
+                return 1;
+            args = ir->expr.call.args;
+            break;
+
+        default: return 0;  // nothing inside the others.
+    } // switch
+
+    for (; args != NULL; args = args->next)
+    {
+        if (ir_writes_variable(ctx, args->expr, index))
+            return 1;
+    } // for
+
+    return 0;
+} // ir_writes_variable
+
+
+// [flatten] if statements become selects: both branches always run, and
+//  each branch's variable writes keep the old value when the condition
+//  doesn't match. That only works for straight-line code that can't do
+//  anything else a skipped branch wouldn't: no jumps out of it, no discards,
+//  no calls. Temps are private to the code that made them, so they don't
+//  need selects.
+
+static int ir_flattenable_expr(Context *ctx, const MOJOSHADER_irExpression *expr);
+
+// (nested) is non-zero inside an ESEQ, where jumps (from "a && b", etc) stay
+//  inside the expression.
+
+static int ir_flattenable_stmt(Context *ctx, const MOJOSHADER_irStatement *stmt,
+                               const int nested)
+{
+    while ((stmt != NULL) && (stmt->ir.type == MOJOSHADER_IR_SEQ))
+    {
+        if (!ir_flattenable_stmt(ctx, stmt->seq.first, nested))
+            return 0;
+        stmt = stmt->seq.next;
+    } // while
+
+    if (stmt == NULL)
+        return 1;
+
+    switch (stmt->ir.type)
+    {
+        case MOJOSHADER_IR_MOVE:
+        {
+            const MOJOSHADER_irExpression *dst = stmt->move.dst;
+            while (dst != NULL)
+            {
+                if (dst->ir.type == MOJOSHADER_IR_SWIZZLE)
+                    dst = dst->swizzle.expr;
+                else if (dst->ir.type == MOJOSHADER_IR_ARRAY)
+                {
+                    // copy_ir_lvalue() has to be able to read it back.
+                    const MOJOSHADER_irExpression *element = dst->array.element;
+                    if (!ir_flattenable_expr(ctx, element))
+                        return 0;
+                    while (element->ir.type == MOJOSHADER_IR_ESEQ)
+                        element = element->eseq.expr;
+                    if ( (element->ir.type != MOJOSHADER_IR_TEMP) &&
+                         (element->ir.type != MOJOSHADER_IR_MEMORY) &&
+                         (element->ir.type != MOJOSHADER_IR_CONSTANT) )
+                        return 0;
+                    dst = dst->array.array;
+                } // else if
+                else
+                    break;
+            } // while
+            if ( (dst == NULL) || ((dst->ir.type != MOJOSHADER_IR_TEMP) &&
+                                   (dst->ir.type != MOJOSHADER_IR_MEMORY)) )
+                return 0;
+            return ir_flattenable_expr(ctx, stmt->move.src);
+        } // case
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            return ir_flattenable_expr(ctx, stmt->expr.expr);
+
+        case MOJOSHADER_IR_LABEL:
+        case MOJOSHADER_IR_JUMP:
+            return nested;
+
+        case MOJOSHADER_IR_CJUMP:
+            return ( (nested) &&
+                     (ir_flattenable_expr(ctx, stmt->cjump.left)) &&
+                     (ir_flattenable_expr(ctx, stmt->cjump.right)) );
+
+        default: return 0;
+    } // switch
+} // ir_flattenable_stmt
+
+static int ir_flattenable_expr(Context *ctx, const MOJOSHADER_irExpression *expr)
+{
+    const MOJOSHADER_irExprList *args = NULL;
+
+    if (expr == NULL)
+        return 1;
+
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_ESEQ:
+            return ( (ir_flattenable_stmt(ctx, expr->eseq.stmt, 1)) &&
+                     (ir_flattenable_expr(ctx, expr->eseq.expr)) );
+
+        case MOJOSHADER_IR_BINOP:
+            return ( (ir_flattenable_expr(ctx, expr->binop.left)) &&
+                     (ir_flattenable_expr(ctx, expr->binop.right)) );
+
+        case MOJOSHADER_IR_ARRAY:
+            return ( (ir_flattenable_expr(ctx, expr->array.array)) &&
+                     (ir_flattenable_expr(ctx, expr->array.element)) );
+
+        case MOJOSHADER_IR_CONVERT:
+            return ir_flattenable_expr(ctx, expr->convert.expr);
+
+        case MOJOSHADER_IR_SWIZZLE:
+            return ir_flattenable_expr(ctx, expr->swizzle.expr);
+
+        case MOJOSHADER_IR_SELECT:
+            return ( (ir_flattenable_expr(ctx, expr->select.cond)) &&
+                     (ir_flattenable_expr(ctx, expr->select.iftrue)) &&
+                     (ir_flattenable_expr(ctx, expr->select.iffalse)) );
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            args = expr->construct.args;
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            // user functions might discard, void intrinsics are clip() and
+            //  sincos(), and modf() and frexp() write their arguments, too.
+            if ((expr->call.index >= 0) || (expr->info.elements == 0))
+                return 0;
+            else if (ir_intrinsic_writes_arg(&expr->call, 1))
+                return 0;
+            args = expr->call.args;
+            break;
+
+        default: return 1;  // nothing inside the others.
+    } // switch
+
+    for (; args != NULL; args = args->next)
+    {
+        if (!ir_flattenable_expr(ctx, args->expr))
+            return 0;
+    } // for
+
+    return 1;
+} // ir_flattenable_expr
+
+static void flatten_ir_branch(Context *ctx, MOJOSHADER_irStatement *stmt,
+                              const int cond, const int istrue);
+
+static void flatten_ir_expr(Context *ctx, MOJOSHADER_irExpression *expr,
+                            const int cond, const int istrue)
+{
+    MOJOSHADER_irExprList *args = NULL;
+
+    if (expr == NULL)
+        return;
+
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_ESEQ:
+            flatten_ir_branch(ctx, expr->eseq.stmt, cond, istrue);
+            flatten_ir_expr(ctx, expr->eseq.expr, cond, istrue);
+            break;
+
+        case MOJOSHADER_IR_BINOP:
+            flatten_ir_expr(ctx, expr->binop.left, cond, istrue);
+            flatten_ir_expr(ctx, expr->binop.right, cond, istrue);
+            break;
+
+        case MOJOSHADER_IR_ARRAY:
+            flatten_ir_expr(ctx, expr->array.array, cond, istrue);
+            flatten_ir_expr(ctx, expr->array.element, cond, istrue);
+            break;
+
+        case MOJOSHADER_IR_CONVERT:
+            flatten_ir_expr(ctx, expr->convert.expr, cond, istrue);
+            break;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            flatten_ir_expr(ctx, expr->swizzle.expr, cond, istrue);
+            break;
+
+        case MOJOSHADER_IR_SELECT:
+            flatten_ir_expr(ctx, expr->select.cond, cond, istrue);
+            flatten_ir_expr(ctx, expr->select.iftrue, cond, istrue);
+            flatten_ir_expr(ctx, expr->select.iffalse, cond, istrue);
+            break;
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            for (args = expr->construct.args; args != NULL; args = args->next)
+                flatten_ir_expr(ctx, args->expr, cond, istrue);
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            for (args = expr->call.args; args != NULL; args = args->next)
+                flatten_ir_expr(ctx, args->expr, cond, istrue);
+            break;
+
+        default: break;  // nothing inside the others.
+    } // switch
+} // flatten_ir_expr
+
+// Makes each variable write in (stmt) keep the old value unless the bool in
+//  temp (cond) is (istrue). (stmt) has to pass ir_flattenable_stmt() first.
+static void flatten_ir_branch(Context *ctx, MOJOSHADER_irStatement *stmt,
+                              const int cond, const int istrue)
+{
+    while ((stmt != NULL) && (stmt->ir.type == MOJOSHADER_IR_SEQ))
+    {
+        flatten_ir_branch(ctx, stmt->seq.first, cond, istrue);
+        stmt = stmt->seq.next;
+    } // while
+
+    if (stmt == NULL)
+        return;
+    else if (stmt->ir.type == MOJOSHADER_IR_EXPR_STMT)
+    {
+        flatten_ir_expr(ctx, stmt->expr.expr, cond, istrue);
+        return;
+    } // else if
+    else if (stmt->ir.type == MOJOSHADER_IR_CJUMP)
+    {
+        flatten_ir_expr(ctx, stmt->cjump.left, cond, istrue);
+        flatten_ir_expr(ctx, stmt->cjump.right, cond, istrue);
+        return;
+    } // else if
+    else if (stmt->ir.type != MOJOSHADER_IR_MOVE)
+        return;
+
+    flatten_ir_expr(ctx, stmt->move.dst, cond, istrue);
+    flatten_ir_expr(ctx, stmt->move.src, cond, istrue);
+    if (!ir_is_variable(stmt->move.dst, -1))
+        return;
+
+    MOJOSHADER_irExpression *src = stmt->move.src;
+    MOJOSHADER_irExpression *old = copy_ir_lvalue(ctx, stmt->move.dst);
+    MOJOSHADER_irExpression *test = new_ir_temp(ctx, cond, MOJOSHADER_AST_DATATYPE_BOOL, 1);
+    MOJOSHADER_irExpression *select = NULL;
+    if ((old != NULL) && (test != NULL))
+    {
+        select = istrue ? new_ir_select(ctx, test, src, old) :
+                          new_ir_select(ctx, test, old, src);
+    } // if
+
+    if (select == NULL)  // out of memory; leave it alone.
+    {
+        delete_ir(ctx, old);
+        delete_ir(ctx, test);
+        return;
+    } // if
+
+    stmt->move.src = select;
+} // flatten_ir_branch
+
+// The jump that picks an if statement's branch. [branch] asks for real flow
+//  control, which code generation gives it where the profile can.
+static MOJOSHADER_irStatement *build_ir_if_cjump(Context *ctx,
+                                          const MOJOSHADER_astIfStatement *ast,
+                                          MOJOSHADER_irExpression *expr,
+                                          const int t, const int f)
+{
+    // the branches are built by now; the jump belongs to the if's test.
+    ctx->sourcefile = ast->expr->ast.filename;
+    ctx->sourceline = ast->expr->ast.line;
+    MOJOSHADER_irStatement *retval = new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, expr, new_ir_constbool(ctx, 1), t, f);
+    if (retval != NULL)
+        retval->cjump.branch = (ast->attributes == MOJOSHADER_AST_IFATTR_BRANCH);
+    return retval;
+} // build_ir_if_cjump
+
+static MOJOSHADER_irStatement *build_ir_ifstmt(Context *ctx,
+                                          const MOJOSHADER_astIfStatement *ast)
+{
+    assert(ast->expr->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+
+    // ifs nested in a [flatten] if have to flatten too, unless they're
+    //  marked [branch].
+    const int flatten = (ast->attributes == MOJOSHADER_AST_IFATTR_FLATTEN) ||
+                        ( (ctx->ir_flatten > 0) &&
+                          (ast->attributes != MOJOSHADER_AST_IFATTR_BRANCH) );
+
+    // !!! FIXME: the other ast->attributes?
+
+    MOJOSHADER_irExpression *expr = build_ir_expr(ctx, ast->expr);
+    ctx->ir_flatten += flatten;
+    MOJOSHADER_irStatement *stmt = build_ir_stmt(ctx, ast->statement);
+    MOJOSHADER_irStatement *elsestmt = build_ir_stmt(ctx, ast->else_statement);
+    ctx->ir_flatten -= flatten;
+
+    if (flatten)
+    {
+        if ( (ir_flattenable_stmt(ctx, stmt, 0)) &&
+             (ir_flattenable_stmt(ctx, elsestmt, 0)) )
+        {
+            /* The gist...
+                    move tmp, expr
+                    statement  // writes become "move x, select(tmp, y, x)"
+                    elsestatement  // writes become "move x, select(tmp, x, y)"
+            */
+
+            const int tmp = generate_ir_temp(ctx);
+            flatten_ir_branch(ctx, stmt, tmp, 1);
+            flatten_ir_branch(ctx, elsestmt, tmp, 0);
+            return new_ir_seq(ctx, new_ir_move(ctx, new_ir_temp(ctx, tmp, MOJOSHADER_AST_DATATYPE_BOOL, 1), expr, -1),
+                   new_ir_seq(ctx, stmt,
+                   new_ir_seq(ctx, elsestmt,
+                                   build_ir_stmt(ctx, ast->next))));
+        } // if
+
+        else if (ast->attributes == MOJOSHADER_AST_IFATTR_FLATTEN)
+        {
+            ctx->sourcefile = ast->expr->ast.filename;
+            ctx->sourceline = ast->expr->ast.line;
+            warn(ctx, "Can't flatten if statement that jumps, discards or calls functions");
+        } // else if
+    } // if
+
+    // IF statement without an ELSE.
+    if (elsestmt == NULL)
+    {
+        /* The gist...
+                cjump expr, t, join
+            t:
+                statement
+            join:
+        */
+
+        const int t = generate_ir_label(ctx);
+        const int join = generate_ir_label(ctx);
+
+        return new_ir_seq(ctx, build_ir_if_cjump(ctx, ast, expr, t, join),
+               new_ir_seq(ctx, new_ir_label(ctx, t),
+               new_ir_seq(ctx, stmt,
+               new_ir_seq(ctx, new_ir_label(ctx, join),
+                               build_ir_stmt(ctx, ast->next)))));
+    } // if
+
+    // IF statement _with_ an ELSE.
+    /* The gist...
+            cjump expr, t, f
+        t:
+            statement
+            jump join
+        f:
+            elsestatement
+        join:
+    */
+
+    const int t = generate_ir_label(ctx);
+    const int f = generate_ir_label(ctx);
+    const int join = generate_ir_label(ctx);
+
+    return new_ir_seq(ctx, build_ir_if_cjump(ctx, ast, expr, t, f),
+           new_ir_seq(ctx, new_ir_label(ctx, t),
+           new_ir_seq(ctx, stmt,
+           new_ir_seq(ctx, new_ir_jump(ctx, join),
+           new_ir_seq(ctx, new_ir_label(ctx, f),
+           new_ir_seq(ctx, elsestmt,
+           new_ir_seq(ctx, new_ir_label(ctx, join),
+                           build_ir_stmt(ctx, ast->next))))))));
+} // build_ir_ifstmt
+
+
+// Loops with a constant iteration count get unrolled completely, which is
+//  also the only way Shader Model 2 can run them. [unroll(n)] says a loop
+//  never runs more than (n) times, so loops we can't count can still unroll
+//  into (n) copies that each check the loop test first. [loop] loops, and
+//  loops we can't count or unroll, stay loops.
+
+#define IR_MAX_UNROLL 1024  // more iterations than this aren't "constant".
+
+typedef struct IrLoopCount
+{
+    int var;  // the loop variable's index.
+    MOJOSHADER_astDataTypeType type;  // its type; a scalar int or float.
+    int isfloat;
+    MOJOSHADER_astNodeType test;  // how it compares to (limit)...
+    double limit;  // ...as the left side of the loop test.
+    double start;  // its value for the first iteration...
+    double step;  // ...and what each iteration adds to it.
+} IrLoopCount;
+
+// The variable's IR type if (dt) is a scalar int or float, NONE otherwise.
+static MOJOSHADER_astDataTypeType ir_loop_type(Context *ctx,
+                                               const MOJOSHADER_astDataType *dt,
+                                               int *isfloat)
+{
+    dt = reduce_datatype(ctx, dt);
+    if (dt == NULL)
+        return MOJOSHADER_AST_DATATYPE_NONE;
+
+    switch (dt->type & ~MOJOSHADER_AST_DATATYPE_CONST)
+    {
+        case MOJOSHADER_AST_DATATYPE_INT:
+        case MOJOSHADER_AST_DATATYPE_UINT:
+            *isfloat = 0;
+            return datatype_base(ctx, dt)->type;
+
+        case MOJOSHADER_AST_DATATYPE_FLOAT:
+        case MOJOSHADER_AST_DATATYPE_HALF:
+        case MOJOSHADER_AST_DATATYPE_DOUBLE:
+            *isfloat = 1;
+            return datatype_base(ctx, dt)->type;
+
+        default:
+            return MOJOSHADER_AST_DATATYPE_NONE;
+    } // switch
+} // ir_loop_type
+
+// Evaluates a literal, maybe negated or cast, that a loop counts with.
+//  Returns zero if (_ast) is anything more complicated than that.
+static int ir_loop_constant(Context *ctx, const MOJOSHADER_astExpression *_ast,
+                            double *val)
+{
+    const MOJOSHADER_astNode *ast = (const MOJOSHADER_astNode *) _ast;
+    int isfloat = 0;
+
+    switch (ast->ast.type)
+    {
+        case MOJOSHADER_AST_OP_INT_LITERAL:
+            *val = (double) ast->intliteral.value;
+            return 1;
+
+        case MOJOSHADER_AST_OP_FLOAT_LITERAL:
+            *val = ast->floatliteral.value;
+            return 1;
+
+        case MOJOSHADER_AST_OP_NEGATE:
+            if (!ir_loop_constant(ctx, ast->unary.operand, val))
+                return 0;
+            *val = -*val;
+            return 1;
+
+        case MOJOSHADER_AST_OP_CAST:
+            if (ir_loop_type(ctx, ast->cast.datatype, &isfloat) == MOJOSHADER_AST_DATATYPE_NONE)
+                return 0;
+            else if (!ir_loop_constant(ctx, ast->cast.operand, val))
+                return 0;
+            *val = isfloat ? (double) ((float) *val) : (double) ((int) *val);
+            return 1;
+
+        default:
+            return 0;
+    } // switch
+} // ir_loop_constant
+
+// Nonzero if (_ast) reads the loop variable. An int variable can be cast to
+//  float to compare it with a float; that doesn't change its value.
+static int ir_loop_is_var(Context *ctx, const IrLoopCount *count,
+                          const MOJOSHADER_astExpression *_ast)
+{
+    const MOJOSHADER_astNode *ast = (const MOJOSHADER_astNode *) _ast;
+    int isfloat = 0;
+
+    if ( (ast->ast.type == MOJOSHADER_AST_OP_CAST) && (!count->isfloat) &&
+         (ir_loop_type(ctx, ast->cast.datatype, &isfloat) != MOJOSHADER_AST_DATATYPE_NONE) &&
+         (isfloat) )
+        ast = (const MOJOSHADER_astNode *) ast->cast.operand;
+
+    return ( (ast->ast.type == MOJOSHADER_AST_OP_IDENTIFIER) &&
+             (ast->identifier.index == count->var) );
+} // ir_loop_is_var
+
+static double ir_loop_next(const IrLoopCount *count, const double value)
+{
+    const double retval = value + count->step;
+    return count->isfloat ? (double) ((float) retval) : retval;
+} // ir_loop_next
+
+static int ir_loop_test(const IrLoopCount *count, const double value)
+{
+    switch (count->test)
+    {
+        case MOJOSHADER_AST_OP_LESSTHAN: return (value < count->limit);
+        case MOJOSHADER_AST_OP_GREATERTHAN: return (value > count->limit);
+        case MOJOSHADER_AST_OP_LESSTHANOREQUAL: return (value <= count->limit);
+        case MOJOSHADER_AST_OP_GREATERTHANOREQUAL: return (value >= count->limit);
+        case MOJOSHADER_AST_OP_EQUAL: return (value == count->limit);
+        case MOJOSHADER_AST_OP_NOTEQUAL: return (value != count->limit);
+        default: assert(0 && "unexpected loop test"); return 0;
+    } // switch
+} // ir_loop_test
+
+// Works out how many times a for loop runs, if it starts its variable at a
+//  constant, tests it against a constant, and steps it by a constant. Whether
+//  the body changes the variable is up to the caller. Returns -1 if we can't
+//  tell, or it's more than IR_MAX_UNROLL.
+static int count_ir_loop(Context *ctx, const MOJOSHADER_astForStatement *ast,
+                         IrLoopCount *count)
+{
+    const MOJOSHADER_astNode *test = (const MOJOSHADER_astNode *) ast->looptest;
+    const MOJOSHADER_astNode *counter = (const MOJOSHADER_astNode *) ast->counter;
+    const MOJOSHADER_astExpression *lhs = NULL;
+    const MOJOSHADER_astExpression *rhs = NULL;
+    const MOJOSHADER_astDataType *dt = NULL;
+    double value = 0.0;
+    int retval = 0;
+
+    memset(count, '\0', sizeof (*count));
+
+    // "int i = 0" or "i = 0" ...
+    if (ast->var_decl != NULL)
+    {
+        if ((ast->var_decl->next != NULL) || (ast->var_decl->initializer == NULL))
+            return -1;
+        count->var = ast->var_decl->index;
+        dt = ast->var_decl->datatype;
+        rhs = ast->var_decl->initializer;
+    } // if
+    else if ( (ast->initializer != NULL) &&
+              (ast->initializer->ast.type == MOJOSHADER_AST_OP_ASSIGN) )
+    {
+        const MOJOSHADER_astExpressionBinary *init = (const MOJOSHADER_astExpressionBinary *) ast->initializer;
+        if (init->left->ast.type != MOJOSHADER_AST_OP_IDENTIFIER)
+            return -1;
+        count->var = ((const MOJOSHADER_astExpressionIdentifier *) init->left)->index;
+        dt = init->left->datatype;
+        rhs = init->right;
+    } // else if
+    else
+        return -1;
+
+    count->type = ir_loop_type(ctx, dt, &count->isfloat);
+    if (count->type == MOJOSHADER_AST_DATATYPE_NONE)
+        return -1;
+    else if (!ir_loop_constant(ctx, rhs, &count->start))
+        return -1;
+
+    // ... "i < 4" or "4 > i" ...
+    if (test == NULL)
+        return -1;
+
+    count->test = test->ast.type;
+    switch (count->test)
+    {
+        case MOJOSHADER_AST_OP_LESSTHAN:
+        case MOJOSHADER_AST_OP_GREATERTHAN:
+        case MOJOSHADER_AST_OP_LESSTHANOREQUAL:
+        case MOJOSHADER_AST_OP_GREATERTHANOREQUAL:
+        case MOJOSHADER_AST_OP_EQUAL:
+        case MOJOSHADER_AST_OP_NOTEQUAL:
+            break;
+        default:
+            return -1;
+    } // switch
+
+    if ( (ir_loop_is_var(ctx, count, test->binary.left)) &&
+         (ir_loop_constant(ctx, test->binary.right, &count->limit)) )
+        ;  // all set.
+    else if ( (ir_loop_is_var(ctx, count, test->binary.right)) &&
+              (ir_loop_constant(ctx, test->binary.left, &count->limit)) )
+    {
+        // flip it around, so the variable is on the left.
+        switch (count->test)
+        {
+            case MOJOSHADER_AST_OP_LESSTHAN: count->test = MOJOSHADER_AST_OP_GREATERTHAN; break;
+            case MOJOSHADER_AST_OP_GREATERTHAN: count->test = MOJOSHADER_AST_OP_LESSTHAN; break;
+            case MOJOSHADER_AST_OP_LESSTHANOREQUAL: count->test = MOJOSHADER_AST_OP_GREATERTHANOREQUAL; break;
+            case MOJOSHADER_AST_OP_GREATERTHANOREQUAL: count->test = MOJOSHADER_AST_OP_LESSTHANOREQUAL; break;
+            default: break;  // == and != don't care.
+        } // switch
+    } // else if
+    else
+        return -1;
+
+    // ... "i++", "i -= 2" or "i = i + 1".
+    if (counter == NULL)
+        return -1;
+
+    switch (counter->ast.type)
+    {
+        case MOJOSHADER_AST_OP_PREINCREMENT:
+        case MOJOSHADER_AST_OP_POSTINCREMENT:
+        case MOJOSHADER_AST_OP_PREDECREMENT:
+        case MOJOSHADER_AST_OP_POSTDECREMENT:
+            if (!ir_loop_is_var(ctx, count, counter->unary.operand))
+                return -1;
+            count->step = ( (counter->ast.type == MOJOSHADER_AST_OP_PREINCREMENT) ||
+                            (counter->ast.type == MOJOSHADER_AST_OP_POSTINCREMENT) ) ? 1.0 : -1.0;
+            break;
+
+        case MOJOSHADER_AST_OP_ADDASSIGN:
+        case MOJOSHADER_AST_OP_SUBASSIGN:
+            if (!ir_loop_is_var(ctx, count, counter->binary.left))
+                return -1;
+            else if (!ir_loop_constant(ctx, counter->binary.right, &count->step))
+                return -1;
+            if (counter->ast.type == MOJOSHADER_AST_OP_SUBASSIGN)
+                count->step = -count->step;
+            break;
+
+        case MOJOSHADER_AST_OP_ASSIGN:
+        {
+            const MOJOSHADER_astNode *sum = (const MOJOSHADER_astNode *) counter->binary.right;
+            if (!ir_loop_is_var(ctx, count, counter->binary.left))
+                return -1;
+            else if ( (sum->ast.type != MOJOSHADER_AST_OP_ADD) &&
+                      (sum->ast.type != MOJOSHADER_AST_OP_SUBTRACT) )
+                return -1;
+            lhs = sum->binary.left;
+            rhs = sum->binary.right;
+            if ( (sum->ast.type == MOJOSHADER_AST_OP_ADD) &&
+                 (ir_loop_is_var(ctx, count, rhs)) )
+            {
+                rhs = lhs;  // "i = 1 + i"
+                lhs = sum->binary.right;
+            } // if
+            if (!ir_loop_is_var(ctx, count, lhs))
+                return -1;
+            else if (!ir_loop_constant(ctx, rhs, &count->step))
+                return -1;
+            if (sum->ast.type == MOJOSHADER_AST_OP_SUBTRACT)
+                count->step = -count->step;
+            break;
+        } // case
+
+        default:
+            return -1;
+    } // switch
+
+    for (value = count->start; ir_loop_test(count, value); value = ir_loop_next(count, value))
+    {
+        if (++retval > IR_MAX_UNROLL)
+            return -1;
+    } // for
+
+    return retval;
+} // count_ir_loop
+
+static MOJOSHADER_irExpression *new_ir_loop_constant(Context *ctx,
+                                                    const IrLoopCount *count,
+                                                    const double value)
+{
+    MOJOSHADER_irExpression *retval = new_ir_constant(ctx, count->type, 1);
+    if (retval == NULL)
+        return NULL;
+    else if (count->isfloat)
+        retval->constant.value.fval[0] = (float) value;
+    else
+        retval->constant.value.ival[0] = (int) value;
+    return retval;
+} // new_ir_loop_constant
+
+static MOJOSHADER_irStatement *new_ir_loop_move(Context *ctx,
+                                                const IrLoopCount *count,
+                                                const double value)
+{
+    MOJOSHADER_irExpression *dst = new_ir_memory(ctx, count->var, count->type, 1);
+    MOJOSHADER_irExpression *src = new_ir_loop_constant(ctx, count, value);
+    if ((dst == NULL) || (src == NULL))
+    {
+        delete_ir(ctx, dst);
+        delete_ir(ctx, src);
+        return NULL;
+    } // if
+    return new_ir_move(ctx, dst, src, -1);
+} // new_ir_loop_move
+
+static void subst_ir_loop_var(Context *ctx, MOJOSHADER_irStatement *stmt,
+                              const IrLoopCount *count, const double value);
+
+static void subst_ir_loop_expr(Context *ctx, MOJOSHADER_irExpression **slot,
+                               const IrLoopCount *count, const double value)
+{
+    MOJOSHADER_irExpression *expr = *slot;
+    MOJOSHADER_irExprList *args = NULL;
+
+    if (expr == NULL)
+        return;
+
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_MEMORY:
+            if (expr->memory.index == count->var)
+            {
+                MOJOSHADER_irExpression *constant = new_ir_loop_constant(ctx, count, value);
+                if (constant != NULL)
+                {
+                    delete_ir(ctx, expr);
+                    *slot = constant;
+                } // if
+            } // if
+            break;
+
+        case MOJOSHADER_IR_ESEQ:
+            subst_ir_loop_var(ctx, expr->eseq.stmt, count, value);
+            subst_ir_loop_expr(ctx, &expr->eseq.expr, count, value);
+            break;
+
+        case MOJOSHADER_IR_BINOP:
+            subst_ir_loop_expr(ctx, &expr->binop.left, count, value);
+            subst_ir_loop_expr(ctx, &expr->binop.right, count, value);
+            break;
+
+        case MOJOSHADER_IR_ARRAY:
+            subst_ir_loop_expr(ctx, &expr->array.array, count, value);
+            subst_ir_loop_expr(ctx, &expr->array.element, count, value);
+            break;
+
+        case MOJOSHADER_IR_CONVERT:
+            subst_ir_loop_expr(ctx, &expr->convert.expr, count, value);
+            break;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            subst_ir_loop_expr(ctx, &expr->swizzle.expr, count, value);
+            break;
+
+        case MOJOSHADER_IR_SELECT:
+            subst_ir_loop_expr(ctx, &expr->select.cond, count, value);
+            subst_ir_loop_expr(ctx, &expr->select.iftrue, count, value);
+            subst_ir_loop_expr(ctx, &expr->select.iffalse, count, value);
+            break;
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            for (args = expr->construct.args; args != NULL; args = args->next)
+                subst_ir_loop_expr(ctx, &args->expr, count, value);
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            for (args = expr->call.args; args != NULL; args = args->next)
+                subst_ir_loop_expr(ctx, &args->expr, count, value);
+            break;
+
+        default: break;  // nothing inside the others.
+    } // switch
+} // subst_ir_loop_expr
+
+// Replaces every read of the loop variable in one copy of an unrolled loop's
+//  body with the value it has in that iteration. The body can't write to the
+//  variable, or the loop wouldn't have been unrolled.
+static void subst_ir_loop_var(Context *ctx, MOJOSHADER_irStatement *stmt,
+                              const IrLoopCount *count, const double value)
+{
+    MOJOSHADER_irExpression **dst = NULL;
+
+    while ((stmt != NULL) && (stmt->ir.type == MOJOSHADER_IR_SEQ))
+    {
+        subst_ir_loop_var(ctx, stmt->seq.first, count, value);
+        stmt = stmt->seq.next;
+    } // while
+
+    if (stmt == NULL)
+        return;
+
+    switch (stmt->ir.type)
+    {
+        case MOJOSHADER_IR_MOVE:
+            // the destination isn't a read, but its array indices are.
+            for (dst = &stmt->move.dst; *dst != NULL; )
+            {
+                if ((*dst)->ir.type == MOJOSHADER_IR_SWIZZLE)
+                    dst = &(*dst)->swizzle.expr;
+                else if ((*dst)->ir.type == MOJOSHADER_IR_ARRAY)
+                {
+                    subst_ir_loop_expr(ctx, &(*dst)->array.element, count, value);
+                    dst = &(*dst)->array.array;
+                } // else if
+                else if ((*dst)->ir.type == MOJOSHADER_IR_ESEQ)
+                {
+                    subst_ir_loop_var(ctx, (*dst)->eseq.stmt, count, value);
+                    dst = &(*dst)->eseq.expr;
+                } // else if
+                else
+                    break;
+            } // for
+            subst_ir_loop_expr(ctx, &stmt->move.src, count, value);
+            break;
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            subst_ir_loop_expr(ctx, &stmt->expr.expr, count, value);
+            break;
+
+        case MOJOSHADER_IR_CJUMP:
+            subst_ir_loop_expr(ctx, &stmt->cjump.left, count, value);
+            subst_ir_loop_expr(ctx, &stmt->cjump.right, count, value);
+            break;
+
+        default: break;  // nothing inside the others.
+    } // switch
+} // subst_ir_loop_var
+
+// Builds another copy of a loop's body, with its own label for "continue".
+//  The first copy is already built by the time we need the others, so its
+//  continue label is the one push_ir_loop() made.
+static MOJOSHADER_irStatement *build_ir_loop_body(Context *ctx,
+                                      const MOJOSHADER_astStatement *ast)
+{
+    ctx->ir_loop->start = generate_ir_label(ctx);
+    return build_ir_stmt(ctx, (void *) ast);
+} // build_ir_loop_body
+
+// Reports loops that can't be unrolled as [unroll] says they must be.
+//  (ast) is the loop test, since the loop's own node gets the line where
+//  the parser finished the whole loop.
+static void fail_ir_unroll(Context *ctx, const MOJOSHADER_astNodeInfo *ast)
+{
+    ctx->sourcefile = ast->filename;
+    ctx->sourceline = ast->line;
+    fail(ctx, "Can't unroll loop: its iteration count isn't a constant (try [unroll(n)] or [loop])");
+} // fail_ir_unroll
+
+static MOJOSHADER_irStatement *build_ir_forstmt(Context *ctx,
+                                       const MOJOSHADER_astForStatement *ast)
+{
+    assert( (!ast->looptest) ||
+            (ast->looptest->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL) );
+    assert(!(ast->var_decl && ast->initializer));
+
+    MOJOSHADER_irStatement *init = NULL;
+    if (ast->var_decl != NULL)
+        init = build_ir_vardecl(ctx, ast->var_decl);
+    else if (ast->initializer != NULL)
+        init = new_ir_expr_stmt(ctx, build_ir_expr(ctx, ast->initializer));
+
+    const LoopLabels *labels = push_ir_loop(ctx, 0);
+    if (labels == NULL)
+    {
+        delete_ir(ctx, init);
+        return NULL;  // out of memory...
+    } // if
+
+    const int join = labels->end;
+    MOJOSHADER_irStatement *body = build_ir_stmt(ctx, ast->statement);
+    MOJOSHADER_irStatement *retval = NULL;
+    IrLoopCount count;
+    int iterations = -1;
+    int i;
+
+    if (ast->unroll != 0)  // not [loop]?
+    {
+        iterations = count_ir_loop(ctx, ast, &count);
+        if ((iterations >= 0) && (ir_writes_variable(ctx, body, count.var)))
+            iterations = -1;  // the body changes the count.
+    } // if
+
+    if (iterations >= 0)
+    {
+        /* The gist...
+                initializer  // if var outlives the loop.
+                statement  // with var's first value in place of var.
+            increment0:
+                move var, second value  // if var outlives the loop.
+                statement  // with var's second value, etc.
+            increment1:
+                ...
+                move var, last value  // if var outlives the loop.
+            join:
+        */
+
+        // The body's reads of the variable become constants, and
+        //  "for (int i = 0; ...)" scopes (i) to the loop, so that one never
+        //  has to be kept up to date.
+        const int keepvar = (ast->var_decl == NULL);
+        double value = count.start;
+
+        if (!keepvar)
+        {
+            delete_ir(ctx, init);
+            init = NULL;
+        } // if
+
+        if ((ast->unroll > 0) && (iterations > ast->unroll))
+        {
+            ctx->sourcefile = ast->looptest->ast.filename;
+            ctx->sourceline = ast->looptest->ast.line;
+            warnf(ctx, "Loop runs %d times, but [unroll(%d)] stops it after %d",
+                  iterations, ast->unroll, ast->unroll);
+            iterations = ast->unroll;
+        } // if
+
+        if (iterations == 0)
+            delete_ir(ctx, body);
+
+        for (i = 0; i < iterations; i++)
+        {
+            if (i > 0)
+            {
+                value = ir_loop_next(&count, value);
+                body = build_ir_loop_body(ctx, ast->statement);
+                if (keepvar)
+                    retval = new_ir_seq(ctx, retval, new_ir_loop_move(ctx, &count, value));
+            } // if
+            subst_ir_loop_var(ctx, body, &count, value);
+            retval = new_ir_seq(ctx, retval,
+                     new_ir_seq(ctx, body, new_ir_label(ctx, ctx->ir_loop->start)));
+        } // for
+
+        if ((iterations > 0) && (keepvar))
+            retval = new_ir_seq(ctx, retval, new_ir_loop_move(ctx, &count, ir_loop_next(&count, value)));
+    } // if
+
+    else if (ast->unroll > 0)
+    {
+        /* The gist...
+                initializer
+                cjump looptest == true, loop0, join
+            loop0:
+                statement
+            increment0:
+                counter
+                ...repeat (ast->unroll) times...
+            join:
+        */
+
+        for (i = 0; i < ast->unroll; i++)
+        {
+            const int loop = generate_ir_label(ctx);
+            if (i > 0)
+                body = build_ir_loop_body(ctx, ast->statement);
+            if (ast->looptest != NULL)
+                retval = new_ir_seq(ctx, retval, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->looptest), new_ir_constbool(ctx, 1), loop, join));
+            retval = new_ir_seq(ctx, retval,
+                     new_ir_seq(ctx, new_ir_label(ctx, loop),
+                     new_ir_seq(ctx, body,
+                                     new_ir_label(ctx, ctx->ir_loop->start))));
+            if (ast->counter != NULL)
+                retval = new_ir_seq(ctx, retval, new_ir_expr_stmt(ctx, build_ir_expr(ctx, ast->counter)));
+        } // for
+    } // else if
+
+    else if (ast->unroll == -1)  // plain [unroll]
+    {
+        fail_ir_unroll(ctx, (ast->looptest != NULL) ? &ast->looptest->ast : &ast->ast);
+        delete_ir(ctx, body);
+    } // else if
+
+    else
+    {
+        /* The gist...
+                initializer
+            test:
+                cjump looptest == true, loop, join
+            loop:
+                statement
+            increment:  // needs to be here; this is where "continue" jumps!
+                counter
+                jump test
+            join:
+        */
+
+        const int test = generate_ir_label(ctx);
+        const int loop = generate_ir_label(ctx);
+        const int increment = labels->start;
+        MOJOSHADER_irStatement *cjump = NULL;
+        MOJOSHADER_irStatement *counter = NULL;
+
+        if (ast->looptest != NULL)
+            cjump = new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->looptest), new_ir_constbool(ctx, 1), loop, join);
+        if (ast->counter != NULL)
+            counter = new_ir_expr_stmt(ctx, build_ir_expr(ctx, ast->counter));
+
+        retval = new_ir_seq(ctx, new_ir_label(ctx, test),
+                 new_ir_seq(ctx, cjump,
+                 new_ir_seq(ctx, new_ir_label(ctx, loop),
+                 new_ir_seq(ctx, body,
+                 new_ir_seq(ctx, new_ir_label(ctx, increment),
+                 new_ir_seq(ctx, counter,
+                                 new_ir_jump(ctx, test)))))));
+    } // else
+
+    retval = new_ir_seq(ctx, init, new_ir_seq(ctx, retval, new_ir_label(ctx, join)));
+
+    pop_ir_loop(ctx);
+
+    return new_ir_seq(ctx, retval, build_ir_stmt(ctx, ast->next));
+} // build_ir_forstmt
+
+static MOJOSHADER_irStatement *build_ir_whilestmt(Context *ctx,
+                                          const MOJOSHADER_astWhileStatement *ast)
+{
+    assert(ast->expr->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+
+    const LoopLabels *labels = push_ir_loop(ctx, 0);
+    if (labels == NULL)
+        return NULL;  // out of memory...
+
+    const int join = labels->end;
+    MOJOSHADER_irStatement *retval = NULL;
+    int i;
+
+    // !!! FIXME: count iterations for [unroll] while loops, too?
+    if (ast->unroll > 0)
+    {
+        /* The gist...
+                cjump expr == true, t0, join
+            t0:
+                statement
+            loop0:
+                ...repeat (ast->unroll) times...
+            join:
+        */
+
+        for (i = 0; i < ast->unroll; i++)
+        {
+            const int t = generate_ir_label(ctx);
+            MOJOSHADER_irExpression *expr = build_ir_expr(ctx, ast->expr);
+            MOJOSHADER_irStatement *body = (i == 0) ? build_ir_stmt(ctx, ast->statement) : build_ir_loop_body(ctx, ast->statement);
+            retval = new_ir_seq(ctx, retval,
+                     new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, expr, new_ir_constbool(ctx, 1), t, join),
+                     new_ir_seq(ctx, new_ir_label(ctx, t),
+                     new_ir_seq(ctx, body,
+                                     new_ir_label(ctx, ctx->ir_loop->start)))));
+        } // for
+        retval = new_ir_seq(ctx, retval, new_ir_label(ctx, join));
+    } // if
+
+    else if (ast->unroll == -1)  // plain [unroll]
+        fail_ir_unroll(ctx, &ast->expr->ast);
+
+    else
+    {
+        /* The gist...
+            loop:
+                cjump expr == true, t, join
+            t:
+                statement
+                jump loop
+            join:
+        */
+
+        const int loop = labels->start;
+        const int t = generate_ir_label(ctx);
+
+        retval =
+            new_ir_seq(ctx, new_ir_label(ctx, loop),
+            new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->expr), new_ir_constbool(ctx, 1), t, join),
+            new_ir_seq(ctx, new_ir_label(ctx, t),
+            new_ir_seq(ctx, build_ir_stmt(ctx, ast->statement),
+            new_ir_seq(ctx, new_ir_jump(ctx, loop),
+                            new_ir_label(ctx, join))))));
+    } // else
+
+    pop_ir_loop(ctx);
+
+    return new_ir_seq(ctx, retval, build_ir_stmt(ctx, ast->next));
+} // build_ir_whilestmt
+
+static MOJOSHADER_irStatement *build_ir_dostmt(Context *ctx,
+                                          const MOJOSHADER_astDoStatement *ast)
+{
+    assert(ast->expr->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+
+    const LoopLabels *labels = push_ir_loop(ctx, 0);
+    if (labels == NULL)
+        return NULL;  // out of memory...
+
+    const int join = labels->end;
+    MOJOSHADER_irStatement *retval = NULL;
+    int i;
+
+    if (ast->unroll > 0)
+    {
+        /* The gist...
+                statement
+            loop0:
+                cjump expr == true, t1, join
+            t1:
+                ...repeat (ast->unroll) times...
+                expr  // the last test still has to run.
+            join:
+        */
+
+        for (i = 0; i < ast->unroll; i++)
+        {
+            MOJOSHADER_irStatement *body = (i == 0) ? build_ir_stmt(ctx, ast->statement) : build_ir_loop_body(ctx, ast->statement);
+            retval = new_ir_seq(ctx, retval,
+                     new_ir_seq(ctx, body, new_ir_label(ctx, ctx->ir_loop->start)));
+            if (i == ast->unroll - 1)
+                retval = new_ir_seq(ctx, retval, new_ir_expr_stmt(ctx, build_ir_expr(ctx, ast->expr)));
+            else
+            {
+                const int t = generate_ir_label(ctx);
+                retval = new_ir_seq(ctx, retval,
+                         new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->expr), new_ir_constbool(ctx, 1), t, join),
+                                         new_ir_label(ctx, t)));
+            } // else
+        } // for
+        retval = new_ir_seq(ctx, retval, new_ir_label(ctx, join));
+    } // if
+
+    else if (ast->unroll == -1)  // plain [unroll]
+        fail_ir_unroll(ctx, &ast->expr->ast);
+
+    else
+    {
+        /* The gist...
+            loop:
+                statement
+                cjump expr == true, loop, join
+            join:
+        */
+
+        const int loop = labels->start;
+
+        retval =
+            new_ir_seq(ctx, new_ir_label(ctx, loop),
+            new_ir_seq(ctx, build_ir_stmt(ctx, ast->statement),
+            new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->expr), new_ir_constbool(ctx, 1), loop, join),
+                            new_ir_label(ctx, join))));
+    } // else
+
+    pop_ir_loop(ctx);
+
+    return new_ir_seq(ctx, retval, build_ir_stmt(ctx, ast->next));
+} // build_ir_dostmt
+
+static MOJOSHADER_irStatement *build_ir_switch(Context *ctx, const MOJOSHADER_astSwitchStatement *ast)
+{
+    // Dithering down to a list of if-statements in all cases
+    //  isn't ideal, but we can't do jumptables in D3D bytecode.
+
+    // !!! FIXME: attributes?
+
+    /* The gist...
+            move tmp, expr
+            cjump tmp == case1expr, case1, testcase2
+        testcase2:  // etc
+            cjump tmp == case2expr, case2, join
+        case1:
+            case1stmt  // might have a break in it somewhere.
+        case2:
+            case2stmt
+        join:
+    */
+
+    const LoopLabels *labels = push_ir_loop(ctx, 1);
+    if (labels == NULL)
+        return NULL;  // out of memory...
+
+    const int join = labels->end;
+    const int elems = datatype_elems(ctx, ast->expr->datatype);
+    const MOJOSHADER_astDataTypeType dt = datatype_base(ctx, ast->expr->datatype)->type;
+
+    const MOJOSHADER_astSwitchCases *cases = ast->cases;
+    const int tmp = generate_ir_temp(ctx);
+    MOJOSHADER_irStatement *startseqs = new_ir_move(ctx, new_ir_temp(ctx, tmp, dt, elems), build_ir_expr(ctx, ast->expr), -1);
+    MOJOSHADER_irStatement *testseqs = startseqs;
+    MOJOSHADER_irStatement *startcaseseqs = NULL;
+    MOJOSHADER_irStatement *caseseqs = NULL;
+    while (cases)
+    {
+        const int t = generate_ir_label(ctx);
+        const int f = (cases->next == NULL) ? join : generate_ir_label(ctx);
+        MOJOSHADER_irStatement *cjump = new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, cases->expr), new_ir_temp(ctx, tmp, dt, elems), t, f);
+
+        if (cases->next == NULL)  // last one, do the join label.
+        {
+            testseqs = new_ir_seq(ctx, testseqs, cjump);
+            caseseqs = new_ir_seq(ctx, caseseqs, new_ir_seq(ctx, new_ir_label(ctx, t), build_ir_stmt(ctx, cases->statement)));
+            caseseqs = new_ir_seq(ctx, caseseqs, new_ir_label(ctx, f));
+        } // if
+        else
+        {
+            testseqs = new_ir_seq(ctx, testseqs, new_ir_seq(ctx, cjump, new_ir_label(ctx, f)));
+            caseseqs = new_ir_seq(ctx, caseseqs, new_ir_seq(ctx, new_ir_label(ctx, t), build_ir_stmt(ctx, cases->statement)));
+        } // else
+
+        if (startcaseseqs == NULL)
+            startcaseseqs = caseseqs;
+
+        cases = cases->next;
+    } // while
+
+    pop_ir_loop(ctx);
+
+    return new_ir_seq(ctx, startseqs, new_ir_seq(ctx, startcaseseqs, build_ir_stmt(ctx, ast->next)));
+} // build_ir_switch
+
+static MOJOSHADER_irExpression *build_ir_increxpr(Context *ctx, const MOJOSHADER_astDataType *_dt,
+                                                  const int val)
+{
+    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, _dt);
+    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
+    const int elems = datatype_elems(ctx, dt);
+    MOJOSHADER_irConstant *retval = (MOJOSHADER_irConstant *) new_ir_constant(ctx, type, elems);
+    int i;
+
+    switch (type)
+    {
+        case MOJOSHADER_AST_DATATYPE_BOOL:
+        case MOJOSHADER_AST_DATATYPE_INT:
+        case MOJOSHADER_AST_DATATYPE_UINT:
+            for (i = 0; i < elems; i++)
+                retval->value.ival[i] = (int) val;
+            break;
+
+        case MOJOSHADER_AST_DATATYPE_FLOAT:
+        case MOJOSHADER_AST_DATATYPE_FLOAT_SNORM:
+        case MOJOSHADER_AST_DATATYPE_FLOAT_UNORM:
+        case MOJOSHADER_AST_DATATYPE_HALF:
+        case MOJOSHADER_AST_DATATYPE_DOUBLE:
+            for (i = 0; i < elems; i++)
+                retval->value.fval[i] = (float) val;
+            break;
+
+        default:
+            assert(0 && "Semantic analysis should have caught this!");
+    } // switch
+
+    return (MOJOSHADER_irExpression *) retval;
+} // build_ir_increxpr
+
+static MOJOSHADER_irExpression *build_ir_preincdec(Context *ctx, MOJOSHADER_astExpressionUnary *ast, const MOJOSHADER_irBinOpType binop)
+{
+    /* The gist...
+        move expr, expr + 1
+        return expr
+    */
+    // !!! FIXME: can you writemask an increment operator?
+    MOJOSHADER_irExpression *constant = build_ir_increxpr(ctx, ast->datatype, 1);
+    return new_ir_eseq(ctx,
+                new_ir_move(ctx,
+                    build_ir_expr(ctx, ast->operand),
+                    new_ir_binop(ctx, binop, build_ir_expr(ctx, ast->operand), constant), -1),
+                build_ir_expr(ctx, ast->operand));
+} // build_ir_preincdec
+
+static MOJOSHADER_irExpression *build_ir_postincdec(Context *ctx, MOJOSHADER_astExpressionUnary *ast, const MOJOSHADER_irBinOpType binop)
+{
+    /* The gist...
+        move tmp, expr
+        move expr, expr + 1
+        return tmp
+    */
+
+    // !!! FIXME: can you writemask an increment operator?
+    MOJOSHADER_irExpression *constant = build_ir_increxpr(ctx, ast->datatype, 1);
+    const int tmp = generate_ir_temp(ctx);
+    return new_ir_eseq(ctx,
+                new_ir_seq(ctx,
+                    new_ir_move(ctx, new_ir_temp(ctx, tmp, constant->info.type, constant->info.elements), build_ir_expr(ctx, ast->operand), -1),
+                    new_ir_move(ctx, build_ir_expr(ctx, ast->operand),
+                        new_ir_binop(ctx, binop, build_ir_expr(ctx, ast->operand), constant), -1)),
+                new_ir_temp(ctx, tmp, constant->info.type, constant->info.elements));
+} // build_ir_postincdec
+
+static MOJOSHADER_irExpression *build_ir_convert(Context *ctx, const MOJOSHADER_astExpressionCast *ast)
+{
+    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
+    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
+    const int elems = datatype_elems(ctx, dt);
+    const int columns = (dt->type == MOJOSHADER_AST_DATATYPE_MATRIX) ? dt->matrix.columns : 0;
+    return new_ir_convert(ctx, build_ir_expr(ctx, ast->operand), type, elems, columns);
+} // build_ir_convert
+
+static MOJOSHADER_irExprList *build_ir_exprlist(Context *ctx, MOJOSHADER_astArguments *args)
+{
+    MOJOSHADER_irExprList *retval = NULL;
+    MOJOSHADER_irExprList *prev = NULL;
+
+    while (args != NULL)
+    {
+        assert((retval && prev) || ((!retval) && (!prev)));
+
+        MOJOSHADER_irExprList *item = new_ir_exprlist(ctx, build_ir_expr(ctx, args->argument));
+        if (prev == NULL)
+            prev = retval = item;
+        else
+        {
+            prev->next = item;
+            prev = item;
+        } // else
+
+        args = args->next;
+    } // while
+
+    return retval;
+} // build_ir_exprlist
+
+static MOJOSHADER_irExpression *build_ir_constructor(Context *ctx, const MOJOSHADER_astExpressionConstructor *ast)
+{
+    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
+    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
+    const int elems = datatype_elems(ctx, dt);
+    assert(elems <= 16);  // just in case (matrix4x4 constructor is largest).
+    return new_ir_construct(ctx, build_ir_exprlist(ctx, ast->args), type, elems);
+} // build_ir_constructor
+
+static MOJOSHADER_irExpression *build_ir_call(Context *ctx, const MOJOSHADER_astExpressionCallFunction *ast)
+{
+    // void functions (like clip()) don't have a datatype.
+    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
+    const MOJOSHADER_astDataTypeType type = (dt != NULL) ? datatype_base(ctx, dt)->type : MOJOSHADER_AST_DATATYPE_NONE;
+    const int elems = (dt != NULL) ? datatype_elems(ctx, dt) : 0;
+    return new_ir_call(ctx, ast->identifier->index, build_ir_exprlist(ctx, ast->args), type, elems);
+} // build_ir_call
+
+static char swiz_to_channel(const char swiz)
+{
+    if ((swiz == 'r') || (swiz == 'x')) return 0;
+    if ((swiz == 'g') || (swiz == 'y')) return 1;
+    if ((swiz == 'b') || (swiz == 'z')) return 2;
+    if ((swiz == 'a') || (swiz == 'w')) return 3;
+    assert(0 && "Should have been caught by semantic analysis.");
+    return 0;
+} // swiz_to_channel
+
+static MOJOSHADER_irExpression *build_ir_swizzle(Context *ctx, const MOJOSHADER_astExpressionDerefStruct *ast)
+{
+    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
+    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
+    const int elems = datatype_elems(ctx, dt);
+    char chans[4] = { 0, 0, 0, 0 };
+    const char *swizstr = ast->member;
+    int i;
+
+    for (i = 0; swizstr[i]; i++)
+        chans[i] = swiz_to_channel(swizstr[i]);
+
+    return new_ir_swizzle(ctx, build_ir_expr(ctx, ast->identifier), chans, type, elems);
+} // build_ir_swizzle
+
+static MOJOSHADER_irExpression *build_ir_identifier(Context *ctx, const MOJOSHADER_astExpressionIdentifier *ast)
+{
+    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
+    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
+    const int elems = datatype_elems(ctx, dt);
+    return new_ir_memory(ctx, ast->index, type, elems);
+} // build_ir_identifier
+
+static MOJOSHADER_irExpression *build_ir_derefstruct(Context *ctx, const MOJOSHADER_astExpressionDerefStruct *ast)
+{
+    // A struct variable is an irMemory (or an irESeq that results in one),
+    //  and its members are variables of their own after it (see
+    //  datatype_member_offset()), so we offset appropriately for the member.
+    //  An element of an array of structs is an irArray of one of those, and
+    //  each member is an array of its own, so we pick that array and index
+    //  it instead. Anything else (a function's return value, say) is a
+    //  whole struct value, which we index by member number with an irArray.
+    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
+    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
+    const int elems = datatype_elems(ctx, dt);
+    const int offset = datatype_member_offset(ctx, ast->identifier->datatype, ast->member_index);
+    MOJOSHADER_irExpression *expr = build_ir_expr(ctx, ast->identifier);
+    MOJOSHADER_irExpression *finalexpr = expr;
+    MOJOSHADER_irExpression *variable = NULL;
+
+    if (expr == NULL)
+        return NULL;
+
+    assert(!ast->isswizzle);
+
+    while (finalexpr->ir.type == MOJOSHADER_IR_ESEQ)
+        finalexpr = finalexpr->eseq.expr;
+
+    if (finalexpr->ir.type == MOJOSHADER_IR_MEMORY)
+        variable = finalexpr;
+    else if (finalexpr->ir.type == MOJOSHADER_IR_ARRAY)
+    {
+        variable = finalexpr->array.array;
+        while (variable->ir.type == MOJOSHADER_IR_ESEQ)
+            variable = variable->eseq.expr;
+        if (variable->ir.type != MOJOSHADER_IR_MEMORY)
+            variable = NULL;
+    } // else if
+
+    if (variable == NULL)
+    {
+        MOJOSHADER_irExpression *member = new_ir_constant(ctx, MOJOSHADER_AST_DATATYPE_INT, 1);
+        if (member == NULL)
+        {
+            delete_ir(ctx, expr);
+            return NULL;
+        } // if
+        member->constant.value.ival[0] = ast->member_index;
+        return new_ir_array(ctx, expr, member, type, elems);
+    } // if
+
+    variable->memory.index += offset;
+    variable->info.type = type;
+    variable->info.elements = elems;
+
+    // Replace the struct type with the type of the member.
+    finalexpr->info.type = type;
+    finalexpr->info.elements = elems;
+    expr->info.type = type;
+    expr->info.elements = elems;
+
+    return expr;
+} // build_ir_derefstruct
+
+static MOJOSHADER_irExpression *build_ir_derefarray(Context *ctx, const MOJOSHADER_astExpressionBinary *ast)
+{
+    // In most compilers, arrays dither down to offsets into memory, but
+    //  they're somewhat special in D3D, since they might have to deal with
+    //  vectors, etc...so we keep them as first-class citizens of the IR,
+    //  and let the optimizer/codegen sort it out.
+    // !!! FIXME: this might be the wrong move. Maybe remove this IR node type?
+    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
+    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
+    const int elems = datatype_elems(ctx, dt);
+
+    // !!! FIXME: Array dereference of a vector can become a simple swizzle operation, if we have a constant index.
+    // !!! FIXME: Matrix dereference of a vector can become a simple reference to a temp/memory, if we have a constant index.
+    return new_ir_array(ctx, build_ir_expr(ctx, ast->left), build_ir_expr(ctx, ast->right), type, elems);
+} // build_ir_derefarray
+
+// Makes a second copy of an lvalue, so it can be both read and written. Any
+//  statements in it run when the first copy is read, so this leaves them out.
+static MOJOSHADER_irExpression *copy_ir_lvalue(Context *ctx,
+                                        const MOJOSHADER_irExpression *expr)
+{
+    const MOJOSHADER_astDataTypeType type = expr->info.type;
+    const int elems = expr->info.elements;
+    MOJOSHADER_irExpression *retval = NULL;
+
+    while (expr->ir.type == MOJOSHADER_IR_ESEQ)
+        expr = expr->eseq.expr;
+
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_TEMP:
+            return new_ir_temp(ctx, expr->temp.index, type, elems);
+
+        case MOJOSHADER_IR_MEMORY:
+            return new_ir_memory(ctx, expr->memory.index, type, elems);
+
+        case MOJOSHADER_IR_CONSTANT:  // an array index.
+            retval = new_ir_constant(ctx, type, elems);
+            if (retval != NULL)
+                memcpy(&retval->constant.value, &expr->constant.value, sizeof (retval->constant.value));
+            return retval;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            retval = copy_ir_lvalue(ctx, expr->swizzle.expr);
+            if (retval == NULL)
+                return NULL;
+            return new_ir_swizzle(ctx, retval, expr->swizzle.channels, type, elems);
+
+        case MOJOSHADER_IR_ARRAY:
+        {
+            MOJOSHADER_irExpression *array = copy_ir_lvalue(ctx, expr->array.array);
+            MOJOSHADER_irExpression *element = NULL;
+            if (array != NULL)
+                element = copy_ir_lvalue(ctx, expr->array.element);
+            if (element != NULL)
+                retval = new_ir_array(ctx, array, element, type, elems);
+            if (retval == NULL)
+            {
+                delete_ir(ctx, array);
+                delete_ir(ctx, element);
+            } // if
+            return retval;
+        } // case
+
+        default:
+            // !!! FIXME: array indices with side effects ("a[i++] += 1").
+            fail(ctx, "Assignment operators need a simpler destination here");
+            return NULL;
+    } // switch
+} // copy_ir_lvalue
+
+static MOJOSHADER_irExpression *build_ir_assign_binop(Context *ctx,
+                                                const MOJOSHADER_irBinOpType op,
+                                                const MOJOSHADER_astExpressionBinary *ast)
+{
+    MOJOSHADER_irExpression *lvalue = build_ir_expr(ctx, ast->left);
+    MOJOSHADER_irExpression *rvalue = build_ir_expr(ctx, ast->right);
+    if ((lvalue == NULL) || (rvalue == NULL))
+    {
+        delete_ir(ctx, lvalue);
+        delete_ir(ctx, rvalue);
+        return NULL;
+    } // if
+
+    const MOJOSHADER_astDataTypeType type = lvalue->info.type;
+    const int elems = lvalue->info.elements;
+    const int tmp = generate_ir_temp(ctx);
+
+    // Semantic analysis should have inserted casts if necessary.
+    assert(type == rvalue->info.type);
+    assert(elems == rvalue->info.elements);
+
+    // The destination must eventually be lvalue, which means memory or temp,
+    //  maybe swizzled or indexed.
+    MOJOSHADER_irExpression *dst = copy_ir_lvalue(ctx, lvalue);
+    if (dst == NULL)
+    {
+        delete_ir(ctx, lvalue);
+        delete_ir(ctx, rvalue);
+        return NULL;
+    } // if
+
+    // !!! FIXME: write masking!
+    return new_ir_eseq(ctx,
+                new_ir_seq(ctx,
+                    new_ir_move(ctx, new_ir_temp(ctx, tmp, type, elems), new_ir_binop(ctx, op, lvalue, rvalue), -1),
+                    new_ir_move(ctx, dst, new_ir_temp(ctx, tmp, type, elems), -1)),
+                new_ir_temp(ctx, tmp, type, elems));
+} // build_ir_assign_binop
+
+static MOJOSHADER_irExpression *build_ir_assign(Context *ctx,
+                                                const MOJOSHADER_astExpressionBinary *ast)
+{
+    MOJOSHADER_irExpression *lvalue = build_ir_expr(ctx, ast->left);
+    MOJOSHADER_irExpression *rvalue = build_ir_expr(ctx, ast->right);
+    const MOJOSHADER_astDataTypeType type = lvalue->info.type;
+    const int elems = lvalue->info.elements;
+    const int tmp = generate_ir_temp(ctx);
+
+    // Semantic analysis should have inserted casts if necessary.
+    assert(type == rvalue->info.type);
+    assert(elems == rvalue->info.elements);
+
+    // !!! FIXME: write masking!
+    // !!! FIXME: whole array/struct assignments need to become a sequence of moves.
+    return new_ir_eseq(ctx,
+                new_ir_seq(ctx,
+                    new_ir_move(ctx, new_ir_temp(ctx, tmp, type, elems), rvalue, -1),
+                    new_ir_move(ctx, lvalue, new_ir_temp(ctx, tmp, type, elems), -1)),
+                new_ir_temp(ctx, tmp, type, elems));
+} // build_ir_assign
+
+
+// Moves each initialized variable in a declaration list to its initial value.
+static MOJOSHADER_irStatement *build_ir_vardecl(Context *ctx,
+                                    const MOJOSHADER_astVariableDeclaration *ast)
+{
+    MOJOSHADER_irStatement *retval = NULL;
+
+    for (; ast != NULL; ast = ast->next)
+    {
+        if (ast->initializer == NULL)
+            continue;
+
+        ctx->sourcefile = ast->ast.filename;
+        ctx->sourceline = ast->ast.line;
+
+        const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
+        const int dttype = dt->type & ~MOJOSHADER_AST_DATATYPE_CONST;
+        if ( (dttype == MOJOSHADER_AST_DATATYPE_STRUCT) ||
+             (dttype == MOJOSHADER_AST_DATATYPE_ARRAY) )
+        {
+            // copying a whole struct or array ("S s = f();") is just a move,
+            //  like assigning one, but a list isn't something we can move.
+            const MOJOSHADER_astDataType *initdt = reduce_datatype(ctx, ast->initializer->datatype);
+            if ( (initdt == NULL) ||
+                 ((initdt->type & ~MOJOSHADER_AST_DATATYPE_CONST) != dttype) )
+            {
+                // !!! FIXME: initializer lists ("float a[2] = { 1, 2 };").
+                fail(ctx, "Initializer lists for arrays and structs aren't supported yet");
+                continue;
+            } // if
+        } // if
+
+        MOJOSHADER_irExpression *init = build_ir_expr(ctx, ast->initializer);
+        if (init == NULL)
+            continue;
+
+        MOJOSHADER_irExpression *dst = new_ir_memory(ctx, ast->index,
+                                       init->info.type, init->info.elements);
+        MOJOSHADER_irStatement *move = NULL;
+        if (dst != NULL)
+            move = new_ir_move(ctx, dst, init, -1);
+        if (move == NULL)
+        {
+            delete_ir(ctx, init);
+            delete_ir(ctx, dst);
+            continue;
+        } // if
+
+        retval = new_ir_seq(ctx, retval, move);
+    } // for
+
+    return retval;
+} // build_ir_vardecl
+
+
+// The AST must be perfect and normalized and sane here. If there are any
+//  strange corner cases, you should strive to handle them in semantic
+//  analysis, so conversion to IR can proceed with a minimum of drama.
+static void *build_ir_internal(Context *ctx, void *_ast);
+static inline MOJOSHADER_irNode *build_ir(Context *ctx, void *_ast)
+{
+    return (MOJOSHADER_irNode *) build_ir_internal(ctx, _ast);
+} // build_ir
+
+static void *build_ir_internal(Context *ctx, void *_ast)
+{
+    if ((_ast == NULL) || (ctx->out_of_memory))
+        return NULL;
+
+    MOJOSHADER_astNode *ast = (MOJOSHADER_astNode *) _ast;
+
+    // upkeep so we report correct error locations...
+    ctx->sourcefile = ast->ast.filename;
+    ctx->sourceline = ast->ast.line;
+
+    switch (ast->ast.type)
+    {
+        case MOJOSHADER_AST_OP_PREINCREMENT:  // !!! FIXME: sequence points?
+            return build_ir_preincdec(ctx, &ast->unary, MOJOSHADER_IR_BINOP_ADD);
+
+        case MOJOSHADER_AST_OP_POSTINCREMENT: // !!! FIXME: sequence points?
+            return build_ir_postincdec(ctx, &ast->unary, MOJOSHADER_IR_BINOP_ADD);
+
+        case MOJOSHADER_AST_OP_PREDECREMENT:  // !!! FIXME: sequence points?
+            return build_ir_preincdec(ctx, &ast->unary, MOJOSHADER_IR_BINOP_SUBTRACT);
+
+        case MOJOSHADER_AST_OP_POSTDECREMENT: // !!! FIXME: sequence points?
+            return build_ir_postincdec(ctx, &ast->unary, MOJOSHADER_IR_BINOP_SUBTRACT);
+
+        case MOJOSHADER_AST_OP_COMPLEMENT:
+            return NEW_IR_BINOP(XOR, build_ir_expr(ctx, ast->unary.operand),
+                                new_ir_constint(ctx, 0xFFFFFFFF));
+
+        case MOJOSHADER_AST_OP_NEGATE:  // !!! FIXME: -0.0f != +0.0f
+            return NEW_IR_BINOP(SUBTRACT, build_ir_increxpr(ctx, ast->unary.datatype, 0),
+                                build_ir_expr(ctx, ast->unary.operand));
+
+        case MOJOSHADER_AST_OP_NOT:  // operand must be bool here!
+            assert(ast->unary.operand->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+            return NEW_IR_BINOP(XOR, build_ir_expr(ctx, ast->unary.operand),
+                                new_ir_constbool(ctx, 1));
+
+        case MOJOSHADER_AST_OP_DEREF_ARRAY:
+            return build_ir_derefarray(ctx, &ast->binary);
+
+        case MOJOSHADER_AST_OP_DEREF_STRUCT:
+            if (ast->derefstruct.isswizzle)
+                return build_ir_swizzle(ctx, &ast->derefstruct);
+            return build_ir_derefstruct(ctx, &ast->derefstruct);
+
+        case MOJOSHADER_AST_OP_COMMA:
+            // evaluate and throw away left, return right.
+            return new_ir_eseq(ctx, new_ir_expr_stmt(ctx, build_ir_expr(ctx, ast->binary.left)),
+                               build_ir_expr(ctx, ast->binary.right));
+
+        case MOJOSHADER_AST_OP_LESSTHAN: return EASY_IR_COMPARE(LT);
+        case MOJOSHADER_AST_OP_GREATERTHAN: return EASY_IR_COMPARE(GT);
+        case MOJOSHADER_AST_OP_LESSTHANOREQUAL: return EASY_IR_COMPARE(LEQ);
+        case MOJOSHADER_AST_OP_GREATERTHANOREQUAL: return EASY_IR_COMPARE(GEQ);
+        case MOJOSHADER_AST_OP_NOTEQUAL: return EASY_IR_COMPARE(NEQ);
+        case MOJOSHADER_AST_OP_EQUAL: return EASY_IR_COMPARE(EQL);
+
+        case MOJOSHADER_AST_OP_MULTIPLY: return EASY_IR_BINOP(MULTIPLY);
+        case MOJOSHADER_AST_OP_DIVIDE: return EASY_IR_BINOP(DIVIDE);
+        case MOJOSHADER_AST_OP_MODULO: return EASY_IR_BINOP(MODULO);
+        case MOJOSHADER_AST_OP_ADD: return EASY_IR_BINOP(ADD);
+        case MOJOSHADER_AST_OP_SUBTRACT: return EASY_IR_BINOP(SUBTRACT);
+        case MOJOSHADER_AST_OP_LSHIFT: return EASY_IR_BINOP(LSHIFT);
+        case MOJOSHADER_AST_OP_RSHIFT: return EASY_IR_BINOP(RSHIFT);
+        case MOJOSHADER_AST_OP_BINARYAND: return EASY_IR_BINOP(AND);
+        case MOJOSHADER_AST_OP_BINARYXOR: return EASY_IR_BINOP(XOR);
+        case MOJOSHADER_AST_OP_BINARYOR: return EASY_IR_BINOP(OR);
+
+        case MOJOSHADER_AST_OP_LOGICALAND:
+            return build_ir_logical_and(ctx, &ast->binary);
+
+        case MOJOSHADER_AST_OP_LOGICALOR:
+            return build_ir_logical_or(ctx, &ast->binary);
+
+        case MOJOSHADER_AST_OP_ASSIGN:
+            return build_ir_assign(ctx, &ast->binary);
+
+        case MOJOSHADER_AST_OP_MULASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_MULTIPLY, &ast->binary);
+        case MOJOSHADER_AST_OP_DIVASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_DIVIDE, &ast->binary);
+        case MOJOSHADER_AST_OP_MODASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_MODULO, &ast->binary);
+        case MOJOSHADER_AST_OP_ADDASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_ADD, &ast->binary);
+        case MOJOSHADER_AST_OP_SUBASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_SUBTRACT, &ast->binary);
+        case MOJOSHADER_AST_OP_LSHIFTASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_LSHIFT, &ast->binary);
+        case MOJOSHADER_AST_OP_RSHIFTASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_RSHIFT, &ast->binary);
+        case MOJOSHADER_AST_OP_ANDASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_AND, &ast->binary);
+        case MOJOSHADER_AST_OP_XORASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_XOR, &ast->binary);
+        case MOJOSHADER_AST_OP_ORASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_OR, &ast->binary);
+
+        case MOJOSHADER_AST_OP_CONDITIONAL:
+            assert(ast->binary.left->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+            return build_ir_compare(ctx, MOJOSHADER_IR_COND_EQL,
+                                  build_ir_expr(ctx, ast->ternary.left),
+                                  new_ir_constbool(ctx, 1),
+                                  build_ir_expr(ctx, ast->ternary.center),
+                                  build_ir_expr(ctx, ast->ternary.right));
+
+        case MOJOSHADER_AST_OP_IDENTIFIER:
+            return build_ir_identifier(ctx, &ast->identifier);
+
+        case MOJOSHADER_AST_OP_INT_LITERAL:
+            return new_ir_constint(ctx, ast->intliteral.value);
+
+        case MOJOSHADER_AST_OP_FLOAT_LITERAL:
+            return new_ir_constfloat(ctx, ast->floatliteral.value);
+
+        case MOJOSHADER_AST_OP_BOOLEAN_LITERAL:
+            return new_ir_constbool(ctx, ast->boolliteral.value);
+
+        case MOJOSHADER_AST_OP_CALLFUNC:
+            return build_ir_call(ctx, &ast->callfunc);
+
+        case MOJOSHADER_AST_OP_CONSTRUCTOR:
+            return build_ir_constructor(ctx, &ast->constructor);
+
+        case MOJOSHADER_AST_OP_CAST:
+            return build_ir_convert(ctx, &ast->cast);
+
+        case MOJOSHADER_AST_STATEMENT_BREAK:
+        {
+            const LoopLabels *labels = ctx->ir_loop;
+            assert(labels != NULL);  // semantic analysis should catch this.
+            return new_ir_jump(ctx, labels->end);
+        } // case
+
+        case MOJOSHADER_AST_STATEMENT_CONTINUE:
+        {
+            const LoopLabels *labels = ctx->ir_loop;
+            assert(labels != NULL);  // semantic analysis should catch this.
+            return new_ir_jump(ctx, labels->start);
+        } // case
+
+        case MOJOSHADER_AST_STATEMENT_DISCARD:
+            return new_ir_seq(ctx, new_ir_discard(ctx), build_ir_stmt(ctx, ast->discardstmt.next));
+
+        case MOJOSHADER_AST_STATEMENT_EMPTY:
+            return build_ir(ctx, ast->stmt.next);  // skip it, do next thing.
+
+        case MOJOSHADER_AST_STATEMENT_EXPRESSION:
+            return new_ir_seq(ctx, new_ir_expr_stmt(ctx, build_ir_expr(ctx, ast->exprstmt.expr)), build_ir_stmt(ctx, ast->exprstmt.next));
+
+        case MOJOSHADER_AST_STATEMENT_IF:
+            return build_ir_ifstmt(ctx, &ast->ifstmt);
+
+        case MOJOSHADER_AST_STATEMENT_TYPEDEF:  // ignore this, move on.
+            return build_ir(ctx, ast->typedefstmt.next);
+
+        case MOJOSHADER_AST_STATEMENT_SWITCH:
+            return build_ir_switch(ctx, &ast->switchstmt);
+
+        case MOJOSHADER_AST_STATEMENT_STRUCT:  // ignore this, move on.
+            return build_ir(ctx, ast->structstmt.next);
+
+        case MOJOSHADER_AST_STATEMENT_VARDECL:
+            return new_ir_seq(ctx, build_ir_vardecl(ctx, ast->vardeclstmt.declaration),
+                              build_ir_stmt(ctx, ast->vardeclstmt.next));
+
+        case MOJOSHADER_AST_STATEMENT_BLOCK:
+            return new_ir_seq(ctx, build_ir_stmt(ctx, ast->blockstmt.statements), build_ir_stmt(ctx, ast->blockstmt.next));
+
+        case MOJOSHADER_AST_STATEMENT_FOR:
+            return build_ir_forstmt(ctx, &ast->forstmt);
+
+        case MOJOSHADER_AST_STATEMENT_DO:
+            return build_ir_dostmt(ctx, &ast->dostmt);
+
+        case MOJOSHADER_AST_STATEMENT_WHILE:
+            return build_ir_whilestmt(ctx, &ast->whilestmt);
+
+        case MOJOSHADER_AST_STATEMENT_RETURN:
+        {
+            const int label = ctx->ir_end;
+            assert(label >= 0);  // parser should have caught this!
+            MOJOSHADER_irStatement *retval = NULL;
+            if (ast->returnstmt.expr != NULL)
+            {
+                // !!! FIXME: whole array/struct returns need to move more into the temp.
+                const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->returnstmt.expr->datatype);
+                const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
+                const int elems = datatype_elems(ctx, dt);
+                assert(ctx->ir_ret >= 0);
+                retval = new_ir_move(ctx, new_ir_temp(ctx, ctx->ir_ret, type, elems), build_ir_expr(ctx, ast->returnstmt.expr), -1);
+            } // if
+            return new_ir_seq(ctx, retval, new_ir_jump(ctx, label));
+        } // case
+
+        case MOJOSHADER_AST_COMPUNIT_TYPEDEF:
+        case MOJOSHADER_AST_COMPUNIT_STRUCT:
+        case MOJOSHADER_AST_COMPUNIT_VARIABLE:
+        case MOJOSHADER_AST_COMPUNIT_FUNCTION:
+        case MOJOSHADER_AST_ARGUMENTS:
+        case MOJOSHADER_AST_OP_STRING_LITERAL:
+        case MOJOSHADER_AST_SWITCH_CASE:
+        case MOJOSHADER_AST_SCALAR_OR_ARRAY:
+        case MOJOSHADER_AST_TYPEDEF:
+        case MOJOSHADER_AST_FUNCTION_PARAMS:
+        case MOJOSHADER_AST_FUNCTION_SIGNATURE:
+        case MOJOSHADER_AST_STRUCT_DECLARATION:
+        case MOJOSHADER_AST_STRUCT_MEMBER:
+        case MOJOSHADER_AST_VARIABLE_DECLARATION:
+        case MOJOSHADER_AST_ANNOTATION:
+        case MOJOSHADER_AST_PACK_OFFSET:
+        case MOJOSHADER_AST_VARIABLE_LOWLEVEL:
+            assert(0 && "Shouldn't hit this in build_ir.");
+            return NULL;
+
+        default:
+            assert(0 && "unexpected type");
+            return NULL;
+    } // switch
+} // build_ir
+
+#if DEBUG_COMPILER_IR
+static MOJOSHADER_irStatement *ir_tree_view(Context *ctx, const IrFlat *flat);
+static void print_ir(FILE *io, unsigned int depth, void *_ir)
+{
+    MOJOSHADER_irNode *ir = (MOJOSHADER_irNode *) _ir;
+    if (ir == NULL)
+        return;
+
+    const char *fname = strrchr(ir->ir.filename, '/');
+    if (fname != NULL)
+        fname++;
+    else
+    {
+        fname = strrchr(ir->ir.filename, '\\');
+        if (fname != NULL)
+            fname++;
+        else
+            fname = ir->ir.filename;
+    } // else
+
+    int i;
+    for (i = 0; i < depth; i++)
+        fprintf(io, "  ");
+    depth++;
+
+    fprintf(io, "[ %s:%d ", fname, ir->ir.line);
+
+    switch (ir->ir.type)
+    {
+        case MOJOSHADER_IR_LABEL:
+            fprintf(io, "LABEL %d ]\n", ir->stmt.label.index);
+            break;
+
+        case MOJOSHADER_IR_CONSTANT:
+            fprintf(io, "CONSTANT ");
+            switch (ir->expr.constant.info.type)
+            {
+                case MOJOSHADER_AST_DATATYPE_BOOL:
+                case MOJOSHADER_AST_DATATYPE_INT:
+                case MOJOSHADER_AST_DATATYPE_UINT:
+                    for (i = 0; i < ir->expr.constant.info.elements-1; i++)
+                        fprintf(io, "%d, ", ir->expr.constant.value.ival[i]);
+                    if (ir->expr.constant.info.elements > 0)
+                        fprintf(io, "%d", ir->expr.constant.value.ival[i]);
+                    break;
+
+                case MOJOSHADER_AST_DATATYPE_FLOAT:
+                case MOJOSHADER_AST_DATATYPE_FLOAT_SNORM:
+                case MOJOSHADER_AST_DATATYPE_FLOAT_UNORM:
+                case MOJOSHADER_AST_DATATYPE_HALF:
+                case MOJOSHADER_AST_DATATYPE_DOUBLE:
+                    for (i = 0; i < ir->expr.constant.info.elements-1; i++)
+                        fprintf(io, "%ff, ", ir->expr.constant.value.fval[i]);
+                    if (ir->expr.constant.info.elements > 0)
+                        fprintf(io, "%ff", ir->expr.constant.value.fval[i]);
+                    break;
+
+                default: assert(0 && "shouldn't happen");
+            } // switch
+            fprintf(io, " ]\n");
+            break;
+
+        case MOJOSHADER_IR_TEMP:
+            fprintf(io, "TEMP %d ]\n", ir->expr.temp.index);
+            break;
+
+        case MOJOSHADER_IR_DISCARD:
+            fprintf(io, "DISCARD ]\n");
+            break;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            fprintf(io, "SWIZZLE");
+            for (i = 0; i < ir->expr.swizzle.info.elements-1; i++)
+                fprintf(io, " %d", (int) ir->expr.swizzle.channels[i]);
+            fprintf(io, " ]\n");
+            print_ir(io, depth, ir->expr.swizzle.expr);
+            break;
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            fprintf(io, "CONSTRUCT ]\n");
+            print_ir(io, depth, ir->expr.construct.args);
+            break;
+
+        case MOJOSHADER_IR_SELECT:
+            fprintf(io, "SELECT ]\n");
+            print_ir(io, depth, ir->expr.select.cond);
+            print_ir(io, depth, ir->expr.select.iftrue);
+            print_ir(io, depth, ir->expr.select.iffalse);
+            break;
+
+        case MOJOSHADER_IR_CONVERT:
+            if (ir->expr.convert.columns)
+                fprintf(io, "CONVERT columns %d ]\n", ir->expr.convert.columns);
+            else
+                fprintf(io, "CONVERT ]\n");
+            print_ir(io, depth, ir->expr.convert.expr);
+            break;
+
+        case MOJOSHADER_IR_BINOP:
+            fprintf(io, "BINOP ");
+            switch (ir->expr.binop.op)
+            {
+                #define PRINT_IR_BINOP(x) \
+                    case MOJOSHADER_IR_BINOP_##x: fprintf(io, #x); break;
+                PRINT_IR_BINOP(ADD)
+                PRINT_IR_BINOP(SUBTRACT)
+                PRINT_IR_BINOP(MULTIPLY)
+                PRINT_IR_BINOP(DIVIDE)
+                PRINT_IR_BINOP(MODULO)
+                PRINT_IR_BINOP(AND)
+                PRINT_IR_BINOP(OR)
+                PRINT_IR_BINOP(XOR)
+                PRINT_IR_BINOP(LSHIFT)
+                PRINT_IR_BINOP(RSHIFT)
+                PRINT_IR_BINOP(UNKNOWN)
+                #undef PRINT_IR_BINOP
+                default: assert(0 && "unexpected case"); break;
+            } // switch
+            fprintf(io, " ]\n");
+            print_ir(io, depth, ir->expr.binop.left);
+            print_ir(io, depth, ir->expr.binop.right);
+            break;
+
+        case MOJOSHADER_IR_MEMORY:
+            fprintf(io, "MEMORY %d ]\n", ir->expr.memory.index);
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            fprintf(io, "CALL %d ]\n", ir->expr.call.index);
+            print_ir(io, depth, ir->expr.call.args);
+            break;
+
+        case MOJOSHADER_IR_ESEQ:
+            fprintf(io, "ESEQ ]\n");
+            print_ir(io, depth, ir->expr.eseq.stmt);
+            break;
+
+        case MOJOSHADER_IR_ARRAY:
+            fprintf(io, "ARRAY ]\n");
+            print_ir(io, depth, ir->expr.array.array);
+            print_ir(io, depth, ir->expr.array.element);
+            break;
+
+        case MOJOSHADER_IR_MOVE:
+            fprintf(io, "MOVE ]\n");
+            print_ir(io, depth, ir->stmt.move.dst);
+            print_ir(io, depth, ir->stmt.move.src);
+            break;
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            fprintf(io, "EXPRSTMT ]\n");
+            print_ir(io, depth, ir->stmt.expr.expr);
+            break;
+
+        case MOJOSHADER_IR_JUMP:
+            fprintf(io, "JUMP %d ]\n", ir->stmt.jump.label);
+            break;
+
+        case MOJOSHADER_IR_CJUMP:
+            fprintf(io, "CJUMP ");
+            switch (ir->stmt.cjump.cond)
+            {
+                #define PRINT_IR_COND(x) \
+                    case MOJOSHADER_IR_COND_##x: fprintf(io, #x); break;
+                PRINT_IR_COND(EQL)
+                PRINT_IR_COND(NEQ)
+                PRINT_IR_COND(LT)
+                PRINT_IR_COND(GT)
+                PRINT_IR_COND(LEQ)
+                PRINT_IR_COND(GEQ)
+                PRINT_IR_COND(UNKNOWN)
+                #undef PRINT_IR_COND
+                default: assert(0 && "unexpected case"); break;
+            } // switch
+            fprintf(io, " %d %d%s ]\n", ir->stmt.cjump.iftrue, ir->stmt.cjump.iffalse,
+                    ir->stmt.cjump.branch ? " BRANCH" : "");
+            print_ir(io, depth, ir->stmt.cjump.left);
+            print_ir(io, depth, ir->stmt.cjump.right);
+            break;
+
+        case MOJOSHADER_IR_SEQ:
+        {
+            // a whole chain of SEQs prints as one list, so long functions
+            //  don't indent (or recurse) any deeper than short ones.
+            const MOJOSHADER_irStatement *seq = &ir->stmt;
+            fprintf(io, "SEQ ]\n");
+            while (seq->ir.type == MOJOSHADER_IR_SEQ)
+            {
+                print_ir(io, depth, seq->seq.first);
+                seq = seq->seq.next;
+            } // while
+            print_ir(io, depth, (void *) seq);
+            break;
+        } // case
+
+        case MOJOSHADER_IR_EXPRLIST:
+            fprintf(io, "EXPRLIST ]\n");
+            print_ir(io, depth, ir->misc.exprlist.expr);
+            print_ir(io, depth, ir->misc.exprlist.next);  // !!! FIXME: don't recurse?
+            break;
+
+        default: assert(0 && "unexpected IR node"); break;
+    } // switch
+} // print_ir
+
+static void print_whole_ir(Context *ctx, FILE *io)
+{
+    if (ctx->ir != NULL)
+    {
+        int i;
+        for (i = 0; i <= ctx->user_func_index; i++)
+        {
+            printf("[FUNCTION %d ]\n", i);
+            print_ir(io, 1, ir_tree_view(ctx, &ctx->ir[i]));
+        } // for
+    } // if
+} // print_whole_ir
+#endif
+
+static void delete_ir(Context *ctx, void *_ir)
+{
+    MOJOSHADER_irNode *ir = (MOJOSHADER_irNode *) _ir;
+
+    // walk down chains of SEQs instead of recursing on them.
+    while ((ir != NULL) && (ir->ir.type == MOJOSHADER_IR_SEQ))
+    {
+        MOJOSHADER_irNode *next = (MOJOSHADER_irNode *) ir->stmt.seq.next;
+        delete_ir(ctx, ir->stmt.seq.first);
+        Free(ctx, ir);
+        ir = next;
+    } // while
+
+    if (ir == NULL)
+        return;
+
+    switch (ir->ir.type)
+    {
+        case MOJOSHADER_IR_JUMP:
+        case MOJOSHADER_IR_LABEL:
+        case MOJOSHADER_IR_CONSTANT:
+        case MOJOSHADER_IR_TEMP:
+        case MOJOSHADER_IR_DISCARD:
+        case MOJOSHADER_IR_MEMORY:
+            break;  // nothing extra to free here.
+
+        case MOJOSHADER_IR_BINOP:
+            delete_ir(ctx, ir->expr.binop.left);
+            delete_ir(ctx, ir->expr.binop.right);
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            delete_ir(ctx, ir->expr.call.args);
+            break;
+
+        case MOJOSHADER_IR_ESEQ:
+            delete_ir(ctx, ir->expr.eseq.stmt);
+            delete_ir(ctx, ir->expr.eseq.expr);
+            break;
+
+        case MOJOSHADER_IR_ARRAY:
+            delete_ir(ctx, ir->expr.array.array);
+            delete_ir(ctx, ir->expr.array.element);
+            break;
+
+        case MOJOSHADER_IR_MOVE:
+            delete_ir(ctx, ir->stmt.move.dst);
+            delete_ir(ctx, ir->stmt.move.src);
+            break;
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            delete_ir(ctx, ir->stmt.expr.expr);
+            break;
+
+        case MOJOSHADER_IR_CJUMP:
+            delete_ir(ctx, ir->stmt.cjump.left);
+            delete_ir(ctx, ir->stmt.cjump.right);
+            break;
+
+        case MOJOSHADER_IR_EXPRLIST:
+            delete_ir(ctx, ir->misc.exprlist.expr);
+            delete_ir(ctx, ir->misc.exprlist.next);  // !!! FIXME: don't recurse?
+            break;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            delete_ir(ctx, ir->expr.swizzle.expr);
+            break;
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            delete_ir(ctx, ir->expr.construct.args);
+            break;
+
+        case MOJOSHADER_IR_SELECT:
+            delete_ir(ctx, ir->expr.select.cond);
+            delete_ir(ctx, ir->expr.select.iftrue);
+            delete_ir(ctx, ir->expr.select.iffalse);
+            break;
+
+        case MOJOSHADER_IR_CONVERT:
+            delete_ir(ctx, ir->expr.convert.expr);
+            break;
+
+        default: assert(0 && "unexpected IR node"); break;
+    } // switch
+
+    Free(ctx, ir);
+} // delete_ir
+
+/* IR optimization... */
+
+// Each function's IR starts out as a tree of SEQs, with ESEQs hiding more
+//  statements inside expressions. canonicalize_ir() flattens that into a
+//  list of statements in execution order, none of them a SEQ or containing
+//  an ESEQ, and every pass after that works on the list. optimize_ir()
+//  turns the list back into a chain of SEQs when it's done.
+typedef struct IrStatementList
+{
+    MOJOSHADER_irStatement **stmts;
+    int count;
+    int allocated;
+} IrStatementList;
+
+// Returns zero if out of memory, in which case (stmt) is still yours.
+static int ir_list_insert(Context *ctx, IrStatementList *list, const int pos,
+                          MOJOSHADER_irStatement *stmt)
+{
+    assert((pos >= 0) && (pos <= list->count));
+    if (list->count >= list->allocated)
+    {
+        const int allocated = (list->allocated == 0) ? 64 : list->allocated * 2;
+        const size_t len = sizeof (MOJOSHADER_irStatement *) * allocated;
+        MOJOSHADER_irStatement **stmts = (MOJOSHADER_irStatement **) Malloc(ctx, len);
+        if (stmts == NULL)
+            return 0;
+        else if (list->stmts != NULL)
+        {
+            memcpy(stmts, list->stmts, sizeof (MOJOSHADER_irStatement *) * list->count);
+            Free(ctx, list->stmts);
+        } // else if
+        list->stmts = stmts;
+        list->allocated = allocated;
+    } // if
+
+    memmove(&list->stmts[pos + 1], &list->stmts[pos],
+            sizeof (MOJOSHADER_irStatement *) * (list->count - pos));
+    list->stmts[pos] = stmt;
+    list->count++;
+    return 1;
+} // ir_list_insert
+
+// Takes ownership of (stmt) either way.
+static void ir_list_add(Context *ctx, IrStatementList *list,
+                        MOJOSHADER_irStatement *stmt)
+{
+    if ((stmt != NULL) && (!ir_list_insert(ctx, list, list->count, stmt)))
+        delete_ir(ctx, stmt);
+} // ir_list_add
+
+static void ir_list_free(Context *ctx, IrStatementList *list)
+{
+    int i;
+    for (i = 0; i < list->count; i++)
+        delete_ir(ctx, list->stmts[i]);
+    if (list->stmts != NULL)
+        Free(ctx, list->stmts);
+    memset(list, '\0', sizeof (IrStatementList));
+} // ir_list_free
+
+static inline int ir_type_is_scalar(const MOJOSHADER_astDataTypeType type)
+{
+    switch (type)
+    {
+        case MOJOSHADER_AST_DATATYPE_BOOL:
+        case MOJOSHADER_AST_DATATYPE_INT:
+        case MOJOSHADER_AST_DATATYPE_UINT:
+        case MOJOSHADER_AST_DATATYPE_FLOAT:
+        case MOJOSHADER_AST_DATATYPE_FLOAT_SNORM:
+        case MOJOSHADER_AST_DATATYPE_FLOAT_UNORM:
+        case MOJOSHADER_AST_DATATYPE_HALF:
+        case MOJOSHADER_AST_DATATYPE_DOUBLE:
+            return 1;
+        default:
+            return 0;
+    } // switch
+} // ir_type_is_scalar
+
+static inline int ir_type_is_float(const MOJOSHADER_astDataTypeType type)
+{
+    switch (type)
+    {
+        case MOJOSHADER_AST_DATATYPE_FLOAT:
+        case MOJOSHADER_AST_DATATYPE_FLOAT_SNORM:
+        case MOJOSHADER_AST_DATATYPE_FLOAT_UNORM:
+        case MOJOSHADER_AST_DATATYPE_HALF:
+        case MOJOSHADER_AST_DATATYPE_DOUBLE:
+            return 1;
+        default:
+            return 0;
+    } // switch
+} // ir_type_is_float
+
+
+// Calls (visit) on (*slot) and, if it returns non-zero, on every expression
+//  inside it, outermost first. (visit) may replace (*slot) before returning.
+//  This is for canonical IR, so there are no ESEQs to look inside.
+typedef int (*IrExprVisitor)(Context *ctx, MOJOSHADER_irExpression **slot,
+                             void *data);
+
+static void visit_ir_expr(Context *ctx, MOJOSHADER_irExpression **slot,
+                          IrExprVisitor visit, void *data)
+{
+    MOJOSHADER_irExprList *args = NULL;
+    MOJOSHADER_irExpression *expr = *slot;
+    if ((expr == NULL) || (!visit(ctx, slot, data)))
+        return;
+
+    expr = *slot;
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_BINOP:
+            visit_ir_expr(ctx, &expr->binop.left, visit, data);
+            visit_ir_expr(ctx, &expr->binop.right, visit, data);
+            break;
+
+        case MOJOSHADER_IR_ARRAY:
+            visit_ir_expr(ctx, &expr->array.array, visit, data);
+            visit_ir_expr(ctx, &expr->array.element, visit, data);
+            break;
+
+        case MOJOSHADER_IR_CONVERT:
+            visit_ir_expr(ctx, &expr->convert.expr, visit, data);
+            break;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            visit_ir_expr(ctx, &expr->swizzle.expr, visit, data);
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            for (args = expr->call.args; args != NULL; args = args->next)
+                visit_ir_expr(ctx, &args->expr, visit, data);
+            break;
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            for (args = expr->construct.args; args != NULL; args = args->next)
+                visit_ir_expr(ctx, &args->expr, visit, data);
+            break;
+
+        case MOJOSHADER_IR_SELECT:
+            visit_ir_expr(ctx, &expr->select.cond, visit, data);
+            visit_ir_expr(ctx, &expr->select.iftrue, visit, data);
+            visit_ir_expr(ctx, &expr->select.iffalse, visit, data);
+            break;
+
+        case MOJOSHADER_IR_ESEQ:
+            assert(0 && "canonicalize_ir() should have removed this");
+            break;
+
+        default: break;  // nothing inside the others.
+    } // switch
+} // visit_ir_expr
+
+// The TEMP or MEMORY that a MOVE writes, even if it only writes part of it.
+static MOJOSHADER_irExpression *ir_dest_base(MOJOSHADER_irExpression *dst)
+{
+    while (dst != NULL)
+    {
+        if (dst->ir.type == MOJOSHADER_IR_SWIZZLE)
+            dst = dst->swizzle.expr;
+        else if (dst->ir.type == MOJOSHADER_IR_ARRAY)
+            dst = dst->array.array;
+        else
+            break;
+    } // while
+    return dst;
+} // ir_dest_base
+
+// Calls visit_ir_expr() on every expression that (stmt) reads. The only
+//  reads in a MOVE's destination are array indices.
+static void visit_ir_reads(Context *ctx, MOJOSHADER_irStatement *stmt,
+                           IrExprVisitor visit, void *data)
+{
+    MOJOSHADER_irExpression *dst = NULL;
+    switch (stmt->ir.type)
+    {
+        case MOJOSHADER_IR_MOVE:
+            for (dst = stmt->move.dst; dst != NULL; )
+            {
+                if (dst->ir.type == MOJOSHADER_IR_SWIZZLE)
+                    dst = dst->swizzle.expr;
+                else if (dst->ir.type == MOJOSHADER_IR_ARRAY)
+                {
+                    visit_ir_expr(ctx, &dst->array.element, visit, data);
+                    dst = dst->array.array;
+                } // else if
+                else
+                    break;
+            } // for
+            visit_ir_expr(ctx, &stmt->move.src, visit, data);
+            break;
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            visit_ir_expr(ctx, &stmt->expr.expr, visit, data);
+            break;
+
+        case MOJOSHADER_IR_CJUMP:
+            visit_ir_expr(ctx, &stmt->cjump.left, visit, data);
+            visit_ir_expr(ctx, &stmt->cjump.right, visit, data);
+            break;
+
+        default: break;  // nothing read by the others.
+    } // switch
+} // visit_ir_reads
+
+static int find_ir_node_type(Context *ctx, MOJOSHADER_irExpression **slot,
+                             void *data)
+{
+    MOJOSHADER_irNodeType *type = (MOJOSHADER_irNodeType *) data;
+    if ((*slot)->ir.type != *type)
+        return 1;
+    *type = MOJOSHADER_IR_START_RANGE_EXPR;  // found it, stop looking.
+    return 0;
+} // find_ir_node_type
+
+static int ir_expr_contains(Context *ctx, MOJOSHADER_irExpression *expr,
+                            MOJOSHADER_irNodeType type)
+{
+    visit_ir_expr(ctx, &expr, find_ir_node_type, &type);
+    return (type == MOJOSHADER_IR_START_RANGE_EXPR);
+} // ir_expr_contains
+
+static int ir_stmt_contains(Context *ctx, MOJOSHADER_irStatement *stmt,
+                            MOJOSHADER_irNodeType type)
+{
+    visit_ir_reads(ctx, stmt, find_ir_node_type, &type);
+    return (type == MOJOSHADER_IR_START_RANGE_EXPR);
+} // ir_stmt_contains
+
+// User functions can write globals and intrinsics can have "out" params, so
+//  anything that makes a call has side effects as far as we're concerned.
+static inline int ir_expr_has_call(Context *ctx, MOJOSHADER_irExpression *expr)
+{
+    return ir_expr_contains(ctx, expr, MOJOSHADER_IR_CALL);
+} // ir_expr_has_call
+
+static inline int ir_stmt_has_call(Context *ctx, MOJOSHADER_irStatement *stmt)
+{
+    return ir_stmt_contains(ctx, stmt, MOJOSHADER_IR_CALL);
+} // ir_stmt_has_call
+
+static inline int ir_expr_reads_memory(Context *ctx, MOJOSHADER_irExpression *expr)
+{
+    return ir_expr_contains(ctx, expr, MOJOSHADER_IR_MEMORY);
+} // ir_expr_reads_memory
+
+typedef struct IrTempCounts
+{
+    int *reads;
+    int *writes;
+    int total;
+    int aggregates;  // non-zero if any temp holds a struct, etc.
+} IrTempCounts;
+
+static int count_ir_temp_reads(Context *ctx, MOJOSHADER_irExpression **slot,
+                               void *data)
+{
+    IrTempCounts *counts = (IrTempCounts *) data;
+    const MOJOSHADER_irExpression *expr = *slot;
+    if (expr->ir.type == MOJOSHADER_IR_TEMP)
+    {
+        if (!ir_type_is_scalar(expr->info.type))
+            counts->aggregates = 1;
+        if ((expr->temp.index >= 0) && (expr->temp.index < counts->total))
+            counts->reads[expr->temp.index]++;
+    } // if
+    return 1;
+} // count_ir_temp_reads
+
+// Counts how many times each temp is read and written in (list). Returns
+//  zero if out of memory. Free (counts->reads) when done.
+static int count_ir_temps(Context *ctx, IrStatementList *list,
+                          IrTempCounts *counts)
+{
+    const int total = ctx->ir_temp_count;
+    const size_t len = sizeof (int) * (total > 0 ? total : 1) * 2;
+    int i;
+
+    counts->reads = (int *) Malloc(ctx, len);
+    if (counts->reads == NULL)
+        return 0;
+    memset(counts->reads, '\0', len);
+    counts->writes = counts->reads + total;
+    counts->total = total;
+    counts->aggregates = 0;
+
+    for (i = 0; i < list->count; i++)
+    {
+        MOJOSHADER_irStatement *stmt = list->stmts[i];
+        visit_ir_reads(ctx, stmt, count_ir_temp_reads, counts);
+        if (stmt->ir.type == MOJOSHADER_IR_MOVE)
+        {
+            const MOJOSHADER_irExpression *dst = ir_dest_base(stmt->move.dst);
+            if (dst->ir.type == MOJOSHADER_IR_TEMP)
+            {
+                if (!ir_type_is_scalar(dst->info.type))
+                    counts->aggregates = 1;
+                if ((dst->temp.index >= 0) && (dst->temp.index < total))
+                    counts->writes[dst->temp.index]++;
+            } // if
+        } // if
+    } // for
+
+    return 1;
+} // count_ir_temps
+
+
+// Statistics...
+
+static void count_ir(Context *ctx, const void *_ir, IrCounts *counts,
+                     uint8 *temps, const int total)
+{
+    const MOJOSHADER_irNode *ir = (const MOJOSHADER_irNode *) _ir;
+
+    while ((ir != NULL) && (ir->ir.type == MOJOSHADER_IR_SEQ))
+    {
+        count_ir(ctx, ir->stmt.seq.first, counts, temps, total);
+        ir = (const MOJOSHADER_irNode *) ir->stmt.seq.next;
+    } // while
+
+    if (ir == NULL)
+        return;
+
+    if (ir->ir.type == MOJOSHADER_IR_EXPRLIST)
+    {
+        const MOJOSHADER_irExprList *list;
+        for (list = &ir->misc.exprlist; list != NULL; list = list->next)
+            count_ir(ctx, list->expr, counts, temps, total);
+        return;
+    } // if
+
+    counts->nodes++;
+    if ((ir->ir.type > MOJOSHADER_IR_START_RANGE_STMT) &&
+        (ir->ir.type < MOJOSHADER_IR_END_RANGE_STMT) &&
+        (ir->ir.type != MOJOSHADER_IR_LABEL))
+        counts->instructions++;
+
+    switch (ir->ir.type)
+    {
+        case MOJOSHADER_IR_TEMP:
+        {
+            const int index = ir->expr.temp.index;
+            if ((index >= 0) && (index < total) && (!temps[index]))
+            {
+                temps[index] = 1;
+                counts->temps++;
+            } // if
+            break;
+        } // case
+
+        case MOJOSHADER_IR_BINOP:
+            count_ir(ctx, ir->expr.binop.left, counts, temps, total);
+            count_ir(ctx, ir->expr.binop.right, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            count_ir(ctx, ir->expr.call.args, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_ESEQ:
+            count_ir(ctx, ir->expr.eseq.stmt, counts, temps, total);
+            count_ir(ctx, ir->expr.eseq.expr, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_ARRAY:
+            count_ir(ctx, ir->expr.array.array, counts, temps, total);
+            count_ir(ctx, ir->expr.array.element, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_CONVERT:
+            count_ir(ctx, ir->expr.convert.expr, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            count_ir(ctx, ir->expr.swizzle.expr, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            count_ir(ctx, ir->expr.construct.args, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_SELECT:
+            count_ir(ctx, ir->expr.select.cond, counts, temps, total);
+            count_ir(ctx, ir->expr.select.iftrue, counts, temps, total);
+            count_ir(ctx, ir->expr.select.iffalse, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_MOVE:
+            count_ir(ctx, ir->stmt.move.dst, counts, temps, total);
+            count_ir(ctx, ir->stmt.move.src, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            count_ir(ctx, ir->stmt.expr.expr, counts, temps, total);
+            break;
+
+        case MOJOSHADER_IR_CJUMP:
+            count_ir(ctx, ir->stmt.cjump.left, counts, temps, total);
+            count_ir(ctx, ir->stmt.cjump.right, counts, temps, total);
+            break;
+
+        default: break;  // nothing inside the others.
+    } // switch
+} // count_ir
+
+// (list) is NULL if (ir) is still a tree.
+static void add_ir_counts(Context *ctx, IrCounts *counts,
+                          const MOJOSHADER_irStatement *ir,
+                          const IrStatementList *list)
+{
+    const int total = ctx->ir_temp_count;
+    uint8 *temps = (uint8 *) Malloc(ctx, total > 0 ? total : 1);
+    int i;
+
+    if (temps == NULL)
+        return;
+
+    memset(temps, '\0', total);
+    if (list == NULL)
+        count_ir(ctx, ir, counts, temps, total);
+    else
+    {
+        for (i = 0; i < list->count; i++)
+            count_ir(ctx, list->stmts[i], counts, temps, total);
+    } // else
+
+    Free(ctx, temps);
+} // add_ir_counts
+
+static const char *ir_pass_names[IR_PASS_TOTAL] = {
+    "canonicalize", "fold constants", "propagate copies",
+    "common subexpressions", "dead code"
+};
+
+#if DEBUG_COMPILER_IR
+static void print_ir_stats(Context *ctx, FILE *io)
+{
+    int i;
+    for (i = 0; i < IR_PASS_TOTAL; i++)
+    {
+        const IrPassStats *stats = &ctx->ir_stats[i];
+        fprintf(io, "[OPTIMIZE %s: %d -> %d instructions, %d -> %d nodes,"
+                    " %d -> %d temps, %d changes ]\n", ir_pass_names[i],
+                    stats->before.instructions, stats->after.instructions,
+                    stats->before.nodes, stats->after.nodes,
+                    stats->before.temps, stats->after.temps, stats->changes);
+    } // for
+} // print_ir_stats
+#endif
+
+
+// Canonicalization...
+
+static void linearize_ir(Context *ctx, IrStatementList *list,
+                         MOJOSHADER_irStatement *stmt);
+
+// Evaluates (*slot) into a new temp at (pos) in (list), since something
+//  that runs after it was evaluated is being hoisted in front of it.
+//  Returns the number of statements added.
+static int spill_ir_expr(Context *ctx, IrStatementList *list, const int pos,
+                         MOJOSHADER_irExpression **slot)
+{
+    MOJOSHADER_irExpression *expr = *slot;
+    if ((expr == NULL) || (expr->ir.type == MOJOSHADER_IR_CONSTANT))
+        return 0;  // constants don't care what happens around them.
+
+    const MOJOSHADER_astDataTypeType type = expr->info.type;
+    const int elements = expr->info.elements;
+    const int tmp = generate_ir_temp(ctx);
+    MOJOSHADER_irExpression *dst = new_ir_temp(ctx, tmp, type, elements);
+    MOJOSHADER_irExpression *use = new_ir_temp(ctx, tmp, type, elements);
+    MOJOSHADER_irStatement *move = NULL;
+
+    if ((dst != NULL) && (use != NULL))
+        move = new_ir_move(ctx, dst, expr, -1);
+
+    if ((move == NULL) || (!ir_list_insert(ctx, list, pos, move)))
+    {
+        if (move != NULL)
+            move->move.src = NULL;  // (expr) stays where it was.
+        delete_ir(ctx, (move != NULL) ? (void *) move : (void *) dst);
+        delete_ir(ctx, use);
+        return 0;
+    } // if
+
+    *slot = use;
+    return 1;
+} // spill_ir_expr
+
+static void lift_ir_expr(Context *ctx, IrStatementList *list,
+                         MOJOSHADER_irExpression **slot);
+
+// Lifts the ESEQs out of each expression in turn. If that puts statements
+//  in front of operands that were already evaluated, those operands have to
+//  be evaluated into temps first, or the statements might change them.
+static void lift_ir_exprlist(Context *ctx, IrStatementList *list,
+                             MOJOSHADER_irExprList *args)
+{
+    MOJOSHADER_irExprList *item;
+    for (item = args; item != NULL; item = item->next)
+    {
+        const int mark = list->count;
+        lift_ir_expr(ctx, list, &item->expr);
+        if (list->count > mark)
+        {
+            MOJOSHADER_irExprList *prev;
+            int pos = mark;
+            for (prev = args; prev != item; prev = prev->next)
+                pos += spill_ir_expr(ctx, list, pos, &prev->expr);
+        } // if
+    } // for
+} // lift_ir_exprlist
+
+static void lift_ir_pair(Context *ctx, IrStatementList *list,
+                         MOJOSHADER_irExpression **left,
+                         MOJOSHADER_irExpression **right)
+{
+    lift_ir_expr(ctx, list, left);
+    const int mark = list->count;
+    lift_ir_expr(ctx, list, right);
+    if (list->count > mark)
+        spill_ir_expr(ctx, list, mark, left);
+} // lift_ir_pair
+
+// Moves every ESEQ's statements out of (*slot) and onto the end of (list),
+//  leaving just the expressions behind.
+static void lift_ir_expr(Context *ctx, IrStatementList *list,
+                         MOJOSHADER_irExpression **slot)
+{
+    MOJOSHADER_irExpression *expr = *slot;
+    if (expr == NULL)
+        return;
+
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_ESEQ:
+            linearize_ir(ctx, list, expr->eseq.stmt);
+            *slot = expr->eseq.expr;
+            Free(ctx, expr);
+            ctx->ir_stats[IR_PASS_CANONICALIZE].changes++;
+            lift_ir_expr(ctx, list, slot);
+            break;
+
+        case MOJOSHADER_IR_BINOP:
+            lift_ir_pair(ctx, list, &expr->binop.left, &expr->binop.right);
+            break;
+
+        case MOJOSHADER_IR_ARRAY:
+            // the array itself is a place, not a value, so it never needs
+            //  a temp; just its index might.
+            lift_ir_expr(ctx, list, &expr->array.array);
+            lift_ir_expr(ctx, list, &expr->array.element);
+            break;
+
+        case MOJOSHADER_IR_CONVERT:
+            lift_ir_expr(ctx, list, &expr->convert.expr);
+            break;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            lift_ir_expr(ctx, list, &expr->swizzle.expr);
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            lift_ir_exprlist(ctx, list, expr->call.args);
+            break;
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            lift_ir_exprlist(ctx, list, expr->construct.args);
+            break;
+
+        case MOJOSHADER_IR_SELECT:
+        {
+            lift_ir_pair(ctx, list, &expr->select.cond, &expr->select.iftrue);
+            const int mark = list->count;
+            lift_ir_expr(ctx, list, &expr->select.iffalse);
+            if (list->count > mark)
+            {
+                const int pos = mark + spill_ir_expr(ctx, list, mark, &expr->select.cond);
+                spill_ir_expr(ctx, list, pos, &expr->select.iftrue);
+            } // if
+            break;
+        } // case
+
+        default: break;  // nothing inside the others.
+    } // switch
+} // lift_ir_expr
+
+// If (dst) indexes an array, spill the indices, since statements that were
+//  lifted out of the MOVE's source will run before them now.
+static void spill_ir_dest_indices(Context *ctx, IrStatementList *list,
+                                  int pos, MOJOSHADER_irExpression *dst)
+{
+    while (dst != NULL)
+    {
+        if (dst->ir.type == MOJOSHADER_IR_SWIZZLE)
+            dst = dst->swizzle.expr;
+        else if (dst->ir.type == MOJOSHADER_IR_ARRAY)
+        {
+            pos += spill_ir_expr(ctx, list, pos, &dst->array.element);
+            dst = dst->array.array;
+        } // else if
+        else
+            break;
+    } // while
+} // spill_ir_dest_indices
+
+// Flattens (stmt) onto the end of (list), lifting statements out of ESEQs
+//  as it goes. Takes ownership of (stmt).
+static void linearize_ir(Context *ctx, IrStatementList *list,
+                         MOJOSHADER_irStatement *stmt)
+{
+    while ((stmt != NULL) && (stmt->ir.type == MOJOSHADER_IR_SEQ))
+    {
+        MOJOSHADER_irStatement *next = stmt->seq.next;
+        linearize_ir(ctx, list, stmt->seq.first);
+        Free(ctx, stmt);
+        stmt = next;
+    } // while
+
+    if (stmt == NULL)
+        return;
+
+    ctx->sourcefile = stmt->ir.filename;
+    ctx->sourceline = stmt->ir.line;
+
+    switch (stmt->ir.type)
+    {
+        case MOJOSHADER_IR_MOVE:
+        {
+            lift_ir_expr(ctx, list, &stmt->move.dst);
+            const int mark = list->count;
+            lift_ir_expr(ctx, list, &stmt->move.src);
+            if (list->count > mark)
+                spill_ir_dest_indices(ctx, list, mark, stmt->move.dst);
+            break;
+        } // case
+
+        case MOJOSHADER_IR_CJUMP:
+            lift_ir_pair(ctx, list, &stmt->cjump.left, &stmt->cjump.right);
+            break;
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            // once the ESEQs are gone, only calls make this worth keeping.
+            lift_ir_expr(ctx, list, &stmt->expr.expr);
+            if ((stmt->expr.expr == NULL) || (!ir_expr_has_call(ctx, stmt->expr.expr)))
+            {
+                delete_ir(ctx, stmt);
+                ctx->ir_stats[IR_PASS_CANONICALIZE].changes++;
+                return;
+            } // if
+            break;
+
+        default: break;
+    } // switch
+
+    ir_list_add(ctx, list, stmt);
+} // linearize_ir
+
+
+// Constant folding...
+
+static void load_ir_constant(const MOJOSHADER_irExpression *expr, const int i,
+                             AstCalcData *data)
+{
+    const MOJOSHADER_irConstant *constant = &expr->constant;
+    assert(expr->ir.type == MOJOSHADER_IR_CONSTANT);
+    data->isflt = ir_type_is_float(constant->info.type);
+    if (data->isflt)
+        data->value.f = (double) constant->value.fval[i];
+    else if (constant->info.type == MOJOSHADER_AST_DATATYPE_UINT)
+        data->value.i = (int64) ((uint32) constant->value.ival[i]);
+    else
+        data->value.i = (int64) constant->value.ival[i];
+} // load_ir_constant
+
+// Converts (data) to (type). Returns zero if it won't fit.
+static int convert_ir_constant(AstCalcData *data,
+                               const MOJOSHADER_astDataTypeType type)
+{
+    if (ir_type_is_float(type))
+    {
+        if (!data->isflt)
+            data->value.f = (double) data->value.i;
+        data->isflt = 1;
+    } // if
+
+    else if (type == MOJOSHADER_AST_DATATYPE_BOOL)
+    {
+        data->value.i = data->isflt ? (data->value.f != 0.0) : (data->value.i != 0);
+        data->isflt = 0;
+    } // else if
+
+    else if (data->isflt)
+    {
+        // this also catches NaNs.
+        if (!((data->value.f > -2147483649.0) && (data->value.f < 4294967296.0)))
+            return 0;
+        data->value.i = (int64) data->value.f;
+        data->isflt = 0;
+    } // else if
+
+    return 1;
+} // convert_ir_constant
+
+static void store_ir_constant(MOJOSHADER_irConstant *constant, const int i,
+                              const AstCalcData *data)
+{
+    if (data->isflt)
+        constant->value.fval[i] = (float) data->value.f;
+    else
+        constant->value.ival[i] = (int) ((uint32) data->value.i);
+} // store_ir_constant
+
+static int fold_ir_binop(Context *ctx, MOJOSHADER_irExpression **slot)
+{
+    MOJOSHADER_irExpression *expr = *slot;
+    MOJOSHADER_irExpression *left = expr->binop.left;
+    MOJOSHADER_irExpression *right = expr->binop.right;
+    const MOJOSHADER_astDataTypeType type = expr->info.type;
+    const int elements = expr->info.elements;
+    const int isflt = ir_type_is_float(type);
+    AstCalcData results[16];
+    MOJOSHADER_astNodeType op;
+    int i;
+
+    if ((left->ir.type != MOJOSHADER_IR_CONSTANT) ||
+        (right->ir.type != MOJOSHADER_IR_CONSTANT) ||
+        (left->info.type != type) || (right->info.type != type) ||
+        (left->info.elements != elements) ||
+        (right->info.elements != elements) ||
+        (elements < 1) || (elements > 16))
+        return 0;
+
+    switch (expr->binop.op)
+    {
+        case MOJOSHADER_IR_BINOP_ADD: op = MOJOSHADER_AST_OP_ADD; break;
+        case MOJOSHADER_IR_BINOP_SUBTRACT: op = MOJOSHADER_AST_OP_SUBTRACT; break;
+        case MOJOSHADER_IR_BINOP_MULTIPLY: op = MOJOSHADER_AST_OP_MULTIPLY; break;
+        case MOJOSHADER_IR_BINOP_DIVIDE: op = MOJOSHADER_AST_OP_DIVIDE; break;
+        case MOJOSHADER_IR_BINOP_MODULO: op = MOJOSHADER_AST_OP_MODULO; break;
+        case MOJOSHADER_IR_BINOP_AND: op = MOJOSHADER_AST_OP_BINARYAND; break;
+        case MOJOSHADER_IR_BINOP_OR: op = MOJOSHADER_AST_OP_BINARYOR; break;
+        case MOJOSHADER_IR_BINOP_XOR: op = MOJOSHADER_AST_OP_BINARYXOR; break;
+        case MOJOSHADER_IR_BINOP_LSHIFT: op = MOJOSHADER_AST_OP_LSHIFT; break;
+        case MOJOSHADER_IR_BINOP_RSHIFT: op = MOJOSHADER_AST_OP_RSHIFT; break;
+        default: return 0;
+    } // switch
+
+    // calc_const_binary() would call these errors, but fmod() on floats is
+    //  legal; we just can't fold it.
+    if ((isflt) && (op != MOJOSHADER_AST_OP_ADD) &&
+        (op != MOJOSHADER_AST_OP_SUBTRACT) &&
+        (op != MOJOSHADER_AST_OP_MULTIPLY) && (op != MOJOSHADER_AST_OP_DIVIDE))
+        return 0;
+
+    for (i = 0; i < elements; i++)
+    {
+        AstCalcData rval;
+        load_ir_constant(left, i, &results[i]);
+        load_ir_constant(right, i, &rval);
+        if ( ((op == MOJOSHADER_AST_OP_LSHIFT) || (op == MOJOSHADER_AST_OP_RSHIFT)) &&
+             ((rval.value.i < 0) || (rval.value.i > 31)) )
+            return 0;  // the GPU decides what this means, not us.
+        else if (!calc_const_binary(ctx, op, &results[i], &rval))
+            return 0;
+        else if (!convert_ir_constant(&results[i], type))
+            return 0;
+    } // for
+
+    for (i = 0; i < elements; i++)
+        store_ir_constant(&left->constant, i, &results[i]);
+
+    expr->binop.left = NULL;
+    delete_ir(ctx, expr);
+    *slot = left;
+    return 1;
+} // fold_ir_binop
+
+// Handles CONVERT, SWIZZLE and CONSTRUCT of constants, which all just pick
+//  and convert elements from their operands.
+static int fold_ir_elements(Context *ctx, MOJOSHADER_irExpression **slot)
+{
+    MOJOSHADER_irExpression *expr = *slot;
+    const MOJOSHADER_astDataTypeType type = expr->info.type;
+    const int elements = expr->info.elements;
+    MOJOSHADER_irExpression *constant = NULL;
+    AstCalcData results[16];
+    int i;
+
+    if ((elements < 1) || (elements > 16) || (!ir_type_is_scalar(type)))
+        return 0;
+
+    if (expr->ir.type == MOJOSHADER_IR_CONSTRUCT)
+    {
+        const MOJOSHADER_irExprList *args;
+        int total = 0;
+        for (args = expr->construct.args; args != NULL; args = args->next)
+        {
+            const MOJOSHADER_irExpression *arg = args->expr;
+            if ((arg == NULL) || (arg->ir.type != MOJOSHADER_IR_CONSTANT) ||
+                (!ir_type_is_scalar(arg->info.type)) ||
+                (total + arg->info.elements > elements))
+                return 0;
+            for (i = 0; i < arg->info.elements; i++)
+                load_ir_constant(arg, i, &results[total++]);
+        } // for
+
+        if (total != elements)
+            return 0;
+    } // if
+
+    else
+    {
+        MOJOSHADER_irExpression *operand = (expr->ir.type == MOJOSHADER_IR_CONVERT) ? expr->convert.expr : expr->swizzle.expr;
+        const int count = operand->info.elements;
+        if ((operand->ir.type != MOJOSHADER_IR_CONSTANT) ||
+            (!ir_type_is_scalar(operand->info.type)))
+            return 0;
+
+        // matrix truncation needs the source's dimensions, which a constant
+        //  doesn't have. Leave it for the code generator.
+        if ((expr->ir.type == MOJOSHADER_IR_CONVERT) &&
+            (expr->convert.columns != 0) && (count != 1) && (count != elements))
+            return 0;
+
+        for (i = 0; i < elements; i++)
+        {
+            int element = i;
+            if (expr->ir.type == MOJOSHADER_IR_SWIZZLE)
+                element = (i < 4) ? expr->swizzle.channels[i] : count;
+            else if (count == 1)
+                element = 0;  // a scalar converts to every element.
+            if (element >= count)
+                return 0;
+            load_ir_constant(operand, element, &results[i]);
+        } // for
+    } // else
+
+    for (i = 0; i < elements; i++)
+    {
+        if (!convert_ir_constant(&results[i], type))
+            return 0;
+    } // for
+
+    ctx->sourcefile = expr->ir.filename;
+    ctx->sourceline = expr->ir.line;
+    constant = new_ir_constant(ctx, type, elements);
+    if (constant == NULL)
+        return 0;
+
+    for (i = 0; i < elements; i++)
+        store_ir_constant(&constant->constant, i, &results[i]);
+
+    delete_ir(ctx, expr);
+    *slot = constant;
+    return 1;
+} // fold_ir_elements
+
+// Replaces anything in (*slot) that only works on constants with the result.
+//  Returns the number of nodes folded.
+static int fold_ir_expr(Context *ctx, MOJOSHADER_irExpression **slot)
+{
+    MOJOSHADER_irExpression *expr = *slot;
+    MOJOSHADER_irExprList *args = NULL;
+    int retval = 0;
+
+    if (expr == NULL)
+        return 0;
+
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_BINOP:
+            retval += fold_ir_expr(ctx, &expr->binop.left);
+            retval += fold_ir_expr(ctx, &expr->binop.right);
+            retval += fold_ir_binop(ctx, slot);
+            break;
+
+        case MOJOSHADER_IR_CONVERT:
+            retval += fold_ir_expr(ctx, &expr->convert.expr);
+            retval += fold_ir_elements(ctx, slot);
+            break;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            retval += fold_ir_expr(ctx, &expr->swizzle.expr);
+            retval += fold_ir_elements(ctx, slot);
+            break;
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            for (args = expr->construct.args; args != NULL; args = args->next)
+                retval += fold_ir_expr(ctx, &args->expr);
+            retval += fold_ir_elements(ctx, slot);
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            for (args = expr->call.args; args != NULL; args = args->next)
+                retval += fold_ir_expr(ctx, &args->expr);
+            break;
+
+        case MOJOSHADER_IR_ARRAY:
+            retval += fold_ir_expr(ctx, &expr->array.element);
+            break;
+
+        case MOJOSHADER_IR_SELECT:
+            retval += fold_ir_expr(ctx, &expr->select.cond);
+            retval += fold_ir_expr(ctx, &expr->select.iftrue);
+            retval += fold_ir_expr(ctx, &expr->select.iffalse);
+            if (expr->select.cond->ir.type == MOJOSHADER_IR_CONSTANT)
+            {
+                const int cond = expr->select.cond->constant.value.ival[0];
+                *slot = cond ? expr->select.iftrue : expr->select.iffalse;
+                if (cond)
+                    expr->select.iftrue = NULL;
+                else
+                    expr->select.iffalse = NULL;
+                delete_ir(ctx, expr);
+                retval++;
+            } // if
+            break;
+
+        default: break;  // nothing to fold in the others.
+    } // switch
+
+    return retval;
+} // fold_ir_expr
+
+static int fold_ir_cjump(Context *ctx, MOJOSHADER_irStatement **slot)
+{
+    MOJOSHADER_irStatement *stmt = *slot;
+    const MOJOSHADER_irExpression *left = stmt->cjump.left;
+    const MOJOSHADER_irExpression *right = stmt->cjump.right;
+    MOJOSHADER_astNodeType op;
+    AstCalcData lval, rval;
+
+    if ((left->ir.type != MOJOSHADER_IR_CONSTANT) ||
+        (right->ir.type != MOJOSHADER_IR_CONSTANT) ||
+        (left->info.elements != 1) || (right->info.elements != 1))
+        return 0;
+
+    switch (stmt->cjump.cond)
+    {
+        case MOJOSHADER_IR_COND_EQL: op = MOJOSHADER_AST_OP_EQUAL; break;
+        case MOJOSHADER_IR_COND_NEQ: op = MOJOSHADER_AST_OP_NOTEQUAL; break;
+        case MOJOSHADER_IR_COND_LT: op = MOJOSHADER_AST_OP_LESSTHAN; break;
+        case MOJOSHADER_IR_COND_GT: op = MOJOSHADER_AST_OP_GREATERTHAN; break;
+        case MOJOSHADER_IR_COND_LEQ: op = MOJOSHADER_AST_OP_LESSTHANOREQUAL; break;
+        case MOJOSHADER_IR_COND_GEQ: op = MOJOSHADER_AST_OP_GREATERTHANOREQUAL; break;
+        default: return 0;
+    } // switch
+
+    load_ir_constant(left, 0, &lval);
+    load_ir_constant(right, 0, &rval);
+    if (!calc_const_binary(ctx, op, &lval, &rval))
+        return 0;
+
+    ctx->sourcefile = stmt->ir.filename;
+    ctx->sourceline = stmt->ir.line;
+    MOJOSHADER_irStatement *jump = new_ir_jump(ctx, lval.value.i ? stmt->cjump.iftrue : stmt->cjump.iffalse);
+    if (jump == NULL)
+        return 0;
+
+    delete_ir(ctx, stmt);
+    *slot = jump;
+    return 1;
+} // fold_ir_cjump
+
+static int fold_ir_stmt(Context *ctx, MOJOSHADER_irStatement **slot)
+{
+    MOJOSHADER_irStatement *stmt = *slot;
+    MOJOSHADER_irExpression *dst = NULL;
+    int retval = 0;
+
+    switch (stmt->ir.type)
+    {
+        case MOJOSHADER_IR_MOVE:
+            for (dst = stmt->move.dst; dst != NULL; )
+            {
+                if (dst->ir.type == MOJOSHADER_IR_SWIZZLE)
+                    dst = dst->swizzle.expr;
+                else if (dst->ir.type == MOJOSHADER_IR_ARRAY)
+                {
+                    retval += fold_ir_expr(ctx, &dst->array.element);
+                    dst = dst->array.array;
+                } // else if
+                else
+                    break;
+            } // for
+            retval += fold_ir_expr(ctx, &stmt->move.src);
+            break;
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            retval += fold_ir_expr(ctx, &stmt->expr.expr);
+            break;
+
+        case MOJOSHADER_IR_CJUMP:
+            retval += fold_ir_expr(ctx, &stmt->cjump.left);
+            retval += fold_ir_expr(ctx, &stmt->cjump.right);
+            retval += fold_ir_cjump(ctx, slot);
+            break;
+
+        default: break;
+    } // switch
+
+    return retval;
+} // fold_ir_stmt
+
+static void fold_ir_constants(Context *ctx, IrStatementList *list,
+                              const int rettemp, int *changes)
+{
+    int i;
+    for (i = 0; i < list->count; i++)
+        *changes += fold_ir_stmt(ctx, &list->stmts[i]);
+} // fold_ir_constants
+
+
+// Copy propagation...
+
+static int ir_exprs_equal(const MOJOSHADER_irExpression *a,
+                          const MOJOSHADER_irExpression *b);
+
+typedef struct IrCopies
+{
+    MOJOSHADER_irExpression **copies;  // what each temp is a copy of.
+    int *active;  // temps that are a copy of something right now.
+    int num_active;
+    IrTempCounts counts;
+    int substituted_constant;
+    int changes;
+} IrCopies;
+
+static void forget_ir_copies(IrCopies *state, const MOJOSHADER_irExpression *of,
+                             const int memory_only)
+{
+    int i = 0;
+    while (i < state->num_active)
+    {
+        const int index = state->active[i];
+        const MOJOSHADER_irExpression *copy = state->copies[index];
+        int forget = 0;
+
+        if (memory_only)
+            forget = (copy->ir.type == MOJOSHADER_IR_MEMORY);
+        else if (of == NULL)
+            forget = 1;
+        else if (of->ir.type == MOJOSHADER_IR_TEMP)
+        {
+            forget = ( (index == of->temp.index) ||
+                       ((copy->ir.type == MOJOSHADER_IR_TEMP) &&
+                        (copy->temp.index == of->temp.index)) );
+        } // else if
+        else if (of->ir.type == MOJOSHADER_IR_MEMORY)
+        {
+            forget = ( (copy->ir.type == MOJOSHADER_IR_MEMORY) &&
+                       (copy->memory.index == of->memory.index) );
+        } // else if
+
+        if (!forget)
+            i++;
+        else
+        {
+            state->copies[index] = NULL;
+            state->active[i] = state->active[--state->num_active];
+        } // else
+    } // while
+} // forget_ir_copies
+
+static int substitute_ir_copy(Context *ctx, MOJOSHADER_irExpression **slot,
+                              void *data)
+{
+    IrCopies *state = (IrCopies *) data;
+    MOJOSHADER_irExpression *expr = *slot;
+    const MOJOSHADER_irExpression *copy = NULL;
+    MOJOSHADER_irExpression *replacement = NULL;
+
+    if (expr->ir.type != MOJOSHADER_IR_TEMP)
+        return 1;
+    else if ((expr->temp.index < 0) || (expr->temp.index >= state->counts.total))
+        return 0;
+
+    copy = state->copies[expr->temp.index];
+    if ( (copy == NULL) || (copy->info.type != expr->info.type) ||
+         (copy->info.elements != expr->info.elements) )
+        return 0;
+
+    ctx->sourcefile = expr->ir.filename;
+    ctx->sourceline = expr->ir.line;
+    switch (copy->ir.type)
+    {
+        case MOJOSHADER_IR_TEMP:
+            replacement = new_ir_temp(ctx, copy->temp.index, copy->info.type, copy->info.elements);
+            if (replacement != NULL)
+                state->counts.reads[copy->temp.index]++;
+            break;
+
+        case MOJOSHADER_IR_MEMORY:
+            replacement = new_ir_memory(ctx, copy->memory.index, copy->info.type, copy->info.elements);
+            break;
+
+        case MOJOSHADER_IR_CONSTANT:
+            replacement = new_ir_constant(ctx, copy->info.type, copy->info.elements);
+            if (replacement != NULL)
+            {
+                memcpy(&replacement->constant.value, &copy->constant.value, sizeof (copy->constant.value));
+                state->substituted_constant = 1;
+            } // if
+            break;
+
+        default: assert(0 && "not a copy"); break;
+    } // switch
+
+    if (replacement != NULL)
+    {
+        state->counts.reads[expr->temp.index]--;
+        delete_ir(ctx, expr);
+        *slot = replacement;
+        state->changes++;
+    } // if
+
+    return 0;
+} // substitute_ir_copy
+
+typedef struct IrTempRead
+{
+    int index;
+    MOJOSHADER_irExpression **slot;
+} IrTempRead;
+
+static int find_ir_temp_read(Context *ctx, MOJOSHADER_irExpression **slot,
+                             void *data)
+{
+    IrTempRead *read = (IrTempRead *) data;
+    if (read->slot != NULL)
+        return 0;  // already found it.
+    else if (((*slot)->ir.type == MOJOSHADER_IR_TEMP) && ((*slot)->temp.index == read->index))
+    {
+        read->slot = slot;
+        return 0;
+    } // else if
+    return 1;
+} // find_ir_temp_read
+
+// If (prev) only computes a temp for (stmt) to read once, move the
+//  computation into (stmt), where the temp was read. Returns non-zero if
+//  (prev) is gone now.
+static int forward_ir_temp(Context *ctx, IrCopies *state,
+                           MOJOSHADER_irStatement *prev,
+                           MOJOSHADER_irStatement *stmt, const int rettemp)
+{
+    IrTempRead read;
+    MOJOSHADER_irExpression *src = NULL;
+
+    if ((prev->ir.type != MOJOSHADER_IR_MOVE) ||
+        (prev->move.dst->ir.type != MOJOSHADER_IR_TEMP))
+        return 0;
+
+    read.index = prev->move.dst->temp.index;
+    read.slot = NULL;
+    src = prev->move.src;
+
+    if ( (read.index == rettemp) || (read.index < 0) ||
+         (read.index >= state->counts.total) ||
+         (state->counts.reads[read.index] != 1) ||
+         (state->counts.writes[read.index] != 1) ||
+         ((ir_stmt_has_call(ctx, stmt)) && (ir_expr_reads_memory(ctx, src))) )
+        return 0;
+
+    visit_ir_reads(ctx, stmt, find_ir_temp_read, &read);
+
+    // a call can only move if nothing else (stmt) reads would move past it.
+    if ( (ir_expr_has_call(ctx, src)) &&
+         ( (stmt->ir.type != MOJOSHADER_IR_MOVE) ||
+           (read.slot != &stmt->move.src) ||
+           (stmt->move.dst != ir_dest_base(stmt->move.dst)) ) )
+        return 0;
+
+    if ( (read.slot == NULL) ||
+         ((*read.slot)->info.type != src->info.type) ||
+         ((*read.slot)->info.elements != src->info.elements) )
+        return 0;
+
+    delete_ir(ctx, *read.slot);
+    *read.slot = src;
+    prev->move.src = NULL;
+    delete_ir(ctx, prev);
+    state->counts.reads[read.index] = 0;
+    state->counts.writes[read.index] = 0;
+    state->changes++;
+    return 1;
+} // forward_ir_temp
+
+// If (stmt) writes some channels of a vector straight from some channels of
+//  another vector, return what it writes and reads, otherwise NULL.
+static const MOJOSHADER_irExpression *ir_component_copy(
+                                        const MOJOSHADER_irStatement *stmt,
+                                        const MOJOSHADER_irExpression **src)
+{
+    const MOJOSHADER_irExpression *dst = NULL;
+    if (stmt->ir.type != MOJOSHADER_IR_MOVE)
+        return NULL;
+
+    dst = stmt->move.dst;
+    *src = stmt->move.src;
+    if ((dst->ir.type != MOJOSHADER_IR_SWIZZLE) || ((*src)->ir.type != MOJOSHADER_IR_SWIZZLE))
+        return NULL;
+
+    dst = dst->swizzle.expr;
+    *src = (*src)->swizzle.expr;
+    if ( ((dst->ir.type != MOJOSHADER_IR_TEMP) && (dst->ir.type != MOJOSHADER_IR_MEMORY)) ||
+         (((*src)->ir.type != MOJOSHADER_IR_TEMP) && ((*src)->ir.type != MOJOSHADER_IR_MEMORY)) ||
+         (!ir_type_is_scalar(dst->info.type)) || (dst->info.elements > 4) ||
+         ((*src)->info.type != dst->info.type) || ((*src)->info.elements > 4) ||
+         (ir_exprs_equal(dst, *src)) )
+        return NULL;
+
+    return dst;
+} // ir_component_copy
+
+// If (stmt) finishes copying a vector one channel at a time, with the moves
+//  right before it in the rewritten list (which ends at (count)), turn it
+//  into one move of the whole thing, so the usual copy propagation can see
+//  it. Returns how many statements it removed from the end of the list.
+static int merge_ir_component_copies(Context *ctx, IrCopies *state,
+                                     IrStatementList *list, const int count,
+                                     MOJOSHADER_irStatement *stmt)
+{
+    const MOJOSHADER_irExpression *src = NULL;
+    const MOJOSHADER_irExpression *from = NULL;
+    const MOJOSHADER_irExpression *to = ir_component_copy(stmt, &from);
+    char chans[4] = { 0, 1, 2, 3 };
+    int written = 0;
+    int identity = 1;
+    int start, i;
+
+    if (to == NULL)
+        return 0;
+
+    const int all = (1 << to->info.elements) - 1;
+    for (start = count; written != all; start--)
+    {
+        const MOJOSHADER_irStatement *move = (start == count) ? stmt : list->stmts[start];
+        const MOJOSHADER_irExpression *base = ir_component_copy(move, &src);
+        if ((base == NULL) || (!ir_exprs_equal(base, to)) || (!ir_exprs_equal(src, from)))
+            return 0;
+
+        for (i = 0; i < move->move.dst->info.elements; i++)
+        {
+            const int chan = move->move.dst->swizzle.channels[i];
+            if (written & (1 << chan))
+                return 0;  // writes the same channel twice; leave it be.
+            written |= (1 << chan);
+            chans[chan] = move->move.src->swizzle.channels[i];
+        } // for
+
+        if ((written != all) && (start == 0))
+            return 0;  // ran out of statements first.
+    } // for
+
+    const int removed = count - (start + 1);
+    if (removed == 0)
+        return 0;  // one move does it all already.
+
+    for (i = 0; i < to->info.elements; i++)
+        identity = identity && (chans[i] == i);
+
+    // reuse (stmt), since the others are going away.
+    MOJOSHADER_irExpression *dst = stmt->move.dst->swizzle.expr;
+    MOJOSHADER_irExpression *copy = stmt->move.src->swizzle.expr;
+    if ((!identity) || (copy->info.elements != dst->info.elements))
+    {
+        ctx->sourcefile = stmt->ir.filename;
+        ctx->sourceline = stmt->ir.line;
+        copy = new_ir_swizzle(ctx, copy, chans, dst->info.type, dst->info.elements);
+        if (copy == NULL)
+            return 0;
+    } // if
+
+    stmt->move.dst->swizzle.expr = NULL;
+    stmt->move.src->swizzle.expr = NULL;
+    delete_ir(ctx, stmt->move.dst);
+    delete_ir(ctx, stmt->move.src);
+    stmt->move.dst = dst;
+    stmt->move.src = copy;
+
+    if ((dst->ir.type == MOJOSHADER_IR_TEMP) && (dst->temp.index >= 0) &&
+        (dst->temp.index < state->counts.total))
+        state->counts.writes[dst->temp.index] -= removed;
+
+    src = ir_dest_base(copy);
+    if ((src->ir.type == MOJOSHADER_IR_TEMP) && (src->temp.index >= 0) &&
+        (src->temp.index < state->counts.total))
+        state->counts.reads[src->temp.index] -= removed;
+
+    for (i = count - removed; i < count; i++)
+        delete_ir(ctx, list->stmts[i]);
+
+    state->changes++;
+    return removed;
+} // merge_ir_component_copies
+
+// Within each basic block, replaces reads of a temp that's just a copy of
+//  another temp, a memory location or a constant with what it copied, and
+//  folds temps that are computed once and read once into the statement
+//  that reads them. A vector copied a channel at a time counts as a copy.
+static void propagate_ir_copies(Context *ctx, IrStatementList *list,
+                                const int rettemp, int *changes)
+{
+    IrCopies state;
+    int count = 0;
+    int i;
+
+    memset(&state, '\0', sizeof (state));
+    if (!count_ir_temps(ctx, list, &state.counts))
+        return;
+    else if (state.counts.aggregates)
+    {
+        // struct temps overlap, so what's a copy of what gets murky.
+        Free(ctx, state.counts.reads);
+        return;
+    } // else if
+
+    const size_t len = (sizeof (MOJOSHADER_irExpression *) + sizeof (int)) * (state.counts.total + 1);
+    state.copies = (MOJOSHADER_irExpression **) Malloc(ctx, len);
+    if (state.copies == NULL)
+    {
+        Free(ctx, state.counts.reads);
+        return;
+    } // if
+    memset(state.copies, '\0', len);
+    state.active = (int *) (state.copies + (state.counts.total + 1));
+
+    for (i = 0; i < list->count; i++)
+    {
+        MOJOSHADER_irStatement *stmt = list->stmts[i];
+        const int has_call = ir_stmt_has_call(ctx, stmt);
+
+        if (stmt->ir.type == MOJOSHADER_IR_LABEL)
+            forget_ir_copies(&state, NULL, 0);  // new basic block.
+
+        if (state.num_active > 0)
+        {
+            if (has_call)  // the call might change memory before we read it.
+                forget_ir_copies(&state, NULL, 1);
+            state.substituted_constant = 0;
+            visit_ir_reads(ctx, stmt, substitute_ir_copy, &state);
+            if (state.substituted_constant)
+                *changes += fold_ir_stmt(ctx, &list->stmts[i]);
+            stmt = list->stmts[i];
+        } // if
+
+        // (count) is where the rewritten list ends. Pull in whatever the
+        //  statements right before this one computed just for it.
+        while ((count > 0) && (forward_ir_temp(ctx, &state, list->stmts[count-1], stmt, rettemp)))
+        {
+            count--;
+            *changes += fold_ir_stmt(ctx, &list->stmts[i]);
+            stmt = list->stmts[i];
+        } // while
+
+        count -= merge_ir_component_copies(ctx, &state, list, count, stmt);
+
+        if (stmt->ir.type == MOJOSHADER_IR_MOVE)
+        {
+            MOJOSHADER_irExpression *dst = stmt->move.dst;
+            const MOJOSHADER_irExpression *src = stmt->move.src;
+            const MOJOSHADER_irExpression *base = ir_dest_base(dst);
+            forget_ir_copies(&state, base, 0);
+            if (!ir_type_is_scalar(base->info.type))  // a whole struct, etc.
+                forget_ir_copies(&state, NULL, 1);
+
+            if ( (dst->ir.type == MOJOSHADER_IR_TEMP) &&
+                 (dst->temp.index >= 0) &&
+                 (dst->temp.index < state.counts.total) &&
+                 ( (src->ir.type == MOJOSHADER_IR_CONSTANT) ||
+                   (src->ir.type == MOJOSHADER_IR_MEMORY) ||
+                   ((src->ir.type == MOJOSHADER_IR_TEMP) && (src->temp.index != dst->temp.index)) ) )
+            {
+                state.copies[dst->temp.index] = (MOJOSHADER_irExpression *) src;
+                state.active[state.num_active++] = dst->temp.index;
+            } // if
+        } // if
+
+        if (has_call)
+            forget_ir_copies(&state, NULL, 1);
+
+        if ((stmt->ir.type == MOJOSHADER_IR_JUMP) || (stmt->ir.type == MOJOSHADER_IR_CJUMP))
+            forget_ir_copies(&state, NULL, 0);  // end of basic block.
+
+        list->stmts[count++] = stmt;
+    } // for
+
+    list->count = count;
+    *changes += state.changes;
+    Free(ctx, state.copies);
+    Free(ctx, state.counts.reads);
+} // propagate_ir_copies
+
+
+// Common subexpression elimination...
+
+typedef struct IrAvailable
+{
+    MOJOSHADER_irExpression **slot;  // where the expression lives now.
+    uint32 hash;
+    int pos;  // statement in the list that holds (slot).
+    int stamp;  // when it was computed, see IrSubexpressions.
+    int temp;  // the temp it's been moved into, -1 if it hasn't yet.
+    int next;  // next entry in the same bucket, -1 at the end.
+} IrAvailable;
+
+#define IR_CSE_BUCKETS 256
+
+// Times here are indices into the original list. Something that was
+//  computed at or before the last time one of its inputs was written, or
+//  that reads memory and was computed at or before the last call, isn't
+//  available anymore.
+typedef struct IrSubexpressions
+{
+    IrStatementList *list;
+    int pos;  // where the current statement is in (list).
+    int stamp;  // the current statement's time.
+    int has_call;  // non-zero if the current statement makes a call.
+    IrAvailable *available;
+    int num_available;
+    int allocated;
+    int buckets[IR_CSE_BUCKETS];
+    int *temp_written;  // last time each temp was written.
+    int num_temps;
+    int *memory_written;  // last time each memory location was written.
+    int min_memory;
+    int num_memory;
+    int call_made;  // last time a call was made.
+    int changes;
+} IrSubexpressions;
+
+static inline uint32 mix_ir_hash(const uint32 hash, const uint32 val)
+{
+    return ((hash << 5) + hash) ^ val;
+} // mix_ir_hash
+
+static uint32 hash_ir_expr(const MOJOSHADER_irExpression *expr)
+{
+    const MOJOSHADER_irExprList *args = NULL;
+    uint32 hash = mix_ir_hash(5381, (uint32) expr->ir.type);
+    int i;
+
+    hash = mix_ir_hash(hash, (uint32) expr->info.type);
+    hash = mix_ir_hash(hash, (uint32) expr->info.elements);
+
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_CONSTANT:
+            for (i = 0; (i < expr->info.elements) && (i < 16); i++)
+                hash = mix_ir_hash(hash, (uint32) expr->constant.value.ival[i]);
+            break;
+        case MOJOSHADER_IR_TEMP:
+            hash = mix_ir_hash(hash, (uint32) expr->temp.index);
+            break;
+        case MOJOSHADER_IR_MEMORY:
+            hash = mix_ir_hash(hash, (uint32) expr->memory.index);
+            break;
+        case MOJOSHADER_IR_BINOP:
+            hash = mix_ir_hash(hash, (uint32) expr->binop.op);
+            hash = mix_ir_hash(hash, hash_ir_expr(expr->binop.left));
+            hash = mix_ir_hash(hash, hash_ir_expr(expr->binop.right));
+            break;
+        case MOJOSHADER_IR_ARRAY:
+            hash = mix_ir_hash(hash, hash_ir_expr(expr->array.array));
+            hash = mix_ir_hash(hash, hash_ir_expr(expr->array.element));
+            break;
+        case MOJOSHADER_IR_CONVERT:
+            hash = mix_ir_hash(hash, (uint32) expr->convert.columns);
+            hash = mix_ir_hash(hash, hash_ir_expr(expr->convert.expr));
+            break;
+        case MOJOSHADER_IR_SWIZZLE:
+            for (i = 0; i < 4; i++)
+                hash = mix_ir_hash(hash, (uint32) expr->swizzle.channels[i]);
+            hash = mix_ir_hash(hash, hash_ir_expr(expr->swizzle.expr));
+            break;
+        case MOJOSHADER_IR_CALL:
+            hash = mix_ir_hash(hash, (uint32) expr->call.index);
+            for (args = expr->call.args; args != NULL; args = args->next)
+                hash = mix_ir_hash(hash, hash_ir_expr(args->expr));
+            break;
+        case MOJOSHADER_IR_CONSTRUCT:
+            for (args = expr->construct.args; args != NULL; args = args->next)
+                hash = mix_ir_hash(hash, hash_ir_expr(args->expr));
+            break;
+        case MOJOSHADER_IR_SELECT:
+            hash = mix_ir_hash(hash, hash_ir_expr(expr->select.cond));
+            hash = mix_ir_hash(hash, hash_ir_expr(expr->select.iftrue));
+            hash = mix_ir_hash(hash, hash_ir_expr(expr->select.iffalse));
+            break;
+        default: break;
+    } // switch
+
+    return hash;
+} // hash_ir_expr
+
+static int ir_exprlists_equal(const MOJOSHADER_irExprList *a,
+                              const MOJOSHADER_irExprList *b)
+{
+    while ((a != NULL) && (b != NULL))
+    {
+        if (!ir_exprs_equal(a->expr, b->expr))
+            return 0;
+        a = a->next;
+        b = b->next;
+    } // while
+    return ((a == NULL) && (b == NULL));
+} // ir_exprlists_equal
+
+static int ir_exprs_equal(const MOJOSHADER_irExpression *a,
+                          const MOJOSHADER_irExpression *b)
+{
+    if ((a == NULL) || (b == NULL))
+        return (a == b);
+    else if ( (a->ir.type != b->ir.type) ||
+              (a->info.type != b->info.type) ||
+              (a->info.elements != b->info.elements) )
+        return 0;
+
+    switch (a->ir.type)
+    {
+        case MOJOSHADER_IR_CONSTANT:
+            return (memcmp(a->constant.value.ival, b->constant.value.ival,
+                           sizeof (int) * a->info.elements) == 0);
+        case MOJOSHADER_IR_TEMP:
+            return (a->temp.index == b->temp.index);
+        case MOJOSHADER_IR_MEMORY:
+            return (a->memory.index == b->memory.index);
+        case MOJOSHADER_IR_BINOP:
+            return ( (a->binop.op == b->binop.op) &&
+                     (ir_exprs_equal(a->binop.left, b->binop.left)) &&
+                     (ir_exprs_equal(a->binop.right, b->binop.right)) );
+        case MOJOSHADER_IR_ARRAY:
+            return ( (ir_exprs_equal(a->array.array, b->array.array)) &&
+                     (ir_exprs_equal(a->array.element, b->array.element)) );
+        case MOJOSHADER_IR_CONVERT:
+            return ( (a->convert.columns == b->convert.columns) &&
+                     (ir_exprs_equal(a->convert.expr, b->convert.expr)) );
+        case MOJOSHADER_IR_SWIZZLE:
+            return ( (memcmp(a->swizzle.channels, b->swizzle.channels, sizeof (a->swizzle.channels)) == 0) &&
+                     (ir_exprs_equal(a->swizzle.expr, b->swizzle.expr)) );
+        case MOJOSHADER_IR_CALL:
+            return ( (a->call.index == b->call.index) &&
+                     (ir_exprlists_equal(a->call.args, b->call.args)) );
+        case MOJOSHADER_IR_CONSTRUCT:
+            return ir_exprlists_equal(a->construct.args, b->construct.args);
+        case MOJOSHADER_IR_SELECT:
+            return ( (ir_exprs_equal(a->select.cond, b->select.cond)) &&
+                     (ir_exprs_equal(a->select.iftrue, b->select.iftrue)) &&
+                     (ir_exprs_equal(a->select.iffalse, b->select.iffalse)) );
+        default: break;
+    } // switch
+
+    return 0;
+} // ir_exprs_equal
+
+static int check_ir_available(Context *ctx, MOJOSHADER_irExpression **slot,
+                              void *data)
+{
+    IrSubexpressions *cse = (IrSubexpressions *) data;
+    const MOJOSHADER_irExpression *expr = *slot;
+    int written = -1;
+
+    if (expr->ir.type == MOJOSHADER_IR_TEMP)
+    {
+        const int index = expr->temp.index;
+        if ((index >= 0) && (index < cse->num_temps))
+            written = cse->temp_written[index];
+    } // if
+    else if (expr->ir.type == MOJOSHADER_IR_MEMORY)
+    {
+        const int index = expr->memory.index - cse->min_memory;
+        if ((index >= 0) && (index < cse->num_memory))
+            written = cse->memory_written[index];
+        if (cse->call_made > written)
+            written = cse->call_made;
+    } // else if
+
+    if (written >= cse->stamp)
+        cse->stamp = -1;  // flag it as stale.
+    return (cse->stamp >= 0);
+} // check_ir_available
+
+static int ir_still_available(Context *ctx, IrSubexpressions *cse,
+                              const IrAvailable *avail)
+{
+    const int stamp = cse->stamp;
+    cse->stamp = avail->stamp;
+    visit_ir_expr(ctx, avail->slot, check_ir_available, cse);
+    const int retval = (cse->stamp >= 0);
+    cse->stamp = stamp;
+    return retval;
+} // ir_still_available
+
+typedef struct IrSlotSearch
+{
+    MOJOSHADER_irExpression **slot;
+    int found;
+} IrSlotSearch;
+
+static int find_ir_slot(Context *ctx, MOJOSHADER_irExpression **slot,
+                        void *data)
+{
+    IrSlotSearch *search = (IrSlotSearch *) data;
+    if (slot == search->slot)
+        search->found = 1;
+    return !search->found;
+} // find_ir_slot
+
+// Moves (avail)'s expression into a new temp, right before the statement
+//  that computed it. Returns zero if out of memory.
+static int hoist_ir_expr(Context *ctx, IrSubexpressions *cse, IrAvailable *avail)
+{
+    MOJOSHADER_irExpression *expr = *avail->slot;
+    const MOJOSHADER_astDataTypeType type = expr->info.type;
+    const int elements = expr->info.elements;
+    const int pos = avail->pos;
+    MOJOSHADER_irExpression *dst = NULL;
+    MOJOSHADER_irExpression *use = NULL;
+    MOJOSHADER_irStatement *move = NULL;
+    int tmp = 0;
+    int i;
+
+    ctx->sourcefile = expr->ir.filename;
+    ctx->sourceline = expr->ir.line;
+    tmp = generate_ir_temp(ctx);
+    dst = new_ir_temp(ctx, tmp, type, elements);
+    use = new_ir_temp(ctx, tmp, type, elements);
+    if ((dst != NULL) && (use != NULL))
+        move = new_ir_move(ctx, dst, expr, -1);
+
+    if ((move == NULL) || (!ir_list_insert(ctx, cse->list, pos, move)))
+    {
+        if (move != NULL)
+            move->move.src = NULL;  // (expr) stays where it was.
+        delete_ir(ctx, (move != NULL) ? (void *) move : (void *) dst);
+        delete_ir(ctx, use);
+        return 0;
+    } // if
+
+    *avail->slot = use;
+
+    // everything from (pos) on moved down one, except for what's inside
+    //  the expression we just moved into the new statement.
+    for (i = 0; i < cse->num_available; i++)
+    {
+        IrAvailable *other = &cse->available[i];
+        if (other->pos < pos)
+            continue;
+        else if ((other->pos == pos) && (other != avail))
+        {
+            IrSlotSearch search;
+            search.slot = other->slot;
+            search.found = 0;
+            visit_ir_expr(ctx, &move->move.src, find_ir_slot, &search);
+            if (search.found)
+                continue;
+        } // else if
+        other->pos++;
+    } // for
+
+    cse->pos++;
+    avail->slot = &move->move.src;
+    avail->pos = pos;
+    avail->temp = tmp;
+    return 1;
+} // hoist_ir_expr
+
+static void add_ir_available(Context *ctx, IrSubexpressions *cse,
+                             MOJOSHADER_irExpression **slot, const uint32 hash)
+{
+    if (cse->num_available >= cse->allocated)
+    {
+        const int allocated = (cse->allocated == 0) ? 128 : cse->allocated * 2;
+        IrAvailable *available = (IrAvailable *) Malloc(ctx, sizeof (IrAvailable) * allocated);
+        if (available == NULL)
+            return;  // it just won't be available; that's okay.
+        else if (cse->available != NULL)
+        {
+            memcpy(available, cse->available, sizeof (IrAvailable) * cse->num_available);
+            Free(ctx, cse->available);
+        } // else if
+        cse->available = available;
+        cse->allocated = allocated;
+    } // if
+
+    IrAvailable *avail = &cse->available[cse->num_available];
+    const int bucket = (int) (hash % IR_CSE_BUCKETS);
+    avail->slot = slot;
+    avail->hash = hash;
+    avail->pos = cse->pos;
+    avail->stamp = cse->stamp;
+    avail->temp = -1;
+    avail->next = cse->buckets[bucket];
+    cse->buckets[bucket] = cse->num_available++;
+} // add_ir_available
+
+static void forget_ir_available(IrSubexpressions *cse)
+{
+    int i;
+    for (i = 0; i < IR_CSE_BUCKETS; i++)
+        cse->buckets[i] = -1;
+    cse->num_available = 0;
+} // forget_ir_available
+
+static int eliminate_ir_subexpr(Context *ctx, MOJOSHADER_irExpression **slot,
+                                void *data)
+{
+    IrSubexpressions *cse = (IrSubexpressions *) data;
+    MOJOSHADER_irExpression *expr = *slot;
+    int i;
+
+    // leaves and swizzles cost nothing to recompute; calls might not give
+    //  the same answer twice.
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_BINOP:
+        case MOJOSHADER_IR_ARRAY:
+        case MOJOSHADER_IR_CONSTRUCT:
+        case MOJOSHADER_IR_CONVERT:
+        case MOJOSHADER_IR_SELECT:
+            break;
+        default:
+            return 1;
+    } // switch
+
+    if ( (!ir_type_is_scalar(expr->info.type)) ||
+         (ir_expr_has_call(ctx, expr)) ||
+         ((cse->has_call) && (ir_expr_reads_memory(ctx, expr))) )
+        return 1;
+
+    const uint32 hash = hash_ir_expr(expr);
+    for (i = cse->buckets[hash % IR_CSE_BUCKETS]; i >= 0; i = cse->available[i].next)
+    {
+        IrAvailable *avail = &cse->available[i];
+        if ( (avail->hash != hash) || (!ir_exprs_equal(*avail->slot, expr)) ||
+             (!ir_still_available(ctx, cse, avail)) )
+            continue;
+        else if ((avail->temp < 0) && (!hoist_ir_expr(ctx, cse, avail)))
+            return 1;
+
+        MOJOSHADER_irExpression *use = new_ir_temp(ctx, avail->temp, expr->info.type, expr->info.elements);
+        if (use == NULL)
+            return 1;
+        delete_ir(ctx, expr);
+        *slot = use;
+        cse->changes++;
+        return 0;
+    } // for
+
+    add_ir_available(ctx, cse, slot, hash);
+    return 1;
+} // eliminate_ir_subexpr
+
+static int find_ir_memory_range(Context *ctx, MOJOSHADER_irExpression **slot,
+                                void *data)
+{
+    IrSubexpressions *cse = (IrSubexpressions *) data;
+    const MOJOSHADER_irExpression *expr = *slot;
+    if (expr->ir.type == MOJOSHADER_IR_MEMORY)
+    {
+        const int index = expr->memory.index;
+        if (cse->num_memory == 0)
+        {
+            cse->min_memory = index;
+            cse->num_memory = 1;
+        } // if
+        else if (index < cse->min_memory)
+        {
+            cse->num_memory += cse->min_memory - index;
+            cse->min_memory = index;
+        } // else if
+        else if (index >= cse->min_memory + cse->num_memory)
+            cse->num_memory = (index - cse->min_memory) + 1;
+    } // if
+    return 1;
+} // find_ir_memory_range
+
+// Within each basic block, computes an expression that's used more than
+//  once into a temp the first time, and reads the temp after that.
+static void eliminate_ir_subexprs(Context *ctx, IrStatementList *list,
+                                  const int rettemp, int *changes)
+{
+    IrSubexpressions cse;
+    int i, count;
+
+    memset(&cse, '\0', sizeof (cse));
+    cse.list = list;
+    cse.call_made = -1;
+    forget_ir_available(&cse);
+
+    for (i = 0; i < list->count; i++)
+    {
+        MOJOSHADER_irStatement *stmt = list->stmts[i];
+        visit_ir_reads(ctx, stmt, find_ir_memory_range, &cse);
+        if (stmt->ir.type == MOJOSHADER_IR_MOVE)
+        {
+            MOJOSHADER_irExpression *dst = ir_dest_base(stmt->move.dst);
+            find_ir_memory_range(ctx, &dst, &cse);
+        } // if
+    } // for
+
+    cse.num_temps = ctx->ir_temp_count;
+    const size_t len = sizeof (int) * (cse.num_temps + cse.num_memory + 1);
+    cse.temp_written = (int *) Malloc(ctx, len);
+    if (cse.temp_written == NULL)
+        return;
+    cse.memory_written = cse.temp_written + cse.num_temps;
+    for (i = 0; i < cse.num_temps + cse.num_memory; i++)
+        cse.temp_written[i] = -1;
+
+    // (i) walks the original statements; hoisting adds more in front of
+    //  (cse.pos) as we go.
+    count = list->count;
+    cse.pos = 0;
+    for (i = 0; i < count; i++, cse.pos++)
+    {
+        MOJOSHADER_irStatement *stmt = list->stmts[cse.pos];
+
+        if (stmt->ir.type == MOJOSHADER_IR_LABEL)
+            forget_ir_available(&cse);  // new basic block.
+
+        cse.stamp = i;
+        cse.has_call = ir_stmt_has_call(ctx, stmt);
+        visit_ir_reads(ctx, stmt, eliminate_ir_subexpr, &cse);
+
+        if (stmt->ir.type == MOJOSHADER_IR_MOVE)
+        {
+            const MOJOSHADER_irExpression *dst = ir_dest_base(stmt->move.dst);
+            if (!ir_type_is_scalar(dst->info.type))
+                forget_ir_available(&cse);  // a whole struct, etc.
+            else if ( (dst->ir.type == MOJOSHADER_IR_TEMP) &&
+                 (dst->temp.index >= 0) && (dst->temp.index < cse.num_temps) )
+                cse.temp_written[dst->temp.index] = i;
+            else if (dst->ir.type == MOJOSHADER_IR_MEMORY)
+                cse.memory_written[dst->memory.index - cse.min_memory] = i;
+        } // if
+
+        if (cse.has_call)
+            cse.call_made = i;
+
+        if ((stmt->ir.type == MOJOSHADER_IR_JUMP) || (stmt->ir.type == MOJOSHADER_IR_CJUMP))
+            forget_ir_available(&cse);  // end of basic block.
+    } // for
+
+    *changes += cse.changes;
+    if (cse.available != NULL)
+        Free(ctx, cse.available);
+    Free(ctx, cse.temp_written);
+} // eliminate_ir_subexprs
+
+
+// Dead code elimination...
+
+static int ir_move_is_dead(Context *ctx, const MOJOSHADER_irStatement *stmt,
+                           const IrTempCounts *counts, const int rettemp)
+{
+    const MOJOSHADER_irExpression *dst = stmt->move.dst;
+    const MOJOSHADER_irExpression *src = stmt->move.src;
+    const MOJOSHADER_irExpression *base = ir_dest_base(stmt->move.dst);
+
+    // moving something onto itself.
+    if (ir_exprs_equal(dst, src) &&
+        ((dst->ir.type == MOJOSHADER_IR_TEMP) || (dst->ir.type == MOJOSHADER_IR_MEMORY)))
+        return 1;
+
+    // writing a temp that nothing reads.
+    return ( (!counts->aggregates) &&
+             (base->ir.type == MOJOSHADER_IR_TEMP) &&
+             (base->temp.index != rettemp) &&
+             (base->temp.index >= 0) &&
+             (base->temp.index < counts->total) &&
+             (counts->reads[base->temp.index] == 0) &&
+             (!ir_stmt_has_call(ctx, (MOJOSHADER_irStatement *) stmt)) );
+} // ir_move_is_dead
+
+// Removes writes to temps that nothing reads, code that nothing can reach,
+//  jumps to the very next statement and labels that nothing jumps to.
+static void eliminate_ir_dead_code(Context *ctx, IrStatementList *list,
+                                   const int rettemp, int *changes)
+{
+    int removed = 1;
+    int *jumps = NULL;
+    int i, count;
+
+    // removing one write can leave the temps it read unread, too.
+    while (removed)
+    {
+        IrTempCounts counts;
+        if (!count_ir_temps(ctx, list, &counts))
+            return;
+
+        removed = 0;
+        for (i = count = 0; i < list->count; i++)
+        {
+            MOJOSHADER_irStatement *stmt = list->stmts[i];
+            if ((stmt->ir.type == MOJOSHADER_IR_MOVE) && (ir_move_is_dead(ctx, stmt, &counts, rettemp)))
+            {
+                delete_ir(ctx, stmt);
+                removed++;
+            } // if
+            else
+            {
+                list->stmts[count++] = stmt;
+            } // else
+        } // for
+
+        list->count = count;
+        *changes += removed;
+        Free(ctx, counts.reads);
+    } // while
+
+    // how many jumps go to each label. A label nothing jumps to doesn't
+    //  start a new basic block, so the code after it can be unreachable.
+    const size_t len = sizeof (int) * (ctx->ir_label_count > 0 ? ctx->ir_label_count : 1);
+    jumps = (int *) Malloc(ctx, len);
+    if (jumps == NULL)
+        return;
+    memset(jumps, '\0', len);
+    for (i = 0; i < list->count; i++)
+    {
+        const MOJOSHADER_irStatement *stmt = list->stmts[i];
+        if (stmt->ir.type == MOJOSHADER_IR_JUMP)
+            jumps[stmt->jump.label]++;
+        else if (stmt->ir.type == MOJOSHADER_IR_CJUMP)
+        {
+            jumps[stmt->cjump.iftrue]++;
+            jumps[stmt->cjump.iffalse]++;
+        } // else if
+    } // for
+
+    // removing a jump can leave its label unused, so go until nothing changes.
+    for (removed = 1; removed; )
+    {
+        removed = 0;
+        for (i = count = 0; i < list->count; i++)
+        {
+            MOJOSHADER_irStatement *stmt = list->stmts[i];
+            MOJOSHADER_irStatement *prev = (count > 0) ? list->stmts[count-1] : NULL;
+            int dead = 0;
+
+            if ((stmt->ir.type == MOJOSHADER_IR_LABEL) && (jumps[stmt->label.index] == 0))
+                dead = 1;  // nothing jumps here.
+            else if ((prev != NULL) && (prev->ir.type == MOJOSHADER_IR_JUMP))
+            {
+                if (stmt->ir.type != MOJOSHADER_IR_LABEL)
+                    dead = 1;  // nothing can get here.
+                else if (prev->jump.label == stmt->label.index)
+                {
+                    jumps[prev->jump.label]--;  // it'd get here anyhow.
+                    delete_ir(ctx, prev);
+                    count--;
+                    removed++;
+                } // else if
+            } // else if
+
+            if (!dead)
+                list->stmts[count++] = stmt;
+            else
+            {
+                if (stmt->ir.type == MOJOSHADER_IR_JUMP)
+                    jumps[stmt->jump.label]--;
+                else if (stmt->ir.type == MOJOSHADER_IR_CJUMP)
+                {
+                    jumps[stmt->cjump.iftrue]--;
+                    jumps[stmt->cjump.iffalse]--;
+                } // else if
+                delete_ir(ctx, stmt);
+                removed++;
+            } // else
+        } // for
+
+        list->count = count;
+        *changes += removed;
+    } // for
+
+    Free(ctx, jumps);
+} // eliminate_ir_dead_code
+
+
+typedef void (*IrPassFn)(Context *ctx, IrStatementList *list,
+                         const int rettemp, int *changes);
+
+// After the first round, the stats only add what the pass itself changed,
+//  so "after" is what it started with plus everything it did.
+static void run_ir_pass(Context *ctx, IrStatementList *list, const IrPass pass,
+                        IrPassFn fn, const int rettemp, const int round)
+{
+    IrPassStats *stats = &ctx->ir_stats[pass];
+    IrCounts before, after;
+    if (ctx->out_of_memory)
+        return;
+    memset(&before, '\0', sizeof (before));
+    memset(&after, '\0', sizeof (after));
+    if (ctx->want_ir_stats)
+        add_ir_counts(ctx, (round == 0) ? &stats->before : &before, NULL, list);
+    fn(ctx, list, rettemp, &stats->changes);
+    if (ctx->want_ir_stats)
+    {
+        add_ir_counts(ctx, &after, NULL, list);
+        stats->after.instructions += after.instructions - before.instructions;
+        stats->after.nodes += after.nodes - before.nodes;
+        stats->after.temps += after.temps - before.temps;
+    } // if
+} // run_ir_pass
+
+static int count_ir_labels(const IrStatementList *list)
+{
+    int retval = 0;
+    int i;
+    for (i = 0; i < list->count; i++)
+        retval += (list->stmts[i]->ir.type == MOJOSHADER_IR_LABEL);
+    return retval;
+} // count_ir_labels
+
+// Dead code elimination can merge basic blocks, which gives the passes
+//  that work one block at a time more to see. Merging blocks is what makes
+//  another round worthwhile, so we stop when it doesn't, or after this many.
+#define IR_OPTIMIZE_ROUNDS 4
+
+// Optimizes one function's IR, returning the new version. (rettemp) is the
+//  temp that holds the function's return value, or -1 if there isn't one.
+static MOJOSHADER_irStatement *optimize_ir(Context *ctx,
+                                           MOJOSHADER_irStatement *ir,
+                                           const int rettemp)
+{
+    IrStatementList list;
+    MOJOSHADER_irStatement *retval = NULL;
+    int round, i;
+
+    if ((ir == NULL) || (ctx->out_of_memory))
+        return ir;
+
+    memset(&list, '\0', sizeof (list));
+    if (ctx->want_ir_stats)
+        add_ir_counts(ctx, &ctx->ir_stats[IR_PASS_CANONICALIZE].before, ir, NULL);
+    linearize_ir(ctx, &list, ir);
+    if (ctx->want_ir_stats)
+        add_ir_counts(ctx, &ctx->ir_stats[IR_PASS_CANONICALIZE].after, NULL, &list);
+
+    for (round = 0; round < IR_OPTIMIZE_ROUNDS; round++)
+    {
+        const int labels = count_ir_labels(&list);
+        run_ir_pass(ctx, &list, IR_PASS_FOLD_CONSTANTS, fold_ir_constants, rettemp, round);
+        run_ir_pass(ctx, &list, IR_PASS_PROPAGATE_COPIES, propagate_ir_copies, rettemp, round);
+        run_ir_pass(ctx, &list, IR_PASS_COMMON_SUBEXPRESSIONS, eliminate_ir_subexprs, rettemp, round);
+        run_ir_pass(ctx, &list, IR_PASS_DEAD_CODE, eliminate_ir_dead_code, rettemp, round);
+        if ((ctx->out_of_memory) || (count_ir_labels(&list) == labels))
+            break;
+    } // for
+
+    if (ctx->out_of_memory)
+    {
+        ir_list_free(ctx, &list);
+        return NULL;
+    } // if
+
+    for (i = list.count - 1; i >= 0; i--)
+    {
+        ctx->sourcefile = list.stmts[i]->ir.filename;
+        ctx->sourceline = list.stmts[i]->ir.line;
+        MOJOSHADER_irStatement *seq = new_ir_seq(ctx, list.stmts[i], retval);
+        if (seq != NULL)
+            retval = seq;
+        else
+            delete_ir(ctx, list.stmts[i]);
+    } // for
+
+    Free(ctx, list.stmts);
+    return retval;
+} // optimize_ir
+
+/* Flat IR... */
+
+// Once a function's IR is built and optimized, store_ir() packs it into an
+//  IrFlat and deletes the tree. A tree node costs a Malloc, a pointer per
+//  operand and a 64-byte value array for every constant; a flat node is a
+//  few bytes in each of the IrFlat arrays, plus 32-bit operand indices, and
+//  constants are interned in a pool that every function shares.
+
+#define IR_FLAT_NONE 0xFFFFFFFF
+
+typedef struct IrFlatNode
+{
+    uint32 first;  // index of this node's operands in IrFlatBuilder.
+    uint32 line;
+    uint16 elements;
+    uint16 file;
+    uint8 type;
+    uint8 datatype;
+    uint8 op;
+} IrFlatNode;
+
+typedef struct IrFlatBuilder
+{
+    IrFlatNode *nodes;
+    int node_count;
+    int node_alloc;
+    uint32 *operands;
+    int operand_count;
+    int operand_alloc;
+    uint32 *stack;  // a SEQ or EXPRLIST chain's items, until we add the node.
+    int stack_count;
+    int stack_alloc;
+    int link_count;
+} IrFlatBuilder;
+
+// Pool entries are a word count followed by that many words of value. The
+//  hashtable keys are an entry's offset in ctx->ir_constants, plus one so
+//  they aren't NULL.
+static uint32 hash_hash_ir_constant(const void *key, void *data)
+{
+    const Context *ctx = (const Context *) data;
+    const uint32 *words = ctx->ir_constants + (((size_t) key) - 1);
+    return hash_bytes(words, (words[0] + 1) * sizeof (uint32));
+} // hash_hash_ir_constant
+
+static int hash_keymatch_ir_constant(const void *a, const void *b, void *data)
+{
+    const Context *ctx = (const Context *) data;
+    const uint32 *x = ctx->ir_constants + (((size_t) a) - 1);
+    const uint32 *y = ctx->ir_constants + (((size_t) b) - 1);
+    return (memcmp(x, y, (x[0] + 1) * sizeof (uint32)) == 0);
+} // hash_keymatch_ir_constant
+
+static void ir_constant_nuke(const void *key, const void *value, void *data)
+{
+    // no-op; the keys and values aren't pointers.
+} // ir_constant_nuke
+
+static uint32 intern_ir_constant(Context *ctx, const MOJOSHADER_irConstant *c)
+{
+    const int count = c->info.elements;
+    const int offset = ctx->ir_constant_count;
+    const void *key = (const void *) (((size_t) offset) + 1);
+    const void *value = NULL;
+
+    assert((count >= 0) && (count <= STATICARRAYLEN(c->value.ival)));
+    if (!grow_array(ctx, (void **) &ctx->ir_constants,
+                    &ctx->ir_constant_alloc, offset + count + 1,
+                    sizeof (uint32)))
+        return IR_FLAT_NONE;
+
+    // put it at the end of the pool; if it's already in there, that space
+    //  just gets reused by the next one.
+    ctx->ir_constants[offset] = (uint32) count;
+    memcpy(ctx->ir_constants + offset + 1, c->value.ival, count * sizeof (uint32));
+    if (hash_find(ctx->ir_constant_map, key, &value))
+        return (uint32) (((size_t) value) - 1);
+
+    if (hash_insert(ctx->ir_constant_map, key, key) != 1)
+    {
+        out_of_memory(ctx);
+        return IR_FLAT_NONE;
+    } // if
+
+    ctx->ir_constant_count += count + 1;
+    return (uint32) offset;
+} // intern_ir_constant
+
+static int flat_ir_file(Context *ctx, const char *filename)
+{
+    // filenames are in the string cache, and there aren't many of them.
+    int i;
+    for (i = ctx->ir_file_count - 1; i >= 0; i--)
+    {
+        if (ctx->ir_files[i] == filename)
+            return i;
+    } // for
+
+    if (ctx->ir_file_count > 0xFFFF)
+    {
+        fail(ctx, "Internal error: too many source files for the IR");
+        return 0;
+    } // if
+
+    if (!grow_array(ctx, (void **) &ctx->ir_files, &ctx->ir_file_alloc,
+                    ctx->ir_file_count + 1, sizeof (const char *)))
+        return 0;
+
+    ctx->ir_files[ctx->ir_file_count] = filename;
+    return ctx->ir_file_count++;
+} // flat_ir_file
+
+static uint32 add_flat_ir_node(Context *ctx, IrFlatBuilder *b,
+                               const MOJOSHADER_irNode *ir, const int op,
+                               const uint32 *operands, const int count)
+{
+    const MOJOSHADER_irNodeType type = ir->ir.type;
+    IrFlatNode *node = NULL;
+
+    if (!grow_array(ctx, (void **) &b->nodes, &b->node_alloc,
+                    b->node_count + 1, sizeof (IrFlatNode)))
+        return IR_FLAT_NONE;
+    else if (!grow_array(ctx, (void **) &b->operands, &b->operand_alloc,
+                         b->operand_count + count, sizeof (uint32)))
+        return IR_FLAT_NONE;
+
+    node = &b->nodes[b->node_count];
+    memset(node, '\0', sizeof (IrFlatNode));
+    node->type = (uint8) type;
+    node->op = (uint8) op;
+    node->file = (uint16) flat_ir_file(ctx, ir->ir.filename);
+    node->line = ir->ir.line;
+    node->first = (uint32) b->operand_count;
+
+    if ((type > MOJOSHADER_IR_START_RANGE_EXPR) && (type < MOJOSHADER_IR_END_RANGE_EXPR))
+    {
+        if ((ir->expr.info.elements < 0) || (ir->expr.info.elements > 0xFFFF))
+            fail(ctx, "Internal error: IR expression is too large");
+        node->datatype = (uint8) ir->expr.info.type;
+        node->elements = (uint16) ir->expr.info.elements;
+    } // if
+
+    memcpy(b->operands + b->operand_count, operands, count * sizeof (uint32));
+    b->operand_count += count;
+    return (uint32) b->node_count++;
+} // add_flat_ir_node
+
+static uint32 encode_flat_ir(Context *ctx, IrFlatBuilder *b, const void *_ir);
+
+static int push_flat_ir_stack(Context *ctx, IrFlatBuilder *b, const uint32 idx)
+{
+    if (!grow_array(ctx, (void **) &b->stack, &b->stack_alloc,
+                    b->stack_count + 1, sizeof (uint32)))
+        return 0;
+    b->stack[b->stack_count++] = idx;
+    return 1;
+} // push_flat_ir_stack
+
+// A SEQ or EXPRLIST chain becomes one node, with each link's item as an
+//  operand (and for a SEQ, the statement at the end of the chain last),
+//  so long functions don't recurse once per statement.
+static uint32 encode_flat_ir_chain(Context *ctx, IrFlatBuilder *b,
+                                   const MOJOSHADER_irNode *ir)
+{
+    const MOJOSHADER_irNodeType type = ir->ir.type;
+    const int seq = (type == MOJOSHADER_IR_SEQ);
+    const int base = b->stack_count;
+    const MOJOSHADER_irNode *link = ir;
+    int count = 0;
+
+    while ((link != NULL) && (link->ir.type == type))
+    {
+        uint32 idx;
+        if (seq)
+        {
+            idx = encode_flat_ir(ctx, b, link->stmt.seq.first);
+            link = (const MOJOSHADER_irNode *) link->stmt.seq.next;
+        } // if
+        else
+        {
+            idx = encode_flat_ir(ctx, b, link->misc.exprlist.expr);
+            link = (const MOJOSHADER_irNode *) link->misc.exprlist.next;
+        } // else
+
+        if (!push_flat_ir_stack(ctx, b, idx))
+            return IR_FLAT_NONE;
+    } // while
+
+    assert(seq || (link == NULL));
+    if (seq && !push_flat_ir_stack(ctx, b, encode_flat_ir(ctx, b, link)))
+        return IR_FLAT_NONE;
+
+    count = b->stack_count - base;
+    b->stack_count = base;
+    b->link_count += count - (seq ? 2 : 1);
+    return add_flat_ir_node(ctx, b, ir, 0, b->stack + base, count);
+} // encode_flat_ir_chain
+
+// Operands are node indices (IR_FLAT_NONE for NULL), except for temp,
+//  memory, call, jump and label indices, iftrue/iffalse labels, move
+//  writemasks, swizzle channels (packed into one operand), convert
+//  columns and constants (an offset into ctx->ir_constants).
+static uint32 encode_flat_ir(Context *ctx, IrFlatBuilder *b, const void *_ir)
+{
+    const MOJOSHADER_irNode *ir = (const MOJOSHADER_irNode *) _ir;
+    uint32 operands[5];
+    int count = 0;
+    int op = 0;
+
+    if (ir == NULL)
+        return IR_FLAT_NONE;
+
+    switch (ir->ir.type)
+    {
+        case MOJOSHADER_IR_CONSTANT:
+            operands[count++] = intern_ir_constant(ctx, &ir->expr.constant);
+            break;
+
+        case MOJOSHADER_IR_TEMP:
+            operands[count++] = (uint32) ir->expr.temp.index;
+            break;
+
+        case MOJOSHADER_IR_MEMORY:
+            operands[count++] = (uint32) ir->expr.memory.index;
+            break;
+
+        case MOJOSHADER_IR_BINOP:
+            op = (int) ir->expr.binop.op;
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.binop.left);
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.binop.right);
+            break;
+
+        case MOJOSHADER_IR_CALL:
+            operands[count++] = (uint32) ir->expr.call.index;
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.call.args);
+            break;
+
+        case MOJOSHADER_IR_ESEQ:
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.eseq.stmt);
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.eseq.expr);
+            break;
+
+        case MOJOSHADER_IR_ARRAY:
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.array.array);
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.array.element);
+            break;
+
+        case MOJOSHADER_IR_CONVERT:
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.convert.expr);
+            operands[count++] = (uint32) ir->expr.convert.columns;
+            break;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.swizzle.expr);
+            memcpy(&operands[count++], ir->expr.swizzle.channels, sizeof (uint32));
+            break;
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.construct.args);
+            break;
+
+        case MOJOSHADER_IR_SELECT:
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.select.cond);
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.select.iftrue);
+            operands[count++] = encode_flat_ir(ctx, b, ir->expr.select.iffalse);
+            break;
+
+        case MOJOSHADER_IR_MOVE:
+            operands[count++] = encode_flat_ir(ctx, b, ir->stmt.move.dst);
+            operands[count++] = encode_flat_ir(ctx, b, ir->stmt.move.src);
+            operands[count++] = (uint32) ir->stmt.move.writemask;
+            break;
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            operands[count++] = encode_flat_ir(ctx, b, ir->stmt.expr.expr);
+            break;
+
+        case MOJOSHADER_IR_JUMP:
+            operands[count++] = (uint32) ir->stmt.jump.label;
+            break;
+
+        case MOJOSHADER_IR_CJUMP:
+            op = (int) ir->stmt.cjump.cond;
+            operands[count++] = encode_flat_ir(ctx, b, ir->stmt.cjump.left);
+            operands[count++] = encode_flat_ir(ctx, b, ir->stmt.cjump.right);
+            operands[count++] = (uint32) ir->stmt.cjump.iftrue;
+            operands[count++] = (uint32) ir->stmt.cjump.iffalse;
+            operands[count++] = (uint32) ir->stmt.cjump.branch;
+            break;
+
+        case MOJOSHADER_IR_LABEL:
+            operands[count++] = (uint32) ir->stmt.label.index;
+            break;
+
+        case MOJOSHADER_IR_DISCARD:
+            break;
+
+        case MOJOSHADER_IR_SEQ:
+        case MOJOSHADER_IR_EXPRLIST:
+            return encode_flat_ir_chain(ctx, b, ir);
+
+        default:
+            assert(0 && "unexpected IR node");
+            return IR_FLAT_NONE;
+    } // switch
+
+    return add_flat_ir_node(ctx, b, ir, op, operands, count);
+} // encode_flat_ir
+
+#ifndef NDEBUG
+static MOJOSHADER_irStatement *ir_tree_view(Context *ctx, const IrFlat *flat);
+
+// Non-zero if two trees are the same, down to every node's source line.
+//  Code generation only sees ir_tree_view(), so this is how we know the
+//  flat encoding didn't change what it generates.
+static int ir_trees_match(const void *_a, const void *_b)
+{
+    const MOJOSHADER_irNode *a = (const MOJOSHADER_irNode *) _a;
+    const MOJOSHADER_irNode *b = (const MOJOSHADER_irNode *) _b;
+
+    // walk down chains of SEQs and EXPRLISTs instead of recursing on them.
+    while ((a != NULL) && (b != NULL) && (a->ir.type == b->ir.type))
+    {
+        if (a->ir.type == MOJOSHADER_IR_SEQ)
+        {
+            if (!ir_trees_match(a->stmt.seq.first, b->stmt.seq.first))
+                return 0;
+            a = (const MOJOSHADER_irNode *) a->stmt.seq.next;
+            b = (const MOJOSHADER_irNode *) b->stmt.seq.next;
+        } // if
+        else if (a->ir.type == MOJOSHADER_IR_EXPRLIST)
+        {
+            if (!ir_trees_match(a->misc.exprlist.expr, b->misc.exprlist.expr))
+                return 0;
+            a = (const MOJOSHADER_irNode *) a->misc.exprlist.next;
+            b = (const MOJOSHADER_irNode *) b->misc.exprlist.next;
+        } // else if
+        else
+            break;
+    } // while
+
+    if ((a == NULL) || (b == NULL))
+        return (a == b);
+    else if ( (a->ir.type != b->ir.type) ||
+              (a->ir.filename != b->ir.filename) ||
+              (a->ir.line != b->ir.line) )
+        return 0;
+
+    const MOJOSHADER_irNodeType type = a->ir.type;
+    if ((type > MOJOSHADER_IR_START_RANGE_EXPR) && (type < MOJOSHADER_IR_END_RANGE_EXPR))
+    {
+        if ( (a->expr.info.type != b->expr.info.type) ||
+             (a->expr.info.elements != b->expr.info.elements) )
+            return 0;
+    } // if
+
+    switch (type)
+    {
+        case MOJOSHADER_IR_CONSTANT:
+            return (memcmp(a->expr.constant.value.ival, b->expr.constant.value.ival,
+                           sizeof (int) * a->expr.info.elements) == 0);
+        case MOJOSHADER_IR_TEMP:
+            return (a->expr.temp.index == b->expr.temp.index);
+        case MOJOSHADER_IR_MEMORY:
+            return (a->expr.memory.index == b->expr.memory.index);
+        case MOJOSHADER_IR_BINOP:
+            return ( (a->expr.binop.op == b->expr.binop.op) &&
+                     (ir_trees_match(a->expr.binop.left, b->expr.binop.left)) &&
+                     (ir_trees_match(a->expr.binop.right, b->expr.binop.right)) );
+        case MOJOSHADER_IR_CALL:
+            return ( (a->expr.call.index == b->expr.call.index) &&
+                     (ir_trees_match(a->expr.call.args, b->expr.call.args)) );
+        case MOJOSHADER_IR_ESEQ:
+            return ( (ir_trees_match(a->expr.eseq.stmt, b->expr.eseq.stmt)) &&
+                     (ir_trees_match(a->expr.eseq.expr, b->expr.eseq.expr)) );
+        case MOJOSHADER_IR_ARRAY:
+            return ( (ir_trees_match(a->expr.array.array, b->expr.array.array)) &&
+                     (ir_trees_match(a->expr.array.element, b->expr.array.element)) );
+        case MOJOSHADER_IR_CONVERT:
+            return ( (a->expr.convert.columns == b->expr.convert.columns) &&
+                     (ir_trees_match(a->expr.convert.expr, b->expr.convert.expr)) );
+        case MOJOSHADER_IR_SWIZZLE:
+            return ( (memcmp(a->expr.swizzle.channels, b->expr.swizzle.channels, sizeof (a->expr.swizzle.channels)) == 0) &&
+                     (ir_trees_match(a->expr.swizzle.expr, b->expr.swizzle.expr)) );
+        case MOJOSHADER_IR_CONSTRUCT:
+            return ir_trees_match(a->expr.construct.args, b->expr.construct.args);
+        case MOJOSHADER_IR_SELECT:
+            return ( (ir_trees_match(a->expr.select.cond, b->expr.select.cond)) &&
+                     (ir_trees_match(a->expr.select.iftrue, b->expr.select.iftrue)) &&
+                     (ir_trees_match(a->expr.select.iffalse, b->expr.select.iffalse)) );
+        case MOJOSHADER_IR_MOVE:
+            return ( (a->stmt.move.writemask == b->stmt.move.writemask) &&
+                     (ir_trees_match(a->stmt.move.dst, b->stmt.move.dst)) &&
+                     (ir_trees_match(a->stmt.move.src, b->stmt.move.src)) );
+        case MOJOSHADER_IR_EXPR_STMT:
+            return ir_trees_match(a->stmt.expr.expr, b->stmt.expr.expr);
+        case MOJOSHADER_IR_JUMP:
+            return (a->stmt.jump.label == b->stmt.jump.label);
+        case MOJOSHADER_IR_CJUMP:
+            return ( (a->stmt.cjump.cond == b->stmt.cjump.cond) &&
+                     (a->stmt.cjump.iftrue == b->stmt.cjump.iftrue) &&
+                     (a->stmt.cjump.iffalse == b->stmt.cjump.iffalse) &&
+                     (a->stmt.cjump.branch == b->stmt.cjump.branch) &&
+                     (ir_trees_match(a->stmt.cjump.left, b->stmt.cjump.left)) &&
+                     (ir_trees_match(a->stmt.cjump.right, b->stmt.cjump.right)) );
+        case MOJOSHADER_IR_LABEL:
+            return (a->stmt.label.index == b->stmt.label.index);
+        case MOJOSHADER_IR_DISCARD:
+            return 1;
+        default:
+            assert(0 && "unexpected IR node");
+            return 0;
+    } // switch
+} // ir_trees_match
+#endif
+
+// Packs a function's IR into ctx->ir[index], and deletes the tree. Builds
+//  with assertions check that unpacking it gives back the same tree.
+static void store_ir(Context *ctx, IrFlatBuilder *b, const int index,
+                     MOJOSHADER_irStatement *ir)
+{
+    IrFlat *flat = &ctx->ir[index];
+    size_t len = 0;
+    uint8 *ptr = NULL;
+    int i;
+
+    b->node_count = b->operand_count = b->stack_count = b->link_count = 0;
+    encode_flat_ir(ctx, b, ir);
+
+    if (b->node_count == 0)
+    {
+        delete_ir(ctx, ir);
+        return;
+    } // if
+
+    // one allocation per function, biggest alignment first.
+    len = ((b->node_count * 2) + 1 + b->operand_count) * sizeof (uint32);
+    len += (b->node_count * 2) * sizeof (uint16);
+    len += (b->node_count * 3) * sizeof (uint8);
+    ptr = (uint8 *) Malloc(ctx, len);
+    if (ptr == NULL)
+    {
+        delete_ir(ctx, ir);
+        return;
+    } // if
+
+    flat->node_count = b->node_count;
+    flat->link_count = b->link_count;
+    flat->first = (uint32 *) ptr; ptr += (b->node_count + 1) * sizeof (uint32);
+    flat->lines = (uint32 *) ptr; ptr += b->node_count * sizeof (uint32);
+    flat->operands = (uint32 *) ptr; ptr += b->operand_count * sizeof (uint32);
+    flat->elements = (uint16 *) ptr; ptr += b->node_count * sizeof (uint16);
+    flat->files = (uint16 *) ptr; ptr += b->node_count * sizeof (uint16);
+    flat->types = ptr; ptr += b->node_count;
+    flat->datatypes = ptr; ptr += b->node_count;
+    flat->ops = ptr;
+
+    for (i = 0; i < b->node_count; i++)
+    {
+        const IrFlatNode *node = &b->nodes[i];
+        flat->first[i] = node->first;
+        flat->lines[i] = node->line;
+        flat->elements[i] = node->elements;
+        flat->files[i] = node->file;
+        flat->types[i] = node->type;
+        flat->datatypes[i] = node->datatype;
+        flat->ops[i] = node->op;
+    } // for
+
+    flat->first[b->node_count] = (uint32) b->operand_count;
+    memcpy(flat->operands, b->operands, b->operand_count * sizeof (uint32));
+
+    #ifndef NDEBUG
+    const MOJOSHADER_irStatement *view = ir_tree_view(ctx, flat);
+    if ((!isfail(ctx)) && (!ir_trees_match(ir, view)))
+        failf(ctx, "Internal error: flat IR for function %d doesn't match its tree", index);
+    #endif
+
+    delete_ir(ctx, ir);
+} // store_ir
+
+static inline void *flat_ir_operand(MOJOSHADER_irNode *nodes, const uint32 idx)
+{
+    return (idx == IR_FLAT_NONE) ? NULL : &nodes[idx];
+} // flat_ir_operand
+
+// Unpacks an IrFlat into a tree, for code generation and print_ir(). The
+//  nodes are all in one array in the arena, so nothing needs to delete them.
+static MOJOSHADER_irStatement *ir_tree_view(Context *ctx, const IrFlat *flat)
+{
+    const int total = flat->node_count + flat->link_count;
+    MOJOSHADER_irNode *nodes = NULL;
+    int links = flat->node_count;
+    int i, j;
+
+    if (flat->node_count == 0)
+        return NULL;
+
+    nodes = (MOJOSHADER_irNode *) ArenaMalloc(ctx, total * sizeof (MOJOSHADER_irNode));
+    if (nodes == NULL)
+        return NULL;
+    memset(nodes, '\0', total * sizeof (MOJOSHADER_irNode));
+
+    for (i = 0; i < flat->node_count; i++)
+    {
+        MOJOSHADER_irNode *ir = &nodes[i];
+        const MOJOSHADER_irNodeType type = (MOJOSHADER_irNodeType) flat->types[i];
+        const uint32 *operands = flat->operands + flat->first[i];
+        const int count = (int) (flat->first[i+1] - flat->first[i]);
+
+        ir->ir.type = type;
+        ir->ir.filename = ctx->ir_files[flat->files[i]];
+        ir->ir.line = flat->lines[i];
+        if ((type > MOJOSHADER_IR_START_RANGE_EXPR) && (type < MOJOSHADER_IR_END_RANGE_EXPR))
+        {
+            ir->expr.info.type = (MOJOSHADER_astDataTypeType) flat->datatypes[i];
+            ir->expr.info.elements = flat->elements[i];
+        } // if
+
+        switch (type)
+        {
+            case MOJOSHADER_IR_CONSTANT:
+            {
+                const uint32 *words = ctx->ir_constants + operands[0];
+                memcpy(ir->expr.constant.value.ival, words + 1, words[0] * sizeof (uint32));
+                break;
+            } // case
+
+            case MOJOSHADER_IR_TEMP:
+                ir->expr.temp.index = (int) operands[0];
+                break;
+
+            case MOJOSHADER_IR_MEMORY:
+                ir->expr.memory.index = (int) operands[0];
+                break;
+
+            case MOJOSHADER_IR_BINOP:
+                ir->expr.binop.op = (MOJOSHADER_irBinOpType) flat->ops[i];
+                ir->expr.binop.left = flat_ir_operand(nodes, operands[0]);
+                ir->expr.binop.right = flat_ir_operand(nodes, operands[1]);
+                break;
+
+            case MOJOSHADER_IR_CALL:
+                ir->expr.call.index = (int) operands[0];
+                ir->expr.call.args = flat_ir_operand(nodes, operands[1]);
+                break;
+
+            case MOJOSHADER_IR_ESEQ:
+                ir->expr.eseq.stmt = flat_ir_operand(nodes, operands[0]);
+                ir->expr.eseq.expr = flat_ir_operand(nodes, operands[1]);
+                break;
+
+            case MOJOSHADER_IR_ARRAY:
+                ir->expr.array.array = flat_ir_operand(nodes, operands[0]);
+                ir->expr.array.element = flat_ir_operand(nodes, operands[1]);
+                break;
+
+            case MOJOSHADER_IR_CONVERT:
+                ir->expr.convert.expr = flat_ir_operand(nodes, operands[0]);
+                ir->expr.convert.columns = (int) operands[1];
+                break;
+
+            case MOJOSHADER_IR_SWIZZLE:
+                ir->expr.swizzle.expr = flat_ir_operand(nodes, operands[0]);
+                memcpy(ir->expr.swizzle.channels, &operands[1], sizeof (uint32));
+                break;
+
+            case MOJOSHADER_IR_CONSTRUCT:
+                ir->expr.construct.args = flat_ir_operand(nodes, operands[0]);
+                break;
+
+            case MOJOSHADER_IR_SELECT:
+                ir->expr.select.cond = flat_ir_operand(nodes, operands[0]);
+                ir->expr.select.iftrue = flat_ir_operand(nodes, operands[1]);
+                ir->expr.select.iffalse = flat_ir_operand(nodes, operands[2]);
+                break;
+
+            case MOJOSHADER_IR_MOVE:
+                ir->stmt.move.dst = flat_ir_operand(nodes, operands[0]);
+                ir->stmt.move.src = flat_ir_operand(nodes, operands[1]);
+                ir->stmt.move.writemask = (int) operands[2];
+                break;
+
+            case MOJOSHADER_IR_EXPR_STMT:
+                ir->stmt.expr.expr = flat_ir_operand(nodes, operands[0]);
+                break;
+
+            case MOJOSHADER_IR_JUMP:
+                ir->stmt.jump.label = (int) operands[0];
+                break;
+
+            case MOJOSHADER_IR_CJUMP:
+                ir->stmt.cjump.cond = (MOJOSHADER_irConditionType) flat->ops[i];
+                ir->stmt.cjump.left = flat_ir_operand(nodes, operands[0]);
+                ir->stmt.cjump.right = flat_ir_operand(nodes, operands[1]);
+                ir->stmt.cjump.iftrue = (int) operands[2];
+                ir->stmt.cjump.iffalse = (int) operands[3];
+                ir->stmt.cjump.branch = (int) operands[4];
+                break;
+
+            case MOJOSHADER_IR_LABEL:
+                ir->stmt.label.index = (int) operands[0];
+                break;
+
+            case MOJOSHADER_IR_DISCARD:
+                break;
+
+            case MOJOSHADER_IR_SEQ:
+            {
+                // the last operand is the end of the chain, not a link.
+                MOJOSHADER_irNode *seq = ir;
+                for (j = 0; j < count - 1; j++)
+                {
+                    if (j > 0)
+                    {
+                        MOJOSHADER_irNode *link = &nodes[links++];
+                        link->ir = ir->ir;
+                        seq->stmt.seq.next = &link->stmt;
+                        seq = link;
+                    } // if
+                    seq->stmt.seq.first = flat_ir_operand(nodes, operands[j]);
+                } // for
+                seq->stmt.seq.next = flat_ir_operand(nodes, operands[count - 1]);
+                break;
+            } // case
+
+            case MOJOSHADER_IR_EXPRLIST:
+            {
+                MOJOSHADER_irNode *list = ir;
+                for (j = 0; j < count; j++)
+                {
+                    if (j > 0)
+                    {
+                        MOJOSHADER_irNode *link = &nodes[links++];
+                        link->ir = ir->ir;
+                        list->misc.exprlist.next = &link->misc.exprlist;
+                        list = link;
+                    } // if
+                    list->misc.exprlist.expr = flat_ir_operand(nodes, operands[j]);
+                } // for
+                break;
+            } // case
+
+            default: assert(0 && "unexpected IR node"); break;
+        } // switch
+    } // for
+
+    assert(links == total);
+    return &nodes[flat->node_count - 1].stmt;
+} // ir_tree_view
+
+
+
+static int start_ir(Context *ctx)
+{
+    const size_t arraylen = (ctx->user_func_index+1) * sizeof (IrFlat);
+    const size_t funcslen = (ctx->user_func_index+1) * sizeof (IrFunction);
+    int i;
+
+    ctx->ir_constant_map = hash_create(ctx, hash_hash_ir_constant,
+                                       hash_keymatch_ir_constant,
+                                       ir_constant_nuke, 1,
+                                       MallocBridge, FreeBridge, ctx);
+    if (ctx->ir_constant_map == NULL)
+    {
+        out_of_memory(ctx);
+        return 0;
+    } // if
+
+    ctx->ir = (IrFlat *) Malloc(ctx, arraylen);
+    if (ctx->ir == NULL)
+        return 0;
+    memset(ctx->ir, '\0', arraylen);
+
+    ctx->ir_funcs = Malloc(ctx, funcslen);
+    if (ctx->ir_funcs == NULL)
+        return 0;
+    memset(ctx->ir_funcs, '\0', funcslen);
+    for (i = 0; i <= ctx->user_func_index; i++)
+        ctx->ir_funcs[i].rettemp = -1;
+
+    ctx->ir_end = -1;
+    ctx->ir_ret = -1;
+    return 1;
+} // start_ir
+
+// Builds, optimizes and stores one function definition's IR. Its slot in
+//  ctx->ir has to be empty.
+static void function_ir(Context *ctx, IrFlatBuilder *builder,
+                        const MOJOSHADER_astCompilationUnitFunction *astfn)
+{
+    assert(astfn->definition != NULL);
+    assert(ctx->ir_loop == NULL);  // parser should have caught this!
+    assert(ctx->ir_end < 0);  // parser should have caught this!
+    assert(ctx->ir_ret < 0);  // parser should have caught this!
+    const int start = generate_ir_label(ctx);  // !!! FIXME: store somewhere.
+    const int end = generate_ir_label(ctx);
+    const int first_temp = ctx->ir_temp_count;
+    ctx->ir_end = end;
+
+    if (astfn->declaration->datatype != NULL)
+        ctx->ir_ret = generate_ir_temp(ctx);
+
+    MOJOSHADER_irStatement *funcseq = new_ir_seq(ctx, new_ir_label(ctx, start), build_ir_stmt(ctx, astfn->definition));
+    funcseq = new_ir_seq(ctx, funcseq, new_ir_label(ctx, end));
+    funcseq = optimize_ir(ctx, funcseq, ctx->ir_ret);
+    assert(ctx->ir_loop == NULL);  // parser should have caught this!
+
+    assert(astfn->index <= ctx->user_func_index);
+    assert(ctx->ir[astfn->index].node_count == 0);
+    store_ir(ctx, builder, astfn->index, funcseq);
+    ctx->ir_funcs[astfn->index].ast = astfn;
+    ctx->ir_funcs[astfn->index].rettemp = ctx->ir_ret;
+    ctx->ir_funcs[astfn->index].first_temp = first_temp;
+    ctx->ir_funcs[astfn->index].temp_count = ctx->ir_temp_count - first_temp;
+
+    ctx->ir_end = -1;
+    ctx->ir_ret = -1;
+} // function_ir
+
+// Function zero runs the static globals' initializers.
+static void statics_ir(Context *ctx, IrFlatBuilder *builder)
+{
+    const MOJOSHADER_astCompilationUnit *ast = NULL;
+    MOJOSHADER_irStatement *globalseq = NULL;
+
+    // Function zero gets built last, so its temps are contiguous, too.
+    ctx->ir_funcs[0].first_temp = ctx->ir_temp_count;
+    for (ast = &ctx->ast->compunit; ast != NULL; ast = ast->next)
+    {
+        // Other globals are uniforms; their initializers are just
+        //  default values for the app to use.
+        if (ast->ast.type == MOJOSHADER_AST_COMPUNIT_VARIABLE)
+        {
+            const MOJOSHADER_astCompilationUnitVariable *var = (const MOJOSHADER_astCompilationUnitVariable *) ast;
+            const MOJOSHADER_astVariableDeclaration *decl = var->declaration;
+            if (decl->attributes & MOJOSHADER_AST_VARATTR_STATIC)
+                globalseq = new_ir_seq(ctx, globalseq, build_ir_vardecl(ctx, decl));
+        } // if
+    } // for
+
+    if (globalseq != NULL)
+        store_ir(ctx, builder, 0, optimize_ir(ctx, globalseq, -1));
+    ctx->ir_funcs[0].temp_count = ctx->ir_temp_count - ctx->ir_funcs[0].first_temp;
+} // statics_ir
+
+static void free_flat_ir_builder(Context *ctx, IrFlatBuilder *builder)
+{
+    Free(ctx, builder->nodes);
+    Free(ctx, builder->operands);
+    Free(ctx, builder->stack);
+    memset(builder, '\0', sizeof (*builder));
+} // free_flat_ir_builder
+
+static void intermediate_representation(Context *ctx)
+{
+    const MOJOSHADER_astCompilationUnit *ast = NULL;
+    IrFlatBuilder builder;
+
+    if (!start_ir(ctx))
+        return;
+
+    memset(&builder, '\0', sizeof (builder));
+    for (ast = &ctx->ast->compunit; ast != NULL; ast = ast->next)
+    {
+        assert(ast->ast.type > MOJOSHADER_AST_COMPUNIT_START_RANGE);
+        assert(ast->ast.type < MOJOSHADER_AST_COMPUNIT_END_RANGE);
+
+        if (ast->ast.type != MOJOSHADER_AST_COMPUNIT_FUNCTION)
+            continue;  // only care about functions and variables right now.
+
+        const MOJOSHADER_astCompilationUnitFunction *astfn;
+        astfn = (const MOJOSHADER_astCompilationUnitFunction *) ast;
+        if (astfn->definition != NULL)  // NULL is just a predeclare; skip.
+            function_ir(ctx, &builder, astfn);
+    } // for
+
+    statics_ir(ctx, &builder);
+    free_flat_ir_builder(ctx, &builder);
+
+    #if DEBUG_COMPILER_IR
+    print_whole_ir(ctx, stdout);
+    print_ir_stats(ctx, stdout);
+    #endif
+
+    // The AST stays around until code generation is done with it; the nodes
+    //  stay in the arena until destroy_context().
+} // intermediate_representation
+
+/* Code generation... */
+
+// This turns the IR into D3D assembly source, then hands that and the
+//  uniforms' symbols to MOJOSHADER_assemble(), which builds the bytecode and
+//  its CTAB for us.
+//
+// Shader Model 2 doesn't have much in the way of flow control, so we flatten
+//  everything: user functions are inlined into their callers, every basic
+//  block gets a predicate (1.0 if the block runs, 0.0 if it doesn't), and a
+//  write in a block that might not run becomes a cmp or lrp that keeps the
+//  old value when the predicate is zero. That only works when every branch
+//  goes forward, so loops have to be unrolled before they get here. Shader
+//  Model 3 runs the loops that weren't unrolled with rep and break, and
+//  [branch] ifs with if_ne and else; everything else is still flattened.
+//
+// Every instruction writes to a new virtual register, and nothing writes to
+//  a virtual register once the instructions that build its value are done,
+//  so variables can share registers without copying anything. The one
+//  exception is the registers that carry values out of Shader Model 3 loops
+//  and branches; see asm_make_homes(). Virtual registers get packed into r#
+//  registers once all the code is generated.
+
+// def'd constants, until we know which c# registers they go in.
+#define ASMREG_LITERAL ((RegisterType) (REG_TYPE_MAX + 1))
+
+// flow control instructions' destination, which isn't there.
+#define ASMREG_NONE ((RegisterType) (REG_TYPE_MAX + 2))
+
+// rep runs this many times at most; see asm_begin_loop().
+#define ASM_REP_COUNT 255
+
+typedef struct AsmOperand
+{
+    RegisterType regtype;
+    int regnum;  // a virtual register if (regtype) is REG_TYPE_TEMP.
+    int elements;  // how many components this value has, 1 to 4.
+    int swizzle[4];  // the channel that holds each component.
+    int negate;
+    int relative;  // c[a0.x + regnum] (vertex shaders only).
+} AsmOperand;
+
+typedef enum AsmOpcode
+{
+    ASMOP_MOV, ASMOP_ADD, ASMOP_SUB, ASMOP_MUL, ASMOP_MAD, ASMOP_MIN,
+    ASMOP_MAX, ASMOP_ABS, ASMOP_FRC, ASMOP_CMP, ASMOP_LRP, ASMOP_SLT,
+    ASMOP_SGE, ASMOP_DSX, ASMOP_DSY, ASMOP_MOVA, ASMOP_RCP, ASMOP_RSQ,
+    ASMOP_EXP, ASMOP_LOG, ASMOP_POW, ASMOP_SINCOS, ASMOP_DP3, ASMOP_DP4,
+    ASMOP_DP2ADD, ASMOP_NRM, ASMOP_LIT, ASMOP_TEXLD, ASMOP_TEXLDB,
+    ASMOP_TEXLDP, ASMOP_TEXLDL, ASMOP_TEXLDD, ASMOP_TEXKILL, ASMOP_REP,
+    ASMOP_ENDREP, ASMOP_IFNE, ASMOP_ELSE, ASMOP_ENDIF, ASMOP_BREAK,
+    ASMOP_BREAKNE, ASMOP_TOTAL
+} AsmOpcode;
+
+// How an instruction's sources line up with its destination's channels.
+typedef enum AsmLayout
+{
+    ASMLAYOUT_COMPONENTWISE,  // each channel reads the same component.
+    ASMLAYOUT_REPLICATE,  // scalar sources.
+    ASMLAYOUT_RAW,  // sources are read as they are (dp4, texld, etc).
+    ASMLAYOUT_FLOW,  // flow control: no destination, scalar sources.
+} AsmLayout;
+
+typedef struct AsmOpcodeInfo
+{
+    const char *name;
+    AsmLayout layout;
+} AsmOpcodeInfo;
+
+static const AsmOpcodeInfo asm_opcodes[ASMOP_TOTAL] = {
+    { "mov", ASMLAYOUT_COMPONENTWISE }, { "add", ASMLAYOUT_COMPONENTWISE },
+    { "sub", ASMLAYOUT_COMPONENTWISE }, { "mul", ASMLAYOUT_COMPONENTWISE },
+    { "mad", ASMLAYOUT_COMPONENTWISE }, { "min", ASMLAYOUT_COMPONENTWISE },
+    { "max", ASMLAYOUT_COMPONENTWISE }, { "abs", ASMLAYOUT_COMPONENTWISE },
+    { "frc", ASMLAYOUT_COMPONENTWISE }, { "cmp", ASMLAYOUT_COMPONENTWISE },
+    { "lrp", ASMLAYOUT_COMPONENTWISE }, { "slt", ASMLAYOUT_COMPONENTWISE },
+    { "sge", ASMLAYOUT_COMPONENTWISE }, { "dsx", ASMLAYOUT_COMPONENTWISE },
+    { "dsy", ASMLAYOUT_COMPONENTWISE }, { "mova", ASMLAYOUT_COMPONENTWISE },
+    { "rcp", ASMLAYOUT_REPLICATE }, { "rsq", ASMLAYOUT_REPLICATE },
+    { "exp", ASMLAYOUT_REPLICATE }, { "log", ASMLAYOUT_REPLICATE },
+    { "pow", ASMLAYOUT_REPLICATE }, { "sincos", ASMLAYOUT_REPLICATE },
+    { "dp3", ASMLAYOUT_RAW }, { "dp4", ASMLAYOUT_RAW },
+    { "dp2add", ASMLAYOUT_RAW }, { "nrm", ASMLAYOUT_RAW },
+    { "lit", ASMLAYOUT_RAW }, { "texld", ASMLAYOUT_RAW },
+    { "texldb", ASMLAYOUT_RAW }, { "texldp", ASMLAYOUT_RAW },
+    { "texldl", ASMLAYOUT_RAW }, { "texldd", ASMLAYOUT_RAW },
+    { "texkill", ASMLAYOUT_RAW }, { "rep", ASMLAYOUT_FLOW },
+    { "endrep", ASMLAYOUT_FLOW }, { "if_ne", ASMLAYOUT_FLOW },
+    { "else", ASMLAYOUT_FLOW }, { "endif", ASMLAYOUT_FLOW },
+    { "break", ASMLAYOUT_FLOW }, { "break_ne", ASMLAYOUT_FLOW },
+};
+
+typedef struct AsmInstruction
+{
+    AsmOpcode opcode;
+    int saturate;
+    int operand_count;  // destination first; texkill only has that one.
+    AsmOperand operands[5];
+    const char *filename;  // the source it came from, for error messages.
+    unsigned int line;
+} AsmInstruction;
+
+typedef struct AsmLiteral  // one def'd constant register.
+{
+    float value[4];
+    int used;  // how many channels are spoken for.
+} AsmLiteral;
+
+typedef struct AsmPredicate
+{
+    int always;  // non-zero if the code always runs; (value) isn't used.
+    AsmOperand value;  // scalar: 1.0 if the code runs, 0.0 if it doesn't.
+} AsmPredicate;
+
+typedef struct AsmMatrix
+{
+    AsmOperand lines[4];  // rows if (rowmajor), otherwise columns.
+    int rows;
+    int columns;
+    int rowmajor;
+} AsmMatrix;
+
+// A variable's or temp's current value, or an expression's result.
+typedef struct AsmSlot
+{
+    int defined;  // non-zero once something wrote to it.
+    int readonly;  // uniforms.
+    int ismatrix;  // (matrix) is the value, not (value).
+    AsmOperand value;
+    AsmMatrix matrix;
+    int arraylen;  // uniform arrays: (value) is element zero's register...
+    int stride;  // ...each element uses this many registers...
+    const MOJOSHADER_astDataType *elemtype;  // ...and is one of these.
+    const MOJOSHADER_astDataType *structtype;  // structs: (members) has it.
+    struct AsmSlot *members;  // struct members, or local arrays' elements.
+} AsmSlot;
+
+typedef struct AsmBlock
+{
+    int first;  // index of the first statement in AsmFunction::stmts.
+    int count;
+    int succ[2];  // jump (or true) target, and false target; -1 if none.
+    int idom;  // immediate dominator; -1 for the entry block.
+    int ipdom;  // immediate postdominator, in its loop; see asm_build_blocks().
+    int reachable;
+    int loop;  // the innermost loop it's in, or -1.
+    int join;  // [branch] ifs we can really branch on: where the arms meet.
+} AsmBlock;
+
+// Where an edge goes if it leaves the loop we're looking at.
+#define ASM_LEAVES_LOOP 0x7FFFFFFF
+
+typedef struct AsmLoop  // Shader Model 3 only; the others unroll or fail.
+{
+    int header;  // the first block, which every back edge goes to...
+    int last;  // ...and the last block, which has the last back edge.
+    int parent;  // the loop this one is in, or -1.
+    int ipdom;  // where it always goes once it's done, in (parent).
+    int *exits;  // blocks outside the loop it can jump to.
+    int exit_count;
+} AsmLoop;
+
+// Which temps and variables each block might read before it writes them,
+//  for the loops and branches that have to carry values through registers
+//  that don't change. Keys are bit numbers in a set of them: temps first,
+//  then local variables by index.
+typedef struct AsmLiveness
+{
+    int temp_count;
+    int key_count;
+    int words;  // uint32s in a set of keys...
+    int global_words;  // ...and in a set of globals, by negated index.
+    uint32 *livein;  // by block.
+    uint32 *writes;  // by block: keys it might write to...
+    uint32 *global_writes;  // ...and static globals, counting its calls.
+    uint32 *returned;  // what the caller reads: return value, out params.
+    uint32 *all_globals;  // every static global the function might write.
+    int *temp_elements;  // how many components each temp has.
+} AsmLiveness;
+
+// What code generation needs to know about a function, worked out once no
+//  matter how many times we inline it.
+typedef struct AsmFunction
+{
+    int ready;
+    MOJOSHADER_irStatement **stmts;
+    int stmt_count;
+    AsmBlock *blocks;
+    int block_count;
+    AsmLoop *loops;  // outermost first, in order.
+    int loop_count;
+    int branches;  // non-zero if any block has a (join).
+    const MOJOSHADER_astDataType **localtypes;  // reduced, by variable index.
+    int local_count;
+    AsmLiveness *live;  // NULL until it has loops or branches to run.
+} AsmFunction;
+
+typedef struct AsmFrame  // one inlined call.
+{
+    int func;  // index into ctx->ir and ctx->ir_funcs.
+    AsmSlot *temps;  // by IR temp index, less the function's first_temp.
+    AsmSlot *locals;  // by variable index.
+} AsmFrame;
+
+typedef struct AsmGlobal
+{
+    const MOJOSHADER_astVariableDeclaration *decl;  // NULL for struct members.
+    const MOJOSHADER_astDataType *datatype;  // reduced.
+    int structidx;  // for a struct and its members, the struct's index.
+    int isstatic;
+    int ready;  // non-zero once (slot) is set up.
+    AsmSlot slot;
+} AsmGlobal;
+
+typedef struct AsmUniform
+{
+    const char *name;
+    const MOJOSHADER_astDataType *datatype;  // reduced.
+    int rowmajor;
+    MOJOSHADER_symbolRegisterSet regset;
+    int regindex;
+    int regcount;
+} AsmUniform;
+
+typedef struct AsmIO  // an entry point input or output that needs a dcl.
+{
+    MOJOSHADER_usage usage;
+    int index;
+    AsmOperand reg;
+} AsmIO;
+
+#define ASM_MAX_IO 32
+#define ASM_MAX_CONSTS 256
+#define ASM_MAX_SAMPLERS 16
+#define ASM_MAX_INLINE_DEPTH 64
+
+typedef struct AsmContext
+{
+    Context *ctx;
+    int pixel;  // non-zero for pixel shaders, zero for vertex shaders.
+    int major;
+    int minor;
+    int max_temps;
+    int max_consts;
+    int temps_used;  // how many r# registers the allocator handed out.
+    int repeats;  // non-zero if there's a rep, which needs i0 def'd.
+    AsmInstruction *instrs;
+    int instr_count;
+    int instr_alloc;
+    int vreg_count;
+    AsmLiteral *literals;
+    int literal_count;
+    int literal_alloc;
+    AsmUniform *uniforms;
+    int uniform_count;
+    int uniform_alloc;
+    uint8 constused[ASM_MAX_CONSTS];
+    uint8 samplerused[ASM_MAX_SAMPLERS];
+    TextureType samplertypes[ASM_MAX_SAMPLERS];
+    AsmIO inputs[ASM_MAX_IO];
+    int input_count;
+    AsmIO outputs[ASM_MAX_IO];
+    int output_count;
+    AsmGlobal *globals;  // by negated variable index.
+    int global_count;
+    const MOJOSHADER_astDataType **intrinsics;  // by negated function index.
+    const char **intrinsic_names;
+    int intrinsic_count;
+    AsmFunction *funcs;  // by function index.
+    int depth;  // how many calls deep the inlining is...
+    int inlining[ASM_MAX_INLINE_DEPTH + 1];  // ...and which functions, outermost first.
+} AsmContext;
+
+
+static int grow_asm_array(AsmContext *actx, void **_array, int *alloc,
+                          const int needed, const size_t len)
+{
+    if (needed <= *alloc)
+        return 1;
+
+    int newalloc = (*alloc == 0) ? 16 : *alloc;
+    while (newalloc < needed)
+        newalloc *= 2;
+
+    char *array = (char *) Malloc(actx->ctx, newalloc * len);
+    if (array == NULL)
+        return 0;
+
+    if (*_array != NULL)
+    {
+        memcpy(array, *_array, *alloc * len);
+        Free(actx->ctx, *_array);
+    } // if
+
+    memset(array + (*alloc * len), '\0', (newalloc - *alloc) * len);
+    *_array = array;
+    *alloc = newalloc;
+    return 1;
+} // grow_asm_array
+
+// These live in the arena, so they go away with the rest of the compile.
+static void *new_asm_array(AsmContext *actx, const int count, const size_t len)
+{
+    const size_t total = (count > 0) ? (count * len) : 1;
+    void *retval = ArenaMalloc(actx->ctx, total);
+    if (retval != NULL)
+        memset(retval, '\0', total);
+    return retval;
+} // new_asm_array
+
+
+static AsmOperand asm_register(const RegisterType regtype, const int regnum,
+                               const int elements)
+{
+    AsmOperand retval;
+    int i;
+    memset(&retval, '\0', sizeof (retval));
+    retval.regtype = regtype;
+    retval.regnum = regnum;
+    retval.elements = elements;
+    for (i = 0; i < 4; i++)
+        retval.swizzle[i] = i;
+    return retval;
+} // asm_register
+
+static inline AsmOperand new_asm_vreg(AsmContext *actx, const int elements)
+{
+    return asm_register(REG_TYPE_TEMP, actx->vreg_count++, elements);
+} // new_asm_vreg
+
+// Component (i) of (op), as a scalar. Scalars broadcast, so any (i) works.
+static AsmOperand asm_component(const AsmOperand *op, const int i)
+{
+    AsmOperand retval = *op;
+    retval.swizzle[0] = op->swizzle[(op->elements == 1) ? 0 : i];
+    retval.elements = 1;
+    return retval;
+} // asm_component
+
+// Picks (count) of (op)'s components, like a swizzle in the source code.
+static AsmOperand asm_swizzle(const AsmOperand *op, const int *comps,
+                              const int count)
+{
+    AsmOperand retval = *op;
+    int i;
+    for (i = 0; i < count; i++)
+        retval.swizzle[i] = op->swizzle[(op->elements == 1) ? 0 : comps[i]];
+    retval.elements = count;
+    return retval;
+} // asm_swizzle
+
+static AsmOperand asm_swizzle_str(const AsmOperand *op, const char *str)
+{
+    int comps[4];
+    int i;
+    for (i = 0; str[i]; i++)
+        comps[i] = (str[i] == 'w') ? 3 : (str[i] - 'x');
+    return asm_swizzle(op, comps, i);
+} // asm_swizzle_str
+
+static AsmOperand asm_negate(const AsmOperand *op)
+{
+    AsmOperand retval = *op;
+    retval.negate = !retval.negate;
+    return retval;
+} // asm_negate
+
+// Makes (op) have (count) components: scalars broadcast, vectors truncate,
+//  and if a vector has to grow, its last component repeats.
+static AsmOperand asm_resize(const AsmOperand *op, const int count)
+{
+    AsmOperand retval = *op;
+    int i;
+    for (i = op->elements; i < count; i++)
+        retval.swizzle[i] = op->swizzle[op->elements - 1];
+    retval.elements = count;
+    return retval;
+} // asm_resize
+
+static inline int asm_same_register(const AsmOperand *a, const AsmOperand *b)
+{
+    return ( (a->regtype == b->regtype) && (a->regnum == b->regnum) &&
+             (a->relative == b->relative) );
+} // asm_same_register
+
+
+static void emit_asm(AsmContext *actx, const AsmOpcode opcode,
+                     const int saturate, const AsmOperand *dst,
+                     const AsmOperand *src0, const AsmOperand *src1,
+                     const AsmOperand *src2, const AsmOperand *src3)
+{
+    const AsmOperand *ops[5] = { dst, src0, src1, src2, src3 };
+    AsmInstruction *instr;
+    int i;
+
+    if (!grow_asm_array(actx, (void **) &actx->instrs, &actx->instr_alloc,
+                        actx->instr_count + 1, sizeof (AsmInstruction)))
+        return;
+
+    instr = &actx->instrs[actx->instr_count++];
+    memset(instr, '\0', sizeof (*instr));
+    instr->opcode = opcode;
+    instr->saturate = saturate;
+    instr->filename = actx->ctx->sourcefile;
+    instr->line = actx->ctx->sourceline;
+    for (i = 0; (i < 5) && (ops[i] != NULL); i++)
+        instr->operands[instr->operand_count++] = *ops[i];
+} // emit_asm
+
+// Runs (opcode) into a new register with (elements) components.
+static AsmOperand asm_op(AsmContext *actx, const AsmOpcode opcode,
+                         const int elements, const AsmOperand *a,
+                         const AsmOperand *b, const AsmOperand *c)
+{
+    const AsmOperand retval = new_asm_vreg(actx, elements);
+    emit_asm(actx, opcode, 0, &retval, a, b, c, NULL);
+    return retval;
+} // asm_op
+
+static inline AsmOperand asm_mov(AsmContext *actx, const AsmOperand *src)
+{
+    return asm_op(actx, ASMOP_MOV, src->elements, src, NULL, NULL);
+} // asm_mov
+
+// Scalar-only opcodes (rcp, rsq, etc) run once per component.
+static AsmOperand asm_scalar_op(AsmContext *actx, const AsmOpcode opcode,
+                                const AsmOperand *a, const AsmOperand *b)
+{
+    const int elements = a->elements;
+    AsmOperand retval = new_asm_vreg(actx, elements);
+    int i;
+
+    for (i = 0; i < elements; i++)
+    {
+        const AsmOperand dst = asm_component(&retval, i);
+        const AsmOperand x = asm_component(a, i);
+        const AsmOperand y = (b != NULL) ? asm_component(b, i) : x;
+        emit_asm(actx, opcode, 0, &dst, &x, (b != NULL) ? &y : NULL, NULL, NULL);
+    } // for
+
+    return retval;
+} // asm_scalar_op
+
+// Flow control, which only Shader Model 3 has. (a) and (b) are scalars.
+static void asm_flow(AsmContext *actx, const AsmOpcode opcode,
+                     const AsmOperand *a, const AsmOperand *b)
+{
+    const AsmOperand none = asm_register(ASMREG_NONE, 0, 0);
+    emit_asm(actx, opcode, 0, &none, a, b, NULL, NULL);
+} // asm_flow
+
+
+// Constants used by the code are packed into as few def'd registers as we
+//  can, reusing channels that already hold the same value.
+static int pack_asm_literal(AsmLiteral *lit, const float *values,
+                            const int count, int *chans, const int append)
+{
+    int i, j;
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < lit->used; j++)
+        {
+            if (memcmp(&lit->value[j], &values[i], sizeof (float)) == 0)
+                break;
+        } // for
+
+        if (j == lit->used)
+        {
+            if ((!append) || (lit->used == 4))
+                return 0;
+            lit->value[lit->used++] = values[i];
+        } // if
+
+        chans[i] = j;
+    } // for
+
+    return 1;
+} // pack_asm_literal
+
+static AsmOperand asm_literal(AsmContext *actx, const float *values,
+                              const int count)
+{
+    AsmOperand retval = asm_register(ASMREG_LITERAL, 0, count);
+    int chans[4] = { 0, 1, 2, 3 };
+    int pass, i;
+
+    // first see if they're all there already, then see where they'd fit.
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (i = 0; i < actx->literal_count; i++)
+        {
+            AsmLiteral lit = actx->literals[i];
+            if (pack_asm_literal(&lit, values, count, chans, pass))
+            {
+                actx->literals[i] = lit;
+                retval.regnum = i;
+                memcpy(retval.swizzle, chans, sizeof (int) * count);
+                return retval;
+            } // if
+        } // for
+    } // for
+
+    if (grow_asm_array(actx, (void **) &actx->literals, &actx->literal_alloc,
+                       actx->literal_count + 1, sizeof (AsmLiteral)))
+    {
+        pack_asm_literal(&actx->literals[actx->literal_count], values,
+                         count, chans, 1);
+        retval.regnum = actx->literal_count++;
+        memcpy(retval.swizzle, chans, sizeof (int) * count);
+    } // if
+
+    return retval;
+} // asm_literal
+
+static inline AsmOperand asm_literal1(AsmContext *actx, const float value)
+{
+    return asm_literal(actx, &value, 1);
+} // asm_literal1
+
+// A whole register of constants, in this order (sincos wants this).
+static AsmOperand asm_literal4(AsmContext *actx, const float *values)
+{
+    int i;
+    for (i = 0; i < actx->literal_count; i++)
+    {
+        const AsmLiteral *lit = &actx->literals[i];
+        if ((lit->used == 4) && (memcmp(lit->value, values, sizeof (lit->value)) == 0))
+            return asm_register(ASMREG_LITERAL, i, 4);
+    } // for
+
+    if (grow_asm_array(actx, (void **) &actx->literals, &actx->literal_alloc,
+                       actx->literal_count + 1, sizeof (AsmLiteral)))
+    {
+        AsmLiteral *lit = &actx->literals[actx->literal_count];
+        memcpy(lit->value, values, sizeof (lit->value));
+        lit->used = 4;
+        return asm_register(ASMREG_LITERAL, actx->literal_count++, 4);
+    } // if
+
+    return asm_register(ASMREG_LITERAL, 0, 4);
+} // asm_literal4
+
+
+// Math that doesn't map straight to one instruction. Booleans are 0.0 or 1.0.
+
+static inline AsmOperand asm_zero(AsmContext *actx)
+{
+    return asm_literal1(actx, 0.0f);
+} // asm_zero
+
+static inline AsmOperand asm_one(AsmContext *actx)
+{
+    return asm_literal1(actx, 1.0f);
+} // asm_one
+
+// (x >= 0) ? a : b, for each component.
+static AsmOperand asm_select_ge(AsmContext *actx, const AsmOperand *x,
+                                const AsmOperand *a, const AsmOperand *b)
+{
+    const int elements = x->elements;
+    if (actx->pixel)
+        return asm_op(actx, ASMOP_CMP, elements, x, a, b);
+
+    // no cmp in vertex shaders; make a 0 or 1 and blend with that.
+    const AsmOperand zero = asm_zero(actx);
+    const AsmOperand ge = asm_op(actx, ASMOP_SGE, elements, x, &zero, NULL);
+    return asm_op(actx, ASMOP_LRP, elements, &ge, a, b);
+} // asm_select_ge
+
+// (l cond r) ? 1 : 0, for each component.
+static AsmOperand asm_compare(AsmContext *actx,
+                              const MOJOSHADER_irConditionType cond,
+                              const AsmOperand *l, const AsmOperand *r)
+{
+    const int elements = (l->elements > r->elements) ? l->elements : r->elements;
+    const AsmOperand zero = asm_zero(actx);
+    const AsmOperand one = asm_one(actx);
+    AsmOperand a, b;
+
+    if (!actx->pixel)
+    {
+        switch (cond)
+        {
+            case MOJOSHADER_IR_COND_LT:
+                return asm_op(actx, ASMOP_SLT, elements, l, r, NULL);
+            case MOJOSHADER_IR_COND_GEQ:
+                return asm_op(actx, ASMOP_SGE, elements, l, r, NULL);
+            case MOJOSHADER_IR_COND_GT:
+                return asm_op(actx, ASMOP_SLT, elements, r, l, NULL);
+            case MOJOSHADER_IR_COND_LEQ:
+                return asm_op(actx, ASMOP_SGE, elements, r, l, NULL);
+            case MOJOSHADER_IR_COND_EQL:
+                a = asm_op(actx, ASMOP_SGE, elements, l, r, NULL);
+                b = asm_op(actx, ASMOP_SGE, elements, r, l, NULL);
+                return asm_op(actx, ASMOP_MUL, elements, &a, &b, NULL);
+            case MOJOSHADER_IR_COND_NEQ:
+                a = asm_op(actx, ASMOP_SLT, elements, l, r, NULL);
+                b = asm_op(actx, ASMOP_SLT, elements, r, l, NULL);
+                return asm_op(actx, ASMOP_ADD, elements, &a, &b, NULL);
+            default: break;
+        } // switch
+
+        assert(0 && "unexpected condition");
+        return zero;
+    } // if
+
+    // pixel shaders: cmp picks by the sign of the difference.
+    switch (cond)
+    {
+        case MOJOSHADER_IR_COND_GEQ:
+        case MOJOSHADER_IR_COND_LT:
+            a = asm_op(actx, ASMOP_SUB, elements, l, r, NULL);
+            break;
+        case MOJOSHADER_IR_COND_LEQ:
+        case MOJOSHADER_IR_COND_GT:
+            a = asm_op(actx, ASMOP_SUB, elements, r, l, NULL);
+            break;
+        case MOJOSHADER_IR_COND_EQL:
+        case MOJOSHADER_IR_COND_NEQ:
+            // -(l-r)^2 is only >= 0 if they're equal.
+            b = asm_op(actx, ASMOP_SUB, elements, l, r, NULL);
+            a = asm_op(actx, ASMOP_MUL, elements, &b, &b, NULL);
+            a = asm_negate(&a);
+            break;
+        default:
+            assert(0 && "unexpected condition");
+            return zero;
+    } // switch
+
+    if ((cond == MOJOSHADER_IR_COND_LT) || (cond == MOJOSHADER_IR_COND_GT) ||
+        (cond == MOJOSHADER_IR_COND_NEQ))
+        return asm_select_ge(actx, &a, &zero, &one);
+    return asm_select_ge(actx, &a, &one, &zero);
+} // asm_compare
+
+static inline AsmOperand asm_nonzero(AsmContext *actx, const AsmOperand *x)
+{
+    const AsmOperand zero = asm_zero(actx);
+    return asm_compare(actx, MOJOSHADER_IR_COND_NEQ, x, &zero);
+} // asm_nonzero
+
+// 1-x, which is "not" for booleans.
+static AsmOperand asm_not(AsmContext *actx, const AsmOperand *x)
+{
+    const AsmOperand one = asm_one(actx);
+    const AsmOperand negx = asm_negate(x);
+    return asm_op(actx, ASMOP_ADD, x->elements, &negx, &one, NULL);
+} // asm_not
+
+// Rounds toward zero.
+static AsmOperand asm_trunc(AsmContext *actx, const AsmOperand *x)
+{
+    const int elements = x->elements;
+    const AsmOperand a = asm_op(actx, ASMOP_ABS, elements, x, NULL, NULL);
+    const AsmOperand f = asm_op(actx, ASMOP_FRC, elements, &a, NULL, NULL);
+    const AsmOperand t = asm_op(actx, ASMOP_SUB, elements, &a, &f, NULL);
+    const AsmOperand negt = asm_negate(&t);
+    return asm_select_ge(actx, x, &t, &negt);
+} // asm_trunc
+
+static AsmOperand asm_floor(AsmContext *actx, const AsmOperand *x)
+{
+    const AsmOperand f = asm_op(actx, ASMOP_FRC, x->elements, x, NULL, NULL);
+    return asm_op(actx, ASMOP_SUB, x->elements, x, &f, NULL);
+} // asm_floor
+
+static AsmOperand asm_divide(AsmContext *actx, const AsmOperand *a,
+                             const AsmOperand *b, const int isint)
+{
+    const int elements = (a->elements > b->elements) ? a->elements : b->elements;
+    const AsmOperand r = asm_scalar_op(actx, ASMOP_RCP, b, NULL);
+    AsmOperand retval = asm_op(actx, ASMOP_MUL, elements, a, &r, NULL);
+    if (isint)
+    {
+        // rcp is only close, so 6/3 might be 1.9999999; nudge it away from
+        //  zero before we throw away the fraction.
+        const AsmOperand fudge = asm_literal1(actx, 1.0000152587890625f);
+        retval = asm_op(actx, ASMOP_MUL, elements, &retval, &fudge, NULL);
+        retval = asm_trunc(actx, &retval);
+    } // if
+    return retval;
+} // asm_divide
+
+static AsmOperand asm_dot(AsmContext *actx, const AsmOperand *a,
+                          const AsmOperand *b, const int elements)
+{
+    if (elements == 4)
+        return asm_op(actx, ASMOP_DP4, 1, a, b, NULL);
+    else if (elements == 3)
+        return asm_op(actx, ASMOP_DP3, 1, a, b, NULL);
+    else if (elements == 1)
+        return asm_op(actx, ASMOP_MUL, 1, a, b, NULL);
+    else if (actx->pixel)
+    {
+        const AsmOperand zero = asm_zero(actx);
+        return asm_op(actx, ASMOP_DP2ADD, 1, a, b, &zero);
+    } // else if
+
+    const AsmOperand t = asm_op(actx, ASMOP_MUL, 2, a, b, NULL);
+    const AsmOperand x = asm_component(&t, 0);
+    const AsmOperand y = asm_component(&t, 1);
+    return asm_op(actx, ASMOP_ADD, 1, &x, &y, NULL);
+} // asm_dot
+
+static AsmOperand asm_fmod(AsmContext *actx, const AsmOperand *a,
+                           const AsmOperand *b, const int elements)
+{
+    // a - (b * trunc(a / b)), which keeps a's sign.
+    const AsmOperand q = asm_divide(actx, a, b, 0);
+    const AsmOperand tq = asm_trunc(actx, &q);
+    const AsmOperand negb = asm_negate(b);
+    return asm_op(actx, ASMOP_MAD, elements, &negb, &tq, a);
+} // asm_fmod
+
+
+// Uniforms, globals and the slots that hold variables...
+
+static const MOJOSHADER_astDataType *asm_reduce(Context *ctx, const MOJOSHADER_astDataType *dt)
+{
+    static const MOJOSHADER_astDataType none = { MOJOSHADER_AST_DATATYPE_NONE };
+    dt = reduce_datatype(ctx, dt);
+    if (dt == NULL)
+        return &none;
+    else if ((dt->type & MOJOSHADER_AST_DATATYPE_CONST) == 0)
+        return dt;
+
+    // const types are their own datatypes; reduce to the non-const one.
+    MOJOSHADER_astDataType nonconst = *dt;
+    nonconst.type &= ~MOJOSHADER_AST_DATATYPE_CONST;
+    dt = intern_datatype(ctx, &nonconst);
+    return (dt != NULL) ? dt : &none;
+} // asm_reduce
+
+// The struct that (dt) is, or is an array of, or NULL.
+static const MOJOSHADER_astDataType *asm_struct_type(Context *ctx,
+                                        const MOJOSHADER_astDataType *dt)
+{
+    dt = asm_reduce(ctx, dt);
+    if (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+        dt = asm_reduce(ctx, dt->array.base);
+    return (dt->type == MOJOSHADER_AST_DATATYPE_STRUCT) ? dt : NULL;
+} // asm_struct_type
+
+// The type of member (i) of struct (dt). An array of structs keeps each
+//  member in an array of its own (see push_variable()), so for those, it's
+//  an array of the member's type.
+static const MOJOSHADER_astDataType *asm_member_type(Context *ctx,
+                                        const MOJOSHADER_astDataType *dt,
+                                        const int i)
+{
+    const MOJOSHADER_astDataType *s = asm_struct_type(ctx, dt);
+    const MOJOSHADER_astDataType *mdt = asm_reduce(ctx, s->structure.members[i].datatype);
+    MOJOSHADER_astDataType array;
+
+    dt = asm_reduce(ctx, dt);
+    if (dt->type != MOJOSHADER_AST_DATATYPE_ARRAY)
+        return mdt;
+
+    memset(&array, '\0', sizeof (array));
+    array.type = MOJOSHADER_AST_DATATYPE_ARRAY;
+    array.array.base = mdt;
+    array.array.elements = dt->array.elements;
+    dt = intern_datatype(ctx, &array);
+    return (dt != NULL) ? dt : mdt;
+} // asm_member_type
+
+static int asm_register_name(const char *str, char *regchar)
+{
+    int retval = 0;
+    if ((str == NULL) || (str[1] < '0') || (str[1] > '9'))
+        return -1;
+    else if ((*str >= 'A') && (*str <= 'Z'))
+        *regchar = *str - 'A' + 'a';
+    else
+        *regchar = *str;
+    for (str++; (*str >= '0') && (*str <= '9'); str++)
+        retval = (retval * 10) + (*str - '0');
+    return (*str == '\0') ? retval : -1;
+} // asm_register_name
+
+static inline int asm_is_sampler(const MOJOSHADER_astDataType *dt)
+{
+    switch (dt->type)
+    {
+        case MOJOSHADER_AST_DATATYPE_SAMPLER_1D:
+        case MOJOSHADER_AST_DATATYPE_SAMPLER_2D:
+        case MOJOSHADER_AST_DATATYPE_SAMPLER_3D:
+        case MOJOSHADER_AST_DATATYPE_SAMPLER_CUBE:
+            return 1;
+        default:
+            return 0;
+    } // switch
+} // asm_is_sampler
+
+// How many registers one of these needs: one per column for matrices, or
+//  one per row if they're row major.
+static int asm_register_count(Context *ctx, const MOJOSHADER_astDataType *dt,
+                              const int rowmajor)
+{
+    dt = reduce_datatype(ctx, dt);
+    if (dt->type == MOJOSHADER_AST_DATATYPE_MATRIX)
+        return rowmajor ? dt->matrix.rows : dt->matrix.columns;
+    return 1;
+} // asm_register_count
+
+// How many registers a whole uniform takes up, arrays and structs included.
+static int asm_uniform_register_count(Context *ctx,
+                                      const MOJOSHADER_astDataType *dt,
+                                      const int rowmajor)
+{
+    int count = 1;
+    int retval = 0;
+    int i;
+
+    dt = asm_reduce(ctx, dt);
+    if (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+    {
+        count = dt->array.elements;
+        dt = asm_reduce(ctx, dt->array.base);
+    } // if
+
+    if (dt->type != MOJOSHADER_AST_DATATYPE_STRUCT)
+        retval = asm_register_count(ctx, dt, rowmajor);
+    else
+    {
+        for (i = 0; i < dt->structure.member_count; i++)
+            retval += asm_uniform_register_count(ctx, dt->structure.members[i].datatype, rowmajor);
+    } // else
+
+    return count * retval;
+} // asm_uniform_register_count
+
+// Finds (regcount) free registers for a uniform, or the ones it asked for
+//  with register(). Returns the first one, or -1 on failure.
+static int asm_uniform_registers(AsmContext *actx, const char *name,
+                                 const int issampler, const int regcount,
+                                 const char *register_name)
+{
+    Context *ctx = actx->ctx;
+    uint8 *used = issampler ? actx->samplerused : actx->constused;
+    const int maxregs = issampler ? ASM_MAX_SAMPLERS : actx->max_consts;
+    const char wantchar = issampler ? 's' : 'c';
+    char regchar = 0;
+    int regindex = asm_register_name(register_name, &regchar);
+    int i;
+
+    if ((regindex >= 0) && (regchar != wantchar))
+    {
+        failf(ctx, "Uniform '%s' can't go in register '%s'", name, register_name);
+        return -1;
+    } // if
+
+    if (regindex < 0)  // no register(); find room for it.
+    {
+        for (regindex = 0; regindex + regcount <= maxregs; regindex++)
+        {
+            for (i = 0; i < regcount; i++)
+            {
+                if (used[regindex + i])
+                    break;
+            } // for
+            if (i == regcount)
+                break;
+        } // for
+    } // if
+
+    if (regindex + regcount > maxregs)
+    {
+        failf(ctx, "Out of %s registers for uniform '%s'",
+              issampler ? "sampler" : "constant", name);
+        return -1;
+    } // if
+
+    for (i = 0; i < regcount; i++)
+        used[regindex + i] = 1;
+
+    return regindex;
+} // asm_uniform_registers
+
+// Records a uniform for the constant table.
+static int asm_add_uniform(AsmContext *actx, const char *name,
+                           const MOJOSHADER_astDataType *dt, const int rowmajor,
+                           const int issampler, const int regindex,
+                           const int regcount)
+{
+    if (!grow_asm_array(actx, (void **) &actx->uniforms, &actx->uniform_alloc,
+                        actx->uniform_count + 1, sizeof (AsmUniform)))
+        return 0;
+
+    AsmUniform *uniform = &actx->uniforms[actx->uniform_count++];
+    uniform->name = name;
+    uniform->datatype = dt;
+    uniform->rowmajor = rowmajor;
+    uniform->regset = issampler ? MOJOSHADER_SYMREGSET_SAMPLER : MOJOSHADER_SYMREGSET_FLOAT4;
+    uniform->regindex = regindex;
+    uniform->regcount = regcount;
+    return 1;
+} // asm_add_uniform
+
+// Points (slot) at a uniform value (dt) that starts at register (regindex).
+static void asm_uniform_slot(AsmContext *actx, AsmSlot *slot,
+                             const MOJOSHADER_astDataType *dt,
+                             const int rowmajor, const int issampler,
+                             const int regindex)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *elemtype = dt;
+    int arraylen = 0;
+    int i;
+
+    if (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+    {
+        arraylen = dt->array.elements;
+        elemtype = asm_reduce(ctx, dt->array.base);
+    } // if
+
+    const int stride = asm_register_count(ctx, elemtype, rowmajor);
+    memset(slot, '\0', sizeof (*slot));
+    slot->defined = slot->readonly = 1;
+    slot->arraylen = arraylen;
+    slot->stride = stride;
+    slot->elemtype = elemtype;
+    slot->value = asm_register(issampler ? REG_TYPE_SAMPLER : REG_TYPE_CONST,
+                               regindex, datatype_elems(ctx, elemtype));
+    slot->matrix.rowmajor = rowmajor;
+    if ((arraylen == 0) && (elemtype->type == MOJOSHADER_AST_DATATYPE_MATRIX))
+    {
+        slot->ismatrix = 1;
+        slot->matrix.rows = elemtype->matrix.rows;
+        slot->matrix.columns = elemtype->matrix.columns;
+        slot->matrix.rowmajor = rowmajor;
+        for (i = 0; i < stride; i++)
+        {
+            slot->matrix.lines[i] = asm_register(REG_TYPE_CONST, regindex + i,
+                                        rowmajor ? elemtype->matrix.columns :
+                                                   elemtype->matrix.rows);
+        } // for
+    } // if
+} // asm_uniform_slot
+
+// Can the code generator put a uniform value of this type in registers?
+static int asm_uniform_type_ok(Context *ctx, const MOJOSHADER_astDataType *dt)
+{
+    if (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+        dt = asm_reduce(ctx, dt->array.base);
+
+    switch (dt->type)
+    {
+        case MOJOSHADER_AST_DATATYPE_STRUCT:
+        case MOJOSHADER_AST_DATATYPE_ARRAY:
+        case MOJOSHADER_AST_DATATYPE_STRING:
+        case MOJOSHADER_AST_DATATYPE_BUFFER:
+            return 0;
+        default:
+            return 1;
+    } // switch
+} // asm_uniform_type_ok
+
+// Points (slot) at a uniform's register(s), picking them if need be.
+static int asm_uniform(AsmContext *actx, AsmSlot *slot, const char *name,
+                       const MOJOSHADER_astDataType *dt, const int attributes,
+                       const char *register_name)
+{
+    Context *ctx = actx->ctx;
+    const int rowmajor = (attributes & MOJOSHADER_AST_VARATTR_ROWMAJOR) != 0;
+    const MOJOSHADER_astDataType *elemtype = dt;
+
+    if (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+        elemtype = asm_reduce(ctx, dt->array.base);
+
+    if (!asm_uniform_type_ok(ctx, dt))
+    {
+        failf(ctx, "Uniform '%s' has a type that can't go in shader registers", name);
+        return 0;
+    } // if
+
+    const int issampler = asm_is_sampler(elemtype);
+    const int regcount = asm_uniform_register_count(ctx, dt, rowmajor);
+    const int regindex = asm_uniform_registers(actx, name, issampler, regcount,
+                                               register_name);
+    if (regindex < 0)
+        return 0;
+    else if (!asm_add_uniform(actx, name, dt, rowmajor, issampler, regindex, regcount))
+        return 0;
+
+    asm_uniform_slot(actx, slot, dt, rowmajor, issampler, regindex);
+    return 1;
+} // asm_uniform
+
+// Can the code generator put a uniform struct (or array of them) in
+//  registers? Samplers have to be uniforms of their own, and each member
+//  of an array of structs is an array already, so arrays in those become
+//  arrays of arrays, which can't hold structs.
+static int asm_uniform_struct_ok(Context *ctx, const MOJOSHADER_astDataType *dt,
+                                 int isarray)
+{
+    const MOJOSHADER_astDataTypeStruct *s = &asm_struct_type(ctx, dt)->structure;
+    int i;
+
+    isarray = (isarray) || (asm_reduce(ctx, dt)->type == MOJOSHADER_AST_DATATYPE_ARRAY);
+    for (i = 0; i < s->member_count; i++)
+    {
+        const MOJOSHADER_astDataType *mdt = asm_reduce(ctx, s->members[i].datatype);
+        const MOJOSHADER_astDataType *elemtype = mdt;
+        if (mdt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+            elemtype = asm_reduce(ctx, mdt->array.base);
+
+        if ((isarray) && (elemtype != mdt) && (elemtype->type == MOJOSHADER_AST_DATATYPE_STRUCT))
+            return 0;
+        else if (asm_struct_type(ctx, mdt) != NULL)
+        {
+            if (!asm_uniform_struct_ok(ctx, mdt, isarray))
+                return 0;
+        } // else if
+        else if ((!asm_uniform_type_ok(ctx, mdt)) || (asm_is_sampler(elemtype)))
+            return 0;
+    } // for
+
+    return 1;
+} // asm_uniform_struct_ok
+
+// Points the slots of a uniform struct's members (see build_asm_globals())
+//  at registers after each other, starting at (regindex). An array of
+//  structs has each element's members after each other, so each member's
+//  array skips over the whole struct, (stride) registers, between elements.
+static void asm_uniform_members(AsmContext *actx, const int idx,
+                                const MOJOSHADER_astDataType *dt,
+                                const int rowmajor, int regindex, int stride)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *sdt = asm_struct_type(ctx, dt);
+    const MOJOSHADER_astDataTypeStruct *s = &sdt->structure;
+    int i;
+
+    if ((stride == 0) && (asm_reduce(ctx, dt)->type == MOJOSHADER_AST_DATATYPE_ARRAY))
+        stride = asm_uniform_register_count(ctx, sdt, rowmajor);
+
+    for (i = 0; i < s->member_count; i++)
+    {
+        const int midx = idx - datatype_member_offset(ctx, dt, i);
+        if (midx <= 0)
+            break;
+
+        AsmGlobal *member = &actx->globals[midx];
+        member->ready = 1;
+        if (asm_struct_type(ctx, member->datatype) != NULL)
+            asm_uniform_members(actx, midx, member->datatype, rowmajor, regindex, stride);
+        else
+        {
+            asm_uniform_slot(actx, &member->slot, member->datatype, rowmajor, 0, regindex);
+            if (stride != 0)
+                member->slot.stride = stride;
+        } // else
+        regindex += asm_uniform_register_count(ctx, s->members[i].datatype, rowmajor);
+    } // for
+} // asm_uniform_members
+
+// A uniform struct is one constant table entry, but each member is its own
+//  global variable (see build_asm_globals()), so this sets up all of their
+//  slots at once.
+static int asm_uniform_struct(AsmContext *actx, const int structidx)
+{
+    Context *ctx = actx->ctx;
+    const AsmGlobal *global = &actx->globals[structidx];
+    const MOJOSHADER_astVariableDeclaration *decl = global->decl;
+    const MOJOSHADER_astDataType *dt = global->datatype;
+    const MOJOSHADER_astVariableLowLevel *ll = decl->lowlevel;
+    const char *name = decl->details->identifier;
+    const int rowmajor = (decl->attributes & MOJOSHADER_AST_VARATTR_ROWMAJOR) != 0;
+
+    if (!asm_uniform_struct_ok(ctx, dt, 0))
+    {
+        failf(ctx, "Uniform '%s' can't go in constant registers: samplers in structs, and arrays of structs in arrays of structs, need to be uniforms of their own", name);
+        return 0;
+    } // if
+
+    const int regcount = asm_uniform_register_count(ctx, dt, rowmajor);
+    const int regindex = asm_uniform_registers(actx, name, 0, regcount,
+                                               (ll != NULL) ? ll->register_name : NULL);
+    if (regindex < 0)
+        return 0;
+    else if (!asm_add_uniform(actx, name, dt, rowmajor, 0, regindex, regcount))
+        return 0;
+
+    actx->globals[structidx].ready = 1;
+    asm_uniform_members(actx, structidx, dt, rowmajor, regindex, 0);
+    return 1;
+} // asm_uniform_struct
+
+// Uniforms that ask for a specific register get it, even if we see one
+//  that doesn't care first.
+static void asm_reserve_registers(AsmContext *actx)
+{
+    int i, j;
+    for (i = 1; i < actx->global_count; i++)
+    {
+        const AsmGlobal *global = &actx->globals[i];
+        const MOJOSHADER_astVariableDeclaration *decl = global->decl;
+        if ((decl == NULL) || (global->isstatic) || (decl->lowlevel == NULL))
+            continue;
+
+        char regchar = 0;
+        const int regindex = asm_register_name(decl->lowlevel->register_name, &regchar);
+        if (regindex < 0)
+            continue;
+
+        const int rowmajor = (decl->attributes & MOJOSHADER_AST_VARATTR_ROWMAJOR) != 0;
+        const int count = asm_uniform_register_count(actx->ctx, global->datatype, rowmajor);
+
+        uint8 *used = (regchar == 's') ? actx->samplerused : actx->constused;
+        const int maxregs = (regchar == 's') ? ASM_MAX_SAMPLERS : ASM_MAX_CONSTS;
+        for (j = regindex; (j < regindex + count) && (j < maxregs); j++)
+            used[j] = 1;
+    } // for
+} // asm_reserve_registers
+
+// Struct members are globals of their own, counting up from the struct's
+//  index (so down in (actx->globals); see datatype_member_offset()).
+static void asm_global_members(AsmContext *actx, const int idx,
+                               const MOJOSHADER_astDataType *dt,
+                               const int isstatic)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *sdt = asm_struct_type(ctx, dt);
+    int i;
+
+    for (i = 0; (sdt != NULL) && (i < sdt->structure.member_count); i++)
+    {
+        const int midx = idx - datatype_member_offset(ctx, dt, i);
+        if (midx <= 0)
+            break;
+
+        AsmGlobal *member = &actx->globals[midx];
+        member->datatype = asm_member_type(ctx, dt, i);
+        member->isstatic = isstatic;
+        member->structidx = actx->globals[idx].structidx;
+        asm_global_members(actx, midx, member->datatype, isstatic);
+    } // for
+} // asm_global_members
+
+static int build_asm_globals(AsmContext *actx)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astCompilationUnit *ast;
+    const MOJOSHADER_astVariableDeclaration *decl;
+
+    actx->global_count = -ctx->global_var_index + 1;
+    actx->globals = (AsmGlobal *) new_asm_array(actx, actx->global_count, sizeof (AsmGlobal));
+    if (actx->globals == NULL)
+        return 0;
+
+    for (ast = &ctx->ast->compunit; ast != NULL; ast = ast->next)
+    {
+        if (ast->ast.type != MOJOSHADER_AST_COMPUNIT_VARIABLE)
+            continue;
+
+        decl = ((const MOJOSHADER_astCompilationUnitVariable *) ast)->declaration;
+        for (; decl != NULL; decl = decl->next)
+        {
+            const int idx = -decl->index;
+            if ((idx <= 0) || (idx >= actx->global_count))
+                continue;
+
+            AsmGlobal *global = &actx->globals[idx];
+            global->decl = decl;
+            global->datatype = asm_reduce(ctx, decl->datatype);
+            global->isstatic = (decl->attributes & MOJOSHADER_AST_VARATTR_STATIC) != 0;
+
+            if (asm_struct_type(ctx, global->datatype) != NULL)
+            {
+                global->structidx = idx;
+                asm_global_members(actx, idx, global->datatype, global->isstatic);
+            } // if
+        } // for
+    } // for
+
+    asm_reserve_registers(actx);
+    return 1;
+} // build_asm_globals
+
+static AsmSlot *asm_global_slot(AsmContext *actx, const int index)
+{
+    Context *ctx = actx->ctx;
+    if ((index <= 0) || (index >= actx->global_count))
+    {
+        fail(ctx, "Internal error: unknown global variable");
+        return NULL;
+    } // if
+
+    AsmGlobal *global = &actx->globals[index];
+    if (!global->ready)
+    {
+        global->ready = 1;
+        if (global->isstatic)
+            ;  // starts out undefined; function 0 might initialize it.
+        else if (global->structidx != 0)
+            asm_uniform_struct(actx, global->structidx);
+        else
+        {
+            const MOJOSHADER_astVariableLowLevel *ll = global->decl->lowlevel;
+            asm_uniform(actx, &global->slot, global->decl->details->identifier,
+                        global->datatype, global->decl->attributes,
+                        (ll != NULL) ? ll->register_name : NULL);
+        } // else
+    } // if
+
+    return &global->slot;
+} // asm_global_slot
+
+static int asm_datatype_elems(Context *ctx, const MOJOSHADER_astDataType *dt)
+{
+    const int retval = datatype_elems(ctx, dt);
+    return (retval < 1) ? 1 : retval;
+} // asm_datatype_elems
+
+// A value made of zeros, for reading something nothing wrote to yet.
+static void asm_zero_slot(AsmContext *actx, const MOJOSHADER_astDataType *dt,
+                          const int elements, AsmSlot *slot)
+{
+    static const float zeros[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    Context *ctx = actx->ctx;
+    int i;
+
+    memset(slot, '\0', sizeof (*slot));
+    slot->defined = 1;
+    dt = (dt != NULL) ? asm_reduce(ctx, dt) : NULL;
+
+    if ((dt != NULL) && (dt->type == MOJOSHADER_AST_DATATYPE_MATRIX))
+    {
+        slot->ismatrix = 1;
+        slot->matrix.rows = dt->matrix.rows;
+        slot->matrix.columns = dt->matrix.columns;
+        slot->matrix.rowmajor = 1;
+        for (i = 0; i < dt->matrix.rows; i++)
+            slot->matrix.lines[i] = asm_literal(actx, zeros, dt->matrix.columns);
+    } // if
+    else if ((dt != NULL) && (dt->type == MOJOSHADER_AST_DATATYPE_STRUCT))
+    {
+        const MOJOSHADER_astDataTypeStruct *s = &dt->structure;
+        slot->structtype = dt;
+        slot->members = (AsmSlot *) new_asm_array(actx, s->member_count, sizeof (AsmSlot));
+        if (slot->members == NULL)
+            return;
+        for (i = 0; i < s->member_count; i++)
+            asm_zero_slot(actx, s->members[i].datatype, 1, &slot->members[i]);
+    } // else if
+    else if ((dt != NULL) && (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY))
+    {
+        slot->arraylen = dt->array.elements;
+        slot->elemtype = asm_reduce(ctx, dt->array.base);
+        slot->members = (AsmSlot *) new_asm_array(actx, slot->arraylen, sizeof (AsmSlot));
+        if (slot->members == NULL)
+            return;
+        for (i = 0; i < slot->arraylen; i++)
+            asm_zero_slot(actx, slot->elemtype, 1, &slot->members[i]);
+    } // else if
+    else
+    {
+        const int count = (dt != NULL) ? asm_datatype_elems(ctx, dt) : elements;
+        slot->value = asm_literal(actx, zeros, (count > 4) ? 4 : count);
+    } // else
+} // asm_zero_slot
+
+// Breaks a vector or matrix into scalars, in the order the source code lists
+//  them (a matrix goes row by row). Returns how many there were.
+static int asm_flatten(const AsmSlot *value, AsmOperand *comps, const int max)
+{
+    const AsmMatrix *m = &value->matrix;
+    int retval = 0;
+    int row, col;
+
+    if (!value->ismatrix)
+    {
+        for (col = 0; (col < value->value.elements) && (retval < max); col++)
+            comps[retval++] = asm_component(&value->value, col);
+        return retval;
+    } // if
+
+    // row major lines can come up short: see asm_flat_value().
+    for (row = 0; row < m->rows; row++)
+    {
+        const int columns = m->rowmajor ? m->lines[row].elements : m->columns;
+        for (col = 0; (col < columns) && (retval < max); col++)
+        {
+            if (m->rowmajor)
+                comps[retval++] = asm_component(&m->lines[row], col);
+            else
+                comps[retval++] = asm_component(&m->lines[col], row);
+        } // for
+    } // for
+
+    return retval;
+} // asm_flatten
+
+// Puts (count) scalars together in one register, one mov per run of them
+//  that come from the same place.
+static AsmOperand asm_gather(AsmContext *actx, const AsmOperand *comps,
+                             const int count)
+{
+    AsmOperand retval;
+    int i, j;
+
+    if (count == 1)
+        return comps[0];
+
+    // already lined up in one register?
+    for (i = 1; i < count; i++)
+    {
+        if ( (!asm_same_register(&comps[i], &comps[0])) ||
+             (comps[i].negate != comps[0].negate) )
+            break;
+    } // for
+
+    if (i == count)
+    {
+        retval = comps[0];
+        retval.elements = count;
+        for (i = 0; i < count; i++)
+            retval.swizzle[i] = comps[i].swizzle[0];
+        return retval;
+    } // if
+
+    retval = new_asm_vreg(actx, count);
+    for (i = 0; i < count; i = j)
+    {
+        AsmOperand dst = retval;
+        AsmOperand src = comps[i];
+        dst.elements = 0;
+        for (j = i; j < count; j++)
+        {
+            if ( (!asm_same_register(&comps[j], &comps[i])) ||
+                 (comps[j].negate != comps[i].negate) )
+                break;
+            dst.swizzle[dst.elements] = j;
+            src.swizzle[dst.elements] = comps[j].swizzle[0];
+            dst.elements++;
+        } // for
+        src.elements = dst.elements;
+        emit_asm(actx, ASMOP_MOV, 0, &dst, &src, NULL, NULL, NULL);
+    } // for
+
+    return retval;
+} // asm_gather
+
+// Values with more than four components (float3x3(...), etc) that don't
+//  know what shape they are yet: four to a line, as a row major matrix.
+//  asm_convert_value() sorts them out when they land somewhere with a type.
+static void asm_flat_value(AsmContext *actx, const AsmOperand *comps,
+                           const int count, AsmSlot *out)
+{
+    int i;
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+    out->ismatrix = 1;
+    out->matrix.rowmajor = 1;
+    out->matrix.columns = 4;
+    for (i = 0; (i < count) && (i < 16); i += 4)
+    {
+        const int len = ((count - i) < 4) ? (count - i) : 4;
+        out->matrix.lines[out->matrix.rows++] = asm_gather(actx, &comps[i], len);
+    } // for
+} // asm_flat_value
+
+// Lays (value) out as a (rows)x(columns) matrix, one line per row if
+//  (rowmajor), one per column otherwise. Vectors are read in row order, so
+//  float2x2(1,2,3,4) ends up here as a float4 first.
+static int asm_reshape_matrix(AsmContext *actx, const AsmSlot *value,
+                              const int rows, const int columns,
+                              const int rowmajor, AsmSlot *out)
+{
+    AsmOperand flat[16];
+    AsmOperand line[4];
+    int i, j;
+
+    if ( (value->ismatrix) && (value->matrix.rows == rows) &&
+         (value->matrix.columns == columns) &&
+         (value->matrix.rowmajor == rowmajor) )
+    {
+        *out = *value;
+        out->readonly = 0;
+        return 1;
+    } // if
+
+    const int count = asm_flatten(value, flat, STATICARRAYLEN(flat));
+    if (count != rows * columns)
+    {
+        fail(actx->ctx, "Internal error: matrix size mismatch");
+        return 0;
+    } // if
+
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+    out->ismatrix = 1;
+    out->matrix.rows = rows;
+    out->matrix.columns = columns;
+    out->matrix.rowmajor = rowmajor;
+
+    const int lines = rowmajor ? rows : columns;
+    const int linelen = rowmajor ? columns : rows;
+    for (i = 0; i < lines; i++)
+    {
+        for (j = 0; j < linelen; j++)
+            line[j] = rowmajor ? flat[(i * columns) + j] : flat[(j * columns) + i];
+        out->matrix.lines[i] = asm_gather(actx, line, linelen);
+    } // for
+
+    return 1;
+} // asm_reshape_matrix
+
+// Makes (value) fit something of type (dt): scalars broadcast, vectors
+//  truncate, and matrices get the layout we keep variables in.
+static int asm_convert_value(AsmContext *actx, const AsmSlot *value,
+                             const MOJOSHADER_astDataType *dt, AsmSlot *out)
+{
+    dt = asm_reduce(actx->ctx, dt);
+    if (dt->type == MOJOSHADER_AST_DATATYPE_MATRIX)
+    {
+        const int rowmajor = value->ismatrix ? value->matrix.rowmajor : 1;
+        return asm_reshape_matrix(actx, value, dt->matrix.rows,
+                                  dt->matrix.columns, rowmajor, out);
+    } // if
+
+    *out = *value;
+    out->readonly = 0;
+    if ( (value->ismatrix) || (value->members != NULL) ||
+         (dt->type == MOJOSHADER_AST_DATATYPE_STRUCT) ||
+         (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY) )
+        return 1;  // nothing to do (or nothing we can do).
+
+    const int elements = asm_datatype_elems(actx->ctx, dt);
+    if (elements != value->value.elements)
+        out->value = asm_resize(&value->value, elements);
+    return 1;
+} // asm_convert_value
+
+
+// Per-function setup...
+
+static int asm_local_type(AsmContext *actx, AsmFunction *fn, const int index,
+                          const MOJOSHADER_astDataType *dt)
+{
+    Context *ctx = actx->ctx;
+    int i;
+
+    dt = asm_reduce(ctx, dt);
+    if ((index <= 0) || (index >= fn->local_count))
+    {
+        fail(ctx, "Internal error: unknown local variable");
+        return 0;
+    } // if
+
+    fn->localtypes[index] = dt;
+    const MOJOSHADER_astDataType *sdt = asm_struct_type(ctx, dt);
+    for (i = 0; (sdt != NULL) && (i < sdt->structure.member_count); i++)
+    {
+        const int midx = index + datatype_member_offset(ctx, dt, i);
+        if (!asm_local_type(actx, fn, midx, asm_member_type(ctx, dt, i)))
+            return 0;
+    } // for
+
+    return 1;
+} // asm_local_type
+
+static int asm_local_extent(Context *ctx, const int index,
+                            const MOJOSHADER_astDataType *dt)
+{
+    return index + datatype_index_count(ctx, dt);
+} // asm_local_extent
+
+// Walks a function body for its variables. With (fn->localtypes) NULL, this
+//  just finds how many indexes there are.
+static void asm_walk_locals(AsmContext *actx, AsmFunction *fn,
+                            const MOJOSHADER_astStatement *stmt)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astVariableDeclaration *decl;
+
+    for (; stmt != NULL; stmt = stmt->next)
+    {
+        decl = NULL;
+        switch (stmt->ast.type)
+        {
+            case MOJOSHADER_AST_STATEMENT_BLOCK:
+                asm_walk_locals(actx, fn, ((const MOJOSHADER_astBlockStatement *) stmt)->statements);
+                break;
+
+            case MOJOSHADER_AST_STATEMENT_IF:
+            {
+                const MOJOSHADER_astIfStatement *ifstmt = (const MOJOSHADER_astIfStatement *) stmt;
+                asm_walk_locals(actx, fn, ifstmt->statement);
+                asm_walk_locals(actx, fn, ifstmt->else_statement);
+                break;
+            } // case
+
+            case MOJOSHADER_AST_STATEMENT_SWITCH:
+            {
+                const MOJOSHADER_astSwitchCases *cases = ((const MOJOSHADER_astSwitchStatement *) stmt)->cases;
+                for (; cases != NULL; cases = cases->next)
+                    asm_walk_locals(actx, fn, cases->statement);
+                break;
+            } // case
+
+            case MOJOSHADER_AST_STATEMENT_FOR:
+            {
+                const MOJOSHADER_astForStatement *forstmt = (const MOJOSHADER_astForStatement *) stmt;
+                decl = forstmt->var_decl;
+                asm_walk_locals(actx, fn, forstmt->statement);
+                break;
+            } // case
+
+            case MOJOSHADER_AST_STATEMENT_DO:
+            case MOJOSHADER_AST_STATEMENT_WHILE:
+                asm_walk_locals(actx, fn, ((const MOJOSHADER_astWhileStatement *) stmt)->statement);
+                break;
+
+            case MOJOSHADER_AST_STATEMENT_VARDECL:
+                decl = ((const MOJOSHADER_astVarDeclStatement *) stmt)->declaration;
+                break;
+
+            default: break;
+        } // switch
+
+        for (; decl != NULL; decl = decl->next)
+        {
+            if (fn->localtypes != NULL)
+                asm_local_type(actx, fn, decl->index, decl->datatype);
+            else
+            {
+                const int extent = asm_local_extent(ctx, decl->index, decl->datatype);
+                if (extent > fn->local_count)
+                    fn->local_count = extent;
+            } // else
+        } // for
+    } // for
+} // asm_walk_locals
+
+static int asm_count_stmts(const MOJOSHADER_irStatement *stmt)
+{
+    if (stmt == NULL)
+        return 0;
+    else if (stmt->ir.type == MOJOSHADER_IR_SEQ)
+        return asm_count_stmts(stmt->seq.first) + asm_count_stmts(stmt->seq.next);
+    return 1;
+} // asm_count_stmts
+
+static void asm_flatten_stmts(MOJOSHADER_irStatement *stmt,
+                              MOJOSHADER_irStatement **list, int *count)
+{
+    // the optimizer leaves these leaning right, so this loops more than it
+    //  recurses.
+    while (stmt != NULL)
+    {
+        if (stmt->ir.type != MOJOSHADER_IR_SEQ)
+        {
+            list[(*count)++] = stmt;
+            return;
+        } // if
+        asm_flatten_stmts(stmt->seq.first, list, count);
+        stmt = stmt->seq.next;
+    } // while
+} // asm_flatten_stmts
+
+static int asm_intersect_dom(const AsmBlock *blocks, int a, int b)
+{
+    while (a != b)
+    {
+        if (a > b)
+            a = blocks[a].idom;
+        else
+            b = blocks[b].idom;
+    } // while
+    return a;
+} // asm_intersect_dom
+
+// Where an edge to (to) goes, as far as (region) can tell: that's a loop, or
+//  -1 for the whole function. Going back to the loop's header is going to
+//  the end of it (it goes around again from there), and leaving the loop is
+//  going nowhere, since it really jumps out.
+static int asm_region_target(const AsmFunction *fn, const int region,
+                             const int to)
+{
+    if (region < 0)
+        return (to < 0) ? fn->block_count : to;
+
+    const AsmLoop *loop = &fn->loops[region];
+    if (to == loop->header)
+        return loop->last + 1;
+    else if ((to < loop->header) || (to > loop->last))
+        return ASM_LEAVES_LOOP;
+    return to;
+} // asm_region_target
+
+// The loop right inside (region) that (b) is in, or -1 if it's not in one.
+static int asm_child_loop(const AsmFunction *fn, const int region, const int b)
+{
+    int loop = fn->blocks[b].loop;
+    if (loop == region)
+        return -1;
+    while ((loop >= 0) && (fn->loops[loop].parent != region))
+        loop = fn->loops[loop].parent;
+    return loop;
+} // asm_child_loop
+
+// (region) sees the loops inside it as one block, at their header.
+static int asm_region_ipdom(const AsmFunction *fn, const int region,
+                            const int node)
+{
+    const int loop = asm_child_loop(fn, region, node);
+    return (loop >= 0) ? fn->loops[loop].ipdom : fn->blocks[node].ipdom;
+} // asm_region_ipdom
+
+static int asm_intersect_postdom(const AsmFunction *fn, const int region,
+                                 int a, int b)
+{
+    const int exit = (region < 0) ? fn->block_count : fn->loops[region].last + 1;
+    while (a != b)
+    {
+        if (a == ASM_LEAVES_LOOP)
+            return b;
+        else if (b == ASM_LEAVES_LOOP)
+            return a;
+        else if (a < b)
+            a = (a == exit) ? exit : asm_region_ipdom(fn, region, a);
+        else
+            b = (b == exit) ? exit : asm_region_ipdom(fn, region, b);
+    } // while
+    return a;
+} // asm_intersect_postdom
+
+static int asm_dominates(const AsmFunction *fn, const int a, int b)
+{
+    while (b > a)
+        b = fn->blocks[b].idom;
+    return (b == a);
+} // asm_dominates
+
+// Finds the loops, which the IR only makes one way: the header comes first,
+//  every back edge goes to it, and the loop is everything from there to the
+//  last block that jumps back. Loops inside it nest, so we can run them
+//  with rep and break.
+static int asm_find_loops(AsmContext *actx, AsmFunction *fn)
+{
+    Context *ctx = actx->ctx;
+    int *lastback = (int *) new_asm_array(actx, fn->block_count, sizeof (int));
+    int *stack = NULL;
+    int depth = 0;
+    int pass, b, i, j, l;
+
+    if (lastback == NULL)
+        return 0;
+
+    for (b = 0; b < fn->block_count; b++)
+        lastback[b] = -1;
+
+    for (b = 0; b < fn->block_count; b++)
+    {
+        const AsmBlock *block = &fn->blocks[b];
+        for (i = 0; i < 2; i++)
+        {
+            const int s = block->succ[i];
+            if ((s < 0) || (s > b))
+                continue;
+            else if (actx->major < 3)
+            {
+                const MOJOSHADER_irStatement *last = fn->stmts[block->first + block->count - 1];
+                ctx->sourcefile = last->ir.filename;
+                ctx->sourceline = last->ir.line;
+                fail(ctx, "Loops that can't be unrolled need Shader Model 3");
+                return 0;
+            } // else if
+            else if (b > lastback[s])
+            {
+                if (lastback[s] < 0)
+                    fn->loop_count++;
+                lastback[s] = b;
+            } // else if
+        } // for
+    } // for
+
+    if (fn->loop_count == 0)
+        return 1;
+
+    fn->loops = (AsmLoop *) new_asm_array(actx, fn->loop_count, sizeof (AsmLoop));
+    stack = (int *) new_asm_array(actx, fn->loop_count, sizeof (int));
+    if ((fn->loops == NULL) || (stack == NULL))
+        return 0;
+
+    // headers come in order, so the loop that holds this one is on the stack.
+    for (b = 0, l = 0; b < fn->block_count; b++)
+    {
+        if (lastback[b] < 0)
+            continue;
+
+        AsmLoop *loop = &fn->loops[l];
+        loop->header = b;
+        loop->last = lastback[b];
+        while ((depth > 0) && (fn->loops[stack[depth-1]].last < b))
+            depth--;
+        loop->parent = (depth > 0) ? stack[depth-1] : -1;
+        if ((loop->parent >= 0) && (fn->loops[loop->parent].last <= loop->last))
+        {
+            fail(ctx, "Internal error: loops don't nest");
+            return 0;
+        } // if
+
+        for (i = loop->header; i <= loop->last; i++)
+            fn->blocks[i].loop = l;
+        stack[depth++] = l++;
+    } // for
+
+    // the only way into a loop is through its header.
+    for (b = 0; b < fn->block_count; b++)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            const int s = fn->blocks[b].succ[i];
+            for (l = (s < 0) ? -1 : fn->blocks[s].loop; l >= 0; l = fn->loops[l].parent)
+            {
+                const AsmLoop *loop = &fn->loops[l];
+                if ((s != loop->header) && ((b < loop->header) || (b > loop->last)))
+                {
+                    fail(ctx, "Internal error: jump into the middle of a loop");
+                    return 0;
+                } // if
+            } // for
+        } // for
+    } // for
+
+    // the blocks outside each loop that it can jump to, counting the one
+    //  after it, where it goes when rep runs out. First pass counts them.
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (l = 0; l < fn->loop_count; l++)
+        {
+            AsmLoop *loop = &fn->loops[l];
+            if (pass == 0)
+                loop->exit_count = 1;
+            else
+            {
+                loop->exits = (int *) new_asm_array(actx, loop->exit_count, sizeof (int));
+                if (loop->exits == NULL)
+                    return 0;
+                loop->exits[0] = loop->last + 1;
+                loop->exit_count = 1;
+            } // else
+        } // for
+
+        for (b = 0; b < fn->block_count; b++)
+        {
+            const AsmBlock *block = &fn->blocks[b];
+            for (i = 0; i < 2; i++)
+            {
+                const int s = block->succ[i];
+                if (s < 0)
+                    continue;
+
+                for (l = block->loop; l >= 0; l = fn->loops[l].parent)
+                {
+                    AsmLoop *loop = &fn->loops[l];
+                    if ((s >= loop->header) && (s <= loop->last))
+                        break;  // still inside it.
+                    else if (pass == 0)
+                        loop->exit_count++;
+                    else
+                    {
+                        for (j = 0; j < loop->exit_count; j++)
+                        {
+                            if (loop->exits[j] == s)
+                                break;
+                        } // for
+                        if (j == loop->exit_count)
+                            loop->exits[loop->exit_count++] = s;
+                    } // else
+                } // for
+            } // for
+        } // for
+    } // for
+
+    return 1;
+} // asm_find_loops
+
+// A [branch] if that we can run as if_ne/else/endif: the true side starts
+//  right after the branch and runs up to the false side, the false side runs
+//  up to where they meet, and nothing jumps between the two sides or into
+//  them from outside. Leaving the loop we're in is fine, since that's a
+//  break. Everything else stays predicated.
+static int asm_can_branch(const AsmFunction *fn, const int b)
+{
+    const AsmBlock *block = &fn->blocks[b];
+    const int region = block->loop;
+    const int exit = (region < 0) ? fn->block_count : fn->loops[region].last + 1;
+    const int t = asm_region_target(fn, region, block->succ[0]);
+    const int f = asm_region_target(fn, region, block->succ[1]);
+    const int join = block->ipdom;
+    int x, i;
+
+    if ( (t != b + 1) || (f <= t) || (join == ASM_LEAVES_LOOP) ||
+         (join < f) || (join > exit) )
+        return 0;
+    else if ((join < exit) && (fn->blocks[join].idom != b))
+        return 0;
+
+    for (x = b + 1; x < join; x++)
+    {
+        const int end = (x < f) ? f : join;
+        const int loop = asm_child_loop(fn, region, x);
+        const int *targets = (loop >= 0) ? fn->loops[loop].exits : fn->blocks[x].succ;
+        const int count = (loop >= 0) ? fn->loops[loop].exit_count : 2;
+
+        if (!fn->blocks[x].reachable)
+            continue;
+        else if ((loop >= 0) && (fn->loops[loop].last >= end))
+            return 0;
+        else if (!asm_dominates(fn, b, x))
+            return 0;
+
+        for (i = 0; i < count; i++)
+        {
+            if ((loop < 0) && (i == 1) && (targets[i] < 0))
+                continue;  // just the one way out.
+            const int to = asm_region_target(fn, region, targets[i]);
+            if ((to != ASM_LEAVES_LOOP) && (to != join) && ((to <= x) || (to >= end)))
+                return 0;
+        } // for
+
+        if (loop >= 0)
+            x = fn->loops[loop].last;
+    } // for
+
+    return 1;
+} // asm_can_branch
+
+// Splits a function into basic blocks and works out which blocks control
+//  which, so we can predicate them. Branches only go forward, except for the
+//  back edges of loops (Shader Model 3 only), which asm_find_loops() sorts
+//  out. Postdominators are worked out for each loop on its own: a loop sees
+//  the loops inside it as one block, and its back edges go to the block
+//  after it.
+static int asm_build_blocks(AsmContext *actx, AsmFunction *fn)
+{
+    Context *ctx = actx->ctx;
+    MOJOSHADER_irStatement **stmts = fn->stmts;
+    int *labelblock = NULL;
+    int i, b, l;
+
+    fn->block_count = 0;
+    for (i = 0; i < fn->stmt_count; i++)
+    {
+        if ( (i == 0) || (stmts[i]->ir.type == MOJOSHADER_IR_LABEL) ||
+             (stmts[i-1]->ir.type == MOJOSHADER_IR_JUMP) ||
+             (stmts[i-1]->ir.type == MOJOSHADER_IR_CJUMP) )
+            fn->block_count++;
+    } // for
+
+    fn->blocks = (AsmBlock *) new_asm_array(actx, fn->block_count, sizeof (AsmBlock));
+    labelblock = (int *) new_asm_array(actx, ctx->ir_label_count, sizeof (int));
+    if ((fn->blocks == NULL) || (labelblock == NULL))
+        return 0;
+
+    b = -1;
+    for (i = 0; i < fn->stmt_count; i++)
+    {
+        if ( (i == 0) || (stmts[i]->ir.type == MOJOSHADER_IR_LABEL) ||
+             (stmts[i-1]->ir.type == MOJOSHADER_IR_JUMP) ||
+             (stmts[i-1]->ir.type == MOJOSHADER_IR_CJUMP) )
+            fn->blocks[++b].first = i;
+        fn->blocks[b].count++;
+        if (stmts[i]->ir.type == MOJOSHADER_IR_LABEL)
+        {
+            const int label = stmts[i]->label.index;
+            if ((label >= 0) && (label < ctx->ir_label_count))
+                labelblock[label] = b;
+        } // if
+    } // for
+
+    for (b = 0; b < fn->block_count; b++)
+    {
+        AsmBlock *block = &fn->blocks[b];
+        const MOJOSHADER_irStatement *last = stmts[block->first + block->count - 1];
+        block->succ[0] = block->succ[1] = -1;
+        block->idom = -1;
+        block->loop = -1;
+        block->join = -1;
+        if (last->ir.type == MOJOSHADER_IR_JUMP)
+            block->succ[0] = labelblock[last->jump.label];
+        else if (last->ir.type == MOJOSHADER_IR_CJUMP)
+        {
+            block->succ[0] = labelblock[last->cjump.iftrue];
+            block->succ[1] = labelblock[last->cjump.iffalse];
+        } // else if
+        else if (b + 1 < fn->block_count)
+            block->succ[0] = b + 1;
+    } // for
+
+    if (!asm_find_loops(actx, fn))
+        return 0;
+
+    // dominators, for the blocks we can get to. Back edges don't change
+    //  anything: the header dominates everything that jumps back to it.
+    fn->blocks[0].reachable = 1;
+    for (b = 0; b < fn->block_count; b++)
+    {
+        const AsmBlock *block = &fn->blocks[b];
+        if (!block->reachable)
+            continue;
+        for (i = 0; i < 2; i++)
+        {
+            const int s = block->succ[i];
+            if ((s < 0) || (s <= b))
+                continue;
+            AsmBlock *succ = &fn->blocks[s];
+            succ->idom = succ->reachable ? asm_intersect_dom(fn->blocks, succ->idom, b) : b;
+            succ->reachable = 1;
+        } // for
+    } // for
+
+    // postdominators, with (block_count) as the way out. A loop's header is
+    //  the last of its blocks we get to going backwards, so the loop is done
+    //  by then, and its parent can treat it as one block.
+    for (b = fn->block_count - 1; b >= 0; b--)
+    {
+        AsmBlock *block = &fn->blocks[b];
+        const int region = block->loop;
+        block->ipdom = asm_region_target(fn, region, block->succ[0]);
+        if (block->succ[1] >= 0)
+        {
+            const int s1 = asm_region_target(fn, region, block->succ[1]);
+            block->ipdom = asm_intersect_postdom(fn, region, block->ipdom, s1);
+        } // if
+
+        for (l = region; (l >= 0) && (fn->loops[l].header == b); l = fn->loops[l].parent)
+        {
+            AsmLoop *loop = &fn->loops[l];
+            loop->ipdom = ASM_LEAVES_LOOP;
+            for (i = 0; i < loop->exit_count; i++)
+            {
+                const int to = asm_region_target(fn, loop->parent, loop->exits[i]);
+                loop->ipdom = asm_intersect_postdom(fn, loop->parent, loop->ipdom, to);
+            } // for
+        } // for
+    } // for
+
+    // Shader Model 3 can really branch, if the if statement asked for that.
+    for (b = 0; (actx->major >= 3) && (b < fn->block_count); b++)
+    {
+        AsmBlock *block = &fn->blocks[b];
+        const MOJOSHADER_irStatement *last = stmts[block->first + block->count - 1];
+        if ( (!block->reachable) || (last->ir.type != MOJOSHADER_IR_CJUMP) ||
+             (!last->cjump.branch) || (block->succ[0] == block->succ[1]) )
+            continue;
+        else if (!asm_can_branch(fn, b))
+        {
+            ctx->sourcefile = last->ir.filename;
+            ctx->sourceline = last->ir.line;
+            warn(ctx, "Can't branch on this if statement; predicating it instead");
+            continue;
+        } // else if
+
+        block->join = block->ipdom;
+        fn->branches = 1;
+    } // for
+
+    return 1;
+} // asm_build_blocks
+
+static AsmFunction *asm_function(AsmContext *actx, const int index)
+{
+    Context *ctx = actx->ctx;
+    if ((index < 0) || (index > ctx->user_func_index))
+    {
+        fail(ctx, "Internal error: unknown function");
+        return NULL;
+    } // if
+
+    AsmFunction *fn = &actx->funcs[index];
+    if (fn->ready)
+        return fn;
+
+    fn->ready = 1;
+    MOJOSHADER_irStatement *ir = ir_tree_view(ctx, &ctx->ir[index]);
+    fn->stmt_count = asm_count_stmts(ir);
+    fn->stmts = (MOJOSHADER_irStatement **) new_asm_array(actx, fn->stmt_count, sizeof (MOJOSHADER_irStatement *));
+    if (fn->stmts == NULL)
+        return NULL;
+    fn->stmt_count = 0;
+    asm_flatten_stmts(ir, fn->stmts, &fn->stmt_count);
+
+    const MOJOSHADER_astCompilationUnitFunction *astfn = ctx->ir_funcs[index].ast;
+    if (astfn != NULL)
+    {
+        const MOJOSHADER_astFunctionParameters *param;
+        fn->local_count = 1;  // zero is never a variable index.
+        for (param = astfn->declaration->params; param != NULL; param = param->next)
+        {
+            const int extent = asm_local_extent(ctx, param->index, param->datatype);
+            if (extent > fn->local_count)
+                fn->local_count = extent;
+        } // for
+        asm_walk_locals(actx, fn, astfn->definition);
+
+        fn->localtypes = (const MOJOSHADER_astDataType **) new_asm_array(actx, fn->local_count, sizeof (MOJOSHADER_astDataType *));
+        if (fn->localtypes == NULL)
+            return NULL;
+        for (param = astfn->declaration->params; param != NULL; param = param->next)
+            asm_local_type(actx, fn, param->index, param->datatype);
+        asm_walk_locals(actx, fn, astfn->definition);
+    } // if
+
+    if ((fn->stmt_count > 0) && (!asm_build_blocks(actx, fn)))
+        return NULL;
+
+    return isfail(ctx) ? NULL : fn;
+} // asm_function
+
+static int asm_new_frame(AsmContext *actx, const int func, AsmFrame *frame)
+{
+    const AsmFunction *fn = &actx->funcs[func];
+    frame->func = func;
+    frame->temps = (AsmSlot *) new_asm_array(actx, actx->ctx->ir_funcs[func].temp_count, sizeof (AsmSlot));
+    frame->locals = (AsmSlot *) new_asm_array(actx, fn->local_count, sizeof (AsmSlot));
+    return ((frame->temps != NULL) && (frame->locals != NULL));
+} // asm_new_frame
+
+// Where a temp or variable's value lives, and what type it was declared as
+//  (NULL for temps, which only have what the IR says about them).
+static AsmSlot *asm_variable(AsmContext *actx, AsmFrame *frame,
+                             const MOJOSHADER_irExpression *expr,
+                             const int offset,
+                             const MOJOSHADER_astDataType **_dt)
+{
+    Context *ctx = actx->ctx;
+    const AsmFunction *fn = &actx->funcs[frame->func];
+    const MOJOSHADER_astDataType *dt = NULL;
+    AsmSlot *retval = NULL;
+
+    if (expr->ir.type == MOJOSHADER_IR_TEMP)
+    {
+        const IrFunction *irfn = &ctx->ir_funcs[frame->func];
+        const int index = expr->temp.index - irfn->first_temp + offset;
+        if ((offset == 0) && (index >= 0) && (index < irfn->temp_count))
+            retval = &frame->temps[index];
+        else
+            fail(ctx, "Internal error: unknown temp");
+    } // if
+    else
+    {
+        assert(expr->ir.type == MOJOSHADER_IR_MEMORY);
+        const int index = expr->memory.index + offset;
+        if (expr->memory.index < 0)
+        {
+            retval = asm_global_slot(actx, -index);
+            if (retval != NULL)
+                dt = actx->globals[-index].datatype;
+        } // if
+        else if ((index > 0) && (index < fn->local_count))
+        {
+            retval = &frame->locals[index];
+            dt = fn->localtypes[index];
+        } // else if
+        else
+        {
+            fail(ctx, "Internal error: unknown local variable");
+        } // else
+    } // else
+
+    if (_dt != NULL)
+        *_dt = dt;
+    return retval;
+} // asm_variable
+
+
+// Expressions...
+
+static int asm_expr(AsmContext *actx, AsmFrame *frame,
+                    const AsmPredicate *pred,
+                    const MOJOSHADER_irExpression *expr, AsmSlot *out);
+static int asm_call(AsmContext *actx, AsmFrame *frame,
+                    const AsmPredicate *pred,
+                    const MOJOSHADER_irCall *call, AsmSlot *out);
+static int asm_intrinsic(AsmContext *actx, AsmFrame *frame,
+                         const AsmPredicate *pred,
+                         const MOJOSHADER_irCall *call, AsmSlot *out);
+static int asm_store_slot(AsmContext *actx, const AsmPredicate *pred,
+                          AsmSlot *slot, const MOJOSHADER_astDataType *dt,
+                          const AsmSlot *value);
+
+static inline int asm_is_int_type(const MOJOSHADER_astDataTypeType type)
+{
+    return ( (type == MOJOSHADER_AST_DATATYPE_INT) ||
+             (type == MOJOSHADER_AST_DATATYPE_UINT) );
+} // asm_is_int_type
+
+static inline float asm_constant_value(const MOJOSHADER_irConstant *c,
+                                       const int i)
+{
+    if ( (c->info.type == MOJOSHADER_AST_DATATYPE_INT) ||
+         (c->info.type == MOJOSHADER_AST_DATATYPE_UINT) ||
+         (c->info.type == MOJOSHADER_AST_DATATYPE_BOOL) )
+        return (float) c->value.ival[i];
+    return c->value.fval[i];
+} // asm_constant_value
+
+// Evaluates something that has to be a scalar or vector.
+static int asm_vector_expr(AsmContext *actx, AsmFrame *frame,
+                           const AsmPredicate *pred,
+                           const MOJOSHADER_irExpression *expr,
+                           AsmOperand *out)
+{
+    AsmSlot slot;
+    if (!asm_expr(actx, frame, pred, expr, &slot))
+        return 0;
+    else if ((slot.ismatrix) || (slot.members != NULL) || (slot.arraylen > 0))
+    {
+        fail(actx->ctx, "Internal error: expected a scalar or vector");
+        return 0;
+    } // else if
+
+    *out = slot.value;
+    return 1;
+} // asm_vector_expr
+
+static int asm_constant_index(const MOJOSHADER_irExpression *expr, int *index)
+{
+    if (expr->ir.type != MOJOSHADER_IR_CONSTANT)
+        return 0;
+    *index = (int) asm_constant_value(&expr->constant, 0);
+    return 1;
+} // asm_constant_index
+
+static void asm_vector_slot(const AsmOperand *value, AsmSlot *out)
+{
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+    out->value = *value;
+} // asm_vector_slot
+
+// A struct variable is one variable per member (see
+//  datatype_member_offset()), so this pulls them together. An array of
+//  structs is an array per member, so (out) gets those.
+static int asm_struct_value(AsmContext *actx, AsmFrame *frame,
+                            const MOJOSHADER_irExpression *expr,
+                            const int offset,
+                            const MOJOSHADER_astDataType *dt, AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *sdt = asm_struct_type(ctx, dt);
+    const MOJOSHADER_astDataTypeStruct *s = &sdt->structure;
+    int i;
+
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+    out->structtype = sdt;
+    if (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+        out->arraylen = dt->array.elements;
+    out->members = (AsmSlot *) new_asm_array(actx, s->member_count, sizeof (AsmSlot));
+    if (out->members == NULL)
+        return 0;
+
+    for (i = 0; i < s->member_count; i++)
+    {
+        const int moffset = offset + datatype_member_offset(ctx, dt, i);
+        const MOJOSHADER_astDataType *mdt = NULL;
+        AsmSlot *member = asm_variable(actx, frame, expr, moffset, &mdt);
+        if (member == NULL)
+            return 0;
+        else if (asm_struct_type(ctx, mdt) != NULL)
+        {
+            if (!asm_struct_value(actx, frame, expr, moffset, mdt, &out->members[i]))
+                return 0;
+        } // else if
+        else if (member->defined)
+            out->members[i] = *member;
+        else
+            asm_zero_slot(actx, mdt, 1, &out->members[i]);
+    } // for
+
+    return 1;
+} // asm_struct_value
+
+static int asm_read_variable(AsmContext *actx, AsmFrame *frame,
+                             const MOJOSHADER_irExpression *expr,
+                             AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *dt = NULL;
+    AsmSlot *slot = asm_variable(actx, frame, expr, 0, &dt);
+
+    if (slot == NULL)
+        return 0;
+
+    else if ((dt != NULL) && (asm_struct_type(ctx, dt) != NULL))
+        return asm_struct_value(actx, frame, expr, 0, dt, out);
+
+    if (slot->defined)
+        *out = *slot;
+    else if ((dt == NULL) && (expr->info.type == MOJOSHADER_AST_DATATYPE_STRUCT))
+    {
+        fail(ctx, "Internal error: struct temp read before it was written");
+        return 0;
+    } // else if
+    else
+        asm_zero_slot(actx, dt, expr->info.elements, out);
+
+    return 1;
+} // asm_read_variable
+
+// Integer bit math, without integer instructions. A float holds integers
+//  exactly up to 24 bits, so that's what these work with: bit 23 is the
+//  sign, like two's complement, and the bits above it copy that one.
+//  frc(x / 2^b) * 2^b is x mod 2^b, which is the low (b) bits of (x) even
+//  when (x) is negative, and multiplying by powers of two is always exact.
+
+#define ASM_INT_BITS 24
+
+static inline float asm_pow2(const int n)
+{
+    return (float) ldexp(1.0, n);
+} // asm_pow2
+
+// Bit (b) of (c), as far as a float-sized integer goes.
+static inline int asm_const_bit(const int c, const int b)
+{
+    return (b < ASM_INT_BITS) ? ((((unsigned int) c) >> b) & 1) : (c < 0);
+} // asm_const_bit
+
+// The low (b) bits of (x), scaled by (scale): frc(x / 2^b) * (scale).
+static AsmOperand asm_low_bits(AsmContext *actx, const AsmOperand *x,
+                               const int b, const AsmOperand *scale)
+{
+    const AsmOperand k = asm_literal1(actx, asm_pow2(-b));
+    AsmOperand t = asm_op(actx, ASMOP_MUL, x->elements, x, &k, NULL);
+    t = asm_op(actx, ASMOP_FRC, x->elements, &t, NULL, NULL);
+    return asm_op(actx, ASMOP_MUL, x->elements, &t, scale, NULL);
+} // asm_low_bits
+
+// (x & c) for a constant (c). Each run of set bits in (c), from bit (lo) up
+//  to (hi), is (x mod 2^hi) - (x mod 2^lo), so this costs a few
+//  instructions per run instead of per bit.
+static AsmOperand asm_and_const(AsmContext *actx, const AsmOperand *x,
+                                const int c)
+{
+    const int elements = x->elements;
+    AsmOperand retval = *x;  // a negative (c) never ends its last run.
+    int have = (c < 0);
+    int b;
+
+    for (b = 1; b <= ASM_INT_BITS; b++)
+    {
+        const int prev = asm_const_bit(c, b - 1);
+        if (prev == asm_const_bit(c, b))
+            continue;
+
+        // a run ends at (b) if the bit below it is set, or starts there.
+        const float scale = prev ? asm_pow2(b) : -asm_pow2(b);
+        const AsmOperand k = asm_literal1(actx, scale);
+        const AsmOperand t = asm_low_bits(actx, x, b, &k);
+        retval = have ? asm_op(actx, ASMOP_ADD, elements, &retval, &t, NULL) : t;
+        have = 1;
+    } // for
+
+    if (!have)
+    {
+        const AsmOperand zero = asm_zero(actx);
+        return asm_resize(&zero, elements);
+    } // if
+
+    return retval;
+} // asm_and_const
+
+// (a & b) for two scalars that aren't known until the shader runs: every
+//  bit of both, four at a time, with the sign bit weighed negative.
+static AsmOperand asm_and_scalars(AsmContext *actx, const AsmOperand *a,
+                                  const AsmOperand *b)
+{
+    const AsmOperand half = asm_literal1(actx, 0.5f);
+    const AsmOperand a4 = asm_resize(a, 4);
+    const AsmOperand b4 = asm_resize(b, 4);
+    AsmOperand retval;
+    float scales[4];
+    float weights[4];
+    int i, j;
+
+    for (i = 0; i < ASM_INT_BITS; i += 4)
+    {
+        for (j = 0; j < 4; j++)
+        {
+            const int bit = i + j;
+            scales[j] = asm_pow2(-(bit + 1));
+            weights[j] = asm_pow2(bit);
+            if (bit == ASM_INT_BITS - 1)
+                weights[j] = -weights[j];
+        } // for
+
+        const AsmOperand k = asm_literal(actx, scales, 4);
+        const AsmOperand w = asm_literal(actx, weights, 4);
+        AsmOperand ta = asm_op(actx, ASMOP_MUL, 4, &a4, &k, NULL);
+        AsmOperand tb = asm_op(actx, ASMOP_MUL, 4, &b4, &k, NULL);
+        ta = asm_op(actx, ASMOP_FRC, 4, &ta, NULL, NULL);
+        tb = asm_op(actx, ASMOP_FRC, 4, &tb, NULL, NULL);
+        ta = asm_compare(actx, MOJOSHADER_IR_COND_GEQ, &ta, &half);
+        tb = asm_compare(actx, MOJOSHADER_IR_COND_GEQ, &tb, &half);
+        const AsmOperand both = asm_op(actx, ASMOP_MUL, 4, &ta, &tb, NULL);
+        const AsmOperand sum = asm_op(actx, ASMOP_DP4, 1, &both, &w, NULL);
+        retval = (i == 0) ? sum : asm_op(actx, ASMOP_ADD, 1, &retval, &sum, NULL);
+    } // for
+
+    return retval;
+} // asm_and_scalars
+
+// Is (expr) a constant with the same integer in every component?
+static int asm_splat_int(const MOJOSHADER_irExpression *expr, int *val)
+{
+    int i;
+    if ((expr->ir.type != MOJOSHADER_IR_CONSTANT) ||
+        (!asm_is_int_type(expr->info.type)))
+        return 0;
+
+    *val = expr->constant.value.ival[0];
+    for (i = 1; i < expr->info.elements; i++)
+    {
+        if (expr->constant.value.ival[i] != *val)
+            return 0;
+    } // for
+    return 1;
+} // asm_splat_int
+
+static AsmOperand asm_bitand(AsmContext *actx, const MOJOSHADER_irBinOp *binop,
+                             const AsmOperand *a, const AsmOperand *b,
+                             const int elements)
+{
+    AsmOperand comps[4];
+    int c = 0;
+    int i;
+
+    if (asm_splat_int(binop->right, &c))
+    {
+        const AsmOperand x = asm_resize(a, elements);
+        return asm_and_const(actx, &x, c);
+    } // if
+    else if (asm_splat_int(binop->left, &c))
+    {
+        const AsmOperand x = asm_resize(b, elements);
+        return asm_and_const(actx, &x, c);
+    } // else if
+
+    for (i = 0; i < elements; i++)
+    {
+        const AsmOperand x = asm_component(a, i);
+        const AsmOperand y = asm_component(b, i);
+        comps[i] = asm_and_scalars(actx, &x, &y);
+    } // for
+    return asm_gather(actx, comps, elements);
+} // asm_bitand
+
+// 2^n, or 2^-n if (negative), from the low five bits of (n) like a real
+//  shift. exp is only close, and a shift has to be exact.
+static AsmOperand asm_shift_scale(AsmContext *actx, const AsmOperand *n,
+                                  const int negative)
+{
+    const int elements = n->elements;
+    const AsmOperand half = asm_literal1(actx, 0.5f);
+    const AsmOperand one = asm_one(actx);
+    AsmOperand retval;
+    int i;
+
+    for (i = 0; i < 5; i++)
+    {
+        // each bit of (n) multiplies in 1 or 2^(2^i).
+        const int shift = 1 << i;
+        const float factor = asm_pow2(negative ? -shift : shift);
+        const AsmOperand k = asm_literal1(actx, asm_pow2(-(i + 1)));
+        const AsmOperand f = asm_literal1(actx, factor - 1.0f);
+        AsmOperand t = asm_op(actx, ASMOP_MUL, elements, n, &k, NULL);
+        t = asm_op(actx, ASMOP_FRC, elements, &t, NULL, NULL);
+        t = asm_compare(actx, MOJOSHADER_IR_COND_GEQ, &t, &half);
+        t = asm_op(actx, ASMOP_MAD, elements, &t, &f, &one);
+        retval = (i == 0) ? t : asm_op(actx, ASMOP_MUL, elements, &retval, &t, NULL);
+    } // for
+
+    return retval;
+} // asm_shift_scale
+
+// x << n is x * 2^n, and x >> n is floor(x / 2^n), which keeps the sign.
+static AsmOperand asm_shift(AsmContext *actx, const MOJOSHADER_irBinOp *binop,
+                            const AsmOperand *a, const AsmOperand *b,
+                            const int elements)
+{
+    const int right = (binop->op == MOJOSHADER_IR_BINOP_RSHIFT);
+    const MOJOSHADER_irExpression *amount = binop->right;
+    AsmOperand scale;
+    float values[4];
+    int i;
+
+    if (amount->ir.type != MOJOSHADER_IR_CONSTANT)
+        scale = asm_shift_scale(actx, b, right);
+    else
+    {
+        for (i = 0; i < amount->info.elements; i++)
+        {
+            const int n = ((int) asm_constant_value(&amount->constant, i)) & 31;
+            values[i] = asm_pow2(right ? -n : n);
+        } // for
+        scale = asm_literal(actx, values, amount->info.elements);
+    } // else
+
+    const AsmOperand t = asm_op(actx, ASMOP_MUL, elements, a, &scale, NULL);
+    return right ? asm_floor(actx, &t) : t;
+} // asm_shift
+
+// Applies a binary operator to two vectors, or a line of a matrix.
+static AsmOperand asm_binop(AsmContext *actx, const MOJOSHADER_irBinOp *binop,
+                            const AsmOperand *a, const AsmOperand *b,
+                            const int elements)
+{
+    const MOJOSHADER_astDataTypeType type = binop->info.type;
+    const int isint = asm_is_int_type(type);
+    AsmOperand t, sum;
+    int i;
+
+    switch (binop->op)
+    {
+        case MOJOSHADER_IR_BINOP_ADD:
+            return asm_op(actx, ASMOP_ADD, elements, a, b, NULL);
+
+        case MOJOSHADER_IR_BINOP_SUBTRACT:
+            return asm_op(actx, ASMOP_SUB, elements, a, b, NULL);
+
+        case MOJOSHADER_IR_BINOP_MULTIPLY:
+            return asm_op(actx, ASMOP_MUL, elements, a, b, NULL);
+
+        case MOJOSHADER_IR_BINOP_DIVIDE:
+            if ((!isint) && (binop->right->ir.type == MOJOSHADER_IR_CONSTANT))
+            {
+                // dividing by a constant is multiplying by its reciprocal.
+                const MOJOSHADER_irConstant *c = &binop->right->constant;
+                float recip[4];
+                for (i = 0; i < b->elements; i++)
+                {
+                    const float val = asm_constant_value(c, i);
+                    if (val == 0.0f)
+                        break;
+                    recip[i] = 1.0f / val;
+                } // for
+
+                if (i == b->elements)
+                {
+                    t = asm_literal(actx, recip, b->elements);
+                    return asm_op(actx, ASMOP_MUL, elements, a, &t, NULL);
+                } // if
+            } // if
+            return asm_divide(actx, a, b, isint);
+
+        case MOJOSHADER_IR_BINOP_MODULO:
+            return asm_fmod(actx, a, b, elements);
+
+        case MOJOSHADER_IR_BINOP_AND:
+            if (type == MOJOSHADER_AST_DATATYPE_BOOL)
+                return asm_op(actx, ASMOP_MUL, elements, a, b, NULL);
+            return asm_bitand(actx, binop, a, b, elements);
+
+        case MOJOSHADER_IR_BINOP_OR:
+            if (type == MOJOSHADER_AST_DATATYPE_BOOL)
+                return asm_op(actx, ASMOP_MAX, elements, a, b, NULL);
+            // a | b is a + b - (a & b).
+            t = asm_bitand(actx, binop, a, b, elements);
+            sum = asm_op(actx, ASMOP_ADD, elements, a, b, NULL);
+            return asm_op(actx, ASMOP_SUB, elements, &sum, &t, NULL);
+
+        case MOJOSHADER_IR_BINOP_XOR:
+            if (type == MOJOSHADER_AST_DATATYPE_BOOL)
+            {
+                t = asm_op(actx, ASMOP_SUB, elements, a, b, NULL);
+                return asm_op(actx, ASMOP_MUL, elements, &t, &t, NULL);
+            } // if
+            else if ((asm_splat_int(binop->right, &i)) && (i == -1))
+            {
+                // ~x, which is -x - 1.
+                const AsmOperand negone = asm_literal1(actx, -1.0f);
+                t = asm_negate(a);
+                return asm_op(actx, ASMOP_ADD, elements, &t, &negone, NULL);
+            } // else if
+            // a ^ b is a + b - 2(a & b).
+            t = asm_bitand(actx, binop, a, b, elements);
+            sum = asm_op(actx, ASMOP_ADD, elements, a, b, NULL);
+            t = asm_op(actx, ASMOP_ADD, elements, &t, &t, NULL);
+            return asm_op(actx, ASMOP_SUB, elements, &sum, &t, NULL);
+
+        case MOJOSHADER_IR_BINOP_LSHIFT:
+        case MOJOSHADER_IR_BINOP_RSHIFT:
+            return asm_shift(actx, binop, a, b, elements);
+
+        default: break;
+    } // switch
+
+    fail(actx->ctx, "Internal error: unexpected binary operator");
+    return *a;
+} // asm_binop
+
+static int asm_binop_expr(AsmContext *actx, AsmFrame *frame,
+                          const AsmPredicate *pred,
+                          const MOJOSHADER_irBinOp *binop, AsmSlot *out)
+{
+    AsmSlot a, b;
+    int i;
+
+    if (!asm_expr(actx, frame, pred, binop->left, &a))
+        return 0;
+    else if (!asm_expr(actx, frame, pred, binop->right, &b))
+        return 0;
+    else if ((a.members != NULL) || (b.members != NULL))
+    {
+        fail(actx->ctx, "Internal error: operator on a struct");
+        return 0;
+    } // else if
+
+    if ((!a.ismatrix) && (!b.ismatrix))
+    {
+        const AsmOperand result = asm_binop(actx, binop, &a.value, &b.value,
+                                            binop->info.elements);
+        asm_vector_slot(&result, out);
+        return 1;
+    } // if
+
+    // matrix operators work per component, so do it a line at a time.
+    const AsmSlot *m = a.ismatrix ? &a : &b;
+    AsmSlot other;
+    *out = *m;
+    if ((a.ismatrix) && (b.ismatrix))
+    {
+        if (!asm_reshape_matrix(actx, &b, a.matrix.rows, a.matrix.columns,
+                                a.matrix.rowmajor, &other))
+            return 0;
+    } // if
+    else
+    {
+        other = a.ismatrix ? b : a;
+        if (other.value.elements != 1)
+        {
+            fail(actx->ctx, "Internal error: matrix and vector operator");
+            return 0;
+        } // if
+    } // else
+
+    const int lines = m->matrix.rowmajor ? m->matrix.rows : m->matrix.columns;
+    for (i = 0; i < lines; i++)
+    {
+        const AsmOperand *mline = &m->matrix.lines[i];
+        const AsmOperand *oline = other.ismatrix ? &other.matrix.lines[i] : &other.value;
+        const AsmOperand *l = a.ismatrix ? mline : oline;
+        const AsmOperand *r = a.ismatrix ? oline : mline;
+        out->matrix.lines[i] = asm_binop(actx, binop, l, r, mline->elements);
+    } // for
+
+    out->readonly = 0;
+    return 1;
+} // asm_binop_expr
+
+// (float3x3) m4x4 is the upper-left corner. Lines are already registers, so
+//  this just drops the extra lines and shortens the rest; no instructions.
+static int asm_truncate_matrix(AsmContext *actx,
+                               const MOJOSHADER_irConvert *convert,
+                               AsmSlot *out)
+{
+    const int columns = convert->columns;
+    const int rows = (columns > 0) ? (convert->info.elements / columns) : 0;
+    AsmMatrix *matrix = &out->matrix;
+    int i;
+
+    if (convert->info.elements == convert->expr->info.elements)
+        return 1;  // same size, nothing to do.
+    else if ((rows > matrix->rows) || (columns > matrix->columns) || (rows == 0))
+    {
+        fail(actx->ctx, "Internal error: bogus matrix truncation");
+        return 0;
+    } // else if
+
+    const int lines = matrix->rowmajor ? rows : columns;
+    const int linelen = matrix->rowmajor ? columns : rows;
+    for (i = 0; i < lines; i++)
+        matrix->lines[i] = asm_resize(&matrix->lines[i], linelen);
+    matrix->rows = rows;
+    matrix->columns = columns;
+    return 1;
+} // asm_truncate_matrix
+
+static int asm_convert_expr(AsmContext *actx, AsmFrame *frame,
+                            const AsmPredicate *pred,
+                            const MOJOSHADER_irConvert *convert, AsmSlot *out)
+{
+    const MOJOSHADER_astDataTypeType from = convert->expr->info.type;
+    const MOJOSHADER_astDataTypeType to = convert->info.type;
+    const int elements = convert->info.elements;
+    AsmOperand value;
+
+    if (!asm_expr(actx, frame, pred, convert->expr, out))
+        return 0;
+    else if (out->members != NULL)
+        return 1;  // struct to struct, nothing to do.
+    else if (out->ismatrix)
+        return asm_truncate_matrix(actx, convert, out);
+
+    value = out->value;
+    if ((elements != value.elements) && (elements <= 4))
+        value = asm_resize(&value, elements);
+
+    if ((to == MOJOSHADER_AST_DATATYPE_BOOL) && (from != MOJOSHADER_AST_DATATYPE_BOOL))
+        value = asm_nonzero(actx, &value);
+    else if ((asm_is_int_type(to)) && (!asm_is_int_type(from)) &&
+             (from != MOJOSHADER_AST_DATATYPE_BOOL))
+        value = asm_trunc(actx, &value);
+
+    asm_vector_slot(&value, out);
+    return 1;
+} // asm_convert_expr
+
+// A bool is 1.0 or 0.0, just like a predicate, so this is (iffalse) with
+//  (iftrue) stored over it wherever (cond) is true.
+static int asm_select_expr(AsmContext *actx, AsmFrame *frame,
+                           const AsmPredicate *pred,
+                           const MOJOSHADER_irSelect *select, AsmSlot *out)
+{
+    AsmPredicate cond;
+    AsmSlot iftrue;
+
+    cond.always = 0;
+    if (!asm_vector_expr(actx, frame, pred, select->cond, &cond.value))
+        return 0;
+    else if (!asm_expr(actx, frame, pred, select->iftrue, &iftrue))
+        return 0;
+    else if (!asm_expr(actx, frame, pred, select->iffalse, out))
+        return 0;
+
+    out->readonly = 0;  // it's a copy, even if it came from a uniform.
+    return asm_store_slot(actx, &cond, out, NULL, &iftrue);
+} // asm_select_expr
+
+static int asm_construct_expr(AsmContext *actx, AsmFrame *frame,
+                              const AsmPredicate *pred,
+                              const MOJOSHADER_irConstruct *construct,
+                              AsmSlot *out)
+{
+    const MOJOSHADER_irExprList *args = construct->args;
+    AsmOperand comps[16];
+    int count = 0;
+    AsmSlot arg;
+
+    // one argument that's already the right size? Nothing to do.
+    if ( (args != NULL) && (args->next == NULL) &&
+         (args->expr->info.elements == construct->info.elements) )
+        return asm_expr(actx, frame, pred, args->expr, out);
+
+    for (; args != NULL; args = args->next)
+    {
+        if (!asm_expr(actx, frame, pred, args->expr, &arg))
+            return 0;
+        count += asm_flatten(&arg, &comps[count], STATICARRAYLEN(comps) - count);
+    } // for
+
+    // a single scalar fills the whole thing: float4(0) is float4(0,0,0,0).
+    if (count == 1)
+    {
+        for (; count < construct->info.elements; count++)
+            comps[count] = comps[0];
+    } // if
+
+    if (count > 4)
+        asm_flat_value(actx, comps, count, out);
+    else
+    {
+        const AsmOperand value = asm_gather(actx, comps, count);
+        asm_vector_slot(&value, out);
+    } // else
+
+    return 1;
+} // asm_construct_expr
+
+static int asm_uniform_element(AsmContext *actx, const AsmSlot *array,
+                               const AsmOperand *idx, const int index,
+                               AsmSlot *out);
+
+// An element of a uniform array that's an array itself (a member array in
+//  an array of structs, say). With a constant index, that's a uniform array
+//  further along; a variable index sets a0, which won't hold still until
+//  something reads the elements, so they're all copied out right away.
+static int asm_uniform_subarray(AsmContext *actx, const AsmSlot *array,
+                                const AsmOperand *idx, const int index,
+                                AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *elemtype = asm_reduce(ctx, array->elemtype->array.base);
+    AsmSlot sub;
+    int i;
+
+    memset(&sub, '\0', sizeof (sub));
+    sub.defined = sub.readonly = 1;
+    sub.arraylen = array->elemtype->array.elements;
+    sub.elemtype = elemtype;
+    sub.stride = asm_register_count(ctx, elemtype, array->matrix.rowmajor);
+    sub.value = array->value;
+    sub.matrix.rowmajor = array->matrix.rowmajor;
+
+    if (elemtype->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+    {
+        fail(ctx, "Internal error: uniform array nested too deep");
+        return 0;
+    } // if
+    else if (idx == NULL)
+    {
+        if ((index < 0) || (index >= array->arraylen))
+        {
+            fail(ctx, "Array index out of range");
+            return 0;
+        } // if
+        sub.value.regnum += index * array->stride;
+        *out = sub;
+        return 1;
+    } // else if
+    else if ((actx->pixel) || (sub.value.regtype != REG_TYPE_CONST))
+    {
+        fail(ctx, "Arrays in pixel shaders and sampler arrays need constant indexes");
+        return 0;
+    } // else if
+
+    AsmOperand offset = *idx;
+    if (array->stride != 1)
+    {
+        const AsmOperand stride = asm_literal1(actx, (float) array->stride);
+        offset = asm_op(actx, ASMOP_MUL, 1, idx, &stride, NULL);
+    } // if
+
+    const AsmOperand a0 = asm_register(REG_TYPE_ADDRESS, 0, 1);
+    emit_asm(actx, ASMOP_MOVA, 0, &a0, &offset, NULL, NULL, NULL);
+    sub.value.relative = 1;
+
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+    out->arraylen = sub.arraylen;
+    out->elemtype = elemtype;
+    out->members = (AsmSlot *) new_asm_array(actx, out->arraylen, sizeof (AsmSlot));
+    if (out->members == NULL)
+        return 0;
+    for (i = 0; i < out->arraylen; i++)
+    {
+        AsmSlot *elem = &out->members[i];
+        if (!asm_uniform_element(actx, &sub, NULL, i, elem))
+            return 0;
+        else if (!elem->ismatrix)  // matrix lines already got copied.
+            elem->value = asm_mov(actx, &elem->value);
+        elem->readonly = 0;
+    } // for
+
+    return 1;
+} // asm_uniform_subarray
+
+// Loads element (index) of a uniform array, or element (idx) if that isn't
+//  NULL, which means the index isn't a constant.
+static int asm_uniform_element(AsmContext *actx, const AsmSlot *array,
+                               const AsmOperand *idx, const int index,
+                               AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *elemtype = array->elemtype;
+    const int ismatrix = (elemtype->type == MOJOSHADER_AST_DATATYPE_MATRIX);
+    const int elements = ismatrix ? 4 : asm_datatype_elems(ctx, elemtype);
+    AsmOperand reg = array->value;
+    int i;
+
+    if (elemtype->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+        return asm_uniform_subarray(actx, array, idx, index, out);
+
+    reg.elements = elements;
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+    out->readonly = 1;
+
+    if (idx == NULL)
+    {
+        if ((index < 0) || (index >= array->arraylen))
+        {
+            fail(ctx, "Array index out of range");
+            return 0;
+        } // if
+        reg.regnum += index * array->stride;
+    } // if
+    else if ((actx->pixel) || (reg.regtype != REG_TYPE_CONST))
+    {
+        fail(ctx, "Arrays in pixel shaders and sampler arrays need constant indexes");
+        return 0;
+    } // else if
+    else
+    {
+        AsmOperand offset = *idx;
+        if (array->stride != 1)
+        {
+            const AsmOperand stride = asm_literal1(actx, (float) array->stride);
+            offset = asm_op(actx, ASMOP_MUL, 1, idx, &stride, NULL);
+        } // if
+
+        const AsmOperand a0 = asm_register(REG_TYPE_ADDRESS, 0, 1);
+        emit_asm(actx, ASMOP_MOVA, 0, &a0, &offset, NULL, NULL, NULL);
+
+        // copy it out now, before something else changes a0.
+        reg.relative = 1;
+        out->readonly = 0;
+        if (!ismatrix)
+        {
+            out->value = asm_mov(actx, &reg);
+            return 1;
+        } // if
+    } // else
+
+    if (!ismatrix)
+    {
+        out->value = reg;
+        return 1;
+    } // if
+
+    out->ismatrix = 1;
+    out->matrix.rows = elemtype->matrix.rows;
+    out->matrix.columns = elemtype->matrix.columns;
+    out->matrix.rowmajor = array->matrix.rowmajor;
+    for (i = 0; i < asm_register_count(ctx, elemtype, out->matrix.rowmajor); i++)
+    {
+        AsmOperand line = reg;
+        line.regnum += i;
+        line.elements = out->matrix.rowmajor ? out->matrix.columns : out->matrix.rows;
+        out->matrix.lines[i] = reg.relative ? asm_mov(actx, &line) : line;
+    } // for
+
+    return 1;
+} // asm_uniform_element
+
+// Reads element (index) of a local array, or element (idx) if that isn't
+//  NULL. There's no indexing temp registers, so a variable index picks
+//  through every element.
+static int asm_local_element(AsmContext *actx, const AsmSlot *array,
+                             const AsmOperand *idx, const int index,
+                             AsmSlot *out)
+{
+    int i;
+
+    if (idx == NULL)
+    {
+        if ((index < 0) || (index >= array->arraylen))
+        {
+            fail(actx->ctx, "Array index out of range");
+            return 0;
+        } // if
+        *out = array->members[index];
+        return 1;
+    } // if
+
+    // out-of-range indexes get element zero.
+    *out = array->members[0];
+    for (i = 1; i < array->arraylen; i++)
+    {
+        const AsmOperand k = asm_literal1(actx, (float) i);
+        AsmPredicate match;
+        match.always = 0;
+        match.value = asm_compare(actx, MOJOSHADER_IR_COND_EQL, idx, &k);
+        if (!asm_store_slot(actx, &match, out, array->elemtype, &array->members[i]))
+            return 0;
+    } // for
+
+    return 1;
+} // asm_local_element
+
+// Reads an element of an array of structs, which keeps an array per member
+//  (see asm_read_variable()), so it's an element from each of those.
+static int asm_struct_element(AsmContext *actx, const AsmSlot *array,
+                              const AsmOperand *idx, const int index,
+                              AsmSlot *out)
+{
+    const int count = array->structtype->structure.member_count;
+    int i;
+
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+    out->structtype = array->structtype;
+    out->members = (AsmSlot *) new_asm_array(actx, count, sizeof (AsmSlot));
+    if (out->members == NULL)
+        return 0;
+
+    for (i = 0; i < count; i++)
+    {
+        const AsmSlot *member = &array->members[i];
+        if (member->structtype != NULL)  // a struct in the struct.
+        {
+            if (!asm_struct_element(actx, member, idx, index, &out->members[i]))
+                return 0;
+        } // if
+        else if (member->members != NULL)
+        {
+            if (!asm_local_element(actx, member, idx, index, &out->members[i]))
+                return 0;
+        } // else if
+        else if (!asm_uniform_element(actx, member, idx, index, &out->members[i]))
+            return 0;
+    } // for
+
+    return 1;
+} // asm_struct_element
+
+// A component of a vector, or a row of a matrix, at a constant index.
+static int asm_vector_element(AsmContext *actx, const AsmSlot *base,
+                              const int index, AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    AsmOperand comps[4];
+    int i;
+
+    if (!base->ismatrix)  // a component of a vector.
+    {
+        if ((index < 0) || (index >= base->value.elements))
+        {
+            fail(ctx, "Array index out of range");
+            return 0;
+        } // if
+        const AsmOperand value = asm_component(&base->value, index);
+        asm_vector_slot(&value, out);
+        return 1;
+    } // if
+
+    // a row of a matrix.
+    const AsmMatrix *m = &base->matrix;
+    if ((index < 0) || (index >= m->rows))
+    {
+        fail(ctx, "Array index out of range");
+        return 0;
+    } // if
+
+    if (m->rowmajor)
+        asm_vector_slot(&m->lines[index], out);
+    else
+    {
+        for (i = 0; i < m->columns; i++)
+            comps[i] = asm_component(&m->lines[i], index);
+        const AsmOperand value = asm_gather(actx, comps, m->columns);
+        asm_vector_slot(&value, out);
+    } // else
+
+    return 1;
+} // asm_vector_element
+
+static int asm_array_expr(AsmContext *actx, AsmFrame *frame,
+                          const AsmPredicate *pred,
+                          const MOJOSHADER_irArray *array, AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    AsmSlot base;
+    AsmSlot line;
+    AsmOperand idx;
+    int index = 0;
+    int i;
+
+    if (!asm_expr(actx, frame, pred, array->array, &base))
+        return 0;
+    else if (base.arraylen > 0)
+    {
+        const AsmOperand *element = NULL;
+        if (!asm_constant_index(array->element, &index))
+        {
+            if (!asm_vector_expr(actx, frame, pred, array->element, &idx))
+                return 0;
+            element = &idx;
+        } // if
+
+        if (base.structtype != NULL)
+            return asm_struct_element(actx, &base, element, index, out);
+        else if (base.members != NULL)
+            return asm_local_element(actx, &base, element, index, out);
+        return asm_uniform_element(actx, &base, element, index, out);
+    } // else if
+    else if (base.structtype != NULL)
+    {
+        // a member of a struct value, by number (see build_ir_derefstruct()).
+        if ( (!asm_constant_index(array->element, &index)) || (index < 0) ||
+             (index >= base.structtype->structure.member_count) )
+        {
+            fail(ctx, "Internal error: bad struct member");
+            return 0;
+        } // if
+        *out = base.members[index];
+        return 1;
+    } // else if
+    else if (base.members != NULL)
+    {
+        fail(ctx, "Internal error: struct used as an array");
+        return 0;
+    } // else if
+    else if (asm_constant_index(array->element, &index))
+        return asm_vector_element(actx, &base, index, out);
+    else if (!asm_vector_expr(actx, frame, pred, array->element, &idx))
+        return 0;
+
+    // Registers can't be indexed by component, so pick each one in turn,
+    //  like asm_local_element() does. Out-of-range indexes get element zero.
+    const int count = base.ismatrix ? base.matrix.rows : base.value.elements;
+    if (!asm_vector_element(actx, &base, 0, out))
+        return 0;
+
+    for (i = 1; i < count; i++)
+    {
+        const AsmOperand k = asm_literal1(actx, (float) i);
+        AsmPredicate match;
+        match.always = 0;
+        match.value = asm_compare(actx, MOJOSHADER_IR_COND_EQL, &idx, &k);
+        if (!asm_vector_element(actx, &base, i, &line))
+            return 0;
+        else if (!asm_store_slot(actx, &match, out, NULL, &line))
+            return 0;
+    } // for
+
+    return 1;
+} // asm_array_expr
+
+static int asm_expr(AsmContext *actx, AsmFrame *frame,
+                    const AsmPredicate *pred,
+                    const MOJOSHADER_irExpression *expr, AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    float values[4];
+    int i;
+
+    if (isfail(ctx))
+        return 0;
+
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_CONSTANT:
+        {
+            const int count = expr->info.elements;
+            if (count <= 4)
+            {
+                for (i = 0; i < count; i++)
+                    values[i] = asm_constant_value(&expr->constant, i);
+                const AsmOperand value = asm_literal(actx, values, count);
+                asm_vector_slot(&value, out);
+            } // if
+            else
+            {
+                AsmOperand comps[16];
+                for (i = 0; (i < count) && (i < 16); i++)
+                {
+                    const float val = asm_constant_value(&expr->constant, i);
+                    comps[i] = asm_literal1(actx, val);
+                } // for
+                asm_flat_value(actx, comps, i, out);
+            } // else
+            return 1;
+        } // case
+
+        case MOJOSHADER_IR_TEMP:
+        case MOJOSHADER_IR_MEMORY:
+            return asm_read_variable(actx, frame, expr, out);
+
+        case MOJOSHADER_IR_SWIZZLE:
+        {
+            AsmOperand value;
+            int comps[4];
+            if (!asm_vector_expr(actx, frame, pred, expr->swizzle.expr, &value))
+                return 0;
+            for (i = 0; i < expr->info.elements; i++)
+                comps[i] = expr->swizzle.channels[i];
+            value = asm_swizzle(&value, comps, expr->info.elements);
+            asm_vector_slot(&value, out);
+            return 1;
+        } // case
+
+        case MOJOSHADER_IR_BINOP:
+            return asm_binop_expr(actx, frame, pred, &expr->binop, out);
+
+        case MOJOSHADER_IR_CONVERT:
+            return asm_convert_expr(actx, frame, pred, &expr->convert, out);
+
+        case MOJOSHADER_IR_CONSTRUCT:
+            return asm_construct_expr(actx, frame, pred, &expr->construct, out);
+
+        case MOJOSHADER_IR_ARRAY:
+            return asm_array_expr(actx, frame, pred, &expr->array, out);
+
+        case MOJOSHADER_IR_SELECT:
+            return asm_select_expr(actx, frame, pred, &expr->select, out);
+
+        case MOJOSHADER_IR_CALL:
+            if (expr->call.index < 0)
+                return asm_intrinsic(actx, frame, pred, &expr->call, out);
+            return asm_call(actx, frame, pred, &expr->call, out);
+
+        default: break;
+    } // switch
+
+    // optimize_ir() should have pulled all the ESEQs out into statements.
+    fail(ctx, "Internal error: unexpected IR node in code generation");
+    return 0;
+} // asm_expr
+
+
+// Stores...
+
+// A copy of a uniform array is just its registers; this gives it a slot per
+//  element in (members), like a local array's.
+static int asm_uniform_copy_elements(AsmContext *actx, const AsmSlot *array,
+                                     AsmSlot *members)
+{
+    int i;
+    for (i = 0; i < array->arraylen; i++)
+    {
+        if (!asm_uniform_element(actx, array, NULL, i, &members[i]))
+            return 0;
+        members[i].readonly = 0;
+    } // for
+    return 1;
+} // asm_uniform_copy_elements
+
+// (value) if this code runs, (old) if it doesn't.
+static AsmOperand asm_predicated(AsmContext *actx, const AsmPredicate *pred,
+                                 const AsmOperand *value, const AsmOperand *old)
+{
+    const int elements = (value->elements > old->elements) ? value->elements : old->elements;
+    if (actx->pixel)
+    {
+        const AsmOperand negp = asm_negate(&pred->value);
+        return asm_op(actx, ASMOP_CMP, elements, &negp, old, value);
+    } // if
+    return asm_op(actx, ASMOP_LRP, elements, &pred->value, value, old);
+} // asm_predicated
+
+// Replaces what's in (slot) with (value), which fits (dt) if it isn't NULL.
+static int asm_store_slot(AsmContext *actx, const AsmPredicate *pred,
+                          AsmSlot *slot, const MOJOSHADER_astDataType *dt,
+                          const AsmSlot *value)
+{
+    AsmSlot newval;
+    int i;
+
+    if (slot->readonly)
+    {
+        fail(actx->ctx, "Uniforms can't be assigned to");
+        return 0;
+    } // if
+
+    if ((dt == NULL) && (value->structtype != NULL))
+        dt = value->structtype;
+
+    if (dt == NULL)
+        newval = *value;
+    else if (!asm_convert_value(actx, value, dt, &newval))
+        return 0;
+
+    newval.readonly = 0;
+    newval.defined = 1;
+
+    // Nothing to keep? Then the new value just takes over. Variables that
+    //  aren't written on every path are undefined on the others anyhow.
+    if ((pred->always) || (!slot->defined))
+    {
+        *slot = newval;
+        return 1;
+    } // if
+
+    // blending a copy of a uniform array needs it one element at a time.
+    if ((newval.arraylen > 0) && (newval.members == NULL))
+    {
+        AsmSlot *elems = (AsmSlot *) new_asm_array(actx, newval.arraylen, sizeof (AsmSlot));
+        if ((elems == NULL) || (!asm_uniform_copy_elements(actx, &newval, elems)))
+            return 0;
+        newval.members = elems;
+    } // if
+    if ((slot->arraylen > 0) && (slot->members == NULL))
+    {
+        AsmSlot *elems = (AsmSlot *) new_asm_array(actx, slot->arraylen, sizeof (AsmSlot));
+        if ((elems == NULL) || (!asm_uniform_copy_elements(actx, slot, elems)))
+            return 0;
+        slot->members = elems;
+    } // if
+
+    if (newval.members != NULL)
+    {
+        // struct members or array elements, one at a time.
+        const int isarray = (newval.structtype == NULL);
+        const int count = isarray ? newval.arraylen : newval.structtype->structure.member_count;
+        AsmSlot *members = (AsmSlot *) new_asm_array(actx, count, sizeof (AsmSlot));
+        if ((members == NULL) || (slot->members == NULL))
+            return 0;
+        for (i = 0; i < count; i++)
+        {
+            // an array of structs has an array per member; those know their own types.
+            const MOJOSHADER_astDataType *mdt = isarray ? newval.elemtype : newval.structtype->structure.members[i].datatype;
+            if ((!isarray) && (newval.arraylen > 0))
+                mdt = NULL;
+            members[i] = slot->members[i];
+            if (!asm_store_slot(actx, pred, &members[i], mdt, &newval.members[i]))
+                return 0;
+        } // for
+        slot->members = members;
+        return 1;
+    } // if
+
+    else if (newval.ismatrix)
+    {
+        AsmSlot reshaped;
+        const AsmMatrix *m = &slot->matrix;
+        if (!asm_reshape_matrix(actx, &newval, m->rows, m->columns, m->rowmajor, &reshaped))
+            return 0;
+        const int lines = m->rowmajor ? m->rows : m->columns;
+        for (i = 0; i < lines; i++)
+            slot->matrix.lines[i] = asm_predicated(actx, pred, &reshaped.matrix.lines[i], &m->lines[i]);
+        return 1;
+    } // else if
+
+    slot->value = asm_predicated(actx, pred, &newval.value, &slot->value);
+    return 1;
+} // asm_store_slot
+
+// Where an assignment goes: some channels of a variable, or of one line of
+//  a matrix variable.
+typedef struct AsmLvalue
+{
+    AsmSlot *slot;
+    const MOJOSHADER_astDataType *datatype;  // NULL for temps.
+    int whole;  // non-zero if the whole variable gets replaced.
+    int line;  // row of a matrix, or -1.
+    int width;  // components in the variable (or row).
+    int chans[4];  // where each component of the value goes.
+    int count;
+} AsmLvalue;
+
+// Gets a local array ready to have element (index) replaced. Other slots
+//  might share its elements from an earlier copy, so it gets its own.
+static int asm_array_lvalue(AsmContext *actx, AsmSlot *slot,
+                            const MOJOSHADER_astDataType *dt, const int index)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *elemtype = asm_reduce(ctx, dt->array.base);
+    AsmSlot *members;
+
+    if (slot->readonly)
+    {
+        fail(ctx, "Uniforms can't be assigned to");
+        return 0;
+    } // if
+    else if (elemtype->type == MOJOSHADER_AST_DATATYPE_STRUCT)
+    {
+        fail(ctx, "Internal error: array of structs isn't an array per member");
+        return 0;
+    } // else if
+    else if (!slot->defined)
+        asm_zero_slot(actx, dt, 1, slot);
+
+    if ((index < 0) || (index >= slot->arraylen))
+    {
+        fail(ctx, "Array index out of range");
+        return 0;
+    } // if
+
+    members = (AsmSlot *) new_asm_array(actx, slot->arraylen, sizeof (AsmSlot));
+    if (members == NULL)
+        return 0;
+    else if (slot->members != NULL)
+        memcpy(members, slot->members, sizeof (AsmSlot) * slot->arraylen);
+    else if (!asm_uniform_copy_elements(actx, slot, members))
+        return 0;
+    slot->members = members;
+    return 1;
+} // asm_array_lvalue
+
+static int asm_lvalue(AsmContext *actx, AsmFrame *frame,
+                      const MOJOSHADER_irExpression *expr, AsmLvalue *lval)
+{
+    Context *ctx = actx->ctx;
+    AsmLvalue inner;
+    int index = 0;
+    int i;
+
+    switch (expr->ir.type)
+    {
+        case MOJOSHADER_IR_TEMP:
+        case MOJOSHADER_IR_MEMORY:
+            memset(lval, '\0', sizeof (*lval));
+            lval->slot = asm_variable(actx, frame, expr, 0, &lval->datatype);
+            if (lval->slot == NULL)
+                return 0;
+            lval->whole = 1;
+            lval->line = -1;
+            lval->width = lval->count = expr->info.elements;
+            if (lval->datatype != NULL)
+                lval->width = lval->count = asm_datatype_elems(ctx, lval->datatype);
+            for (i = 0; i < 4; i++)
+                lval->chans[i] = i;
+            return 1;
+
+        case MOJOSHADER_IR_SWIZZLE:
+            if (!asm_lvalue(actx, frame, expr->swizzle.expr, &inner))
+                return 0;
+            else if ((inner.whole) && (inner.slot->ismatrix))
+                break;
+            *lval = inner;
+            lval->whole = 0;
+            lval->count = expr->info.elements;
+            for (i = 0; i < lval->count; i++)
+                lval->chans[i] = inner.chans[(int) expr->swizzle.channels[i]];
+            return 1;
+
+        case MOJOSHADER_IR_ARRAY:
+            if (!asm_constant_index(expr->array.element, &index))
+                break;
+            else if (!asm_lvalue(actx, frame, expr->array.array, &inner))
+                return 0;
+
+            *lval = inner;
+            lval->whole = 0;
+            if ( (inner.whole) && (inner.datatype != NULL) &&
+                 (inner.datatype->type == MOJOSHADER_AST_DATATYPE_MATRIX) )
+            {
+                // rows are easier to write if the matrix is row major.
+                const MOJOSHADER_astDataType *dt = inner.datatype;
+                AsmSlot *slot = inner.slot;
+                if ((index < 0) || (index >= dt->matrix.rows))
+                {
+                    fail(ctx, "Array index out of range");
+                    return 0;
+                } // if
+                else if (!slot->defined)
+                    asm_zero_slot(actx, dt, 1, slot);
+                else if (!slot->matrix.rowmajor)
+                {
+                    const AsmSlot colmajor = *slot;
+                    if (!asm_reshape_matrix(actx, &colmajor, dt->matrix.rows, dt->matrix.columns, 1, slot))
+                        return 0;
+                } // else if
+                lval->line = index;
+                lval->width = lval->count = dt->matrix.columns;
+                for (i = 0; i < 4; i++)
+                    lval->chans[i] = i;
+                return 1;
+            } // if
+
+            else if ((inner.whole) && (inner.datatype != NULL) &&
+                     (inner.datatype->type == MOJOSHADER_AST_DATATYPE_ARRAY))
+            {
+                // an element of a local array becomes the thing we write.
+                AsmSlot *slot = inner.slot;
+                if (!asm_array_lvalue(actx, slot, inner.datatype, index))
+                    return 0;
+                memset(lval, '\0', sizeof (*lval));
+                lval->slot = &slot->members[index];
+                lval->datatype = slot->elemtype;
+                lval->whole = 1;
+                lval->line = -1;
+                lval->width = lval->count = asm_datatype_elems(ctx, slot->elemtype);
+                for (i = 0; i < 4; i++)
+                    lval->chans[i] = i;
+                return 1;
+            } // else if
+            else if ((index < 0) || (index >= inner.count))
+            {
+                fail(ctx, "Array index out of range");
+                return 0;
+            } // else if
+
+            lval->count = 1;
+            lval->chans[0] = inner.chans[index];
+            return 1;
+
+        default: break;
+    } // switch
+
+    // (variable indexes went through asm_store_part() instead.)
+    fail(ctx, "Only variables, and parts of them, can be assigned to");
+    return 0;
+} // asm_lvalue
+
+static int asm_is_array_variable(AsmContext *actx, AsmFrame *frame,
+                                 const MOJOSHADER_irExpression *expr)
+{
+    const MOJOSHADER_astDataType *dt = NULL;
+    if (expr->ir.type != MOJOSHADER_IR_MEMORY)
+        return 0;
+    else if (asm_variable(actx, frame, expr, 0, &dt) == NULL)
+        return 0;
+    return ((dt != NULL) && (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY));
+} // asm_is_array_variable
+
+// Stores to element (idx) of local array (slot), a variable index: every
+//  element gets the store, predicated on the index matching.
+static int asm_store_elements(AsmContext *actx, const AsmPredicate *pred,
+                              AsmSlot *slot, const AsmOperand *idx,
+                              const AsmSlot *value)
+{
+    int i;
+    for (i = 0; i < slot->arraylen; i++)
+    {
+        const AsmOperand k = asm_literal1(actx, (float) i);
+        AsmPredicate match;
+        match.always = 0;
+        match.value = asm_compare(actx, MOJOSHADER_IR_COND_EQL, idx, &k);
+        if (!pred->always)
+            match.value = asm_op(actx, ASMOP_MUL, 1, &match.value, &pred->value, NULL);
+        if (!asm_store_slot(actx, &match, &slot->members[i], slot->elemtype, value))
+            return 0;
+    } // for
+
+    return 1;
+} // asm_store_elements
+
+// Stores to a local array element with a variable index.
+static int asm_store_element(AsmContext *actx, AsmFrame *frame,
+                             const AsmPredicate *pred,
+                             const MOJOSHADER_irArray *dst,
+                             const AsmSlot *value)
+{
+    AsmLvalue lval;
+    AsmOperand idx;
+
+    if (!asm_vector_expr(actx, frame, pred, dst->element, &idx))
+        return 0;
+    else if (!asm_lvalue(actx, frame, dst->array, &lval))
+        return 0;
+    else if ((!lval.whole) || (!asm_array_lvalue(actx, lval.slot, lval.datatype, 0)))
+    {
+        if (!isfail(actx->ctx))
+            fail(actx->ctx, "Internal error: storing an element of something that isn't an array");
+        return 0;
+    } // else if
+
+    return asm_store_elements(actx, pred, lval.slot, &idx, value);
+} // asm_store_element
+
+// Stores a whole struct in struct variable (var), or in element (idx), or
+//  (index) if that's NULL, of an array of structs; if (index) is -1 too,
+//  (value) is the whole array. Each member is a variable of its own (see
+//  datatype_member_offset()), and in an array of structs, each of those is
+//  an array.
+static int asm_store_struct(AsmContext *actx, AsmFrame *frame,
+                            const AsmPredicate *pred,
+                            const MOJOSHADER_irExpression *var,
+                            const int offset,
+                            const MOJOSHADER_astDataType *dt,
+                            const AsmOperand *idx, const int index,
+                            const AsmSlot *value)
+{
+    Context *ctx = actx->ctx;
+    int i;
+
+    if ((value->members == NULL) || (value->structtype == NULL))
+    {
+        fail(ctx, "Internal error: storing something that isn't a struct in a struct");
+        return 0;
+    } // if
+
+    for (i = 0; i < value->structtype->structure.member_count; i++)
+    {
+        const int moffset = offset + datatype_member_offset(ctx, dt, i);
+        const MOJOSHADER_astDataType *mdt = NULL;
+        AsmSlot *member = asm_variable(actx, frame, var, moffset, &mdt);
+        if (member == NULL)
+            return 0;
+        else if (asm_struct_type(ctx, mdt) != NULL)
+        {
+            if (!asm_store_struct(actx, frame, pred, var, moffset, mdt, idx, index, &value->members[i]))
+                return 0;
+        } // else if
+        else if ((idx == NULL) && (index < 0))
+        {
+            if (!asm_store_slot(actx, pred, member, mdt, &value->members[i]))
+                return 0;
+        } // else if
+        else if (!asm_array_lvalue(actx, member, mdt, (idx != NULL) ? 0 : index))
+            return 0;
+        else if (idx != NULL)
+        {
+            if (!asm_store_elements(actx, pred, member, idx, &value->members[i]))
+                return 0;
+        } // else if
+        else if (!asm_store_slot(actx, pred, &member->members[index], member->elemtype, &value->members[i]))
+            return 0;
+    } // for
+
+    return 1;
+} // asm_store_struct
+
+// Stores a whole struct in an element of an array of structs.
+static int asm_store_struct_element(AsmContext *actx, AsmFrame *frame,
+                                    const AsmPredicate *pred,
+                                    const MOJOSHADER_irArray *dst,
+                                    const AsmSlot *value)
+{
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *dt = NULL;
+    AsmOperand idx;
+    int index = 0;
+
+    if ( (dst->array->ir.type != MOJOSHADER_IR_MEMORY) ||
+         (asm_variable(actx, frame, dst->array, 0, &dt) == NULL) ||
+         (asm_struct_type(ctx, dt) == NULL) ||
+         (dt->type != MOJOSHADER_AST_DATATYPE_ARRAY) )
+    {
+        if (!isfail(ctx))
+            fail(ctx, "Internal error: storing a struct in something that isn't an array of them");
+        return 0;
+    } // if
+    else if (asm_constant_index(dst->element, &index))
+    {
+        if ((index < 0) || (index >= dt->array.elements))
+        {
+            fail(ctx, "Array index out of range");
+            return 0;
+        } // if
+        return asm_store_struct(actx, frame, pred, dst->array, 0, dt, NULL, index, value);
+    } // else if
+    else if (!asm_vector_expr(actx, frame, pred, dst->element, &idx))
+        return 0;
+    return asm_store_struct(actx, frame, pred, dst->array, 0, dt, &idx, 0, value);
+} // asm_store_struct_element
+
+// Does (expr) pick a component, row or element with a variable index
+//  anywhere along the way? asm_lvalue() can't follow those.
+static int asm_has_variable_index(const MOJOSHADER_irExpression *expr)
+{
+    int index;
+    while (1)
+    {
+        if (expr->ir.type == MOJOSHADER_IR_SWIZZLE)
+            expr = expr->swizzle.expr;
+        else if (expr->ir.type != MOJOSHADER_IR_ARRAY)
+            return 0;
+        else if (!asm_constant_index(expr->array.element, &index))
+            return 1;
+        else
+            expr = expr->array.array;
+    } // while
+} // asm_has_variable_index
+
+static int asm_store(AsmContext *actx, AsmFrame *frame,
+                     const AsmPredicate *pred,
+                     const MOJOSHADER_irExpression *dst, const AsmSlot *value);
+
+// Stores to some channels, a component or a row of a vector or matrix that
+//  asm_lvalue() can't find, because it has a variable index somewhere in
+//  it: reads the whole vector or matrix, changes that part of it, and
+//  stores it back, which might go through here again.
+static int asm_store_part(AsmContext *actx, AsmFrame *frame,
+                          const AsmPredicate *pred,
+                          const MOJOSHADER_irExpression *dst,
+                          const AsmSlot *value)
+{
+    Context *ctx = actx->ctx;
+    const int isswizzle = (dst->ir.type == MOJOSHADER_IR_SWIZZLE);
+    const MOJOSHADER_irExpression *baseexpr = isswizzle ? dst->swizzle.expr : dst->array.array;
+    AsmSlot base, whole;
+    AsmOperand idx, dstop;
+    int index = 0;
+    int i;
+
+    if (!asm_expr(actx, frame, pred, baseexpr, &base))
+        return 0;
+    else if (base.readonly)
+    {
+        fail(ctx, "Uniforms can't be assigned to");
+        return 0;
+    } // else if
+    else if ( (base.members != NULL) || (base.arraylen > 0) ||
+              (value->ismatrix) || (value->members != NULL) ||
+              ((isswizzle) && (base.ismatrix)) )
+    {
+        fail(ctx, "Internal error: partial store of a matrix or struct");
+        return 0;
+    } // else if
+
+    const int isconstant = (!isswizzle) && (asm_constant_index(dst->array.element, &index));
+    if ((!isswizzle) && (!isconstant) && (!asm_vector_expr(actx, frame, pred, dst->array.element, &idx)))
+        return 0;
+
+    if (base.ismatrix)  // a row: make the matrix row major and replace it.
+    {
+        const AsmMatrix *m = &base.matrix;
+        const AsmOperand row = asm_resize(&value->value, m->columns);
+        if (!asm_reshape_matrix(actx, &base, m->rows, m->columns, 1, &whole))
+            return 0;
+        else if ((isconstant) && ((index < 0) || (index >= m->rows)))
+        {
+            fail(ctx, "Array index out of range");
+            return 0;
+        } // else if
+        else if (isconstant)
+            whole.matrix.lines[index] = row;
+        else
+        {
+            for (i = 0; i < m->rows; i++)
+            {
+                const AsmOperand k = asm_literal1(actx, (float) i);
+                AsmPredicate match;
+                match.always = 0;
+                match.value = asm_compare(actx, MOJOSHADER_IR_COND_EQL, &idx, &k);
+                whole.matrix.lines[i] = asm_predicated(actx, &match, &row, &whole.matrix.lines[i]);
+            } // for
+        } // else
+        return asm_store(actx, frame, pred, baseexpr, &whole);
+    } // if
+
+    const int count = base.value.elements;
+    if (isswizzle)  // some channels: copy the rest, then write these.
+    {
+        const AsmOperand newval = asm_resize(&value->value, dst->info.elements);
+        const AsmOperand result = asm_mov(actx, &base.value);
+        dstop = result;
+        dstop.elements = dst->info.elements;
+        for (i = 0; i < dstop.elements; i++)
+            dstop.swizzle[i] = dst->swizzle.channels[i];
+        emit_asm(actx, ASMOP_MOV, 0, &dstop, &newval, NULL, NULL, NULL);
+        asm_vector_slot(&result, &whole);
+    } // if
+    else if (isconstant)  // a component.
+    {
+        if ((index < 0) || (index >= count))
+        {
+            fail(ctx, "Array index out of range");
+            return 0;
+        } // if
+        const AsmOperand newval = asm_resize(&value->value, 1);
+        const AsmOperand result = asm_mov(actx, &base.value);
+        dstop = asm_component(&result, index);
+        emit_asm(actx, ASMOP_MOV, 0, &dstop, &newval, NULL, NULL, NULL);
+        asm_vector_slot(&result, &whole);
+    } // else if
+    else
+    {
+        // registers can't be indexed by component: compare the index to
+        //  all of them at once, and take the new value where it matches.
+        static const float counting[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+        const AsmOperand k = asm_literal(actx, counting, count);
+        const AsmOperand idxs = asm_resize(&idx, count);
+        const AsmOperand newval = asm_resize(&value->value, count);
+        AsmPredicate match;
+        match.always = 0;
+        match.value = asm_compare(actx, MOJOSHADER_IR_COND_EQL, &idxs, &k);
+        const AsmOperand result = asm_predicated(actx, &match, &newval, &base.value);
+        asm_vector_slot(&result, &whole);
+    } // else
+
+    return asm_store(actx, frame, pred, baseexpr, &whole);
+} // asm_store_part
+
+static int asm_store(AsmContext *actx, AsmFrame *frame,
+                     const AsmPredicate *pred,
+                     const MOJOSHADER_irExpression *dst, const AsmSlot *value)
+{
+    Context *ctx = actx->ctx;
+    AsmLvalue lval;
+    int i;
+
+    if ( (dst->ir.type == MOJOSHADER_IR_MEMORY) &&
+         (dst->info.type == MOJOSHADER_AST_DATATYPE_STRUCT) )
+    {
+        // struct variables are one variable per member.
+        const MOJOSHADER_astDataType *dt = NULL;
+        if (asm_variable(actx, frame, dst, 0, &dt) == NULL)
+            return 0;
+        else if (asm_struct_type(ctx, dt) == NULL)
+        {
+            fail(ctx, "Internal error: storing a struct in something that isn't one");
+            return 0;
+        } // else if
+        return asm_store_struct(actx, frame, pred, dst, 0, dt, NULL, -1, value);
+    } // if
+
+    if ( (dst->ir.type == MOJOSHADER_IR_ARRAY) &&
+         (dst->info.type == MOJOSHADER_AST_DATATYPE_STRUCT) )
+        return asm_store_struct_element(actx, frame, pred, &dst->array, value);
+
+    if ( (dst->ir.type == MOJOSHADER_IR_ARRAY) &&
+         (!asm_constant_index(dst->array.element, &i)) &&
+         (asm_is_array_variable(actx, frame, dst->array.array)) )
+        return asm_store_element(actx, frame, pred, &dst->array, value);
+
+    else if ( ((dst->ir.type == MOJOSHADER_IR_SWIZZLE) && (asm_has_variable_index(dst->swizzle.expr))) ||
+              ((dst->ir.type == MOJOSHADER_IR_ARRAY) && (asm_has_variable_index(dst))) )
+        return asm_store_part(actx, frame, pred, dst, value);
+
+    if (!asm_lvalue(actx, frame, dst, &lval))
+        return 0;
+    else if (lval.whole)
+        return asm_store_slot(actx, pred, lval.slot, lval.datatype, value);
+    else if (lval.slot->readonly)
+    {
+        fail(ctx, "Uniforms can't be assigned to");
+        return 0;
+    } // else if
+    else if ((value->ismatrix) || (value->members != NULL))
+    {
+        fail(ctx, "Internal error: partial store of a matrix or struct");
+        return 0;
+    } // else if
+
+    // A write to some channels: copy the rest, then write these.
+    AsmSlot *slot = lval.slot;
+    if (!slot->defined)
+        asm_zero_slot(actx, lval.datatype, lval.width, slot);
+
+    const AsmOperand old = (lval.line >= 0) ? slot->matrix.lines[lval.line] : slot->value;
+    const AsmOperand newval = asm_resize(&value->value, lval.count);
+    AsmOperand result = asm_mov(actx, &old);
+    AsmOperand dstop = result;
+    dstop.elements = lval.count;
+    memcpy(dstop.swizzle, lval.chans, sizeof (dstop.swizzle));
+
+    if (pred->always)
+        emit_asm(actx, ASMOP_MOV, 0, &dstop, &newval, NULL, NULL, NULL);
+    else
+    {
+        const AsmOperand oldchans = asm_swizzle(&old, lval.chans, lval.count);
+        if (actx->pixel)
+        {
+            const AsmOperand negp = asm_negate(&pred->value);
+            emit_asm(actx, ASMOP_CMP, 0, &dstop, &negp, &oldchans, &newval, NULL);
+        } // if
+        else
+        {
+            emit_asm(actx, ASMOP_LRP, 0, &dstop, &pred->value, &newval, &oldchans, NULL);
+        } // else
+    } // else
+
+    if (lval.line >= 0)
+        slot->matrix.lines[lval.line] = result;
+    else
+        slot->value = result;
+    slot->defined = 1;
+    return 1;
+} // asm_store
+
+
+// Intrinsics...
+
+// sin and cos for one component: (x) is cos, (y) is sin.
+static AsmOperand asm_sincos(AsmContext *actx, const AsmOperand *x)
+{
+    // sincos wants -pi to pi, so wrap it around to that first.
+    static const float sm2consts1[4] = { -1.5500992e-006f, -2.1701389e-005f, 0.0026041667f, 0.00026041668f };
+    static const float sm2consts2[4] = { -0.020833334f, -0.125f, 1.0f, 0.5f };
+    const AsmOperand invtwopi = asm_literal1(actx, 0.15915494f);
+    const AsmOperand half = asm_literal1(actx, 0.5f);
+    const AsmOperand twopi = asm_literal1(actx, 6.2831855f);
+    const AsmOperand negpi = asm_literal1(actx, -3.1415927f);
+    AsmOperand t = asm_op(actx, ASMOP_MAD, 1, x, &invtwopi, &half);
+    t = asm_op(actx, ASMOP_FRC, 1, &t, NULL, NULL);
+    t = asm_op(actx, ASMOP_MAD, 1, &t, &twopi, &negpi);
+
+    const AsmOperand retval = new_asm_vreg(actx, 2);
+    if (actx->major >= 3)
+        emit_asm(actx, ASMOP_SINCOS, 0, &retval, &t, NULL, NULL, NULL);
+    else
+    {
+        const AsmOperand c1 = asm_literal4(actx, sm2consts1);
+        const AsmOperand c2 = asm_literal4(actx, sm2consts2);
+        emit_asm(actx, ASMOP_SINCOS, 0, &retval, &t, &c1, &c2, NULL);
+    } // else
+    return retval;
+} // asm_sincos
+
+// sin (which == 1) or cos (which == 0) of each component.
+static AsmOperand asm_sin_or_cos(AsmContext *actx, const AsmOperand *x,
+                                 const int which)
+{
+    AsmOperand comps[4];
+    int i;
+    for (i = 0; i < x->elements; i++)
+    {
+        const AsmOperand xi = asm_component(x, i);
+        const AsmOperand sc = asm_sincos(actx, &xi);
+        comps[i] = asm_component(&sc, which);
+    } // for
+    return asm_gather(actx, comps, x->elements);
+} // asm_sin_or_cos
+
+static AsmOperand asm_length(AsmContext *actx, const AsmOperand *x)
+{
+    const AsmOperand d = asm_dot(actx, x, x, x->elements);
+    const AsmOperand r = asm_op(actx, ASMOP_RSQ, 1, &d, NULL, NULL);
+    return asm_op(actx, ASMOP_RCP, 1, &r, NULL, NULL);
+} // asm_length
+
+// (x >= 0) ? y : -y, for each component.
+static inline AsmOperand asm_copysign(AsmContext *actx, const AsmOperand *x,
+                                      const AsmOperand *y)
+{
+    const AsmOperand negy = asm_negate(y);
+    return asm_select_ge(actx, x, y, &negy);
+} // asm_copysign
+
+// (x >= 0) ? y : (k - y), for each component; the arc functions use this
+//  to fold their results around pi/2 or pi.
+static AsmOperand asm_reflect_unless(AsmContext *actx, const AsmOperand *x,
+                                     const AsmOperand *y, const float k)
+{
+    const AsmOperand kop = asm_literal1(actx, k);
+    const AsmOperand negy = asm_negate(y);
+    const AsmOperand other = asm_op(actx, ASMOP_ADD, y->elements, &negy, &kop, NULL);
+    return asm_select_ge(actx, x, y, &other);
+} // asm_reflect_unless
+
+// acos(|x|), from Abramowitz and Stegun 4.4.45; it's off by 7e-5 at most.
+static AsmOperand asm_acos_abs(AsmContext *actx, const AsmOperand *ax)
+{
+    const int elements = ax->elements;
+    const AsmOperand c3 = asm_literal1(actx, -0.0187293f);
+    const AsmOperand c2 = asm_literal1(actx, 0.0742610f);
+    const AsmOperand c1 = asm_literal1(actx, -0.2121144f);
+    const AsmOperand c0 = asm_literal1(actx, 1.5707288f);
+    const AsmOperand one = asm_one(actx);
+    const AsmOperand negax = asm_negate(ax);
+    AsmOperand p = asm_op(actx, ASMOP_MAD, elements, ax, &c3, &c2);
+    p = asm_op(actx, ASMOP_MAD, elements, &p, ax, &c1);
+    p = asm_op(actx, ASMOP_MAD, elements, &p, ax, &c0);
+    AsmOperand t = asm_op(actx, ASMOP_ADD, elements, &negax, &one, NULL);
+    t = asm_scalar_op(actx, ASMOP_RSQ, &t, NULL);
+    t = asm_scalar_op(actx, ASMOP_RCP, &t, NULL);
+    return asm_op(actx, ASMOP_MUL, elements, &p, &t, NULL);
+} // asm_acos_abs
+
+// atan(small / big) for 0 <= small <= big, from Abramowitz and Stegun
+//  4.4.49; it's off by 1e-5 at most. (big) can't be less than a tiny
+//  constant, so atan2(0, 0) comes out as zero.
+static AsmOperand asm_atan_ratio(AsmContext *actx, const AsmOperand *small,
+                                 const AsmOperand *big)
+{
+    static const float coefficients[] = {
+        0.0208351f, -0.0851330f, 0.1801410f, -0.3302995f, 0.9998660f
+    };
+    const int elements = small->elements;
+    const AsmOperand tiny = asm_literal1(actx, 1.0e-20f);
+    AsmOperand a = asm_op(actx, ASMOP_MAX, elements, big, &tiny, NULL);
+    a = asm_scalar_op(actx, ASMOP_RCP, &a, NULL);
+    a = asm_op(actx, ASMOP_MUL, elements, small, &a, NULL);
+    const AsmOperand s = asm_op(actx, ASMOP_MUL, elements, &a, &a, NULL);
+    const AsmOperand c0 = asm_literal1(actx, coefficients[0]);
+    const AsmOperand c1 = asm_literal1(actx, coefficients[1]);
+    AsmOperand p = asm_op(actx, ASMOP_MAD, elements, &s, &c0, &c1);
+    size_t i;
+    for (i = 2; i < STATICARRAYLEN(coefficients); i++)
+    {
+        const AsmOperand c = asm_literal1(actx, coefficients[i]);
+        p = asm_op(actx, ASMOP_MAD, elements, &p, &s, &c);
+    } // for
+    return asm_op(actx, ASMOP_MUL, elements, &p, &a, NULL);
+} // asm_atan_ratio
+
+// e^(scale * x), for each component.
+static AsmOperand asm_exp_e(AsmContext *actx, const AsmOperand *x,
+                            const float scale)
+{
+    const AsmOperand k = asm_literal1(actx, scale * 1.442695f);  // log2(e)
+    const AsmOperand t = asm_op(actx, ASMOP_MUL, x->elements, x, &k, NULL);
+    return asm_scalar_op(actx, ASMOP_EXP, &t, NULL);
+} // asm_exp_e
+
+// 1.0 where a component is NaN, 0.0 elsewhere. NaN is the only thing that's
+//  neither >= 0 nor <= 0. This and the other classifications count on the
+//  hardware following IEEE rules for NaN and infinity, which D3D9 doesn't
+//  promise.
+static AsmOperand asm_isnan(AsmContext *actx, const AsmOperand *x)
+{
+    const AsmOperand zero = asm_zero(actx);
+    const AsmOperand one = asm_one(actx);
+    const AsmOperand negx = asm_negate(x);
+    const AsmOperand t = asm_select_ge(actx, &negx, &zero, &one);
+    return asm_select_ge(actx, x, &zero, &t);
+} // asm_isnan
+
+// x - x is zero, unless x is infinite or NaN, and NaN isn't >= 0.
+static AsmOperand asm_isfinite(AsmContext *actx, const AsmOperand *x)
+{
+    const AsmOperand zero = asm_zero(actx);
+    const AsmOperand one = asm_one(actx);
+    const AsmOperand d = asm_op(actx, ASMOP_SUB, x->elements, x, x, NULL);
+    return asm_select_ge(actx, &d, &one, &zero);
+} // asm_isfinite
+
+// Intrinsics that work on each component by itself. These work on matrices
+//  a line at a time. Returns zero if (name) isn't one of these.
+static int asm_componentwise(AsmContext *actx, const char *name,
+                             const AsmOperand *args, const int argc,
+                             const int elements, AsmOperand *out)
+{
+    Context *ctx = actx->ctx;
+    const AsmOperand *a = &args[0];
+    const AsmOperand *b = (argc > 1) ? &args[1] : NULL;
+    const AsmOperand *c = (argc > 2) ? &args[2] : NULL;
+    AsmOperand t, u;
+
+    if (strcmp(name, "abs") == 0)
+        *out = asm_op(actx, ASMOP_ABS, elements, a, NULL, NULL);
+    else if (strcmp(name, "min") == 0)
+        *out = asm_op(actx, ASMOP_MIN, elements, a, b, NULL);
+    else if (strcmp(name, "max") == 0)
+        *out = asm_op(actx, ASMOP_MAX, elements, a, b, NULL);
+    else if (strcmp(name, "clamp") == 0)
+    {
+        t = asm_op(actx, ASMOP_MAX, elements, a, b, NULL);
+        *out = asm_op(actx, ASMOP_MIN, elements, &t, c, NULL);
+    } // else if
+    else if (strcmp(name, "saturate") == 0)
+    {
+        *out = new_asm_vreg(actx, elements);
+        emit_asm(actx, ASMOP_MOV, 1, out, a, NULL, NULL, NULL);
+    } // else if
+    else if (strcmp(name, "lerp") == 0)
+        *out = asm_op(actx, ASMOP_LRP, elements, c, b, a);
+    else if (strcmp(name, "frac") == 0)
+        *out = asm_op(actx, ASMOP_FRC, elements, a, NULL, NULL);
+    else if (strcmp(name, "floor") == 0)
+        *out = asm_floor(actx, a);
+    else if (strcmp(name, "ceil") == 0)
+    {
+        const AsmOperand nega = asm_negate(a);
+        t = asm_op(actx, ASMOP_FRC, elements, &nega, NULL, NULL);
+        *out = asm_op(actx, ASMOP_ADD, elements, a, &t, NULL);
+    } // else if
+    else if (strcmp(name, "round") == 0)
+    {
+        // !!! FIXME: HLSL rounds halves to even; this rounds them up.
+        t = asm_literal1(actx, 0.5f);
+        u = asm_op(actx, ASMOP_ADD, elements, a, &t, NULL);
+        *out = asm_floor(actx, &u);
+    } // else if
+    else if (strcmp(name, "trunc") == 0)
+        *out = asm_trunc(actx, a);
+    else if (strcmp(name, "fmod") == 0)
+        *out = asm_fmod(actx, a, b, elements);
+    else if (strcmp(name, "step") == 0)
+        *out = asm_compare(actx, MOJOSHADER_IR_COND_GEQ, b, a);
+    else if (strcmp(name, "sign") == 0)
+    {
+        const AsmOperand zero = asm_zero(actx);
+        t = asm_compare(actx, MOJOSHADER_IR_COND_GT, a, &zero);
+        u = asm_compare(actx, MOJOSHADER_IR_COND_LT, a, &zero);
+        *out = asm_op(actx, ASMOP_SUB, elements, &t, &u, NULL);
+    } // else if
+    else if (strcmp(name, "smoothstep") == 0)
+    {
+        // t = saturate((x - a) / (b - a)); t * t * (3 - 2t)
+        const AsmOperand range = asm_op(actx, ASMOP_SUB, elements, b, a, NULL);
+        const AsmOperand dist = asm_op(actx, ASMOP_SUB, elements, c, a, NULL);
+        const AsmOperand r = asm_scalar_op(actx, ASMOP_RCP, &range, NULL);
+        const AsmOperand st = new_asm_vreg(actx, elements);
+        emit_asm(actx, ASMOP_MUL, 1, &st, &dist, &r, NULL, NULL);
+        const AsmOperand negtwo = asm_literal1(actx, -2.0f);
+        const AsmOperand three = asm_literal1(actx, 3.0f);
+        t = asm_op(actx, ASMOP_MAD, elements, &st, &negtwo, &three);
+        u = asm_op(actx, ASMOP_MUL, elements, &st, &st, NULL);
+        *out = asm_op(actx, ASMOP_MUL, elements, &u, &t, NULL);
+    } // else if
+    else if (strcmp(name, "degrees") == 0)
+    {
+        t = asm_literal1(actx, 57.29578f);
+        *out = asm_op(actx, ASMOP_MUL, elements, a, &t, NULL);
+    } // else if
+    else if (strcmp(name, "radians") == 0)
+    {
+        t = asm_literal1(actx, 0.017453292f);
+        *out = asm_op(actx, ASMOP_MUL, elements, a, &t, NULL);
+    } // else if
+    else if (strcmp(name, "rsqrt") == 0)
+        *out = asm_scalar_op(actx, ASMOP_RSQ, a, NULL);
+    else if (strcmp(name, "sqrt") == 0)
+    {
+        t = asm_scalar_op(actx, ASMOP_RSQ, a, NULL);
+        *out = asm_scalar_op(actx, ASMOP_RCP, &t, NULL);
+    } // else if
+    else if (strcmp(name, "exp2") == 0)
+        *out = asm_scalar_op(actx, ASMOP_EXP, a, NULL);
+    else if (strcmp(name, "exp") == 0)
+    {
+        t = asm_literal1(actx, 1.442695f);  // log2(e)
+        u = asm_op(actx, ASMOP_MUL, elements, a, &t, NULL);
+        *out = asm_scalar_op(actx, ASMOP_EXP, &u, NULL);
+    } // else if
+    else if (strcmp(name, "log2") == 0)
+        *out = asm_scalar_op(actx, ASMOP_LOG, a, NULL);
+    else if ((strcmp(name, "log") == 0) || (strcmp(name, "log10") == 0))
+    {
+        t = asm_literal1(actx, (name[3] == '1') ? 0.30103f : 0.6931472f);  // log10(2) or ln(2)
+        u = asm_scalar_op(actx, ASMOP_LOG, a, NULL);
+        *out = asm_op(actx, ASMOP_MUL, elements, &u, &t, NULL);
+    } // else if
+    else if (strcmp(name, "pow") == 0)
+        *out = asm_scalar_op(actx, ASMOP_POW, a, b);
+    else if (strcmp(name, "sin") == 0)
+        *out = asm_sin_or_cos(actx, a, 1);
+    else if (strcmp(name, "cos") == 0)
+        *out = asm_sin_or_cos(actx, a, 0);
+    else if (strcmp(name, "tan") == 0)
+    {
+        t = asm_sin_or_cos(actx, a, 1);
+        u = asm_sin_or_cos(actx, a, 0);
+        u = asm_scalar_op(actx, ASMOP_RCP, &u, NULL);
+        *out = asm_op(actx, ASMOP_MUL, elements, &t, &u, NULL);
+    } // else if
+    else if ((strcmp(name, "acos") == 0) || (strcmp(name, "asin") == 0))
+    {
+        // acos(-x) is pi - acos(x); asin(x) is pi/2 - acos(x).
+        t = asm_op(actx, ASMOP_ABS, elements, a, NULL, NULL);
+        t = asm_acos_abs(actx, &t);
+        if (name[1] == 'c')
+            *out = asm_reflect_unless(actx, a, &t, 3.1415927f);
+        else
+        {
+            const AsmOperand halfpi = asm_literal1(actx, 1.5707964f);
+            const AsmOperand negt = asm_negate(&t);
+            u = asm_op(actx, ASMOP_ADD, elements, &negt, &halfpi, NULL);
+            *out = asm_copysign(actx, a, &u);
+        } // else
+    } // else if
+    else if (strcmp(name, "atan") == 0)
+    {
+        // atan(x) is pi/2 - atan(1/x), so work with whichever is <= 1.
+        const AsmOperand one = asm_one(actx);
+        const AsmOperand ax = asm_op(actx, ASMOP_ABS, elements, a, NULL, NULL);
+        const AsmOperand negax = asm_negate(&ax);
+        const AsmOperand small = asm_op(actx, ASMOP_MIN, elements, &ax, &one, NULL);
+        const AsmOperand big = asm_op(actx, ASMOP_MAX, elements, &ax, &one, NULL);
+        const AsmOperand le1 = asm_op(actx, ASMOP_ADD, elements, &negax, &one, NULL);
+        t = asm_atan_ratio(actx, &small, &big);
+        t = asm_reflect_unless(actx, &le1, &t, 1.5707964f);
+        *out = asm_copysign(actx, a, &t);
+    } // else if
+    else if (strcmp(name, "atan2") == 0)
+    {
+        // atan(|y| / |x|) or atan(|x| / |y|), whichever is <= 1, then
+        //  move it into the right quadrant.
+        const AsmOperand ay = asm_op(actx, ASMOP_ABS, elements, a, NULL, NULL);
+        const AsmOperand ax = asm_op(actx, ASMOP_ABS, elements, b, NULL, NULL);
+        const AsmOperand negay = asm_negate(&ay);
+        const AsmOperand small = asm_op(actx, ASMOP_MIN, elements, &ax, &ay, NULL);
+        const AsmOperand big = asm_op(actx, ASMOP_MAX, elements, &ax, &ay, NULL);
+        const AsmOperand xbigger = asm_op(actx, ASMOP_ADD, elements, &ax, &negay, NULL);
+        t = asm_atan_ratio(actx, &small, &big);
+        t = asm_reflect_unless(actx, &xbigger, &t, 1.5707964f);
+        t = asm_reflect_unless(actx, b, &t, 3.1415927f);
+        *out = asm_copysign(actx, a, &t);
+    } // else if
+    else if ((strcmp(name, "sinh") == 0) || (strcmp(name, "cosh") == 0))
+    {
+        const AsmOperand half = asm_literal1(actx, 0.5f);
+        t = asm_exp_e(actx, a, 1.0f);
+        u = asm_scalar_op(actx, ASMOP_RCP, &t, NULL);
+        u = asm_op(actx, (name[0] == 's') ? ASMOP_SUB : ASMOP_ADD, elements, &t, &u, NULL);
+        *out = asm_op(actx, ASMOP_MUL, elements, &u, &half, NULL);
+    } // else if
+    else if (strcmp(name, "tanh") == 0)
+    {
+        // 1 - 2 / (e^2x + 1), which doesn't overflow to inf / inf.
+        const AsmOperand one = asm_one(actx);
+        const AsmOperand negtwo = asm_literal1(actx, -2.0f);
+        t = asm_exp_e(actx, a, 2.0f);
+        t = asm_op(actx, ASMOP_ADD, elements, &t, &one, NULL);
+        t = asm_scalar_op(actx, ASMOP_RCP, &t, NULL);
+        *out = asm_op(actx, ASMOP_MAD, elements, &t, &negtwo, &one);
+    } // else if
+    else if (strcmp(name, "ldexp") == 0)
+    {
+        t = asm_scalar_op(actx, ASMOP_EXP, b, NULL);
+        *out = asm_op(actx, ASMOP_MUL, elements, a, &t, NULL);
+    } // else if
+    else if (strcmp(name, "isnan") == 0)
+        *out = asm_isnan(actx, a);
+    else if (strcmp(name, "isfinite") == 0)
+        *out = asm_isfinite(actx, a);
+    else if (strcmp(name, "isinf") == 0)
+    {
+        // neither finite nor NaN.
+        t = asm_isfinite(actx, a);
+        u = asm_isnan(actx, a);
+        t = asm_not(actx, &t);
+        *out = asm_op(actx, ASMOP_SUB, elements, &t, &u, NULL);
+    } // else if
+    else if ( (strcmp(name, "ddx") == 0) || (strcmp(name, "ddy") == 0) ||
+              (strcmp(name, "fwidth") == 0) )
+    {
+        if ((!actx->pixel) || (actx->major < 3))
+            failf(ctx, "'%s' needs ps_3_0", name);
+        else if (name[0] == 'd')
+            *out = asm_op(actx, (name[2] == 'x') ? ASMOP_DSX : ASMOP_DSY, elements, a, NULL, NULL);
+        else
+        {
+            t = asm_op(actx, ASMOP_DSX, elements, a, NULL, NULL);
+            u = asm_op(actx, ASMOP_DSY, elements, a, NULL, NULL);
+            t = asm_op(actx, ASMOP_ABS, elements, &t, NULL, NULL);
+            u = asm_op(actx, ASMOP_ABS, elements, &u, NULL, NULL);
+            *out = asm_op(actx, ASMOP_ADD, elements, &t, &u, NULL);
+        } // else
+    } // else if
+    else
+    {
+        return 0;
+    } // else
+
+    return 1;
+} // asm_componentwise
+
+// vector * matrix: a row vector.
+static AsmOperand asm_mul_vec_mat(AsmContext *actx, const AsmOperand *v,
+                                  const AsmMatrix *m)
+{
+    AsmOperand comps[4];
+    AsmOperand retval;
+    int i;
+
+    if (!m->rowmajor)  // each column is a dot product.
+    {
+        for (i = 0; i < m->columns; i++)
+            comps[i] = asm_dot(actx, v, &m->lines[i], m->rows);
+        return asm_gather(actx, comps, m->columns);
+    } // if
+
+    // otherwise it's the rows, scaled by each component, added up.
+    const AsmOperand v0 = asm_component(v, 0);
+    retval = asm_op(actx, ASMOP_MUL, m->columns, &m->lines[0], &v0, NULL);
+    for (i = 1; i < m->rows; i++)
+    {
+        const AsmOperand vi = asm_component(v, i);
+        retval = asm_op(actx, ASMOP_MAD, m->columns, &m->lines[i], &vi, &retval);
+    } // for
+    return retval;
+} // asm_mul_vec_mat
+
+// matrix * vector: a column vector.
+static AsmOperand asm_mul_mat_vec(AsmContext *actx, const AsmMatrix *m,
+                                  const AsmOperand *v)
+{
+    AsmOperand comps[4];
+    AsmOperand retval;
+    int i;
+
+    if (m->rowmajor)  // each row is a dot product.
+    {
+        for (i = 0; i < m->rows; i++)
+            comps[i] = asm_dot(actx, &m->lines[i], v, m->columns);
+        return asm_gather(actx, comps, m->rows);
+    } // if
+
+    const AsmOperand v0 = asm_component(v, 0);
+    retval = asm_op(actx, ASMOP_MUL, m->rows, &m->lines[0], &v0, NULL);
+    for (i = 1; i < m->columns; i++)
+    {
+        const AsmOperand vi = asm_component(v, i);
+        retval = asm_op(actx, ASMOP_MAD, m->rows, &m->lines[i], &vi, &retval);
+    } // for
+    return retval;
+} // asm_mul_mat_vec
+
+static AsmOperand asm_matrix_row(AsmContext *actx, const AsmMatrix *m,
+                                 const int row)
+{
+    AsmOperand comps[4];
+    int i;
+    if (m->rowmajor)
+        return m->lines[row];
+    for (i = 0; i < m->columns; i++)
+        comps[i] = asm_component(&m->lines[i], row);
+    return asm_gather(actx, comps, m->columns);
+} // asm_matrix_row
+
+static int asm_mul(AsmContext *actx, const AsmSlot *a, const AsmSlot *b,
+                   AsmSlot *out)
+{
+    int i;
+
+    if ((!a->ismatrix) && (!b->ismatrix))
+    {
+        AsmOperand value;
+        if ((a->value.elements == 1) || (b->value.elements == 1))
+        {
+            const int elements = (a->value.elements > b->value.elements) ? a->value.elements : b->value.elements;
+            value = asm_op(actx, ASMOP_MUL, elements, &a->value, &b->value, NULL);
+        } // if
+        else
+        {
+            value = asm_dot(actx, &a->value, &b->value, a->value.elements);
+        } // else
+        asm_vector_slot(&value, out);
+        return 1;
+    } // if
+
+    else if ((a->ismatrix) && (b->ismatrix))
+    {
+        memset(out, '\0', sizeof (*out));
+        out->defined = 1;
+        out->ismatrix = 1;
+        out->matrix.rows = a->matrix.rows;
+        out->matrix.columns = b->matrix.columns;
+        out->matrix.rowmajor = 1;
+        for (i = 0; i < a->matrix.rows; i++)
+        {
+            const AsmOperand row = asm_matrix_row(actx, &a->matrix, i);
+            out->matrix.lines[i] = asm_mul_vec_mat(actx, &row, &b->matrix);
+        } // for
+        return 1;
+    } // else if
+
+    const AsmSlot *m = a->ismatrix ? a : b;
+    const AsmSlot *v = a->ismatrix ? b : a;
+    AsmOperand value;
+
+    if (v->value.elements == 1)  // scalar * matrix
+    {
+        *out = *m;
+        out->readonly = 0;
+        const int lines = m->matrix.rowmajor ? m->matrix.rows : m->matrix.columns;
+        for (i = 0; i < lines; i++)
+            out->matrix.lines[i] = asm_op(actx, ASMOP_MUL, m->matrix.lines[i].elements, &m->matrix.lines[i], &v->value, NULL);
+        return 1;
+    } // if
+
+    if (a->ismatrix)
+        value = asm_mul_mat_vec(actx, &a->matrix, &b->value);
+    else
+        value = asm_mul_vec_mat(actx, &a->value, &b->matrix);
+
+    asm_vector_slot(&value, out);
+    return 1;
+} // asm_mul
+
+// Texture coordinates go in a temp (or a t# register, in pixel shaders) all
+//  by themselves, since Shader Model 2 is picky about them.
+static AsmOperand asm_texcoord(AsmContext *actx, const AsmOperand *coord)
+{
+    int i;
+    if ( ((coord->regtype == REG_TYPE_TEMP) || ((actx->pixel) && (coord->regtype == REG_TYPE_TEXTURE))) &&
+         (!coord->negate) && (!coord->relative) && (coord->elements == 4) )
+    {
+        for (i = 0; i < 4; i++)
+        {
+            if (coord->swizzle[i] != i)
+                break;
+        } // for
+        if (i == 4)
+            return *coord;
+    } // if
+
+    const AsmOperand resized = asm_resize(coord, 4);
+    return asm_mov(actx, &resized);
+} // asm_texcoord
+
+static int asm_texture(AsmContext *actx, const char *name,
+                       const AsmSlot *args, const int argc, AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    const char *suffix = name + 3;
+    TextureType ttype = TEXTURE_TYPE_2D;
+    AsmOpcode opcode = ASMOP_TEXLD;
+
+    if ((strncmp(suffix, "1D", 2) == 0) || (strncmp(suffix, "2D", 2) == 0))
+        suffix += 2;
+    else if (strncmp(suffix, "3D", 2) == 0)
+    {
+        ttype = TEXTURE_TYPE_VOLUME;
+        suffix += 2;
+    } // else if
+    else if (strncmp(suffix, "CUBE", 4) == 0)
+    {
+        ttype = TEXTURE_TYPE_CUBE;
+        suffix += 4;
+    } // else if
+    else
+    {
+        return 0;
+    } // else
+
+    if ((*suffix == '\0') && (argc == 4))
+        suffix = "grad";
+
+    if (*suffix == '\0')
+        opcode = ASMOP_TEXLD;
+    else if (strcmp(suffix, "proj") == 0)
+        opcode = ASMOP_TEXLDP;
+    else if (strcmp(suffix, "bias") == 0)
+        opcode = ASMOP_TEXLDB;
+    else if (strcmp(suffix, "lod") == 0)
+        opcode = ASMOP_TEXLDL;
+    else if (strcmp(suffix, "grad") == 0)
+        opcode = ASMOP_TEXLDD;
+    else
+        return 0;
+
+    if ((!actx->pixel) && ((actx->major < 3) || (opcode != ASMOP_TEXLDL)))
+    {
+        failf(ctx, "'%s' isn't available in vertex shaders (try tex*lod in vs_3_0)", name);
+        return 1;
+    } // if
+    else if ((actx->major < 3) && ((opcode == ASMOP_TEXLDL) || (opcode == ASMOP_TEXLDD)))
+    {
+        failf(ctx, "'%s' needs Shader Model 3", name);
+        return 1;
+    } // else if
+
+    const AsmOperand *sampler = &args[0].value;
+    if (sampler->regtype != REG_TYPE_SAMPLER)
+    {
+        fail(ctx, "Internal error: texture lookup without a sampler");
+        return 1;
+    } // if
+    actx->samplertypes[sampler->regnum] = ttype;
+
+    const AsmOperand coord = asm_texcoord(actx, &args[1].value);
+    const AsmOperand result = new_asm_vreg(actx, 4);
+    if (opcode == ASMOP_TEXLDD)
+    {
+        const AsmOperand dx = asm_resize(&args[2].value, 4);
+        const AsmOperand dy = asm_resize(&args[3].value, 4);
+        emit_asm(actx, opcode, 0, &result, &coord, sampler, &dx, &dy);
+    } // if
+    else
+    {
+        emit_asm(actx, opcode, 0, &result, &coord, sampler, NULL, NULL);
+    } // else
+
+    asm_vector_slot(&result, out);
+    return 1;
+} // asm_texture
+
+static void asm_texkill(AsmContext *actx, const AsmPredicate *pred,
+                        const AsmOperand *x)
+{
+    AsmOperand value = *x;
+    if (value.elements == 4)  // texkill only looks at xyz in ps_2_0.
+    {
+        const AsmOperand xy = asm_swizzle_str(&value, "xy");
+        const AsmOperand zw = asm_swizzle_str(&value, "zw");
+        value = asm_op(actx, ASMOP_MIN, 2, &xy, &zw, NULL);
+    } // if
+
+    if (!pred->always)  // don't kill anything if we aren't running.
+    {
+        const AsmOperand negp = asm_negate(&pred->value);
+        const AsmOperand zero = asm_zero(actx);
+        value = asm_op(actx, ASMOP_CMP, value.elements, &negp, &zero, &value);
+    } // if
+
+    const AsmOperand resized = asm_resize(&value, 4);
+    const AsmOperand killreg = asm_mov(actx, &resized);
+    emit_asm(actx, ASMOP_TEXKILL, 0, &killreg, NULL, NULL, NULL, NULL);
+} // asm_texkill
+
+// The determinant of a square matrix. A matrix and its transpose have the
+//  same determinant, so the lines can stand in for rows either way.
+static AsmOperand asm_determinant(AsmContext *actx, const AsmMatrix *m)
+{
+    AsmOperand r[4];
+    AsmOperand s, c;
+    int i;
+
+    // vertex shaders can only read one constant register per instruction,
+    //  so copy the lines that get read alongside another one first.
+    for (i = 0; i < m->rows; i++)
+    {
+        const int paired = (m->rows == 3) ? (i == 2) : (i & 1);
+        const RegisterType regtype = m->lines[i].regtype;
+        if ( (!actx->pixel) && (paired) &&
+             ((regtype == REG_TYPE_CONST) || (regtype == ASMREG_LITERAL)) )
+            r[i] = asm_mov(actx, &m->lines[i]);
+        else
+            r[i] = m->lines[i];
+    } // for
+
+    if (m->rows == 1)
+        return asm_component(&r[0], 0);
+    else if (m->rows == 2)  // ad - bc
+    {
+        const AsmOperand a = asm_component(&r[0], 0);
+        const AsmOperand b = asm_component(&r[0], 1);
+        const AsmOperand cc = asm_component(&r[1], 0);
+        const AsmOperand d = asm_component(&r[1], 1);
+        const AsmOperand negb = asm_negate(&b);
+        const AsmOperand ad = asm_op(actx, ASMOP_MUL, 1, &a, &d, NULL);
+        return asm_op(actx, ASMOP_MAD, 1, &negb, &cc, &ad);
+    } // else if
+    else if (m->rows == 3)  // r0 . (r1 x r2)
+    {
+        const AsmOperand ayzx = asm_swizzle_str(&r[1], "yzx");
+        const AsmOperand bzxy = asm_swizzle_str(&r[2], "zxy");
+        const AsmOperand azxy = asm_swizzle_str(&r[1], "zxy");
+        const AsmOperand negazxy = asm_negate(&azxy);
+        const AsmOperand byzx = asm_swizzle_str(&r[2], "yzx");
+        c = asm_op(actx, ASMOP_MUL, 3, &ayzx, &bzxy, NULL);
+        c = asm_op(actx, ASMOP_MAD, 3, &negazxy, &byzx, &c);
+        return asm_dot(actx, &r[0], &c, 3);
+    } // else if
+
+    // Laplace expansion along the first two rows: each 2x2 determinant from
+    //  rows 0 and 1 times the one from rows 2 and 3 in the other columns.
+    //  (s) gets the minors for columns 01, 10 (negated, for its sign), 03
+    //  and 12, and (c) the ones that go with them: 23, 13, 12 and 03.
+    const AsmOperand a0 = asm_swizzle_str(&r[0], "xzxy");
+    const AsmOperand b0 = asm_swizzle_str(&r[1], "yxwz");
+    const AsmOperand a1 = asm_swizzle_str(&r[0], "yxwz");
+    const AsmOperand b1 = asm_swizzle_str(&r[1], "xzxy");
+    const AsmOperand nega1 = asm_negate(&a1);
+    s = asm_op(actx, ASMOP_MUL, 4, &a0, &b0, NULL);
+    s = asm_op(actx, ASMOP_MAD, 4, &nega1, &b1, &s);
+
+    const AsmOperand c0 = asm_swizzle_str(&r[2], "zyyx");
+    const AsmOperand d0 = asm_swizzle_str(&r[3], "wwzw");
+    const AsmOperand c1 = asm_swizzle_str(&r[2], "wwzw");
+    const AsmOperand d1 = asm_swizzle_str(&r[3], "zyyx");
+    const AsmOperand negc1 = asm_negate(&c1);
+    c = asm_op(actx, ASMOP_MUL, 4, &c0, &d0, NULL);
+    c = asm_op(actx, ASMOP_MAD, 4, &negc1, &d1, &c);
+    AsmOperand retval = asm_dot(actx, &s, &c, 4);
+
+    // ...and the last two pairs: -(13 * 02) + (23 * 01), as (31, 32) times
+    //  (02, 10).
+    const AsmOperand a2 = asm_swizzle_str(&r[0], "ww");
+    const AsmOperand b2 = asm_swizzle_str(&r[1], "yz");
+    const AsmOperand a3 = asm_swizzle_str(&r[0], "yz");
+    const AsmOperand b3 = asm_swizzle_str(&r[1], "ww");
+    const AsmOperand nega3 = asm_negate(&a3);
+    s = asm_op(actx, ASMOP_MUL, 2, &a2, &b2, NULL);
+    s = asm_op(actx, ASMOP_MAD, 2, &nega3, &b3, &s);
+
+    const AsmOperand c2 = asm_swizzle_str(&r[2], "xy");
+    const AsmOperand d2 = asm_swizzle_str(&r[3], "zx");
+    const AsmOperand c3 = asm_swizzle_str(&r[2], "zx");
+    const AsmOperand d3 = asm_swizzle_str(&r[3], "xy");
+    const AsmOperand negc3 = asm_negate(&c3);
+    c = asm_op(actx, ASMOP_MUL, 2, &c2, &d2, NULL);
+    c = asm_op(actx, ASMOP_MAD, 2, &negc3, &d3, &c);
+
+    if (actx->pixel)
+        return asm_op(actx, ASMOP_DP2ADD, 1, &s, &c, &retval);
+
+    const AsmOperand sx = asm_component(&s, 0);
+    const AsmOperand sy = asm_component(&s, 1);
+    const AsmOperand cx = asm_component(&c, 0);
+    const AsmOperand cy = asm_component(&c, 1);
+    retval = asm_op(actx, ASMOP_MAD, 1, &sx, &cx, &retval);
+    return asm_op(actx, ASMOP_MAD, 1, &sy, &cy, &retval);
+} // asm_determinant
+
+// lit(n . l, n . h, m): (1, diffuse, specular, 1). Vertex shaders have an
+//  instruction for this.
+static AsmOperand asm_lit(AsmContext *actx, const AsmOperand *ops)
+{
+    AsmOperand comps[4];
+    comps[0] = ops[0];
+    comps[1] = ops[1];
+    comps[2] = ops[2];
+    if (!actx->pixel)
+    {
+        // lit reads the power from .w.
+        AsmOperand src = asm_gather(actx, comps, 3);
+        src = asm_resize(&src, 4);
+        return asm_op(actx, ASMOP_LIT, 4, &src, NULL, NULL);
+    } // if
+
+    // specular is zero if either dot product is negative.
+    const AsmOperand zero = asm_zero(actx);
+    const AsmOperand one = asm_one(actx);
+    const AsmOperand lowest = asm_op(actx, ASMOP_MIN, 1, &ops[0], &ops[1], NULL);
+    const AsmOperand spec = asm_op(actx, ASMOP_POW, 1, &ops[1], &ops[2], NULL);
+    comps[0] = one;
+    comps[1] = asm_op(actx, ASMOP_MAX, 1, &ops[0], &zero, NULL);
+    comps[2] = asm_select_ge(actx, &lowest, &spec, &zero);
+    comps[3] = one;
+    return asm_gather(actx, comps, 4);
+} // asm_lit
+
+// modf() and frexp() return one part of each component and store the other
+//  through their second argument.
+static int asm_split_parts(AsmContext *actx, AsmFrame *frame,
+                           const AsmPredicate *pred, const int isfrexp,
+                           const MOJOSHADER_irCall *call, AsmSlot *out)
+{
+    const MOJOSHADER_irExprList *args = call->args;
+    const AsmOperand zero = asm_zero(actx);
+    const AsmOperand one = asm_one(actx);
+    AsmSlot x, other;
+    int i;
+
+    if (!asm_expr(actx, frame, pred, args->expr, &x))
+        return 0;
+
+    *out = other = x;
+    out->readonly = other.readonly = 0;
+    const int lines = !x.ismatrix ? 1 : x.matrix.rowmajor ? x.matrix.rows : x.matrix.columns;
+    for (i = 0; i < lines; i++)
+    {
+        const AsmOperand *v = x.ismatrix ? &x.matrix.lines[i] : &x.value;
+        AsmOperand *part = out->ismatrix ? &out->matrix.lines[i] : &out->value;
+        AsmOperand *rest = other.ismatrix ? &other.matrix.lines[i] : &other.value;
+        const int elements = v->elements;
+
+        if (!isfrexp)  // modf: the whole part has the same sign.
+        {
+            *rest = asm_trunc(actx, v);
+            const AsmOperand negrest = asm_negate(rest);
+            *part = asm_op(actx, ASMOP_ADD, elements, v, &negrest, NULL);
+            continue;
+        } // if
+
+        // frexp: x = m * 2^e, with 0.5 <= |m| < 1, and zero for zero. log's
+        //  error can leave |m| at 1.0 for an exact power of two, but
+        //  m * 2^e is still x.
+        const AsmOperand ax = asm_op(actx, ASMOP_ABS, elements, v, NULL, NULL);
+        const AsmOperand negax = asm_negate(&ax);
+        AsmOperand e = asm_scalar_op(actx, ASMOP_LOG, &ax, NULL);
+        e = asm_floor(actx, &e);
+        e = asm_op(actx, ASMOP_ADD, elements, &e, &one, NULL);
+        const AsmOperand nege = asm_negate(&e);
+        AsmOperand m = asm_scalar_op(actx, ASMOP_EXP, &nege, NULL);
+        m = asm_op(actx, ASMOP_MUL, elements, v, &m, NULL);
+        *part = asm_select_ge(actx, &negax, &zero, &m);
+        *rest = asm_select_ge(actx, &negax, &zero, &e);
+    } // for
+
+    return asm_store(actx, frame, pred, args->next->expr, &other);
+} // asm_split_parts
+
+static int asm_intrinsic(AsmContext *actx, AsmFrame *frame,
+                         const AsmPredicate *pred,
+                         const MOJOSHADER_irCall *call, AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    const int index = -call->index;
+    const MOJOSHADER_irExprList *item;
+    AsmSlot args[4];
+    AsmOperand ops[4];
+    int argc = 0;
+    int i, j;
+
+    if ((index <= 0) || (index >= actx->intrinsic_count) ||
+        (actx->intrinsics[index] == NULL))
+    {
+        fail(ctx, "Internal error: unknown intrinsic");
+        return 0;
+    } // if
+
+    const char *name = actx->intrinsic_names[index];
+    const MOJOSHADER_astDataTypeFunction *fn = &actx->intrinsics[index]->function;
+    const MOJOSHADER_astDataType *ret = asm_reduce(ctx, fn->retval);
+
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+
+    if ((strcmp(name, "modf") == 0) || (strcmp(name, "frexp") == 0))
+        return asm_split_parts(actx, frame, pred, name[0] == 'f', call, out);
+
+    else if (strcmp(name, "sincos") == 0)
+    {
+        AsmSlot s, c;
+        const MOJOSHADER_irExprList *args = call->args;
+        if (!asm_vector_expr(actx, frame, pred, args->expr, &ops[0]))
+            return 0;
+        const AsmOperand sinval = asm_sin_or_cos(actx, &ops[0], 1);
+        const AsmOperand cosval = asm_sin_or_cos(actx, &ops[0], 0);
+        asm_vector_slot(&sinval, &s);
+        asm_vector_slot(&cosval, &c);
+        asm_vector_slot(&sinval, out);
+        return ( asm_store(actx, frame, pred, args->next->expr, &s) &&
+                 asm_store(actx, frame, pred, args->next->next->expr, &c) );
+    } // if
+
+    for (item = call->args; item != NULL; item = item->next)
+    {
+        AsmSlot arg;
+        if ((argc >= (int) STATICARRAYLEN(args)) || (argc >= fn->num_params))
+        {
+            fail(ctx, "Internal error: too many arguments to intrinsic");
+            return 0;
+        } // if
+        else if (!asm_expr(actx, frame, pred, item->expr, &arg))
+            return 0;
+        else if (!asm_convert_value(actx, &arg, fn->params[argc], &args[argc]))
+            return 0;
+        ops[argc] = args[argc].value;
+        argc++;
+    } // for
+
+    const int elements = args[0].ismatrix ? 0 : args[0].value.elements;
+    const AsmOperand *a = &ops[0];
+    const AsmOperand *b = &ops[1];
+    AsmOperand value;
+
+    if (strncmp(name, "tex", 3) == 0)
+    {
+        if (asm_texture(actx, name, args, argc, out))
+            return !isfail(ctx);
+    } // if
+
+    else if (strcmp(name, "mul") == 0)
+        return asm_mul(actx, &args[0], &args[1], out);
+
+    else if (strcmp(name, "transpose") == 0)
+    {
+        *out = args[0];
+        out->readonly = 0;
+        out->matrix.rows = args[0].matrix.columns;
+        out->matrix.columns = args[0].matrix.rows;
+        out->matrix.rowmajor = !args[0].matrix.rowmajor;
+        return 1;
+    } // else if
+
+    else if (strcmp(name, "clip") == 0)
+    {
+        if (!actx->pixel)
+            fail(ctx, "clip() only works in pixel shaders");
+        else if (!args[0].ismatrix)
+            asm_texkill(actx, pred, a);
+        else
+        {
+            // any negative component anywhere kills the pixel.
+            const AsmMatrix *m = &args[0].matrix;
+            const int lines = m->rowmajor ? m->rows : m->columns;
+            value = m->lines[0];
+            for (i = 1; i < lines; i++)
+                value = asm_op(actx, ASMOP_MIN, value.elements, &value, &m->lines[i], NULL);
+            asm_texkill(actx, pred, &value);
+        } // else
+        return !isfail(ctx);
+    } // else if
+
+    else if (strcmp(name, "determinant") == 0)
+    {
+        value = asm_determinant(actx, &args[0].matrix);
+        asm_vector_slot(&value, out);
+        return 1;
+    } // else if
+
+    else if (strcmp(name, "noise") == 0)
+    {
+        fail(ctx, "noise() only works in texture shaders, not vertex or pixel shaders");
+        return 0;
+    } // else if
+
+    else if ((args[0].ismatrix) && ((strcmp(name, "any") == 0) || (strcmp(name, "all") == 0)))
+    {
+        AsmOperand comps[16];
+        const int count = asm_flatten(&args[0], comps, STATICARRAYLEN(comps));
+        const int isall = (name[1] == 'l');
+        value = comps[0];
+        for (i = 1; i < count; i++)
+        {
+            if (isall)
+                value = asm_op(actx, ASMOP_MUL, 1, &value, &comps[i], NULL);
+            else  // sum the squares, so nothing cancels out.
+            {
+                if (i == 1)
+                    value = asm_op(actx, ASMOP_MUL, 1, &value, &value, NULL);
+                value = asm_op(actx, ASMOP_MAD, 1, &comps[i], &comps[i], &value);
+            } // else
+        } // for
+        value = asm_nonzero(actx, &value);
+        asm_vector_slot(&value, out);
+        return 1;
+    } // else if
+
+    else if (elements > 0)  // everything else here wants vectors.
+    {
+        if (strcmp(name, "dot") == 0)
+            value = asm_dot(actx, a, b, elements);
+        else if (strcmp(name, "length") == 0)
+            value = asm_length(actx, a);
+        else if (strcmp(name, "distance") == 0)
+        {
+            const AsmOperand diff = asm_op(actx, ASMOP_SUB, elements, a, b, NULL);
+            value = asm_length(actx, &diff);
+        } // else if
+        else if ((strcmp(name, "normalize") == 0) && (elements == 3))
+            value = asm_op(actx, ASMOP_NRM, 3, a, NULL, NULL);
+        else if (strcmp(name, "normalize") == 0)
+        {
+            const AsmOperand d = asm_dot(actx, a, a, elements);
+            const AsmOperand r = asm_op(actx, ASMOP_RSQ, 1, &d, NULL, NULL);
+            value = asm_op(actx, ASMOP_MUL, elements, a, &r, NULL);
+        } // else if
+        else if (strcmp(name, "cross") == 0)
+        {
+            const AsmOperand ayzx = asm_swizzle_str(a, "yzx");
+            const AsmOperand bzxy = asm_swizzle_str(b, "zxy");
+            const AsmOperand nazxy = asm_swizzle_str(a, "zxy");
+            const AsmOperand negazxy = asm_negate(&nazxy);
+            const AsmOperand byzx = asm_swizzle_str(b, "yzx");
+            const AsmOperand t = asm_op(actx, ASMOP_MUL, 3, &ayzx, &bzxy, NULL);
+            value = asm_op(actx, ASMOP_MAD, 3, &negazxy, &byzx, &t);
+        } // else if
+        else if (strcmp(name, "reflect") == 0)
+        {
+            // i - 2 * dot(n, i) * n
+            const AsmOperand d = asm_dot(actx, b, a, elements);
+            const AsmOperand negtwo = asm_literal1(actx, -2.0f);
+            const AsmOperand s = asm_op(actx, ASMOP_MUL, 1, &d, &negtwo, NULL);
+            value = asm_op(actx, ASMOP_MAD, elements, b, &s, a);
+        } // else if
+        else if (strcmp(name, "faceforward") == 0)
+        {
+            // -n * sign(dot(i, ng))
+            const AsmOperand d = asm_dot(actx, b, &ops[2], elements);
+            const AsmOperand nega = asm_negate(a);
+            if (actx->pixel)
+                value = asm_select_ge(actx, &d, &nega, a);
+            else
+            {
+                const AsmOperand zero = asm_zero(actx);
+                const AsmOperand lt = asm_op(actx, ASMOP_SLT, 1, &d, &zero, NULL);
+                value = asm_op(actx, ASMOP_LRP, elements, &lt, a, &nega);
+            } // else
+        } // else if
+        else if (strcmp(name, "refract") == 0)
+        {
+            // k = 1 - eta^2 * (1 - (n . i)^2); zero if k < 0, otherwise
+            //  eta * i - (eta * (n . i) + sqrt(k)) * n.
+            const AsmOperand *eta = &ops[2];
+            const AsmOperand one = asm_one(actx);
+            const AsmOperand zero = asm_zero(actx);
+            const AsmOperand d = asm_dot(actx, b, a, elements);
+            const AsmOperand negd = asm_negate(&d);
+            const AsmOperand t = asm_op(actx, ASMOP_MAD, 1, &negd, &d, &one);
+            const AsmOperand e2 = asm_op(actx, ASMOP_MUL, 1, eta, eta, NULL);
+            const AsmOperand nege2 = asm_negate(&e2);
+            const AsmOperand k = asm_op(actx, ASMOP_MAD, 1, &nege2, &t, &one);
+            AsmOperand sq = asm_op(actx, ASMOP_RSQ, 1, &k, NULL, NULL);
+            sq = asm_op(actx, ASMOP_RCP, 1, &sq, NULL, NULL);
+            const AsmOperand s = asm_op(actx, ASMOP_MAD, 1, eta, &d, &sq);
+            const AsmOperand negs = asm_negate(&s);
+            AsmOperand r = asm_op(actx, ASMOP_MUL, elements, a, eta, NULL);
+            r = asm_op(actx, ASMOP_MAD, elements, &negs, b, &r);
+            const AsmOperand kvec = asm_resize(&k, elements);
+            value = asm_select_ge(actx, &kvec, &r, &zero);
+        } // else if
+        else if (strcmp(name, "lit") == 0)
+            value = asm_lit(actx, ops);
+        else if (strcmp(name, "any") == 0)
+        {
+            const AsmOperand d = asm_dot(actx, a, a, elements);
+            value = asm_nonzero(actx, &d);
+        } // else if
+        else if (strcmp(name, "all") == 0)
+        {
+            value = asm_component(a, 0);
+            for (i = 1; i < elements; i++)
+            {
+                const AsmOperand ai = asm_component(a, i);
+                value = asm_op(actx, ASMOP_MUL, 1, &value, &ai, NULL);
+            } // for
+            value = asm_nonzero(actx, &value);
+        } // else if
+        else if (strcmp(name, "D3DCOLORtoUBYTE4") == 0)
+        {
+            const AsmOperand zyxw = asm_swizzle_str(a, "zyxw");
+            const AsmOperand scale = asm_literal1(actx, 255.001953f);
+            const AsmOperand t = asm_op(actx, ASMOP_MUL, 4, &zyxw, &scale, NULL);
+            value = asm_trunc(actx, &t);
+        } // else if
+        else if (!asm_componentwise(actx, name, ops, argc, asm_datatype_elems(ctx, ret), &value))
+            value.elements = 0;
+
+        if (value.elements > 0)
+        {
+            asm_vector_slot(&value, out);
+            return !isfail(ctx);
+        } // if
+    } // else if
+
+    else  // matrices, a line at a time.
+    {
+        const AsmMatrix *m = &args[0].matrix;
+        const int lines = m->rowmajor ? m->rows : m->columns;
+        AsmOperand lineops[4];
+        *out = args[0];
+        out->readonly = 0;
+        for (i = 0; i < lines; i++)
+        {
+            for (j = 0; j < argc; j++)
+            {
+                AsmSlot reshaped;
+                if (!args[j].ismatrix)
+                    lineops[j] = ops[j];
+                else if (!asm_reshape_matrix(actx, &args[j], m->rows, m->columns, m->rowmajor, &reshaped))
+                    return 0;
+                else
+                    lineops[j] = reshaped.matrix.lines[i];
+            } // for
+
+            if (!asm_componentwise(actx, name, lineops, argc, m->lines[i].elements, &out->matrix.lines[i]))
+                break;
+        } // for
+
+        if (i == lines)
+            return !isfail(ctx);
+    } // else
+
+    failf(ctx, "Internal error: unexpected arguments to intrinsic '%s'", name);
+    return 0;
+} // asm_intrinsic
+
+static int build_asm_intrinsics(AsmContext *actx)
+{
+    const HashTable *table = (builtin_ctx != NULL) ? builtin_ctx->functions : NULL;
+    const void *key = NULL;
+    void *iter = NULL;
+
+    if (table == NULL)
+        return 1;
+
+    actx->intrinsic_count = -builtin_ctx->intrinsic_func_index + 1;
+    actx->intrinsics = (const MOJOSHADER_astDataType **) new_asm_array(actx, actx->intrinsic_count, sizeof (MOJOSHADER_astDataType *));
+    actx->intrinsic_names = (const char **) new_asm_array(actx, actx->intrinsic_count, sizeof (const char *));
+    if ((actx->intrinsics == NULL) || (actx->intrinsic_names == NULL))
+        return 0;
+
+    while (hash_iter_keys(table, &key, &iter))
+    {
+        const FunctionOverloads *fos = (const FunctionOverloads *) key;
+        const FunctionOverload *fo;
+        for (fo = fos->overloads; fo != NULL; fo = fo->next)
+        {
+            const int index = -fo->index;
+            if ((index > 0) && (index < actx->intrinsic_count))
+            {
+                actx->intrinsics[index] = fo->datatype;
+                actx->intrinsic_names[index] = fos->symbol;
+            } // if
+        } // for
+    } // while
+
+    return 1;
+} // build_asm_intrinsics
+
+
+// Statements, control flow and calls...
+
+static const AsmPredicate asm_always = { 1 };
+
+static int asm_run_function(AsmContext *actx, AsmFrame *frame,
+                            const AsmPredicate *entry);
+
+// The value of a CJUMP's condition, as 0.0 or 1.0.
+static int asm_condition(AsmContext *actx, AsmFrame *frame,
+                         const AsmPredicate *pred,
+                         const MOJOSHADER_irCJump *cjump, AsmOperand *out)
+{
+    const MOJOSHADER_irExpression *right = cjump->right;
+    AsmOperand l, r;
+
+    if (!asm_vector_expr(actx, frame, pred, cjump->left, &l))
+        return 0;
+
+    // "if (x)" is "if (x == true)", and x is already 0 or 1.
+    if ( (right->ir.type == MOJOSHADER_IR_CONSTANT) &&
+         (right->info.type == MOJOSHADER_AST_DATATYPE_BOOL) &&
+         ((cjump->cond == MOJOSHADER_IR_COND_EQL) || (cjump->cond == MOJOSHADER_IR_COND_NEQ)) )
+    {
+        const int istrue = (right->constant.value.ival[0] != 0);
+        const int iseql = (cjump->cond == MOJOSHADER_IR_COND_EQL);
+        *out = (istrue == iseql) ? l : asm_not(actx, &l);
+        *out = asm_component(out, 0);
+        return 1;
+    } // if
+
+    if (!asm_vector_expr(actx, frame, pred, right, &r))
+        return 0;
+
+    // a branch only looks at one value: like "if (x)" above, vectors are
+    //  truncated to their first component.
+    l = asm_component(&l, 0);
+    r = asm_component(&r, 0);
+    *out = asm_compare(actx, cjump->cond, &l, &r);
+    return 1;
+} // asm_condition
+
+static int asm_statement(AsmContext *actx, AsmFrame *frame,
+                         const AsmPredicate *pred,
+                         const MOJOSHADER_irStatement *stmt,
+                         AsmOperand *cond)
+{
+    Context *ctx = actx->ctx;
+    AsmSlot value;
+
+    ctx->sourcefile = stmt->ir.filename;
+    ctx->sourceline = stmt->ir.line;
+
+    switch (stmt->ir.type)
+    {
+        case MOJOSHADER_IR_LABEL:
+        case MOJOSHADER_IR_JUMP:
+            return 1;  // asm_build_blocks() dealt with these.
+
+        case MOJOSHADER_IR_CJUMP:
+            return asm_condition(actx, frame, pred, &stmt->cjump, cond);
+
+        case MOJOSHADER_IR_MOVE:
+            if (!asm_expr(actx, frame, pred, stmt->move.src, &value))
+                return 0;
+            return asm_store(actx, frame, pred, stmt->move.dst, &value);
+
+        case MOJOSHADER_IR_EXPR_STMT:
+            return asm_expr(actx, frame, pred, stmt->expr.expr, &value);
+
+        case MOJOSHADER_IR_DISCARD:
+            if (!actx->pixel)
+            {
+                fail(ctx, "discard only works in pixel shaders");
+                return 0;
+            } // if
+            else
+            {
+                const AsmOperand negone = asm_literal1(actx, -1.0f);
+                asm_texkill(actx, pred, &negone);
+            } // else
+            return 1;
+
+        default: break;
+    } // switch
+
+    fail(ctx, "Internal error: unexpected IR statement in code generation");
+    return 0;
+} // asm_statement
+
+// How much of (from)'s predicate carries over when it goes to block (to).
+static AsmPredicate asm_edge_predicate(AsmContext *actx,
+                                       const AsmPredicate *from,
+                                       const AsmBlock *block,
+                                       const AsmOperand *cond, const int to)
+{
+    AsmPredicate retval = *from;
+    if ((block->succ[1] < 0) || (block->succ[0] == block->succ[1]))
+        return retval;  // no choice here.
+
+    const int istrue = (block->succ[0] == to);
+    retval.always = 0;
+    if (from->always)
+        retval.value = istrue ? *cond : asm_not(actx, cond);
+    else if (istrue)
+        retval.value = asm_op(actx, ASMOP_MUL, 1, &from->value, cond, NULL);
+    else
+    {
+        // p * (1 - c) == p - (p * c)
+        const AsmOperand negp = asm_negate(&from->value);
+        retval.value = asm_op(actx, ASMOP_MAD, 1, &negp, cond, &from->value);
+    } // else
+
+    return retval;
+} // asm_edge_predicate
+
+// Semantic analysis turns a signature's datatype into a function type.
+static const MOJOSHADER_astDataType *asm_return_type(
+                                const MOJOSHADER_astFunctionSignature *sig)
+{
+    const MOJOSHADER_astDataType *dt = sig->datatype;
+    if ((dt != NULL) && (dt->type == MOJOSHADER_AST_DATATYPE_FUNCTION))
+        dt = dt->function.retval;
+    return dt;
+} // asm_return_type
+
+// Loops and branches...
+
+// Shader Model 3 can really loop and branch, but then a variable's value
+//  can't just be whatever register last got written: the code after the
+//  loop or if doesn't know which way it came. So each value that's still
+//  needed gets a home, a set of registers that it's copied into before it
+//  goes around again, breaks out, or leaves either side of an if, and the
+//  code after reads it from there. Liveness says which values are needed.
+
+static inline void asm_add_key(uint32 *set, const int key)
+{
+    set[key >> 5] |= ((uint32) 1) << (key & 31);
+} // asm_add_key
+
+static inline int asm_has_key(const uint32 *set, const int key)
+{
+    return (int) ((set[key >> 5] >> (key & 31)) & 1);
+} // asm_has_key
+
+typedef struct AsmLiveScan
+{
+    AsmContext *actx;
+    int func;
+    AsmLiveness *live;
+    uint32 *use;  // read before the block writes them.
+    uint32 *def;  // written, all of them, before the block reads them.
+    uint32 *writes;
+    uint32 *globals;
+} AsmLiveScan;
+
+static AsmLiveness *asm_liveness(AsmContext *actx, const int func);
+
+// How many keys (or static globals, if (*isglobal)) (expr) covers: one,
+//  unless it's a whole struct. Globals count down from (*first).
+static int asm_live_keys(const AsmLiveScan *scan,
+                         const MOJOSHADER_irExpression *expr,
+                         int *first, int *isglobal)
+{
+    AsmContext *actx = scan->actx;
+    const AsmFunction *fn = &actx->funcs[scan->func];
+    const IrFunction *irfn = &actx->ctx->ir_funcs[scan->func];
+    const MOJOSHADER_astDataType *dt = NULL;
+    int limit = 1;
+
+    *isglobal = 0;
+    if ((expr == NULL) || (expr->ir.type == MOJOSHADER_IR_TEMP))
+    {
+        *first = (expr != NULL) ? expr->temp.index - irfn->first_temp : -1;
+        return ((*first >= 0) && (*first < irfn->temp_count)) ? 1 : 0;
+    } // if
+    else if (expr->ir.type != MOJOSHADER_IR_MEMORY)
+        return 0;
+
+    const int index = expr->memory.index;
+    if (index < 0)
+    {
+        if ((-index >= actx->global_count) || (!actx->globals[-index].isstatic))
+            return 0;
+        *isglobal = 1;
+        *first = -index;
+        dt = actx->globals[-index].datatype;
+        limit = -index;
+    } // if
+    else if ((index > 0) && (index < fn->local_count))
+    {
+        *first = scan->live->temp_count + index;
+        dt = fn->localtypes[index];
+        limit = fn->local_count - index;
+    } // else if
+    else
+    {
+        return 0;
+    } // else
+
+    if ( (dt != NULL) && (asm_struct_type(actx->ctx, dt) != NULL) &&
+         (expr->info.type == MOJOSHADER_AST_DATATYPE_STRUCT) )
+    {
+        const int count = datatype_index_count(actx->ctx, dt);
+        return (count < limit) ? count : limit;
+    } // if
+    return 1;
+} // asm_live_keys
+
+// (whole) is zero if the write might leave some of the old value there.
+static void asm_live_write(AsmLiveScan *scan, MOJOSHADER_irExpression *dst,
+                           int whole)
+{
+    MOJOSHADER_irExpression *base = ir_dest_base(dst);
+    int first, isglobal, i;
+    const int count = asm_live_keys(scan, base, &first, &isglobal);
+
+    whole = (whole) && (base == dst);
+    for (i = 0; i < count; i++)
+    {
+        if (isglobal)
+            asm_add_key(scan->globals, first - i);
+        else
+        {
+            asm_add_key(scan->writes, first + i);
+            if (whole)
+                asm_add_key(scan->def, first + i);
+            else if (!asm_has_key(scan->def, first + i))
+                asm_add_key(scan->use, first + i);
+        } // else
+    } // for
+
+    if ((whole) && (!isglobal) && (count > 0) && (base->ir.type == MOJOSHADER_IR_TEMP))
+        scan->live->temp_elements[first] = base->info.elements;
+} // asm_live_write
+
+static int asm_live_read(Context *ctx, MOJOSHADER_irExpression **slot,
+                         void *data);
+
+// The arguments are all read before the call writes any of them back. Out
+//  parameters get copied back whether the callee wrote them or not, and all
+//  that's read of them is array indices.
+static void asm_live_call(AsmLiveScan *scan, MOJOSHADER_irCall *call)
+{
+    AsmContext *actx = scan->actx;
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astFunctionParameters *params = NULL;
+    const MOJOSHADER_astFunctionParameters *param;
+    MOJOSHADER_irExprList *arg;
+    MOJOSHADER_irExpression *dst;
+    int pass, n, i;
+
+    if (call->index > 0)
+    {
+        if ((call->index > ctx->user_func_index) || (ctx->ir_funcs[call->index].ast == NULL))
+            return;  // asm_call() will complain about this.
+        params = ctx->ir_funcs[call->index].ast->declaration->params;
+    } // if
+
+    for (pass = 0; pass < 2; pass++)
+    {
+        param = params;
+        for (arg = call->args, n = 0; arg != NULL; arg = arg->next, n++)
+        {
+            MOJOSHADER_astInputModifier mod = MOJOSHADER_AST_INPUTMOD_NONE;
+            if (call->index < 0)
+                mod = ir_intrinsic_writes_arg(call, n) ? MOJOSHADER_AST_INPUTMOD_OUT : mod;
+            else if (param != NULL)
+            {
+                mod = param->input_modifier;
+                param = param->next;
+            } // else if
+
+            if (pass == 1)
+            {
+                if ((mod == MOJOSHADER_AST_INPUTMOD_OUT) || (mod == MOJOSHADER_AST_INPUTMOD_INOUT))
+                    asm_live_write(scan, arg->expr, 1);
+            } // if
+            else if (mod != MOJOSHADER_AST_INPUTMOD_OUT)
+                visit_ir_expr(ctx, &arg->expr, asm_live_read, scan);
+            else
+            {
+                for (dst = arg->expr; dst != NULL; )
+                {
+                    if (dst->ir.type == MOJOSHADER_IR_SWIZZLE)
+                        dst = dst->swizzle.expr;
+                    else if (dst->ir.type == MOJOSHADER_IR_ARRAY)
+                    {
+                        visit_ir_expr(ctx, &dst->array.element, asm_live_read, scan);
+                        dst = dst->array.array;
+                    } // else if
+                    else
+                        break;
+                } // for
+            } // else
+        } // for
+    } // for
+
+    const AsmLiveness *callee = (call->index > 0) ? asm_liveness(actx, call->index) : NULL;
+    for (i = 0; (callee != NULL) && (i < callee->global_words); i++)
+        scan->globals[i] |= callee->all_globals[i];
+} // asm_live_call
+
+static int asm_live_read(Context *ctx, MOJOSHADER_irExpression **slot,
+                         void *data)
+{
+    AsmLiveScan *scan = (AsmLiveScan *) data;
+    MOJOSHADER_irExpression *expr = *slot;
+    int first, isglobal, i;
+    const int count = asm_live_keys(scan, expr, &first, &isglobal);
+
+    for (i = 0; (!isglobal) && (i < count); i++)
+    {
+        if (!asm_has_key(scan->def, first + i))
+            asm_add_key(scan->use, first + i);
+    } // for
+
+    if (expr->ir.type != MOJOSHADER_IR_CALL)
+        return 1;
+
+    asm_live_call(scan, &expr->call);
+    return 0;  // asm_live_call() did the arguments.
+} // asm_live_read
+
+static AsmLiveness *asm_liveness(AsmContext *actx, const int func)
+{
+    Context *ctx = actx->ctx;
+    AsmFunction *fn = asm_function(actx, func);
+    const IrFunction *irfn = &ctx->ir_funcs[func];
+    const MOJOSHADER_astFunctionParameters *param;
+    AsmLiveScan scan;
+    int changed = 1;
+    int b, i, w;
+
+    if (fn == NULL)
+        return NULL;
+    else if (fn->live != NULL)
+        return fn->live;  // done already, or it calls itself: asm_call() fails that.
+
+    AsmLiveness *live = (AsmLiveness *) new_asm_array(actx, 1, sizeof (AsmLiveness));
+    if (live == NULL)
+        return NULL;
+    fn->live = live;
+
+    const int blocks = fn->block_count;
+    live->temp_count = irfn->temp_count;
+    live->key_count = irfn->temp_count + fn->local_count;
+    live->words = (live->key_count + 31) / 32;
+    live->global_words = (actx->global_count + 31) / 32;
+    live->livein = (uint32 *) new_asm_array(actx, blocks * live->words, sizeof (uint32));
+    live->writes = (uint32 *) new_asm_array(actx, blocks * live->words, sizeof (uint32));
+    live->global_writes = (uint32 *) new_asm_array(actx, blocks * live->global_words, sizeof (uint32));
+    live->returned = (uint32 *) new_asm_array(actx, live->words, sizeof (uint32));
+    live->all_globals = (uint32 *) new_asm_array(actx, live->global_words, sizeof (uint32));
+    live->temp_elements = (int *) new_asm_array(actx, live->temp_count, sizeof (int));
+    uint32 *use = (uint32 *) new_asm_array(actx, blocks * live->words, sizeof (uint32));
+    uint32 *def = (uint32 *) new_asm_array(actx, blocks * live->words, sizeof (uint32));
+    if ( (live->livein == NULL) || (live->writes == NULL) ||
+         (live->global_writes == NULL) || (live->returned == NULL) ||
+         (live->all_globals == NULL) || (live->temp_elements == NULL) ||
+         (use == NULL) || (def == NULL) )
+        return NULL;
+
+    if ((irfn->rettemp >= irfn->first_temp) && (irfn->rettemp - irfn->first_temp < live->temp_count))
+        asm_add_key(live->returned, irfn->rettemp - irfn->first_temp);
+
+    param = (irfn->ast != NULL) ? irfn->ast->declaration->params : NULL;
+    for (; param != NULL; param = param->next)
+    {
+        const MOJOSHADER_astDataType *dt = asm_reduce(ctx, param->datatype);
+        int count = 1;
+        if ( (param->input_modifier != MOJOSHADER_AST_INPUTMOD_OUT) &&
+             (param->input_modifier != MOJOSHADER_AST_INPUTMOD_INOUT) )
+            continue;
+        else if (dt->type == MOJOSHADER_AST_DATATYPE_STRUCT)
+            count = dt->structure.member_count;
+        for (i = 0; (i < count) && (param->index + i < fn->local_count); i++)
+            asm_add_key(live->returned, live->temp_count + param->index + i);
+    } // for
+
+    memset(&scan, '\0', sizeof (scan));
+    scan.actx = actx;
+    scan.func = func;
+    scan.live = live;
+    for (b = 0; b < blocks; b++)
+    {
+        const AsmBlock *block = &fn->blocks[b];
+        scan.use = use + (b * live->words);
+        scan.def = def + (b * live->words);
+        scan.writes = live->writes + (b * live->words);
+        scan.globals = live->global_writes + (b * live->global_words);
+        for (i = 0; i < block->count; i++)
+        {
+            MOJOSHADER_irStatement *stmt = fn->stmts[block->first + i];
+            visit_ir_reads(ctx, stmt, asm_live_read, &scan);
+            if (stmt->ir.type == MOJOSHADER_IR_MOVE)
+                asm_live_write(&scan, stmt->move.dst, 1);
+        } // for
+
+        for (w = 0; w < live->global_words; w++)
+            live->all_globals[w] |= scan.globals[w];
+    } // for
+
+    // the usual backward dataflow, until nothing changes.
+    while (changed)
+    {
+        changed = 0;
+        for (b = blocks - 1; b >= 0; b--)
+        {
+            const AsmBlock *block = &fn->blocks[b];
+            for (w = 0; w < live->words; w++)
+            {
+                const int k = (b * live->words) + w;
+                uint32 out = 0;
+                if (block->succ[0] < 0)
+                    out = live->returned[w];
+                for (i = 0; i < 2; i++)
+                {
+                    if (block->succ[i] >= 0)
+                        out |= live->livein[(block->succ[i] * live->words) + w];
+                } // for
+
+                const uint32 in = use[k] | (out & ~def[k]);
+                if (in != live->livein[k])
+                {
+                    live->livein[k] = in;
+                    changed = 1;
+                } // if
+            } // for
+        } // for
+    } // while
+
+    return live;
+} // asm_liveness
+
+typedef struct AsmHome  // a value that has to end up in the same registers.
+{
+    AsmSlot *slot;  // the temp or variable...
+    AsmSlot home;  // ...and its registers.
+} AsmHome;
+
+typedef struct AsmRegion  // a loop or branch we're in the middle of.
+{
+    int loop;  // index into AsmFunction::loops, or -1 for a branch.
+    int block;  // branches: the block that branches...
+    int elsearm;  // ...where the false side starts...
+    int join;  // ...and where the sides meet.
+    int inelse;
+    AsmPredicate entry;  // the predicate going in.
+    int wrapped;  // loops: non-zero if it's in an if_ne on (entry).
+    AsmHome *homes;
+    int home_count;
+    AsmOperand *flags;  // loops: by exit, 1.0 if we broke out to go there.
+    AsmSlot *saved;  // branches: every temp, local and global going in.
+} AsmRegion;
+
+typedef struct AsmRun  // one asm_run_function().
+{
+    AsmContext *actx;
+    AsmFrame *frame;
+    const AsmFunction *fn;
+    const AsmLiveness *live;
+    AsmPredicate *preds;
+    AsmOperand *conds;
+    uint8 *preset;  // blocks whose (preds) a region already set.
+    AsmRegion *loops;  // by loop index.
+    AsmRegion **stack;  // the loops and branches we're in, innermost last.
+    int depth;
+    AsmOperand *moves;  // destination, source, destination, source...
+    int move_count;
+    int move_alloc;
+} AsmRun;
+
+// Zeros, laid out like (shape), for things nothing wrote to yet.
+static void asm_zero_like(AsmContext *actx, const AsmSlot *shape, AsmSlot *out)
+{
+    static const float zeros[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    int i;
+
+    *out = *shape;
+    if (shape->members != NULL)
+    {
+        const int count = (shape->structtype != NULL) ? shape->structtype->structure.member_count : shape->arraylen;
+        out->members = (AsmSlot *) new_asm_array(actx, count, sizeof (AsmSlot));
+        for (i = 0; (out->members != NULL) && (i < count); i++)
+            asm_zero_like(actx, &shape->members[i], &out->members[i]);
+    } // if
+    else if (shape->ismatrix)
+    {
+        const int lines = shape->matrix.rowmajor ? shape->matrix.rows : shape->matrix.columns;
+        for (i = 0; i < lines; i++)
+            out->matrix.lines[i] = asm_literal(actx, zeros, shape->matrix.lines[i].elements);
+    } // else if
+    else
+    {
+        out->value = asm_literal(actx, zeros, shape->value.elements);
+    } // else
+} // asm_zero_like
+
+// New registers for something shaped like (value).
+static int asm_new_home(AsmContext *actx, const AsmSlot *value, AsmSlot *home)
+{
+    int i;
+
+    *home = *value;
+    home->defined = 1;
+    home->readonly = 0;
+    if (value->members != NULL)
+    {
+        const int count = (value->structtype != NULL) ? value->structtype->structure.member_count : value->arraylen;
+        home->members = (AsmSlot *) new_asm_array(actx, count, sizeof (AsmSlot));
+        if (home->members == NULL)
+            return 0;
+        for (i = 0; i < count; i++)
+        {
+            if (!asm_new_home(actx, &value->members[i], &home->members[i]))
+                return 0;
+        } // for
+    } // if
+    else if (value->arraylen > 0)
+    {
+        // a copy of a uniform array: each element gets registers of its own.
+        AsmSlot *elems = (AsmSlot *) new_asm_array(actx, value->arraylen, sizeof (AsmSlot));
+        home->members = (AsmSlot *) new_asm_array(actx, value->arraylen, sizeof (AsmSlot));
+        if ((elems == NULL) || (home->members == NULL))
+            return 0;
+        else if (!asm_uniform_copy_elements(actx, value, elems))
+            return 0;
+        for (i = 0; i < value->arraylen; i++)
+        {
+            if (!asm_new_home(actx, &elems[i], &home->members[i]))
+                return 0;
+        } // for
+    } // else if
+    else if (value->ismatrix)
+    {
+        const int lines = value->matrix.rowmajor ? value->matrix.rows : value->matrix.columns;
+        for (i = 0; i < lines; i++)
+            home->matrix.lines[i] = new_asm_vreg(actx, value->matrix.lines[i].elements);
+    } // else if
+    else
+    {
+        home->value = new_asm_vreg(actx, value->value.elements);
+    } // else
+
+    return 1;
+} // asm_new_home
+
+static int asm_add_move(AsmRun *run, const AsmOperand *dst, const AsmOperand *src)
+{
+    const AsmOperand value = asm_resize(src, dst->elements);
+    int i;
+
+    // already there?
+    if ( (asm_same_register(dst, &value)) && (!value.negate) && (!value.relative) )
+    {
+        for (i = 0; i < dst->elements; i++)
+        {
+            if (dst->swizzle[i] != value.swizzle[i])
+                break;
+        } // for
+        if (i == dst->elements)
+            return 1;
+    } // if
+
+    if (!grow_asm_array(run->actx, (void **) &run->moves, &run->move_alloc,
+                        run->move_count + 2, sizeof (AsmOperand)))
+        return 0;
+    run->moves[run->move_count++] = *dst;
+    run->moves[run->move_count++] = value;
+    return 1;
+} // asm_add_move
+
+// The movs that put (value) in (home)'s registers.
+static int asm_home_moves(AsmRun *run, const AsmSlot *home,
+                          const AsmSlot *value)
+{
+    AsmContext *actx = run->actx;
+    AsmSlot zero, shaped;
+    int i;
+
+    if (!value->defined)
+    {
+        asm_zero_like(actx, home, &zero);
+        value = &zero;
+    } // if
+
+    if (home->members != NULL)
+    {
+        const int count = (home->structtype != NULL) ? home->structtype->structure.member_count : home->arraylen;
+        const AsmSlot *members = value->members;
+        if ((members == NULL) && (value->arraylen == count) && (home->structtype == NULL))
+        {
+            // a copy of a uniform array, still just its registers.
+            AsmSlot *elems = (AsmSlot *) new_asm_array(actx, count, sizeof (AsmSlot));
+            if ((elems == NULL) || (!asm_uniform_copy_elements(actx, value, elems)))
+                return 0;
+            members = elems;
+        } // if
+        else if (members == NULL)
+        {
+            fail(actx->ctx, "Internal error: a value changed shape in a loop or branch");
+            return 0;
+        } // else if
+        for (i = 0; i < count; i++)
+        {
+            if (!asm_home_moves(run, &home->members[i], &members[i]))
+                return 0;
+        } // for
+        return 1;
+    } // if
+
+    else if (home->ismatrix)
+    {
+        const AsmMatrix *m = &home->matrix;
+        const int lines = m->rowmajor ? m->rows : m->columns;
+        if (!asm_reshape_matrix(actx, value, m->rows, m->columns, m->rowmajor, &shaped))
+            return 0;
+        for (i = 0; i < lines; i++)
+        {
+            if (!asm_add_move(run, &m->lines[i], &shaped.matrix.lines[i]))
+                return 0;
+        } // for
+        return 1;
+    } // else if
+
+    else if ((value->ismatrix) || (value->members != NULL))
+    {
+        fail(actx->ctx, "Internal error: a value changed shape in a loop or branch");
+        return 0;
+    } // else if
+
+    return asm_add_move(run, &home->value, &value->value);
+} // asm_home_moves
+
+static int asm_collect_homes(AsmRun *run, const AsmRegion *region)
+{
+    int i;
+    run->move_count = 0;
+    for (i = 0; i < region->home_count; i++)
+    {
+        const AsmHome *home = &region->homes[i];
+        if (!asm_home_moves(run, &home->home, home->slot))
+            return 0;
+    } // for
+    return 1;
+} // asm_collect_homes
+
+// Does all the movs at once, as far as anyone can tell: a source that's some
+//  other mov's destination gets copied out of the way first.
+static void asm_emit_moves(AsmRun *run)
+{
+    AsmContext *actx = run->actx;
+    AsmOperand *moves = run->moves;
+    int i, j;
+
+    for (i = 1; i < run->move_count; i += 2)
+    {
+        for (j = 0; j < run->move_count; j += 2)
+        {
+            if ((j != i - 1) && (asm_same_register(&moves[i], &moves[j])))
+            {
+                moves[i] = asm_mov(actx, &moves[i]);
+                break;
+            } // if
+        } // for
+    } // for
+
+    for (i = 0; i < run->move_count; i += 2)
+        emit_asm(actx, ASMOP_MOV, 0, &moves[i], &moves[i+1], NULL, NULL, NULL);
+    run->move_count = 0;
+} // asm_emit_moves
+
+// Where (key) lives, and what's in it now (zeros if nothing wrote to it).
+static AsmSlot *asm_key_slot(AsmRun *run, const int key, AsmSlot *value)
+{
+    AsmContext *actx = run->actx;
+    Context *ctx = actx->ctx;
+    const IrFunction *irfn = &ctx->ir_funcs[run->frame->func];
+    const MOJOSHADER_astDataType *dt = NULL;
+    int elements = 0;
+    AsmSlot *slot;
+
+    if (key < run->live->temp_count)
+    {
+        slot = &run->frame->temps[key];
+        if ((key == irfn->rettemp - irfn->first_temp) && (irfn->ast != NULL))
+            dt = asm_return_type(irfn->ast->declaration);
+        else
+            elements = run->live->temp_elements[key];
+    } // if
+    else
+    {
+        const int index = key - run->live->temp_count;
+        slot = &run->frame->locals[index];
+        dt = run->fn->localtypes[index];
+    } // else
+
+    if (slot->defined)
+        *value = *slot;
+    else if (dt != NULL)
+        asm_zero_slot(actx, dt, 1, value);
+    else if ((elements >= 1) && (elements <= 4))
+        asm_zero_slot(actx, NULL, elements, value);
+    else
+    {
+        fail(ctx, "Internal error: can't tell what shape a temp is");
+        return NULL;
+    } // else
+
+    return slot;
+} // asm_key_slot
+
+// A struct's own index (or global) holds nothing; its members do.
+static int asm_is_struct_key(const AsmRun *run, const int key)
+{
+    const MOJOSHADER_astDataType *dt = NULL;
+    if (key >= run->live->temp_count)
+        dt = run->fn->localtypes[key - run->live->temp_count];
+    return ((dt != NULL) && (asm_struct_type(run->actx->ctx, dt) != NULL));
+} // asm_is_struct_key
+
+static int asm_is_struct_global(AsmContext *actx, const int g)
+{
+    const MOJOSHADER_astDataType *dt = actx->globals[g].datatype;
+    return ((dt != NULL) && (asm_struct_type(actx->ctx, dt) != NULL));
+} // asm_is_struct_global
+
+// Gives (keys) and (globals) new homes, and copies what they hold now into
+//  them if (init).
+static int asm_make_homes(AsmRun *run, AsmRegion *region, const uint32 *keys,
+                          const uint32 *globals, const int init)
+{
+    AsmContext *actx = run->actx;
+    const AsmLiveness *live = run->live;
+    AsmSlot value;
+    int count = 0;
+    int i;
+
+    for (i = 0; i < live->key_count; i++)
+        count += (asm_has_key(keys, i) && !asm_is_struct_key(run, i));
+    for (i = 1; i < actx->global_count; i++)
+        count += (asm_has_key(globals, i) && actx->globals[i].isstatic);
+
+    region->home_count = 0;
+    region->homes = (AsmHome *) new_asm_array(actx, count, sizeof (AsmHome));
+    if (region->homes == NULL)
+        return 0;
+
+    run->move_count = 0;
+    for (i = 0; i < live->key_count + actx->global_count; i++)
+    {
+        AsmHome *home = &region->homes[region->home_count];
+        if (i < live->key_count)
+        {
+            if ((!asm_has_key(keys, i)) || (asm_is_struct_key(run, i)))
+                continue;
+            else if ((home->slot = asm_key_slot(run, i, &value)) == NULL)
+                return 0;
+        } // if
+        else
+        {
+            const int g = i - live->key_count;
+            if ((g == 0) || (!asm_has_key(globals, g)) || (!actx->globals[g].isstatic))
+                continue;
+            else if (asm_is_struct_global(actx, g))
+                continue;
+            else if ((home->slot = asm_global_slot(actx, g)) == NULL)
+                return 0;
+            else if (home->slot->defined)
+                value = *home->slot;
+            else
+                asm_zero_slot(actx, actx->globals[g].datatype, 1, &value);
+        } // else
+
+        if (!asm_new_home(actx, &value, &home->home))
+            return 0;
+        else if ((init) && (!asm_home_moves(run, &home->home, &value)))
+            return 0;
+        region->home_count++;
+    } // for
+
+    asm_emit_moves(run);
+    return 1;
+} // asm_make_homes
+
+static void asm_bind_homes(const AsmRegion *region)
+{
+    int i;
+    for (i = 0; i < region->home_count; i++)
+        *region->homes[i].slot = region->homes[i].home;
+} // asm_bind_homes
+
+// Adds what's read after going to block (node) to (keys).
+static void asm_add_live(const AsmRun *run, const int node, uint32 *keys)
+{
+    const AsmLiveness *live = run->live;
+    const uint32 *set = live->returned;
+    int w;
+    if (node < run->fn->block_count)
+        set = live->livein + (node * live->words);
+    for (w = 0; w < live->words; w++)
+        keys[w] |= set[w];
+} // asm_add_live
+
+// What's read after going to (node), as (region) sees it: the end of a loop
+//  goes around again, or out one of the ways out.
+static void asm_live_at(const AsmRun *run, const int region, const int node,
+                        uint32 *keys)
+{
+    const AsmFunction *fn = run->fn;
+    int i;
+
+    memset(keys, '\0', run->live->words * sizeof (uint32));
+    if ((region < 0) || (node != fn->loops[region].last + 1))
+    {
+        asm_add_live(run, node, keys);
+        return;
+    } // if
+
+    const AsmLoop *loop = &fn->loops[region];
+    asm_add_live(run, loop->header, keys);
+    for (i = 0; i < loop->exit_count; i++)
+        asm_add_live(run, loop->exits[i], keys);
+} // asm_live_at
+
+// What blocks (first) to (last) might change that's read at (node), and
+//  which static globals they might change.
+static int asm_region_homes(AsmRun *run, AsmRegion *region, const int first,
+                            const int last, const int where, const int node,
+                            const int init)
+{
+    AsmContext *actx = run->actx;
+    const AsmLiveness *live = run->live;
+    uint32 *keys = (uint32 *) new_asm_array(actx, live->words, sizeof (uint32));
+    uint32 *globals = (uint32 *) new_asm_array(actx, live->global_words, sizeof (uint32));
+    uint32 *writes = (uint32 *) new_asm_array(actx, live->words, sizeof (uint32));
+    int b, w;
+
+    if ((keys == NULL) || (globals == NULL) || (writes == NULL))
+        return 0;
+
+    for (b = first; b <= last; b++)
+    {
+        for (w = 0; w < live->words; w++)
+            writes[w] |= live->writes[(b * live->words) + w];
+        for (w = 0; w < live->global_words; w++)
+            globals[w] |= live->global_writes[(b * live->global_words) + w];
+    } // for
+
+    asm_live_at(run, where, node, keys);
+    for (w = 0; w < live->words; w++)
+        keys[w] &= writes[w];
+
+    return asm_make_homes(run, region, keys, globals, init);
+} // asm_region_homes
+
+// Breaks out of loop (l) to go to block (to), if (pred) says so.
+static int asm_break(AsmRun *run, const int l, const int to,
+                     const AsmPredicate *pred)
+{
+    AsmContext *actx = run->actx;
+    const AsmLoop *loop = &run->fn->loops[l];
+    AsmRegion *region = &run->loops[l];
+    const AsmOperand zero = asm_zero(actx);
+    const AsmOperand *flag = NULL;
+    int i;
+
+    for (i = 1; i < loop->exit_count; i++)
+    {
+        if (loop->exits[i] == to)
+            flag = &region->flags[i];
+    } // for
+
+    if (!asm_collect_homes(run, region))
+        return 0;
+    else if ((!pred->always) && (run->move_count == 0) && (flag == NULL))
+    {
+        asm_flow(actx, ASMOP_BREAKNE, &pred->value, &zero);
+        return 1;
+    } // else if
+
+    if (!pred->always)
+        asm_flow(actx, ASMOP_IFNE, &pred->value, &zero);
+    asm_emit_moves(run);
+    if (flag != NULL)
+    {
+        const AsmOperand one = asm_one(actx);
+        emit_asm(actx, ASMOP_MOV, 0, flag, &one, NULL, NULL, NULL);
+    } // if
+    asm_flow(actx, ASMOP_BREAK, NULL, NULL);
+    if (!pred->always)
+        asm_flow(actx, ASMOP_ENDIF, NULL, NULL);
+    return 1;
+} // asm_break
+
+// Once loop (l) is done, whether it went to block (to).
+static AsmPredicate asm_loop_exit_predicate(AsmRun *run, const int l,
+                                            const int to)
+{
+    AsmContext *actx = run->actx;
+    const AsmLoop *loop = &run->fn->loops[l];
+    const AsmRegion *region = &run->loops[l];
+    AsmPredicate retval = region->entry;
+    AsmOperand sum;
+    int i;
+
+    for (i = 1; i < loop->exit_count; i++)
+    {
+        if (loop->exits[i] == to)
+        {
+            retval.always = 0;
+            retval.value = region->flags[i];
+            return retval;
+        } // if
+    } // for
+
+    // the way out at the bottom: whatever went in, less what broke out to
+    //  go somewhere else.
+    if (loop->exit_count == 1)
+        return retval;
+
+    sum = region->flags[1];
+    for (i = 2; i < loop->exit_count; i++)
+        sum = asm_op(actx, ASMOP_ADD, 1, &sum, &region->flags[i], NULL);
+
+    if (retval.always)
+        retval.value = asm_not(actx, &sum);
+    else
+    {
+        const AsmOperand negsum = asm_negate(&sum);
+        retval.value = asm_op(actx, ASMOP_ADD, 1, &retval.value, &negsum, NULL);
+    } // else
+
+    retval.always = 0;
+    return retval;
+} // asm_loop_exit_predicate
+
+// Flags start at zero before anything else, so they're still zero if the
+//  loop doesn't run at all. The homes go in before the if_ne for the same
+//  reason.
+static int asm_begin_loop(AsmRun *run, const int l)
+{
+    AsmContext *actx = run->actx;
+    const AsmLoop *loop = &run->fn->loops[l];
+    AsmRegion *region = &run->loops[l];
+    const AsmOperand zero = asm_zero(actx);
+    const AsmOperand i0 = asm_register(REG_TYPE_CONSTINT, 0, 1);
+    int i;
+
+    memset(region, '\0', sizeof (*region));
+    region->loop = l;
+    region->block = loop->header;
+    region->entry = run->preds[loop->header];
+    region->flags = (AsmOperand *) new_asm_array(actx, loop->exit_count, sizeof (AsmOperand));
+    if (region->flags == NULL)
+        return 0;
+
+    for (i = 1; i < loop->exit_count; i++)
+        region->flags[i] = asm_mov(actx, &zero);
+
+    if (!asm_region_homes(run, region, loop->header, loop->last, l, loop->last + 1, 1))
+        return 0;
+
+    if (!region->entry.always)
+    {
+        asm_flow(actx, ASMOP_IFNE, &region->entry.value, &zero);
+        region->wrapped = 1;
+    } // if
+
+    actx->repeats = 1;
+    asm_flow(actx, ASMOP_REP, &i0, NULL);
+    asm_bind_homes(region);
+    run->preds[loop->header] = asm_always;
+    run->stack[run->depth++] = region;
+    return 1;
+} // asm_begin_loop
+
+static int asm_end_loop(AsmRun *run, AsmRegion *region)
+{
+    AsmContext *actx = run->actx;
+    const AsmLoop *loop = &run->fn->loops[region->loop];
+    int i;
+
+    // going around again.
+    if (!asm_collect_homes(run, region))
+        return 0;
+    asm_emit_moves(run);
+
+    asm_flow(actx, ASMOP_ENDREP, NULL, NULL);
+    if (region->wrapped)
+        asm_flow(actx, ASMOP_ENDIF, NULL, NULL);
+    asm_bind_homes(region);
+    run->preds[loop->header] = region->entry;
+    run->depth--;
+
+    // breaking out of this loop to get out of the one it's in, too.
+    for (i = 1; (loop->parent >= 0) && (i < loop->exit_count); i++)
+    {
+        const AsmLoop *parent = &run->fn->loops[loop->parent];
+        const int to = loop->exits[i];
+        if ((to < parent->header) || (to > parent->last))
+        {
+            AsmPredicate pred;
+            pred.always = 0;
+            pred.value = region->flags[i];
+            if (!asm_break(run, loop->parent, to, &pred))
+                return 0;
+        } // if
+    } // for
+
+    return 1;
+} // asm_end_loop
+
+// Every temp, local and static global, as it is now.
+static AsmSlot *asm_save_slots(AsmRun *run)
+{
+    AsmContext *actx = run->actx;
+    const int temps = run->live->temp_count;
+    const int locals = run->fn->local_count;
+    AsmSlot *retval = (AsmSlot *) new_asm_array(actx, temps + locals + actx->global_count, sizeof (AsmSlot));
+    int i;
+
+    if (retval == NULL)
+        return NULL;
+
+    memcpy(retval, run->frame->temps, temps * sizeof (AsmSlot));
+    memcpy(retval + temps, run->frame->locals, locals * sizeof (AsmSlot));
+    for (i = 1; i < actx->global_count; i++)
+    {
+        if (actx->globals[i].isstatic)
+            retval[temps + locals + i] = actx->globals[i].slot;
+    } // for
+
+    return retval;
+} // asm_save_slots
+
+static void asm_restore_slots(AsmRun *run, const AsmSlot *saved)
+{
+    AsmContext *actx = run->actx;
+    const int temps = run->live->temp_count;
+    const int locals = run->fn->local_count;
+    int i;
+
+    memcpy(run->frame->temps, saved, temps * sizeof (AsmSlot));
+    memcpy(run->frame->locals, saved + temps, locals * sizeof (AsmSlot));
+    for (i = 1; i < actx->global_count; i++)
+    {
+        if (actx->globals[i].isstatic)
+            actx->globals[i].slot = saved[temps + locals + i];
+    } // for
+} // asm_restore_slots
+
+// Without a false side, the homes go in first, in case the true side doesn't
+//  run; otherwise both sides fill them in.
+static int asm_begin_branch(AsmRun *run, const int b)
+{
+    AsmContext *actx = run->actx;
+    const AsmFunction *fn = run->fn;
+    const AsmBlock *block = &fn->blocks[b];
+    const AsmOperand zero = asm_zero(actx);
+    AsmRegion *region = (AsmRegion *) new_asm_array(actx, 1, sizeof (AsmRegion));
+    if (region == NULL)
+        return 0;
+
+    region->loop = -1;
+    region->block = b;
+    region->join = block->join;
+    region->elsearm = asm_region_target(fn, block->loop, block->succ[1]);
+    region->entry = run->preds[b];
+
+    const AsmPredicate taken = asm_edge_predicate(actx, &run->preds[b], block, &run->conds[b], block->succ[0]);
+    if (!asm_region_homes(run, region, b + 1, region->join - 1, block->loop,
+                          region->join, region->elsearm == region->join))
+        return 0;
+    else if ((region->saved = asm_save_slots(run)) == NULL)
+        return 0;
+
+    asm_flow(actx, ASMOP_IFNE, &taken.value, &zero);
+    run->preds[b + 1] = asm_always;
+    run->preset[b + 1] = 1;
+    run->preset[region->elsearm] = (region->elsearm < region->join);
+    run->stack[run->depth++] = region;
+    return 1;
+} // asm_begin_branch
+
+// The end of one side of a branch. Each side starts with what was there
+//  going in, and afterwards, everything that's still needed is in its home.
+static int asm_end_arm(AsmRun *run, AsmRegion *region)
+{
+    AsmContext *actx = run->actx;
+
+    if (!asm_collect_homes(run, region))
+        return 0;
+    asm_emit_moves(run);
+    asm_restore_slots(run, region->saved);
+
+    if ((!region->inelse) && (region->elsearm < region->join))
+    {
+        asm_flow(actx, ASMOP_ELSE, NULL, NULL);
+        run->preds[region->elsearm] = region->entry;
+        region->inelse = 1;
+        return 1;
+    } // if
+
+    asm_flow(actx, ASMOP_ENDIF, NULL, NULL);
+    asm_bind_homes(region);
+    run->depth--;
+    return 1;
+} // asm_end_arm
+
+// Each basic block runs if the block that dominates it runs and it's always
+//  going to get there from that block; otherwise it runs if one of the edges
+//  into it was taken, and only one of them can be. (region) is the loop
+//  we're in, which sees the loops inside it as one block that's done by
+//  the time we get past it.
+static void asm_block_predicate(AsmRun *run, const int region, const int b)
+{
+    AsmContext *actx = run->actx;
+    const AsmFunction *fn = run->fn;
+    AsmPredicate *preds = run->preds;
+    int dom = fn->blocks[b].idom;
+    int first = 1;
+    int q, i;
+
+    const int domloop = asm_child_loop(fn, region, dom);
+    if (domloop >= 0)
+        dom = fn->loops[domloop].header;
+
+    for (q = dom; q < b; q = asm_region_ipdom(fn, region, q)) { /* spin */ }
+
+    if (q == b)  // always get here from our dominator.
+    {
+        preds[b] = preds[dom];
+        return;
+    } // if
+
+    for (q = dom; q < b; q++)
+    {
+        const AsmBlock *from = &fn->blocks[q];
+        const int loop = asm_child_loop(fn, region, q);
+        AsmPredicate edge;
+
+        if (!from->reachable)
+            continue;
+        else if (loop >= 0)
+        {
+            const AsmLoop *inner = &fn->loops[loop];
+            q = inner->last;
+            for (i = 0; i < inner->exit_count; i++)
+            {
+                if (inner->exits[i] == b)
+                    break;
+            } // for
+            if (i == inner->exit_count)
+                continue;
+            edge = asm_loop_exit_predicate(run, loop, b);
+        } // else if
+        else if ((from->succ[0] != b) && (from->succ[1] != b))
+            continue;
+        else
+            edge = asm_edge_predicate(actx, &preds[q], from, &run->conds[q], b);
+
+        if (first)
+            preds[b] = edge;
+        else if ((preds[b].always) || (edge.always))
+            preds[b].always = 1;
+        else
+            preds[b].value = asm_op(actx, ASMOP_ADD, 1, &preds[b].value, &edge.value, NULL);
+        first = 0;
+    } // for
+} // asm_block_predicate
+
+static int asm_run_blocks(AsmRun *run, const AsmPredicate *entry)
+{
+    AsmContext *actx = run->actx;
+    const AsmFunction *fn = run->fn;
+    int b, i;
+
+    for (b = 0; b < fn->block_count; b++)
+    {
+        const AsmBlock *block = &fn->blocks[b];
+        const int loop = block->loop;
+        const int isheader = ((loop >= 0) && (fn->loops[loop].header == b));
+
+        if (block->reachable)
+        {
+            if (b == 0)
+                run->preds[b] = *entry;
+            else if (!run->preset[b])
+                asm_block_predicate(run, isheader ? fn->loops[loop].parent : loop, b);
+
+            if ((isheader) && (!asm_begin_loop(run, loop)))
+                return 0;
+
+            for (i = 0; i < block->count; i++)
+            {
+                const MOJOSHADER_irStatement *stmt = fn->stmts[block->first + i];
+                if (!asm_statement(actx, run->frame, &run->preds[b], stmt, &run->conds[b]))
+                    return 0;
+            } // for
+
+            // jumping out of the loop is a break.
+            for (i = 0; (loop >= 0) && (i < 2); i++)
+            {
+                const AsmLoop *l = &fn->loops[loop];
+                const int s = block->succ[i];
+                if ((s < 0) || ((i == 1) && (s == block->succ[0])))
+                    continue;
+                else if ((s < l->header) || (s > l->last))
+                {
+                    const AsmPredicate edge = asm_edge_predicate(actx, &run->preds[b], block, &run->conds[b], s);
+                    if (!asm_break(run, loop, s, &edge))
+                        return 0;
+                } // else if
+            } // for
+
+            if ((block->join >= 0) && (!asm_begin_branch(run, b)))
+                return 0;
+        } // if
+
+        // close whatever ends here, innermost first.
+        while (run->depth > 0)
+        {
+            AsmRegion *region = run->stack[run->depth - 1];
+            if (region->loop >= 0)
+            {
+                if (fn->loops[region->loop].last != b)
+                    break;
+                else if (!asm_end_loop(run, region))
+                    return 0;
+            } // if
+            else
+            {
+                const int end = region->inelse ? region->join : region->elsearm;
+                if (end - 1 != b)
+                    break;
+                else if (!asm_end_arm(run, region))
+                    return 0;
+            } // else
+        } // while
+    } // for
+
+    return 1;
+} // asm_run_blocks
+
+// Runs a function's code with (entry) as its predicate. Blocks are
+//  predicated, except for the loops and [branch] ifs that Shader Model 3
+//  runs for real; see asm_block_predicate().
+static int asm_run_function(AsmContext *actx, AsmFrame *frame,
+                            const AsmPredicate *entry)
+{
+    Context *ctx = actx->ctx;
+    const AsmFunction *fn = asm_function(actx, frame->func);
+    AsmRun run;
+
+    if (fn == NULL)
+        return 0;
+    else if (fn->block_count == 0)
+        return 1;
+
+    memset(&run, '\0', sizeof (run));
+    run.actx = actx;
+    run.frame = frame;
+    run.fn = fn;
+    run.preds = (AsmPredicate *) new_asm_array(actx, fn->block_count, sizeof (AsmPredicate));
+    run.conds = (AsmOperand *) new_asm_array(actx, fn->block_count, sizeof (AsmOperand));
+    run.preset = (uint8 *) new_asm_array(actx, fn->block_count, sizeof (uint8));
+    if ((run.preds == NULL) || (run.conds == NULL) || (run.preset == NULL))
+        return 0;
+
+    if ((fn->loop_count > 0) || (fn->branches))
+    {
+        run.live = asm_liveness(actx, frame->func);
+        run.loops = (AsmRegion *) new_asm_array(actx, fn->loop_count, sizeof (AsmRegion));
+        run.stack = (AsmRegion **) new_asm_array(actx, fn->block_count + fn->loop_count, sizeof (AsmRegion *));
+        if ((run.live == NULL) || (run.loops == NULL) || (run.stack == NULL))
+            return 0;
+    } // if
+
+    const int retval = asm_run_blocks(&run, entry);
+    if (run.moves != NULL)
+        Free(ctx, run.moves);
+    return (retval) && (!isfail(ctx));
+} // asm_run_function
+
+// What a local variable holds right now (structs are pulled together).
+static int asm_local_value(AsmContext *actx, AsmFrame *frame, const int index,
+                           const MOJOSHADER_astDataType *dt, AsmSlot *out)
+{
+    const AsmFunction *fn = &actx->funcs[frame->func];
+    int i;
+
+    dt = asm_reduce(actx->ctx, dt);
+    if ((index <= 0) || (index >= fn->local_count))
+    {
+        fail(actx->ctx, "Internal error: unknown local variable");
+        return 0;
+    } // if
+
+    const MOJOSHADER_astDataType *sdt = asm_struct_type(actx->ctx, dt);
+    if (sdt == NULL)
+    {
+        if (frame->locals[index].defined)
+            *out = frame->locals[index];
+        else
+            asm_zero_slot(actx, dt, 1, out);
+        return 1;
+    } // if
+
+    const MOJOSHADER_astDataTypeStruct *s = &sdt->structure;
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+    out->structtype = sdt;
+    if (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+        out->arraylen = dt->array.elements;
+    out->members = (AsmSlot *) new_asm_array(actx, s->member_count, sizeof (AsmSlot));
+    if (out->members == NULL)
+        return 0;
+    for (i = 0; i < s->member_count; i++)
+    {
+        const int midx = index + datatype_member_offset(actx->ctx, dt, i);
+        const MOJOSHADER_astDataType *mdt = asm_member_type(actx->ctx, dt, i);
+        if (!asm_local_value(actx, frame, midx, mdt, &out->members[i]))
+            return 0;
+    } // for
+    return 1;
+} // asm_local_value
+
+// Sets a local variable (structs are spread across their members' indexes).
+static int asm_set_local(AsmContext *actx, AsmFrame *frame, const int index,
+                         const MOJOSHADER_astDataType *dt, const AsmSlot *value)
+{
+    const AsmFunction *fn = &actx->funcs[frame->func];
+    int i;
+
+    dt = asm_reduce(actx->ctx, dt);
+    if ((index <= 0) || (index >= fn->local_count))
+    {
+        fail(actx->ctx, "Internal error: unknown local variable");
+        return 0;
+    } // if
+    else if (asm_struct_type(actx->ctx, dt) == NULL)
+        return asm_store_slot(actx, &asm_always, &frame->locals[index], dt, value);
+    else if ((value->members == NULL) || (value->structtype == NULL))
+    {
+        fail(actx->ctx, "Internal error: storing something that isn't a struct in a struct");
+        return 0;
+    } // else if
+
+    for (i = 0; i < value->structtype->structure.member_count; i++)
+    {
+        const int midx = index + datatype_member_offset(actx->ctx, dt, i);
+        const MOJOSHADER_astDataType *mdt = asm_member_type(actx->ctx, dt, i);
+        if (!asm_set_local(actx, frame, midx, mdt, &value->members[i]))
+            return 0;
+    } // for
+
+    return 1;
+} // asm_set_local
+
+// User functions get inlined: Shader Model 2 can't call anything with
+//  arguments, and we're flattening everything anyhow.
+static int asm_call(AsmContext *actx, AsmFrame *frame,
+                    const AsmPredicate *pred,
+                    const MOJOSHADER_irCall *call, AsmSlot *out)
+{
+    Context *ctx = actx->ctx;
+    const int index = call->index;
+    const MOJOSHADER_astFunctionParameters *param;
+    const MOJOSHADER_irExprList *arg;
+    AsmFrame callee;
+    AsmSlot value;
+    int retval = 0;
+    int i;
+
+    if ((index <= 0) || (index > ctx->user_func_index) || (ctx->ir_funcs[index].ast == NULL))
+    {
+        fail(ctx, "Function is called but never defined");
+        return 0;
+    } // if
+
+    for (i = 0; i <= actx->depth; i++)
+    {
+        if (actx->inlining[i] == index)
+        {
+            fail(ctx, "Recursive function calls aren't allowed");
+            return 0;
+        } // if
+    } // for
+
+    if (actx->depth >= ASM_MAX_INLINE_DEPTH)
+    {
+        failf(ctx, "Function calls nest more than %d deep",
+              ASM_MAX_INLINE_DEPTH);
+        return 0;
+    } // if
+    else if (asm_function(actx, index) == NULL)
+        return 0;
+    else if (!asm_new_frame(actx, index, &callee))
+        return 0;
+
+    const IrFunction *irfn = &ctx->ir_funcs[index];
+    const MOJOSHADER_astFunctionSignature *sig = irfn->ast->declaration;
+
+    arg = call->args;
+    for (param = sig->params; (param != NULL) && (arg != NULL); param = param->next, arg = arg->next)
+    {
+        if (param->input_modifier == MOJOSHADER_AST_INPUTMOD_OUT)
+            continue;
+        else if (!asm_expr(actx, frame, pred, arg->expr, &value))
+            return 0;
+        else if (!asm_set_local(actx, &callee, param->index, param->datatype, &value))
+            return 0;
+    } // for
+
+    actx->inlining[++actx->depth] = index;
+    retval = asm_run_function(actx, &callee, pred);
+    actx->depth--;
+
+    // copy out and inout parameters back to the caller.
+    arg = call->args;
+    for (param = sig->params; (retval) && (param != NULL) && (arg != NULL); param = param->next, arg = arg->next)
+    {
+        if ( (param->input_modifier != MOJOSHADER_AST_INPUTMOD_OUT) &&
+             (param->input_modifier != MOJOSHADER_AST_INPUTMOD_INOUT) )
+            continue;
+        retval = asm_local_value(actx, &callee, param->index, param->datatype, &value) &&
+                 asm_store(actx, frame, pred, arg->expr, &value);
+    } // for
+
+    if (!retval)
+        return 0;
+    else if (irfn->rettemp < 0)
+        asm_zero_slot(actx, NULL, 1, out);  // void; nothing should read this.
+    else
+    {
+        const AsmSlot *ret = &callee.temps[irfn->rettemp - irfn->first_temp];
+        if (ret->defined)
+            *out = *ret;
+        else
+            asm_zero_slot(actx, asm_return_type(sig), 1, out);
+    } // else
+
+    return 1;
+} // asm_call
+
+
+// Entry point inputs and outputs...
+
+typedef struct AsmSemantic
+{
+    const char *name;
+    MOJOSHADER_usage usage;
+} AsmSemantic;
+
+static const AsmSemantic asm_semantics[] = {
+    { "SV_Position", MOJOSHADER_USAGE_POSITION },
+    { "SV_Target", MOJOSHADER_USAGE_COLOR },
+    { "SV_Depth", MOJOSHADER_USAGE_DEPTH },
+    { "POSITION", MOJOSHADER_USAGE_POSITION },
+    { "BLENDWEIGHT", MOJOSHADER_USAGE_BLENDWEIGHT },
+    { "BLENDINDICES", MOJOSHADER_USAGE_BLENDINDICES },
+    { "NORMAL", MOJOSHADER_USAGE_NORMAL },
+    { "PSIZE", MOJOSHADER_USAGE_POINTSIZE },
+    { "TEXCOORD", MOJOSHADER_USAGE_TEXCOORD },
+    { "TANGENT", MOJOSHADER_USAGE_TANGENT },
+    { "BINORMAL", MOJOSHADER_USAGE_BINORMAL },
+    { "TESSFACTOR", MOJOSHADER_USAGE_TESSFACTOR },
+    { "COLOR", MOJOSHADER_USAGE_COLOR },
+    { "FOG", MOJOSHADER_USAGE_FOG },
+    { "DEPTH", MOJOSHADER_USAGE_DEPTH },
+};
+
+// "TEXCOORD3" is usage TEXCOORD, index 3. Returns zero if we don't know it.
+static int asm_parse_semantic(const char *semantic, MOJOSHADER_usage *usage,
+                              int *index)
+{
+    size_t i;
+    for (i = 0; i < STATICARRAYLEN(asm_semantics); i++)
+    {
+        const AsmSemantic *s = &asm_semantics[i];
+        const size_t len = strlen(s->name);
+        const char *ptr = semantic + len;
+        if (strncasecmp(semantic, s->name, len) != 0)
+            continue;
+
+        *usage = s->usage;
+        *index = 0;
+        for (; (*ptr >= '0') && (*ptr <= '9'); ptr++)
+            *index = (*index * 10) + (*ptr - '0');
+        if (*ptr == '\0')
+            return 1;
+    } // for
+
+    return 0;
+} // asm_parse_semantic
+
+static int asm_add_io(AsmContext *actx, AsmIO *list, int *count,
+                      const MOJOSHADER_usage usage, const int index,
+                      const AsmOperand *reg)
+{
+    if (*count >= ASM_MAX_IO)
+    {
+        fail(actx->ctx, "Too many entry point inputs or outputs");
+        return 0;
+    } // if
+    list[*count].usage = usage;
+    list[*count].index = index;
+    list[*count].reg = *reg;
+    (*count)++;
+    return 1;
+} // asm_add_io
+
+// One input register, for semantic (semantic) plus (row): matrices and
+//  arrays take one semantic index per row or element, counting up.
+static int asm_input_register(AsmContext *actx, const char *semantic,
+                              const int row, const int elements,
+                              AsmOperand *out)
+{
+    Context *ctx = actx->ctx;
+    MOJOSHADER_usage usage = MOJOSHADER_USAGE_UNKNOWN;
+    RegisterType regtype = REG_TYPE_INPUT;
+    int regnum = -1;
+    int index = 0;
+    int i;
+
+    if ((actx->pixel) && (actx->major >= 3) && (strcasecmp(semantic, "VPOS") == 0))
+        regtype = REG_TYPE_MISCTYPE, regnum = 0;
+    else if ((actx->pixel) && (actx->major >= 3) && (strcasecmp(semantic, "VFACE") == 0))
+        regtype = REG_TYPE_MISCTYPE, regnum = 1;
+    else if (!asm_parse_semantic(semantic, &usage, &index))
+    {
+        failf(ctx, "Unknown or unsupported input semantic '%s'", semantic);
+        return 0;
+    } // else if
+
+    if ((regtype == REG_TYPE_MISCTYPE) && (row > 0))
+    {
+        failf(ctx, "Input '%s' has to be a scalar or vector", semantic);
+        return 0;
+    } // if
+
+    index += row;
+    if (regtype == REG_TYPE_MISCTYPE)
+        ;  // VPOS and VFACE are where they are.
+    else if ((actx->pixel) && (actx->major < 3))
+    {
+        // ps_2_0 only has colors and texture coordinates coming in.
+        if ((usage == MOJOSHADER_USAGE_COLOR) && (index < 2))
+            regnum = index;
+        else if ((usage == MOJOSHADER_USAGE_TEXCOORD) && (index < 8))
+            regtype = REG_TYPE_TEXTURE, regnum = index;
+        else
+        {
+            failf(ctx, "Input semantic '%s' isn't available in ps_2_0", semantic);
+            return 0;
+        } // else
+    } // else if
+
+    // already have this one?
+    for (i = 0; i < actx->input_count; i++)
+    {
+        const AsmIO *io = &actx->inputs[i];
+        if ( ((regnum >= 0) && (io->reg.regtype == regtype) && (io->reg.regnum == regnum)) ||
+             ((regnum < 0) && (io->usage == usage) && (io->index == index)) )
+        {
+            *out = asm_register(io->reg.regtype, io->reg.regnum, elements);
+            return 1;
+        } // if
+    } // for
+
+    if (regnum < 0)  // vertex shaders and ps_3_0 just count up.
+    {
+        regnum = 0;
+        for (i = 0; i < actx->input_count; i++)
+        {
+            if (actx->inputs[i].reg.regtype == REG_TYPE_INPUT)
+                regnum++;
+        } // for
+
+        if (regnum >= (actx->pixel ? 10 : 16))
+        {
+            fail(ctx, "Too many entry point inputs");
+            return 0;
+        } // if
+    } // if
 
-static MOJOSHADER_irExpression *new_ir_convert(Context *ctx, MOJOSHADER_irExpression *expr,
-                                               const MOJOSHADER_astDataTypeType type,
-                                               const int elements)
-{
-    NEW_IR_EXPR(retval, MOJOSHADER_irConvert, MOJOSHADER_IR_CONVERT, type, elements);
-    retval->expr = expr;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_convert
+    *out = asm_register(regtype, regnum, elements);
+    return asm_add_io(actx, actx->inputs, &actx->input_count, usage, index, out);
+} // asm_input_register
 
-static MOJOSHADER_irExpression *new_ir_construct(Context *ctx, MOJOSHADER_irExprList *args,
-                                               const MOJOSHADER_astDataTypeType type,
-                                               const int elements)
+// A scalar, vector or matrix input, starting at (row); see asm_input().
+static int asm_input_value(AsmContext *actx, const char *semantic,
+                           const int row, const MOJOSHADER_astDataType *dt,
+                           AsmSlot *out)
 {
-    NEW_IR_EXPR(retval, MOJOSHADER_irConstruct, MOJOSHADER_IR_CONSTRUCT, type, elements);
-    retval->args = args;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_construct
+    Context *ctx = actx->ctx;
+    int i;
 
-static MOJOSHADER_irExpression *new_ir_call(Context *ctx, const int index,
-                                            MOJOSHADER_irExprList *args,
-                                            const MOJOSHADER_astDataTypeType type,
-                                            const int elements)
-{
-    NEW_IR_EXPR(retval, MOJOSHADER_irCall, MOJOSHADER_IR_CALL, type, elements);
-    retval->args = args;
-    retval->index = index;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_call
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
 
-static MOJOSHADER_irExpression *new_ir_swizzle(Context *ctx,
-                                               MOJOSHADER_irExpression *expr,
-                                               const char *channels,
-                                               const MOJOSHADER_astDataTypeType type,
-                                               const int elements)
-{
-    NEW_IR_EXPR(retval, MOJOSHADER_irSwizzle, MOJOSHADER_IR_SWIZZLE, type, elements);
-    retval->expr = expr;
-    memcpy(retval->channels, channels, sizeof (retval->channels));
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_swizzle
+    dt = asm_reduce(ctx, dt);
+    if (dt->type != MOJOSHADER_AST_DATATYPE_MATRIX)
+    {
+        const int elements = asm_datatype_elems(ctx, dt);
+        if (elements > 4)
+        {
+            failf(ctx, "Input '%s' has a type the code generator can't handle", semantic);
+            return 0;
+        } // if
+        return asm_input_register(actx, semantic, row, elements, &out->value);
+    } // if
 
-static MOJOSHADER_irExpression *new_ir_memory(Context *ctx, const int index,
-                                              const MOJOSHADER_astDataTypeType type,
-                                              const int elements)
-{
-    NEW_IR_EXPR(retval, MOJOSHADER_irMemory, MOJOSHADER_IR_MEMORY, type, elements);
-    retval->index = index;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_memory
+    // like vertex buffers hand them over: a row per semantic index.
+    out->ismatrix = 1;
+    out->matrix.rows = dt->matrix.rows;
+    out->matrix.columns = dt->matrix.columns;
+    out->matrix.rowmajor = 1;
+    for (i = 0; i < dt->matrix.rows; i++)
+    {
+        if (!asm_input_register(actx, semantic, row + i, dt->matrix.columns, &out->matrix.lines[i]))
+            return 0;
+    } // for
+    return 1;
+} // asm_input_value
 
-static MOJOSHADER_irExpression *new_ir_array(Context *ctx,
-                                             MOJOSHADER_irExpression *array,
-                                             MOJOSHADER_irExpression *element,
-                                             const MOJOSHADER_astDataTypeType type,
-                                             const int elements)
+// An entry point input. Arrays of scalars, vectors and matrices count up
+//  from their semantic's index, an element at a time.
+static int asm_input(AsmContext *actx, const char *semantic,
+                     const MOJOSHADER_astDataType *dt, AsmSlot *out)
 {
-    NEW_IR_EXPR(retval, MOJOSHADER_irArray, MOJOSHADER_IR_ARRAY, type, elements);
-    retval->array = array;
-    retval->element = element;
-    return (MOJOSHADER_irExpression *) retval;
-} // new_ir_array
+    Context *ctx = actx->ctx;
+    int i;
 
-static MOJOSHADER_irStatement *new_ir_seq(Context *ctx,
-                                     MOJOSHADER_irStatement *first,
-                                     MOJOSHADER_irStatement *next)
+    dt = asm_reduce(ctx, dt);
+    if (semantic == NULL)
+    {
+        fail(ctx, "Entry point inputs need semantics");
+        return 0;
+    } // if
+    else if (dt->type != MOJOSHADER_AST_DATATYPE_ARRAY)
+        return asm_input_value(actx, semantic, 0, dt, out);
+
+    const MOJOSHADER_astDataType *elemtype = asm_reduce(ctx, dt->array.base);
+    const int rows = (elemtype->type == MOJOSHADER_AST_DATATYPE_MATRIX) ? elemtype->matrix.rows : 1;
+    if ( (elemtype->type == MOJOSHADER_AST_DATATYPE_ARRAY) ||
+         (elemtype->type == MOJOSHADER_AST_DATATYPE_STRUCT) )
+    {
+        failf(ctx, "Input '%s' has a type the code generator can't handle", semantic);
+        return 0;
+    } // if
+
+    memset(out, '\0', sizeof (*out));
+    out->defined = 1;
+    out->arraylen = dt->array.elements;
+    out->elemtype = elemtype;
+    out->members = (AsmSlot *) new_asm_array(actx, out->arraylen, sizeof (AsmSlot));
+    if (out->members == NULL)
+        return 0;
+    for (i = 0; i < out->arraylen; i++)
+    {
+        if (!asm_input_value(actx, semantic, i * rows, elemtype, &out->members[i]))
+            return 0;
+    } // for
+    return 1;
+} // asm_input
+
+// Writes (src) to the output register for semantic (semantic) plus (row);
+//  see asm_input_register().
+static int asm_output_register(AsmContext *actx, const char *semantic,
+                               const int row, const AsmOperand *_src)
 {
-    assert((first != NULL) || (next != NULL));
-    if (first == NULL)  // don't generate a SEQ if unnecessary.
-        return next;
-    else if (next == NULL)
-        return first;
+    Context *ctx = actx->ctx;
+    MOJOSHADER_usage usage = MOJOSHADER_USAGE_UNKNOWN;
+    RegisterType regtype = REG_TYPE_OUTPUT;
+    int elements = _src->elements;
+    int scalar = 0;
+    int regnum = -1;
+    int index = 0;
+    int i;
 
-    NEW_IR_NODE(retval, MOJOSHADER_irSeq, MOJOSHADER_IR_SEQ);
-    retval->first = first;
-    retval->next = next;
-    return (MOJOSHADER_irStatement *) retval;
-} // new_ir_seq
+    if (!asm_parse_semantic(semantic, &usage, &index))
+    {
+        failf(ctx, "Unknown or unsupported output semantic '%s'", semantic);
+        return 0;
+    } // if
 
-static MOJOSHADER_irStatement *new_ir_jump(Context *ctx, const int label)
+    index += row;
+    if (actx->pixel)
+    {
+        if ((usage == MOJOSHADER_USAGE_COLOR) && (index < 4))
+            regtype = REG_TYPE_COLOROUT, regnum = index;
+        else if ((usage == MOJOSHADER_USAGE_DEPTH) && (index == 0))
+            regtype = REG_TYPE_DEPTHOUT, regnum = 0, scalar = 1;
+    } // if
+    else if (actx->major < 3)
+    {
+        if ((usage == MOJOSHADER_USAGE_POSITION) && (index == 0))
+            regtype = REG_TYPE_RASTOUT, regnum = 0;
+        else if ((usage == MOJOSHADER_USAGE_FOG) && (index == 0))
+            regtype = REG_TYPE_RASTOUT, regnum = 1, scalar = 1;
+        else if ((usage == MOJOSHADER_USAGE_POINTSIZE) && (index == 0))
+            regtype = REG_TYPE_RASTOUT, regnum = 2, scalar = 1;
+        else if ((usage == MOJOSHADER_USAGE_COLOR) && (index < 2))
+            regtype = REG_TYPE_ATTROUT, regnum = index;
+        else if ((usage == MOJOSHADER_USAGE_TEXCOORD) && (index < 8))
+            regtype = REG_TYPE_TEXCRDOUT, regnum = index;
+    } // else if
+    else
+    {
+        regnum = actx->output_count;
+        if (regnum >= 12)
+        {
+            fail(ctx, "Too many entry point outputs");
+            return 0;
+        } // if
+    } // else
+
+    if (regnum < 0)
+    {
+        failf(ctx, "Output semantic '%s' isn't available in %s", semantic,
+              ctx->source_profile + 5);
+        return 0;
+    } // if
+
+    for (i = 0; i < actx->output_count; i++)
+    {
+        const AsmIO *io = &actx->outputs[i];
+        if ((io->usage == usage) && (io->index == index))
+        {
+            failf(ctx, "Output semantic '%s' is used more than once", semantic);
+            return 0;
+        } // if
+    } // for
+
+    AsmOperand src = *_src;
+    if (scalar)
+        elements = 1;
+    else if (regtype == REG_TYPE_COLOROUT)
+    {
+        // pixel shaders have to write all of a color; alpha defaults to 1.
+        AsmOperand comps[4];
+        const AsmOperand zero = asm_zero(actx);
+        for (i = 0; i < 4; i++)
+        {
+            if (i < src.elements)
+                comps[i] = asm_component(&src, i);
+            else
+                comps[i] = (i == 3) ? asm_one(actx) : zero;
+        } // for
+        src = asm_gather(actx, comps, 4);
+        elements = 4;
+    } // else if
+
+    src = asm_resize(&src, elements);
+    const AsmOperand dst = asm_register(regtype, regnum, elements);
+    emit_asm(actx, ASMOP_MOV, 0, &dst, &src, NULL, NULL, NULL);
+    return asm_add_io(actx, actx->outputs, &actx->output_count, usage, index, &dst);
+} // asm_output_register
+
+// A scalar, vector or matrix output, starting at (row); see asm_output().
+static int asm_output_value(AsmContext *actx, const char *semantic,
+                            const int row, const MOJOSHADER_astDataType *dt,
+                            const AsmSlot *value)
 {
-    NEW_IR_NODE(retval, MOJOSHADER_irJump, MOJOSHADER_IR_JUMP);
-    retval->label = label;
-    return (MOJOSHADER_irStatement *) retval;
-} // new_ir_jump
+    Context *ctx = actx->ctx;
+    AsmSlot rows;
+    int i;
 
-static MOJOSHADER_irStatement *new_ir_cjump(Context *ctx,
-                                       const MOJOSHADER_irConditionType cond,
-                                       MOJOSHADER_irExpression *left,
-                                       MOJOSHADER_irExpression *right,
-                                       const int iftrue, const int iffalse)
+    dt = asm_reduce(ctx, dt);
+    if (dt->type != MOJOSHADER_AST_DATATYPE_MATRIX)
+    {
+        if ((asm_datatype_elems(ctx, dt) > 4) || (value->ismatrix) || (value->members != NULL))
+        {
+            failf(ctx, "Output '%s' has a type the code generator can't handle", semantic);
+            return 0;
+        } // if
+        return asm_output_register(actx, semantic, row, &value->value);
+    } // if
+
+    // a row per semantic index, like inputs.
+    if (!asm_reshape_matrix(actx, value, dt->matrix.rows, dt->matrix.columns, 1, &rows))
+        return 0;
+    for (i = 0; i < dt->matrix.rows; i++)
+    {
+        if (!asm_output_register(actx, semantic, row + i, &rows.matrix.lines[i]))
+            return 0;
+    } // for
+    return 1;
+} // asm_output_value
+
+// An entry point output; arrays count up like asm_input()'s.
+static int asm_output(AsmContext *actx, const char *semantic,
+                      const MOJOSHADER_astDataType *dt, const AsmSlot *value)
 {
-    NEW_IR_NODE(retval, MOJOSHADER_irCJump, MOJOSHADER_IR_CJUMP);
-    retval->cond = cond;
-    retval->left = left;
-    retval->right = right;
-    retval->iftrue = iftrue;
-    retval->iffalse = iffalse;
-    return (MOJOSHADER_irStatement *) retval;
-} // new_ir_cjump
+    Context *ctx = actx->ctx;
+    AsmSlot elem;
+    int i;
 
-static MOJOSHADER_irStatement *new_ir_label(Context *ctx, const int index)
+    dt = asm_reduce(ctx, dt);
+    if (semantic == NULL)
+    {
+        fail(ctx, "Entry point outputs need semantics");
+        return 0;
+    } // if
+    else if (dt->type != MOJOSHADER_AST_DATATYPE_ARRAY)
+        return asm_output_value(actx, semantic, 0, dt, value);
+
+    const MOJOSHADER_astDataType *elemtype = asm_reduce(ctx, dt->array.base);
+    const int rows = (elemtype->type == MOJOSHADER_AST_DATATYPE_MATRIX) ? elemtype->matrix.rows : 1;
+    if ( (elemtype->type == MOJOSHADER_AST_DATATYPE_ARRAY) ||
+         (elemtype->type == MOJOSHADER_AST_DATATYPE_STRUCT) ||
+         (value->arraylen != dt->array.elements) )
+    {
+        failf(ctx, "Output '%s' has a type the code generator can't handle", semantic);
+        return 0;
+    } // if
+
+    for (i = 0; i < dt->array.elements; i++)
+    {
+        if (value->members != NULL)
+            elem = value->members[i];
+        else if (!asm_uniform_element(actx, value, NULL, i, &elem))  // a uniform's copy.
+            return 0;
+
+        if (!asm_output_value(actx, semantic, i * rows, elemtype, &elem))
+            return 0;
+    } // for
+    return 1;
+} // asm_output
+
+static const MOJOSHADER_astStructDeclaration *asm_find_struct(AsmContext *actx,
+                                            const MOJOSHADER_astDataType *dt)
 {
-    NEW_IR_NODE(retval, MOJOSHADER_irLabel, MOJOSHADER_IR_LABEL);
-    retval->index = index;
-    return (MOJOSHADER_irStatement *) retval;
-} // new_ir_label
+    const MOJOSHADER_astCompilationUnit *ast;
+    for (ast = &actx->ctx->ast->compunit; ast != NULL; ast = ast->next)
+    {
+        if (ast->ast.type == MOJOSHADER_AST_COMPUNIT_STRUCT)
+        {
+            const MOJOSHADER_astStructDeclaration *decl = ((const MOJOSHADER_astCompilationUnitStruct *) ast)->struct_info;
+            if (asm_reduce(actx->ctx, decl->datatype) == dt)
+                return decl;
+        } // if
+    } // for
+    return NULL;
+} // asm_find_struct
 
-static MOJOSHADER_irStatement *new_ir_move(Context *ctx,
-                                      MOJOSHADER_irExpression *dst,
-                                      MOJOSHADER_irExpression *src,
-                                      const int writemask)
+// Inputs for a parameter, or outputs for a parameter or return value:
+//  structs use their members' semantics, and structs in those, theirs.
+static int asm_entry_io(AsmContext *actx, AsmFrame *frame, const int isinput,
+                        const int index, const MOJOSHADER_astDataType *dt,
+                        const char *semantic, const AsmSlot *value)
 {
-    NEW_IR_NODE(retval, MOJOSHADER_irMove, MOJOSHADER_IR_MOVE);
-    assert(dst && src && (dst->info.type == src->info.type));
-    assert(dst && src && (dst->info.elements == src->info.elements));
-    retval->dst = dst;
-    retval->src = src;
-    retval->writemask = writemask;
-    return (MOJOSHADER_irStatement *) retval;
-} // new_ir_move
+    Context *ctx = actx->ctx;
+    AsmSlot slot;
+    int i;
 
-static MOJOSHADER_irStatement *new_ir_expr_stmt(Context *ctx, MOJOSHADER_irExpression *expr)
+    dt = asm_reduce(ctx, dt);
+    if (dt->type != MOJOSHADER_AST_DATATYPE_STRUCT)
+    {
+        if (!isinput)
+            return asm_output(actx, semantic, dt, value);
+        return ( asm_input(actx, semantic, dt, &slot) &&
+                 asm_store_slot(actx, &asm_always, &frame->locals[index], dt, &slot) );
+    } // if
+
+    const MOJOSHADER_astStructDeclaration *decl = asm_find_struct(actx, dt);
+    const MOJOSHADER_astStructMembers *member = (decl != NULL) ? decl->members : NULL;
+    if (member == NULL)
+    {
+        fail(ctx, "Internal error: can't find the struct for an entry point's semantics");
+        return 0;
+    } // if
+    else if ((!isinput) && (value->members == NULL))
+    {
+        fail(ctx, "Internal error: output struct has no members");
+        return 0;
+    } // else if
+
+    for (i = 0; (member != NULL) && (i < dt->structure.member_count); i++, member = member->next)
+    {
+        const MOJOSHADER_astDataType *mdt = dt->structure.members[i].datatype;
+        const int midx = index + datatype_member_offset(ctx, dt, i);
+        const AsmSlot *mvalue = isinput ? NULL : &value->members[i];
+        if (!asm_entry_io(actx, frame, isinput, midx, mdt, member->semantic, mvalue))
+            return 0;
+    } // for
+
+    return 1;
+} // asm_entry_io
+
+static int asm_entry_point(AsmContext *actx)
 {
-    NEW_IR_NODE(retval, MOJOSHADER_irExprStmt, MOJOSHADER_IR_EXPR_STMT);
-    retval->expr = expr;
-    return (MOJOSHADER_irStatement *) retval;
-} // new_ir_expr_stmt
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astFunctionParameters *param;
+    const MOJOSHADER_astFunctionSignature *sig = NULL;
+    AsmFrame frame;
+    AsmSlot value;
+    int mainfn;
+
+    for (mainfn = 1; mainfn <= ctx->user_func_index; mainfn++)
+    {
+        const MOJOSHADER_astCompilationUnitFunction *astfn = ctx->ir_funcs[mainfn].ast;
+        if ((astfn != NULL) && (strcmp(astfn->declaration->identifier, "main") == 0))
+        {
+            sig = astfn->declaration;
+            break;
+        } // if
+    } // for
+
+    if (sig == NULL)
+    {
+        fail(ctx, "No 'main' function to use as the entry point");
+        return 0;
+    } // if
+
+    // static globals get their initial values first.
+    if (ctx->ir[0].node_count > 0)
+    {
+        AsmFrame statics;
+        if (!asm_function(actx, 0) || !asm_new_frame(actx, 0, &statics))
+            return 0;
+        else if (!asm_run_function(actx, &statics, &asm_always))
+            return 0;
+    } // if
+
+    if (!asm_function(actx, mainfn) || !asm_new_frame(actx, mainfn, &frame))
+        return 0;
+
+    actx->inlining[0] = mainfn;
+
+    for (param = sig->params; param != NULL; param = param->next)
+    {
+        ctx->sourcefile = param->ast.filename;
+        ctx->sourceline = param->ast.line;
+        if (param->input_modifier == MOJOSHADER_AST_INPUTMOD_UNIFORM)
+        {
+            // "uniform" parameters are constants named "$param".
+            const char *name = stringcache_fmt(ctx->strcache, "$%s", param->identifier);
+            const MOJOSHADER_astDataType *dt = asm_reduce(ctx, param->datatype);
+            if ((name == NULL) || (!asm_uniform(actx, &frame.locals[param->index], name, dt, 0, NULL)))
+                return 0;
+        } // if
+        else if (param->input_modifier != MOJOSHADER_AST_INPUTMOD_OUT)
+        {
+            if (!asm_entry_io(actx, &frame, 1, param->index, param->datatype, param->semantic, NULL))
+                return 0;
+        } // else if
+    } // for
+
+    if (!asm_run_function(actx, &frame, &asm_always))
+        return 0;
+
+    ctx->sourcefile = sig->ast.filename;
+    ctx->sourceline = sig->ast.line;
+
+    const IrFunction *irfn = &ctx->ir_funcs[mainfn];
+    if (irfn->rettemp >= 0)
+    {
+        const AsmSlot *ret = &frame.temps[irfn->rettemp - irfn->first_temp];
+        if (!ret->defined)
+        {
+            fail(ctx, "'main' doesn't return a value");
+            return 0;
+        } // if
+        else if (!asm_entry_io(actx, &frame, 0, 0, asm_return_type(sig), sig->semantic, ret))
+            return 0;
+    } // if
+
+    for (param = sig->params; param != NULL; param = param->next)
+    {
+        if ( (param->input_modifier != MOJOSHADER_AST_INPUTMOD_OUT) &&
+             (param->input_modifier != MOJOSHADER_AST_INPUTMOD_INOUT) )
+            continue;
+
+        ctx->sourcefile = param->ast.filename;
+        ctx->sourceline = param->ast.line;
+        if (!asm_local_value(actx, &frame, param->index, param->datatype, &value))
+            return 0;
+        else if (!asm_entry_io(actx, &frame, 0, param->index, param->datatype, param->semantic, &value))
+            return 0;
+    } // for
 
-static MOJOSHADER_irStatement *new_ir_discard(Context *ctx)
-{
-    NEW_IR_NODE(retval, MOJOSHADER_irDiscard, MOJOSHADER_IR_DISCARD);
-    return (MOJOSHADER_irStatement *) retval;
-} // new_ir_discard
+    return 1;
+} // asm_entry_point
 
-static MOJOSHADER_irExprList *new_ir_exprlist(Context *ctx, MOJOSHADER_irExpression *expr)
-{
-    NEW_IR_NODE(retval, MOJOSHADER_irExprList, MOJOSHADER_IR_EXPRLIST);
-    retval->expr = expr;
-    retval->next = NULL;
-    return (MOJOSHADER_irExprList *) retval;
-} // new_ir_exprlist
 
+// Turning the instructions into assembly...
 
-// This handles most comparison operators (less-than, equals, etc...)
-static MOJOSHADER_irExpression *build_ir_compare(Context *ctx,
-                                    const MOJOSHADER_irConditionType operation,
-                                    MOJOSHADER_irExpression *left,
-                                    MOJOSHADER_irExpression *right,
-                                    MOJOSHADER_irExpression *tval,
-                                    MOJOSHADER_irExpression *fval)
+// The channel each of a source's four swizzle slots reads, and which of
+//  those slots the instruction actually looks at.
+static void asm_source_channels(const AsmInstruction *instr, const int i,
+                                int *chans, int *needed)
 {
-    /* The gist...
-            cjump x < y, t, f  // '<' is whatever operation
-        t:
-            move tmp, tval
-            jump join
-        f:
-            move tmp, fval
-        join:
-    */
+    const AsmOperand *dst = &instr->operands[0];
+    const AsmOperand *src = &instr->operands[i];
+    const int elements = src->elements;
+    int j;
 
-    const int t = generate_ir_label(ctx);
-    const int f = generate_ir_label(ctx);
-    const int join = generate_ir_label(ctx);
-    const int tmp = generate_ir_temp(ctx);
+    for (j = 0; j < 4; j++)
+    {
+        chans[j] = j;
+        needed[j] = 0;
+    } // for
 
-    assert(tval && fval && (tval->info.type == fval->info.type));
-    assert(tval && fval && (tval->info.elements == fval->info.elements));
+    switch (asm_opcodes[instr->opcode].layout)
+    {
+        case ASMLAYOUT_COMPONENTWISE:
+            for (j = 0; j < dst->elements; j++)
+            {
+                const int c = dst->swizzle[j];
+                chans[c] = src->swizzle[(j < elements) ? j : (elements - 1)];
+                needed[c] = 1;
+            } // for
+            break;
 
-    const MOJOSHADER_astDataTypeType dt = tval->info.type;
-    const int elements = tval->info.elements;
+        case ASMLAYOUT_REPLICATE:
+        case ASMLAYOUT_FLOW:
+            for (j = 0; j < 4; j++)
+                chans[j] = src->swizzle[0];
+            needed[0] = 1;
+            break;
 
-    return new_ir_eseq(ctx,
-                new_ir_seq(ctx, new_ir_cjump(ctx, operation, left, right, t, f),
-                new_ir_seq(ctx, new_ir_label(ctx, t),
-                new_ir_seq(ctx, new_ir_move(ctx, new_ir_temp(ctx, tmp, dt, elements), tval, -1),
-                new_ir_seq(ctx, new_ir_jump(ctx, join),
-                new_ir_seq(ctx, new_ir_label(ctx, f),
-                new_ir_seq(ctx, new_ir_move(ctx, new_ir_temp(ctx, tmp, dt, elements), fval, -1),
-                                new_ir_label(ctx, join))))))),
-                    new_ir_temp(ctx, tmp, dt, elements));
-} // build_ir_compare
+        case ASMLAYOUT_RAW:
+            for (j = 0; j < elements; j++)
+            {
+                chans[j] = src->swizzle[j];
+                needed[j] = 1;
+            } // for
+            break;
+    } // switch
+} // asm_source_channels
 
-#define EASY_IR_COMPARE(op) \
-    build_ir_compare(ctx, MOJOSHADER_IR_COND_##op, \
-                   build_ir_expr(ctx, ast->binary.left), \
-                   build_ir_expr(ctx, ast->binary.right), \
-                   new_ir_constbool(ctx, 1), \
-                   new_ir_constbool(ctx, 0))
+// Sources that print as just a register name.
+static int asm_bare_source(const AsmContext *actx, const AsmInstruction *instr,
+                           const int i)
+{
+    const AsmOperand *src = &instr->operands[i];
+    const MOJOSHADER_shaderType shader_type = actx->pixel ? MOJOSHADER_TYPE_PIXEL : MOJOSHADER_TYPE_VERTEX;
+    if ((src->regtype == REG_TYPE_SAMPLER) || (src->regtype == REG_TYPE_CONSTINT))
+        return 1;
+    else if ((instr->opcode == ASMOP_SINCOS) && (i > 1))
+        return 1;  // Shader Model 2's sincos constants.
+    return (src->regtype != ASMREG_LITERAL) && scalar_register(shader_type, src->regtype, src->regnum);
+} // asm_bare_source
+
+// Fills in the slots nobody reads so the swizzle is one ps_2_0 can do, if
+//  there is one. Everything else can do any swizzle at all.
+static int asm_pick_swizzle(const AsmContext *actx, const int *chans,
+                            const int *needed, int *swizzle)
+{
+    static const int patterns[4][4] = {
+        { 0, 1, 2, 3 }, { 1, 2, 0, 3 }, { 2, 0, 1, 3 }, { 3, 2, 1, 0 }
+    };
+    int first = -1;
+    int i, j;
 
+    for (i = 0; i < 4; i++)
+    {
+        if ((needed[i]) && (first < 0))
+            first = chans[i];
+    } // for
 
-// This handles && and || operators.
-static MOJOSHADER_irExpression *build_ir_logical_and_or(Context *ctx,
-                                    const MOJOSHADER_astExpressionBinary *ast,
-                                    const int left_testval)
-{
-    /* The gist...
-            cjump left == left_testval, maybe, f
-        maybe:
-            cjump right == true, t, f
-        t:
-            move tmp, 1
-            jump join
-        f:
-            move tmp, 0
-        join:
-    */
+    for (i = 0; i < 4; i++)  // replicate swizzles work everywhere.
+    {
+        if ((needed[i]) && (chans[i] != first))
+            break;
+    } // for
 
-    assert(ast->left->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
-    assert(ast->right->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+    if ((first < 0) || (i == 4))
+    {
+        for (i = 0; i < 4; i++)
+            swizzle[i] = (first < 0) ? i : first;
+        return 1;
+    } // if
 
-    const int t = generate_ir_label(ctx);
-    const int f = generate_ir_label(ctx);
-    const int maybe = generate_ir_label(ctx);
-    const int join = generate_ir_label(ctx);
-    const int tmp = generate_ir_temp(ctx);
+    for (j = 0; j < 4; j++)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            if ((needed[i]) && (chans[i] != patterns[j][i]))
+                break;
+        } // for
+        if (i == 4)
+        {
+            memcpy(swizzle, patterns[j], sizeof (patterns[j]));
+            return 1;
+        } // if
+    } // for
 
-    return new_ir_eseq(ctx,
-                new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->left), new_ir_constbool(ctx, left_testval), maybe, f),
-                new_ir_seq(ctx, new_ir_label(ctx, maybe),
-                new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->right), new_ir_constbool(ctx, 1), t, f),
-                new_ir_seq(ctx, new_ir_label(ctx, t),
-                new_ir_seq(ctx, new_ir_move(ctx, new_ir_temp(ctx, tmp, MOJOSHADER_AST_DATATYPE_BOOL, 1), new_ir_constbool(ctx, 1), -1),
-                new_ir_seq(ctx, new_ir_jump(ctx, join),
-                new_ir_seq(ctx, new_ir_label(ctx, f),
-                new_ir_seq(ctx, new_ir_move(ctx, new_ir_temp(ctx, tmp, MOJOSHADER_AST_DATATYPE_BOOL, 1), new_ir_constbool(ctx, 0), -1),
-                                new_ir_label(ctx, join))))))))),
-                    new_ir_temp(ctx, tmp, MOJOSHADER_AST_DATATYPE_BOOL, 1));
-} // build_ir_logical_and_or
+    for (i = 0; i < 4; i++)
+        swizzle[i] = needed[i] ? chans[i] : i;
+    return (!actx->pixel) || (actx->major >= 3);
+} // asm_pick_swizzle
 
-static inline MOJOSHADER_irExpression *build_ir_logical_and(Context *ctx,
-                                    const MOJOSHADER_astExpressionBinary *ast)
+static void asm_relegalize(AsmContext *actx, const AsmInstruction *instr,
+                           AsmInstruction *out, const int i,
+                           const int wholereg)
 {
-    // this needs to not evaluate (right) if (left) is false!
-    return build_ir_logical_and_or(ctx, ast, 1);
-} // build_ir_logical_and
+    AsmOperand *src = &out->operands[i];
+    AsmOperand reg = *src;
+    int chans[4], needed[4];
+    int j;
 
-static inline MOJOSHADER_irExpression *build_ir_logical_or(Context *ctx,
-                                    const MOJOSHADER_astExpressionBinary *ast)
-{
-    // this needs to not evaluate (right) if (left) is true!
-    return build_ir_logical_and_or(ctx, ast, 0);
-} // build_ir_logical_or
+    reg.negate = 0;
+    if (wholereg)  // copy the whole register, it's read too many times.
+    {
+        AsmOperand tmp;
+        reg.elements = 4;
+        for (j = 0; j < 4; j++)
+            reg.swizzle[j] = j;
+        tmp = asm_mov(actx, &reg);
+        src->regtype = tmp.regtype;
+        src->regnum = tmp.regnum;
+        src->relative = 0;
+        return;
+    } // if
 
-static inline MOJOSHADER_irStatement *build_ir_no_op(Context *ctx)
-{
-    return new_ir_label(ctx, generate_ir_label(ctx));
-} // build_ir_no_op
+    // move the channels it needs into place one at a time.
+    const AsmOperand tmp = new_asm_vreg(actx, 4);
+    asm_source_channels(instr, i, chans, needed);
+    for (j = 0; j < 4; j++)
+    {
+        if (needed[j])
+        {
+            const AsmOperand dst = asm_component(&tmp, j);
+            const AsmOperand c = asm_component(&reg, 0);
+            AsmOperand chan = c;
+            chan.swizzle[0] = chans[j];
+            emit_asm(actx, ASMOP_MOV, 0, &dst, &chan, NULL, NULL, NULL);
+        } // if
+    } // for
 
-static MOJOSHADER_irStatement *build_ir_ifstmt(Context *ctx,
-                                          const MOJOSHADER_astIfStatement *ast)
+    src->regtype = tmp.regtype;
+    src->regnum = tmp.regnum;
+    src->relative = 0;
+    if (asm_opcodes[instr->opcode].layout == ASMLAYOUT_COMPONENTWISE)
+    {
+        src->elements = instr->operands[0].elements;
+        for (j = 0; j < src->elements; j++)
+            src->swizzle[j] = instr->operands[0].swizzle[j];
+    } // if
+    else
+    {
+        for (j = 0; j < 4; j++)
+            src->swizzle[j] = j;
+    } // else
+} // asm_relegalize
+
+// Shader Model 2 can only read so many constant and input registers in one
+//  instruction, and ps_2_0 can't do arbitrary swizzles. Anything that breaks
+//  those rules gets copied to a temp first.
+static int asm_legalize(AsmContext *actx)
 {
-    assert(ast->expr->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+    AsmInstruction *instrs = actx->instrs;
+    const int count = actx->instr_count;
+    const int maxconsts = actx->pixel ? 2 : 1;
+    int i, j, k;
 
-    // !!! FIXME: ast->attributes?
+    actx->instrs = NULL;
+    actx->instr_count = actx->instr_alloc = 0;
 
-    // IF statement without an ELSE.
-    if (ast->else_statement == NULL)
+    for (i = 0; i < count; i++)
     {
-        /* The gist...
-                cjump expr, t, join
-            t:
-                statement
-            join:
-        */
+        const AsmInstruction *instr = &instrs[i];
+        AsmInstruction fixed = *instr;
+        actx->ctx->sourcefile = instr->filename;  // for any copies we add.
+        actx->ctx->sourceline = instr->line;
+        AsmOperand seen[5];
+        int consts = 0, inputs = 0, textures = 0;
+        int seen_count = 0;
+
+        for (j = 1; j < instr->operand_count; j++)
+        {
+            const AsmOperand *src = &instr->operands[j];
+            int chans[4], needed[4], swizzle[4];
+            int wholereg = 0;
 
-        const int t = generate_ir_label(ctx);
-        const int join = generate_ir_label(ctx);
+            if ((instr->opcode == ASMOP_TEXKILL) || (asm_bare_source(actx, instr, j)))
+                continue;
 
-        return new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->expr), new_ir_constbool(ctx, 1), t, join),
-               new_ir_seq(ctx, new_ir_label(ctx, t),
-               new_ir_seq(ctx, build_ir_stmt(ctx, ast->statement),
-               new_ir_seq(ctx, new_ir_label(ctx, join),
-                               build_ir_stmt(ctx, ast->next)))));
-    } // if
+            for (k = 0; k < seen_count; k++)
+            {
+                if (asm_same_register(src, &seen[k]))
+                    break;
+            } // for
 
-    // IF statement _with_ an ELSE.
-    /* The gist...
-            cjump expr, t, f
-        t:
-            statement
-            jump join
-        f:
-            elsestatement
-        join:
-    */
+            if (k == seen_count)  // a register we haven't read yet.
+            {
+                seen[seen_count++] = *src;
+                if ((src->regtype == REG_TYPE_CONST) || (src->regtype == ASMREG_LITERAL))
+                    wholereg = (++consts > maxconsts);
+                else if (src->regtype == REG_TYPE_INPUT)
+                    wholereg = (++inputs > 1);
+                else if ((actx->pixel) && (src->regtype == REG_TYPE_TEXTURE))
+                    wholereg = (++textures > 1);
+            } // if
 
-    const int t = generate_ir_label(ctx);
-    const int f = generate_ir_label(ctx);
-    const int join = generate_ir_label(ctx);
+            asm_source_channels(instr, j, chans, needed);
+            if (wholereg)
+                asm_relegalize(actx, instr, &fixed, j, 1);
+            if (!asm_pick_swizzle(actx, chans, needed, swizzle))
+                asm_relegalize(actx, instr, &fixed, j, 0);
+        } // for
 
-    return new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->expr), new_ir_constbool(ctx, 1), t, f),
-           new_ir_seq(ctx, new_ir_label(ctx, t),
-           new_ir_seq(ctx, build_ir_stmt(ctx, ast->statement),
-           new_ir_seq(ctx, new_ir_jump(ctx, join),
-           new_ir_seq(ctx, new_ir_label(ctx, f),
-           new_ir_seq(ctx, build_ir_stmt(ctx, ast->else_statement),
-           new_ir_seq(ctx, new_ir_label(ctx, join),
-                           build_ir_stmt(ctx, ast->next))))))));
-} // build_ir_ifstmt
+        if (!grow_asm_array(actx, (void **) &actx->instrs, &actx->instr_alloc,
+                            actx->instr_count + 1, sizeof (AsmInstruction)))
+            break;
+        actx->instrs[actx->instr_count++] = fixed;
+    } // for
 
+    Free(actx->ctx, instrs);
+    return !isfail(actx->ctx);
+} // asm_legalize
+
+// Register allocation...
+
+// By now a virtual register is only written while its value is being built,
+//  except for the ones that carry values around loops and out of ifs, so
+//  it's live from the first instruction that mentions it to the last one
+//  (or to the end of the loop, if it's live going into one). That makes linear scan a good fit: walk
+//  the instructions in order, give each virtual register the channels it
+//  needs in some r# register the first time we see it, and hand them back
+//  after the last instruction that reads it.
+//
+// Registers are packed by channel, so four live scalars can share one r#
+//  register. A virtual register keeps its channels in order but can slide
+//  over to wherever there's room, except in ps_2_0, where that might need a
+//  swizzle the hardware can't do, so only scalars move there.
+typedef struct AsmLiveRange
+{
+    int first;  // the first instruction that mentions it.
+    int last;  // the last one.
+    int mask;  // the channels it uses, before it moves.
+    int pinned;  // non-zero if its channels can't move.
+    int conflicts;  // where its conflicts start in the conflict list...
+    int conflict_count;  // ...and how many there are.
+    int nextend;  // the next range that ends at the same instruction.
+    int reg;  // the r# register it got, -1 until it gets one.
+    int shift;  // how far its channels moved.
+    int live;
+} AsmLiveRange;
+
+static const int asm_channel_count[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
 
-static MOJOSHADER_irStatement *build_ir_forstmt(Context *ctx,
-                                       const MOJOSHADER_astForStatement *ast)
+static int asm_operand_mask(const AsmOperand *op)
 {
-    // !!! FIXME: ast->unroll
+    int retval = 0;
+    int i;
+    for (i = 0; i < op->elements; i++)
+        retval |= (1 << op->swizzle[i]);
+    return retval;
+} // asm_operand_mask
 
-    assert(ast->looptest->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+// These opcodes only write certain channels (or all of them), so their
+//  destinations stay where they are.
+static inline int asm_pinned_destination(const AsmOpcode opcode)
+{
+    switch (opcode)
+    {
+        case ASMOP_SINCOS: case ASMOP_NRM: case ASMOP_TEXLD: case ASMOP_TEXLDB:
+        case ASMOP_TEXLDP: case ASMOP_TEXLDL: case ASMOP_TEXLDD:
+            return 1;
+        default:
+            return 0;
+    } // switch
+} // asm_pinned_destination
 
-    /* The gist...
-            initializer  // (or var_decl->initializer!)
-        test:
-            cjump looptest == true, loop, join
-        loop:
-            statement
-        increment:  // needs to be here; this is where "continue" jumps!
-            counter
-            jump test
-        join:
-    */
+// Works out where each virtual register is live, which channels it uses,
+//  and which other virtual registers it can't share an r# register with: an
+//  instruction's destination never shares one with its sources, since some
+//  opcodes don't allow that.
+static int *asm_live_ranges(AsmContext *actx, AsmLiveRange *ranges)
+{
+    Context *ctx = actx->ctx;
+    const int vregs = actx->vreg_count;
+    int *conflicts = NULL;
+    int total = 0;
+    int pass, i, j, s, e;
 
-    const int test = generate_ir_label(ctx);
-    const int loop = generate_ir_label(ctx);
+    for (i = 0; i < vregs; i++)
+    {
+        memset(&ranges[i], '\0', sizeof (AsmLiveRange));
+        ranges[i].first = ranges[i].last = ranges[i].nextend = ranges[i].reg = -1;
+    } // for
 
-    const LoopLabels *labels = push_ir_loop(ctx, 0);
-    if (labels == NULL)
-        return NULL;  // out of memory...
+    // first pass counts the conflicts, second pass fills them in.
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (i = 0; i < actx->instr_count; i++)
+        {
+            const AsmInstruction *instr = &actx->instrs[i];
+            const AsmOperand *dst = &instr->operands[0];
+            const int hasdst = ( (dst->regtype == REG_TYPE_TEMP) &&
+                                 (instr->opcode != ASMOP_TEXKILL) );
 
-    const int increment = labels->start;
-    const int join = labels->end;
+            for (j = 0; (pass == 0) && (j < instr->operand_count); j++)
+            {
+                const AsmOperand *op = &instr->operands[j];
+                if (op->regtype != REG_TYPE_TEMP)
+                    continue;
+
+                AsmLiveRange *range = &ranges[op->regnum];
+                if (range->first < 0)
+                    range->first = i;
+                range->last = i;
+                range->mask |= asm_operand_mask(op);
+                if ((j == 0) && (asm_pinned_destination(instr->opcode)))
+                    range->pinned = 1;
+            } // for
 
-    assert( (ast->var_decl && !ast->initializer) ||
-            (!ast->var_decl && ast->initializer) );
+            for (j = 1; (hasdst) && (j < instr->operand_count); j++)
+            {
+                const AsmOperand *src = &instr->operands[j];
+                if ((src->regtype != REG_TYPE_TEMP) || (src->regnum == dst->regnum))
+                    continue;
 
-    MOJOSHADER_irStatement *init = NULL;
-    if (ast->var_decl != NULL)
-    {
-//sdfsdf
-        // !!! FIXME: map the initializer to the variable? Need fix to var_decl parsing.
-//        new_ir_move(ctx, FIXME MAP TO REGISTER ast->var_decl->index, build_ir_expr(ctx, ast->fsdf));
-//        FIXME
-//        init = build_ir_vardecl(ctx, ast->var_decl);
-    } // if
-    else
-    {
-//        init = build_ir_expr(ctx, ast->initializer);
-    } // else
+                AsmLiveRange *a = &ranges[dst->regnum];
+                AsmLiveRange *b = &ranges[src->regnum];
+                if (pass == 0)
+                {
+                    a->conflicts++;
+                    b->conflicts++;
+                } // if
+                else
+                {
+                    conflicts[a->conflicts + a->conflict_count++] = src->regnum;
+                    conflicts[b->conflicts + b->conflict_count++] = dst->regnum;
+                } // else
+            } // for
+        } // for
 
-    MOJOSHADER_irStatement *retval =
-        new_ir_seq(ctx, init,
-        new_ir_seq(ctx, new_ir_label(ctx, test),
-        new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->looptest), new_ir_constbool(ctx, 1), loop, join),
-        new_ir_seq(ctx, new_ir_label(ctx, loop),
-        new_ir_seq(ctx, build_ir_stmt(ctx, ast->statement),
-        new_ir_seq(ctx, new_ir_label(ctx, increment),
-        new_ir_seq(ctx, new_ir_expr_stmt(ctx, build_ir_expr(ctx, ast->counter)),
-        new_ir_seq(ctx, new_ir_jump(ctx, test),
-                        new_ir_label(ctx, join)))))))));
+        if (pass == 0)  // turn the counts into offsets.
+        {
+            for (i = 0; i < vregs; i++)
+            {
+                const int count = ranges[i].conflicts;
+                ranges[i].conflicts = total;
+                total += count;
+            } // for
 
-    pop_ir_loop(ctx);
+            conflicts = (int *) Malloc(ctx, sizeof (int) * (total + 1));
+            if (conflicts == NULL)
+                return NULL;
+        } // if
+    } // for
 
-    return new_ir_seq(ctx, retval, build_ir_stmt(ctx, ast->next));
-} // build_ir_forstmt
+    // Anything live going into a loop is live until the loop is done, since
+    //  the next time around might read it again. endreps come in order, so
+    //  inner loops get done first.
+    for (e = 0; e < actx->instr_count; e++)
+    {
+        int nested = 0;
+        if (actx->instrs[e].opcode != ASMOP_ENDREP)
+            continue;
 
-static MOJOSHADER_irStatement *build_ir_whilestmt(Context *ctx,
-                                          const MOJOSHADER_astWhileStatement *ast)
-{
-    // !!! FIXME: ast->unroll
+        for (s = e - 1; s >= 0; s--)
+        {
+            const AsmOpcode opcode = actx->instrs[s].opcode;
+            if (opcode == ASMOP_ENDREP)
+                nested++;
+            else if ((opcode == ASMOP_REP) && (nested-- == 0))
+                break;
+        } // for
+
+        for (i = 0; i < vregs; i++)
+        {
+            AsmLiveRange *range = &ranges[i];
+            if ((range->first >= 0) && (range->first < s) && (range->last >= s) && (range->last < e))
+                range->last = e;
+        } // for
+    } // for
 
-    assert(ast->expr->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+    return conflicts;
+} // asm_live_ranges
 
-    /* The gist...
-        loop:
-            cjump expr == true, t, join
-        t:
-            statement
-            jump loop
-        join:
-    */
+// Finds room for (range) in the r# register that has the least room left,
+//  so registers fill up before we start on a new one.
+static int asm_assign_register(AsmContext *actx, AsmLiveRange *ranges,
+                               const int *conflicts, AsmLiveRange *range,
+                               int *occupied)
+{
+    const int ps2 = (actx->pixel) && (actx->major < 3);
+    const int mask = range->mask;
+    const int fixed = (range->pinned) || ((ps2) && (asm_channel_count[mask] > 1));
+    int lowest = 0;
+    int blocked[32];
+    int bestroom = 5;
+    int i, p;
+
+    while ((mask & (1 << lowest)) == 0)
+        lowest++;
+
+    memset(blocked, '\0', sizeof (blocked));
+    for (i = 0; i < range->conflict_count; i++)
+    {
+        const AsmLiveRange *other = &ranges[conflicts[range->conflicts + i]];
+        if (other->live)
+            blocked[other->reg] = 1;
+    } // for
 
-    const LoopLabels *labels = push_ir_loop(ctx, 0);
-    if (labels == NULL)
-        return NULL;  // out of memory...
+    for (p = 0; p < actx->max_temps; p++)
+    {
+        const int room = 4 - asm_channel_count[occupied[p]];
+        int shift;
 
-    const int loop = labels->start;
-    const int t = generate_ir_label(ctx);
-    const int join = labels->end;
+        if ((blocked[p]) || (room >= bestroom))
+            continue;
 
-    MOJOSHADER_irStatement *retval =
-        new_ir_seq(ctx, new_ir_label(ctx, loop),
-        new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->expr), new_ir_constbool(ctx, 1), t, join),
-        new_ir_seq(ctx, new_ir_label(ctx, t),
-        new_ir_seq(ctx, build_ir_stmt(ctx, ast->statement),
-        new_ir_seq(ctx, new_ir_jump(ctx, loop),
-                        new_ir_label(ctx, join))))));
+        for (shift = -lowest; shift < 4; shift++)
+        {
+            const int moved = (mask >> lowest) << (lowest + shift);
+            if ((fixed) && (shift != 0))
+                continue;
+            else if ((moved > 0xF) || (moved & occupied[p]))
+                continue;
+
+            range->reg = p;
+            range->shift = shift;
+            bestroom = room;
+            break;
+        } // for
+    } // for
 
-    pop_ir_loop(ctx);
+    if (range->reg < 0)
+        return 0;
 
-    return new_ir_seq(ctx, retval, build_ir_stmt(ctx, ast->next));
-} // build_ir_whilestmt
+    occupied[range->reg] |= (mask >> lowest) << (lowest + range->shift);
+    range->live = 1;
+    return 1;
+} // asm_assign_register
 
-static MOJOSHADER_irStatement *build_ir_dostmt(Context *ctx,
-                                          const MOJOSHADER_astDoStatement *ast)
+// Gives every virtual register channels in a real r# register, and rewrites
+//  the instructions to use them.
+static int asm_allocate_registers(AsmContext *actx)
 {
-    // !!! FIXME: ast->unroll
+    Context *ctx = actx->ctx;
+    const int vregs = actx->vreg_count;
+    AsmLiveRange *ranges;
+    int *conflicts = NULL;
+    int *endlist;
+    int occupied[32];
+    int i, j;
+
+    ranges = (AsmLiveRange *) Malloc(ctx, sizeof (AsmLiveRange) * (vregs + 1));
+    endlist = (int *) Malloc(ctx, sizeof (int) * (actx->instr_count + 1));
+    if ((ranges != NULL) && (endlist != NULL))
+        conflicts = asm_live_ranges(actx, ranges);
+
+    if (conflicts == NULL)
+    {
+        Free(ctx, ranges);
+        Free(ctx, endlist);
+        return 0;
+    } // if
 
-    assert(ast->expr->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
+    for (i = 0; i < actx->instr_count; i++)
+        endlist[i] = -1;
+    for (i = 0; i < vregs; i++)
+    {
+        AsmLiveRange *range = &ranges[i];
+        if (range->last >= 0)
+        {
+            range->nextend = endlist[range->last];
+            endlist[range->last] = i;
+        } // if
+    } // for
 
-    /* The gist...
-        loop:
-            statement
-            cjump expr == true, loop, join
-        join:
-    */
+    memset(occupied, '\0', sizeof (occupied));
+    for (i = 0; (i < actx->instr_count) && (!isfail(ctx)); i++)
+    {
+        const AsmInstruction *instr = &actx->instrs[i];
+        for (j = 0; j < instr->operand_count; j++)
+        {
+            const AsmOperand *op = &instr->operands[j];
+            AsmLiveRange *range;
+            if (op->regtype != REG_TYPE_TEMP)
+                continue;
+
+            range = &ranges[op->regnum];
+            if (range->reg >= 0)
+                continue;
+            else if (!asm_assign_register(actx, ranges, conflicts, range, occupied))
+            {
+                ctx->sourcefile = instr->filename;
+                ctx->sourceline = instr->line;
+                failf(ctx, "Shader needs more than the %d temp registers %s has",
+                      actx->max_temps, ctx->source_profile + 5);
+                break;
+            } // else if
+            else if (range->reg >= actx->temps_used)
+                actx->temps_used = range->reg + 1;
+        } // for
 
-    const LoopLabels *labels = push_ir_loop(ctx, 0);
-    if (labels == NULL)
-        return NULL;  // out of memory...
+        // anything that isn't read after this instruction gives its channels back.
+        for (j = endlist[i]; j >= 0; j = ranges[j].nextend)
+        {
+            const AsmLiveRange *range = &ranges[j];
+            const int mask = range->mask;
+            int lowest = 0;
+            while ((mask & (1 << lowest)) == 0)
+                lowest++;
+            occupied[range->reg] &= ~((mask >> lowest) << (lowest + range->shift));
+            ranges[j].live = 0;
+        } // for
+    } // for
 
-    const int loop = labels->start;
-    const int join = labels->end;
+    if (!isfail(ctx))
+    {
+        for (i = 0; i < actx->instr_count; i++)
+        {
+            AsmInstruction *instr = &actx->instrs[i];
+            for (j = 0; j < instr->operand_count; j++)
+            {
+                AsmOperand *op = &instr->operands[j];
+                const AsmLiveRange *range;
+                int k;
+                if (op->regtype != REG_TYPE_TEMP)
+                    continue;
+
+                range = &ranges[op->regnum];
+                op->regnum = range->reg;
+                for (k = 0; k < op->elements; k++)
+                    op->swizzle[k] += range->shift;
+            } // for
+        } // for
+    } // if
 
-    MOJOSHADER_irStatement *retval =
-        new_ir_seq(ctx, new_ir_label(ctx, loop),
-        new_ir_seq(ctx, build_ir_stmt(ctx, ast->statement),
-        new_ir_seq(ctx, new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, ast->expr), new_ir_constbool(ctx, 1), loop, join),
-                        new_ir_label(ctx, join))));
+    #if DEBUG_COMPILER_IR
+    if (!isfail(ctx))
+        printf("codegen: %d virtual registers in %d temp registers\n",
+               vregs, actx->temps_used);
+    #endif
 
-    pop_ir_loop(ctx);
+    Free(ctx, conflicts);
+    Free(ctx, endlist);
+    Free(ctx, ranges);
+    return !isfail(ctx);
+} // asm_allocate_registers
 
-    return new_ir_seq(ctx, retval, build_ir_stmt(ctx, ast->next));
-} // build_ir_dostmt
+static const char *asm_usage_names[] = {
+    "position", "blendweight", "blendindices", "normal", "psize",
+    "texcoord", "tangent", "binormal", "tessfactor", "positiont",
+    "color", "fog", "depth", "sample"
+};
 
-static MOJOSHADER_irStatement *build_ir_switch(Context *ctx, const MOJOSHADER_astSwitchStatement *ast)
+static void asm_print_register(const AsmContext *actx, Buffer *buf,
+                               const AsmOperand *op, const int literal_base)
 {
-    // Dithering down to a list of if-statements in all cases
-    //  isn't ideal, but we can't do jumptables in D3D bytecode.
+    if (op->regtype == ASMREG_LITERAL)
+    {
+        buffer_append_fmt(buf, "c%d", literal_base + op->regnum);
+        return;
+    } // if
 
-    // !!! FIXME: attributes?
+    switch (op->regtype)
+    {
+        case REG_TYPE_TEMP:
+            buffer_append_fmt(buf, "r%d", op->regnum);
+            return;
+        case REG_TYPE_CONST:
+            if (op->relative)
+                buffer_append_fmt(buf, "c[a0.x + %d]", op->regnum);
+            else
+                buffer_append_fmt(buf, "c%d", op->regnum);
+            return;
+        case REG_TYPE_INPUT: buffer_append_fmt(buf, "v%d", op->regnum); return;
+        case REG_TYPE_SAMPLER: buffer_append_fmt(buf, "s%d", op->regnum); return;
+        case REG_TYPE_CONSTINT: buffer_append_fmt(buf, "i%d", op->regnum); return;
+        case REG_TYPE_COLOROUT: buffer_append_fmt(buf, "oC%d", op->regnum); return;
+        case REG_TYPE_DEPTHOUT: buffer_append(buf, "oDepth", 6); return;
+        case REG_TYPE_ATTROUT: buffer_append_fmt(buf, "oD%d", op->regnum); return;
+        case REG_TYPE_OUTPUT:  // same as REG_TYPE_TEXCRDOUT.
+            buffer_append_fmt(buf, "%s%d", (actx->major >= 3) ? "o" : "oT", op->regnum);
+            return;
+        case REG_TYPE_ADDRESS:  // same as REG_TYPE_TEXTURE.
+            buffer_append_fmt(buf, "%s%d", actx->pixel ? "t" : "a", op->regnum);
+            return;
+        case REG_TYPE_RASTOUT:
+            if (op->regnum == RASTOUT_TYPE_POSITION)
+                buffer_append(buf, "oPos", 4);
+            else if (op->regnum == RASTOUT_TYPE_FOG)
+                buffer_append(buf, "oFog", 4);
+            else
+                buffer_append(buf, "oPts", 4);
+            return;
+        case REG_TYPE_MISCTYPE:
+            if (op->regnum == MISCTYPE_TYPE_POSITION)
+                buffer_append(buf, "vPos", 4);
+            else
+                buffer_append(buf, "vFace", 5);
+            return;
+        default:
+            assert(0 && "unexpected register type");
+            return;
+    } // switch
+} // asm_print_register
 
-    /* The gist...
-            move tmp, expr
-            cjump tmp == case1expr, case1, testcase2
-        testcase2:  // etc
-            cjump tmp == case2expr, case2, join
-        case1:
-            case1stmt  // might have a break in it somewhere.
-        case2:
-            case2stmt
-        join:
-    */
+static void asm_print_writemask(Buffer *buf, const AsmOperand *op)
+{
+    char mask[6];
+    int chan[4] = { 0, 0, 0, 0 };
+    int i, len = 0;
 
-    const LoopLabels *labels = push_ir_loop(ctx, 1);
-    if (labels == NULL)
-        return NULL;  // out of memory...
+    for (i = 0; i < op->elements; i++)
+        chan[op->swizzle[i]] = 1;
+    if (chan[0] && chan[1] && chan[2] && chan[3])
+        return;
 
-    const int join = labels->end;
-    const int elems = datatype_elems(ctx, ast->expr->datatype);
-    const MOJOSHADER_astDataTypeType dt = datatype_base(ctx, ast->expr->datatype)->type;
+    mask[len++] = '.';
+    for (i = 0; i < 4; i++)
+    {
+        if (chan[i])
+            mask[len++] = "xyzw"[i];
+    } // for
+    buffer_append(buf, mask, len);
+} // asm_print_writemask
 
-    const MOJOSHADER_astSwitchCases *cases = ast->cases;
-    const int tmp = generate_ir_temp(ctx);
-    MOJOSHADER_irStatement *startseqs = new_ir_move(ctx, new_ir_temp(ctx, tmp, dt, elems), build_ir_expr(ctx, ast->expr), -1);
-    MOJOSHADER_irStatement *testseqs = startseqs;
-    MOJOSHADER_irStatement *startcaseseqs = NULL;
-    MOJOSHADER_irStatement *caseseqs = NULL;
-    while (cases)
+static void asm_print_instruction(const AsmContext *actx, Buffer *buf,
+                                  const AsmInstruction *instr,
+                                  const int literal_base)
+{
+    const MOJOSHADER_shaderType shader_type = actx->pixel ? MOJOSHADER_TYPE_PIXEL : MOJOSHADER_TYPE_VERTEX;
+    const AsmOperand *dst = &instr->operands[0];
+    const int flow = (asm_opcodes[instr->opcode].layout == ASMLAYOUT_FLOW);
+    int i, j;
+
+    buffer_append_fmt(buf, "    %s%s", asm_opcodes[instr->opcode].name,
+                      instr->saturate ? "_sat" : "");
+    if (!flow)
     {
-        const int t = generate_ir_label(ctx);
-        const int f = (cases->next == NULL) ? join : generate_ir_label(ctx);
-        MOJOSHADER_irStatement *cjump = new_ir_cjump(ctx, MOJOSHADER_IR_COND_EQL, build_ir_expr(ctx, cases->expr), new_ir_temp(ctx, tmp, dt, elems), t, f);
+        buffer_append(buf, " ", 1);
+        asm_print_register(actx, buf, dst, literal_base);
+        if ( (instr->opcode != ASMOP_TEXKILL) &&
+             (!scalar_register(shader_type, dst->regtype, dst->regnum)) )
+            asm_print_writemask(buf, dst);
+    } // if
 
-        if (cases->next == NULL)  // last one, do the join label.
-        {
-            testseqs = new_ir_seq(ctx, testseqs, cjump);
-            caseseqs = new_ir_seq(ctx, caseseqs, new_ir_seq(ctx, new_ir_label(ctx, t), build_ir_stmt(ctx, cases->statement)));
-            caseseqs = new_ir_seq(ctx, caseseqs, new_ir_label(ctx, f));
-        } // if
-        else
-        {
-            testseqs = new_ir_seq(ctx, testseqs, new_ir_seq(ctx, cjump, new_ir_label(ctx, f)));
-            caseseqs = new_ir_seq(ctx, caseseqs, new_ir_seq(ctx, new_ir_label(ctx, t), build_ir_stmt(ctx, cases->statement)));
-        } // else
+    for (i = 1; i < instr->operand_count; i++)
+    {
+        const AsmOperand *src = &instr->operands[i];
+        const char *sep = ((flow) && (i == 1)) ? " " : ", ";
+        int chans[4], needed[4], swizzle[4];
+
+        buffer_append(buf, sep, strlen(sep));
+        if (src->negate)
+            buffer_append(buf, "-", 1);
+        asm_print_register(actx, buf, src, literal_base);
+        if (asm_bare_source(actx, instr, i))
+            continue;
 
-        if (startcaseseqs == NULL)
-            startcaseseqs = caseseqs;
+        asm_source_channels(instr, i, chans, needed);
+        asm_pick_swizzle(actx, chans, needed, swizzle);
+        if ((swizzle[0] == 0) && (swizzle[1] == 1) && (swizzle[2] == 2) && (swizzle[3] == 3))
+            continue;
 
-        cases = cases->next;
-    } // while
+        buffer_append(buf, ".", 1);
+        for (j = 0; j < 4; j++)
+        {
+            buffer_append(buf, &"xyzw"[swizzle[j]], 1);
+            if ((j == 0) && (swizzle[1] == swizzle[0]) &&
+                (swizzle[2] == swizzle[0]) && (swizzle[3] == swizzle[0]))
+                break;  // ".x" means ".xxxx".
+        } // for
+    } // for
 
-    pop_ir_loop(ctx);
+    buffer_append(buf, "\n", 1);
+} // asm_print_instruction
 
-    return new_ir_seq(ctx, startseqs, new_ir_seq(ctx, startcaseseqs, build_ir_stmt(ctx, ast->next)));
-} // build_ir_switch
+static void asm_print_dcl(const AsmContext *actx, Buffer *buf, const AsmIO *io)
+{
+    const AsmOperand *reg = &io->reg;
+    if (reg->regtype == REG_TYPE_MISCTYPE)
+        buffer_append(buf, "    dcl ", 8);
+    else if ((actx->pixel) && (actx->major < 3))
+        buffer_append(buf, "    dcl ", 8);
+    else if (io->index == 0)
+        buffer_append_fmt(buf, "    dcl_%s ", asm_usage_names[io->usage]);
+    else
+        buffer_append_fmt(buf, "    dcl_%s%d ", asm_usage_names[io->usage], io->index);
+
+    asm_print_register(actx, buf, reg, 0);
+    if ((reg->regtype == REG_TYPE_MISCTYPE) && (reg->regnum == MISCTYPE_TYPE_POSITION))
+        buffer_append(buf, ".xy", 3);
+    buffer_append(buf, "\n", 1);
+} // asm_print_dcl
+
+// MOJOSHADER_printFloat() only does nine decimal places, which isn't enough
+//  for tiny constants, so use printf, but don't let the locale pick the
+//  decimal point.
+static void asm_print_float(Buffer *buf, const float value)
+{
+    char str[32];
+    char *ptr;
+    snprintf(str, sizeof (str), ", %.9g", (double) value);
+    for (ptr = str + 1; *ptr; ptr++)
+    {
+        if (*ptr == ',')
+            *ptr = '.';
+    } // for
+    buffer_append(buf, str, strlen(str));
+} // asm_print_float
 
-static MOJOSHADER_irExpression *build_ir_increxpr(Context *ctx, const MOJOSHADER_astDataType *_dt,
-                                                  const int val)
+static char *asm_print(AsmContext *actx, const int literal_base, int *_len)
 {
-    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, _dt);
-    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
-    const int elems = datatype_elems(ctx, dt);
-    MOJOSHADER_irConstant *retval = (MOJOSHADER_irConstant *) new_ir_constant(ctx, type, elems);
-    int i;
+    static const char *samplernames[] = { NULL, NULL, "2d", "cube", "volume" };
+    Context *ctx = actx->ctx;
+    Buffer *buf = buffer_create(4096, MallocBridge, FreeBridge, ctx);
+    int i, j;
 
-    switch (type)
+    if (buf == NULL)
     {
-        case MOJOSHADER_AST_DATATYPE_BOOL:
-        case MOJOSHADER_AST_DATATYPE_INT:
-        case MOJOSHADER_AST_DATATYPE_UINT:
-            for (i = 0; i < elems; i++)
-                retval->value.ival[i] = (int) val;
-            break;
+        out_of_memory(ctx);
+        return NULL;
+    } // if
 
-        case MOJOSHADER_AST_DATATYPE_FLOAT:
-        case MOJOSHADER_AST_DATATYPE_FLOAT_SNORM:
-        case MOJOSHADER_AST_DATATYPE_FLOAT_UNORM:
-        case MOJOSHADER_AST_DATATYPE_HALF:
-        case MOJOSHADER_AST_DATATYPE_DOUBLE:
-            for (i = 0; i < elems; i++)
-                retval->value.fval[i] = (float) val;
-            break;
+    buffer_append_fmt(buf, "%s\n", ctx->source_profile + 5);
 
-        default:
-            assert(0 && "Semantic analysis should have caught this!");
-    } // switch
+    for (i = 0; i < actx->literal_count; i++)
+    {
+        const AsmLiteral *lit = &actx->literals[i];
+        buffer_append_fmt(buf, "    def c%d", literal_base + i);
+        for (j = 0; j < 4; j++)
+            asm_print_float(buf, (j < lit->used) ? lit->value[j] : 0.0f);
+        buffer_append(buf, "\n", 1);
+    } // for
 
-    return (MOJOSHADER_irExpression *) retval;
-} // build_ir_increxpr
+    if (actx->repeats)
+        buffer_append_fmt(buf, "    defi i0, %d, 0, 0, 0\n", ASM_REP_COUNT);
 
-static MOJOSHADER_irExpression *build_ir_preincdec(Context *ctx, MOJOSHADER_astExpressionUnary *ast, const MOJOSHADER_irBinOpType binop)
-{
-    /* The gist...
-        move expr, expr + 1
-        return expr
-    */
-    // !!! FIXME: can you writemask an increment operator?
-    MOJOSHADER_irExpression *constant = build_ir_increxpr(ctx, ast->datatype, 1);
-    return new_ir_eseq(ctx,
-                new_ir_move(ctx,
-                    build_ir_expr(ctx, ast->operand),
-                    new_ir_binop(ctx, binop, build_ir_expr(ctx, ast->operand), constant), -1),
-                build_ir_expr(ctx, ast->operand));
-} // build_ir_preincdec
+    for (i = 0; i < actx->input_count; i++)
+        asm_print_dcl(actx, buf, &actx->inputs[i]);
 
-static MOJOSHADER_irExpression *build_ir_postincdec(Context *ctx, MOJOSHADER_astExpressionUnary *ast, const MOJOSHADER_irBinOpType binop)
-{
-    /* The gist...
-        move tmp, expr
-        move expr, expr + 1
-        return tmp
-    */
+    if ((!actx->pixel) && (actx->major >= 3))
+    {
+        for (i = 0; i < actx->output_count; i++)
+            asm_print_dcl(actx, buf, &actx->outputs[i]);
+    } // if
 
-    // !!! FIXME: can you writemask an increment operator?
-    MOJOSHADER_irExpression *constant = build_ir_increxpr(ctx, ast->datatype, 1);
-    const int tmp = generate_ir_temp(ctx);
-    return new_ir_eseq(ctx,
-                new_ir_seq(ctx,
-                    new_ir_move(ctx, new_ir_temp(ctx, tmp, constant->info.type, constant->info.elements), build_ir_expr(ctx, ast->operand), -1),
-                    new_ir_move(ctx, build_ir_expr(ctx, ast->operand),
-                        new_ir_binop(ctx, binop, build_ir_expr(ctx, ast->operand), constant), -1)),
-                new_ir_temp(ctx, tmp, constant->info.type, constant->info.elements));
-} // build_ir_postincdec
+    for (i = 0; i < actx->uniform_count; i++)
+    {
+        const AsmUniform *uniform = &actx->uniforms[i];
+        const MOJOSHADER_astDataType *dt = uniform->datatype;
+        if (uniform->regset != MOJOSHADER_SYMREGSET_SAMPLER)
+            continue;
+        else if (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
+            dt = asm_reduce(ctx, dt->array.base);
 
-static MOJOSHADER_irExpression *build_ir_convert(Context *ctx, const MOJOSHADER_astExpressionCast *ast)
-{
-    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
-    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
-    const int elems = datatype_elems(ctx, dt);
-    return new_ir_convert(ctx, build_ir_expr(ctx, ast->operand), type, elems);
-} // build_ir_convert
+        for (j = uniform->regindex; j < uniform->regindex + uniform->regcount; j++)
+        {
+            TextureType ttype = actx->samplertypes[j];
+            if (ttype == 0)  // never sampled; go by its type.
+            {
+                if (dt->type == MOJOSHADER_AST_DATATYPE_SAMPLER_3D)
+                    ttype = TEXTURE_TYPE_VOLUME;
+                else if (dt->type == MOJOSHADER_AST_DATATYPE_SAMPLER_CUBE)
+                    ttype = TEXTURE_TYPE_CUBE;
+                else
+                    ttype = TEXTURE_TYPE_2D;
+            } // if
+            buffer_append_fmt(buf, "    dcl_%s s%d\n", samplernames[ttype], j);
+        } // for
+    } // for
 
-static MOJOSHADER_irExprList *build_ir_exprlist(Context *ctx, MOJOSHADER_astArguments *args)
+    for (i = 0; i < actx->instr_count; i++)
+        asm_print_instruction(actx, buf, &actx->instrs[i], literal_base);
+
+    *_len = (int) buffer_size(buf);
+    char *retval = buffer_flatten(buf);
+    buffer_destroy(buf);
+    if (retval == NULL)
+        out_of_memory(ctx);
+    return retval;
+} // asm_print
+
+// Fills in (info) for a uniform of type (dt), members and all.
+static int asm_symbol_info(AsmContext *actx, const MOJOSHADER_astDataType *dt,
+                           const int rowmajor, MOJOSHADER_symbolTypeInfo *info)
 {
-    MOJOSHADER_irExprList *retval = NULL;
-    MOJOSHADER_irExprList *prev = NULL;
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_astDataType *base = dt;
+    int i;
 
-    while (args != NULL)
+    info->elements = 1;
+    if (dt->type == MOJOSHADER_AST_DATATYPE_ARRAY)
     {
-        assert((retval && prev) || ((!retval) && (!prev)));
+        info->elements = (unsigned int) dt->array.elements;
+        dt = base = asm_reduce(ctx, dt->array.base);
+    } // if
 
-        MOJOSHADER_irExprList *item = new_ir_exprlist(ctx, build_ir_expr(ctx, args->argument));
-        if (prev == NULL)
-            prev = retval = item;
-        else
-            prev->next = item;
+    info->rows = info->columns = 1;
+    if (dt->type == MOJOSHADER_AST_DATATYPE_VECTOR)
+    {
+        info->parameter_class = MOJOSHADER_SYMCLASS_VECTOR;
+        info->columns = (unsigned int) dt->vector.elements;
+        base = asm_reduce(ctx, dt->vector.base);
+    } // if
+    else if (dt->type == MOJOSHADER_AST_DATATYPE_MATRIX)
+    {
+        info->parameter_class = rowmajor ? MOJOSHADER_SYMCLASS_MATRIX_ROWS : MOJOSHADER_SYMCLASS_MATRIX_COLUMNS;
+        info->rows = (unsigned int) dt->matrix.rows;
+        info->columns = (unsigned int) dt->matrix.columns;
+        base = asm_reduce(ctx, dt->matrix.base);
+    } // else if
+    else if (dt->type == MOJOSHADER_AST_DATATYPE_STRUCT)
+    {
+        const MOJOSHADER_astDataTypeStruct *s = &dt->structure;
+        const size_t len = sizeof (MOJOSHADER_symbolStructMember) * s->member_count;
+        info->parameter_class = MOJOSHADER_SYMCLASS_STRUCT;
+        info->parameter_type = MOJOSHADER_SYMTYPE_VOID;
+        info->members = (MOJOSHADER_symbolStructMember *) Malloc(ctx, len);
+        if (info->members == NULL)
+            return 0;
+        memset(info->members, '\0', len);
+        info->member_count = (unsigned int) s->member_count;
+        for (i = 0; i < s->member_count; i++)
+        {
+            MOJOSHADER_symbolStructMember *member = &info->members[i];
+            member->name = StrDup(ctx, s->members[i].identifier);
+            if (member->name == NULL)
+                return 0;
+            else if (!asm_symbol_info(actx, asm_reduce(ctx, s->members[i].datatype),
+                                      rowmajor, &member->info))
+                return 0;
+        } // for
+        return 1;
+    } // else if
+    else if (asm_is_sampler(dt))
+        info->parameter_class = MOJOSHADER_SYMCLASS_OBJECT;
+    else
+        info->parameter_class = MOJOSHADER_SYMCLASS_SCALAR;
 
-        args = args->next;
-    } // while
+    switch (base->type)
+    {
+        case MOJOSHADER_AST_DATATYPE_BOOL: info->parameter_type = MOJOSHADER_SYMTYPE_BOOL; break;
+        case MOJOSHADER_AST_DATATYPE_INT:
+        case MOJOSHADER_AST_DATATYPE_UINT: info->parameter_type = MOJOSHADER_SYMTYPE_INT; break;
+        case MOJOSHADER_AST_DATATYPE_SAMPLER_1D: info->parameter_type = MOJOSHADER_SYMTYPE_SAMPLER1D; break;
+        case MOJOSHADER_AST_DATATYPE_SAMPLER_2D: info->parameter_type = MOJOSHADER_SYMTYPE_SAMPLER2D; break;
+        case MOJOSHADER_AST_DATATYPE_SAMPLER_3D: info->parameter_type = MOJOSHADER_SYMTYPE_SAMPLER3D; break;
+        case MOJOSHADER_AST_DATATYPE_SAMPLER_CUBE: info->parameter_type = MOJOSHADER_SYMTYPE_SAMPLERCUBE; break;
+        default: info->parameter_type = MOJOSHADER_SYMTYPE_FLOAT; break;
+    } // switch
 
-    return retval;
-} // build_ir_exprlist
+    return 1;
+} // asm_symbol_info
 
-static MOJOSHADER_irExpression *build_ir_constructor(Context *ctx, const MOJOSHADER_astExpressionConstructor *ast)
+// The uniforms we used, for MOJOSHADER_assemble() to put in the CTAB.
+static MOJOSHADER_symbol *asm_symbols(AsmContext *actx)
 {
-    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
-    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
-    const int elems = datatype_elems(ctx, dt);
-    assert(elems <= 16);  // just in case (matrix4x4 constructor is largest).
-    return new_ir_construct(ctx, build_ir_exprlist(ctx, ast->args), type, elems);
-} // build_ir_constructor
+    Context *ctx = actx->ctx;
+    const int count = actx->uniform_count;
+    int i;
 
-static MOJOSHADER_irExpression *build_ir_call(Context *ctx, const MOJOSHADER_astExpressionCallFunction *ast)
-{
-    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
-    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
-    const int elems = datatype_elems(ctx, dt);
-    return new_ir_call(ctx, ast->identifier->index, build_ir_exprlist(ctx, ast->args), type, elems);
-} // build_ir_call
+    if (count == 0)
+        return NULL;
 
-static char swiz_to_channel(const char swiz)
-{
-    if ((swiz == 'r') || (swiz == 'x')) return 0;
-    if ((swiz == 'g') || (swiz == 'y')) return 1;
-    if ((swiz == 'b') || (swiz == 'z')) return 2;
-    if ((swiz == 'a') || (swiz == 'w')) return 3;
-    assert(0 && "Should have been caught by semantic analysis.");
-    return 0;
-} // swiz_to_channel
+    MOJOSHADER_symbol *retval = (MOJOSHADER_symbol *) Malloc(ctx, sizeof (MOJOSHADER_symbol) * count);
+    if (retval == NULL)
+        return NULL;
+    memset(retval, '\0', sizeof (MOJOSHADER_symbol) * count);
 
-static MOJOSHADER_irExpression *build_ir_swizzle(Context *ctx, const MOJOSHADER_astExpressionDerefStruct *ast)
+    for (i = 0; i < count; i++)
+    {
+        const AsmUniform *uniform = &actx->uniforms[i];
+        MOJOSHADER_symbol *sym = &retval[i];
+
+        sym->name = StrDup(ctx, uniform->name);
+        sym->register_set = uniform->regset;
+        sym->register_index = (unsigned int) uniform->regindex;
+        sym->register_count = (unsigned int) uniform->regcount;
+        asm_symbol_info(actx, uniform->datatype, uniform->rowmajor, &sym->info);
+    } // for
+
+    return retval;
+} // asm_symbols
+
+static void asm_assemble(AsmContext *actx, const char *source, const int len)
 {
-    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
-    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
-    const int elems = datatype_elems(ctx, dt);
-    char chans[4] = { 0, 0, 0, 0 };
-    const char *swizstr = ast->member;
+    Context *ctx = actx->ctx;
+    const MOJOSHADER_parseData *pd;
     int i;
 
-    for (i = 0; swizstr[i]; i++)
-        chans[i] = swiz_to_channel(swizstr[i]);
+    pd = MOJOSHADER_assemble(ctx->sourcefile, source, (unsigned int) len,
+                             NULL, 0, ctx->symbols,
+                             (unsigned int) ctx->symbol_count, NULL, 0,
+                             NULL, NULL, ctx->malloc, ctx->free,
+                             ctx->malloc_data);
 
-    return new_ir_swizzle(ctx, build_ir_expr(ctx, ast->identifier), chans, type, elems);
-} // build_ir_swizzle
+    if (pd == &MOJOSHADER_out_of_mem_data)
+        out_of_memory(ctx);
+    else if (pd->error_count > 0)
+    {
+        // this is our fault, not the shader's.
+        for (i = 0; i < pd->error_count; i++)
+        {
+            failf(ctx, "Internal error: generated assembly didn't assemble: line %d: %s",
+                  pd->errors[i].error_position, pd->errors[i].error);
+        } // for
+    } // else if
+    else
+    {
+        ctx->bytecode = (unsigned char *) Malloc(ctx, pd->output_len);
+        if (ctx->bytecode != NULL)
+        {
+            memcpy(ctx->bytecode, pd->output, pd->output_len);
+            ctx->bytecode_len = pd->output_len;
+        } // if
+    } // else
 
-static MOJOSHADER_irExpression *build_ir_identifier(Context *ctx, const MOJOSHADER_astExpressionIdentifier *ast)
-{
-    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
-    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
-    const int elems = datatype_elems(ctx, dt);
-    return new_ir_memory(ctx, ast->index, type, elems);
-} // build_ir_identifier
+    MOJOSHADER_freeParseData(pd);
+} // asm_assemble
 
-static MOJOSHADER_irExpression *build_ir_derefstruct(Context *ctx, const MOJOSHADER_astExpressionDerefStruct *ast)
+// Generates D3D assembly and bytecode for the compiled shader, which end
+//  up in ctx->output and ctx->bytecode.
+static void codegen(Context *ctx)
 {
-    // There are only three possible IR nodes that contain a struct:
-    //  an irTemp, an irMemory, or an irESeq that results in a temp or memory.
-    //  As such, we figure out which it is, and offset appropriately for the
-    //  member.
-    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
-    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
-    const int elems = datatype_elems(ctx, dt);
-    MOJOSHADER_irExpression *expr = build_ir_expr(ctx, ast->identifier);
-    MOJOSHADER_irExpression *finalexpr = expr;
-
-    if (expr == NULL)
-        return NULL;
+    const char *profile = ctx->source_profile + 5;  // skip "hlsl_".
+    AsmContext actx;
+    int allocated = 0;
+    int literal_base = 0;
+    int i;
 
-    assert(!ast->isswizzle);
+    memset(&actx, '\0', sizeof (actx));
+    actx.ctx = ctx;
+    actx.pixel = (profile[0] == 'p');
+    actx.major = profile[3] - '0';
+    actx.minor = profile[5] - '0';
 
-    while (finalexpr->ir.type == MOJOSHADER_IR_ESEQ)
-        finalexpr = finalexpr->eseq.expr;
+    if (actx.major < 2)
+    {
+        failf(ctx, "Profile '%s' can't be compiled to bytecode; the code generator targets Shader Model 2 and 3", profile);
+        return;
+    } // if
 
-    if (finalexpr->ir.type == MOJOSHADER_IR_TEMP)
-        finalexpr->temp.index += ast->member_index;
-    else if (finalexpr->ir.type == MOJOSHADER_IR_MEMORY)
-        finalexpr->memory.index += ast->member_index;
+    actx.max_temps = (actx.major >= 3) ? 32 : 12;
+    if (!actx.pixel)
+        actx.max_consts = 256;
     else
-        assert(0 && "Unexpected condition");
+        actx.max_consts = (actx.major >= 3) ? 224 : 32;
 
-    // Replace the struct type with the type of the member.
-    expr->info.type = type;
-    expr->info.elements = elems;
+    actx.funcs = (AsmFunction *) new_asm_array(&actx, ctx->user_func_index + 1, sizeof (AsmFunction));
+    if ( (actx.funcs != NULL) && (build_asm_globals(&actx)) &&
+         (build_asm_intrinsics(&actx)) && (asm_entry_point(&actx)) )
+    {
+        ctx->sourcefile = NULL;
+        ctx->sourceline = 0;
+        if (asm_legalize(&actx))
+            allocated = asm_allocate_registers(&actx);
+    } // if
 
-    return expr;
-} // build_ir_derefstruct
+    if ((allocated) && (!isfail(ctx)))
+    {
+        for (i = 0; i < actx.uniform_count; i++)
+        {
+            const AsmUniform *uniform = &actx.uniforms[i];
+            const int end = uniform->regindex + uniform->regcount;
+            if ((uniform->regset == MOJOSHADER_SYMREGSET_FLOAT4) && (end > literal_base))
+                literal_base = end;
+        } // for
 
-static MOJOSHADER_irExpression *build_ir_derefarray(Context *ctx, const MOJOSHADER_astExpressionBinary *ast)
-{
-    // In most compilers, arrays dither down to offsets into memory, but
-    //  they're somewhat special in D3D, since they might have to deal with
-    //  vectors, etc...so we keep them as first-class citizens of the IR,
-    //  and let the optimizer/codegen sort it out.
-    // !!! FIXME: this might be the wrong move. Maybe remove this IR node type?
-    const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->datatype);
-    const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
-    const int elems = datatype_elems(ctx, dt);
+        if (literal_base + actx.literal_count > actx.max_consts)
+        {
+            failf(ctx, "Shader needs more than the %d constant registers %s has",
+                  actx.max_consts, profile);
+        } // if
+    } // if
 
-    // !!! FIXME: Array dereference of a vector can become a simple swizzle operation, if we have a constant index.
-    // !!! FIXME: Matrix dereference of a vector can become a simple reference to a temp/memory, if we have a constant index.
-    return new_ir_array(ctx, build_ir_expr(ctx, ast->left), build_ir_expr(ctx, ast->right), type, elems);
-} // build_ir_derefarray
+    if ((allocated) && (!isfail(ctx)))
+    {
+        for (i = 0; i < actx.literal_count; i++)
+        {
+            const AsmLiteral *lit = &actx.literals[i];
+            int j;
+            for (j = 0; j < lit->used; j++)
+            {
+                if ((isnan(lit->value[j])) || (isinf(lit->value[j])))
+                {
+                    fail(ctx, "Shader has a constant that isn't a finite number");
+                    break;
+                } // if
+            } // for
+        } // for
+    } // if
 
-static MOJOSHADER_irExpression *build_ir_assign_binop(Context *ctx,
-                                                const MOJOSHADER_irBinOpType op,
-                                                const MOJOSHADER_astExpressionBinary *ast)
-{
-    MOJOSHADER_irExpression *lvalue = build_ir_expr(ctx, ast->left);
-    MOJOSHADER_irExpression *rvalue = build_ir_expr(ctx, ast->right);
-    const MOJOSHADER_astDataTypeType type = lvalue->info.type;
-    const int elems = lvalue->info.elements;
-    const int tmp = generate_ir_temp(ctx);
+    if ((allocated) && (!isfail(ctx)))
+    {
+        ctx->output = asm_print(&actx, literal_base, &ctx->output_len);
+        ctx->symbols = asm_symbols(&actx);
+        ctx->symbol_count = (ctx->symbols != NULL) ? actx.uniform_count : 0;
+        if ((ctx->output != NULL) && (!isfail(ctx)))
+            asm_assemble(&actx, ctx->output, ctx->output_len);
+    } // if
 
-    // Semantic analysis should have inserted casts if necessary.
-    assert(type == rvalue->info.type);
-    assert(elems == rvalue->info.elements);
+    Free(ctx, actx.instrs);
+    Free(ctx, actx.literals);
+    Free(ctx, actx.uniforms);
+} // codegen
 
-    // The destination must eventually be lvalue, which means memory or temp.
-    MOJOSHADER_irExpression *dst = lvalue;
-    while (dst->ir.type == MOJOSHADER_IR_ESEQ)
-        dst = dst->eseq.expr;
 
-    if (dst->ir.type == MOJOSHADER_IR_TEMP)
-        dst = new_ir_temp(ctx, dst->temp.index, dst->info.type, dst->info.elements);
-    else if (dst->ir.type == MOJOSHADER_IR_MEMORY)
-        dst = new_ir_memory(ctx, dst->memory.index, dst->info.type, dst->info.elements);
-    else
-        assert(0 && "Unexpected condition");
 
-    // !!! FIXME: write masking!
-    return new_ir_eseq(ctx,
-                new_ir_seq(ctx,
-                    new_ir_move(ctx, new_ir_temp(ctx, tmp, type, elems), new_ir_binop(ctx, op, lvalue, rvalue), -1),
-                    new_ir_move(ctx, dst, new_ir_temp(ctx, tmp, type, elems), -1)),
-                new_ir_temp(ctx, tmp, type, elems));
-} // build_ir_assign_binop
+static MOJOSHADER_astData MOJOSHADER_out_of_mem_ast_data = {
+    1, &MOJOSHADER_out_of_mem_error, 0, 0, 0, 0, 0, 0
+};
 
-static MOJOSHADER_irExpression *build_ir_assign(Context *ctx,
-                                                const MOJOSHADER_astExpressionBinary *ast)
+
+// !!! FIXME: cut and paste from assembler.
+static const MOJOSHADER_astData *build_failed_ast(Context *ctx)
 {
-    MOJOSHADER_irExpression *lvalue = build_ir_expr(ctx, ast->left);
-    MOJOSHADER_irExpression *rvalue = build_ir_expr(ctx, ast->right);
-    const MOJOSHADER_astDataTypeType type = lvalue->info.type;
-    const int elems = lvalue->info.elements;
-    const int tmp = generate_ir_temp(ctx);
+    assert(isfail(ctx));
 
-    // Semantic analysis should have inserted casts if necessary.
-    assert(type == rvalue->info.type);
-    assert(elems == rvalue->info.elements);
+    if (ctx->out_of_memory)
+        return &MOJOSHADER_out_of_mem_ast_data;
+        
+    MOJOSHADER_astData *retval = NULL;
+    retval = (MOJOSHADER_astData *) Malloc(ctx, sizeof (MOJOSHADER_astData));
+    if (retval == NULL)
+        return &MOJOSHADER_out_of_mem_ast_data;
 
-    // !!! FIXME: write masking!
-    // !!! FIXME: whole array/struct assignments need to become a sequence of moves.
-    return new_ir_eseq(ctx,
-                new_ir_seq(ctx,
-                    new_ir_move(ctx, new_ir_temp(ctx, tmp, type, elems), rvalue, -1),
-                    new_ir_move(ctx, lvalue, new_ir_temp(ctx, tmp, type, elems), -1)),
-                new_ir_temp(ctx, tmp, type, elems));
-} // build_ir_assign
+    memset(retval, '\0', sizeof (MOJOSHADER_astData));
+    retval->source_profile = ctx->source_profile;
+    retval->malloc = (ctx->malloc == MOJOSHADER_internal_malloc) ? NULL : ctx->malloc;
+    retval->free = (ctx->free == MOJOSHADER_internal_free) ? NULL : ctx->free;
+    retval->malloc_data = ctx->malloc_data;
+    retval->error_count = errorlist_count(ctx->errors);
+    retval->errors = errorlist_flatten(ctx->errors);
 
+    if (ctx->out_of_memory)
+    {
+        Free(ctx, retval);
+        return &MOJOSHADER_out_of_mem_ast_data;
+    } // if
 
-// The AST must be perfect and normalized and sane here. If there are any
-//  strange corner cases, you should strive to handle them in semantic
-//  analysis, so conversion to IR can proceed with a minimum of drama.
-static void *build_ir_internal(Context *ctx, void *_ast);
-static inline MOJOSHADER_irNode *build_ir(Context *ctx, void *_ast)
-{
-    return (MOJOSHADER_irNode *) build_ir_internal(ctx, _ast);
-} // build_ir
+    return retval;
+} // build_failed_ast
 
-static void *build_ir_internal(Context *ctx, void *_ast)
+
+static const MOJOSHADER_astData *build_astdata(Context *ctx)
 {
-    if ((_ast == NULL) || (ctx->out_of_memory))
-        return NULL;
+    MOJOSHADER_astData *retval = NULL;
 
-    MOJOSHADER_astNode *ast = (MOJOSHADER_astNode *) _ast;
+    if (ctx->out_of_memory)
+        return &MOJOSHADER_out_of_mem_ast_data;
 
-    // upkeep so we report correct error locations...
-    ctx->sourcefile = ast->ast.filename;
-    ctx->sourceline = ast->ast.line;
+    retval = (MOJOSHADER_astData *) Malloc(ctx, sizeof (MOJOSHADER_astData));
+    if (retval == NULL)
+        return &MOJOSHADER_out_of_mem_ast_data;
 
-    switch (ast->ast.type)
+    memset(retval, '\0', sizeof (MOJOSHADER_astData));
+    retval->malloc = (ctx->malloc == MOJOSHADER_internal_malloc) ? NULL : ctx->malloc;
+    retval->free = (ctx->free == MOJOSHADER_internal_free) ? NULL : ctx->free;
+    retval->malloc_data = ctx->malloc_data;
+
+    if (!isfail(ctx))
     {
-        case MOJOSHADER_AST_OP_PREINCREMENT:  // !!! FIXME: sequence points?
-            return build_ir_preincdec(ctx, &ast->unary, MOJOSHADER_IR_BINOP_ADD);
+        retval->source_profile = ctx->source_profile;
+        retval->ast = ctx->ast;
+    } // if
 
-        case MOJOSHADER_AST_OP_POSTINCREMENT: // !!! FIXME: sequence points?
-            return build_ir_postincdec(ctx, &ast->unary, MOJOSHADER_IR_BINOP_ADD);
+    retval->error_count = errorlist_count(ctx->errors);
+    retval->errors = errorlist_flatten(ctx->errors);
+    if (ctx->out_of_memory)
+    {
+        Free(ctx, retval);
+        return &MOJOSHADER_out_of_mem_ast_data;
+    } // if
 
-        case MOJOSHADER_AST_OP_PREDECREMENT:  // !!! FIXME: sequence points?
-            return build_ir_preincdec(ctx, &ast->unary, MOJOSHADER_IR_BINOP_SUBTRACT);
+    retval->opaque = ctx;
 
-        case MOJOSHADER_AST_OP_POSTDECREMENT: // !!! FIXME: sequence points?
-            return build_ir_postincdec(ctx, &ast->unary, MOJOSHADER_IR_BINOP_SUBTRACT);
+    return retval;
+} // build_astdata
 
-        case MOJOSHADER_AST_OP_COMPLEMENT:
-            return NEW_IR_BINOP(XOR, build_ir_expr(ctx, ast->unary.operand),
-                                new_ir_constint(ctx, 0xFFFFFFFF));
 
-        case MOJOSHADER_AST_OP_NEGATE:  // !!! FIXME: -0.0f != +0.0f
-            return NEW_IR_BINOP(SUBTRACT, build_ir_increxpr(ctx, ast->unary.datatype, -1),
-                                build_ir_expr(ctx, ast->unary.operand));
+static void choose_src_profile(Context *ctx, const char *srcprofile)
+{
+    ctx->source_profile = srcprofile;
+
+    #define TEST_PROFILE(x) if (strcmp(srcprofile, x) == 0) { return; }
+
+    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_VS_1_1);
+    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_VS_2_0);
+    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_VS_3_0);
+    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_1);
+    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_2);
+    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_3);
+    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_4);
+    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_2_0);
+    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_3_0);
+
+    #undef TEST_PROFILE
 
-        case MOJOSHADER_AST_OP_NOT:  // operand must be bool here!
-            assert(ast->unary.operand->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
-            return NEW_IR_BINOP(XOR, build_ir_expr(ctx, ast->unary.operand),
-                                new_ir_constint(ctx, 1));
+    fail(ctx, "Unknown profile");
+} // choose_src_profile
 
-        case MOJOSHADER_AST_OP_DEREF_ARRAY:
-            return build_ir_derefarray(ctx, &ast->binary);
 
-        case MOJOSHADER_AST_OP_DEREF_STRUCT:
-            if (ast->derefstruct.isswizzle)
-                return build_ir_swizzle(ctx, &ast->derefstruct);
-            return build_ir_derefstruct(ctx, &ast->derefstruct);
+static MOJOSHADER_compileData MOJOSHADER_out_of_mem_compile_data = {
+    1, &MOJOSHADER_out_of_mem_error, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
 
-        case MOJOSHADER_AST_OP_COMMA:
-            // evaluate and throw away left, return right.
-            return new_ir_eseq(ctx, new_ir_expr_stmt(ctx, build_ir_expr(ctx, ast->binary.left)),
-                               build_ir_expr(ctx, ast->binary.right));
 
-        case MOJOSHADER_AST_OP_LESSTHAN: return EASY_IR_COMPARE(LT);
-        case MOJOSHADER_AST_OP_GREATERTHAN: return EASY_IR_COMPARE(GT);
-        case MOJOSHADER_AST_OP_LESSTHANOREQUAL: return EASY_IR_COMPARE(LEQ);
-        case MOJOSHADER_AST_OP_GREATERTHANOREQUAL: return EASY_IR_COMPARE(GEQ);
-        case MOJOSHADER_AST_OP_NOTEQUAL: return EASY_IR_COMPARE(NEQ);
-        case MOJOSHADER_AST_OP_EQUAL: return EASY_IR_COMPARE(EQL);
+// !!! FIXME: cut and paste from assembler.
+static const MOJOSHADER_compileData *build_failed_compile(Context *ctx)
+{
+    assert(isfail(ctx));
 
-        case MOJOSHADER_AST_OP_MULTIPLY: return EASY_IR_BINOP(MULTIPLY);
-        case MOJOSHADER_AST_OP_DIVIDE: return EASY_IR_BINOP(DIVIDE);
-        case MOJOSHADER_AST_OP_MODULO: return EASY_IR_BINOP(MODULO);
-        case MOJOSHADER_AST_OP_ADD: return EASY_IR_BINOP(ADD);
-        case MOJOSHADER_AST_OP_SUBTRACT: return EASY_IR_BINOP(SUBTRACT);
-        case MOJOSHADER_AST_OP_LSHIFT: return EASY_IR_BINOP(LSHIFT);
-        case MOJOSHADER_AST_OP_RSHIFT: return EASY_IR_BINOP(RSHIFT);
-        case MOJOSHADER_AST_OP_BINARYAND: return EASY_IR_BINOP(AND);
-        case MOJOSHADER_AST_OP_BINARYXOR: return EASY_IR_BINOP(XOR);
-        case MOJOSHADER_AST_OP_BINARYOR: return EASY_IR_BINOP(OR);
+    MOJOSHADER_compileData *retval = NULL;
+    retval = (MOJOSHADER_compileData *) Malloc(ctx, sizeof (MOJOSHADER_compileData));
+    if (retval == NULL)
+        return &MOJOSHADER_out_of_mem_compile_data;
 
-        case MOJOSHADER_AST_OP_LOGICALAND:
-            return build_ir_logical_and(ctx, &ast->binary);
+    memset(retval, '\0', sizeof (MOJOSHADER_compileData));
+    retval->malloc = (ctx->malloc == MOJOSHADER_internal_malloc) ? NULL : ctx->malloc;
+    retval->free = (ctx->free == MOJOSHADER_internal_free) ? NULL : ctx->free;
+    retval->malloc_data = ctx->malloc_data;
+    retval->source_profile = ctx->source_profile;
+    retval->error_count = errorlist_count(ctx->errors);
+    retval->errors = errorlist_flatten(ctx->errors);
+    retval->warning_count = errorlist_count(ctx->warnings);
+    retval->warnings = errorlist_flatten(ctx->warnings);
 
-        case MOJOSHADER_AST_OP_LOGICALOR:
-            return build_ir_logical_or(ctx, &ast->binary);
+    if (ctx->out_of_memory)  // in case something failed up there.
+    {
+        MOJOSHADER_freeCompileData(retval);
+        return &MOJOSHADER_out_of_mem_compile_data;
+    } // if
 
-        case MOJOSHADER_AST_OP_ASSIGN:
-            return build_ir_assign(ctx, &ast->binary);
+    return retval;
+} // build_failed_compile
 
-        case MOJOSHADER_AST_OP_MULASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_MULTIPLY, &ast->binary);
-        case MOJOSHADER_AST_OP_DIVASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_DIVIDE, &ast->binary);
-        case MOJOSHADER_AST_OP_MODASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_MODULO, &ast->binary);
-        case MOJOSHADER_AST_OP_ADDASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_ADD, &ast->binary);
-        case MOJOSHADER_AST_OP_SUBASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_SUBTRACT, &ast->binary);
-        case MOJOSHADER_AST_OP_LSHIFTASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_LSHIFT, &ast->binary);
-        case MOJOSHADER_AST_OP_RSHIFTASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_RSHIFT, &ast->binary);
-        case MOJOSHADER_AST_OP_ANDASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_AND, &ast->binary);
-        case MOJOSHADER_AST_OP_XORASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_XOR, &ast->binary);
-        case MOJOSHADER_AST_OP_ORASSIGN: return build_ir_assign_binop(ctx, MOJOSHADER_IR_BINOP_OR, &ast->binary);
 
-        case MOJOSHADER_AST_OP_CONDITIONAL:
-            assert(ast->binary.left->datatype->type == MOJOSHADER_AST_DATATYPE_BOOL);
-            return build_ir_compare(ctx, MOJOSHADER_IR_COND_EQL,
-                                  build_ir_expr(ctx, ast->ternary.left),
-                                  new_ir_constbool(ctx, 1),
-                                  build_ir_expr(ctx, ast->ternary.center),
-                                  build_ir_expr(ctx, ast->ternary.right));
+static const MOJOSHADER_compileData *build_compiledata(Context *ctx)
+{
+    assert(!isfail(ctx));
 
-        case MOJOSHADER_AST_OP_IDENTIFIER:
-            return build_ir_identifier(ctx, &ast->identifier);
+    MOJOSHADER_compileData *retval = NULL;
 
-        case MOJOSHADER_AST_OP_INT_LITERAL:
-            return new_ir_constint(ctx, ast->intliteral.value);
+    retval = (MOJOSHADER_compileData *) Malloc(ctx, sizeof (MOJOSHADER_compileData));
+    if (retval == NULL)
+        return &MOJOSHADER_out_of_mem_compile_data;
 
-        case MOJOSHADER_AST_OP_FLOAT_LITERAL:
-            return new_ir_constfloat(ctx, ast->floatliteral.value);
+    memset(retval, '\0', sizeof (MOJOSHADER_compileData));
+    retval->malloc = (ctx->malloc == MOJOSHADER_internal_malloc) ? NULL : ctx->malloc;
+    retval->free = (ctx->free == MOJOSHADER_internal_free) ? NULL : ctx->free;
+    retval->malloc_data = ctx->malloc_data;
+    retval->source_profile = ctx->source_profile;
 
-        case MOJOSHADER_AST_OP_BOOLEAN_LITERAL:
-            return new_ir_constbool(ctx, ast->boolliteral.value);
+    // hand off what codegen() built; destroy_context() won't free it now.
+    retval->output = ctx->output;
+    retval->output_len = ctx->output_len;
+    retval->bytecode = ctx->bytecode;
+    retval->bytecode_len = ctx->bytecode_len;
+    retval->symbols = ctx->symbols;
+    retval->symbol_count = ctx->symbol_count;
+    ctx->output = NULL;
+    ctx->bytecode = NULL;
+    ctx->symbols = NULL;
+    ctx->symbol_count = 0;
 
-        case MOJOSHADER_AST_OP_CALLFUNC:
-            return build_ir_call(ctx, &ast->callfunc);
+    retval->error_count = errorlist_count(ctx->errors);
+    retval->errors = errorlist_flatten(ctx->errors);
+    retval->warning_count = errorlist_count(ctx->warnings);
+    retval->warnings = errorlist_flatten(ctx->warnings);
 
-        case MOJOSHADER_AST_OP_CONSTRUCTOR:
-            return build_ir_constructor(ctx, &ast->constructor);
+    if (ctx->want_ir_stats)
+    {
+        const size_t len = sizeof (MOJOSHADER_irPassStats) * IR_PASS_TOTAL;
+        MOJOSHADER_irPassStats *passes = (MOJOSHADER_irPassStats *) Malloc(ctx, len);
+        if (passes != NULL)
+        {
+            int i;
+            for (i = 0; i < IR_PASS_TOTAL; i++)
+            {
+                const IrPassStats *stats = &ctx->ir_stats[i];
+                passes[i].name = ir_pass_names[i];
+                passes[i].instructions_before = stats->before.instructions;
+                passes[i].instructions_after = stats->after.instructions;
+                passes[i].nodes_before = stats->before.nodes;
+                passes[i].nodes_after = stats->after.nodes;
+                passes[i].temps_before = stats->before.temps;
+                passes[i].temps_after = stats->after.temps;
+                passes[i].changes = stats->changes;
+            } // for
+            retval->ir_passes = passes;
+            retval->ir_pass_count = IR_PASS_TOTAL;
+        } // if
+    } // if
 
-        case MOJOSHADER_AST_OP_CAST:
-            return build_ir_convert(ctx, &ast->cast);
+    if (ctx->out_of_memory)  // in case something failed up there.
+    {
+        MOJOSHADER_freeCompileData(retval);
+        return &MOJOSHADER_out_of_mem_compile_data;
+    } // if
 
-        case MOJOSHADER_AST_STATEMENT_BREAK:
-        {
-            const LoopLabels *labels = ctx->ir_loop;
-            assert(labels != NULL);  // semantic analysis should catch this.
-            return new_ir_jump(ctx, labels->end);
-        } // case
+    return retval;
+} // build_compiledata
 
-        case MOJOSHADER_AST_STATEMENT_CONTINUE:
-        {
-            const LoopLabels *labels = ctx->ir_loop;
-            assert(labels != NULL);  // semantic analysis should catch this.
-            return new_ir_jump(ctx, labels->start);
-        } // case
 
-        case MOJOSHADER_AST_STATEMENT_DISCARD:
-            return new_ir_seq(ctx, new_ir_discard(ctx), build_ir_stmt(ctx, ast->discardstmt.next));
+// API entry point...
 
-        case MOJOSHADER_AST_STATEMENT_EMPTY:
-            return build_ir(ctx, ast->stmt.next);  // skip it, do next thing.
+// !!! FIXME: move this (and a lot of other things) to mojoshader_ast.c.
+const MOJOSHADER_astData *MOJOSHADER_parseAst(const char *srcprofile,
+                                    const char *filename, const char *source,
+                                    unsigned int sourcelen,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeOpen include_open,
+                                    MOJOSHADER_includeClose include_close,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d)
+{
+    const MOJOSHADER_astData *retval = NULL;
+    Context *ctx = NULL;
 
-        case MOJOSHADER_AST_STATEMENT_EXPRESSION:
-            return new_ir_seq(ctx, new_ir_expr_stmt(ctx, build_ir_expr(ctx, ast->exprstmt.expr)), build_ir_stmt(ctx, ast->exprstmt.next));
+    if ( ((m == NULL) && (f != NULL)) || ((m != NULL) && (f == NULL)) )
+        return &MOJOSHADER_out_of_mem_ast_data;  // supply both or neither.
 
-        case MOJOSHADER_AST_STATEMENT_IF:
-            return build_ir_ifstmt(ctx, &ast->ifstmt);
+    ctx = build_context(m, f, d);
+    if (ctx == NULL)
+        return &MOJOSHADER_out_of_mem_ast_data;
 
-        case MOJOSHADER_AST_STATEMENT_TYPEDEF:  // ignore this, move on.
-            return build_ir(ctx, ast->typedefstmt.next);
+    choose_src_profile(ctx, srcprofile);
 
-        case MOJOSHADER_AST_STATEMENT_SWITCH:
-            return build_ir_switch(ctx, &ast->switchstmt);
+    if (!isfail(ctx))
+    {
+        parse_source(ctx, filename, source, sourcelen, defs, define_count,
+                     include_open, include_close, NULL);
+    } // if
 
-        case MOJOSHADER_AST_STATEMENT_STRUCT:  // ignore this, move on.
-            return build_ir(ctx, ast->structstmt.next);
+    if (!isfail(ctx))
+        retval = build_astdata(ctx);  // ctx isn't destroyed yet!
+    else
+    {
+        retval = (MOJOSHADER_astData *) build_failed_ast(ctx);
+        destroy_context(ctx);
+    } // else
 
-        case MOJOSHADER_AST_STATEMENT_VARDECL: // ignore this, move on.
-            return build_ir(ctx, ast->vardeclstmt.next);
+    return retval;
+} // MOJOSHADER_parseAst
 
-        case MOJOSHADER_AST_STATEMENT_BLOCK:
-            return new_ir_seq(ctx, build_ir_stmt(ctx, ast->blockstmt.statements), build_ir_stmt(ctx, ast->blockstmt.next));
 
-        case MOJOSHADER_AST_STATEMENT_FOR:
-            return build_ir_forstmt(ctx, &ast->forstmt);
+void MOJOSHADER_freeAstData(const MOJOSHADER_astData *_data)
+{
+    MOJOSHADER_astData *data = (MOJOSHADER_astData *) _data;
+    if ((data == NULL) || (data == &MOJOSHADER_out_of_mem_ast_data))
+        return;  // no-op.
 
-        case MOJOSHADER_AST_STATEMENT_DO:
-            return build_ir_dostmt(ctx, &ast->dostmt);
+    // !!! FIXME: this needs to live for deleting the stringcache and the ast.
+    Context *ctx = (Context *) data->opaque;
+    MOJOSHADER_free f = (data->free == NULL) ? MOJOSHADER_internal_free : data->free;
+    void *d = data->malloc_data;
+    int i;
 
-        case MOJOSHADER_AST_STATEMENT_WHILE:
-            return build_ir_whilestmt(ctx, &ast->whilestmt);
+    // we don't f(data->source_profile), because that's internal static data.
 
-        case MOJOSHADER_AST_STATEMENT_RETURN:
-        {
-            const int label = ctx->ir_end;
-            assert(label >= 0);  // parser should have caught this!
-            MOJOSHADER_irStatement *retval = NULL;
-            if (ast->returnstmt.expr != NULL)
-            {
-                // !!! FIXME: whole array/struct returns need to move more into the temp.
-                const MOJOSHADER_astDataType *dt = reduce_datatype(ctx, ast->returnstmt.expr->datatype);
-                const MOJOSHADER_astDataTypeType type = datatype_base(ctx, dt)->type;
-                const int elems = datatype_elems(ctx, dt);
-                assert(ctx->ir_ret >= 0);
-                retval = new_ir_move(ctx, new_ir_temp(ctx, ctx->ir_ret, type, elems), build_ir_expr(ctx, ast->returnstmt.expr), -1);
-            } // if
-            return new_ir_seq(ctx, retval, new_ir_jump(ctx, label));
-        } // case
+    for (i = 0; i < data->error_count; i++)
+    {
+        f((void *) data->errors[i].error, d);
+        f((void *) data->errors[i].filename, d);
+    } // for
+    f((void *) data->errors, d);
 
-        case MOJOSHADER_AST_COMPUNIT_TYPEDEF:
-        case MOJOSHADER_AST_COMPUNIT_STRUCT:
-        case MOJOSHADER_AST_COMPUNIT_VARIABLE:
-        case MOJOSHADER_AST_COMPUNIT_FUNCTION:
-        case MOJOSHADER_AST_ARGUMENTS:
-        case MOJOSHADER_AST_OP_STRING_LITERAL:
-        case MOJOSHADER_AST_SWITCH_CASE:
-        case MOJOSHADER_AST_SCALAR_OR_ARRAY:
-        case MOJOSHADER_AST_TYPEDEF:
-        case MOJOSHADER_AST_FUNCTION_PARAMS:
-        case MOJOSHADER_AST_FUNCTION_SIGNATURE:
-        case MOJOSHADER_AST_STRUCT_DECLARATION:
-        case MOJOSHADER_AST_STRUCT_MEMBER:
-        case MOJOSHADER_AST_VARIABLE_DECLARATION:
-        case MOJOSHADER_AST_ANNOTATION:
-        case MOJOSHADER_AST_PACK_OFFSET:
-        case MOJOSHADER_AST_VARIABLE_LOWLEVEL:
-            assert(0 && "Shouldn't hit this in build_ir.");
-            return NULL;
+    // don't delete data->ast (it'll delete with the context).
+    f(data, d);
 
-        default:
-            assert(0 && "unexpected type");
-            return NULL;
-    } // switch
-} // build_ir
+    destroy_context(ctx);  // finally safe to destroy this.
+} // MOJOSHADER_freeAstData
 
-static void print_ir(FILE *io, unsigned int depth, void *_ir)
+
+static const MOJOSHADER_compileData *compile_internal(const char *srcprofile,
+                                    const char *filename, const char *source,
+                                    unsigned int sourcelen,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeOpen include_open,
+                                    MOJOSHADER_includeClose include_close,
+                                    MOJOSHADER_includeCache *include_cache,
+                                    MOJOSHADER_astCache *ast_cache,
+                                    const int max_analysis_threads,
+                                    const int ir_stats,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d)
 {
-    MOJOSHADER_irNode *ir = (MOJOSHADER_irNode *) _ir;
-    if (ir == NULL)
-        return;
+    // !!! FIXME: cut and paste from MOJOSHADER_parseAst().
+    MOJOSHADER_compileData *retval = NULL;
+    Context *ctx = NULL;
 
-    const char *fname = strrchr(ir->ir.filename, '/');
-    if (fname != NULL)
-        fname++;
-    else
-    {
-        fname = strrchr(ir->ir.filename, '\\');
-        if (fname != NULL)
-            fname++;
-        else
-            fname = ir->ir.filename;
-    } // else
+    if ( ((m == NULL) && (f != NULL)) || ((m != NULL) && (f == NULL)) )
+        return &MOJOSHADER_out_of_mem_compile_data;  // supply both or neither.
 
-    int i;
-    for (i = 0; i < depth; i++)
-        fprintf(io, "  ");
-    depth++;
+    ctx = build_context(m, f, d);
+    if (ctx == NULL)
+        return &MOJOSHADER_out_of_mem_compile_data;
 
-    fprintf(io, "[ %s:%d ", fname, ir->ir.line);
+    ctx->max_analysis_threads = max_analysis_threads;
+    ctx->want_ir_stats = ir_stats || DEBUG_COMPILER_IR;  // debug builds print them.
+    choose_src_profile(ctx, srcprofile);
 
-    switch (ir->ir.type)
+    if ((!isfail(ctx)) && (ast_cache != NULL))
     {
-        case MOJOSHADER_IR_LABEL:
-            fprintf(io, "LABEL %d ]\n", ir->stmt.label.index);
-            break;
-
-        case MOJOSHADER_IR_CONSTANT:
-            fprintf(io, "CONSTANT ");
-            switch (ir->expr.constant.info.type)
-            {
-                case MOJOSHADER_AST_DATATYPE_BOOL:
-                case MOJOSHADER_AST_DATATYPE_INT:
-                case MOJOSHADER_AST_DATATYPE_UINT:
-                    for (i = 0; i < ir->expr.constant.info.elements-1; i++)
-                        fprintf(io, "%d, ", ir->expr.constant.value.ival[i]);
-                    if (ir->expr.constant.info.elements > 0)
-                        fprintf(io, "%d", ir->expr.constant.value.ival[i]);
-                    break;
+        // this does semantic analysis too, unless it can skip all of it.
+        parse_source_cached(ctx, ast_cache, filename, source, sourcelen,
+                            defs, define_count, include_open, include_close,
+                            include_cache);
+    } // if
 
-                case MOJOSHADER_AST_DATATYPE_FLOAT:
-                case MOJOSHADER_AST_DATATYPE_FLOAT_SNORM:
-                case MOJOSHADER_AST_DATATYPE_FLOAT_UNORM:
-                case MOJOSHADER_AST_DATATYPE_HALF:
-                case MOJOSHADER_AST_DATATYPE_DOUBLE:
-                    for (i = 0; i < ir->expr.constant.info.elements-1; i++)
-                        fprintf(io, "%ff, ", ir->expr.constant.value.fval[i]);
-                    if (ir->expr.constant.info.elements > 0)
-                        fprintf(io, "%ff", ir->expr.constant.value.fval[i]);
-                    break;
+    else if (!isfail(ctx))
+    {
+        parse_source(ctx, filename, source, sourcelen, defs, define_count,
+                     include_open, include_close, include_cache);
+        if (!isfail(ctx))
+            semantic_analysis(ctx);
+    } // else if
 
-                default: assert(0 && "shouldn't happen");
-            } // switch
-            fprintf(io, " ]\n");
-            break;
+    if (!isfail(ctx))
+        intermediate_representation(ctx);
 
-        case MOJOSHADER_IR_TEMP:
-            fprintf(io, "TEMP %d ]\n", ir->expr.temp.index);
-            break;
+    if (!isfail(ctx))
+        codegen(ctx);
 
-        case MOJOSHADER_IR_DISCARD:
-            fprintf(io, "DISCARD ]\n");
-            break;
+    if (isfail(ctx))
+        retval = (MOJOSHADER_compileData *) build_failed_compile(ctx);
+    else
+        retval = (MOJOSHADER_compileData *) build_compiledata(ctx);
 
-        case MOJOSHADER_IR_SWIZZLE:
-            fprintf(io, "SWIZZLE");
-            for (i = 0; i < ir->expr.swizzle.info.elements-1; i++)
-                fprintf(io, " %d", (int) ir->expr.swizzle.channels[i]);
-            fprintf(io, " ]\n");
-            print_ir(io, depth, ir->expr.swizzle.expr);
-            break;
+    destroy_context(ctx);
+    return retval;
+} // compile_internal
 
-        case MOJOSHADER_IR_CONSTRUCT:
-            fprintf(io, "CONSTRUCT ]\n");
-            print_ir(io, depth, ir->expr.construct.args);
-            break;
 
-        case MOJOSHADER_IR_CONVERT:
-            fprintf(io, "CONVERT ]\n");
-            print_ir(io, depth, ir->expr.convert.expr);
-            break;
+const MOJOSHADER_compileData *MOJOSHADER_compile(const char *srcprofile,
+                                    const char *filename, const char *source,
+                                    unsigned int sourcelen,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeOpen include_open,
+                                    MOJOSHADER_includeClose include_close,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d)
+{
+    return compile_internal(srcprofile, filename, source, sourcelen, defs,
+                            define_count, include_open, include_close, NULL,
+                            NULL, 0, 0, m, f, d);
+} // MOJOSHADER_compile
 
-        case MOJOSHADER_IR_BINOP:
-            fprintf(io, "BINOP ");
-            switch (ir->expr.binop.op)
-            {
-                #define PRINT_IR_BINOP(x) \
-                    case MOJOSHADER_IR_BINOP_##x: fprintf(io, #x); break;
-                PRINT_IR_BINOP(ADD)
-                PRINT_IR_BINOP(SUBTRACT)
-                PRINT_IR_BINOP(MULTIPLY)
-                PRINT_IR_BINOP(DIVIDE)
-                PRINT_IR_BINOP(MODULO)
-                PRINT_IR_BINOP(AND)
-                PRINT_IR_BINOP(OR)
-                PRINT_IR_BINOP(XOR)
-                PRINT_IR_BINOP(LSHIFT)
-                PRINT_IR_BINOP(RSHIFT)
-                PRINT_IR_BINOP(UNKNOWN)
-                #undef PRINT_IR_BINOP
-                default: assert(0 && "unexpected case"); break;
-            } // switch
-            fprintf(io, " ]\n");
-            print_ir(io, depth, ir->expr.binop.left);
-            print_ir(io, depth, ir->expr.binop.right);
-            break;
 
-        case MOJOSHADER_IR_MEMORY:
-            fprintf(io, "MEMORY %d ]\n", ir->expr.memory.index);
-            break;
+const MOJOSHADER_compileData *MOJOSHADER_compileWithIrStats(
+                                    const char *srcprofile,
+                                    const char *filename, const char *source,
+                                    unsigned int sourcelen,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeOpen include_open,
+                                    MOJOSHADER_includeClose include_close,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d)
+{
+    return compile_internal(srcprofile, filename, source, sourcelen, defs,
+                            define_count, include_open, include_close, NULL,
+                            NULL, 0, 1, m, f, d);
+} // MOJOSHADER_compileWithIrStats
 
-        case MOJOSHADER_IR_CALL:
-            fprintf(io, "CALL %d ]\n", ir->expr.call.index);
-            print_ir(io, depth, ir->expr.call.args);
-            break;
 
-        case MOJOSHADER_IR_ESEQ:
-            fprintf(io, "ESEQ ]\n");
-            print_ir(io, depth, ir->expr.eseq.stmt);
-            break;
+const MOJOSHADER_compileData *MOJOSHADER_compileWithCache(
+                                    const char *srcprofile,
+                                    const char *filename, const char *source,
+                                    unsigned int sourcelen,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeCache *cache,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d)
+{
+    assert(cache != NULL);
+    return compile_internal(srcprofile, filename, source, sourcelen, defs,
+                            define_count, NULL, NULL, cache, NULL, 0, 0, m, f, d);
+} // MOJOSHADER_compileWithCache
 
-        case MOJOSHADER_IR_ARRAY:
-            fprintf(io, "ARRAY ]\n");
-            print_ir(io, depth, ir->expr.array.array);
-            print_ir(io, depth, ir->expr.array.element);
-            break;
 
-        case MOJOSHADER_IR_MOVE:
-            fprintf(io, "MOVE ]\n");
-            print_ir(io, depth, ir->stmt.move.dst);
-            print_ir(io, depth, ir->stmt.move.src);
-            break;
+const MOJOSHADER_compileData *MOJOSHADER_compileWithAstCache(
+                                    const char *srcprofile,
+                                    const char *filename, const char *source,
+                                    unsigned int sourcelen,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeOpen include_open,
+                                    MOJOSHADER_includeClose include_close,
+                                    MOJOSHADER_astCache *cache,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d)
+{
+    assert(cache != NULL);
+    return compile_internal(srcprofile, filename, source, sourcelen, defs,
+                            define_count, include_open, include_close, NULL,
+                            cache, 0, 0, m, f, d);
+} // MOJOSHADER_compileWithAstCache
 
-        case MOJOSHADER_IR_EXPR_STMT:
-            fprintf(io, "EXPRSTMT ]\n");
-            print_ir(io, depth, ir->stmt.expr.expr);
-            break;
 
-        case MOJOSHADER_IR_JUMP:
-            fprintf(io, "JUMP %d ]\n", ir->stmt.jump.label);
-            break;
+const MOJOSHADER_compileData *MOJOSHADER_compileFile(const char *srcprofile,
+                                    const char *filename,
+                                    const MOJOSHADER_preprocessorDefine *defs,
+                                    unsigned int define_count,
+                                    MOJOSHADER_includeOpen include_open,
+                                    MOJOSHADER_includeClose include_close,
+                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
+                                    void *d)
+{
+    MOJOSHADER_compileData *retval = NULL;
+    const char *source = NULL;
+    unsigned int sourcelen = 0;
 
-        case MOJOSHADER_IR_CJUMP:
-            fprintf(io, "CJUMP ");
-            switch (ir->stmt.cjump.cond)
-            {
-                #define PRINT_IR_COND(x) \
-                    case MOJOSHADER_IR_COND_##x: fprintf(io, #x); break;
-                PRINT_IR_COND(EQL)
-                PRINT_IR_COND(NEQ)
-                PRINT_IR_COND(LT)
-                PRINT_IR_COND(GT)
-                PRINT_IR_COND(LEQ)
-                PRINT_IR_COND(GEQ)
-                PRINT_IR_COND(UNKNOWN)
-                #undef PRINT_IR_COND
-                default: assert(0 && "unexpected case"); break;
-            } // switch
-            fprintf(io, " %d %d ]\n", ir->stmt.cjump.iftrue, ir->stmt.cjump.iffalse);
-            print_ir(io, depth, ir->stmt.cjump.left);
-            print_ir(io, depth, ir->stmt.cjump.right);
-            break;
+    if ((include_open == NULL) && (include_close == NULL))
+    {
+        include_open = MOJOSHADER_mmapIncludeOpen;
+        include_close = MOJOSHADER_mmapIncludeClose;
+    } // if
 
-        case MOJOSHADER_IR_SEQ:
-            fprintf(io, "SEQ ]\n");
-            print_ir(io, depth, ir->stmt.seq.first);
-            print_ir(io, depth, ir->stmt.seq.next);  // !!! FIXME: don't recurse?
-            break;
+    if (!m) m = MOJOSHADER_internal_malloc;
+    if (!f) f = MOJOSHADER_internal_free;
 
-        case MOJOSHADER_IR_EXPRLIST:
-            fprintf(io, "EXPRLIST ]\n");
-            print_ir(io, depth, ir->misc.exprlist.expr);
-            print_ir(io, depth, ir->misc.exprlist.next);  // !!! FIXME: don't recurse?
-            break;
+    if (MOJOSHADER_mmapIncludeOpen(MOJOSHADER_INCLUDETYPE_LOCAL, filename,
+                                   NULL, &source, &sourcelen, m, f, d))
+    {
+        const MOJOSHADER_compileData *data;
+        data = compile_internal(srcprofile, filename, source, sourcelen, defs,
+                                define_count, include_open, include_close,
+                                NULL, NULL, 0, 0, m, f, d);
+        MOJOSHADER_mmapIncludeClose(source, m, f, d);
+        return data;
+    } // if
 
-        default: assert(0 && "unexpected IR node"); break;
-    } // switch
-} // print_ir
+    retval = (MOJOSHADER_compileData *) m(sizeof (*retval), d);
+    if (retval == NULL)
+        return &MOJOSHADER_out_of_mem_compile_data;
 
-static void print_whole_ir(Context *ctx, FILE *io)
-{
-    if (ctx->ir != NULL)
+    memset(retval, '\0', sizeof (*retval));
+    retval->errors = errorlist_single(filename, MOJOSHADER_POSITION_NONE,
+                                      "Couldn't open file", m, f, d);
+    if (retval->errors == NULL)
     {
-        int i;
-        for (i = 0; i <= ctx->user_func_index; i++)
-        {
-            printf("[FUNCTION %d ]\n", i);
-            print_ir(io, 1, ctx->ir[i]);
-        } // for
+        f(retval, d);
+        return &MOJOSHADER_out_of_mem_compile_data;
     } // if
-} // print_whole_ir
 
-static void delete_ir(Context *ctx, void *_ir)
+    retval->error_count = 1;
+    retval->source_profile = srcprofile;
+    retval->malloc = m;
+    retval->free = f;
+    retval->malloc_data = d;
+    return retval;
+} // MOJOSHADER_compileFile
+
+
+typedef struct CompileBatch
+{
+    const char *srcprofile;
+    const char *filename;
+    const char *source;
+    unsigned int sourcelen;
+    const MOJOSHADER_compilePermutation *permutations;
+    unsigned int permutation_count;
+    unsigned int next_permutation;
+    Mutex *mutex;  // guards next_permutation. NULL if we're the only thread.
+    int max_analysis_threads;
+    MOJOSHADER_includeOpen include_open;
+    MOJOSHADER_includeClose include_close;
+    MOJOSHADER_includeCache *include_cache;
+    MOJOSHADER_astCache *ast_cache;
+    const MOJOSHADER_compileData **results;
+    MOJOSHADER_malloc malloc;
+    MOJOSHADER_free free;
+    void *malloc_data;
+} CompileBatch;
+
+static void compile_batch_worker(void *data)
 {
-    MOJOSHADER_irNode *ir = (MOJOSHADER_irNode *) _ir;
-    if (ir == NULL)
-        return;
+    CompileBatch *batch = (CompileBatch *) data;
 
-    switch (ir->ir.type)
+    while (1)
     {
-        case MOJOSHADER_IR_JUMP:
-        case MOJOSHADER_IR_LABEL:
-        case MOJOSHADER_IR_CONSTANT:
-        case MOJOSHADER_IR_TEMP:
-        case MOJOSHADER_IR_DISCARD:
-        case MOJOSHADER_IR_MEMORY:
-            break;  // nothing extra to free here.
+        if (batch->mutex != NULL)
+            mutex_lock(batch->mutex);
+        const unsigned int i = batch->next_permutation;
+        if (i < batch->permutation_count)
+            batch->next_permutation++;
+        if (batch->mutex != NULL)
+            mutex_unlock(batch->mutex);
+
+        if (i >= batch->permutation_count)
+            break;  // all done.
+
+        const MOJOSHADER_compilePermutation *perm = &batch->permutations[i];
+        MOJOSHADER_includeOpen inc_open = batch->include_open;
+        MOJOSHADER_includeClose inc_close = batch->include_close;
+        if (batch->include_cache != NULL)
+        {
+            inc_open = NULL;
+            inc_close = NULL;
+        } // if
 
-        case MOJOSHADER_IR_BINOP:
-            delete_ir(ctx, ir->expr.binop.left);
-            delete_ir(ctx, ir->expr.binop.right);
-            break;
+        batch->results[i] = compile_internal(batch->srcprofile,
+                                  batch->filename, batch->source,
+                                  batch->sourcelen, perm->defines,
+                                  perm->define_count, inc_open, inc_close,
+                                  batch->include_cache, batch->ast_cache,
+                                  batch->max_analysis_threads, 0, batch->malloc,
+                                  batch->free, batch->malloc_data);
+    } // while
+} // compile_batch_worker
+
+
+void MOJOSHADER_compileBatch(const char *srcprofile,
+                             const char *filename, const char *source,
+                             unsigned int sourcelen,
+                             const MOJOSHADER_compilePermutation *permutations,
+                             unsigned int permutation_count,
+                             unsigned int thread_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             const MOJOSHADER_compileData **results,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    CompileBatch batch;
+    Thread **threads = NULL;
+    unsigned int i;
 
-        case MOJOSHADER_IR_CALL:
-            delete_ir(ctx, ir->expr.call.args);
-            break;
+    if ( ((m == NULL) && (f != NULL)) || ((m != NULL) && (f == NULL)) )
+    {
+        for (i = 0; i < permutation_count; i++)  // supply both or neither.
+            results[i] = &MOJOSHADER_out_of_mem_compile_data;
+        return;
+    } // if
 
-        case MOJOSHADER_IR_ESEQ:
-            delete_ir(ctx, ir->expr.eseq.stmt);
-            delete_ir(ctx, ir->expr.eseq.expr);
-            break;
+    if (!m) m = MOJOSHADER_internal_malloc;
+    if (!f) f = MOJOSHADER_internal_free;
 
-        case MOJOSHADER_IR_ARRAY:
-            delete_ir(ctx, ir->expr.array.array);
-            delete_ir(ctx, ir->expr.array.element);
-            break;
+    memset(&batch, '\0', sizeof (batch));
+    batch.srcprofile = srcprofile;
+    batch.filename = filename;
+    batch.source = source;
+    batch.sourcelen = sourcelen;
+    batch.permutations = permutations;
+    batch.permutation_count = permutation_count;
+    batch.include_open = include_open;
+    batch.include_close = include_close;
+    batch.results = results;
+    batch.malloc = m;
+    batch.free = f;
+    batch.malloc_data = d;
+
+    // every permutation shares one include cache, so a header is only read
+    //  once per batch, and one AST cache, so permutations that preprocess
+    //  to the same thing are only parsed and checked once. If we can't
+    //  make these, the permutations just go without.
+    if ((include_open == NULL) == (include_close == NULL))
+    {
+        batch.include_cache = MOJOSHADER_createIncludeCache(include_open,
+                                                            include_close,
+                                                            m, f, d);
+    } // if
+    batch.ast_cache = MOJOSHADER_createAstCache(m, f, d);
 
-        case MOJOSHADER_IR_MOVE:
-            delete_ir(ctx, ir->stmt.move.dst);
-            delete_ir(ctx, ir->stmt.move.src);
-            break;
+    if (thread_count > permutation_count)
+        thread_count = permutation_count;
 
-        case MOJOSHADER_IR_EXPR_STMT:
-            delete_ir(ctx, ir->stmt.expr.expr);
-            break;
+    // the calling thread is a worker, too, so start one less than asked.
+    if (thread_count > 1)
+    {
+        // we're already using the threads we were given; don't let each
+        //  compile start more of its own for semantic analysis.
+        batch.max_analysis_threads = 1;
+        batch.mutex = mutex_create(m, f, d);
+        if (batch.mutex != NULL)
+            threads = (Thread **) m(sizeof (Thread *) * (thread_count-1), d);
+        if (threads != NULL)
+        {
+            // if some of these fail to start, the rest pick up the slack.
+            for (i = 0; i < thread_count - 1; i++)
+                threads[i] = thread_create(compile_batch_worker, &batch, m, f, d);
+        } // if
+    } // if
 
-        case MOJOSHADER_IR_CJUMP:
-            delete_ir(ctx, ir->stmt.cjump.left);
-            delete_ir(ctx, ir->stmt.cjump.right);
-            break;
+    compile_batch_worker(&batch);
 
-        case MOJOSHADER_IR_SEQ:
-            delete_ir(ctx, ir->stmt.seq.first);
-            delete_ir(ctx, ir->stmt.seq.next);  // !!! FIXME: don't recurse?
-            break;
+    if (threads != NULL)
+    {
+        for (i = 0; i < thread_count - 1; i++)
+            thread_join(threads[i]);
+        f(threads, d);
+    } // if
 
-        case MOJOSHADER_IR_EXPRLIST:
-            delete_ir(ctx, ir->misc.exprlist.expr);
-            delete_ir(ctx, ir->misc.exprlist.next);  // !!! FIXME: don't recurse?
-            break;
+    mutex_destroy(batch.mutex);
+    MOJOSHADER_destroyAstCache(batch.ast_cache);
+    MOJOSHADER_destroyIncludeCache(batch.include_cache);
+} // MOJOSHADER_compileBatch
 
-        case MOJOSHADER_IR_SWIZZLE:
-            delete_ir(ctx, ir->expr.swizzle.expr);
-            break;
 
-        case MOJOSHADER_IR_CONSTRUCT:
-            delete_ir(ctx, ir->expr.construct.args);
-            break;
+/* Compile sessions... */
 
-        case MOJOSHADER_IR_CONVERT:
-            delete_ir(ctx, ir->expr.convert.expr);
-            break;
+// A session holds on to the last compile that made it through IR: its
+//  context, with the AST, the symbols and the flattened IR, and a recording
+//  of what the preprocessor gave it, cut up into top-level declarations. If
+//  the next source only differs inside one function's body, we parse and
+//  check just that body, rebuild its IR, and run codegen() again. Anything
+//  else gets a full compile, which replaces the session's state if it gets
+//  that far.
 
-        default: assert(0 && "unexpected IR node"); break;
-    } // switch
+// Replaced function bodies, and the IR that codegen() unpacks every time,
+//  stay in the arena until the next full compile, so do one of those every
+//  so often anyhow.
+#define SESSION_MAX_INCREMENTAL 64
 
-    Free(ctx, ir);
-} // delete_ir
+// One top-level declaration on a session's tape: everything up to a ';', or
+//  up to the '}' at the end of a function body, that isn't inside braces or
+//  parentheses.
+typedef struct SessionUnit
+{
+    size_t start;  // offsets into the tape.
+    size_t body;  // the function body's '{', or 0 if this isn't a function.
+    size_t end;  // just past the last token.
+    int job;  // the function body's AnalysisJob, or -1.
+} SessionUnit;
 
-static void intermediate_representation(Context *ctx)
+typedef enum SessionWarningKind
 {
-    const MOJOSHADER_astCompilationUnit *ast = NULL;
-    const MOJOSHADER_astCompilationUnitFunction *astfn = NULL;
-    const size_t arraylen = (ctx->user_func_index+1) * sizeof (MOJOSHADER_irStatement *);
+    SESSION_WARNING_GLOBAL,  // from the global scope, before (job)'s body.
+    SESSION_WARNING_BODY,  // from checking (job)'s body.
+    SESSION_WARNING_IR  // from building (job)'s IR. The statics are job_count.
+} SessionWarningKind;
+
+// A compile that works doesn't have any errors, so warnings are all we keep.
+//  We need to know where each one came from, to replace them when that
+//  function changes and to report them in the order a full compile would.
+typedef struct SessionWarning
+{
+    MOJOSHADER_error warning;  // we own the strings.
+    int job;
+    SessionWarningKind kind;
+} SessionWarning;
+
+// What changed between the session's tape and a new one: one function's
+//  body. Everything after it in (file) is (delta) lines further down now.
+typedef struct SessionEdit
+{
+    int unit;
+    int job;
+    const char *file;  // where the body's '}' was, in the strcache...
+    unsigned int line;  // ...and the line it was on.
+    int delta;
+} SessionEdit;
+
+struct MOJOSHADER_compileSession
+{
+    const char *srcprofile;
+    char *filename;
+    MOJOSHADER_preprocessorDefine *defines;
+    unsigned int define_count;
+    MOJOSHADER_includeOpen include_open;  // only if we don't have a cache.
+    MOJOSHADER_includeClose include_close;
+    MOJOSHADER_includeCache *include_cache;
+    Context *ctx;  // NULL until something compiles far enough.
+    char *tape;  // what (ctx) was parsed from; see record_tokens().
+    size_t tapelen;
+    SessionUnit *units;  // NULL if (tape) didn't split up cleanly.
+    int unit_count;
+    AnalysisJob *jobs;  // each function body, and what it can see.
+    int job_count;
+    SessionWarning *warnings;  // in the order a full compile reports them.
+    int warning_count;
+    int incremental_count;  // compiles since the last full one.
+    MOJOSHADER_malloc malloc;
+    MOJOSHADER_free free;
+    void *malloc_data;
+};
 
-    ctx->ir = Malloc(ctx, arraylen);
-    if (ctx->ir == NULL)
+static void discard_messages(Context *ctx, ErrorList *list)
+{
+    const int count = errorlist_count(list);
+    MOJOSHADER_error *msgs = errorlist_flatten(list);
+    int i;
+
+    if (msgs == NULL)
         return;
-    memset(ctx->ir, '\0', arraylen);
 
-    ctx->ir_end = -1;
-    ctx->ir_ret = -1;
+    for (i = 0; i < count; i++)
+    {
+        Free(ctx, (void *) msgs[i].error);
+        Free(ctx, (void *) msgs[i].filename);
+    } // for
+    Free(ctx, msgs);
+} // discard_messages
 
-    for (ast = &ctx->ast->compunit; ast != NULL; ast = ast->next)
+static void free_session_warnings(MOJOSHADER_compileSession *session,
+                                  SessionWarning *warnings, const int count)
+{
+    void *d = session->malloc_data;
+    int i;
+
+    for (i = 0; i < count; i++)
     {
-        assert(ast->ast.type > MOJOSHADER_AST_COMPUNIT_START_RANGE);
-        assert(ast->ast.type < MOJOSHADER_AST_COMPUNIT_END_RANGE);
-        if (ast->ast.type != MOJOSHADER_AST_COMPUNIT_FUNCTION)
-            continue;  // only care about functions right now.
+        session->free((void *) warnings[i].warning.error, d);
+        session->free((void *) warnings[i].warning.filename, d);
+    } // for
+    session->free(warnings, d);
+} // free_session_warnings
+
+// Forget the last compile; the next one is a full compile.
+static void drop_session_state(MOJOSHADER_compileSession *session)
+{
+    void *d = session->malloc_data;
+
+    free_session_warnings(session, session->warnings, session->warning_count);
+    session->free(session->jobs, d);
+    session->free(session->units, d);
+    session->free(session->tape, d);
+    destroy_context(session->ctx);
+
+    session->ctx = NULL;
+    session->tape = NULL;
+    session->tapelen = 0;
+    session->units = NULL;
+    session->unit_count = 0;
+    session->jobs = NULL;
+    session->job_count = 0;
+    session->warnings = NULL;
+    session->warning_count = 0;
+    session->incremental_count = 0;
+} // drop_session_state
+
+// Cuts (tape) up into SessionUnits. The function bodies get jobs in order,
+//  and there has to be one for each of semantic analysis' (job_count) jobs.
+//  Returns NULL if the tape doesn't split up cleanly, which just means that
+//  every compile has to be a full one.
+static SessionUnit *split_session_units(Context *ctx, const char *tape,
+                                        const size_t tapelen,
+                                        const int job_count, int *_count)
+{
+    SessionUnit *units = NULL;
+    const char *token = NULL;
+    int alloc = 0;
+    int count = 0;
+    int jobs = 0;
+    int braces = 0;
+    int parens = 0;
+    int params = 0;  // had something in parentheses, like a parameter list.
+    int notfunc = 0;  // had something that a function can't, like a '='.
+    int pragma = 0;
+    int okay = 0;
+    size_t start = 0;
+    size_t body = 0;  // a function's '{' is never the first token.
+    size_t pos = 0;
+    TapeToken tt;
+
+    while (pos < tapelen)
+    {
+        const size_t tokenpos = pos;
+        const int toplevel = ((braces == 0) && (parens == 0));
+        int finished = 0;
 
-        astfn = (MOJOSHADER_astCompilationUnitFunction *) ast;
-        if (astfn->definition == NULL)  // just a predeclare; skip.
+        pos = read_tape_token(tape, pos, &tt, &token);
+        if (pragma)  // parse_tokens() skips these up to the newline.
+        {
+            pragma = (tt.tokenval != ((Token) '\n'));
             continue;
+        } // if
 
-        assert(ctx->ir_loop == NULL);  // parser should have caught this!
-        assert(ctx->ir_end < 0);  // parser should have caught this!
-        assert(ctx->ir_ret < 0);  // parser should have caught this!
-        const int start = generate_ir_label(ctx);  // !!! FIXME: store somewhere.
-        const int end = generate_ir_label(ctx);
-        ctx->ir_end = end;
+        switch (tt.tokenval)
+        {
+            case TOKEN_EOI:
+                okay = ((toplevel) && (start == tokenpos) && (jobs == job_count));
+                break;
 
-        if (astfn->declaration->datatype != NULL)
-            ctx->ir_ret = generate_ir_temp(ctx);
+            case TOKEN_PP_PRAGMA:
+                pragma = 1;
+                break;
 
-        MOJOSHADER_irStatement *funcseq = new_ir_seq(ctx, new_ir_label(ctx, start), build_ir_stmt(ctx, astfn->definition));
-        funcseq = new_ir_seq(ctx, funcseq, new_ir_label(ctx, end));
-        assert(ctx->ir_loop == NULL);  // parser should have caught this!
-        ctx->ir_end = -1;
-        ctx->ir_ret = -1;
+            case ((Token) '('):
+                parens++;
+                break;
 
-        assert(astfn->index <= ctx->user_func_index);
-        assert(ctx->ir[astfn->index] == NULL);
-        ctx->ir[astfn->index] = funcseq;
-    } // for
+            case ((Token) ')'):
+                parens--;
+                params |= ((parens == 0) && (braces == 0));
+                break;
 
-    print_whole_ir(ctx, stdout);
+            case ((Token) '{'):
+                if ((toplevel) && (params) && (!notfunc) && (body == 0))
+                    body = tokenpos;
+                braces++;
+                break;
 
-    // done with the AST, nuke it.
-    // !!! FIXME: we're going to need CTAB data from this at some point.
-    delete_compilation_unit(ctx, (MOJOSHADER_astCompilationUnit *) ctx->ast);
-    ctx->ast = NULL;
-} // intermediate_representation
+            case ((Token) '}'):
+                braces--;
+                finished = ((braces == 0) && (parens == 0) && (body != 0));
+                break;
 
+            case ((Token) ';'):
+                finished = toplevel;
+                break;
 
+            case ((Token) '='):
+                notfunc |= toplevel;
+                break;
 
-static MOJOSHADER_astData MOJOSHADER_out_of_mem_ast_data = {
-    1, &MOJOSHADER_out_of_mem_error, 0, 0, 0, 0, 0, 0
-};
+            case TOKEN_IDENTIFIER:
+                if ( (toplevel) &&
+                     ( ((tt.len == 6) && (memcmp(token, "struct", 6) == 0)) ||
+                       ((tt.len == 7) && (memcmp(token, "typedef", 7) == 0)) ) )
+                    notfunc = 1;
+                break;
 
+            default: break;
+        } // switch
 
-// !!! FIXME: cut and paste from assembler.
-static const MOJOSHADER_astData *build_failed_ast(Context *ctx)
-{
-    assert(isfail(ctx));
+        if ((tt.tokenval == TOKEN_EOI) || (braces < 0) || (parens < 0))
+            break;
 
-    if (ctx->out_of_memory)
-        return &MOJOSHADER_out_of_mem_ast_data;
-        
-    MOJOSHADER_astData *retval = NULL;
-    retval = (MOJOSHADER_astData *) Malloc(ctx, sizeof (MOJOSHADER_astData));
-    if (retval == NULL)
-        return &MOJOSHADER_out_of_mem_ast_data;
+        else if (finished)
+        {
+            if (!grow_array(ctx, (void **) &units, &alloc, count + 1,
+                            sizeof (SessionUnit)))
+                break;
 
-    memset(retval, '\0', sizeof (MOJOSHADER_astData));
-    retval->source_profile = ctx->source_profile;
-    retval->malloc = (ctx->malloc == MOJOSHADER_internal_malloc) ? NULL : ctx->malloc;
-    retval->free = (ctx->free == MOJOSHADER_internal_free) ? NULL : ctx->free;
-    retval->malloc_data = ctx->malloc_data;
-    retval->error_count = errorlist_count(ctx->errors);
-    retval->errors = errorlist_flatten(ctx->errors);
+            SessionUnit *unit = &units[count++];
+            unit->start = start;
+            unit->body = body;
+            unit->end = pos;
+            unit->job = (body != 0) ? jobs++ : -1;
+            start = pos;
+            body = 0;
+            params = notfunc = 0;
+        } // else if
+    } // while
 
-    if (ctx->out_of_memory)
+    if ((!okay) || (count == 0))
     {
-        Free(ctx, retval);
-        return &MOJOSHADER_out_of_mem_ast_data;
+        Free(ctx, units);
+        return NULL;
     } // if
 
-    return retval;
-} // build_failed_ast
+    *_count = count;
+    return units;
+} // split_session_units
+
+// Compares a new tape with the session's. Returns zero if they're the same,
+//  one if only the body of one function changed, which (edit) describes,
+//  and -1 for anything else. Both tapes have to use the session's strcache.
+static int find_session_edit(const MOJOSHADER_compileSession *session,
+                             const char *tape, const size_t tapelen,
+                             const SessionUnit *units, const int unit_count,
+                             SessionEdit *edit)
+{
+    const size_t bracelen = sizeof (TapeToken) + 2;  // a '{' or '}'.
+    const SessionUnit *a = NULL;  // the old version of what changed...
+    const SessionUnit *b = NULL;  // ...and the new one.
+    const char *atoken = NULL;
+    const char *btoken = NULL;
+    TapeToken att;
+    TapeToken btt;
+    size_t apos;
+    size_t bpos;
+    int i;
 
+    if ((tapelen == session->tapelen) && (memcmp(tape, session->tape, tapelen) == 0))
+        return 0;
+    else if (unit_count != session->unit_count)
+        return -1;
 
-static const MOJOSHADER_astData *build_astdata(Context *ctx)
-{
-    MOJOSHADER_astData *retval = NULL;
+    for (i = 0; i < unit_count; i++)
+    {
+        a = &session->units[i];
+        b = &units[i];
+        if (a->job != b->job)
+            return -1;
+        else if ( (a->end - a->start != b->end - b->start) ||
+                  (memcmp(session->tape + a->start, tape + b->start,
+                          a->end - a->start) != 0) )
+            break;
+    } // for
 
-    if (ctx->out_of_memory)
-        return &MOJOSHADER_out_of_mem_ast_data;
+    // If nothing changed but the line the source ends on, that moved what
+    //  the last function's AST says. Not worth the trouble.
+    if ((i == unit_count) || (a->job < 0))
+        return -1;
+
+    // the signature, up to and including the body's '{', has to be exactly
+    //  the same, line numbers and all: we keep the one we checked already.
+    const size_t header = (a->body - a->start) + bracelen;
+    if ( (b->body - b->start + bracelen != header) ||
+         (memcmp(session->tape + a->start, tape + b->start, header) != 0) )
+        return -1;
+
+    read_tape_token(session->tape, a->end - bracelen, &att, &atoken);
+    read_tape_token(tape, b->end - bracelen, &btt, &btoken);
+    assert(att.tokenval == ((Token) '}'));
+    assert(btt.tokenval == ((Token) '}'));
+    if (att.filename != btt.filename)
+        return -1;
+
+    edit->unit = i;
+    edit->job = a->job;
+    edit->file = att.filename;
+    edit->line = att.line;
+    edit->delta = ((int) btt.line) - ((int) att.line);
+
+    // If lines move, everything in (file) past (line) has to be after the
+    //  edit, and everything else before it, so we know what to move.
+    for (apos = 0; (edit->delta != 0) && (apos < a->end); )
+    {
+        apos = read_tape_token(session->tape, apos, &att, &atoken);
+        if ((att.filename == edit->file) && (att.line > edit->line))
+            return -1;
+    } // for
 
-    retval = (MOJOSHADER_astData *) Malloc(ctx, sizeof (MOJOSHADER_astData));
-    if (retval == NULL)
-        return &MOJOSHADER_out_of_mem_ast_data;
+    // The rest has to be the same, except for those line numbers.
+    apos = a->end;
+    bpos = b->end;
+    while ((apos < session->tapelen) && (bpos < tapelen))
+    {
+        apos = read_tape_token(session->tape, apos, &att, &atoken);
+        bpos = read_tape_token(tape, bpos, &btt, &btoken);
+        if ( (att.tokenval != btt.tokenval) || (att.len != btt.len) ||
+             (att.filename != btt.filename) ||
+             (memcmp(atoken, btoken, att.len) != 0) )
+            return -1;
+        else if (att.filename != edit->file)
+        {
+            if (att.line != btt.line)
+                return -1;
+        } // else if
+        else if ( ((edit->delta != 0) && (att.line <= edit->line)) ||
+                  (((int) btt.line) - ((int) att.line) != edit->delta) )
+            return -1;
+    } // while
 
-    memset(retval, '\0', sizeof (MOJOSHADER_astData));
-    retval->malloc = (ctx->malloc == MOJOSHADER_internal_malloc) ? NULL : ctx->malloc;
-    retval->free = (ctx->free == MOJOSHADER_internal_free) ? NULL : ctx->free;
-    retval->malloc_data = ctx->malloc_data;
+    return ((apos == session->tapelen) && (bpos == tapelen)) ? 1 : -1;
+} // find_session_edit
+
+// Parses (unit) of (tape) on its own, with the same global usertypes that
+//  it saw when it was parsed with everything else, so it gets the same
+//  datatypes, too. (eoi) is where the tape's TOKEN_EOI is. Returns NULL,
+//  without leaving any errors behind, if (unit) isn't exactly one function
+//  definition.
+static MOJOSHADER_astCompilationUnitFunction *reparse_function(Context *ctx,
+                                       const char *tape, const size_t tapelen,
+                                       const SessionUnit *unit,
+                                       const size_t eoi, const AnalysisJob *job)
+{
+    MOJOSHADER_astCompilationUnitFunction *retval = NULL;
+    const size_t unitlen = unit->end - unit->start;
+    const size_t eoilen = tapelen - eoi;
+    int i;
 
-    if (!isfail(ctx))
+    char *subtape = (char *) Malloc(ctx, unitlen + eoilen);
+    if (subtape == NULL)
+        return NULL;
+    memcpy(subtape, tape + unit->start, unitlen);
+    memcpy(subtape + unitlen, tape + eoi, eoilen);
+
+    const SymbolMap usertypes = ctx->usertypes;
+    MOJOSHADER_astNode *ast = ctx->ast;
+    MOJOSHADER_astDataType **globals = ctx->global_usertypes;
+    const int global_count = ctx->global_usertype_count;
+
+    if (create_symbolmap(ctx, &ctx->usertypes))
     {
-        retval->source_profile = ctx->source_profile;
-        retval->ast = ctx->ast;
+        // semantic analysis pushed these again, and knows which ones this
+        //  function could see.
+        ctx->usertypes.builtins = usertypes.builtins;
+        for (i = 0; i < global_count; i++)
+        {
+            const MOJOSHADER_astDataType *dt = globals[i];
+            const void *value = NULL;
+            if ( (hash_find(usertypes.hash, dt->user.name, &value)) &&
+                 (((const SymbolScope *) value)->serial <= job->visible_serial) )
+                push_symbol(ctx, &ctx->usertypes, dt->user.name, dt, 0, 0);
+        } // for
+
+        TokenSource src;
+        memset(&src, '\0', sizeof (src));
+        src.tape = subtape;
+        src.tapelen = unitlen + eoilen;
+        ctx->ast = NULL;
+        ctx->global_usertypes = NULL;
+        ctx->global_usertype_count = 0;
+        parse_tokens(ctx, &src);
+
+        const MOJOSHADER_astCompilationUnit *parsed;
+        parsed = (const MOJOSHADER_astCompilationUnit *) ctx->ast;
+        if ( (!isfail(ctx)) && (parsed != NULL) && (parsed->next == NULL) &&
+             (parsed->ast.type == MOJOSHADER_AST_COMPUNIT_FUNCTION) )
+        {
+            retval = (MOJOSHADER_astCompilationUnitFunction *) parsed;
+            if (retval->definition == NULL)
+                retval = NULL;
+        } // if
+
+        destroy_symbolmap(ctx, &ctx->usertypes);
     } // if
 
-    retval->error_count = errorlist_count(ctx->errors);
-    retval->errors = errorlist_flatten(ctx->errors);
-    if (ctx->out_of_memory)
+    ctx->usertypes = usertypes;
+    ctx->ast = ast;
+    ctx->global_usertypes = globals;
+    ctx->global_usertype_count = global_count;
+    Free(ctx, subtape);
+
+    // a full compile will report these properly.
+    discard_messages(ctx, ctx->errors);
+    discard_messages(ctx, ctx->warnings);
+    ctx->isfail = ctx->out_of_memory;
+    return retval;
+} // reparse_function
+
+static inline int session_warning_order(const MOJOSHADER_compileSession *s,
+                                        const int job,
+                                        const SessionWarningKind kind)
+{
+    // semantic analysis reports what it found at global scope before a
+    //  function right before that function's body; the IR comes after all
+    //  of that, a function at a time.
+    if (kind == SESSION_WARNING_IR)
+        return ((s->job_count + 1) * 2) + job;
+    return (job * 2) + ((kind == SESSION_WARNING_BODY) ? 1 : 0);
+} // session_warning_order
+
+// Replaces the warnings that (job) got for (kind) with (msgs). This takes
+//  over the strings in (msgs), but not the array.
+static void replace_session_warnings(Context *ctx,
+                                     MOJOSHADER_compileSession *session,
+                                     const int job,
+                                     const SessionWarningKind kind,
+                                     const MOJOSHADER_error *msgs,
+                                     const int count)
+{
+    const int order = session_warning_order(session, job, kind);
+    SessionWarning *warnings = NULL;
+    int total = count;
+    int added = 0;
+    int i, j, k;
+
+    for (i = 0; i < session->warning_count; i++)
     {
-        Free(ctx, retval);
-        return &MOJOSHADER_out_of_mem_ast_data;
+        const SessionWarning *w = &session->warnings[i];
+        total += (session_warning_order(session, w->job, w->kind) != order);
+    } // for
+
+    if (total > 0)
+    {
+        warnings = (SessionWarning *) Malloc(ctx, sizeof (SessionWarning) * total);
+        if (warnings == NULL)
+        {
+            for (i = 0; i < count; i++)
+            {
+                Free(ctx, (void *) msgs[i].error);
+                Free(ctx, (void *) msgs[i].filename);
+            } // for
+            return;
+        } // if
     } // if
 
-    retval->opaque = ctx;
+    j = 0;
+    for (i = 0; i <= session->warning_count; i++)
+    {
+        const SessionWarning *w = NULL;
+        int worder = 0;
+        if (i < session->warning_count)
+        {
+            w = &session->warnings[i];
+            worder = session_warning_order(session, w->job, w->kind);
+        } // if
 
-    return retval;
-} // build_astdata
+        if ((!added) && ((w == NULL) || (worder > order)))
+        {
+            for (added = 1, k = 0; k < count; k++, j++)
+            {
+                warnings[j].warning = msgs[k];
+                warnings[j].job = job;
+                warnings[j].kind = kind;
+            } // for
+        } // if
 
+        if (w == NULL)
+            break;
+        else if (worder != order)
+            warnings[j++] = *w;
+        else
+        {
+            Free(ctx, (void *) w->warning.error);
+            Free(ctx, (void *) w->warning.filename);
+        } // else
+    } // for
 
-static void choose_src_profile(Context *ctx, const char *srcprofile)
+    assert(j == total);
+    Free(ctx, session->warnings);
+    session->warnings = warnings;
+    session->warning_count = total;
+} // replace_session_warnings
+
+static inline int session_line_moves(const SessionEdit *edit,
+                                     const char *filename,
+                                     const unsigned int line)
 {
-    ctx->source_profile = srcprofile;
+    return ((filename != NULL) && (strcmp(filename, edit->file) == 0) &&
+            (line > edit->line));
+} // session_line_moves
+
+// Moves everything after the edited function in its file by (edit->delta)
+//  lines: the IR of the other functions and the statics, the declarations
+//  that codegen() reports errors against, and the warnings we keep. The
+//  other function bodies' ASTs keep their old lines, but nothing looks at
+//  them after their IR is built.
+static void shift_session_lines(Context *ctx,
+                                MOJOSHADER_compileSession *session,
+                                const SessionEdit *edit, const int index)
+{
+    MOJOSHADER_astCompilationUnit *unit;
+    int file = -1;
+    int i, j;
 
-    #define TEST_PROFILE(x) if (strcmp(srcprofile, x) == 0) { return; }
+    if (edit->delta == 0)
+        return;
+
+    for (i = 0; i < ctx->ir_file_count; i++)
+    {
+        if (ctx->ir_files[i] == edit->file)
+            file = i;
+    } // for
+
+    for (i = 0; (file >= 0) && (i <= ctx->user_func_index); i++)
+    {
+        const IrFlat *flat = &ctx->ir[i];
+        if (i == index)
+            continue;  // we just built this one, with the new lines.
+
+        for (j = 0; j < flat->node_count; j++)
+        {
+            if ((flat->files[j] == file) && (flat->lines[j] > edit->line))
+                flat->lines[j] += edit->delta;
+        } // for
+    } // for
+
+    for (unit = &ctx->ast->compunit; unit != NULL; unit = unit->next)
+    {
+        if (session_line_moves(edit, unit->ast.filename, unit->ast.line))
+            unit->ast.line += edit->delta;
+
+        if (unit->ast.type == MOJOSHADER_AST_COMPUNIT_FUNCTION)
+        {
+            MOJOSHADER_astCompilationUnitFunction *fn;
+            MOJOSHADER_astFunctionParameters *param;
+            fn = (MOJOSHADER_astCompilationUnitFunction *) unit;
+            MOJOSHADER_astNodeInfo *info = &fn->declaration->ast;
+            if (session_line_moves(edit, info->filename, info->line))
+                info->line += edit->delta;
+            for (param = fn->declaration->params; param; param = param->next)
+            {
+                info = &param->ast;
+                if (session_line_moves(edit, info->filename, info->line))
+                    info->line += edit->delta;
+            } // for
+        } // if
+
+        else if (unit->ast.type == MOJOSHADER_AST_COMPUNIT_VARIABLE)
+        {
+            MOJOSHADER_astCompilationUnitVariable *var;
+            MOJOSHADER_astVariableDeclaration *decl;
+            var = (MOJOSHADER_astCompilationUnitVariable *) unit;
+            for (decl = var->declaration; decl != NULL; decl = decl->next)
+            {
+                MOJOSHADER_astNodeInfo *info = &decl->ast;
+                if (session_line_moves(edit, info->filename, info->line))
+                    info->line += edit->delta;
+            } // for
+        } // else if
+    } // for
 
-    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_VS_1_1);
-    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_VS_2_0);
-    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_VS_3_0);
-    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_1);
-    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_2);
-    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_3);
-    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_4);
-    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_2_0);
-    TEST_PROFILE(MOJOSHADER_SRC_PROFILE_HLSL_PS_3_0);
+    for (i = 0; i < session->warning_count; i++)
+    {
+        MOJOSHADER_error *w = &session->warnings[i].warning;
+        if ( (w->error_position > 0) &&
+             (session_line_moves(edit, w->filename, w->error_position)) )
+            w->error_position += edit->delta;
+    } // for
+} // shift_session_lines
 
-    #undef TEST_PROFILE
+static void free_codegen_output(Context *ctx)
+{
+    int i;
+    if (ctx->symbols != NULL)
+    {
+        for (i = 0; i < ctx->symbol_count; i++)
+        {
+            Free(ctx, (void *) ctx->symbols[i].name);
+            free_symbol_members(ctx->free, ctx->malloc_data, &ctx->symbols[i].info);
+        } // for
+        Free(ctx, ctx->symbols);
+    } // if
+    Free(ctx, ctx->output);
+    Free(ctx, ctx->bytecode);
+    ctx->symbols = NULL;
+    ctx->symbol_count = 0;
+    ctx->output = NULL;
+    ctx->output_len = 0;
+    ctx->bytecode = NULL;
+    ctx->bytecode_len = 0;
+} // free_codegen_output
+
+// Generates code for the session's state again, and reports it along with
+//  the warnings from everything that came before.
+static const MOJOSHADER_compileData *session_codegen(MOJOSHADER_compileSession *session)
+{
+    const MOJOSHADER_compileData *retval = NULL;
+    Context *ctx = session->ctx;
+    int i;
 
-    fail(ctx, "Unknown profile");
-} // choose_src_profile
+    discard_messages(ctx, ctx->errors);
+    discard_messages(ctx, ctx->warnings);
+    free_codegen_output(ctx);  // if codegen() failed last time.
+    ctx->isfail = ctx->out_of_memory;
 
+    for (i = 0; i < session->warning_count; i++)
+    {
+        const MOJOSHADER_error *w = &session->warnings[i].warning;
+        if (!errorlist_add(ctx->warnings, w->filename, w->error_position, w->error))
+            out_of_memory(ctx);
+    } // for
 
-static MOJOSHADER_compileData MOJOSHADER_out_of_mem_compile_data = {
-    1, &MOJOSHADER_out_of_mem_error, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
+    if (!isfail(ctx))
+        codegen(ctx);
 
+    if (isfail(ctx))
+        retval = build_failed_compile(ctx);
+    else
+        retval = build_compiledata(ctx);
 
-// !!! FIXME: cut and paste from assembler.
-static const MOJOSHADER_compileData *build_failed_compile(Context *ctx)
+    if (ctx->out_of_memory)
+        drop_session_state(session);
+    return retval;
+} // session_codegen
+
+// Compiles (source) from scratch. If that gets through IR, it's the
+//  session's new state; otherwise we keep the old one to compare with.
+static const MOJOSHADER_compileData *compile_session_full(
+                                    MOJOSHADER_compileSession *session,
+                                    const char *source,
+                                    const unsigned int sourcelen)
 {
-    assert(isfail(ctx));
+    const MOJOSHADER_compileData *retval = NULL;
+    SessionWarning *warnings = NULL;
+    SessionUnit *units = NULL;
+    IrFlatBuilder builder;
+    AnalysisBatch batch;
+    TokenSource src;
+    int *ir_before = NULL;  // warnings before each function's IR.
+    int analysis_warnings = 0;
+    int unit_count = 0;
+    int count = 0;
+    uint64 key = 0;
+    int i;
 
-    MOJOSHADER_compileData *retval = NULL;
-    retval = (MOJOSHADER_compileData *) Malloc(ctx, sizeof (MOJOSHADER_compileData));
-    if (retval == NULL)
+    Context *ctx = build_context(session->malloc, session->free,
+                                 session->malloc_data);
+    if (ctx == NULL)
         return &MOJOSHADER_out_of_mem_compile_data;
 
-    memset(retval, '\0', sizeof (MOJOSHADER_compileData));
-    retval->malloc = (ctx->malloc == MOJOSHADER_internal_malloc) ? NULL : ctx->malloc;
-    retval->free = (ctx->free == MOJOSHADER_internal_free) ? NULL : ctx->free;
-    retval->malloc_data = ctx->malloc_data;
-    retval->source_profile = ctx->source_profile;
-    retval->error_count = errorlist_count(ctx->errors);
-    retval->errors = errorlist_flatten(ctx->errors);
-    retval->warning_count = errorlist_count(ctx->warnings);
-    retval->warnings = errorlist_flatten(ctx->warnings);
+    memset(&batch, '\0', sizeof (batch));
+    memset(&builder, '\0', sizeof (builder));
+    memset(&src, '\0', sizeof (src));
 
-    if (ctx->out_of_memory)  // in case something failed up there.
+    choose_src_profile(ctx, session->srcprofile);
+    if (!isfail(ctx))
     {
-        MOJOSHADER_freeCompileData(retval);
-        return &MOJOSHADER_out_of_mem_compile_data;
+        src.tape = record_source(ctx, session->filename, source, sourcelen,
+                                 session->defines, session->define_count,
+                                 session->include_open, session->include_close,
+                                 session->include_cache, &src.tapelen, &key);
+        if (src.tape != NULL)
+            parse_tokens(ctx, &src);
     } // if
 
-    return retval;
-} // build_failed_compile
+    if (!isfail(ctx))
+    {
+        check_globals(ctx, &batch);
+        check_function_bodies(ctx, &batch);
+        analysis_warnings = errorlist_count(ctx->warnings);
+    } // if
+
+    // this is intermediate_representation(), but it notes which function
+    //  each warning came from.
+    if ((!isfail(ctx)) && (start_ir(ctx)))
+    {
+        ir_before = (int *) Malloc(ctx, sizeof (int) * (batch.job_count + 1));
+        if (ir_before != NULL)
+        {
+            for (i = 0; i < batch.job_count; i++)
+            {
+                ir_before[i] = errorlist_count(ctx->warnings);
+                function_ir(ctx, &builder, batch.jobs[i].ast);
+            } // for
+            ir_before[batch.job_count] = errorlist_count(ctx->warnings);
+            statics_ir(ctx, &builder);
+        } // if
+        free_flat_ir_builder(ctx, &builder);
+    } // if
 
+    if (!isfail(ctx))
+    {
+        count = errorlist_count(ctx->warnings);
+        MOJOSHADER_error *msgs = errorlist_flatten(ctx->warnings);
+        if (count > 0)
+        {
+            warnings = (SessionWarning *) Malloc(ctx, sizeof (SessionWarning) * count);
+            if (msgs == NULL)
+                out_of_memory(ctx);
+        } // if
 
-static const MOJOSHADER_compileData *build_compiledata(Context *ctx)
-{
-    assert(!isfail(ctx));
+        if ((warnings != NULL) && (msgs != NULL))
+        {
+            // see merge_analysis_messages() for where the bodies' went.
+            int pos = 0;
+            int bodies = 0;
+            int job;
+            for (job = 0; pos < analysis_warnings; job++)
+            {
+                int upto = analysis_warnings;
+                if (job < batch.job_count)
+                    upto = batch.jobs[job].warnings_before + bodies;
+                for (; pos < upto; pos++)
+                {
+                    warnings[pos].job = job;
+                    warnings[pos].kind = SESSION_WARNING_GLOBAL;
+                } // for
 
-    MOJOSHADER_compileData *retval = NULL;
+                if (job == batch.job_count)
+                    break;
 
-    retval = (MOJOSHADER_compileData *) Malloc(ctx, sizeof (MOJOSHADER_compileData));
-    if (retval == NULL)
-        return &MOJOSHADER_out_of_mem_compile_data;
+                upto = pos + batch.jobs[job].warning_count;
+                bodies += batch.jobs[job].warning_count;
+                for (; pos < upto; pos++)
+                {
+                    warnings[pos].job = job;
+                    warnings[pos].kind = SESSION_WARNING_BODY;
+                } // for
+            } // for
 
-    memset(retval, '\0', sizeof (MOJOSHADER_compileData));
-    retval->malloc = (ctx->malloc == MOJOSHADER_internal_malloc) ? NULL : ctx->malloc;
-    retval->free = (ctx->free == MOJOSHADER_internal_free) ? NULL : ctx->free;
-    retval->malloc_data = ctx->malloc_data;
-    retval->source_profile = ctx->source_profile;
+            for (job = 0; pos < count; pos++)
+            {
+                while ((job < batch.job_count) && (pos >= ir_before[job + 1]))
+                    job++;
+                warnings[pos].job = job;
+                warnings[pos].kind = SESSION_WARNING_IR;
+            } // for
 
-    if (!isfail(ctx))
-    {
-        // !!! FIXME: build output and output_len here.
+            for (pos = 0; pos < count; pos++)
+                warnings[pos].warning = msgs[pos];
+        } // if
+
+        else if (msgs != NULL)
+        {
+            for (i = 0; i < count; i++)
+            {
+                Free(ctx, (void *) msgs[i].error);
+                Free(ctx, (void *) msgs[i].filename);
+            } // for
+        } // else if
+
+        Free(ctx, msgs);
     } // if
 
     if (!isfail(ctx))
     {
-        // !!! FIXME: build symbols and symbol_count here.
+        units = split_session_units(ctx, src.tape, src.tapelen,
+                                    batch.job_count, &unit_count);
     } // if
 
-    retval->error_count = errorlist_count(ctx->errors);
-    retval->errors = errorlist_flatten(ctx->errors);
-    retval->warning_count = errorlist_count(ctx->warnings);
-    retval->warnings = errorlist_flatten(ctx->warnings);
+    Free(ctx, ir_before);
 
-    if (ctx->out_of_memory)  // in case something failed up there.
+    if (isfail(ctx))
     {
-        MOJOSHADER_freeCompileData(retval);
-        return &MOJOSHADER_out_of_mem_compile_data;
+        retval = build_failed_compile(ctx);
+        if (warnings != NULL)
+            free_session_warnings(session, warnings, count);
+        Free(ctx, units);
+        Free(ctx, batch.jobs);
+        Free(ctx, (void *) src.tape);
+        destroy_context(ctx);
+        return retval;
     } // if
 
-    return retval;
-} // build_compiledata
+    drop_session_state(session);
+    session->ctx = ctx;
+    session->tape = (char *) src.tape;
+    session->tapelen = src.tapelen;
+    session->units = units;
+    session->unit_count = unit_count;
+    session->jobs = batch.jobs;
+    session->job_count = batch.job_count;
+    session->warnings = warnings;
+    session->warning_count = count;
+    return session_codegen(session);
+} // compile_session_full
+
+// Recompiles just the function that changed, if that's all that did.
+//  Returns NULL if (source) needs a full compile instead.
+static const MOJOSHADER_compileData *compile_session_edit(
+                                    MOJOSHADER_compileSession *session,
+                                    const char *source,
+                                    const unsigned int sourcelen)
+{
+    const MOJOSHADER_compileData *retval = NULL;
+    Context *ctx = session->ctx;
+    SessionUnit *units = NULL;
+    MOJOSHADER_error *msgs = NULL;
+    SessionEdit edit;
+    size_t tapelen = 0;
+    uint64 key = 0;
+    int unit_count = 0;
+    int rc = -1;
+    int count;
+
+    char *tape = record_source(ctx, session->filename, source, sourcelen,
+                               session->defines, session->define_count,
+                               session->include_open, session->include_close,
+                               session->include_cache, &tapelen, &key);
+    if (tape != NULL)
+        units = split_session_units(ctx, tape, tapelen, session->job_count, &unit_count);
+    if (units != NULL)
+        rc = find_session_edit(session, tape, tapelen, units, unit_count, &edit);
+
+    if (rc <= 0)
+    {
+        Free(ctx, units);
+        Free(ctx, tape);
+        if (ctx->out_of_memory)
+            drop_session_state(session);
+        else if (rc == 0)
+        {
+            session->incremental_count++;
+            return session_codegen(session);
+        } // else if
+        return NULL;
+    } // if
 
+    AnalysisJob *job = &session->jobs[edit.job];
+    MOJOSHADER_astCompilationUnitFunction *fn = job->ast;
+    MOJOSHADER_astCompilationUnitFunction *parsed;
+    parsed = reparse_function(ctx, tape, tapelen, &units[edit.unit],
+                              units[unit_count - 1].end, job);
+    if (parsed == NULL)
+    {
+        Free(ctx, units);
+        Free(ctx, tape);
+        if (ctx->out_of_memory)
+            drop_session_state(session);
+        return NULL;
+    } // if
 
-// API entry point...
+    // check the new body like check_function_bodies() did the old one,
+    //  with the same globals in view.
+    MOJOSHADER_astStatement *olddef = fn->definition;
+    AnalysisBatch batch;
+    AnalysisJob newjob;
+    memset(&batch, '\0', sizeof (batch));
+    memset(&newjob, '\0', sizeof (newjob));
+    newjob.ast = fn;
+    newjob.visible_serial = job->visible_serial;
+    batch.jobs = &newjob;
+    batch.job_count = 1;
+    fn->definition = parsed->definition;
+    check_function_bodies(ctx, &batch);
+
+    // Report errors in the new body the way a full compile would, and keep
+    //  the old body around to compare the next version with.
+    if ((isfail(ctx)) && (!ctx->out_of_memory))
+    {
+        const int order = session_warning_order(session, edit.job, SESSION_WARNING_BODY);
+        int i;
 
-// !!! FIXME: move this (and a lot of other things) to mojoshader_ast.c.
-const MOJOSHADER_astData *MOJOSHADER_parseAst(const char *srcprofile,
-                                    const char *filename, const char *source,
-                                    unsigned int sourcelen,
-                                    const MOJOSHADER_preprocessorDefine *defs,
-                                    unsigned int define_count,
-                                    MOJOSHADER_includeOpen include_open,
-                                    MOJOSHADER_includeClose include_close,
-                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
-                                    void *d)
-{
-    const MOJOSHADER_astData *retval = NULL;
-    Context *ctx = NULL;
+        count = errorlist_count(ctx->warnings);
+        msgs = errorlist_flatten(ctx->warnings);
+        for (i = 0; i <= session->warning_count; i++)
+        {
+            const SessionWarning *w = NULL;
+            int worder = order + 1;
+            if (i < session->warning_count)
+            {
+                w = &session->warnings[i];
+                worder = session_warning_order(session, w->job, w->kind);
+            } // if
 
-    if ( ((m == NULL) && (f != NULL)) || ((m != NULL) && (f == NULL)) )
-        return &MOJOSHADER_out_of_mem_ast_data;  // supply both or neither.
+            if ((msgs != NULL) && (worder > order))
+            {
+                int j;
+                for (j = 0; j < count; j++)
+                {
+                    const MOJOSHADER_error *e = &msgs[j];
+                    errorlist_add(ctx->warnings, e->filename, e->error_position, e->error);
+                    Free(ctx, (void *) e->error);
+                    Free(ctx, (void *) e->filename);
+                } // for
+                Free(ctx, msgs);
+                msgs = NULL;
+            } // if
 
-    ctx = build_context(m, f, d);
-    if (ctx == NULL)
-        return &MOJOSHADER_out_of_mem_ast_data;
+            if ((w == NULL) || (w->kind == SESSION_WARNING_IR))
+                break;  // no IR if semantic analysis fails.
+            else if (worder != order)
+            {
+                int line = w->warning.error_position;
+                if ((line > 0) && (session_line_moves(&edit, w->warning.filename, line)))
+                    line += edit.delta;
+                errorlist_add(ctx->warnings, w->warning.filename, line, w->warning.error);
+            } // else if
+        } // for
 
-    choose_src_profile(ctx, srcprofile);
+        retval = build_failed_compile(ctx);
+        fn->definition = olddef;
+        ctx->isfail = ctx->out_of_memory;
+        Free(ctx, units);
+        Free(ctx, tape);
+        session->incremental_count++;
+        if (ctx->out_of_memory)
+            drop_session_state(session);
+        return retval;
+    } // if
 
+    // build the new IR where the old one was.
+    const int index = fn->index;
+    const IrFlat oldflat = ctx->ir[index];
+    const IrFunction oldfunc = ctx->ir_funcs[index];
+    const int analysis_warnings = errorlist_count(ctx->warnings);
+    IrFlatBuilder builder;
+    memset(&builder, '\0', sizeof (builder));
+    memset(&ctx->ir[index], '\0', sizeof (IrFlat));
     if (!isfail(ctx))
+        function_ir(ctx, &builder, fn);
+    free_flat_ir_builder(ctx, &builder);
+
+    if (isfail(ctx))
     {
-        parse_source(ctx, filename, source, sourcelen, defs, define_count,
-                     include_open, include_close);
+        // the full compile reports these in the right order.
+        Free(ctx, ctx->ir[index].first);
+        ctx->ir[index] = oldflat;
+        ctx->ir_funcs[index] = oldfunc;
+        fn->definition = olddef;
+        discard_messages(ctx, ctx->errors);
+        discard_messages(ctx, ctx->warnings);
+        ctx->isfail = ctx->out_of_memory;
+        Free(ctx, units);
+        Free(ctx, tape);
+        if (ctx->out_of_memory)
+            drop_session_state(session);
+        return NULL;
     } // if
 
-    if (!isfail(ctx))
-        retval = build_astdata(ctx);  // ctx isn't destroyed yet!
+    Free(ctx, oldflat.first);
+    shift_session_lines(ctx, session, &edit, index);
+
+    count = errorlist_count(ctx->warnings);
+    msgs = errorlist_flatten(ctx->warnings);
+    if ((count > 0) && (msgs == NULL))
+        out_of_memory(ctx);
     else
     {
-        retval = (MOJOSHADER_astData *) build_failed_ast(ctx);
-        destroy_context(ctx);
+        replace_session_warnings(ctx, session, edit.job, SESSION_WARNING_BODY,
+                                 msgs, analysis_warnings);
+        replace_session_warnings(ctx, session, edit.job, SESSION_WARNING_IR,
+                                 msgs + analysis_warnings,
+                                 count - analysis_warnings);
+        Free(ctx, msgs);
     } // else
 
-    return retval;
-} // MOJOSHADER_parseAst
+    Free(ctx, session->units);
+    Free(ctx, session->tape);
+    session->units = units;
+    session->unit_count = unit_count;
+    session->tape = tape;
+    session->tapelen = tapelen;
+    session->incremental_count++;
+
+    if (ctx->out_of_memory)
+    {
+        drop_session_state(session);
+        return NULL;
+    } // if
 
+    return session_codegen(session);
+} // compile_session_edit
 
-void MOJOSHADER_freeAstData(const MOJOSHADER_astData *_data)
+static char *session_strdup(MOJOSHADER_compileSession *session,
+                            const char *str, int *_okay)
 {
-    MOJOSHADER_astData *data = (MOJOSHADER_astData *) _data;
-    if ((data == NULL) || (data == &MOJOSHADER_out_of_mem_ast_data))
-        return;  // no-op.
+    char *retval = NULL;
+    if ((*_okay) && (str != NULL))
+    {
+        retval = (char *) session->malloc(strlen(str) + 1, session->malloc_data);
+        if (retval == NULL)
+            *_okay = 0;
+        else
+            strcpy(retval, str);
+    } // if
+    return retval;
+} // session_strdup
+
+MOJOSHADER_compileSession *MOJOSHADER_createCompileSession(
+                             const char *srcprofile, const char *filename,
+                             const MOJOSHADER_preprocessorDefine *defs,
+                             unsigned int define_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    MOJOSHADER_compileSession *session = NULL;
+    int okay = 1;
+    unsigned int i;
 
-    // !!! FIXME: this needs to live for deleting the stringcache and the ast.
-    Context *ctx = (Context *) data->opaque;
-    MOJOSHADER_free f = (data->free == NULL) ? MOJOSHADER_internal_free : data->free;
-    void *d = data->malloc_data;
-    int i;
+    if ( ((m == NULL) && (f != NULL)) || ((m != NULL) && (f == NULL)) )
+        return NULL;  // supply both or neither.
 
-    // we don't f(data->source_profile), because that's internal static data.
+    if (!m) m = MOJOSHADER_internal_malloc;
+    if (!f) f = MOJOSHADER_internal_free;
 
-    for (i = 0; i < data->error_count; i++)
+    session = (MOJOSHADER_compileSession *) m(sizeof (*session), d);
+    if (session == NULL)
+        return NULL;
+
+    memset(session, '\0', sizeof (*session));
+    session->srcprofile = srcprofile;
+    session->include_open = include_open;
+    session->include_close = include_close;
+    session->malloc = m;
+    session->free = f;
+    session->malloc_data = d;
+
+    session->filename = session_strdup(session, filename, &okay);
+    if ((okay) && (define_count > 0))
     {
-        f((void *) data->errors[i].error, d);
-        f((void *) data->errors[i].filename, d);
-    } // for
-    f((void *) data->errors, d);
+        const size_t len = sizeof (MOJOSHADER_preprocessorDefine) * define_count;
+        session->defines = (MOJOSHADER_preprocessorDefine *) m(len, d);
+        okay = (session->defines != NULL);
+        if (okay)
+        {
+            memset(session->defines, '\0', len);
+            session->define_count = define_count;
+        } // if
 
-    // don't delete data->ast (it'll delete with the context).
-    f(data, d);
+        for (i = 0; (okay) && (i < define_count); i++)
+        {
+            MOJOSHADER_preprocessorDefine *def = &session->defines[i];
+            def->identifier = session_strdup(session, defs[i].identifier, &okay);
+            def->definition = session_strdup(session, defs[i].definition, &okay);
+        } // for
+    } // if
 
-    destroy_context(ctx);  // finally safe to destroy this.
-} // MOJOSHADER_freeAstData
+    // headers are only read once per session, like MOJOSHADER_compileBatch().
+    if ((okay) && ((include_open == NULL) == (include_close == NULL)))
+    {
+        session->include_cache = MOJOSHADER_createIncludeCache(include_open,
+                                                              include_close,
+                                                              m, f, d);
+        session->include_open = NULL;
+        session->include_close = NULL;
+        okay = (session->include_cache != NULL);
+    } // if
 
+    if (!okay)
+    {
+        MOJOSHADER_destroyCompileSession(session);
+        return NULL;
+    } // if
 
-const MOJOSHADER_compileData *MOJOSHADER_compile(const char *srcprofile,
-                                    const char *filename, const char *source,
-                                    unsigned int sourcelen,
-                                    const MOJOSHADER_preprocessorDefine *defs,
-                                    unsigned int define_count,
-                                    MOJOSHADER_includeOpen include_open,
-                                    MOJOSHADER_includeClose include_close,
-                                    MOJOSHADER_malloc m, MOJOSHADER_free f,
-                                    void *d)
-{
-    // !!! FIXME: cut and paste from MOJOSHADER_parseAst().
-    MOJOSHADER_compileData *retval = NULL;
-    Context *ctx = NULL;
+    return session;
+} // MOJOSHADER_createCompileSession
 
-    if ( ((m == NULL) && (f != NULL)) || ((m != NULL) && (f == NULL)) )
-        return &MOJOSHADER_out_of_mem_compile_data;  // supply both or neither.
+const MOJOSHADER_compileData *MOJOSHADER_compileWithSession(
+                                    MOJOSHADER_compileSession *session,
+                                    const char *source, unsigned int sourcelen)
+{
+    const MOJOSHADER_compileData *retval = NULL;
 
-    ctx = build_context(m, f, d);
-    if (ctx == NULL)
+    if (session == NULL)
         return &MOJOSHADER_out_of_mem_compile_data;
 
-    choose_src_profile(ctx, srcprofile);
+    if ( (session->ctx != NULL) && (session->units != NULL) &&
+         (session->incremental_count < SESSION_MAX_INCREMENTAL) )
+        retval = compile_session_edit(session, source, sourcelen);
 
-    if (!isfail(ctx))
-    {
-        parse_source(ctx, filename, source, sourcelen, defs, define_count,
-                     include_open, include_close);
-    } // if
+    if (retval == NULL)
+        retval = compile_session_full(session, source, sourcelen);
 
-    if (!isfail(ctx))
-        semantic_analysis(ctx);
+    return retval;
+} // MOJOSHADER_compileWithSession
 
-    if (!isfail(ctx))
-        intermediate_representation(ctx);
+void MOJOSHADER_destroyCompileSession(MOJOSHADER_compileSession *session)
+{
+    if (session == NULL)
+        return;
 
-    if (isfail(ctx))
-        retval = (MOJOSHADER_compileData *) build_failed_compile(ctx);
-    else
-        retval = (MOJOSHADER_compileData *) build_compiledata(ctx);
+    MOJOSHADER_free f = session->free;
+    void *d = session->malloc_data;
+    unsigned int i;
 
-    destroy_context(ctx);
-    return retval;
-} // MOJOSHADER_compile
+    drop_session_state(session);
+    MOJOSHADER_destroyIncludeCache(session->include_cache);
+
+    for (i = 0; i < session->define_count; i++)
+    {
+        f((void *) session->defines[i].identifier, d);
+        f((void *) session->defines[i].definition, d);
+    } // for
+    f(session->defines, d);
+    f(session->filename, d);
+    f(session, d);
+} // MOJOSHADER_destroyCompileSession
 
 
 void MOJOSHADER_freeCompileData(const MOJOSHADER_compileData *_data)
@@ -6285,11 +22038,13 @@ void MOJOSHADER_freeCompileData(const MOJOSHADER_compileData *_data)
     for (i = 0; i < data->symbol_count; i++)
     {
         f((void *) data->symbols[i].name, d);
-        // !!! FIXME: this is missing stuff (including freeing substructs).
+        free_symbol_members(f, d, &data->symbols[i].info);
     } // for
     f((void *) data->symbols, d);
 
     f((void *) data->output, d);
+    f((void *) data->bytecode, d);
+    f((void *) data->ir_passes, d);
     f(data, d);
 } // MOJOSHADER_freeCompileData
 
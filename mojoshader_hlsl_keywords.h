@@ -0,0 +1,276 @@
+// This file was generated by misc/hlsl_keywords.pl. Don't edit it by hand;
+//  change the word lists in that script and run it again.
+
+#define HLSL_KEYWORD_MINLEN 2
+#define HLSL_KEYWORD_MAXLEN 25
+#define HLSL_KEYWORD_BUCKETS 64
+#define HLSL_KEYWORD_SLOTS 256
+
+static const uint8 hlsl_keyword_displace[HLSL_KEYWORD_BUCKETS] = {
+    3, 7, 1, 0, 1, 0, 9, 0, 0, 10, 0, 6, 12, 5, 1, 4,
+    0, 5, 0, 11, 1, 4, 15, 2, 1, 2, 0, 3, 3, 21, 0, 1,
+    3, 14, 2, 2, 1, 1, 13, 7, 0, 0, 13, 6, 12, 27, 2, 19,
+    7, 3, 19, 7, 13, 10, 14, 2, 14, 3, 31, 31, 16, 35, 15, 20,
+};
+
+static const HlslKeyword hlsl_keyword_slots[HLSL_KEYWORD_SLOTS] = {
+    { "flatten", 7, TOKEN_HLSL_FLATTEN },
+    { "int2x4", 6, TOKEN_HLSL_USERTYPE },
+    { "return", 6, TOKEN_HLSL_RETURN },
+    { NULL, 0, 0 },
+    { "half1x3", 7, TOKEN_HLSL_USERTYPE },
+    { "half1x2", 7, TOKEN_HLSL_USERTYPE },
+    { "uint2x1", 7, TOKEN_HLSL_USERTYPE },
+    { "false", 5, TOKEN_HLSL_FALSE },
+    { "linear", 6, TOKEN_HLSL_LINEAR },
+    { "double2", 7, TOKEN_HLSL_USERTYPE },
+    { "noExpressionOptimizations", 25, TOKEN_HLSL_NOEXPRESSIONOPTIMIZATIONS },
+    { "half1x4", 7, TOKEN_HLSL_USERTYPE },
+    { "half3x2", 7, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "half3x4", 7, TOKEN_HLSL_USERTYPE },
+    { "SamplerComparisonState", 22, TOKEN_HLSL_SAMPLERCOMPARISONSTATE },
+    { "half1x1", 7, TOKEN_HLSL_USERTYPE },
+    { "int2x2", 6, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "sampler1D", 9, TOKEN_HLSL_SAMPLER1D },
+    { NULL, 0, 0 },
+    { "double4", 7, TOKEN_HLSL_USERTYPE },
+    { "double3", 7, TOKEN_HLSL_USERTYPE },
+    { "half3x3", 7, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "nointerpolation", 15, TOKEN_HLSL_NOINTERPOLATION },
+    { "out", 3, TOKEN_HLSL_OUT },
+    { NULL, 0, 0 },
+    { "do", 2, TOKEN_HLSL_DO },
+    { "half3x1", 7, TOKEN_HLSL_USERTYPE },
+    { "typedef", 7, TOKEN_HLSL_TYPEDEF },
+    { "float3", 6, TOKEN_HLSL_USERTYPE },
+    { "float4", 6, TOKEN_HLSL_USERTYPE },
+    { "float1", 6, TOKEN_HLSL_USERTYPE },
+    { "float2", 6, TOKEN_HLSL_USERTYPE },
+    { "maxInstructionCount", 19, TOKEN_HLSL_MAXINSTRUCTIONCOUNT },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "double1", 7, TOKEN_HLSL_USERTYPE },
+    { "case", 4, TOKEN_HLSL_CASE },
+    { NULL, 0, 0 },
+    { "sampler", 7, TOKEN_HLSL_SAMPLER },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "bool4x1", 7, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "bool4x3", 7, TOKEN_HLSL_USERTYPE },
+    { "in", 2, TOKEN_HLSL_IN },
+    { "float1x4", 8, TOKEN_HLSL_USERTYPE },
+    { "isolate", 7, TOKEN_HLSL_ISOLATE },
+    { "default", 7, TOKEN_HLSL_DEFAULT },
+    { "bool4x2", 7, TOKEN_HLSL_USERTYPE },
+    { "bool4x4", 7, TOKEN_HLSL_USERTYPE },
+    { "float1x3", 8, TOKEN_HLSL_USERTYPE },
+    { "noperspective", 13, TOKEN_HLSL_NOPERSPECTIVE },
+    { "float1x1", 8, TOKEN_HLSL_USERTYPE },
+    { "if", 2, TOKEN_HLSL_IF },
+    { "uniform", 7, TOKEN_HLSL_UNIFORM },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "unorm", 5, TOKEN_HLSL_UNORM },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "packoffset", 10, TOKEN_HLSL_PACKOFFSET },
+    { NULL, 0, 0 },
+    { "inout", 5, TOKEN_HLSL_INOUT },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "const", 5, TOKEN_HLSL_CONST },
+    { NULL, 0, 0 },
+    { "float2x1", 8, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "float2x4", 8, TOKEN_HLSL_USERTYPE },
+    { "bool3x1", 7, TOKEN_HLSL_USERTYPE },
+    { "bool3x3", 7, TOKEN_HLSL_USERTYPE },
+    { "half2", 5, TOKEN_HLSL_USERTYPE },
+    { "float1x2", 8, TOKEN_HLSL_USERTYPE },
+    { "half1", 5, TOKEN_HLSL_USERTYPE },
+    { "uint1x2", 7, TOKEN_HLSL_USERTYPE },
+    { "uint1x4", 7, TOKEN_HLSL_USERTYPE },
+    { "half4", 5, TOKEN_HLSL_USERTYPE },
+    { "uint1x3", 7, TOKEN_HLSL_USERTYPE },
+    { "float2x3", 8, TOKEN_HLSL_USERTYPE },
+    { "half3", 5, TOKEN_HLSL_USERTYPE },
+    { "uint1x1", 7, TOKEN_HLSL_USERTYPE },
+    { "bool3x2", 7, TOKEN_HLSL_USERTYPE },
+    { "bool3x4", 7, TOKEN_HLSL_USERTYPE },
+    { "double2x2", 9, TOKEN_HLSL_USERTYPE },
+    { "double2x4", 9, TOKEN_HLSL_USERTYPE },
+    { "double2x3", 9, TOKEN_HLSL_USERTYPE },
+    { "float2x2", 8, TOKEN_HLSL_USERTYPE },
+    { "snorm", 5, TOKEN_HLSL_SNORM },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "register", 8, TOKEN_HLSL_REGISTER },
+    { "double4x2", 9, TOKEN_HLSL_USERTYPE },
+    { "double2x1", 9, TOKEN_HLSL_USERTYPE },
+    { "double4x1", 9, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "double4x4", 9, TOKEN_HLSL_USERTYPE },
+    { "break", 5, TOKEN_HLSL_BREAK },
+    { "continue", 8, TOKEN_HLSL_CONTINUE },
+    { "double4x3", 9, TOKEN_HLSL_USERTYPE },
+    { "half2x2", 7, TOKEN_HLSL_USERTYPE },
+    { "half2x4", 7, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "half2x1", 7, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "half2x3", 7, TOKEN_HLSL_USERTYPE },
+    { "sampler_state", 13, TOKEN_HLSL_SAMPLER_STATE },
+    { "int4x4", 6, TOKEN_HLSL_USERTYPE },
+    { "buffer", 6, TOKEN_HLSL_BUFFER },
+    { "int4x1", 6, TOKEN_HLSL_USERTYPE },
+    { "int4x2", 6, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "int4x3", 6, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "branch", 6, TOKEN_HLSL_BRANCH },
+    { "uint3x2", 7, TOKEN_HLSL_USERTYPE },
+    { "extern", 6, TOKEN_HLSL_EXTERN },
+    { "vector", 6, TOKEN_HLSL_VECTOR },
+    { "uint3x3", 7, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "discard", 7, TOKEN_HLSL_DISCARD },
+    { NULL, 0, 0 },
+    { "uint3x1", 7, TOKEN_HLSL_USERTYPE },
+    { "xps", 3, TOKEN_HLSL_XPS },
+    { NULL, 0, 0 },
+    { "int4", 4, TOKEN_HLSL_USERTYPE },
+    { "int2", 4, TOKEN_HLSL_USERTYPE },
+    { "int3", 4, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "int3x3", 6, TOKEN_HLSL_USERTYPE },
+    { "int3x1", 6, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "samplerCUBE", 11, TOKEN_HLSL_SAMPLERCUBE },
+    { "unroll", 6, TOKEN_HLSL_UNROLL },
+    { "float4x1", 8, TOKEN_HLSL_USERTYPE },
+    { "int3x4", 6, TOKEN_HLSL_USERTYPE },
+    { "uint2", 5, TOKEN_HLSL_USERTYPE },
+    { "int1x3", 6, TOKEN_HLSL_USERTYPE },
+    { "int1x2", 6, TOKEN_HLSL_USERTYPE },
+    { "int1x4", 6, TOKEN_HLSL_USERTYPE },
+    { "uint4", 5, TOKEN_HLSL_USERTYPE },
+    { "uint4x3", 7, TOKEN_HLSL_USERTYPE },
+    { "uint4x2", 7, TOKEN_HLSL_USERTYPE },
+    { "uint1", 5, TOKEN_HLSL_USERTYPE },
+    { "float4x2", 8, TOKEN_HLSL_USERTYPE },
+    { "uint", 4, TOKEN_HLSL_UINT },
+    { "uint3x4", 7, TOKEN_HLSL_USERTYPE },
+    { "uint4x4", 7, TOKEN_HLSL_USERTYPE },
+    { "float4x3", 8, TOKEN_HLSL_USERTYPE },
+    { "int1x1", 6, TOKEN_HLSL_USERTYPE },
+    { "int3x2", 6, TOKEN_HLSL_USERTYPE },
+    { "uint3", 5, TOKEN_HLSL_USERTYPE },
+    { "uint4x1", 7, TOKEN_HLSL_USERTYPE },
+    { "float4x4", 8, TOKEN_HLSL_USERTYPE },
+    { "static", 6, TOKEN_HLSL_STATIC },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "true", 4, TOKEN_HLSL_TRUE },
+    { "forcecase", 9, TOKEN_HLSL_FORCECASE },
+    { "int1", 4, TOKEN_HLSL_USERTYPE },
+    { "void", 4, TOKEN_HLSL_VOID },
+    { "bool", 4, TOKEN_HLSL_BOOL },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "float3x3", 8, TOKEN_HLSL_USERTYPE },
+    { "float3x4", 8, TOKEN_HLSL_USERTYPE },
+    { "half4x2", 7, TOKEN_HLSL_USERTYPE },
+    { "half4x4", 7, TOKEN_HLSL_USERTYPE },
+    { "half", 4, TOKEN_HLSL_HALF },
+    { "half4x3", 7, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "SamplerState", 12, TOKEN_HLSL_SAMPLERSTATE },
+    { "half4x1", 7, TOKEN_HLSL_USERTYPE },
+    { "float", 5, TOKEN_HLSL_FLOAT },
+    { "struct", 6, TOKEN_HLSL_STRUCT },
+    { "else", 4, TOKEN_HLSL_ELSE },
+    { "while", 5, TOKEN_HLSL_WHILE },
+    { "float3x2", 8, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "double1x1", 9, TOKEN_HLSL_USERTYPE },
+    { "double1x4", 9, TOKEN_HLSL_USERTYPE },
+    { "matrix", 6, TOKEN_HLSL_MATRIX },
+    { "string", 6, TOKEN_HLSL_STRING },
+    { "double1x2", 9, TOKEN_HLSL_USERTYPE },
+    { "row_major", 9, TOKEN_HLSL_ROWMAJOR },
+    { "unused", 6, TOKEN_HLSL_UNUSED },
+    { "double3x1", 9, TOKEN_HLSL_USERTYPE },
+    { "bool1x2", 7, TOKEN_HLSL_USERTYPE },
+    { "bool1x3", 7, TOKEN_HLSL_USERTYPE },
+    { "float3x1", 8, TOKEN_HLSL_USERTYPE },
+    { "bool1x4", 7, TOKEN_HLSL_USERTYPE },
+    { "inline", 6, TOKEN_HLSL_INLINE },
+    { "double3x2", 9, TOKEN_HLSL_USERTYPE },
+    { "double1x3", 9, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "centroid", 8, TOKEN_HLSL_CENTROID },
+    { NULL, 0, 0 },
+    { NULL, 0, 0 },
+    { "double3x3", 9, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "switch", 6, TOKEN_HLSL_SWITCH },
+    { NULL, 0, 0 },
+    { "column_major", 12, TOKEN_HLSL_COLUMNMAJOR },
+    { "bool3", 5, TOKEN_HLSL_USERTYPE },
+    { "bool1", 5, TOKEN_HLSL_USERTYPE },
+    { "bool1x1", 7, TOKEN_HLSL_USERTYPE },
+    { "int", 3, TOKEN_HLSL_INT },
+    { "sample", 6, TOKEN_HLSL_SAMPLE },
+    { "double", 6, TOKEN_HLSL_DOUBLE },
+    { "bool4", 5, TOKEN_HLSL_USERTYPE },
+    { "bool2x1", 7, TOKEN_HLSL_USERTYPE },
+    { "bool2x3", 7, TOKEN_HLSL_USERTYPE },
+    { "bool2x2", 7, TOKEN_HLSL_USERTYPE },
+    { "sampler3D", 9, TOKEN_HLSL_SAMPLER3D },
+    { "call", 4, TOKEN_HLSL_CALL },
+    { "bool2x4", 7, TOKEN_HLSL_USERTYPE },
+    { "for", 3, TOKEN_HLSL_FOR },
+    { "sampler2D", 9, TOKEN_HLSL_SAMPLER2D },
+    { "loop", 4, TOKEN_HLSL_LOOP },
+    { "double3x4", 9, TOKEN_HLSL_USERTYPE },
+    { NULL, 0, 0 },
+    { "uint2x3", 7, TOKEN_HLSL_USERTYPE },
+    { "shared", 6, TOKEN_HLSL_SHARED },
+    { "uint2x2", 7, TOKEN_HLSL_USERTYPE },
+    { "bool2", 5, TOKEN_HLSL_USERTYPE },
+    { "volatile", 8, TOKEN_HLSL_VOLATILE },
+    { "uint2x4", 7, TOKEN_HLSL_USERTYPE },
+    { "int2x3", 6, TOKEN_HLSL_USERTYPE },
+    { "int2x1", 6, TOKEN_HLSL_USERTYPE },
+};
+
+// end of mojoshader_hlsl_keywords.h ...
+
@@ -20,6 +20,7 @@
 #define DEBUG_PREPROCESSOR 0
 #define DEBUG_ASSEMBLER_PARSER 0
 #define DEBUG_COMPILER_PARSER 0
+#define DEBUG_COMPILER_IR 0
 #define DEBUG_TOKENIZER \
     (DEBUG_PREPROCESSOR || DEBUG_ASSEMBLER_PARSER || DEBUG_LEXER)
 
@@ -210,6 +211,7 @@ int hash_iter_keys(const HashTable *table, const void **_key, void **iter);
 
 uint32 hash_hash_string(const void *sym, void *unused);
 int hash_keymatch_string(const void *a, const void *b, void *unused);
+uint32 hash_bytes(const void *data, const size_t len);
 
 
 // String -> String map ...
@@ -248,6 +250,13 @@ int errorlist_count(ErrorList *list);
 MOJOSHADER_error *errorlist_flatten(ErrorList *list); // resets the list!
 void errorlist_destroy(ErrorList *list);
 
+// A one-element error array, for when something fails before there's a
+//  context to report it through (like failing to open the source file).
+//  Returns NULL if out of memory.
+MOJOSHADER_error *errorlist_single(const char *fname, const int errpos,
+                                   const char *str, MOJOSHADER_malloc m,
+                                   MOJOSHADER_free f, void *d);
+
 
 
 // Dynamic buffers...
@@ -267,6 +276,45 @@ ssize_t buffer_find(Buffer *buffer, const size_t start,
                     const void *data, const size_t len);
 
 
+// Region allocators: lots of small allocations that all die together.
+//  There's no way to free a single allocation; arena_destroy() releases
+//  everything at once.
+
+typedef struct Arena Arena;
+Arena *arena_create(size_t blksz, MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+void *arena_alloc(Arena *arena, const size_t len);  // NULL if out of memory.
+void arena_destroy(Arena *arena);
+
+
+// Mutexes...
+
+typedef struct Mutex Mutex;
+Mutex *mutex_create(MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+void mutex_lock(Mutex *mutex);
+void mutex_unlock(Mutex *mutex);
+void mutex_destroy(Mutex *mutex);
+
+
+// Threads...
+
+typedef struct Thread Thread;
+typedef void (*ThreadEntry)(void *data);
+Thread *thread_create(ThreadEntry fn, void *fndata,
+                      MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
+void thread_join(Thread *thread);  // waits for (thread), then frees it.
+int cpu_count(void);  // processors we could run threads on; at least one.
+
+
+// Run-once initialization...
+
+// Zero-initialize a static OnceFlag. run_once() calls (fn) the first time
+//  through, and again later only if it failed. Returns non-zero once (fn)
+//  has succeeded. Safe to call from several threads at once.
+typedef int OnceFlag;
+typedef int (*OnceEntry)(void);
+int run_once(OnceFlag *flag, OnceEntry fn);
+
+
 
 // This is the ID for a D3DXSHADER_CONSTANTTABLE in the bytecode comments.
 #define CTAB_ID 0x42415443  // 0x42415443 == 'CTAB'
@@ -542,13 +590,19 @@ typedef struct Conditional
     struct Conditional *next;
 } Conditional;
 
+// Macro expansions are lists of already-lexed tokens, not text. These are
+//  opaque outside the preprocessor.
+typedef struct MacroToken MacroToken;
+typedef struct HideSet HideSet;
+
 typedef struct Define
 {
     const char *identifier;
     const char *definition;
-    const char *original;
     const char **parameters;
     int paramcount;
+    MacroToken *tokens;  // (definition), lexed on first expansion.
+    unsigned int tokencount;
     struct Define *next;
 } Define;
 
@@ -570,6 +624,16 @@ typedef struct IncludeState
     unsigned int line;
     Conditional *conditional_stack;
     MOJOSHADER_includeClose close_callback;
+    const char *guard_key;  // non-NULL if this came from an #include.
+    unsigned int cache_id;  // non-zero if it came from an include cache.
+    const char *guard_macro;
+    int guard_state;
+    const MacroToken *tokens;  // non-NULL if this is a macro expansion.
+    unsigned int tokencount;
+    unsigned int tokenpos;
+    int free_tokens;
+    const HideSet *hideset;  // macros not to expand in (tokens).
+    const HideSet *token_hideset;  // ...and in the current token.
     struct IncludeState *next;
 } IncludeState;
 
@@ -581,6 +645,7 @@ Preprocessor *preprocessor_start(const char *fname, const char *source,
                             unsigned int sourcelen,
                             MOJOSHADER_includeOpen open_callback,
                             MOJOSHADER_includeClose close_callback,
+                            MOJOSHADER_includeCache *include_cache,
                             const MOJOSHADER_preprocessorDefine *defines,
                             unsigned int define_count, int asm_comments,
                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d);
@@ -589,6 +654,25 @@ void preprocessor_end(Preprocessor *pp);
 int preprocessor_outofmemory(Preprocessor *pp);
 const char *preprocessor_nexttoken(Preprocessor *_ctx,
                                    unsigned int *_len, Token *_token);
+
+// Identifier classification, for callers that would otherwise match
+//  keywords against token text. Register a classifier, which returns an
+//  identifier's (nonzero) class or zero, and sets (*needtext) if the caller
+//  still wants the identifier's text after classifying it. Then
+//  preprocessor_nexttoken_classified() returns the class in (*_tokenclass),
+//  and interns string literals, unclassified identifiers, and identifiers
+//  that need their text in (strcache), returning the cached string in
+//  (*_interned) (NULL for everything else). Classification happens after
+//  macro expansion, so it sees exactly what preprocessor_nexttoken() would
+//  have returned.
+typedef int (*PreprocessorClassifier)(const char *str, const unsigned int len,
+                                      int *needtext);
+
+void preprocessor_set_token_classes(Preprocessor *pp, StringCache *strcache,
+                                    PreprocessorClassifier classify);
+const char *preprocessor_nexttoken_classified(Preprocessor *pp,
+                                   unsigned int *_len, Token *_token,
+                                   const char **_interned, int *_tokenclass);
 const char *preprocessor_sourcepos(Preprocessor *pp, unsigned int *pos);
 
 
@@ -58,6 +58,215 @@ static Token update_state(IncludeState *s, int eoi, const uchar *cur,
     return val;
 } // update_state
 
+
+// Fast paths for the long runs that the state machine below would walk one
+//  byte at a time: whitespace, the insides of comments, and identifiers.
+//  Each of these takes a pointer to the first byte that's still in the run
+//  and returns a pointer to the first byte that isn't (or (limit)). They
+//  never read at or past (limit), so they're safe up to the end of the
+//  source; the sentinel takes it from there, like always.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define LEXER_USE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__GNUC__)
+#define LEXER_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if LEXER_USE_SSE2 && defined(_MSC_VER)
+#include <intrin.h>
+static inline int first_set_bit(const unsigned int x)
+{
+    unsigned long retval;
+    _BitScanForward(&retval, x);
+    return (int) retval;
+} // first_set_bit
+#elif LEXER_USE_SSE2
+#define first_set_bit(x) __builtin_ctz(x)
+#endif
+
+#if LEXER_USE_SSE2
+// byte (n) is 0xFF if byte (n) of (v) is in [lo, lo+count), 0 otherwise.
+static inline __m128i sse2_in_range(const __m128i v, const char lo,
+                                    const char count)
+{
+    const __m128i x = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(count - 1)), x);
+} // sse2_in_range
+
+#define SIMD_CHUNK 16
+#define SIMD_FIND_STOP(cur, inrun_expr) { \
+    const __m128i v = _mm_loadu_si128((const __m128i *) (cur)); \
+    const unsigned int stop = (~_mm_movemask_epi8(inrun_expr)) & 0xFFFF; \
+    if (stop) return (cur) + first_set_bit(stop); \
+}
+#define SIMD_EQ(ch) _mm_cmpeq_epi8(v, _mm_set1_epi8(ch))
+#define SIMD_OR(a, b) _mm_or_si128(a, b)
+#define SIMD_NOT(a) _mm_xor_si128(a, _mm_set1_epi8(-1))
+#define SIMD_RANGE(x, lo, count) sse2_in_range(x, lo, count)
+#define SIMD_LOWER(x) _mm_or_si128(x, _mm_set1_epi8(0x20))
+
+#elif LEXER_USE_NEON
+// index of the first 0xFF byte in (mask), or 16 if there isn't one.
+static inline int neon_first_set(const uint8x16_t mask)
+{
+    const uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(mask), 4);
+    const uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+    return bits ? (__builtin_ctzll(bits) >> 2) : 16;
+} // neon_first_set
+
+#define SIMD_CHUNK 16
+#define SIMD_FIND_STOP(cur, inrun_expr) { \
+    const uint8x16_t v = vld1q_u8(cur); \
+    const int stop = neon_first_set(vmvnq_u8(inrun_expr)); \
+    if (stop < 16) return (cur) + stop; \
+}
+#define SIMD_EQ(ch) vceqq_u8(v, vdupq_n_u8((uchar) (ch)))
+#define SIMD_OR(a, b) vorrq_u8(a, b)
+#define SIMD_NOT(a) vmvnq_u8(a)
+#define SIMD_RANGE(x, lo, count) \
+    vcltq_u8(vsubq_u8(x, vdupq_n_u8((uchar) (lo))), vdupq_n_u8((uchar) (count)))
+#define SIMD_LOWER(x) vorrq_u8(x, vdupq_n_u8(0x20))
+#endif
+
+// character classes for the fast paths. Digits can only continue an
+//  identifier, not start one.
+#define LEXCLASS_WHITESPACE 1
+#define LEXCLASS_IDENTIFIER 2
+#define LEXCLASS_DIGIT 4
+#define W LEXCLASS_WHITESPACE
+#define I LEXCLASS_IDENTIFIER
+#define D LEXCLASS_DIGIT
+static const uchar lexer_charclass[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, W, 0, W, W, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    W, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    D, D, D, D, D, D, D, D, D, D, 0, 0, 0, 0, 0, 0,
+    0, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, 0, 0, 0, 0, I,
+    0, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+#undef W
+#undef I
+#undef D
+
+static inline int lexer_is_whitespace(const uchar ch)
+{
+    return (lexer_charclass[ch] & LEXCLASS_WHITESPACE);
+} // lexer_is_whitespace
+
+static inline int lexer_is_identifier_start(const uchar ch)
+{
+    return (lexer_charclass[ch] & LEXCLASS_IDENTIFIER);
+} // lexer_is_identifier_start
+
+static inline int lexer_is_identifier(const uchar ch)
+{
+    return (lexer_charclass[ch] & (LEXCLASS_IDENTIFIER | LEXCLASS_DIGIT));
+} // lexer_is_identifier
+
+static const uchar *lexer_skip_whitespace(const uchar *cur,
+                                          const uchar *limit)
+{
+    // usually this is a single space between tokens.
+    if ((cur == limit) || (!lexer_is_whitespace(*cur)))
+        return cur;
+
+    #ifdef SIMD_CHUNK
+    while ((limit - cur) >= SIMD_CHUNK)
+    {
+        SIMD_FIND_STOP(cur, SIMD_OR(SIMD_OR(SIMD_EQ(' '), SIMD_EQ('\t')),
+                                    SIMD_OR(SIMD_EQ('\v'), SIMD_EQ('\f'))));
+        cur += SIMD_CHUNK;
+    } // while
+    #endif
+
+    while ((cur < limit) && (lexer_is_whitespace(*cur)))
+        cur++;
+    return cur;
+} // lexer_skip_whitespace
+
+// stops on anything that the multiline comment rules care about.
+static const uchar *lexer_skip_multiline_comment(const uchar *cur,
+                                                 const uchar *limit)
+{
+    #ifdef SIMD_CHUNK
+    while ((limit - cur) >= SIMD_CHUNK)
+    {
+        SIMD_FIND_STOP(cur, SIMD_NOT(SIMD_OR(SIMD_OR(SIMD_EQ('*'), SIMD_EQ('\0')),
+                                             SIMD_OR(SIMD_EQ('\r'), SIMD_EQ('\n')))));
+        cur += SIMD_CHUNK;
+    } // while
+    #endif
+
+    while (cur < limit)
+    {
+        const uchar ch = *cur;
+        if ((ch == '*') || (ch == '\0') || (ch == '\r') || (ch == '\n'))
+            break;
+        cur++;
+    } // while
+    return cur;
+} // lexer_skip_multiline_comment
+
+// stops on anything that the single line comment rules care about.
+static const uchar *lexer_skip_singleline_comment(const uchar *cur,
+                                                  const uchar *limit)
+{
+    #ifdef SIMD_CHUNK
+    while ((limit - cur) >= SIMD_CHUNK)
+    {
+        SIMD_FIND_STOP(cur, SIMD_NOT(SIMD_OR(SIMD_EQ('\0'),
+                                             SIMD_OR(SIMD_EQ('\r'), SIMD_EQ('\n')))));
+        cur += SIMD_CHUNK;
+    } // while
+    #endif
+
+    while (cur < limit)
+    {
+        const uchar ch = *cur;
+        if ((ch == '\0') || (ch == '\r') || (ch == '\n'))
+            break;
+        cur++;
+    } // while
+    return cur;
+} // lexer_skip_singleline_comment
+
+static const uchar *lexer_skip_identifier(const uchar *cur,
+                                          const uchar *limit)
+{
+    // most identifiers are short, so don't bother with SIMD until we've
+    //  seen that this one isn't.
+    const uchar *scalar_end = ((limit - cur) > 8) ? cur + 8 : limit;
+    while ((cur < scalar_end) && (lexer_is_identifier(*cur)))
+        cur++;
+    if (cur < scalar_end)
+        return cur;
+
+    #ifdef SIMD_CHUNK
+    while ((limit - cur) >= SIMD_CHUNK)
+    {
+        SIMD_FIND_STOP(cur, SIMD_OR(SIMD_OR(SIMD_EQ('_'), SIMD_RANGE(v, '0', 10)),
+                                    SIMD_RANGE(SIMD_LOWER(v), 'a', 26)));
+        cur += SIMD_CHUNK;
+    } // while
+    #endif
+
+    while ((cur < limit) && (lexer_is_identifier(*cur)))
+        cur++;
+    return cur;
+} // lexer_skip_identifier
+
 Token preprocessor_lexer(IncludeState *s)
 {
     const uchar *cursor = (const uchar *) s->source;
@@ -76,6 +285,20 @@ scanner_loop:
     if (YYLIMIT == YYCURSOR) YYFILL(1);
     token = cursor;
 
+    // the WHITESPACE and identifier rules below are the only ones that
+    //  start with these bytes, so take the fast path instead.
+    if (lexer_is_identifier_start(*cursor))
+    {
+        cursor = lexer_skip_identifier(cursor + 1, limit);
+        RET(TOKEN_IDENTIFIER);
+    } // if
+    else if (lexer_is_whitespace(*cursor))
+    {
+        cursor = lexer_skip_whitespace(cursor + 1, limit);
+        if (s->report_whitespace) RET(' ');
+        goto scanner_loop;
+    } // else if
+
 
 {
 	YYCTYPE yych;
@@ -1113,6 +1336,7 @@ yy180:
 
 
 multilinecomment:
+    cursor = lexer_skip_multiline_comment(cursor, limit);
     if (YYLIMIT == YYCURSOR) YYFILL(1);
     matchptr = cursor;
 // The "*\/" is just to avoid screwing up text editor syntax highlighting.
@@ -1182,6 +1406,7 @@ yy192:
 
 
 singlelinecomment:
+    cursor = lexer_skip_singleline_comment(cursor, limit);
     if (YYLIMIT == YYCURSOR) YYFILL(1);
     matchptr = cursor;
 
@@ -0,0 +1,4132 @@
+/*
+ * My changes over the original lempar.c from SQLite are encased in
+ *  #if __MOJOSHADER__ blocks.  --ryan.
+ */
+#ifndef __MOJOSHADER__
+#define __MOJOSHADER__ 1
+#endif
+
+#if !__MOJOSHADER__
+#define LEMON_SUPPORT_TRACING (!defined(NDEBUG))
+#endif
+
+/* Driver template for the LEMON parser generator.
+** The original author(s) of lempar.c disclaim copyright to this source code.
+** However, changes made for MojoShader fall under the same license as the
+** rest of MojoShader. Please see the file LICENSE.txt in the source's root
+** directory.
+*/
+/* First off, code is included that follows the "include" declaration
+** in the input grammar file. */
+#include <stdio.h>
+#line 31 "/root/repo/mojoshader_parser_hlsl.lemon"
+
+#ifndef __MOJOSHADER_HLSL_COMPILER__
+#error Do not compile this file directly.
+#endif
+#line 28 "/root/repo/mojoshader_parser_hlsl.h"
+/* Next is all token values, in a form suitable for use by makeheaders.
+** This section will be null unless lemon is run with the -m switch.
+*/
+/* 
+** These constants (all generated automatically by the parser generator)
+** specify the various kinds of tokens (terminals) that the parser
+** understands. 
+**
+** Each symbol here is a terminal symbol in the grammar.
+*/
+#define TOKEN_HLSL_COMMA                           1
+#define TOKEN_HLSL_ASSIGN                          2
+#define TOKEN_HLSL_ADDASSIGN                       3
+#define TOKEN_HLSL_SUBASSIGN                       4
+#define TOKEN_HLSL_MULASSIGN                       5
+#define TOKEN_HLSL_DIVASSIGN                       6
+#define TOKEN_HLSL_MODASSIGN                       7
+#define TOKEN_HLSL_LSHIFTASSIGN                    8
+#define TOKEN_HLSL_RSHIFTASSIGN                    9
+#define TOKEN_HLSL_ANDASSIGN                      10
+#define TOKEN_HLSL_ORASSIGN                       11
+#define TOKEN_HLSL_XORASSIGN                      12
+#define TOKEN_HLSL_QUESTION                       13
+#define TOKEN_HLSL_OROR                           14
+#define TOKEN_HLSL_ANDAND                         15
+#define TOKEN_HLSL_OR                             16
+#define TOKEN_HLSL_XOR                            17
+#define TOKEN_HLSL_AND                            18
+#define TOKEN_HLSL_EQL                            19
+#define TOKEN_HLSL_NEQ                            20
+#define TOKEN_HLSL_LT                             21
+#define TOKEN_HLSL_LEQ                            22
+#define TOKEN_HLSL_GT                             23
+#define TOKEN_HLSL_GEQ                            24
+#define TOKEN_HLSL_LSHIFT                         25
+#define TOKEN_HLSL_RSHIFT                         26
+#define TOKEN_HLSL_PLUS                           27
+#define TOKEN_HLSL_MINUS                          28
+#define TOKEN_HLSL_STAR                           29
+#define TOKEN_HLSL_SLASH                          30
+#define TOKEN_HLSL_PERCENT                        31
+#define TOKEN_HLSL_TYPECAST                       32
+#define TOKEN_HLSL_EXCLAMATION                    33
+#define TOKEN_HLSL_COMPLEMENT                     34
+#define TOKEN_HLSL_MINUSMINUS                     35
+#define TOKEN_HLSL_PLUSPLUS                       36
+#define TOKEN_HLSL_DOT                            37
+#define TOKEN_HLSL_LBRACKET                       38
+#define TOKEN_HLSL_RBRACKET                       39
+#define TOKEN_HLSL_LPAREN                         40
+#define TOKEN_HLSL_RPAREN                         41
+#define TOKEN_HLSL_ELSE                           42
+#define TOKEN_HLSL_SEMICOLON                      43
+#define TOKEN_HLSL_TYPEDEF                        44
+#define TOKEN_HLSL_CONST                          45
+#define TOKEN_HLSL_IDENTIFIER                     46
+#define TOKEN_HLSL_VOID                           47
+#define TOKEN_HLSL_INLINE                         48
+#define TOKEN_HLSL_IN                             49
+#define TOKEN_HLSL_INOUT                          50
+#define TOKEN_HLSL_OUT                            51
+#define TOKEN_HLSL_UNIFORM                        52
+#define TOKEN_HLSL_COLON                          53
+#define TOKEN_HLSL_LINEAR                         54
+#define TOKEN_HLSL_CENTROID                       55
+#define TOKEN_HLSL_NOINTERPOLATION                56
+#define TOKEN_HLSL_NOPERSPECTIVE                  57
+#define TOKEN_HLSL_SAMPLE                         58
+#define TOKEN_HLSL_EXTERN                         59
+#define TOKEN_HLSL_SHARED                         60
+#define TOKEN_HLSL_STATIC                         61
+#define TOKEN_HLSL_VOLATILE                       62
+#define TOKEN_HLSL_ROWMAJOR                       63
+#define TOKEN_HLSL_COLUMNMAJOR                    64
+#define TOKEN_HLSL_LBRACE                         65
+#define TOKEN_HLSL_RBRACE                         66
+#define TOKEN_HLSL_STRUCT                         67
+#define TOKEN_HLSL_PACKOFFSET                     68
+#define TOKEN_HLSL_REGISTER                       69
+#define TOKEN_HLSL_USERTYPE                       70
+#define TOKEN_HLSL_SAMPLER                        71
+#define TOKEN_HLSL_SAMPLER1D                      72
+#define TOKEN_HLSL_SAMPLER2D                      73
+#define TOKEN_HLSL_SAMPLER3D                      74
+#define TOKEN_HLSL_SAMPLERCUBE                    75
+#define TOKEN_HLSL_SAMPLER_STATE                  76
+#define TOKEN_HLSL_SAMPLERSTATE                   77
+#define TOKEN_HLSL_SAMPLERCOMPARISONSTATE         78
+#define TOKEN_HLSL_BOOL                           79
+#define TOKEN_HLSL_INT                            80
+#define TOKEN_HLSL_UINT                           81
+#define TOKEN_HLSL_HALF                           82
+#define TOKEN_HLSL_FLOAT                          83
+#define TOKEN_HLSL_DOUBLE                         84
+#define TOKEN_HLSL_STRING                         85
+#define TOKEN_HLSL_SNORM                          86
+#define TOKEN_HLSL_UNORM                          87
+#define TOKEN_HLSL_BUFFER                         88
+#define TOKEN_HLSL_VECTOR                         89
+#define TOKEN_HLSL_INT_CONSTANT                   90
+#define TOKEN_HLSL_MATRIX                         91
+#define TOKEN_HLSL_ISOLATE                        92
+#define TOKEN_HLSL_MAXINSTRUCTIONCOUNT            93
+#define TOKEN_HLSL_NOEXPRESSIONOPTIMIZATIONS      94
+#define TOKEN_HLSL_REMOVEUNUSEDINPUTS             95
+#define TOKEN_HLSL_UNUSED                         96
+#define TOKEN_HLSL_XPS                            97
+#define TOKEN_HLSL_BREAK                          98
+#define TOKEN_HLSL_CONTINUE                       99
+#define TOKEN_HLSL_DISCARD                        100
+#define TOKEN_HLSL_WHILE                          101
+#define TOKEN_HLSL_RETURN                         102
+#define TOKEN_HLSL_UNROLL                         103
+#define TOKEN_HLSL_LOOP                           104
+#define TOKEN_HLSL_FOR                            105
+#define TOKEN_HLSL_DO                             106
+#define TOKEN_HLSL_BRANCH                         107
+#define TOKEN_HLSL_IF                             108
+#define TOKEN_HLSL_FLATTEN                        109
+#define TOKEN_HLSL_IFALL                          110
+#define TOKEN_HLSL_IFANY                          111
+#define TOKEN_HLSL_PREDICATE                      112
+#define TOKEN_HLSL_PREDICATEBLOCK                 113
+#define TOKEN_HLSL_SWITCH                         114
+#define TOKEN_HLSL_FORCECASE                      115
+#define TOKEN_HLSL_CALL                           116
+#define TOKEN_HLSL_CASE                           117
+#define TOKEN_HLSL_DEFAULT                        118
+#define TOKEN_HLSL_FLOAT_CONSTANT                 119
+#define TOKEN_HLSL_STRING_LITERAL                 120
+#define TOKEN_HLSL_TRUE                           121
+#define TOKEN_HLSL_FALSE                          122
+/* Make sure the INTERFACE macro is defined.
+*/
+#ifndef INTERFACE
+# define INTERFACE 1
+#endif
+/* The next thing included is series of defines which control
+** various aspects of the generated parser.
+**    YYCODETYPE         is the data type used for storing terminal
+**                       and nonterminal numbers.  "unsigned char" is
+**                       used if there are fewer than 250 terminals
+**                       and nonterminals.  "int" is used otherwise.
+**    YYNOCODE           is a number of type YYCODETYPE which corresponds
+**                       to no legal terminal or nonterminal number.  This
+**                       number is used to fill in empty slots of the hash 
+**                       table.
+**    YYFALLBACK         If defined, this indicates that one or more tokens
+**                       have fall-back values which should be used if the
+**                       original value of the token will not parse.
+**    YYACTIONTYPE       is the data type used for storing terminal
+**                       and nonterminal numbers.  "unsigned char" is
+**                       used if there are fewer than 250 rules and
+**                       states combined.  "int" is used otherwise.
+**    ParseHLSLTOKENTYPE     is the data type used for minor tokens given 
+**                       directly to the parser from the tokenizer.
+**    YYMINORTYPE        is the data type used for all minor tokens.
+**                       This is typically a union of many types, one of
+**                       which is ParseHLSLTOKENTYPE.  The entry in the union
+**                       for base tokens is called "yy0".
+**    YYSTACKDEPTH       is the maximum depth of the parser's stack.  If
+**                       zero the stack is dynamically sized using realloc()
+**    ParseHLSLARG_SDECL     A static variable declaration for the %extra_argument
+**    ParseHLSLARG_PDECL     A parameter declaration for the %extra_argument
+**    ParseHLSLARG_STORE     Code to store %extra_argument into yypParser
+**    ParseHLSLARG_FETCH     Code to extract %extra_argument from yypParser
+**    YYNSTATE           the combined number of states.
+**    YYNRULE            the number of rules in the grammar
+**    YYERRORSYMBOL      is the code number of the error symbol.  If not
+**                       defined, then do no error processing.
+*/
+#define YYCODETYPE unsigned char
+#define YYNOCODE 198
+#define YYACTIONTYPE unsigned short int
+#define ParseHLSLTOKENTYPE  TokenData 
+typedef union {
+  int yyinit;
+  ParseHLSLTOKENTYPE yy0;
+  MOJOSHADER_astPackOffset * yy8;
+  MOJOSHADER_astVariableDeclaration * yy24;
+  MOJOSHADER_astArguments * yy26;
+  const MOJOSHADER_astDataType * yy37;
+  MOJOSHADER_astTypedef * yy71;
+  MOJOSHADER_astInputModifier yy75;
+  MOJOSHADER_astVariableLowLevel * yy82;
+  MOJOSHADER_astInterpolationModifier yy111;
+  MOJOSHADER_astCompilationUnit * yy139;
+  MOJOSHADER_astSwitchCases * yy165;
+  MOJOSHADER_astFunctionStorageClass yy175;
+  MOJOSHADER_astStatement * yy233;
+  MOJOSHADER_astStructDeclaration * yy249;
+  MOJOSHADER_astAnnotations * yy268;
+  int yy270;
+  const char * yy306;
+  MOJOSHADER_astFunctionParameters * yy307;
+  MOJOSHADER_astExpression * yy322;
+  MOJOSHADER_astStructMembers * yy346;
+  MOJOSHADER_astFunctionSignature * yy364;
+  MOJOSHADER_astScalarOrArray * yy380;
+} YYMINORTYPE;
+#ifndef YYSTACKDEPTH
+#define YYSTACKDEPTH 100
+#endif
+#define ParseHLSLARG_SDECL  Context *ctx ;
+#define ParseHLSLARG_PDECL , Context *ctx 
+#define ParseHLSLARG_FETCH  Context *ctx  = yypParser->ctx 
+#define ParseHLSLARG_STORE yypParser->ctx  = ctx 
+#define YYNSTATE 524
+#define YYNRULE 288
+#define YY_NO_ACTION      (YYNSTATE+YYNRULE+2)
+#define YY_ACCEPT_ACTION  (YYNSTATE+YYNRULE+1)
+#define YY_ERROR_ACTION   (YYNSTATE+YYNRULE)
+
+/* The yyzerominor constant is used to initialize instances of
+** YYMINORTYPE objects to zero. */
+static const YYMINORTYPE yyzerominor = { 0 };
+
+/* Define the yytestcase() macro to be a no-op if is not already defined
+** otherwise.
+**
+** Applications can choose to define yytestcase() in the %include section
+** to a macro that can assist in verifying code coverage.  For production
+** code the yytestcase() macro should be turned off.  But it is useful
+** for testing.
+*/
+#ifndef yytestcase
+# define yytestcase(X)
+#endif
+
+
+/* Next are the tables used to determine what action to take based on the
+** current state and lookahead token.  These tables are used to implement
+** functions that take a state number and lookahead value and return an
+** action integer.  
+**
+** Suppose the action integer is N.  Then the action is determined as
+** follows
+**
+**   0 <= N < YYNSTATE                  Shift N.  That is, push the lookahead
+**                                      token onto the stack and goto state N.
+**
+**   YYNSTATE <= N < YYNSTATE+YYNRULE   Reduce by rule N-YYNSTATE.
+**
+**   N == YYNSTATE+YYNRULE              A syntax error has occurred.
+**
+**   N == YYNSTATE+YYNRULE+1            The parser accepts its input.
+**
+**   N == YYNSTATE+YYNRULE+2            No such action.  Denotes unused
+**                                      slots in the yy_action[] table.
+**
+** The action table is constructed as a single large table named yy_action[].
+** Given state S and lookahead X, the action is computed as
+**
+**      yy_action[ yy_shift_ofst[S] + X ]
+**
+** If the index value yy_shift_ofst[S]+X is out of range or if the value
+** yy_lookahead[yy_shift_ofst[S]+X] is not equal to X or if yy_shift_ofst[S]
+** is equal to YY_SHIFT_USE_DFLT, it means that the action is not in the table
+** and that yy_default[S] should be used instead.  
+**
+** The formula above is for computing the action when the lookahead is
+** a terminal symbol.  If the lookahead is a non-terminal (as occurs after
+** a reduce action) then the yy_reduce_ofst[] array is used in place of
+** the yy_shift_ofst[] array and YY_REDUCE_USE_DFLT is used in place of
+** YY_SHIFT_USE_DFLT.
+**
+** The following are the tables generated in this section:
+**
+**  yy_action[]        A single table containing all actions.
+**  yy_lookahead[]     A table containing the lookahead for each entry in
+**                     yy_action.  Used to detect hash collisions.
+**  yy_shift_ofst[]    For each state, the offset into yy_action for
+**                     shifting terminals.
+**  yy_reduce_ofst[]   For each state, the offset into yy_action for
+**                     shifting non-terminals after a reduce.
+**  yy_default[]       Default action for each state.
+*/
+#define YY_ACTTAB_COUNT (5407)
+static const YYACTIONTYPE yy_action[] = {
+ /*     0 */    86,   85,  445,  446,  263,   46,   83,   84,   90,   91,
+ /*    10 */    39,  123,   88,   47,   27,  114,  343,   97,  404,  143,
+ /*    20 */   104,  421,   82,   81,   80,  406,  370,  140,  139,  409,
+ /*    30 */   369,  368,  410,  408,  407,  405,  403,  402,    1,  382,
+ /*    40 */   248,   76,   75,  510,  509,  508,  507,  506,  505,  504,
+ /*    50 */   503,  502,  501,  500,  499,  498,  497,  496,  495,  294,
+ /*    60 */   293,  292,  281,  481,  277,  249,  397,  396,  395,  394,
+ /*    70 */   393,  247,  246,  245,  337,   37,   78,   77,  335,  333,
+ /*    80 */   347,  332,   74,   72,   73,   71,   39,  331,  521,  100,
+ /*    90 */    86,   85,  480,  479,  478,  477,   83,   84,   90,   91,
+ /*   100 */   186,  123,  412,   47,   27,  115,  343,   97,  404,  143,
+ /*   110 */     1,  428,  117,  417,  138,  406,  367,  140,  139,  409,
+ /*   120 */   366,  365,  410,  408,  407,  405,  403,  402,    1,  383,
+ /*   130 */   248,   40,  214,  510,  509,  508,  507,  506,  505,  504,
+ /*   140 */   503,  502,  501,  500,  499,  498,  497,  496,  495,  294,
+ /*   150 */   293,  292,  281,  481,  277,  494,  397,  396,  395,  394,
+ /*   160 */   393,  247,  246,  245,  337,   37,  431,  493,  335,  333,
+ /*   170 */   364,  332,  140,  139,  363,  362,  146,  331,  284,  100,
+ /*   180 */    86,   85,  480,  479,  478,  477,   83,   84,   90,   91,
+ /*   190 */   180,  123,  412,   47,  113,  422,  343,   97,  404,  143,
+ /*   200 */   415,  140,  139,  492,  416,  406,  140,  139,  100,  409,
+ /*   210 */   140,  139,  410,  408,  407,  405,  403,  402,    1,  181,
+ /*   220 */   248,  412,  491,  510,  509,  508,  507,  506,  505,  504,
+ /*   230 */   503,  502,  501,  500,  499,  498,  497,  496,  495,  294,
+ /*   240 */   293,  292,  281,  481,  277,   63,  435,   70,   69,   62,
+ /*   250 */    63,  247,  246,  245,  337,   37,  473,  414,  335,  333,
+ /*   260 */   121,  332,   60,  140,  139,  262,  258,  331,  262,  258,
+ /*   270 */    86,   85,  480,  479,  478,  477,   83,   84,   90,   91,
+ /*   280 */   390,  137,   24,   47,   61,  100,   33,  514,  404,  143,
+ /*   290 */   511,  516,  515,  513,  512,  406,  181,   60,  412,  409,
+ /*   300 */   517,  179,  410,  408,  407,  405,  403,  402,   60,   48,
+ /*   310 */   248,  490,  122,  510,  509,  508,  507,  506,  505,  504,
+ /*   320 */   503,  502,  501,  500,  499,  498,  497,  496,  495,  294,
+ /*   330 */   293,  292,  281,  481,  277,  474,  489,  351,  119,  339,
+ /*   340 */   344,  109,  102,  132,  309,  118,  122,  427,  476,  442,
+ /*   350 */   130,  305,  260,   94,  437,  398,  433,  420,  488,  251,
+ /*   360 */   152,  240,  480,  479,  478,  477,  170,   24,   60,  514,
+ /*   370 */    38,   79,  511,  516,  515,  513,  512,   18,  345,   60,
+ /*   380 */    22,  219,  218,  216,  122,  338,  135,   60,  401,  475,
+ /*   390 */   150,  250,   60,  449,  145,  466,  157,  199,  198,  149,
+ /*   400 */   191,  271,  270,  268,  266,  189,  461,  351,  220,  339,
+ /*   410 */   344,  109,  102,  501,  500,  499,  498,  497,  496,  495,
+ /*   420 */   294,  293,  361,   94,  359,  398,  400,   21,  360,  251,
+ /*   430 */   358,    3,  425,  389,  342,  487,  170,  126,   60,  514,
+ /*   440 */    60,  319,  511,  516,  515,  513,  512,    5,  345,  486,
+ /*   450 */    22,  219,  218,  216,  399,  338,  135,  295,   27,  475,
+ /*   460 */   150,   27,   60,  449,  145,  466,  157,  199,  198,  149,
+ /*   470 */   191,  271,  270,  268,  266,  189,  461,  105,   20,  282,
+ /*   480 */   105,  351,  340,  339,  344,  109,  102,  501,  500,  499,
+ /*   490 */   498,  497,  496,  495,  294,  293,  101,   94,  100,  398,
+ /*   500 */   419,  138,  112,  251,   36,   40,  214,  103,  413,  184,
+ /*   510 */   170,  436,  154,  514,  140,  139,  511,  516,  515,  513,
+ /*   520 */   512,    4,  345,  485,   22,  219,  218,  216,   60,  338,
+ /*   530 */   135,   60,  213,  475,  150,  134,  125,  449,  145,  466,
+ /*   540 */   157,  199,  198,  149,  191,  271,  270,  268,  266,  189,
+ /*   550 */   461,  351,  279,  339,  344,  109,  102,  278,   60,  514,
+ /*   560 */    60,   60,  511,  516,  515,  513,  512,   94,  215,  398,
+ /*   570 */   484,   17,  275,  251,  291,  290,  289,  288,  287,  286,
+ /*   580 */   170,  285,  283,  514,   60,  124,  511,  516,  515,  513,
+ /*   590 */   512,   60,  222,   60,   22,  219,  218,  216,   14,  338,
+ /*   600 */   135,   12,   31,  475,  150,  144,   60,  449,  145,  466,
+ /*   610 */   157,  199,  198,  149,  191,  271,  270,  268,  266,  189,
+ /*   620 */   461,  317,  133,  311,  295,  351,   35,  339,  344,  109,
+ /*   630 */   102,   10,  514,    9,  274,  511,  516,  515,  513,  512,
+ /*   640 */    60,   94,  273,  398,  131,  307,   38,  251,   29,  483,
+ /*   650 */    27,  272,  295,   68,  170,   67,   65,  514,   64,  447,
+ /*   660 */   511,  516,  515,  513,  512,  261,  349,  185,   22,  219,
+ /*   670 */   218,  216,  434,  338,  135,  209,  259,  475,  150,  256,
+ /*   680 */     6,  449,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*   690 */   270,  268,  266,  189,  461,  351,  257,  339,  344,  109,
+ /*   700 */   102,  184,  514,  432,  262,  511,  516,  515,  513,  512,
+ /*   710 */    60,   94,  418,  398,  258,   89,  388,  251,  435,  384,
+ /*   720 */   380,  379,  378,  243,  170,  376,  136,  514,  153,  238,
+ /*   730 */   511,  516,  515,  513,  512,  151,  217,  242,   22,  219,
+ /*   740 */   218,  216,  239,  338,  135,  177,  176,  475,  150,  141,
+ /*   750 */   233,  449,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*   760 */   270,  268,  266,  189,  461,  357,  231,  356,  229,  351,
+ /*   770 */   227,  339,  344,  109,  102,  355,  514,  225,  353,  511,
+ /*   780 */   516,  515,  513,  512,  354,   94,  223,  398,  352,   44,
+ /*   790 */    19,  251,  221,  350,   43,   42,   41,  120,  170,    2,
+ /*   800 */    88,  514,  315,  212,  511,  516,  515,  513,  512,   93,
+ /*   810 */   348,  107,   22,  219,  218,  216,  106,  338,  135,  304,
+ /*   820 */   302,  475,  150,  204,   87,  449,  145,  466,  157,  199,
+ /*   830 */   198,  149,  191,  271,  270,  268,  266,  189,  461,  351,
+ /*   840 */   299,  339,  344,  109,  102,   38,  519,  295,  438,  482,
+ /*   850 */   430,  255,  473,  429,   27,   94,  254,  398,  252,  387,
+ /*   860 */   249,  251,  371,  336,   23,    1,  316,  312,  170,  520,
+ /*   870 */   310,  514,  298,  280,  511,  516,  515,  513,  512,  308,
+ /*   880 */   381,  306,   22,  219,  218,  216,  346,  338,  135,  241,
+ /*   890 */   184,  475,  150,  276,  158,  449,  145,  466,  157,  199,
+ /*   900 */   198,  149,  191,  271,  270,  268,  266,  189,  461,  814,
+ /*   910 */   814,  814,  814,  351,  814,  339,  344,  109,  102,  814,
+ /*   920 */   814,  814,  814,  814,  814,  814,  814,  814,  814,   94,
+ /*   930 */   814,  398,  814,  814,  814,  251,  814,  814,  814,  814,
+ /*   940 */   814,  814,  170,  814,  814,  514,  814,  814,  511,  516,
+ /*   950 */   515,  513,  512,  814,  334,  814,   22,  219,  218,  216,
+ /*   960 */   814,  338,  135,  814,  814,  475,  150,  814,  814,  449,
+ /*   970 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*   980 */   266,  189,  461,  351,  814,  339,  344,  109,  102,  814,
+ /*   990 */   814,  814,  814,  814,  814,  814,  814,  814,  814,   94,
+ /*  1000 */   814,  398,  814,  814,  814,  251,  814,  814,  814,  814,
+ /*  1010 */   814,  814,  170,  814,  814,  514,  814,  814,  511,  516,
+ /*  1020 */   515,  513,  512,  814,  330,  814,   22,  219,  218,  216,
+ /*  1030 */   814,  338,  135,  814,  814,  475,  150,  814,  814,  449,
+ /*  1040 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*  1050 */   266,  189,  461,  814,  814,  814,  814,  351,  814,  339,
+ /*  1060 */   344,  109,  102,  814,  814,  814,  814,  814,  814,  814,
+ /*  1070 */   814,  814,  814,   94,  814,  398,  814,  814,  814,  251,
+ /*  1080 */   814,  814,  814,  814,  814,  814,  170,  814,  814,  514,
+ /*  1090 */   814,  814,  511,  516,  515,  513,  512,  814,  329,  814,
+ /*  1100 */    22,  219,  218,  216,  814,  338,  135,  814,  814,  475,
+ /*  1110 */   150,  814,  814,  449,  145,  466,  157,  199,  198,  149,
+ /*  1120 */   191,  271,  270,  268,  266,  189,  461,  351,  814,  339,
+ /*  1130 */   344,  109,  102,  814,  814,  814,  814,  814,  814,  814,
+ /*  1140 */   814,  814,  814,   94,  814,  398,  814,  814,  814,  251,
+ /*  1150 */   814,  814,  814,  814,  814,  814,  170,  814,  814,  514,
+ /*  1160 */   814,  814,  511,  516,  515,  513,  512,  814,  328,  814,
+ /*  1170 */    22,  219,  218,  216,  814,  338,  135,  814,  814,  475,
+ /*  1180 */   150,  814,  814,  449,  145,  466,  157,  199,  198,  149,
+ /*  1190 */   191,  271,  270,  268,  266,  189,  461,  814,  814,  814,
+ /*  1200 */   814,  351,  814,  339,  344,  109,  102,  814,  814,  814,
+ /*  1210 */   814,  814,  814,  814,  814,  814,  814,   94,  814,  398,
+ /*  1220 */   814,  814,  814,  251,  814,  814,  814,  814,  814,  814,
+ /*  1230 */   170,  814,  814,  514,  814,  814,  511,  516,  515,  513,
+ /*  1240 */   512,  814,  327,  814,   22,  219,  218,  216,  814,  338,
+ /*  1250 */   135,  814,  814,  475,  150,  814,  814,  449,  145,  466,
+ /*  1260 */   157,  199,  198,  149,  191,  271,  270,  268,  266,  189,
+ /*  1270 */   461,  351,  814,  339,  344,  109,  102,  814,  814,  814,
+ /*  1280 */   814,  814,  814,  814,  814,  814,  814,   94,  814,  398,
+ /*  1290 */   814,  814,  814,  251,  814,  814,  814,  814,  814,  814,
+ /*  1300 */   170,  814,  814,  514,  814,  814,  511,  516,  515,  513,
+ /*  1310 */   512,  814,  326,  814,   22,  219,  218,  216,  814,  338,
+ /*  1320 */   135,  814,  814,  475,  150,  814,  814,  449,  145,  466,
+ /*  1330 */   157,  199,  198,  149,  191,  271,  270,  268,  266,  189,
+ /*  1340 */   461,  814,  814,  814,  814,  351,  814,  339,  344,  109,
+ /*  1350 */   102,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  1360 */   814,   94,  814,  398,  814,  814,  814,  251,  814,  814,
+ /*  1370 */   814,  814,  814,  814,  170,  814,  814,  514,  814,  814,
+ /*  1380 */   511,  516,  515,  513,  512,  814,  325,  814,   22,  219,
+ /*  1390 */   218,  216,  814,  338,  135,  814,  814,  475,  150,  814,
+ /*  1400 */   814,  449,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  1410 */   270,  268,  266,  189,  461,  351,  814,  339,  344,  109,
+ /*  1420 */   102,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  1430 */   814,   94,  814,  398,  814,  814,  814,  251,  814,  814,
+ /*  1440 */   814,  814,  814,  814,  170,  814,  814,  514,  814,  814,
+ /*  1450 */   511,  516,  515,  513,  512,  814,  324,  814,   22,  219,
+ /*  1460 */   218,  216,  814,  338,  135,  814,  814,  475,  150,  814,
+ /*  1470 */   814,  449,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  1480 */   270,  268,  266,  189,  461,  814,  814,  814,  814,  351,
+ /*  1490 */   814,  339,  344,  109,  102,  814,  814,  814,  814,  814,
+ /*  1500 */   814,  814,  814,  814,  814,   94,  814,  398,  814,  814,
+ /*  1510 */   814,  251,  814,  814,  814,  814,  814,  814,  170,  814,
+ /*  1520 */   814,  514,  814,  814,  511,  516,  515,  513,  512,  814,
+ /*  1530 */   323,  814,   22,  219,  218,  216,  814,  338,  135,  814,
+ /*  1540 */   814,  475,  150,  814,  814,  449,  145,  466,  157,  199,
+ /*  1550 */   198,  149,  191,  271,  270,  268,  266,  189,  461,  351,
+ /*  1560 */   814,  339,  344,  109,  102,  814,  814,  814,  814,  814,
+ /*  1570 */   814,  814,  814,  814,  814,   94,  814,  398,  814,  814,
+ /*  1580 */   814,  251,  814,  814,  814,  814,  814,  814,  170,  814,
+ /*  1590 */   814,  514,  814,  814,  511,  516,  515,  513,  512,  814,
+ /*  1600 */   322,  814,   22,  219,  218,  216,  814,  338,  135,  814,
+ /*  1610 */   814,  475,  150,  814,  814,  449,  145,  466,  157,  199,
+ /*  1620 */   198,  149,  191,  271,  270,  268,  266,  189,  461,  814,
+ /*  1630 */   814,  814,  814,  351,  814,  339,  344,  109,  102,  814,
+ /*  1640 */   814,  814,  814,  814,  814,  814,  814,  814,  814,   94,
+ /*  1650 */   814,  398,  814,  814,  814,  251,  814,  814,  814,  814,
+ /*  1660 */   814,  814,  170,  814,  814,  514,  814,  814,  511,  516,
+ /*  1670 */   515,  513,  512,  814,  321,  814,   22,  219,  218,  216,
+ /*  1680 */   814,  338,  135,  814,  814,  475,  150,  814,  814,  449,
+ /*  1690 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*  1700 */   266,  189,  461,  351,  814,  339,  344,  109,  102,  814,
+ /*  1710 */   814,  814,  814,  814,  814,  814,  814,  814,  814,   94,
+ /*  1720 */   814,  398,  814,  814,  814,  251,  814,  814,  814,  814,
+ /*  1730 */   814,  814,  170,  524,  814,  514,  814,  814,  511,  516,
+ /*  1740 */   515,  513,  512,  814,  320,  814,   22,  219,  218,  216,
+ /*  1750 */   814,  338,  135,  814,  814,  475,  150,  814,  814,  449,
+ /*  1760 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*  1770 */   266,  189,  461,  814,  814,  814,  814,   97,  404,  814,
+ /*  1780 */   205,  297,  814,  814,  814,  406,  814,  814,  814,  409,
+ /*  1790 */   814,  814,  410,  408,  407,  405,  403,  402,  814,  814,
+ /*  1800 */   248,  814,  814,  510,  509,  508,  507,  506,  505,  504,
+ /*  1810 */   503,  502,  501,  500,  499,  498,  497,  496,  495,  294,
+ /*  1820 */   293,  292,  281,  814,  277,   86,   85,  814,  814,  814,
+ /*  1830 */   814,   83,   84,   90,   91,  814,  814,  518,   47,  814,
+ /*  1840 */   814,  814,  814,  814,  143,  814,  814,   86,   85,  814,
+ /*  1850 */   814,  814,  814,   83,   84,   90,   91,  814,  814,  814,
+ /*  1860 */    47,  443,  814,  814,  814,  814,  143,  814,  510,  509,
+ /*  1870 */   508,  507,  506,  505,  504,  503,  502,  501,  500,  499,
+ /*  1880 */   498,  497,  496,  495,  294,  293,  292,  281,  481,  277,
+ /*  1890 */   510,  509,  508,  507,  506,  505,  504,  503,  502,  501,
+ /*  1900 */   500,  499,  498,  497,  496,  495,  294,  293,  292,  281,
+ /*  1910 */   481,  277,  814,  814,  814,   86,   85,  480,  479,  478,
+ /*  1920 */   477,   83,   84,   90,   91,  814,  814,  814,   47,  814,
+ /*  1930 */   814,  341,  814,  814,  143,  814,  814,   86,   85,  480,
+ /*  1940 */   479,  478,  477,   83,   84,   90,   91,  814,  814,  814,
+ /*  1950 */    47,  814,  814,   34,  814,  814,  143,  814,  510,  509,
+ /*  1960 */   508,  507,  506,  505,  504,  503,  502,  501,  500,  499,
+ /*  1970 */   498,  497,  496,  495,  294,  293,  292,  281,  481,  277,
+ /*  1980 */   510,  509,  508,  507,  506,  505,  504,  503,  502,  501,
+ /*  1990 */   500,  499,  498,  497,  496,  495,  294,  293,  292,  281,
+ /*  2000 */   481,  277,  814,  814,  814,   86,   85,  480,  479,  478,
+ /*  2010 */   477,   83,   84,   90,   91,  814,  814,  814,   47,   16,
+ /*  2020 */   814,  814,  814,  814,  143,  814,  814,   86,   85,  480,
+ /*  2030 */   479,  478,  477,   83,   84,   90,   91,  814,  814,  814,
+ /*  2040 */    47,   15,  814,  814,  814,  814,  143,  814,  510,  509,
+ /*  2050 */   508,  507,  506,  505,  504,  503,  502,  501,  500,  499,
+ /*  2060 */   498,  497,  496,  495,  294,  293,  292,  281,  481,  277,
+ /*  2070 */   510,  509,  508,  507,  506,  505,  504,  503,  502,  501,
+ /*  2080 */   500,  499,  498,  497,  496,  495,  294,  293,  292,  281,
+ /*  2090 */   481,  277,  814,  814,  814,   86,   85,  480,  479,  478,
+ /*  2100 */   477,   83,   84,   90,   91,  814,  814,  814,   47,  814,
+ /*  2110 */   814,   32,  814,  814,  143,  814,  814,   86,   85,  480,
+ /*  2120 */   479,  478,  477,   83,   84,   90,   91,  814,  814,  814,
+ /*  2130 */    47,   13,  814,  814,  814,  814,  143,  814,  510,  509,
+ /*  2140 */   508,  507,  506,  505,  504,  503,  502,  501,  500,  499,
+ /*  2150 */   498,  497,  496,  495,  294,  293,  292,  281,  481,  277,
+ /*  2160 */   510,  509,  508,  507,  506,  505,  504,  503,  502,  501,
+ /*  2170 */   500,  499,  498,  497,  496,  495,  294,  293,  292,  281,
+ /*  2180 */   481,  277,  814,  814,  814,   86,   85,  480,  479,  478,
+ /*  2190 */   477,   83,   84,   90,   91,  814,  814,  814,   47,   11,
+ /*  2200 */   814,  814,  814,  814,  143,  814,  814,   86,   85,  480,
+ /*  2210 */   479,  478,  477,   83,   84,   90,   91,  814,  814,  814,
+ /*  2220 */    47,  814,  814,   28,  814,  814,  143,  814,  510,  509,
+ /*  2230 */   508,  507,  506,  505,  504,  503,  502,  501,  500,  499,
+ /*  2240 */   498,  497,  496,  495,  294,  293,  292,  281,  481,  277,
+ /*  2250 */   510,  509,  508,  507,  506,  505,  504,  503,  502,  501,
+ /*  2260 */   500,  499,  498,  497,  496,  495,  294,  293,  292,  281,
+ /*  2270 */   481,  277,  814,  814,  814,   86,   85,  480,  479,  478,
+ /*  2280 */   477,   83,   84,   90,   91,  814,  814,  814,   47,    8,
+ /*  2290 */   814,  814,  814,  814,  143,  814,  814,   86,   85,  480,
+ /*  2300 */   479,  478,  477,   83,   84,   90,   91,  814,  814,  814,
+ /*  2310 */    47,    7,  814,  814,  814,  814,  143,  814,  510,  509,
+ /*  2320 */   508,  507,  506,  505,  504,  503,  502,  501,  500,  499,
+ /*  2330 */   498,  497,  496,  495,  294,  293,  292,  281,  481,  277,
+ /*  2340 */   510,  509,  508,  507,  506,  505,  504,  503,  502,  501,
+ /*  2350 */   500,  499,  498,  497,  496,  495,  294,  293,  292,  281,
+ /*  2360 */   481,  277,  814,  814,  814,   86,   85,  480,  479,  478,
+ /*  2370 */   477,   83,   84,   90,   91,  814,  814,  814,   47,  814,
+ /*  2380 */   814,  814,  814,  814,  143,  814,  814,  814,  814,  480,
+ /*  2390 */   479,  478,  477,  814,  814,  814,  814,  814,  814,  814,
+ /*  2400 */   814,  814,  814,   26,  814,  814,  814,  814,  510,  509,
+ /*  2410 */   508,  507,  506,  505,  504,  503,  502,  501,  500,  499,
+ /*  2420 */   498,  497,  496,  495,  294,  293,  292,  281,  481,  277,
+ /*  2430 */   814,   86,   85,  814,  121,  814,  814,   83,   84,   90,
+ /*  2440 */    91,  814,  814,   96,   47,  814,  814,  814,  814,  814,
+ /*  2450 */   143,  814,   92,  385,  386,  814,  814,  480,  479,  478,
+ /*  2460 */   477,  514,  814,  814,  511,  516,  515,  513,  512,   25,
+ /*  2470 */   814,  814,  814,  814,  510,  509,  508,  507,  506,  505,
+ /*  2480 */   504,  503,  502,  501,  500,  499,  498,  497,  496,  495,
+ /*  2490 */   294,  293,  292,  281,  481,  277,  814,   86,   85,  814,
+ /*  2500 */   814,  814,  814,   83,   84,   90,   91,  814,  814,  814,
+ /*  2510 */    45,  814,  814,  814,  814,  814,  143,  814,  814,  814,
+ /*  2520 */   814,  814,  814,  480,  479,  478,  477,   59,   55,   54,
+ /*  2530 */    58,   57,   56,   53,   52,   51,   49,   50,  814,  814,
+ /*  2540 */   510,  509,  508,  507,  506,  505,  504,  503,  502,  501,
+ /*  2550 */   500,  499,  498,  497,  496,  495,  294,  293,  292,  281,
+ /*  2560 */   481,  277,  814,  814,  814,  814,  814,  814,   86,   85,
+ /*  2570 */   814,  208,  814,  814,   83,   84,   90,   91,  313,   98,
+ /*  2580 */   814,   47,  814,  814,  814,  814,  814,  143,  814,  480,
+ /*  2590 */   479,  478,  477,  814,  814,  814,  814,  814,  514,  814,
+ /*  2600 */   814,  511,  516,  515,  513,  512,  814,  814,  814,  814,
+ /*  2610 */   814,  510,  509,  508,  507,  506,  505,  504,  503,  502,
+ /*  2620 */   501,  500,  499,  498,  497,  496,  495,  294,  293,  292,
+ /*  2630 */   281,  481,  277,  814,  377,  244,  375,  374,  373,  372,
+ /*  2640 */   814,  814,  814,  814,  814,  178,  237,  814,  814,  236,
+ /*  2650 */   814,  235,  234,  232,  230,  228,  814,  226,  224,  814,
+ /*  2660 */   480,  479,  478,  477,   97,  404,  814,  205,  297,  814,
+ /*  2670 */   814,  814,  406,  814,  814,  814,  409,  814,  814,  410,
+ /*  2680 */   408,  407,  405,  403,  402,  814,  814,  248,  814,  814,
+ /*  2690 */   510,  509,  508,  507,  506,  505,  504,  503,  502,  501,
+ /*  2700 */   500,  499,  498,  497,  496,  495,  294,  293,  292,  281,
+ /*  2710 */   404,  277,  814,  814,  814,  814,  814,  406,  814,  814,
+ /*  2720 */   814,  409,  814,  814,  410,  408,  407,  405,  403,  402,
+ /*  2730 */   814,  814,  814,  814,  814,  510,  509,  508,  507,  506,
+ /*  2740 */   505,  504,  503,  502,  501,  500,  499,  498,  497,  496,
+ /*  2750 */   495,  294,  293,  292,  281,   30,  277,  814,  814,  111,
+ /*  2760 */   102,  814,  814,  814,  814,  814,  814,  814,  814,  121,
+ /*  2770 */   814,   94,  814,  398,  814,  814,  814,  251,   96,  814,
+ /*  2780 */   814,  814,  814,  814,  168,  814,  814,  514,  391,  386,
+ /*  2790 */   511,  516,  515,  513,  512,  814,  514,  814,  814,  511,
+ /*  2800 */   516,  515,  513,  512,  814,  814,  814,  475,  150,  814,
+ /*  2810 */   814,  449,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  2820 */   270,  268,  266,  189,  461,  814,  397,  396,  395,  394,
+ /*  2830 */   393,  814,  814,  814,  814,  814,  814,  814,  392,  814,
+ /*  2840 */   814,  814,  510,  509,  508,  507,  506,  505,  504,  503,
+ /*  2850 */   502,  501,  500,  499,  498,  497,  496,  495,  294,  293,
+ /*  2860 */   292,  281,  814,  277,  814,  814,  397,  396,  395,  394,
+ /*  2870 */   393,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  2880 */   814,  814,  510,  509,  508,  507,  506,  505,  504,  503,
+ /*  2890 */   502,  501,  500,  499,  498,  497,  496,  495,  294,  293,
+ /*  2900 */   292,  281,  314,  277,  207,  303,  206,  301,  814,  814,
+ /*  2910 */   814,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  2920 */   814,  814,  814,  814,  814,  510,  509,  508,  507,  506,
+ /*  2930 */   505,  504,  503,  502,  501,  500,  499,  498,  497,  496,
+ /*  2940 */   495,  294,  293,  292,  281,  814,  277,  207,  303,  206,
+ /*  2950 */   301,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  2960 */   814,  814,  814,  814,  814,  814,  814,  814,  510,  509,
+ /*  2970 */   508,  507,  506,  505,  504,  503,  502,  501,  500,  499,
+ /*  2980 */   498,  497,  496,  495,  294,  293,  292,  281,  142,  277,
+ /*  2990 */   814,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  3000 */   208,  814,  814,  814,  814,  211,  210,  300,   98,  814,
+ /*  3010 */   814,  814,  423,  814,  814,  514,  814,  424,  511,  516,
+ /*  3020 */   515,  513,  512,  814,  814,  814,  814,  514,  814,  142,
+ /*  3030 */   511,  516,  515,  513,  512,  475,  150,  814,  814,  449,
+ /*  3040 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*  3050 */   266,  189,  461,  253,  814,  814,  514,  182,  814,  511,
+ /*  3060 */   516,  515,  513,  512,  814,  814,  814,  814,  814,  814,
+ /*  3070 */   142,  814,  814,  814,  814,  814,  475,  150,  814,  814,
+ /*  3080 */   449,  145,  466,  157,  199,  198,  149,  191,  271,  270,
+ /*  3090 */   268,  266,  189,  461,  253,  814,  814,  514,  183,  814,
+ /*  3100 */   511,  516,  515,  513,  512,  814,  814,  814,  814,  814,
+ /*  3110 */   814,  142,  814,  814,  814,  814,  814,  475,  150,  814,
+ /*  3120 */   814,  449,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  3130 */   270,  268,  266,  189,  461,  253,  814,  814,  514,  426,
+ /*  3140 */   814,  511,  516,  515,  513,  512,  814,  814,  814,  814,
+ /*  3150 */   814,  814,  127,  814,  814,  814,  814,  814,  475,  150,
+ /*  3160 */   814,  814,  449,  145,  466,  157,  199,  198,  149,  191,
+ /*  3170 */   271,  270,  268,  266,  189,  461,  201,  814,  814,  514,
+ /*  3180 */   814,  814,  511,  516,  515,  513,  512,  814,  814,  814,
+ /*  3190 */   814,  814,  814,  142,  814,  814,  814,  814,  814,  475,
+ /*  3200 */   150,  814,  814,  449,  145,  466,  157,  199,  198,  149,
+ /*  3210 */   191,  271,  270,  268,  266,  189,  461,  200,  814,  814,
+ /*  3220 */   514,  814,  814,  511,  516,  515,  513,  512,  814,  814,
+ /*  3230 */   814,  814,  814,  814,  142,  814,  814,  814,  814,  814,
+ /*  3240 */   475,  150,  814,  814,  449,  145,  466,  157,  199,  198,
+ /*  3250 */   149,  191,  271,  270,  268,  266,  189,  461,  201,  814,
+ /*  3260 */   814,  514,  814,  814,  511,  516,  515,  513,  512,  814,
+ /*  3270 */   814,  814,  814,  814,  814,  142,  814,  814,  814,  814,
+ /*  3280 */   814,  475,  150,  814,  814,  449,  145,  466,  157,  199,
+ /*  3290 */   198,  149,  191,  271,  270,  268,  266,  189,  461,  175,
+ /*  3300 */   814,  814,  514,  814,  814,  511,  516,  515,  513,  512,
+ /*  3310 */   814,  814,  814,  814,  814,  814,  142,  814,  814,  814,
+ /*  3320 */   814,  814,  475,  150,  814,  814,  449,  145,  466,  157,
+ /*  3330 */   199,  198,  149,  191,  271,  270,  268,  266,  189,  461,
+ /*  3340 */   174,  814,  814,  514,  814,  814,  511,  516,  515,  513,
+ /*  3350 */   512,  814,  814,  814,  814,  814,  814,  142,  814,  814,
+ /*  3360 */   814,  814,  814,  475,  150,  814,  814,  449,  145,  466,
+ /*  3370 */   157,  199,  198,  149,  191,  271,  270,  268,  266,  189,
+ /*  3380 */   461,  173,  814,  814,  514,  814,  814,  511,  516,  515,
+ /*  3390 */   513,  512,  814,  814,  814,  814,  814,  814,  142,  814,
+ /*  3400 */   814,  814,  814,  814,  475,  150,  814,  814,  449,  145,
+ /*  3410 */   466,  157,  199,  198,  149,  191,  271,  270,  268,  266,
+ /*  3420 */   189,  461,  172,  814,  814,  514,  814,  814,  511,  516,
+ /*  3430 */   515,  513,  512,  814,  814,  814,  814,  814,  814,  142,
+ /*  3440 */   814,  814,  814,  814,  814,  475,  150,  814,  814,  449,
+ /*  3450 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*  3460 */   266,  189,  461,  171,  814,  814,  514,  814,  814,  511,
+ /*  3470 */   516,  515,  513,  512,  814,  814,  814,  814,  814,  814,
+ /*  3480 */   142,  814,  814,  814,  814,  814,  475,  150,  814,  814,
+ /*  3490 */   449,  145,  466,  157,  199,  198,  149,  191,  271,  270,
+ /*  3500 */   268,  266,  189,  461,  202,  814,  814,  514,  814,  814,
+ /*  3510 */   511,  516,  515,  513,  512,  814,  814,  814,  814,  814,
+ /*  3520 */   142,  814,  814,  814,  814,  814,  814,  475,  150,  814,
+ /*  3530 */   814,  449,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  3540 */   270,  268,  266,  189,  461,  814,  814,  514,  814,  814,
+ /*  3550 */   511,  516,  515,  513,  512,  814,  814,  814,  814,  814,
+ /*  3560 */   814,  142,  814,  814,  814,  814,  814,  475,  150,  814,
+ /*  3570 */   187,  440,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  3580 */   270,  268,  266,  189,  461,  169,  814,  814,  514,  814,
+ /*  3590 */   814,  511,  516,  515,  513,  512,  814,  814,  814,  814,
+ /*  3600 */   814,  814,  142,  814,  814,  814,  814,  814,  475,  150,
+ /*  3610 */   814,  814,  449,  145,  466,  157,  199,  198,  149,  191,
+ /*  3620 */   271,  270,  268,  266,  189,  461,  167,  814,  814,  514,
+ /*  3630 */   814,  814,  511,  516,  515,  513,  512,  814,  814,  814,
+ /*  3640 */   814,  814,  814,  142,  814,  814,  814,  814,  814,  475,
+ /*  3650 */   150,  814,  814,  449,  145,  466,  157,  199,  198,  149,
+ /*  3660 */   191,  271,  270,  268,  266,  189,  461,  166,  814,  814,
+ /*  3670 */   514,  814,  814,  511,  516,  515,  513,  512,  814,  814,
+ /*  3680 */   814,  814,  814,  814,  142,  814,  814,  814,  814,  814,
+ /*  3690 */   475,  150,  814,  814,  449,  145,  466,  157,  199,  198,
+ /*  3700 */   149,  191,  271,  270,  268,  266,  189,  461,  165,  814,
+ /*  3710 */   814,  514,  814,  814,  511,  516,  515,  513,  512,  814,
+ /*  3720 */   814,  814,  814,  814,  814,  142,  814,  814,  814,  814,
+ /*  3730 */   814,  475,  150,  814,  814,  449,  145,  466,  157,  199,
+ /*  3740 */   198,  149,  191,  271,  270,  268,  266,  189,  461,  163,
+ /*  3750 */   814,  814,  514,  814,  814,  511,  516,  515,  513,  512,
+ /*  3760 */   814,  814,  814,  814,  814,  814,  142,  814,  814,  814,
+ /*  3770 */   814,  814,  475,  150,  814,  814,  449,  145,  466,  157,
+ /*  3780 */   199,  198,  149,  191,  271,  270,  268,  266,  189,  461,
+ /*  3790 */   164,  814,  814,  514,  814,  814,  511,  516,  515,  513,
+ /*  3800 */   512,  814,  814,  814,  814,  814,  814,  142,  814,  814,
+ /*  3810 */   814,  814,  814,  475,  150,  814,  814,  449,  145,  466,
+ /*  3820 */   157,  199,  198,  149,  191,  271,  270,  268,  266,  189,
+ /*  3830 */   461,  162,  814,  814,  514,  814,  814,  511,  516,  515,
+ /*  3840 */   513,  512,  814,  814,  814,  814,  814,  814,  142,  814,
+ /*  3850 */   814,  814,  814,  814,  475,  150,  814,  814,  449,  145,
+ /*  3860 */   466,  157,  199,  198,  149,  191,  271,  270,  268,  266,
+ /*  3870 */   189,  461,  161,  814,  814,  514,  814,  814,  511,  516,
+ /*  3880 */   515,  513,  512,  814,  814,  814,  814,  814,  814,  142,
+ /*  3890 */   814,  814,  814,  814,  814,  475,  150,  814,  814,  449,
+ /*  3900 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*  3910 */   266,  189,  461,  160,  814,  814,  514,  814,  814,  511,
+ /*  3920 */   516,  515,  513,  512,  814,  814,  814,  814,  814,  814,
+ /*  3930 */   142,  814,  814,  814,  814,  814,  475,  150,  814,  814,
+ /*  3940 */   449,  145,  466,  157,  199,  198,  149,  191,  271,  270,
+ /*  3950 */   268,  266,  189,  461,  159,  814,  814,  514,  814,  814,
+ /*  3960 */   511,  516,  515,  513,  512,  814,  814,  814,  814,  814,
+ /*  3970 */   142,  814,  814,  814,  814,  814,  814,  475,  150,  814,
+ /*  3980 */   814,  449,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  3990 */   270,  268,  266,  189,  461,  814,  814,  514,  814,  814,
+ /*  4000 */   511,  516,  515,  513,  512,  814,  814,  814,  142,  814,
+ /*  4010 */   814,  814,  814,  814,  814,  814,  814,  475,  150,  814,
+ /*  4020 */   814,  439,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  4030 */   270,  268,  266,  189,  461,  514,  814,  814,  511,  516,
+ /*  4040 */   515,  513,  512,  814,  814,  814,  142,  814,  814,  814,
+ /*  4050 */   814,  814,  814,  814,  814,  475,  150,  814,  814,  460,
+ /*  4060 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*  4070 */   266,  189,  461,  514,  814,  814,  511,  516,  515,  513,
+ /*  4080 */   512,  814,  814,  814,  142,  814,  814,  814,  814,  814,
+ /*  4090 */   814,  814,  814,  475,  150,  814,  814,  459,  145,  466,
+ /*  4100 */   157,  199,  198,  149,  191,  271,  270,  268,  266,  189,
+ /*  4110 */   461,  514,  814,  814,  511,  516,  515,  513,  512,  814,
+ /*  4120 */   814,  814,  142,  814,  814,  814,  814,  814,  814,  814,
+ /*  4130 */   814,  475,  150,  814,  814,  458,  145,  466,  157,  199,
+ /*  4140 */   198,  149,  191,  271,  270,  268,  266,  189,  461,  514,
+ /*  4150 */   814,  814,  511,  516,  515,  513,  512,  814,  814,  814,
+ /*  4160 */   142,  814,  814,  814,  814,  814,  814,  814,  814,  475,
+ /*  4170 */   150,  814,  814,  457,  145,  466,  157,  199,  198,  149,
+ /*  4180 */   191,  271,  270,  268,  266,  189,  461,  514,  814,  814,
+ /*  4190 */   511,  516,  515,  513,  512,  814,  814,  814,  142,  814,
+ /*  4200 */   814,  814,  814,  814,  814,  814,  814,  475,  150,  814,
+ /*  4210 */   814,  456,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  4220 */   270,  268,  266,  189,  461,  514,  814,  814,  511,  516,
+ /*  4230 */   515,  513,  512,  814,  814,  814,  142,  814,  814,  814,
+ /*  4240 */   814,  814,  814,  814,  814,  475,  150,  814,  814,  455,
+ /*  4250 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*  4260 */   266,  189,  461,  514,  814,  814,  511,  516,  515,  513,
+ /*  4270 */   512,  814,  814,  814,  142,  814,  814,  814,  814,  814,
+ /*  4280 */   814,  814,  814,  475,  150,  814,  814,  454,  145,  466,
+ /*  4290 */   157,  199,  198,  149,  191,  271,  270,  268,  266,  189,
+ /*  4300 */   461,  514,  814,  814,  511,  516,  515,  513,  512,  814,
+ /*  4310 */   814,  814,  142,  814,  814,  814,  814,  814,  814,  814,
+ /*  4320 */   814,  475,  150,  814,  814,  453,  145,  466,  157,  199,
+ /*  4330 */   198,  149,  191,  271,  270,  268,  266,  189,  461,  514,
+ /*  4340 */   814,  814,  511,  516,  515,  513,  512,  814,  814,  814,
+ /*  4350 */   142,  814,  814,  814,  814,  814,  814,  814,  814,  475,
+ /*  4360 */   150,  814,  814,  452,  145,  466,  157,  199,  198,  149,
+ /*  4370 */   191,  271,  270,  268,  266,  189,  461,  514,  814,  814,
+ /*  4380 */   511,  516,  515,  513,  512,  814,  814,  814,  142,  814,
+ /*  4390 */   814,  814,  814,  814,  814,  814,  814,  475,  150,  814,
+ /*  4400 */   814,  451,  145,  466,  157,  199,  198,  149,  191,  271,
+ /*  4410 */   270,  268,  266,  189,  461,  514,  814,  814,  511,  516,
+ /*  4420 */   515,  513,  512,  814,  814,  814,  142,  814,  814,  814,
+ /*  4430 */   814,  814,  814,  814,  814,  475,  150,  814,  814,  450,
+ /*  4440 */   145,  466,  157,  199,  198,  149,  191,  271,  270,  268,
+ /*  4450 */   266,  189,  461,  514,  814,  814,  511,  516,  515,  513,
+ /*  4460 */   512,  814,  814,  814,  814,  814,   99,  814,  814,  814,
+ /*  4470 */   814,  814,  814,  475,  150,  814,  814,  441,  145,  466,
+ /*  4480 */   157,  199,  198,  149,  191,  271,  270,  268,  266,  189,
+ /*  4490 */   461,  510,  509,  508,  507,  506,  505,  504,  503,  502,
+ /*  4500 */   501,  500,  499,  498,  497,  496,  495,  294,  293,  292,
+ /*  4510 */   281,  814,  277,  814,  205,  814,  814,  814,  814,  814,
+ /*  4520 */   814,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  4530 */   142,  814,  814,  814,  814,  814,  814,  510,  509,  508,
+ /*  4540 */   507,  506,  505,  504,  503,  502,  501,  500,  499,  498,
+ /*  4550 */   497,  496,  495,  294,  293,  292,  281,  514,  277,  814,
+ /*  4560 */   511,  516,  515,  513,  512,  814,  814,  814,  814,  814,
+ /*  4570 */   814,  814,  814,  814,  814,  814,  814,  475,  150,  814,
+ /*  4580 */   814,  814,  467,  466,  157,  199,  198,  149,  191,  271,
+ /*  4590 */   270,  268,  266,  189,  462,  814,  814,  814,  814,  814,
+ /*  4600 */   814,  510,  509,  508,  507,  506,  505,  504,  503,  502,
+ /*  4610 */   501,  500,  499,  498,  497,  496,  495,  294,  293,  292,
+ /*  4620 */   281,  142,  277,  814,  813,   66,  296,  522,  128,  814,
+ /*  4630 */   318,  108,  110,  814,   95,  129,  814,  814,  814,  814,
+ /*  4640 */   814,  814,  814,   94,  814,  398,  814,  814,  514,  251,
+ /*  4650 */   814,  511,  516,  515,  513,  512,  814,  814,  814,  514,
+ /*  4660 */   814,  814,  511,  516,  515,  513,  512,  814,  475,  150,
+ /*  4670 */   142,  814,  814,  467,  466,  157,  199,  198,  149,  191,
+ /*  4680 */   271,  270,  268,  266,  188,  814,  814,  814,  814,  814,
+ /*  4690 */   814,  814,  814,  814,  814,  814,  814,  514,  814,  814,
+ /*  4700 */   511,  516,  515,  513,  512,  814,  814,  814,  814,  814,
+ /*  4710 */   142,  814,  814,  814,  814,  814,  814,  475,  150,  814,
+ /*  4720 */   116,  814,  467,  466,  157,  199,  198,  149,  191,  271,
+ /*  4730 */   270,  268,  264,  411,  814,  814,  814,  514,  814,  814,
+ /*  4740 */   511,  516,  515,  513,  512,  142,  814,  514,  814,  814,
+ /*  4750 */   511,  516,  515,  513,  512,  814,  814,  475,  150,  814,
+ /*  4760 */   814,  814,  467,  466,  157,  199,  198,  149,  191,  271,
+ /*  4770 */   270,  265,  514,  814,  814,  511,  516,  515,  513,  512,
+ /*  4780 */   814,  142,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  4790 */   814,  814,  475,  150,  814,  814,  814,  467,  466,  157,
+ /*  4800 */   199,  198,  149,  191,  271,  267,  814,  814,  514,  814,
+ /*  4810 */   814,  511,  516,  515,  513,  512,  814,  814,  814,  814,
+ /*  4820 */   814,  814,  814,  814,  814,  814,  814,  814,  475,  150,
+ /*  4830 */   814,  814,  814,  467,  466,  157,  199,  198,  149,  191,
+ /*  4840 */   269,  814,  814,  814,  523,  522,  128,  814,  318,  108,
+ /*  4850 */   110,  814,   95,  129,  814,  814,  814,  814,  142,  814,
+ /*  4860 */   814,   94,  814,  398,  814,  814,  814,  251,  814,  814,
+ /*  4870 */   142,  814,  814,  814,  814,  814,  814,  514,  814,  814,
+ /*  4880 */   511,  516,  515,  513,  512,  514,  814,  814,  511,  516,
+ /*  4890 */   515,  513,  512,  814,  814,  814,  814,  514,  814,  814,
+ /*  4900 */   511,  516,  515,  513,  512,  475,  150,  814,  142,  814,
+ /*  4910 */   467,  466,  157,  199,  198,  149,  190,  475,  150,  814,
+ /*  4920 */   814,  814,  467,  466,  157,  199,  198,  148,  814,  814,
+ /*  4930 */   814,  814,  814,  814,  814,  514,  814,  814,  511,  516,
+ /*  4940 */   515,  513,  512,  814,  142,  814,  814,  814,  814,  814,
+ /*  4950 */   814,  814,  814,  814,  814,  475,  150,  814,  814,  814,
+ /*  4960 */   467,  466,  157,  199,  198,  147,  814,  814,  814,  814,
+ /*  4970 */   814,  514,  814,  814,  511,  516,  515,  513,  512,  142,
+ /*  4980 */   814,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  4990 */   814,  475,  150,  814,  814,  814,  467,  466,  157,  199,
+ /*  5000 */   195,  814,  814,  814,  814,  814,  514,  814,  814,  511,
+ /*  5010 */   516,  515,  513,  512,  142,  814,  814,  814,  814,  814,
+ /*  5020 */   814,  814,  814,  814,  142,  814,  475,  150,  814,  814,
+ /*  5030 */   814,  467,  466,  157,  199,  194,  814,  814,  814,  814,
+ /*  5040 */   814,  514,  814,  814,  511,  516,  515,  513,  512,  814,
+ /*  5050 */   814,  514,  814,  814,  511,  516,  515,  513,  512,  142,
+ /*  5060 */   814,  475,  150,  814,  814,  814,  467,  466,  157,  199,
+ /*  5070 */   193,  475,  150,  814,  814,  814,  467,  466,  157,  199,
+ /*  5080 */   192,  814,  814,  814,  814,  814,  514,  814,  142,  511,
+ /*  5090 */   516,  515,  513,  512,  814,  814,  814,  142,  814,  814,
+ /*  5100 */   814,  814,  814,  814,  814,  814,  475,  150,  814,  814,
+ /*  5110 */   814,  467,  466,  157,  197,  514,  814,  814,  511,  516,
+ /*  5120 */   515,  513,  512,  814,  514,  142,  814,  511,  516,  515,
+ /*  5130 */   513,  512,  814,  814,  814,  475,  150,  814,  814,  814,
+ /*  5140 */   467,  466,  157,  196,  475,  150,  814,  814,  814,  467,
+ /*  5150 */   466,  156,  514,  814,  814,  511,  516,  515,  513,  512,
+ /*  5160 */   208,  814,  814,  814,  814,  203,  210,  300,   98,  814,
+ /*  5170 */   814,  814,  475,  150,  142,  814,  814,  467,  466,  155,
+ /*  5180 */   814,  814,  814,  814,  142,  814,  814,  514,  814,  814,
+ /*  5190 */   511,  516,  515,  513,  512,  814,  814,  814,  814,  814,
+ /*  5200 */   814,  514,  814,  814,  511,  516,  515,  513,  512,  814,
+ /*  5210 */   814,  514,  142,  814,  511,  516,  515,  513,  512,  814,
+ /*  5220 */   814,  475,  150,  142,  814,  814,  467,  471,  814,  814,
+ /*  5230 */   814,  475,  150,  814,  814,  814,  467,  470,  814,  514,
+ /*  5240 */   814,  814,  511,  516,  515,  513,  512,  142,  814,  814,
+ /*  5250 */   514,  814,  814,  511,  516,  515,  513,  512,  142,  475,
+ /*  5260 */   150,  814,  814,  814,  467,  469,  814,  814,  814,  814,
+ /*  5270 */   475,  150,  814,  814,  514,  467,  468,  511,  516,  515,
+ /*  5280 */   513,  512,  142,  814,  814,  514,  814,  814,  511,  516,
+ /*  5290 */   515,  513,  512,  142,  475,  150,  814,  814,  814,  467,
+ /*  5300 */   465,  814,  814,  814,  814,  475,  150,  814,  814,  514,
+ /*  5310 */   467,  464,  511,  516,  515,  513,  512,  142,  814,  814,
+ /*  5320 */   514,  814,  814,  511,  516,  515,  513,  512,  814,  475,
+ /*  5330 */   150,  814,  814,  814,  467,  463,  814,  814,  814,  814,
+ /*  5340 */   475,  150,  814,  814,  514,  467,  444,  511,  516,  515,
+ /*  5350 */   513,  512,  814,  814,  142,  814,  814,  814,  814,  814,
+ /*  5360 */   814,  814,  814,  814,  475,  150,  814,  814,  814,  448,
+ /*  5370 */   814,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  5380 */   814,  514,  814,  814,  511,  516,  515,  513,  512,  814,
+ /*  5390 */   814,  814,  814,  814,  814,  814,  814,  814,  814,  814,
+ /*  5400 */   814,  475,  150,  814,  814,  814,  472,
+};
+static const YYCODETYPE yy_lookahead[] = {
+ /*     0 */    27,   28,   35,   36,   37,   38,   33,   34,   35,   36,
+ /*    10 */    38,   38,   40,   40,    2,  142,   43,   44,   45,   46,
+ /*    20 */   147,  148,   29,   30,   31,   52,  101,  154,  155,   56,
+ /*    30 */   105,  106,   59,   60,   61,   62,   63,   64,   65,   66,
+ /*    40 */    67,   25,   26,   70,   71,   72,   73,   74,   75,   76,
+ /*    50 */    77,   78,   79,   80,   81,   82,   83,   84,   85,   86,
+ /*    60 */    87,   88,   89,   90,   91,   53,   54,   55,   56,   57,
+ /*    70 */    58,   98,   99,  100,  101,  102,   27,   28,  105,  106,
+ /*    80 */    66,  108,   21,   22,   23,   24,   38,  114,   43,  133,
+ /*    90 */    27,   28,  119,  120,  121,  122,   33,   34,   35,   36,
+ /*   100 */   144,   38,  146,   40,    2,  142,   43,   44,   45,   46,
+ /*   110 */    65,  148,  157,  158,  159,   52,  101,  154,  155,   56,
+ /*   120 */   105,  106,   59,   60,   61,   62,   63,   64,   65,   66,
+ /*   130 */    67,  117,  118,   70,   71,   72,   73,   74,   75,   76,
+ /*   140 */    77,   78,   79,   80,   81,   82,   83,   84,   85,   86,
+ /*   150 */    87,   88,   89,   90,   91,   83,   54,   55,   56,   57,
+ /*   160 */    58,   98,   99,  100,  101,  102,  148,   83,  105,  106,
+ /*   170 */   101,  108,  154,  155,  105,  106,   21,  114,   83,  133,
+ /*   180 */    27,   28,  119,  120,  121,  122,   33,   34,   35,   36,
+ /*   190 */   144,   38,  146,   40,  142,  148,   43,   44,   45,   46,
+ /*   200 */   148,  154,  155,   23,  148,   52,  154,  155,  133,   56,
+ /*   210 */   154,  155,   59,   60,   61,   62,   63,   64,   65,  144,
+ /*   220 */    67,  146,   23,   70,   71,   72,   73,   74,   75,   76,
+ /*   230 */    77,   78,   79,   80,   81,   82,   83,   84,   85,   86,
+ /*   240 */    87,   88,   89,   90,   91,   14,   46,   19,   20,   13,
+ /*   250 */    14,   98,   99,  100,  101,  102,  181,  148,  105,  106,
+ /*   260 */   132,  108,    1,  154,  155,   68,   69,  114,   68,   69,
+ /*   270 */    27,   28,  119,  120,  121,  122,   33,   34,   35,   36,
+ /*   280 */   152,  133,    1,   40,   53,  133,   43,  159,   45,   46,
+ /*   290 */   162,  163,  164,  165,  166,   52,  144,    1,  146,   56,
+ /*   300 */    39,  153,   59,   60,   61,   62,   63,   64,    1,    1,
+ /*   310 */    67,   23,    1,   70,   71,   72,   73,   74,   75,   76,
+ /*   320 */    77,   78,   79,   80,   81,   82,   83,   84,   85,   86,
+ /*   330 */    87,   88,   89,   90,   91,   39,   23,  127,  136,  129,
+ /*   340 */   130,  131,  132,  141,  142,  136,    1,   66,   41,   41,
+ /*   350 */   141,  142,   37,  143,   43,  145,   41,   23,   23,  149,
+ /*   360 */    39,   40,  119,  120,  121,  122,  156,    1,    1,  159,
+ /*   370 */    40,   41,  162,  163,  164,  165,  166,  167,  168,    1,
+ /*   380 */   170,  171,  172,  173,    1,  175,  176,    1,   43,  179,
+ /*   390 */   180,    1,    1,  183,  184,  185,  186,  187,  188,  189,
+ /*   400 */   190,  191,  192,  193,  194,  195,  196,  127,   41,  129,
+ /*   410 */   130,  131,  132,   79,   80,   81,   82,   83,   84,   85,
+ /*   420 */    86,   87,  108,  143,  108,  145,   43,   41,  114,  149,
+ /*   430 */   114,   53,   66,   43,   43,   23,  156,  174,    1,  159,
+ /*   440 */     1,  178,  162,  163,  164,  165,  166,  167,  168,   23,
+ /*   450 */   170,  171,  172,  173,   43,  175,  176,   46,    2,  179,
+ /*   460 */   180,    2,    1,  183,  184,  185,  186,  187,  188,  189,
+ /*   470 */   190,  191,  192,  193,  194,  195,  196,   21,   41,   83,
+ /*   480 */    21,  127,   43,  129,  130,  131,  132,   79,   80,   81,
+ /*   490 */    82,   83,   84,   85,   86,   87,  136,  143,  133,  145,
+ /*   500 */   158,  159,  142,  149,   43,  117,  118,  147,  148,   53,
+ /*   510 */   156,  146,   53,  159,  154,  155,  162,  163,  164,  165,
+ /*   520 */   166,  167,  168,   23,  170,  171,  172,  173,    1,  175,
+ /*   530 */   176,    1,  132,  179,  180,  135,   21,  183,  184,  185,
+ /*   540 */   186,  187,  188,  189,  190,  191,  192,  193,  194,  195,
+ /*   550 */   196,  127,    1,  129,  130,  131,  132,   90,    1,  159,
+ /*   560 */     1,    1,  162,  163,  164,  165,  166,  143,   41,  145,
+ /*   570 */    23,   41,    1,  149,   79,   80,   81,   82,   83,   84,
+ /*   580 */   156,   86,   87,  159,    1,   21,  162,  163,  164,  165,
+ /*   590 */   166,    1,  168,    1,  170,  171,  172,  173,   41,  175,
+ /*   600 */   176,   41,   43,  179,  180,  132,    1,  183,  184,  185,
+ /*   610 */   186,  187,  188,  189,  190,  191,  192,  193,  194,  195,
+ /*   620 */   196,   43,  141,  142,   46,  127,   43,  129,  130,  131,
+ /*   630 */   132,   41,  159,   41,   90,  162,  163,  164,  165,  166,
+ /*   640 */     1,  143,    1,  145,  141,  142,   40,  149,   43,   23,
+ /*   650 */     2,   90,   46,   18,  156,   17,   16,  159,   15,   46,
+ /*   660 */   162,  163,  164,  165,  166,   40,  168,   46,  170,  171,
+ /*   670 */   172,  173,   41,  175,  176,  132,   46,  179,  180,   46,
+ /*   680 */    41,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*   690 */   192,  193,  194,  195,  196,  127,   40,  129,  130,  131,
+ /*   700 */   132,   53,  159,   41,   68,  162,  163,  164,  165,  166,
+ /*   710 */     1,  143,   43,  145,   69,   65,   46,  149,   46,   46,
+ /*   720 */    43,   43,   43,   40,  156,   41,   39,  159,   39,   41,
+ /*   730 */   162,  163,  164,  165,  166,   39,  168,   90,  170,  171,
+ /*   740 */   172,  173,   90,  175,  176,   39,   39,  179,  180,  132,
+ /*   750 */    39,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*   760 */   192,  193,  194,  195,  196,  108,   39,  108,   39,  127,
+ /*   770 */    39,  129,  130,  131,  132,  108,  159,   39,  114,  162,
+ /*   780 */   163,  164,  165,  166,  108,  143,   39,  145,  114,   40,
+ /*   790 */    42,  149,  101,   43,   40,   40,   40,   65,  156,   53,
+ /*   800 */    40,  159,   41,   46,  162,  163,  164,  165,  166,    1,
+ /*   810 */   168,   46,  170,  171,  172,  173,   46,  175,  176,   51,
+ /*   820 */    49,  179,  180,   46,   40,  183,  184,  185,  186,  187,
+ /*   830 */   188,  189,  190,  191,  192,  193,  194,  195,  196,  127,
+ /*   840 */    41,  129,  130,  131,  132,   40,  133,   46,  133,  181,
+ /*   850 */   155,   53,  181,  154,    2,  143,   53,  145,  142,  136,
+ /*   860 */    53,  149,  129,  177,   40,   65,  136,  142,  156,  129,
+ /*   870 */   142,  159,  136,  159,  162,  163,  164,  165,  166,  142,
+ /*   880 */   168,  142,  170,  171,  172,  173,  178,  175,  176,  169,
+ /*   890 */    53,  179,  180,  159,   46,  183,  184,  185,  186,  187,
+ /*   900 */   188,  189,  190,  191,  192,  193,  194,  195,  196,  197,
+ /*   910 */   197,  197,  197,  127,  197,  129,  130,  131,  132,  197,
+ /*   920 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  143,
+ /*   930 */   197,  145,  197,  197,  197,  149,  197,  197,  197,  197,
+ /*   940 */   197,  197,  156,  197,  197,  159,  197,  197,  162,  163,
+ /*   950 */   164,  165,  166,  197,  168,  197,  170,  171,  172,  173,
+ /*   960 */   197,  175,  176,  197,  197,  179,  180,  197,  197,  183,
+ /*   970 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*   980 */   194,  195,  196,  127,  197,  129,  130,  131,  132,  197,
+ /*   990 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  143,
+ /*  1000 */   197,  145,  197,  197,  197,  149,  197,  197,  197,  197,
+ /*  1010 */   197,  197,  156,  197,  197,  159,  197,  197,  162,  163,
+ /*  1020 */   164,  165,  166,  197,  168,  197,  170,  171,  172,  173,
+ /*  1030 */   197,  175,  176,  197,  197,  179,  180,  197,  197,  183,
+ /*  1040 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*  1050 */   194,  195,  196,  197,  197,  197,  197,  127,  197,  129,
+ /*  1060 */   130,  131,  132,  197,  197,  197,  197,  197,  197,  197,
+ /*  1070 */   197,  197,  197,  143,  197,  145,  197,  197,  197,  149,
+ /*  1080 */   197,  197,  197,  197,  197,  197,  156,  197,  197,  159,
+ /*  1090 */   197,  197,  162,  163,  164,  165,  166,  197,  168,  197,
+ /*  1100 */   170,  171,  172,  173,  197,  175,  176,  197,  197,  179,
+ /*  1110 */   180,  197,  197,  183,  184,  185,  186,  187,  188,  189,
+ /*  1120 */   190,  191,  192,  193,  194,  195,  196,  127,  197,  129,
+ /*  1130 */   130,  131,  132,  197,  197,  197,  197,  197,  197,  197,
+ /*  1140 */   197,  197,  197,  143,  197,  145,  197,  197,  197,  149,
+ /*  1150 */   197,  197,  197,  197,  197,  197,  156,  197,  197,  159,
+ /*  1160 */   197,  197,  162,  163,  164,  165,  166,  197,  168,  197,
+ /*  1170 */   170,  171,  172,  173,  197,  175,  176,  197,  197,  179,
+ /*  1180 */   180,  197,  197,  183,  184,  185,  186,  187,  188,  189,
+ /*  1190 */   190,  191,  192,  193,  194,  195,  196,  197,  197,  197,
+ /*  1200 */   197,  127,  197,  129,  130,  131,  132,  197,  197,  197,
+ /*  1210 */   197,  197,  197,  197,  197,  197,  197,  143,  197,  145,
+ /*  1220 */   197,  197,  197,  149,  197,  197,  197,  197,  197,  197,
+ /*  1230 */   156,  197,  197,  159,  197,  197,  162,  163,  164,  165,
+ /*  1240 */   166,  197,  168,  197,  170,  171,  172,  173,  197,  175,
+ /*  1250 */   176,  197,  197,  179,  180,  197,  197,  183,  184,  185,
+ /*  1260 */   186,  187,  188,  189,  190,  191,  192,  193,  194,  195,
+ /*  1270 */   196,  127,  197,  129,  130,  131,  132,  197,  197,  197,
+ /*  1280 */   197,  197,  197,  197,  197,  197,  197,  143,  197,  145,
+ /*  1290 */   197,  197,  197,  149,  197,  197,  197,  197,  197,  197,
+ /*  1300 */   156,  197,  197,  159,  197,  197,  162,  163,  164,  165,
+ /*  1310 */   166,  197,  168,  197,  170,  171,  172,  173,  197,  175,
+ /*  1320 */   176,  197,  197,  179,  180,  197,  197,  183,  184,  185,
+ /*  1330 */   186,  187,  188,  189,  190,  191,  192,  193,  194,  195,
+ /*  1340 */   196,  197,  197,  197,  197,  127,  197,  129,  130,  131,
+ /*  1350 */   132,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  1360 */   197,  143,  197,  145,  197,  197,  197,  149,  197,  197,
+ /*  1370 */   197,  197,  197,  197,  156,  197,  197,  159,  197,  197,
+ /*  1380 */   162,  163,  164,  165,  166,  197,  168,  197,  170,  171,
+ /*  1390 */   172,  173,  197,  175,  176,  197,  197,  179,  180,  197,
+ /*  1400 */   197,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  1410 */   192,  193,  194,  195,  196,  127,  197,  129,  130,  131,
+ /*  1420 */   132,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  1430 */   197,  143,  197,  145,  197,  197,  197,  149,  197,  197,
+ /*  1440 */   197,  197,  197,  197,  156,  197,  197,  159,  197,  197,
+ /*  1450 */   162,  163,  164,  165,  166,  197,  168,  197,  170,  171,
+ /*  1460 */   172,  173,  197,  175,  176,  197,  197,  179,  180,  197,
+ /*  1470 */   197,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  1480 */   192,  193,  194,  195,  196,  197,  197,  197,  197,  127,
+ /*  1490 */   197,  129,  130,  131,  132,  197,  197,  197,  197,  197,
+ /*  1500 */   197,  197,  197,  197,  197,  143,  197,  145,  197,  197,
+ /*  1510 */   197,  149,  197,  197,  197,  197,  197,  197,  156,  197,
+ /*  1520 */   197,  159,  197,  197,  162,  163,  164,  165,  166,  197,
+ /*  1530 */   168,  197,  170,  171,  172,  173,  197,  175,  176,  197,
+ /*  1540 */   197,  179,  180,  197,  197,  183,  184,  185,  186,  187,
+ /*  1550 */   188,  189,  190,  191,  192,  193,  194,  195,  196,  127,
+ /*  1560 */   197,  129,  130,  131,  132,  197,  197,  197,  197,  197,
+ /*  1570 */   197,  197,  197,  197,  197,  143,  197,  145,  197,  197,
+ /*  1580 */   197,  149,  197,  197,  197,  197,  197,  197,  156,  197,
+ /*  1590 */   197,  159,  197,  197,  162,  163,  164,  165,  166,  197,
+ /*  1600 */   168,  197,  170,  171,  172,  173,  197,  175,  176,  197,
+ /*  1610 */   197,  179,  180,  197,  197,  183,  184,  185,  186,  187,
+ /*  1620 */   188,  189,  190,  191,  192,  193,  194,  195,  196,  197,
+ /*  1630 */   197,  197,  197,  127,  197,  129,  130,  131,  132,  197,
+ /*  1640 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  143,
+ /*  1650 */   197,  145,  197,  197,  197,  149,  197,  197,  197,  197,
+ /*  1660 */   197,  197,  156,  197,  197,  159,  197,  197,  162,  163,
+ /*  1670 */   164,  165,  166,  197,  168,  197,  170,  171,  172,  173,
+ /*  1680 */   197,  175,  176,  197,  197,  179,  180,  197,  197,  183,
+ /*  1690 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*  1700 */   194,  195,  196,  127,  197,  129,  130,  131,  132,  197,
+ /*  1710 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  143,
+ /*  1720 */   197,  145,  197,  197,  197,  149,  197,  197,  197,  197,
+ /*  1730 */   197,  197,  156,    0,  197,  159,  197,  197,  162,  163,
+ /*  1740 */   164,  165,  166,  197,  168,  197,  170,  171,  172,  173,
+ /*  1750 */   197,  175,  176,  197,  197,  179,  180,  197,  197,  183,
+ /*  1760 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*  1770 */   194,  195,  196,  197,  197,  197,  197,   44,   45,  197,
+ /*  1780 */    47,   48,  197,  197,  197,   52,  197,  197,  197,   56,
+ /*  1790 */   197,  197,   59,   60,   61,   62,   63,   64,  197,  197,
+ /*  1800 */    67,  197,  197,   70,   71,   72,   73,   74,   75,   76,
+ /*  1810 */    77,   78,   79,   80,   81,   82,   83,   84,   85,   86,
+ /*  1820 */    87,   88,   89,  197,   91,   27,   28,  197,  197,  197,
+ /*  1830 */   197,   33,   34,   35,   36,  197,  197,   39,   40,  197,
+ /*  1840 */   197,  197,  197,  197,   46,  197,  197,   27,   28,  197,
+ /*  1850 */   197,  197,  197,   33,   34,   35,   36,  197,  197,  197,
+ /*  1860 */    40,   41,  197,  197,  197,  197,   46,  197,   70,   71,
+ /*  1870 */    72,   73,   74,   75,   76,   77,   78,   79,   80,   81,
+ /*  1880 */    82,   83,   84,   85,   86,   87,   88,   89,   90,   91,
+ /*  1890 */    70,   71,   72,   73,   74,   75,   76,   77,   78,   79,
+ /*  1900 */    80,   81,   82,   83,   84,   85,   86,   87,   88,   89,
+ /*  1910 */    90,   91,  197,  197,  197,   27,   28,  119,  120,  121,
+ /*  1920 */   122,   33,   34,   35,   36,  197,  197,  197,   40,  197,
+ /*  1930 */   197,   43,  197,  197,   46,  197,  197,   27,   28,  119,
+ /*  1940 */   120,  121,  122,   33,   34,   35,   36,  197,  197,  197,
+ /*  1950 */    40,  197,  197,   43,  197,  197,   46,  197,   70,   71,
+ /*  1960 */    72,   73,   74,   75,   76,   77,   78,   79,   80,   81,
+ /*  1970 */    82,   83,   84,   85,   86,   87,   88,   89,   90,   91,
+ /*  1980 */    70,   71,   72,   73,   74,   75,   76,   77,   78,   79,
+ /*  1990 */    80,   81,   82,   83,   84,   85,   86,   87,   88,   89,
+ /*  2000 */    90,   91,  197,  197,  197,   27,   28,  119,  120,  121,
+ /*  2010 */   122,   33,   34,   35,   36,  197,  197,  197,   40,   41,
+ /*  2020 */   197,  197,  197,  197,   46,  197,  197,   27,   28,  119,
+ /*  2030 */   120,  121,  122,   33,   34,   35,   36,  197,  197,  197,
+ /*  2040 */    40,   41,  197,  197,  197,  197,   46,  197,   70,   71,
+ /*  2050 */    72,   73,   74,   75,   76,   77,   78,   79,   80,   81,
+ /*  2060 */    82,   83,   84,   85,   86,   87,   88,   89,   90,   91,
+ /*  2070 */    70,   71,   72,   73,   74,   75,   76,   77,   78,   79,
+ /*  2080 */    80,   81,   82,   83,   84,   85,   86,   87,   88,   89,
+ /*  2090 */    90,   91,  197,  197,  197,   27,   28,  119,  120,  121,
+ /*  2100 */   122,   33,   34,   35,   36,  197,  197,  197,   40,  197,
+ /*  2110 */   197,   43,  197,  197,   46,  197,  197,   27,   28,  119,
+ /*  2120 */   120,  121,  122,   33,   34,   35,   36,  197,  197,  197,
+ /*  2130 */    40,   41,  197,  197,  197,  197,   46,  197,   70,   71,
+ /*  2140 */    72,   73,   74,   75,   76,   77,   78,   79,   80,   81,
+ /*  2150 */    82,   83,   84,   85,   86,   87,   88,   89,   90,   91,
+ /*  2160 */    70,   71,   72,   73,   74,   75,   76,   77,   78,   79,
+ /*  2170 */    80,   81,   82,   83,   84,   85,   86,   87,   88,   89,
+ /*  2180 */    90,   91,  197,  197,  197,   27,   28,  119,  120,  121,
+ /*  2190 */   122,   33,   34,   35,   36,  197,  197,  197,   40,   41,
+ /*  2200 */   197,  197,  197,  197,   46,  197,  197,   27,   28,  119,
+ /*  2210 */   120,  121,  122,   33,   34,   35,   36,  197,  197,  197,
+ /*  2220 */    40,  197,  197,   43,  197,  197,   46,  197,   70,   71,
+ /*  2230 */    72,   73,   74,   75,   76,   77,   78,   79,   80,   81,
+ /*  2240 */    82,   83,   84,   85,   86,   87,   88,   89,   90,   91,
+ /*  2250 */    70,   71,   72,   73,   74,   75,   76,   77,   78,   79,
+ /*  2260 */    80,   81,   82,   83,   84,   85,   86,   87,   88,   89,
+ /*  2270 */    90,   91,  197,  197,  197,   27,   28,  119,  120,  121,
+ /*  2280 */   122,   33,   34,   35,   36,  197,  197,  197,   40,   41,
+ /*  2290 */   197,  197,  197,  197,   46,  197,  197,   27,   28,  119,
+ /*  2300 */   120,  121,  122,   33,   34,   35,   36,  197,  197,  197,
+ /*  2310 */    40,   41,  197,  197,  197,  197,   46,  197,   70,   71,
+ /*  2320 */    72,   73,   74,   75,   76,   77,   78,   79,   80,   81,
+ /*  2330 */    82,   83,   84,   85,   86,   87,   88,   89,   90,   91,
+ /*  2340 */    70,   71,   72,   73,   74,   75,   76,   77,   78,   79,
+ /*  2350 */    80,   81,   82,   83,   84,   85,   86,   87,   88,   89,
+ /*  2360 */    90,   91,  197,  197,  197,   27,   28,  119,  120,  121,
+ /*  2370 */   122,   33,   34,   35,   36,  197,  197,  197,   40,  197,
+ /*  2380 */   197,  197,  197,  197,   46,  197,  197,  197,  197,  119,
+ /*  2390 */   120,  121,  122,  197,  197,  197,  197,  197,  197,  197,
+ /*  2400 */   197,  197,  197,   65,  197,  197,  197,  197,   70,   71,
+ /*  2410 */    72,   73,   74,   75,   76,   77,   78,   79,   80,   81,
+ /*  2420 */    82,   83,   84,   85,   86,   87,   88,   89,   90,   91,
+ /*  2430 */   197,   27,   28,  197,  132,  197,  197,   33,   34,   35,
+ /*  2440 */    36,  197,  197,  141,   40,  197,  197,  197,  197,  197,
+ /*  2450 */    46,  197,  150,  151,  152,  197,  197,  119,  120,  121,
+ /*  2460 */   122,  159,  197,  197,  162,  163,  164,  165,  166,   65,
+ /*  2470 */   197,  197,  197,  197,   70,   71,   72,   73,   74,   75,
+ /*  2480 */    76,   77,   78,   79,   80,   81,   82,   83,   84,   85,
+ /*  2490 */    86,   87,   88,   89,   90,   91,  197,   27,   28,  197,
+ /*  2500 */   197,  197,  197,   33,   34,   35,   36,  197,  197,  197,
+ /*  2510 */    40,  197,  197,  197,  197,  197,   46,  197,  197,  197,
+ /*  2520 */   197,  197,  197,  119,  120,  121,  122,    2,    3,    4,
+ /*  2530 */     5,    6,    7,    8,    9,   10,   11,   12,  197,  197,
+ /*  2540 */    70,   71,   72,   73,   74,   75,   76,   77,   78,   79,
+ /*  2550 */    80,   81,   82,   83,   84,   85,   86,   87,   88,   89,
+ /*  2560 */    90,   91,  197,  197,  197,  197,  197,  197,   27,   28,
+ /*  2570 */   197,  132,  197,  197,   33,   34,   35,   36,  139,  140,
+ /*  2580 */   197,   40,  197,  197,  197,  197,  197,   46,  197,  119,
+ /*  2590 */   120,  121,  122,  197,  197,  197,  197,  197,  159,  197,
+ /*  2600 */   197,  162,  163,  164,  165,  166,  197,  197,  197,  197,
+ /*  2610 */   197,   70,   71,   72,   73,   74,   75,   76,   77,   78,
+ /*  2620 */    79,   80,   81,   82,   83,   84,   85,   86,   87,   88,
+ /*  2630 */    89,   90,   91,  197,   92,   93,   94,   95,   96,   97,
+ /*  2640 */   197,  197,  197,  197,  197,  103,  104,  197,  197,  107,
+ /*  2650 */   197,  109,  110,  111,  112,  113,  197,  115,  116,  197,
+ /*  2660 */   119,  120,  121,  122,   44,   45,  197,   47,   48,  197,
+ /*  2670 */   197,  197,   52,  197,  197,  197,   56,  197,  197,   59,
+ /*  2680 */    60,   61,   62,   63,   64,  197,  197,   67,  197,  197,
+ /*  2690 */    70,   71,   72,   73,   74,   75,   76,   77,   78,   79,
+ /*  2700 */    80,   81,   82,   83,   84,   85,   86,   87,   88,   89,
+ /*  2710 */    45,   91,  197,  197,  197,  197,  197,   52,  197,  197,
+ /*  2720 */   197,   56,  197,  197,   59,   60,   61,   62,   63,   64,
+ /*  2730 */   197,  197,  197,  197,  197,   70,   71,   72,   73,   74,
+ /*  2740 */    75,   76,   77,   78,   79,   80,   81,   82,   83,   84,
+ /*  2750 */    85,   86,   87,   88,   89,  127,   91,  197,  197,  131,
+ /*  2760 */   132,  197,  197,  197,  197,  197,  197,  197,  197,  132,
+ /*  2770 */   197,  143,  197,  145,  197,  197,  197,  149,  141,  197,
+ /*  2780 */   197,  197,  197,  197,  156,  197,  197,  159,  151,  152,
+ /*  2790 */   162,  163,  164,  165,  166,  197,  159,  197,  197,  162,
+ /*  2800 */   163,  164,  165,  166,  197,  197,  197,  179,  180,  197,
+ /*  2810 */   197,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  2820 */   192,  193,  194,  195,  196,  197,   54,   55,   56,   57,
+ /*  2830 */    58,  197,  197,  197,  197,  197,  197,  197,   66,  197,
+ /*  2840 */   197,  197,   70,   71,   72,   73,   74,   75,   76,   77,
+ /*  2850 */    78,   79,   80,   81,   82,   83,   84,   85,   86,   87,
+ /*  2860 */    88,   89,  197,   91,  197,  197,   54,   55,   56,   57,
+ /*  2870 */    58,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  2880 */   197,  197,   70,   71,   72,   73,   74,   75,   76,   77,
+ /*  2890 */    78,   79,   80,   81,   82,   83,   84,   85,   86,   87,
+ /*  2900 */    88,   89,   47,   91,   49,   50,   51,   52,  197,  197,
+ /*  2910 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  2920 */   197,  197,  197,  197,  197,   70,   71,   72,   73,   74,
+ /*  2930 */    75,   76,   77,   78,   79,   80,   81,   82,   83,   84,
+ /*  2940 */    85,   86,   87,   88,   89,  197,   91,   49,   50,   51,
+ /*  2950 */    52,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  2960 */   197,  197,  197,  197,  197,  197,  197,  197,   70,   71,
+ /*  2970 */    72,   73,   74,   75,   76,   77,   78,   79,   80,   81,
+ /*  2980 */    82,   83,   84,   85,   86,   87,   88,   89,  132,   91,
+ /*  2990 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  3000 */   132,  197,  197,  197,  197,  137,  138,  139,  140,  197,
+ /*  3010 */   197,  197,  156,  197,  197,  159,  197,  161,  162,  163,
+ /*  3020 */   164,  165,  166,  197,  197,  197,  197,  159,  197,  132,
+ /*  3030 */   162,  163,  164,  165,  166,  179,  180,  197,  197,  183,
+ /*  3040 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*  3050 */   194,  195,  196,  156,  197,  197,  159,  160,  197,  162,
+ /*  3060 */   163,  164,  165,  166,  197,  197,  197,  197,  197,  197,
+ /*  3070 */   132,  197,  197,  197,  197,  197,  179,  180,  197,  197,
+ /*  3080 */   183,  184,  185,  186,  187,  188,  189,  190,  191,  192,
+ /*  3090 */   193,  194,  195,  196,  156,  197,  197,  159,  160,  197,
+ /*  3100 */   162,  163,  164,  165,  166,  197,  197,  197,  197,  197,
+ /*  3110 */   197,  132,  197,  197,  197,  197,  197,  179,  180,  197,
+ /*  3120 */   197,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  3130 */   192,  193,  194,  195,  196,  156,  197,  197,  159,  160,
+ /*  3140 */   197,  162,  163,  164,  165,  166,  197,  197,  197,  197,
+ /*  3150 */   197,  197,  132,  197,  197,  197,  197,  197,  179,  180,
+ /*  3160 */   197,  197,  183,  184,  185,  186,  187,  188,  189,  190,
+ /*  3170 */   191,  192,  193,  194,  195,  196,  156,  197,  197,  159,
+ /*  3180 */   197,  197,  162,  163,  164,  165,  166,  197,  197,  197,
+ /*  3190 */   197,  197,  197,  132,  197,  197,  197,  197,  197,  179,
+ /*  3200 */   180,  197,  197,  183,  184,  185,  186,  187,  188,  189,
+ /*  3210 */   190,  191,  192,  193,  194,  195,  196,  156,  197,  197,
+ /*  3220 */   159,  197,  197,  162,  163,  164,  165,  166,  197,  197,
+ /*  3230 */   197,  197,  197,  197,  132,  197,  197,  197,  197,  197,
+ /*  3240 */   179,  180,  197,  197,  183,  184,  185,  186,  187,  188,
+ /*  3250 */   189,  190,  191,  192,  193,  194,  195,  196,  156,  197,
+ /*  3260 */   197,  159,  197,  197,  162,  163,  164,  165,  166,  197,
+ /*  3270 */   197,  197,  197,  197,  197,  132,  197,  197,  197,  197,
+ /*  3280 */   197,  179,  180,  197,  197,  183,  184,  185,  186,  187,
+ /*  3290 */   188,  189,  190,  191,  192,  193,  194,  195,  196,  156,
+ /*  3300 */   197,  197,  159,  197,  197,  162,  163,  164,  165,  166,
+ /*  3310 */   197,  197,  197,  197,  197,  197,  132,  197,  197,  197,
+ /*  3320 */   197,  197,  179,  180,  197,  197,  183,  184,  185,  186,
+ /*  3330 */   187,  188,  189,  190,  191,  192,  193,  194,  195,  196,
+ /*  3340 */   156,  197,  197,  159,  197,  197,  162,  163,  164,  165,
+ /*  3350 */   166,  197,  197,  197,  197,  197,  197,  132,  197,  197,
+ /*  3360 */   197,  197,  197,  179,  180,  197,  197,  183,  184,  185,
+ /*  3370 */   186,  187,  188,  189,  190,  191,  192,  193,  194,  195,
+ /*  3380 */   196,  156,  197,  197,  159,  197,  197,  162,  163,  164,
+ /*  3390 */   165,  166,  197,  197,  197,  197,  197,  197,  132,  197,
+ /*  3400 */   197,  197,  197,  197,  179,  180,  197,  197,  183,  184,
+ /*  3410 */   185,  186,  187,  188,  189,  190,  191,  192,  193,  194,
+ /*  3420 */   195,  196,  156,  197,  197,  159,  197,  197,  162,  163,
+ /*  3430 */   164,  165,  166,  197,  197,  197,  197,  197,  197,  132,
+ /*  3440 */   197,  197,  197,  197,  197,  179,  180,  197,  197,  183,
+ /*  3450 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*  3460 */   194,  195,  196,  156,  197,  197,  159,  197,  197,  162,
+ /*  3470 */   163,  164,  165,  166,  197,  197,  197,  197,  197,  197,
+ /*  3480 */   132,  197,  197,  197,  197,  197,  179,  180,  197,  197,
+ /*  3490 */   183,  184,  185,  186,  187,  188,  189,  190,  191,  192,
+ /*  3500 */   193,  194,  195,  196,  156,  197,  197,  159,  197,  197,
+ /*  3510 */   162,  163,  164,  165,  166,  197,  197,  197,  197,  197,
+ /*  3520 */   132,  197,  197,  197,  197,  197,  197,  179,  180,  197,
+ /*  3530 */   197,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  3540 */   192,  193,  194,  195,  196,  197,  197,  159,  197,  197,
+ /*  3550 */   162,  163,  164,  165,  166,  197,  197,  197,  197,  197,
+ /*  3560 */   197,  132,  197,  197,  197,  197,  197,  179,  180,  197,
+ /*  3570 */   182,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  3580 */   192,  193,  194,  195,  196,  156,  197,  197,  159,  197,
+ /*  3590 */   197,  162,  163,  164,  165,  166,  197,  197,  197,  197,
+ /*  3600 */   197,  197,  132,  197,  197,  197,  197,  197,  179,  180,
+ /*  3610 */   197,  197,  183,  184,  185,  186,  187,  188,  189,  190,
+ /*  3620 */   191,  192,  193,  194,  195,  196,  156,  197,  197,  159,
+ /*  3630 */   197,  197,  162,  163,  164,  165,  166,  197,  197,  197,
+ /*  3640 */   197,  197,  197,  132,  197,  197,  197,  197,  197,  179,
+ /*  3650 */   180,  197,  197,  183,  184,  185,  186,  187,  188,  189,
+ /*  3660 */   190,  191,  192,  193,  194,  195,  196,  156,  197,  197,
+ /*  3670 */   159,  197,  197,  162,  163,  164,  165,  166,  197,  197,
+ /*  3680 */   197,  197,  197,  197,  132,  197,  197,  197,  197,  197,
+ /*  3690 */   179,  180,  197,  197,  183,  184,  185,  186,  187,  188,
+ /*  3700 */   189,  190,  191,  192,  193,  194,  195,  196,  156,  197,
+ /*  3710 */   197,  159,  197,  197,  162,  163,  164,  165,  166,  197,
+ /*  3720 */   197,  197,  197,  197,  197,  132,  197,  197,  197,  197,
+ /*  3730 */   197,  179,  180,  197,  197,  183,  184,  185,  186,  187,
+ /*  3740 */   188,  189,  190,  191,  192,  193,  194,  195,  196,  156,
+ /*  3750 */   197,  197,  159,  197,  197,  162,  163,  164,  165,  166,
+ /*  3760 */   197,  197,  197,  197,  197,  197,  132,  197,  197,  197,
+ /*  3770 */   197,  197,  179,  180,  197,  197,  183,  184,  185,  186,
+ /*  3780 */   187,  188,  189,  190,  191,  192,  193,  194,  195,  196,
+ /*  3790 */   156,  197,  197,  159,  197,  197,  162,  163,  164,  165,
+ /*  3800 */   166,  197,  197,  197,  197,  197,  197,  132,  197,  197,
+ /*  3810 */   197,  197,  197,  179,  180,  197,  197,  183,  184,  185,
+ /*  3820 */   186,  187,  188,  189,  190,  191,  192,  193,  194,  195,
+ /*  3830 */   196,  156,  197,  197,  159,  197,  197,  162,  163,  164,
+ /*  3840 */   165,  166,  197,  197,  197,  197,  197,  197,  132,  197,
+ /*  3850 */   197,  197,  197,  197,  179,  180,  197,  197,  183,  184,
+ /*  3860 */   185,  186,  187,  188,  189,  190,  191,  192,  193,  194,
+ /*  3870 */   195,  196,  156,  197,  197,  159,  197,  197,  162,  163,
+ /*  3880 */   164,  165,  166,  197,  197,  197,  197,  197,  197,  132,
+ /*  3890 */   197,  197,  197,  197,  197,  179,  180,  197,  197,  183,
+ /*  3900 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*  3910 */   194,  195,  196,  156,  197,  197,  159,  197,  197,  162,
+ /*  3920 */   163,  164,  165,  166,  197,  197,  197,  197,  197,  197,
+ /*  3930 */   132,  197,  197,  197,  197,  197,  179,  180,  197,  197,
+ /*  3940 */   183,  184,  185,  186,  187,  188,  189,  190,  191,  192,
+ /*  3950 */   193,  194,  195,  196,  156,  197,  197,  159,  197,  197,
+ /*  3960 */   162,  163,  164,  165,  166,  197,  197,  197,  197,  197,
+ /*  3970 */   132,  197,  197,  197,  197,  197,  197,  179,  180,  197,
+ /*  3980 */   197,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  3990 */   192,  193,  194,  195,  196,  197,  197,  159,  197,  197,
+ /*  4000 */   162,  163,  164,  165,  166,  197,  197,  197,  132,  197,
+ /*  4010 */   197,  197,  197,  197,  197,  197,  197,  179,  180,  197,
+ /*  4020 */   197,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  4030 */   192,  193,  194,  195,  196,  159,  197,  197,  162,  163,
+ /*  4040 */   164,  165,  166,  197,  197,  197,  132,  197,  197,  197,
+ /*  4050 */   197,  197,  197,  197,  197,  179,  180,  197,  197,  183,
+ /*  4060 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*  4070 */   194,  195,  196,  159,  197,  197,  162,  163,  164,  165,
+ /*  4080 */   166,  197,  197,  197,  132,  197,  197,  197,  197,  197,
+ /*  4090 */   197,  197,  197,  179,  180,  197,  197,  183,  184,  185,
+ /*  4100 */   186,  187,  188,  189,  190,  191,  192,  193,  194,  195,
+ /*  4110 */   196,  159,  197,  197,  162,  163,  164,  165,  166,  197,
+ /*  4120 */   197,  197,  132,  197,  197,  197,  197,  197,  197,  197,
+ /*  4130 */   197,  179,  180,  197,  197,  183,  184,  185,  186,  187,
+ /*  4140 */   188,  189,  190,  191,  192,  193,  194,  195,  196,  159,
+ /*  4150 */   197,  197,  162,  163,  164,  165,  166,  197,  197,  197,
+ /*  4160 */   132,  197,  197,  197,  197,  197,  197,  197,  197,  179,
+ /*  4170 */   180,  197,  197,  183,  184,  185,  186,  187,  188,  189,
+ /*  4180 */   190,  191,  192,  193,  194,  195,  196,  159,  197,  197,
+ /*  4190 */   162,  163,  164,  165,  166,  197,  197,  197,  132,  197,
+ /*  4200 */   197,  197,  197,  197,  197,  197,  197,  179,  180,  197,
+ /*  4210 */   197,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  4220 */   192,  193,  194,  195,  196,  159,  197,  197,  162,  163,
+ /*  4230 */   164,  165,  166,  197,  197,  197,  132,  197,  197,  197,
+ /*  4240 */   197,  197,  197,  197,  197,  179,  180,  197,  197,  183,
+ /*  4250 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*  4260 */   194,  195,  196,  159,  197,  197,  162,  163,  164,  165,
+ /*  4270 */   166,  197,  197,  197,  132,  197,  197,  197,  197,  197,
+ /*  4280 */   197,  197,  197,  179,  180,  197,  197,  183,  184,  185,
+ /*  4290 */   186,  187,  188,  189,  190,  191,  192,  193,  194,  195,
+ /*  4300 */   196,  159,  197,  197,  162,  163,  164,  165,  166,  197,
+ /*  4310 */   197,  197,  132,  197,  197,  197,  197,  197,  197,  197,
+ /*  4320 */   197,  179,  180,  197,  197,  183,  184,  185,  186,  187,
+ /*  4330 */   188,  189,  190,  191,  192,  193,  194,  195,  196,  159,
+ /*  4340 */   197,  197,  162,  163,  164,  165,  166,  197,  197,  197,
+ /*  4350 */   132,  197,  197,  197,  197,  197,  197,  197,  197,  179,
+ /*  4360 */   180,  197,  197,  183,  184,  185,  186,  187,  188,  189,
+ /*  4370 */   190,  191,  192,  193,  194,  195,  196,  159,  197,  197,
+ /*  4380 */   162,  163,  164,  165,  166,  197,  197,  197,  132,  197,
+ /*  4390 */   197,  197,  197,  197,  197,  197,  197,  179,  180,  197,
+ /*  4400 */   197,  183,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  4410 */   192,  193,  194,  195,  196,  159,  197,  197,  162,  163,
+ /*  4420 */   164,  165,  166,  197,  197,  197,  132,  197,  197,  197,
+ /*  4430 */   197,  197,  197,  197,  197,  179,  180,  197,  197,  183,
+ /*  4440 */   184,  185,  186,  187,  188,  189,  190,  191,  192,  193,
+ /*  4450 */   194,  195,  196,  159,  197,  197,  162,  163,  164,  165,
+ /*  4460 */   166,  197,  197,  197,  197,  197,   45,  197,  197,  197,
+ /*  4470 */   197,  197,  197,  179,  180,  197,  197,  183,  184,  185,
+ /*  4480 */   186,  187,  188,  189,  190,  191,  192,  193,  194,  195,
+ /*  4490 */   196,   70,   71,   72,   73,   74,   75,   76,   77,   78,
+ /*  4500 */    79,   80,   81,   82,   83,   84,   85,   86,   87,   88,
+ /*  4510 */    89,  197,   91,  197,   47,  197,  197,  197,  197,  197,
+ /*  4520 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  4530 */   132,  197,  197,  197,  197,  197,  197,   70,   71,   72,
+ /*  4540 */    73,   74,   75,   76,   77,   78,   79,   80,   81,   82,
+ /*  4550 */    83,   84,   85,   86,   87,   88,   89,  159,   91,  197,
+ /*  4560 */   162,  163,  164,  165,  166,  197,  197,  197,  197,  197,
+ /*  4570 */   197,  197,  197,  197,  197,  197,  197,  179,  180,  197,
+ /*  4580 */   197,  197,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  4590 */   192,  193,  194,  195,  196,  197,  197,  197,  197,  197,
+ /*  4600 */   197,   70,   71,   72,   73,   74,   75,   76,   77,   78,
+ /*  4610 */    79,   80,   81,   82,   83,   84,   85,   86,   87,   88,
+ /*  4620 */    89,  132,   91,  197,  124,  125,  126,  127,  128,  197,
+ /*  4630 */   130,  131,  132,  197,  134,  135,  197,  197,  197,  197,
+ /*  4640 */   197,  197,  197,  143,  197,  145,  197,  197,  159,  149,
+ /*  4650 */   197,  162,  163,  164,  165,  166,  197,  197,  197,  159,
+ /*  4660 */   197,  197,  162,  163,  164,  165,  166,  197,  179,  180,
+ /*  4670 */   132,  197,  197,  184,  185,  186,  187,  188,  189,  190,
+ /*  4680 */   191,  192,  193,  194,  195,  197,  197,  197,  197,  197,
+ /*  4690 */   197,  197,  197,  197,  197,  197,  197,  159,  197,  197,
+ /*  4700 */   162,  163,  164,  165,  166,  197,  197,  197,  197,  197,
+ /*  4710 */   132,  197,  197,  197,  197,  197,  197,  179,  180,  197,
+ /*  4720 */   132,  197,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  4730 */   192,  193,  194,  145,  197,  197,  197,  159,  197,  197,
+ /*  4740 */   162,  163,  164,  165,  166,  132,  197,  159,  197,  197,
+ /*  4750 */   162,  163,  164,  165,  166,  197,  197,  179,  180,  197,
+ /*  4760 */   197,  197,  184,  185,  186,  187,  188,  189,  190,  191,
+ /*  4770 */   192,  193,  159,  197,  197,  162,  163,  164,  165,  166,
+ /*  4780 */   197,  132,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  4790 */   197,  197,  179,  180,  197,  197,  197,  184,  185,  186,
+ /*  4800 */   187,  188,  189,  190,  191,  192,  197,  197,  159,  197,
+ /*  4810 */   197,  162,  163,  164,  165,  166,  197,  197,  197,  197,
+ /*  4820 */   197,  197,  197,  197,  197,  197,  197,  197,  179,  180,
+ /*  4830 */   197,  197,  197,  184,  185,  186,  187,  188,  189,  190,
+ /*  4840 */   191,  197,  197,  197,  126,  127,  128,  197,  130,  131,
+ /*  4850 */   132,  197,  134,  135,  197,  197,  197,  197,  132,  197,
+ /*  4860 */   197,  143,  197,  145,  197,  197,  197,  149,  197,  197,
+ /*  4870 */   132,  197,  197,  197,  197,  197,  197,  159,  197,  197,
+ /*  4880 */   162,  163,  164,  165,  166,  159,  197,  197,  162,  163,
+ /*  4890 */   164,  165,  166,  197,  197,  197,  197,  159,  197,  197,
+ /*  4900 */   162,  163,  164,  165,  166,  179,  180,  197,  132,  197,
+ /*  4910 */   184,  185,  186,  187,  188,  189,  190,  179,  180,  197,
+ /*  4920 */   197,  197,  184,  185,  186,  187,  188,  189,  197,  197,
+ /*  4930 */   197,  197,  197,  197,  197,  159,  197,  197,  162,  163,
+ /*  4940 */   164,  165,  166,  197,  132,  197,  197,  197,  197,  197,
+ /*  4950 */   197,  197,  197,  197,  197,  179,  180,  197,  197,  197,
+ /*  4960 */   184,  185,  186,  187,  188,  189,  197,  197,  197,  197,
+ /*  4970 */   197,  159,  197,  197,  162,  163,  164,  165,  166,  132,
+ /*  4980 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  4990 */   197,  179,  180,  197,  197,  197,  184,  185,  186,  187,
+ /*  5000 */   188,  197,  197,  197,  197,  197,  159,  197,  197,  162,
+ /*  5010 */   163,  164,  165,  166,  132,  197,  197,  197,  197,  197,
+ /*  5020 */   197,  197,  197,  197,  132,  197,  179,  180,  197,  197,
+ /*  5030 */   197,  184,  185,  186,  187,  188,  197,  197,  197,  197,
+ /*  5040 */   197,  159,  197,  197,  162,  163,  164,  165,  166,  197,
+ /*  5050 */   197,  159,  197,  197,  162,  163,  164,  165,  166,  132,
+ /*  5060 */   197,  179,  180,  197,  197,  197,  184,  185,  186,  187,
+ /*  5070 */   188,  179,  180,  197,  197,  197,  184,  185,  186,  187,
+ /*  5080 */   188,  197,  197,  197,  197,  197,  159,  197,  132,  162,
+ /*  5090 */   163,  164,  165,  166,  197,  197,  197,  132,  197,  197,
+ /*  5100 */   197,  197,  197,  197,  197,  197,  179,  180,  197,  197,
+ /*  5110 */   197,  184,  185,  186,  187,  159,  197,  197,  162,  163,
+ /*  5120 */   164,  165,  166,  197,  159,  132,  197,  162,  163,  164,
+ /*  5130 */   165,  166,  197,  197,  197,  179,  180,  197,  197,  197,
+ /*  5140 */   184,  185,  186,  187,  179,  180,  197,  197,  197,  184,
+ /*  5150 */   185,  186,  159,  197,  197,  162,  163,  164,  165,  166,
+ /*  5160 */   132,  197,  197,  197,  197,  137,  138,  139,  140,  197,
+ /*  5170 */   197,  197,  179,  180,  132,  197,  197,  184,  185,  186,
+ /*  5180 */   197,  197,  197,  197,  132,  197,  197,  159,  197,  197,
+ /*  5190 */   162,  163,  164,  165,  166,  197,  197,  197,  197,  197,
+ /*  5200 */   197,  159,  197,  197,  162,  163,  164,  165,  166,  197,
+ /*  5210 */   197,  159,  132,  197,  162,  163,  164,  165,  166,  197,
+ /*  5220 */   197,  179,  180,  132,  197,  197,  184,  185,  197,  197,
+ /*  5230 */   197,  179,  180,  197,  197,  197,  184,  185,  197,  159,
+ /*  5240 */   197,  197,  162,  163,  164,  165,  166,  132,  197,  197,
+ /*  5250 */   159,  197,  197,  162,  163,  164,  165,  166,  132,  179,
+ /*  5260 */   180,  197,  197,  197,  184,  185,  197,  197,  197,  197,
+ /*  5270 */   179,  180,  197,  197,  159,  184,  185,  162,  163,  164,
+ /*  5280 */   165,  166,  132,  197,  197,  159,  197,  197,  162,  163,
+ /*  5290 */   164,  165,  166,  132,  179,  180,  197,  197,  197,  184,
+ /*  5300 */   185,  197,  197,  197,  197,  179,  180,  197,  197,  159,
+ /*  5310 */   184,  185,  162,  163,  164,  165,  166,  132,  197,  197,
+ /*  5320 */   159,  197,  197,  162,  163,  164,  165,  166,  197,  179,
+ /*  5330 */   180,  197,  197,  197,  184,  185,  197,  197,  197,  197,
+ /*  5340 */   179,  180,  197,  197,  159,  184,  185,  162,  163,  164,
+ /*  5350 */   165,  166,  197,  197,  132,  197,  197,  197,  197,  197,
+ /*  5360 */   197,  197,  197,  197,  179,  180,  197,  197,  197,  184,
+ /*  5370 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  5380 */   197,  159,  197,  197,  162,  163,  164,  165,  166,  197,
+ /*  5390 */   197,  197,  197,  197,  197,  197,  197,  197,  197,  197,
+ /*  5400 */   197,  179,  180,  197,  197,  197,  184,
+};
+#define YY_SHIFT_USE_DFLT (-76)
+#define YY_SHIFT_COUNT (295)
+#define YY_SHIFT_MIN   (-75)
+#define YY_SHIFT_MAX   (4531)
+static const short yy_shift_ofst[] = {
+ /*     0 */  2620,   63,  153,  153,  -27,  153,  153,  153,  153,  153,
+ /*    10 */   153,  153,  153,  153,  153,  153,  153,  153,  153,  153,
+ /*    20 */   153,  153,  153,  243, 2404, 2404, 2404, 2338, 2270, 2248,
+ /*    30 */  2180, 2158, 2090, 2068, 2000, 1978, 1910, 1888, 1820, 1798,
+ /*    40 */  2541, 2541, 2541, 2541, 2541, 2541, 2541, 2541, 2541, 2541,
+ /*    50 */  2541, 2541, 2541, 2541, 2541, 2541, 2541, 2541, 2541, 2541,
+ /*    60 */  2541, 2541, 2541, 2541, 2541, 2541, 1733, 2541, 2541, 2541,
+ /*    70 */  2541, 2541, 2541, 2541, 2541, 2541, 2541, 2541, 2541, 2541,
+ /*    80 */  2541, 2541, 2541, 2541, 2541, 2541, 2541, 2855, 2855, 2812,
+ /*    90 */  2470, 2470, 2772, 2898, 2665, 4467, 4531, 4421, 4531, 4531,
+ /*   100 */   459,  456,  606,  648,  648,  408,   12,   12,  578,  411,
+ /*   110 */   848,  801,  837,  837,  837,  837,  801,  334,  102,  102,
+ /*   120 */   388,  801,  801, 2542,  408,  408,   14,  330,   45,  807,
+ /*   130 */   852,  852,  852,  852,  807,  824,  800,  807,  852,  803,
+ /*   140 */   798,  801,  805,  805,  801, 2525,  495,   61,   61,   61,
+ /*   150 */   -33,   69,   15,  -75,  200,   -7,   -7,   -7,  -28,  639,
+ /*   160 */   592,  605,  590,  559,  560,  557,  530,  583,  461,  439,
+ /*   170 */   391,  378,  527,  437,  386,  367,  316,  314,  321,  390,
+ /*   180 */   383,  345,  366,  281,  197,  315,  311,  308,  231,  236,
+ /*   190 */   228,  228,   16,   16,   16,   16,   49,   49,   16,   49,
+ /*   200 */   296,  307,  261,  799,  784,  777,  771,  768,  770,  765,
+ /*   210 */   808,  761,  760,  757,  746,  732,  756,  748,  755,  754,
+ /*   220 */   750,  749,  691,  674,  747,  664,  738,  676,  731,  667,
+ /*   230 */   729,  659,  727,  657,  711,  707,  706,  696,  689,  688,
+ /*   240 */   652,  687,  684,  647,  683,  679,  678,  677,  673,  672,
+ /*   250 */   670,  650,  669,  709,  636,  645,  662,  633,  656,  631,
+ /*   260 */   630,  621,  625,  613,  643,  640,  643,  638,  640,  635,
+ /*   270 */   638,  635,  626,  561,  641,  544,  571,  564,  547,  467,
+ /*   280 */   551,  515,  500,  396,  426,   95,  412,  335,  313,  288,
+ /*   290 */   199,  180,  155,   84,   72,   48,
+};
+#define YY_REDUCE_USE_DFLT (-128)
+#define YY_REDUCE_COUNT (144)
+#define YY_REDUCE_MIN   (-127)
+#define YY_REDUCE_MAX   (5222)
+static const short yy_reduce_ofst[] = {
+ /*     0 */  4500,  354,  280,  210,  712,  712, 1576, 1506, 1432, 1362,
+ /*    10 */  1288, 1218, 1144, 1074, 1000,  930,  856,  786,  712,  642,
+ /*    20 */   568,  498,  424, 2628, 2979, 2938, 2897, 2856, 3798, 3757,
+ /*    30 */  3716, 3675, 3634, 3593, 3552, 3511, 3470, 3429, 3388, 3348,
+ /*    40 */  3307, 3266, 3225, 3184, 3143, 3102, 3061, 3020, 4294, 4256,
+ /*    50 */  4218, 4180, 4142, 4104, 4066, 4028, 3990, 3952, 3914, 3876,
+ /*    60 */  3838, 4398, 4489, 4538, 4578, 4613, 4718, 4649, 4726, 4776,
+ /*    70 */  4738, 4892, 4882, 4847, 4812, 4956, 4927, 4993, 4965, 5161,
+ /*    80 */  5150, 5126, 5115, 5091, 5080, 5052, 5042, 5028, 2868, 2302,
+ /*    90 */  5222, 5185, 2637, 2439, 4588,  400,  128,  617,  543,  473,
+ /*   100 */   360, -127,   75,   52,  -37,  -45,  209,  202,   46,   46,
+ /*   110 */   152,   46,  109,   56,   47,   18,  -44,  342,  503,  481,
+ /*   120 */   263,  148,  365,  720,  734,  714,  708,  671,  740,  736,
+ /*   130 */   739,  737,  728,  725,  730,  686,  733,  723,  716,  699,
+ /*   140 */   695,  715,  671,  668,  713,
+};
+static const YYACTIONTYPE yy_default[] = {
+ /*     0 */   812,  812,  740,  738,  812,  739,  812,  812,  812,  812,
+ /*    10 */   812,  812,  812,  812,  812,  812,  812,  812,  737,  812,
+ /*    20 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*    30 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*    40 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*    50 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*    60 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*    70 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*    80 */   812,  812,  812,  812,  812,  812,  812,  543,  543,  812,
+ /*    90 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*   100 */   605,  597,  812,  601,  593,  812,  561,  553,  812,  812,
+ /*   110 */   812,  812,  603,  599,  595,  591,  812,  812,  557,  549,
+ /*   120 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  537,
+ /*   130 */   559,  555,  551,  547,  535,  812,  812,  613,  812,  619,
+ /*   140 */   618,  812,  812,  741,  812,  766,  812,  785,  784,  783,
+ /*   150 */   759,  812,  812,  812,  812,  774,  773,  772,  622,  812,
+ /*   160 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*   170 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*   180 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  796,
+ /*   190 */   787,  786,  782,  781,  780,  779,  777,  776,  778,  775,
+ /*   200 */   812,  812,  812,  812,  812,  812,  564,  562,  812,  812,
+ /*   210 */   542,  812,  812,  812,  812,  812,  812,  688,  812,  812,
+ /*   220 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*   230 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*   240 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*   250 */   812,  812,  812,  630,  812,  812,  812,  812,  812,  812,
+ /*   260 */   812,  812,  812,  812,  795,  793,  794,  791,  792,  789,
+ /*   270 */   790,  788,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*   280 */   812,  812,  812,  812,  812,  812,  812,  812,  812,  812,
+ /*   290 */   812,  812,  812,  812,  812,  622,  525,  540,  536,  539,
+ /*   300 */   544,  567,  566,  563,  565,  560,  558,  556,  554,  552,
+ /*   310 */   550,  548,  546,  545,  541,  538,  534,  531,  530,  735,
+ /*   320 */   717,  716,  718,  715,  711,  710,  709,  708,  713,  712,
+ /*   330 */   714,  734,  729,  722,  707,  706,  702,  701,  697,  696,
+ /*   340 */   695,  694,  693,  692,  691,  672,  736,  690,  689,  687,
+ /*   350 */   686,  684,  733,  732,  728,  727,  726,  725,  730,  724,
+ /*   360 */   731,  723,  721,  705,  700,  720,  704,  699,  719,  703,
+ /*   370 */   698,  683,  679,  678,  677,  676,  675,  674,  682,  681,
+ /*   380 */   680,  673,  671,  670,  607,  608,  611,  614,  615,  612,
+ /*   390 */   610,  609,  606,  573,  572,  571,  570,  569,  577,  685,
+ /*   400 */   576,  575,  587,  586,  585,  584,  583,  582,  581,  580,
+ /*   410 */   579,  578,  588,  604,  602,  600,  598,  627,  629,  628,
+ /*   420 */   626,  596,  594,  635,  634,  633,  632,  631,  592,  617,
+ /*   430 */   616,  590,  625,  624,  623,  568,  589,  574,  533,  811,
+ /*   440 */   757,  758,  756,  755,  767,  754,  753,  752,  760,  810,
+ /*   450 */   809,  808,  807,  806,  805,  804,  803,  802,  801,  800,
+ /*   460 */   799,  798,  797,  771,  770,  769,  768,  766,  765,  764,
+ /*   470 */   763,  762,  761,  751,  749,  748,  747,  746,  745,  744,
+ /*   480 */   743,  742,  750,  669,  668,  667,  666,  665,  664,  663,
+ /*   490 */   662,  661,  660,  659,  658,  657,  656,  655,  654,  653,
+ /*   500 */   652,  651,  650,  649,  648,  647,  646,  645,  644,  643,
+ /*   510 */   642,  641,  640,  639,  638,  637,  636,  621,  620,  532,
+ /*   520 */   529,  528,  527,  526,
+};
+
+/* The next table maps tokens into fallback tokens.  If a construct
+** like the following:
+** 
+**      %fallback ID X Y Z.
+**
+** appears in the grammar, then ID becomes a fallback token for X, Y,
+** and Z.  Whenever one of the tokens X, Y, or Z is input to the parser
+** but it does not parse, the type of the token is changed to ID and
+** the parse is retried before an error is thrown.
+*/
+#ifdef YYFALLBACK
+static const YYCODETYPE yyFallback[] = {
+};
+#endif /* YYFALLBACK */
+
+/* The following structure represents a single element of the
+** parser's stack.  Information stored includes:
+**
+**   +  The state number for the parser at this level of the stack.
+**
+**   +  The value of the token stored at this level of the stack.
+**      (In other words, the "major" token.)
+**
+**   +  The semantic value stored at this level of the stack.  This is
+**      the information used by the action routines in the grammar.
+**      It is sometimes called the "minor" token.
+*/
+struct yyStackEntry {
+  YYACTIONTYPE stateno;  /* The state-number */
+  YYCODETYPE major;      /* The major token value.  This is the code
+                         ** number for the token at this stack level */
+  YYMINORTYPE minor;     /* The user-supplied minor token value.  This
+                         ** is the value of the token  */
+};
+typedef struct yyStackEntry yyStackEntry;
+
+/* The state of the parser is completely contained in an instance of
+** the following structure */
+struct yyParser {
+  int yyidx;                    /* Index of top element in stack */
+#ifdef YYTRACKMAXSTACKDEPTH
+  int yyidxMax;                 /* Maximum value of yyidx */
+#endif
+  int yyerrcnt;                 /* Shifts left before out of the error */
+  ParseHLSLARG_SDECL                /* A place to hold %extra_argument */
+#if YYSTACKDEPTH<=0
+  int yystksz;                  /* Current side of the stack */
+  yyStackEntry *yystack;        /* The parser's stack */
+#else
+  yyStackEntry yystack[YYSTACKDEPTH];  /* The parser's stack */
+#endif
+};
+typedef struct yyParser yyParser;
+
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+#include <stdio.h>
+static FILE *yyTraceFILE = 0;
+static char *yyTracePrompt = 0;
+#endif /* NDEBUG */
+
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+/*
+** Turn parser tracing on by giving a stream to which to write the trace
+** and a prompt to preface each trace message.  Tracing is turned off
+** by making either argument NULL 
+**
+** Inputs:
+** <ul>
+** <li> A FILE* to which trace output should be written.
+**      If NULL, then tracing is turned off.
+** <li> A prefix string written at the beginning of every
+**      line of trace output.  If NULL, then tracing is
+**      turned off.
+** </ul>
+**
+** Outputs:
+** None.
+*/
+#if __MOJOSHADER__
+static
+#endif
+void ParseHLSLTrace(FILE *TraceFILE, char *zTracePrompt){
+  yyTraceFILE = TraceFILE;
+  yyTracePrompt = zTracePrompt;
+  if( yyTraceFILE==0 ) yyTracePrompt = 0;
+  else if( yyTracePrompt==0 ) yyTraceFILE = 0;
+}
+#endif /* NDEBUG */
+
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+/* For tracing shifts, the names of all terminals and nonterminals
+** are required.  The following table supplies these names */
+static const char *const yyTokenName[] = { 
+  "$",             "COMMA",         "ASSIGN",        "ADDASSIGN",   
+  "SUBASSIGN",     "MULASSIGN",     "DIVASSIGN",     "MODASSIGN",   
+  "LSHIFTASSIGN",  "RSHIFTASSIGN",  "ANDASSIGN",     "ORASSIGN",    
+  "XORASSIGN",     "QUESTION",      "OROR",          "ANDAND",      
+  "OR",            "XOR",           "AND",           "EQL",         
+  "NEQ",           "LT",            "LEQ",           "GT",          
+  "GEQ",           "LSHIFT",        "RSHIFT",        "PLUS",        
+  "MINUS",         "STAR",          "SLASH",         "PERCENT",     
+  "TYPECAST",      "EXCLAMATION",   "COMPLEMENT",    "MINUSMINUS",  
+  "PLUSPLUS",      "DOT",           "LBRACKET",      "RBRACKET",    
+  "LPAREN",        "RPAREN",        "ELSE",          "SEMICOLON",   
+  "TYPEDEF",       "CONST",         "IDENTIFIER",    "VOID",        
+  "INLINE",        "IN",            "INOUT",         "OUT",         
+  "UNIFORM",       "COLON",         "LINEAR",        "CENTROID",    
+  "NOINTERPOLATION",  "NOPERSPECTIVE",  "SAMPLE",        "EXTERN",      
+  "SHARED",        "STATIC",        "VOLATILE",      "ROWMAJOR",    
+  "COLUMNMAJOR",   "LBRACE",        "RBRACE",        "STRUCT",      
+  "PACKOFFSET",    "REGISTER",      "USERTYPE",      "SAMPLER",     
+  "SAMPLER1D",     "SAMPLER2D",     "SAMPLER3D",     "SAMPLERCUBE", 
+  "SAMPLER_STATE",  "SAMPLERSTATE",  "SAMPLERCOMPARISONSTATE",  "BOOL",        
+  "INT",           "UINT",          "HALF",          "FLOAT",       
+  "DOUBLE",        "STRING",        "SNORM",         "UNORM",       
+  "BUFFER",        "VECTOR",        "INT_CONSTANT",  "MATRIX",      
+  "ISOLATE",       "MAXINSTRUCTIONCOUNT",  "NOEXPRESSIONOPTIMIZATIONS",  "REMOVEUNUSEDINPUTS",
+  "UNUSED",        "XPS",           "BREAK",         "CONTINUE",    
+  "DISCARD",       "WHILE",         "RETURN",        "UNROLL",      
+  "LOOP",          "FOR",           "DO",            "BRANCH",      
+  "IF",            "FLATTEN",       "IFALL",         "IFANY",       
+  "PREDICATE",     "PREDICATEBLOCK",  "SWITCH",        "FORCECASE",   
+  "CALL",          "CASE",          "DEFAULT",       "FLOAT_CONSTANT",
+  "STRING_LITERAL",  "TRUE",          "FALSE",         "error",       
+  "shader",        "compilation_units",  "compilation_unit",  "variable_declaration",
+  "function_signature",  "statement_block",  "typedef",       "struct_declaration",
+  "datatype",      "scalar_or_array",  "function_storageclass",  "function_details",
+  "semantic",      "function_parameters",  "function_parameter_list",  "function_parameter",
+  "input_modifier",  "interpolation_mod",  "initializer",   "variable_attribute_list",
+  "variable_declaration_details_list",  "variable_attribute",  "variable_declaration_details",  "annotations", 
+  "variable_lowlevel",  "struct_intro",  "struct_member_list",  "struct_member",
+  "struct_member_details",  "struct_member_item_list",  "packoffset",    "register",    
+  "expression",    "annotation_list",  "annotation",    "datatype_scalar",
+  "initializer_block_list",  "initializer_block",  "intrinsic_datatype",  "datatype_vector",
+  "datatype_matrix",  "datatype_sampler",  "datatype_buffer",  "statement_list",
+  "statement",     "statement_attribute",  "do_intro",      "while_intro", 
+  "if_intro",      "switch_intro",  "switch_case_list",  "for_statement",
+  "for_intro",     "for_details",   "switch_case",   "primary_expr",
+  "postfix_expr",  "arguments",     "argument_list",  "assignment_expr",
+  "unary_expr",    "cast_expr",     "multiplicative_expr",  "additive_expr",
+  "shift_expr",    "relational_expr",  "equality_expr",  "and_expr",    
+  "exclusive_or_expr",  "inclusive_or_expr",  "logical_and_expr",  "logical_or_expr",
+  "conditional_expr",
+};
+#endif /* NDEBUG */
+
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+/* For tracing reduce actions, the names of all rules are required.
+*/
+static const char *const yyRuleName[] = {
+ /*   0 */ "shader ::= compilation_units",
+ /*   1 */ "compilation_units ::= compilation_unit",
+ /*   2 */ "compilation_units ::= compilation_units compilation_unit",
+ /*   3 */ "compilation_unit ::= variable_declaration",
+ /*   4 */ "compilation_unit ::= function_signature SEMICOLON",
+ /*   5 */ "compilation_unit ::= function_signature statement_block",
+ /*   6 */ "compilation_unit ::= typedef",
+ /*   7 */ "compilation_unit ::= struct_declaration SEMICOLON",
+ /*   8 */ "typedef ::= TYPEDEF CONST datatype scalar_or_array",
+ /*   9 */ "typedef ::= TYPEDEF datatype scalar_or_array",
+ /*  10 */ "function_signature ::= function_storageclass function_details semantic",
+ /*  11 */ "function_signature ::= function_storageclass function_details",
+ /*  12 */ "function_signature ::= function_details semantic",
+ /*  13 */ "function_signature ::= function_details",
+ /*  14 */ "function_details ::= datatype IDENTIFIER LPAREN function_parameters RPAREN",
+ /*  15 */ "function_details ::= VOID IDENTIFIER LPAREN function_parameters RPAREN",
+ /*  16 */ "function_storageclass ::= INLINE",
+ /*  17 */ "function_parameters ::= VOID",
+ /*  18 */ "function_parameters ::= function_parameter_list",
+ /*  19 */ "function_parameters ::=",
+ /*  20 */ "function_parameter_list ::= function_parameter",
+ /*  21 */ "function_parameter_list ::= function_parameter_list COMMA function_parameter",
+ /*  22 */ "function_parameter ::= input_modifier datatype IDENTIFIER semantic interpolation_mod initializer",
+ /*  23 */ "function_parameter ::= input_modifier datatype IDENTIFIER semantic interpolation_mod",
+ /*  24 */ "function_parameter ::= input_modifier datatype IDENTIFIER semantic initializer",
+ /*  25 */ "function_parameter ::= input_modifier datatype IDENTIFIER semantic",
+ /*  26 */ "function_parameter ::= input_modifier datatype IDENTIFIER interpolation_mod initializer",
+ /*  27 */ "function_parameter ::= input_modifier datatype IDENTIFIER interpolation_mod",
+ /*  28 */ "function_parameter ::= input_modifier datatype IDENTIFIER initializer",
+ /*  29 */ "function_parameter ::= input_modifier datatype IDENTIFIER",
+ /*  30 */ "function_parameter ::= datatype IDENTIFIER semantic interpolation_mod initializer",
+ /*  31 */ "function_parameter ::= datatype IDENTIFIER semantic interpolation_mod",
+ /*  32 */ "function_parameter ::= datatype IDENTIFIER semantic initializer",
+ /*  33 */ "function_parameter ::= datatype IDENTIFIER semantic",
+ /*  34 */ "function_parameter ::= datatype IDENTIFIER interpolation_mod initializer",
+ /*  35 */ "function_parameter ::= datatype IDENTIFIER interpolation_mod",
+ /*  36 */ "function_parameter ::= datatype IDENTIFIER initializer",
+ /*  37 */ "function_parameter ::= datatype IDENTIFIER",
+ /*  38 */ "input_modifier ::= IN",
+ /*  39 */ "input_modifier ::= INOUT",
+ /*  40 */ "input_modifier ::= OUT",
+ /*  41 */ "input_modifier ::= IN OUT",
+ /*  42 */ "input_modifier ::= OUT IN",
+ /*  43 */ "input_modifier ::= UNIFORM",
+ /*  44 */ "semantic ::= COLON IDENTIFIER",
+ /*  45 */ "interpolation_mod ::= LINEAR",
+ /*  46 */ "interpolation_mod ::= CENTROID",
+ /*  47 */ "interpolation_mod ::= NOINTERPOLATION",
+ /*  48 */ "interpolation_mod ::= NOPERSPECTIVE",
+ /*  49 */ "interpolation_mod ::= SAMPLE",
+ /*  50 */ "variable_declaration ::= variable_attribute_list datatype variable_declaration_details_list SEMICOLON",
+ /*  51 */ "variable_declaration ::= datatype variable_declaration_details_list SEMICOLON",
+ /*  52 */ "variable_declaration ::= struct_declaration variable_declaration_details_list SEMICOLON",
+ /*  53 */ "variable_attribute_list ::= variable_attribute",
+ /*  54 */ "variable_attribute_list ::= variable_attribute_list variable_attribute",
+ /*  55 */ "variable_attribute ::= EXTERN",
+ /*  56 */ "variable_attribute ::= NOINTERPOLATION",
+ /*  57 */ "variable_attribute ::= SHARED",
+ /*  58 */ "variable_attribute ::= STATIC",
+ /*  59 */ "variable_attribute ::= UNIFORM",
+ /*  60 */ "variable_attribute ::= VOLATILE",
+ /*  61 */ "variable_attribute ::= CONST",
+ /*  62 */ "variable_attribute ::= ROWMAJOR",
+ /*  63 */ "variable_attribute ::= COLUMNMAJOR",
+ /*  64 */ "variable_declaration_details_list ::= variable_declaration_details",
+ /*  65 */ "variable_declaration_details_list ::= variable_declaration_details_list COMMA variable_declaration_details",
+ /*  66 */ "variable_declaration_details ::= scalar_or_array semantic annotations initializer variable_lowlevel",
+ /*  67 */ "variable_declaration_details ::= scalar_or_array semantic annotations initializer",
+ /*  68 */ "variable_declaration_details ::= scalar_or_array semantic annotations variable_lowlevel",
+ /*  69 */ "variable_declaration_details ::= scalar_or_array semantic annotations",
+ /*  70 */ "variable_declaration_details ::= scalar_or_array semantic initializer variable_lowlevel",
+ /*  71 */ "variable_declaration_details ::= scalar_or_array semantic initializer",
+ /*  72 */ "variable_declaration_details ::= scalar_or_array semantic variable_lowlevel",
+ /*  73 */ "variable_declaration_details ::= scalar_or_array semantic",
+ /*  74 */ "variable_declaration_details ::= scalar_or_array annotations initializer variable_lowlevel",
+ /*  75 */ "variable_declaration_details ::= scalar_or_array annotations initializer",
+ /*  76 */ "variable_declaration_details ::= scalar_or_array annotations variable_lowlevel",
+ /*  77 */ "variable_declaration_details ::= scalar_or_array annotations",
+ /*  78 */ "variable_declaration_details ::= scalar_or_array initializer variable_lowlevel",
+ /*  79 */ "variable_declaration_details ::= scalar_or_array initializer",
+ /*  80 */ "variable_declaration_details ::= scalar_or_array variable_lowlevel",
+ /*  81 */ "variable_declaration_details ::= scalar_or_array",
+ /*  82 */ "struct_declaration ::= struct_intro LBRACE struct_member_list RBRACE",
+ /*  83 */ "struct_intro ::= STRUCT IDENTIFIER",
+ /*  84 */ "struct_member_list ::= struct_member",
+ /*  85 */ "struct_member_list ::= struct_member_list struct_member",
+ /*  86 */ "struct_member ::= interpolation_mod struct_member_details",
+ /*  87 */ "struct_member ::= struct_member_details",
+ /*  88 */ "struct_member_details ::= datatype struct_member_item_list SEMICOLON",
+ /*  89 */ "struct_member_item_list ::= scalar_or_array",
+ /*  90 */ "struct_member_item_list ::= scalar_or_array semantic",
+ /*  91 */ "struct_member_item_list ::= struct_member_item_list COMMA IDENTIFIER",
+ /*  92 */ "variable_lowlevel ::= packoffset register",
+ /*  93 */ "variable_lowlevel ::= register packoffset",
+ /*  94 */ "variable_lowlevel ::= packoffset",
+ /*  95 */ "variable_lowlevel ::= register",
+ /*  96 */ "scalar_or_array ::= IDENTIFIER LBRACKET RBRACKET",
+ /*  97 */ "scalar_or_array ::= IDENTIFIER LBRACKET expression RBRACKET",
+ /*  98 */ "scalar_or_array ::= IDENTIFIER",
+ /*  99 */ "packoffset ::= COLON PACKOFFSET LPAREN IDENTIFIER DOT IDENTIFIER RPAREN",
+ /* 100 */ "packoffset ::= COLON PACKOFFSET LPAREN IDENTIFIER RPAREN",
+ /* 101 */ "register ::= COLON REGISTER LPAREN IDENTIFIER RPAREN",
+ /* 102 */ "annotations ::= LT annotation_list GT",
+ /* 103 */ "annotation_list ::= annotation",
+ /* 104 */ "annotation_list ::= annotation_list annotation",
+ /* 105 */ "annotation ::= datatype_scalar initializer SEMICOLON",
+ /* 106 */ "initializer_block_list ::= expression",
+ /* 107 */ "initializer_block_list ::= LBRACE initializer_block_list RBRACE",
+ /* 108 */ "initializer_block_list ::= initializer_block_list COMMA initializer_block_list",
+ /* 109 */ "initializer_block ::= LBRACE initializer_block_list RBRACE",
+ /* 110 */ "initializer ::= ASSIGN initializer_block",
+ /* 111 */ "initializer ::= ASSIGN expression",
+ /* 112 */ "intrinsic_datatype ::= datatype_vector",
+ /* 113 */ "intrinsic_datatype ::= datatype_matrix",
+ /* 114 */ "intrinsic_datatype ::= datatype_scalar",
+ /* 115 */ "intrinsic_datatype ::= datatype_sampler",
+ /* 116 */ "intrinsic_datatype ::= datatype_buffer",
+ /* 117 */ "datatype ::= intrinsic_datatype",
+ /* 118 */ "datatype ::= USERTYPE",
+ /* 119 */ "datatype_sampler ::= SAMPLER",
+ /* 120 */ "datatype_sampler ::= SAMPLER1D",
+ /* 121 */ "datatype_sampler ::= SAMPLER2D",
+ /* 122 */ "datatype_sampler ::= SAMPLER3D",
+ /* 123 */ "datatype_sampler ::= SAMPLERCUBE",
+ /* 124 */ "datatype_sampler ::= SAMPLER_STATE",
+ /* 125 */ "datatype_sampler ::= SAMPLERSTATE",
+ /* 126 */ "datatype_sampler ::= SAMPLERCOMPARISONSTATE",
+ /* 127 */ "datatype_scalar ::= BOOL",
+ /* 128 */ "datatype_scalar ::= INT",
+ /* 129 */ "datatype_scalar ::= UINT",
+ /* 130 */ "datatype_scalar ::= HALF",
+ /* 131 */ "datatype_scalar ::= FLOAT",
+ /* 132 */ "datatype_scalar ::= DOUBLE",
+ /* 133 */ "datatype_scalar ::= STRING",
+ /* 134 */ "datatype_scalar ::= SNORM FLOAT",
+ /* 135 */ "datatype_scalar ::= UNORM FLOAT",
+ /* 136 */ "datatype_buffer ::= BUFFER LT BOOL GT",
+ /* 137 */ "datatype_buffer ::= BUFFER LT INT GT",
+ /* 138 */ "datatype_buffer ::= BUFFER LT UINT GT",
+ /* 139 */ "datatype_buffer ::= BUFFER LT HALF GT",
+ /* 140 */ "datatype_buffer ::= BUFFER LT FLOAT GT",
+ /* 141 */ "datatype_buffer ::= BUFFER LT DOUBLE GT",
+ /* 142 */ "datatype_buffer ::= BUFFER LT SNORM FLOAT GT",
+ /* 143 */ "datatype_buffer ::= BUFFER LT UNORM FLOAT GT",
+ /* 144 */ "datatype_vector ::= VECTOR LT datatype_scalar COMMA INT_CONSTANT GT",
+ /* 145 */ "datatype_matrix ::= MATRIX LT datatype_scalar COMMA INT_CONSTANT COMMA INT_CONSTANT GT",
+ /* 146 */ "statement_block ::= LBRACE RBRACE",
+ /* 147 */ "statement_block ::= LBRACE statement_list RBRACE",
+ /* 148 */ "statement_list ::= statement",
+ /* 149 */ "statement_list ::= statement_list statement",
+ /* 150 */ "statement_attribute ::= ISOLATE",
+ /* 151 */ "statement_attribute ::= MAXINSTRUCTIONCOUNT LPAREN INT_CONSTANT RPAREN",
+ /* 152 */ "statement_attribute ::= NOEXPRESSIONOPTIMIZATIONS",
+ /* 153 */ "statement_attribute ::= REMOVEUNUSEDINPUTS",
+ /* 154 */ "statement_attribute ::= UNUSED",
+ /* 155 */ "statement_attribute ::= XPS",
+ /* 156 */ "statement ::= BREAK SEMICOLON",
+ /* 157 */ "statement ::= CONTINUE SEMICOLON",
+ /* 158 */ "statement ::= DISCARD SEMICOLON",
+ /* 159 */ "statement ::= LBRACKET statement_attribute RBRACKET statement_block",
+ /* 160 */ "statement ::= variable_declaration",
+ /* 161 */ "statement ::= struct_declaration SEMICOLON",
+ /* 162 */ "statement ::= do_intro statement WHILE LPAREN expression RPAREN SEMICOLON",
+ /* 163 */ "statement ::= while_intro LPAREN expression RPAREN statement",
+ /* 164 */ "statement ::= if_intro LPAREN expression RPAREN statement",
+ /* 165 */ "statement ::= if_intro LPAREN expression RPAREN statement ELSE statement",
+ /* 166 */ "statement ::= switch_intro LPAREN expression RPAREN LBRACE switch_case_list RBRACE",
+ /* 167 */ "statement ::= typedef",
+ /* 168 */ "statement ::= SEMICOLON",
+ /* 169 */ "statement ::= expression SEMICOLON",
+ /* 170 */ "statement ::= RETURN SEMICOLON",
+ /* 171 */ "statement ::= RETURN expression SEMICOLON",
+ /* 172 */ "statement ::= statement_block",
+ /* 173 */ "statement ::= for_statement",
+ /* 174 */ "while_intro ::= LBRACKET UNROLL LPAREN INT_CONSTANT RPAREN RBRACKET WHILE",
+ /* 175 */ "while_intro ::= LBRACKET UNROLL RBRACKET WHILE",
+ /* 176 */ "while_intro ::= LBRACKET LOOP RBRACKET WHILE",
+ /* 177 */ "while_intro ::= WHILE",
+ /* 178 */ "for_statement ::= for_intro for_details",
+ /* 179 */ "for_intro ::= LBRACKET UNROLL LPAREN INT_CONSTANT RPAREN RBRACKET FOR",
+ /* 180 */ "for_intro ::= LBRACKET UNROLL RBRACKET FOR",
+ /* 181 */ "for_intro ::= LBRACKET LOOP RBRACKET FOR",
+ /* 182 */ "for_intro ::= FOR",
+ /* 183 */ "for_details ::= LPAREN expression SEMICOLON expression SEMICOLON expression RPAREN statement",
+ /* 184 */ "for_details ::= LPAREN SEMICOLON SEMICOLON RPAREN statement",
+ /* 185 */ "for_details ::= LPAREN SEMICOLON SEMICOLON expression RPAREN statement",
+ /* 186 */ "for_details ::= LPAREN SEMICOLON expression SEMICOLON RPAREN statement",
+ /* 187 */ "for_details ::= LPAREN SEMICOLON expression SEMICOLON expression RPAREN statement",
+ /* 188 */ "for_details ::= LPAREN expression SEMICOLON SEMICOLON RPAREN statement",
+ /* 189 */ "for_details ::= LPAREN expression SEMICOLON SEMICOLON expression RPAREN statement",
+ /* 190 */ "for_details ::= LPAREN expression SEMICOLON expression SEMICOLON RPAREN statement",
+ /* 191 */ "for_details ::= LPAREN variable_declaration expression SEMICOLON expression RPAREN statement",
+ /* 192 */ "for_details ::= LPAREN variable_declaration SEMICOLON RPAREN statement",
+ /* 193 */ "for_details ::= LPAREN variable_declaration SEMICOLON expression RPAREN statement",
+ /* 194 */ "for_details ::= LPAREN variable_declaration expression SEMICOLON RPAREN statement",
+ /* 195 */ "do_intro ::= LBRACKET UNROLL LPAREN INT_CONSTANT RPAREN RBRACKET DO",
+ /* 196 */ "do_intro ::= LBRACKET UNROLL RBRACKET DO",
+ /* 197 */ "do_intro ::= LBRACKET LOOP RBRACKET DO",
+ /* 198 */ "do_intro ::= DO",
+ /* 199 */ "if_intro ::= LBRACKET BRANCH RBRACKET IF",
+ /* 200 */ "if_intro ::= LBRACKET FLATTEN RBRACKET IF",
+ /* 201 */ "if_intro ::= LBRACKET IFALL RBRACKET IF",
+ /* 202 */ "if_intro ::= LBRACKET IFANY RBRACKET IF",
+ /* 203 */ "if_intro ::= LBRACKET PREDICATE RBRACKET IF",
+ /* 204 */ "if_intro ::= LBRACKET PREDICATEBLOCK RBRACKET IF",
+ /* 205 */ "if_intro ::= IF",
+ /* 206 */ "switch_intro ::= LBRACKET FLATTEN RBRACKET SWITCH",
+ /* 207 */ "switch_intro ::= LBRACKET BRANCH RBRACKET SWITCH",
+ /* 208 */ "switch_intro ::= LBRACKET FORCECASE RBRACKET SWITCH",
+ /* 209 */ "switch_intro ::= LBRACKET CALL RBRACKET SWITCH",
+ /* 210 */ "switch_intro ::= SWITCH",
+ /* 211 */ "switch_case_list ::= switch_case",
+ /* 212 */ "switch_case_list ::= switch_case_list switch_case",
+ /* 213 */ "switch_case ::= CASE expression COLON statement_list",
+ /* 214 */ "switch_case ::= CASE expression COLON",
+ /* 215 */ "switch_case ::= DEFAULT COLON statement_list",
+ /* 216 */ "switch_case ::= DEFAULT COLON",
+ /* 217 */ "primary_expr ::= IDENTIFIER",
+ /* 218 */ "primary_expr ::= INT_CONSTANT",
+ /* 219 */ "primary_expr ::= FLOAT_CONSTANT",
+ /* 220 */ "primary_expr ::= STRING_LITERAL",
+ /* 221 */ "primary_expr ::= TRUE",
+ /* 222 */ "primary_expr ::= FALSE",
+ /* 223 */ "primary_expr ::= LPAREN expression RPAREN",
+ /* 224 */ "postfix_expr ::= primary_expr",
+ /* 225 */ "postfix_expr ::= postfix_expr LBRACKET expression RBRACKET",
+ /* 226 */ "postfix_expr ::= IDENTIFIER arguments",
+ /* 227 */ "postfix_expr ::= datatype arguments",
+ /* 228 */ "postfix_expr ::= postfix_expr DOT IDENTIFIER",
+ /* 229 */ "postfix_expr ::= postfix_expr PLUSPLUS",
+ /* 230 */ "postfix_expr ::= postfix_expr MINUSMINUS",
+ /* 231 */ "arguments ::= LPAREN RPAREN",
+ /* 232 */ "arguments ::= LPAREN argument_list RPAREN",
+ /* 233 */ "argument_list ::= assignment_expr",
+ /* 234 */ "argument_list ::= argument_list COMMA assignment_expr",
+ /* 235 */ "unary_expr ::= postfix_expr",
+ /* 236 */ "unary_expr ::= PLUSPLUS unary_expr",
+ /* 237 */ "unary_expr ::= MINUSMINUS unary_expr",
+ /* 238 */ "unary_expr ::= PLUS cast_expr",
+ /* 239 */ "unary_expr ::= MINUS cast_expr",
+ /* 240 */ "unary_expr ::= COMPLEMENT cast_expr",
+ /* 241 */ "unary_expr ::= EXCLAMATION cast_expr",
+ /* 242 */ "cast_expr ::= unary_expr",
+ /* 243 */ "cast_expr ::= LPAREN datatype RPAREN cast_expr",
+ /* 244 */ "multiplicative_expr ::= cast_expr",
+ /* 245 */ "multiplicative_expr ::= multiplicative_expr STAR cast_expr",
+ /* 246 */ "multiplicative_expr ::= multiplicative_expr SLASH cast_expr",
+ /* 247 */ "multiplicative_expr ::= multiplicative_expr PERCENT cast_expr",
+ /* 248 */ "additive_expr ::= multiplicative_expr",
+ /* 249 */ "additive_expr ::= additive_expr PLUS multiplicative_expr",
+ /* 250 */ "additive_expr ::= additive_expr MINUS multiplicative_expr",
+ /* 251 */ "shift_expr ::= additive_expr",
+ /* 252 */ "shift_expr ::= shift_expr LSHIFT additive_expr",
+ /* 253 */ "shift_expr ::= shift_expr RSHIFT additive_expr",
+ /* 254 */ "relational_expr ::= shift_expr",
+ /* 255 */ "relational_expr ::= relational_expr LT shift_expr",
+ /* 256 */ "relational_expr ::= relational_expr GT shift_expr",
+ /* 257 */ "relational_expr ::= relational_expr LEQ shift_expr",
+ /* 258 */ "relational_expr ::= relational_expr GEQ shift_expr",
+ /* 259 */ "equality_expr ::= relational_expr",
+ /* 260 */ "equality_expr ::= equality_expr EQL relational_expr",
+ /* 261 */ "equality_expr ::= equality_expr NEQ relational_expr",
+ /* 262 */ "and_expr ::= equality_expr",
+ /* 263 */ "and_expr ::= and_expr AND equality_expr",
+ /* 264 */ "exclusive_or_expr ::= and_expr",
+ /* 265 */ "exclusive_or_expr ::= exclusive_or_expr XOR and_expr",
+ /* 266 */ "inclusive_or_expr ::= exclusive_or_expr",
+ /* 267 */ "inclusive_or_expr ::= inclusive_or_expr OR exclusive_or_expr",
+ /* 268 */ "logical_and_expr ::= inclusive_or_expr",
+ /* 269 */ "logical_and_expr ::= logical_and_expr ANDAND inclusive_or_expr",
+ /* 270 */ "logical_or_expr ::= logical_and_expr",
+ /* 271 */ "logical_or_expr ::= logical_or_expr OROR logical_and_expr",
+ /* 272 */ "conditional_expr ::= logical_or_expr",
+ /* 273 */ "conditional_expr ::= logical_or_expr QUESTION logical_or_expr COLON conditional_expr",
+ /* 274 */ "assignment_expr ::= conditional_expr",
+ /* 275 */ "assignment_expr ::= unary_expr ASSIGN assignment_expr",
+ /* 276 */ "assignment_expr ::= unary_expr MULASSIGN assignment_expr",
+ /* 277 */ "assignment_expr ::= unary_expr DIVASSIGN assignment_expr",
+ /* 278 */ "assignment_expr ::= unary_expr MODASSIGN assignment_expr",
+ /* 279 */ "assignment_expr ::= unary_expr ADDASSIGN assignment_expr",
+ /* 280 */ "assignment_expr ::= unary_expr SUBASSIGN assignment_expr",
+ /* 281 */ "assignment_expr ::= unary_expr LSHIFTASSIGN assignment_expr",
+ /* 282 */ "assignment_expr ::= unary_expr RSHIFTASSIGN assignment_expr",
+ /* 283 */ "assignment_expr ::= unary_expr ANDASSIGN assignment_expr",
+ /* 284 */ "assignment_expr ::= unary_expr XORASSIGN assignment_expr",
+ /* 285 */ "assignment_expr ::= unary_expr ORASSIGN assignment_expr",
+ /* 286 */ "expression ::= assignment_expr",
+ /* 287 */ "expression ::= expression COMMA assignment_expr",
+};
+#endif /* NDEBUG */
+
+
+#if YYSTACKDEPTH<=0
+/*
+** Try to increase the size of the parser stack.
+*/
+static void yyGrowStack(yyParser *p){
+  int newSize;
+  yyStackEntry *pNew;
+
+  newSize = p->yystksz*2 + 100;
+  pNew = realloc(p->yystack, newSize*sizeof(pNew[0]));
+  if( pNew ){
+    p->yystack = pNew;
+    p->yystksz = newSize;
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+    if( yyTraceFILE ){
+      fprintf(yyTraceFILE,"%sStack grows to %d entries!\n",
+              yyTracePrompt, p->yystksz);
+    }
+#endif
+  }
+}
+#endif
+
+/* 
+** This function allocates a new parser.
+** The only argument is a pointer to a function which works like
+** malloc.
+**
+** Inputs:
+** A pointer to the function used to allocate memory.
+**
+** Outputs:
+** A pointer to a parser.  This pointer is used in subsequent calls
+** to ParseHLSL and ParseHLSLFree.
+*/
+#if __MOJOSHADER__
+static void *ParseHLSLAlloc(void *(*mallocProc)(int,void *), void *malloc_data){
+  yyParser *pParser;
+  pParser = (yyParser*)(*mallocProc)( (int)sizeof(yyParser), malloc_data );
+#else
+void *ParseHLSLAlloc(void *(*mallocProc)(size_t)){
+  yyParser *pParser;
+  pParser = (yyParser*)(*mallocProc)( (size_t)sizeof(yyParser) );
+#endif
+  if( pParser ){
+    pParser->yyidx = -1;
+#ifdef YYTRACKMAXSTACKDEPTH
+    pParser->yyidxMax = 0;
+#endif
+#if YYSTACKDEPTH<=0
+    pParser->yystack = NULL;
+    pParser->yystksz = 0;
+    yyGrowStack(pParser);
+#endif
+  }
+  return pParser;
+}
+
+/* The following function deletes the value associated with a
+** symbol.  The symbol can be either a terminal or nonterminal.
+** "yymajor" is the symbol code, and "yypminor" is a pointer to
+** the value.
+*/
+static void yy_destructor(
+  yyParser *yypParser,    /* The parser */
+  YYCODETYPE yymajor,     /* Type code for object to destroy */
+  YYMINORTYPE *yypminor   /* The object to be destroyed */
+){
+  ParseHLSLARG_FETCH;
+  switch( yymajor ){
+    /* Here is inserted the actions which take place when a
+    ** terminal or non-terminal is destroyed.  This can happen
+    ** when the symbol is popped from the stack during a
+    ** reduce or during error processing or when a parser is 
+    ** being destroyed before it is finished parsing.
+    **
+    ** Note: during a reduce, the only symbols destroyed are those
+    ** which appear on the RHS of the rule, but which are not used
+    ** inside the C code.
+    */
+    default:  break;   /* If no destructor action specified: do nothing */
+  }
+  ParseHLSLARG_STORE; /* Suppress warning about unused %extra_argument variable */
+}
+
+/*
+** Pop the parser's stack once.
+**
+** If there is a destructor routine associated with the token which
+** is popped from the stack, then call it.
+**
+** Return the major token number for the symbol popped.
+*/
+static int yy_pop_parser_stack(yyParser *pParser){
+  YYCODETYPE yymajor;
+  yyStackEntry *yytos = &pParser->yystack[pParser->yyidx];
+
+  if( pParser->yyidx<0 ) return 0;
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+  if( yyTraceFILE && pParser->yyidx>=0 ){
+    fprintf(yyTraceFILE,"%sPopping %s\n",
+      yyTracePrompt,
+      yyTokenName[yytos->major]);
+  }
+#endif
+  yymajor = yytos->major;
+  yy_destructor(pParser, yymajor, &yytos->minor);
+  pParser->yyidx--;
+  return yymajor;
+}
+
+/* 
+** Deallocate and destroy a parser.  Destructors are all called for
+** all stack elements before shutting the parser down.
+**
+** Inputs:
+** <ul>
+** <li>  A pointer to the parser.  This should be a pointer
+**       obtained from ParseHLSLAlloc.
+** <li>  A pointer to a function used to reclaim memory obtained
+**       from malloc.
+** </ul>
+*/
+#if __MOJOSHADER__
+static
+#endif
+void ParseHLSLFree(
+  void *p,                    /* The parser to be deleted */
+#if __MOJOSHADER__
+  void (*freeProc)(void*,void*),     /* Function used to reclaim memory */
+  void *malloc_data
+#else
+  void (*freeProc)(void*)     /* Function used to reclaim memory */
+#endif
+){
+  yyParser *pParser = (yyParser*)p;
+  if( pParser==0 ) return;
+  while( pParser->yyidx>=0 ) yy_pop_parser_stack(pParser);
+#if YYSTACKDEPTH<=0
+  free(pParser->yystack);
+#endif
+#if __MOJOSHADER__
+  (*freeProc)((void*)pParser, malloc_data);
+#else
+  (*freeProc)((void*)pParser);
+#endif
+}
+
+/*
+** Return the peak depth of the stack for a parser.
+*/
+#ifdef YYTRACKMAXSTACKDEPTH
+static int ParseHLSLStackPeak(void *p){
+  yyParser *pParser = (yyParser*)p;
+  return pParser->yyidxMax;
+}
+#endif
+
+/*
+** Find the appropriate action for a parser given the terminal
+** look-ahead token iLookAhead.
+**
+** If the look-ahead token is YYNOCODE, then check to see if the action is
+** independent of the look-ahead.  If it is, return the action, otherwise
+** return YY_NO_ACTION.
+*/
+static int yy_find_shift_action(
+  yyParser *pParser,        /* The parser */
+  YYCODETYPE iLookAhead     /* The look-ahead token */
+){
+  int i;
+  int stateno = pParser->yystack[pParser->yyidx].stateno;
+ 
+  if( stateno>YY_SHIFT_COUNT
+   || (i = yy_shift_ofst[stateno])==YY_SHIFT_USE_DFLT ){
+    return yy_default[stateno];
+  }
+  assert( iLookAhead!=YYNOCODE );
+  i += iLookAhead;
+  if( i<0 || i>=YY_ACTTAB_COUNT || yy_lookahead[i]!=iLookAhead ){
+    if( iLookAhead>0 ){
+#ifdef YYFALLBACK
+      YYCODETYPE iFallback;            /* Fallback token */
+      if( iLookAhead<sizeof(yyFallback)/sizeof(yyFallback[0])
+             && (iFallback = yyFallback[iLookAhead])!=0 ){
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+        if( yyTraceFILE ){
+          fprintf(yyTraceFILE, "%sFALLBACK %s => %s\n",
+             yyTracePrompt, yyTokenName[iLookAhead], yyTokenName[iFallback]);
+        }
+#endif
+        return yy_find_shift_action(pParser, iFallback);
+      }
+#endif
+#ifdef YYWILDCARD
+      {
+        int j = i - iLookAhead + YYWILDCARD;
+        if( 
+#if YY_SHIFT_MIN+YYWILDCARD<0
+          j>=0 &&
+#endif
+#if YY_SHIFT_MAX+YYWILDCARD>=YY_ACTTAB_COUNT
+          j<YY_ACTTAB_COUNT &&
+#endif
+          yy_lookahead[j]==YYWILDCARD
+        ){
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+          if( yyTraceFILE ){
+            fprintf(yyTraceFILE, "%sWILDCARD %s => %s\n",
+               yyTracePrompt, yyTokenName[iLookAhead], yyTokenName[YYWILDCARD]);
+          }
+#endif /* NDEBUG */
+          return yy_action[j];
+        }
+      }
+#endif /* YYWILDCARD */
+    }
+    return yy_default[stateno];
+  }else{
+    return yy_action[i];
+  }
+}
+
+/*
+** Find the appropriate action for a parser given the non-terminal
+** look-ahead token iLookAhead.
+**
+** If the look-ahead token is YYNOCODE, then check to see if the action is
+** independent of the look-ahead.  If it is, return the action, otherwise
+** return YY_NO_ACTION.
+*/
+static int yy_find_reduce_action(
+  int stateno,              /* Current state number */
+  YYCODETYPE iLookAhead     /* The look-ahead token */
+){
+  int i;
+#ifdef YYERRORSYMBOL
+  if( stateno>YY_REDUCE_COUNT ){
+    return yy_default[stateno];
+  }
+#else
+  assert( stateno<=YY_REDUCE_COUNT );
+#endif
+  i = yy_reduce_ofst[stateno];
+  assert( i!=YY_REDUCE_USE_DFLT );
+  assert( iLookAhead!=YYNOCODE );
+  i += iLookAhead;
+#ifdef YYERRORSYMBOL
+  if( i<0 || i>=YY_ACTTAB_COUNT || yy_lookahead[i]!=iLookAhead ){
+    return yy_default[stateno];
+  }
+#else
+  assert( i>=0 && i<YY_ACTTAB_COUNT );
+  assert( yy_lookahead[i]==iLookAhead );
+#endif
+  return yy_action[i];
+}
+
+/*
+** The following routine is called if the stack overflows.
+*/
+static void yyStackOverflow(yyParser *yypParser, YYMINORTYPE *yypMinor){
+   ParseHLSLARG_FETCH;
+   yypParser->yyidx--;
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+   if( yyTraceFILE ){
+     fprintf(yyTraceFILE,"%sStack Overflow!\n",yyTracePrompt);
+   }
+#endif
+   while( yypParser->yyidx>=0 ) yy_pop_parser_stack(yypParser);
+   /* Here code is inserted which will execute if the parser
+   ** stack every overflows */
+#line 47 "/root/repo/mojoshader_parser_hlsl.lemon"
+
+    // !!! FIXME: make this a proper fail() function.
+    fail(ctx, "Giving up. Parser stack overflow");
+#line 2224 "/root/repo/mojoshader_parser_hlsl.h"
+   ParseHLSLARG_STORE; /* Suppress warning about unused %extra_argument var */
+}
+
+/*
+** Perform a shift action.
+*/
+static void yy_shift(
+  yyParser *yypParser,          /* The parser to be shifted */
+  int yyNewState,               /* The new state to shift in */
+  int yyMajor,                  /* The major token to shift in */
+  YYMINORTYPE *yypMinor         /* Pointer to the minor token to shift in */
+){
+  yyStackEntry *yytos;
+  yypParser->yyidx++;
+#ifdef YYTRACKMAXSTACKDEPTH
+  if( yypParser->yyidx>yypParser->yyidxMax ){
+    yypParser->yyidxMax = yypParser->yyidx;
+  }
+#endif
+#if YYSTACKDEPTH>0 
+  if( yypParser->yyidx>=YYSTACKDEPTH ){
+    yyStackOverflow(yypParser, yypMinor);
+    return;
+  }
+#else
+  if( yypParser->yyidx>=yypParser->yystksz ){
+    yyGrowStack(yypParser);
+    if( yypParser->yyidx>=yypParser->yystksz ){
+      yyStackOverflow(yypParser, yypMinor);
+      return;
+    }
+  }
+#endif
+  yytos = &yypParser->yystack[yypParser->yyidx];
+  yytos->stateno = (YYACTIONTYPE)yyNewState;
+  yytos->major = (YYCODETYPE)yyMajor;
+  yytos->minor = *yypMinor;
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+  if( yyTraceFILE && yypParser->yyidx>0 ){
+    int i;
+    fprintf(yyTraceFILE,"%sShift %d\n",yyTracePrompt,yyNewState);
+    fprintf(yyTraceFILE,"%sStack:",yyTracePrompt);
+    for(i=1; i<=yypParser->yyidx; i++)
+      fprintf(yyTraceFILE," %s",yyTokenName[yypParser->yystack[i].major]);
+    fprintf(yyTraceFILE,"\n");
+  }
+#endif
+}
+
+/* The following table contains information about every rule that
+** is used during the reduce.
+*/
+static const struct {
+  YYCODETYPE lhs;         /* Symbol on the left-hand side of the rule */
+  unsigned char nrhs;     /* Number of right-hand side symbols in the rule */
+} yyRuleInfo[] = {
+  { 124, 1 },
+  { 125, 1 },
+  { 125, 2 },
+  { 126, 1 },
+  { 126, 2 },
+  { 126, 2 },
+  { 126, 1 },
+  { 126, 2 },
+  { 130, 4 },
+  { 130, 3 },
+  { 128, 3 },
+  { 128, 2 },
+  { 128, 2 },
+  { 128, 1 },
+  { 135, 5 },
+  { 135, 5 },
+  { 134, 1 },
+  { 137, 1 },
+  { 137, 1 },
+  { 137, 0 },
+  { 138, 1 },
+  { 138, 3 },
+  { 139, 6 },
+  { 139, 5 },
+  { 139, 5 },
+  { 139, 4 },
+  { 139, 5 },
+  { 139, 4 },
+  { 139, 4 },
+  { 139, 3 },
+  { 139, 5 },
+  { 139, 4 },
+  { 139, 4 },
+  { 139, 3 },
+  { 139, 4 },
+  { 139, 3 },
+  { 139, 3 },
+  { 139, 2 },
+  { 140, 1 },
+  { 140, 1 },
+  { 140, 1 },
+  { 140, 2 },
+  { 140, 2 },
+  { 140, 1 },
+  { 136, 2 },
+  { 141, 1 },
+  { 141, 1 },
+  { 141, 1 },
+  { 141, 1 },
+  { 141, 1 },
+  { 127, 4 },
+  { 127, 3 },
+  { 127, 3 },
+  { 143, 1 },
+  { 143, 2 },
+  { 145, 1 },
+  { 145, 1 },
+  { 145, 1 },
+  { 145, 1 },
+  { 145, 1 },
+  { 145, 1 },
+  { 145, 1 },
+  { 145, 1 },
+  { 145, 1 },
+  { 144, 1 },
+  { 144, 3 },
+  { 146, 5 },
+  { 146, 4 },
+  { 146, 4 },
+  { 146, 3 },
+  { 146, 4 },
+  { 146, 3 },
+  { 146, 3 },
+  { 146, 2 },
+  { 146, 4 },
+  { 146, 3 },
+  { 146, 3 },
+  { 146, 2 },
+  { 146, 3 },
+  { 146, 2 },
+  { 146, 2 },
+  { 146, 1 },
+  { 131, 4 },
+  { 149, 2 },
+  { 150, 1 },
+  { 150, 2 },
+  { 151, 2 },
+  { 151, 1 },
+  { 152, 3 },
+  { 153, 1 },
+  { 153, 2 },
+  { 153, 3 },
+  { 148, 2 },
+  { 148, 2 },
+  { 148, 1 },
+  { 148, 1 },
+  { 133, 3 },
+  { 133, 4 },
+  { 133, 1 },
+  { 154, 7 },
+  { 154, 5 },
+  { 155, 5 },
+  { 147, 3 },
+  { 157, 1 },
+  { 157, 2 },
+  { 158, 3 },
+  { 160, 1 },
+  { 160, 3 },
+  { 160, 3 },
+  { 161, 3 },
+  { 142, 2 },
+  { 142, 2 },
+  { 162, 1 },
+  { 162, 1 },
+  { 162, 1 },
+  { 162, 1 },
+  { 162, 1 },
+  { 132, 1 },
+  { 132, 1 },
+  { 165, 1 },
+  { 165, 1 },
+  { 165, 1 },
+  { 165, 1 },
+  { 165, 1 },
+  { 165, 1 },
+  { 165, 1 },
+  { 165, 1 },
+  { 159, 1 },
+  { 159, 1 },
+  { 159, 1 },
+  { 159, 1 },
+  { 159, 1 },
+  { 159, 1 },
+  { 159, 1 },
+  { 159, 2 },
+  { 159, 2 },
+  { 166, 4 },
+  { 166, 4 },
+  { 166, 4 },
+  { 166, 4 },
+  { 166, 4 },
+  { 166, 4 },
+  { 166, 5 },
+  { 166, 5 },
+  { 163, 6 },
+  { 164, 8 },
+  { 129, 2 },
+  { 129, 3 },
+  { 167, 1 },
+  { 167, 2 },
+  { 169, 1 },
+  { 169, 4 },
+  { 169, 1 },
+  { 169, 1 },
+  { 169, 1 },
+  { 169, 1 },
+  { 168, 2 },
+  { 168, 2 },
+  { 168, 2 },
+  { 168, 4 },
+  { 168, 1 },
+  { 168, 2 },
+  { 168, 7 },
+  { 168, 5 },
+  { 168, 5 },
+  { 168, 7 },
+  { 168, 7 },
+  { 168, 1 },
+  { 168, 1 },
+  { 168, 2 },
+  { 168, 2 },
+  { 168, 3 },
+  { 168, 1 },
+  { 168, 1 },
+  { 171, 7 },
+  { 171, 4 },
+  { 171, 4 },
+  { 171, 1 },
+  { 175, 2 },
+  { 176, 7 },
+  { 176, 4 },
+  { 176, 4 },
+  { 176, 1 },
+  { 177, 8 },
+  { 177, 5 },
+  { 177, 6 },
+  { 177, 6 },
+  { 177, 7 },
+  { 177, 6 },
+  { 177, 7 },
+  { 177, 7 },
+  { 177, 7 },
+  { 177, 5 },
+  { 177, 6 },
+  { 177, 6 },
+  { 170, 7 },
+  { 170, 4 },
+  { 170, 4 },
+  { 170, 1 },
+  { 172, 4 },
+  { 172, 4 },
+  { 172, 4 },
+  { 172, 4 },
+  { 172, 4 },
+  { 172, 4 },
+  { 172, 1 },
+  { 173, 4 },
+  { 173, 4 },
+  { 173, 4 },
+  { 173, 4 },
+  { 173, 1 },
+  { 174, 1 },
+  { 174, 2 },
+  { 178, 4 },
+  { 178, 3 },
+  { 178, 3 },
+  { 178, 2 },
+  { 179, 1 },
+  { 179, 1 },
+  { 179, 1 },
+  { 179, 1 },
+  { 179, 1 },
+  { 179, 1 },
+  { 179, 3 },
+  { 180, 1 },
+  { 180, 4 },
+  { 180, 2 },
+  { 180, 2 },
+  { 180, 3 },
+  { 180, 2 },
+  { 180, 2 },
+  { 181, 2 },
+  { 181, 3 },
+  { 182, 1 },
+  { 182, 3 },
+  { 184, 1 },
+  { 184, 2 },
+  { 184, 2 },
+  { 184, 2 },
+  { 184, 2 },
+  { 184, 2 },
+  { 184, 2 },
+  { 185, 1 },
+  { 185, 4 },
+  { 186, 1 },
+  { 186, 3 },
+  { 186, 3 },
+  { 186, 3 },
+  { 187, 1 },
+  { 187, 3 },
+  { 187, 3 },
+  { 188, 1 },
+  { 188, 3 },
+  { 188, 3 },
+  { 189, 1 },
+  { 189, 3 },
+  { 189, 3 },
+  { 189, 3 },
+  { 189, 3 },
+  { 190, 1 },
+  { 190, 3 },
+  { 190, 3 },
+  { 191, 1 },
+  { 191, 3 },
+  { 192, 1 },
+  { 192, 3 },
+  { 193, 1 },
+  { 193, 3 },
+  { 194, 1 },
+  { 194, 3 },
+  { 195, 1 },
+  { 195, 3 },
+  { 196, 1 },
+  { 196, 5 },
+  { 183, 1 },
+  { 183, 3 },
+  { 183, 3 },
+  { 183, 3 },
+  { 183, 3 },
+  { 183, 3 },
+  { 183, 3 },
+  { 183, 3 },
+  { 183, 3 },
+  { 183, 3 },
+  { 183, 3 },
+  { 183, 3 },
+  { 156, 1 },
+  { 156, 3 },
+};
+
+static void yy_accept(yyParser*);  /* Forward Declaration */
+
+/*
+** Perform a reduce action and the shift that must immediately
+** follow the reduce.
+*/
+static void yy_reduce(
+  yyParser *yypParser,         /* The parser */
+  int yyruleno                 /* Number of the rule by which to reduce */
+){
+  int yygoto;                     /* The next state */
+  int yyact;                      /* The next action */
+  YYMINORTYPE yygotominor;        /* The LHS of the rule reduced */
+  yyStackEntry *yymsp;            /* The top of the parser's stack */
+  int yysize;                     /* Amount to pop the stack */
+  ParseHLSLARG_FETCH;
+  yymsp = &yypParser->yystack[yypParser->yyidx];
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+  if( yyTraceFILE && yyruleno>=0
+        && yyruleno<(int)(sizeof(yyRuleName)/sizeof(yyRuleName[0])) ){
+    fprintf(yyTraceFILE, "%sReduce [%s].\n", yyTracePrompt,
+      yyRuleName[yyruleno]);
+  }
+#endif /* NDEBUG */
+
+  /* Silence complaints from purify about yygotominor being uninitialized
+  ** in some cases when it is copied into the stack after the following
+  ** switch.  yygotominor is uninitialized when a rule reduces that does
+  ** not set the value of its left-hand side nonterminal.  Leaving the
+  ** value of the nonterminal uninitialized is utterly harmless as long
+  ** as the value is never used.  So really the only thing this code
+  ** accomplishes is to quieten purify.  
+  **
+  ** 2007-01-16:  The wireshark project (www.wireshark.org) reports that
+  ** without this code, their parser segfaults.  I'm not sure what there
+  ** parser is doing to make this happen.  This is the second bug report
+  ** from wireshark this week.  Clearly they are stressing Lemon in ways
+  ** that it has not been previously stressed...  (SQLite ticket #2172)
+  */
+  /*memset(&yygotominor, 0, sizeof(yygotominor));*/
+  yygotominor = yyzerominor;
+
+
+  switch( yyruleno ){
+  /* Beginning here are the reduction cases.  A typical example
+  ** follows:
+  **   case 0:
+  **  #line <lineno> <grammarfile>
+  **     { ... }           // User supplied code
+  **  #line <lineno> <thisfile>
+  **     break;
+  */
+      case 0: /* shader ::= compilation_units */
+#line 82 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ assert(ctx->ast == NULL); REVERSE_LINKED_LIST(MOJOSHADER_astCompilationUnit, yymsp[0].minor.yy139); ctx->ast = (MOJOSHADER_astNode *) yymsp[0].minor.yy139; }
+#line 2626 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 1: /* compilation_units ::= compilation_unit */
+#line 85 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy139 = yymsp[0].minor.yy139; }
+#line 2631 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 2: /* compilation_units ::= compilation_units compilation_unit */
+#line 86 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ if (yymsp[0].minor.yy139) { yymsp[0].minor.yy139->next = yymsp[-1].minor.yy139; yygotominor.yy139 = yymsp[0].minor.yy139; } }
+#line 2636 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 3: /* compilation_unit ::= variable_declaration */
+#line 90 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy139 = new_global_variable(ctx, yymsp[0].minor.yy24); }
+#line 2641 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 4: /* compilation_unit ::= function_signature SEMICOLON */
+#line 91 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy139 = new_function(ctx, yymsp[-1].minor.yy364, NULL); }
+#line 2646 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 5: /* compilation_unit ::= function_signature statement_block */
+#line 92 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy139 = new_function(ctx, yymsp[-1].minor.yy364, yymsp[0].minor.yy233); }
+#line 2651 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 6: /* compilation_unit ::= typedef */
+#line 93 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy139 = new_global_typedef(ctx, yymsp[0].minor.yy71); }
+#line 2656 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 7: /* compilation_unit ::= struct_declaration SEMICOLON */
+#line 94 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy139 = new_global_struct(ctx, yymsp[-1].minor.yy249); }
+#line 2661 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 8: /* typedef ::= TYPEDEF CONST datatype scalar_or_array */
+#line 99 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy71 = new_typedef(ctx, 1, yymsp[-1].minor.yy37, yymsp[0].minor.yy380); push_usertype(ctx, yymsp[0].minor.yy380->identifier, yygotominor.yy71->datatype); }
+#line 2666 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 9: /* typedef ::= TYPEDEF datatype scalar_or_array */
+#line 100 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy71 = new_typedef(ctx, 0, yymsp[-1].minor.yy37, yymsp[0].minor.yy380); push_usertype(ctx, yymsp[0].minor.yy380->identifier, yygotominor.yy71->datatype); }
+#line 2671 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 10: /* function_signature ::= function_storageclass function_details semantic */
+#line 103 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy364 = yymsp[-1].minor.yy364; yygotominor.yy364->storage_class = yymsp[-2].minor.yy175; yygotominor.yy364->semantic = yymsp[0].minor.yy306; }
+#line 2676 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 11: /* function_signature ::= function_storageclass function_details */
+#line 104 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy364 = yymsp[0].minor.yy364; yygotominor.yy364->storage_class = yymsp[-1].minor.yy175; }
+#line 2681 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 12: /* function_signature ::= function_details semantic */
+#line 105 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy364 = yymsp[-1].minor.yy364; yygotominor.yy364->semantic = yymsp[0].minor.yy306; }
+#line 2686 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 13: /* function_signature ::= function_details */
+#line 106 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy364 = yymsp[0].minor.yy364; }
+#line 2691 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 14: /* function_details ::= datatype IDENTIFIER LPAREN function_parameters RPAREN */
+#line 109 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy364 = new_function_signature(ctx, yymsp[-4].minor.yy37, yymsp[-3].minor.yy0.string, yymsp[-1].minor.yy307); }
+#line 2696 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 15: /* function_details ::= VOID IDENTIFIER LPAREN function_parameters RPAREN */
+#line 110 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy364 = new_function_signature(ctx, NULL, yymsp[-3].minor.yy0.string, yymsp[-1].minor.yy307); }
+#line 2701 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 16: /* function_storageclass ::= INLINE */
+#line 120 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy175 = MOJOSHADER_AST_FNSTORECLS_INLINE; }
+#line 2706 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 17: /* function_parameters ::= VOID */
+      case 19: /* function_parameters ::= */ yytestcase(yyruleno==19);
+#line 123 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = NULL; }
+#line 2712 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 18: /* function_parameters ::= function_parameter_list */
+#line 124 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astFunctionParameters, yymsp[0].minor.yy307); yygotominor.yy307 = yymsp[0].minor.yy307; }
+#line 2717 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 20: /* function_parameter_list ::= function_parameter */
+#line 128 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = yymsp[0].minor.yy307; }
+#line 2722 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 21: /* function_parameter_list ::= function_parameter_list COMMA function_parameter */
+#line 129 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yymsp[0].minor.yy307->next = yymsp[-2].minor.yy307; yygotominor.yy307 = yymsp[0].minor.yy307; }
+#line 2727 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 22: /* function_parameter ::= input_modifier datatype IDENTIFIER semantic interpolation_mod initializer */
+#line 134 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, yymsp[-5].minor.yy75, yymsp[-4].minor.yy37, yymsp[-3].minor.yy0.string, yymsp[-2].minor.yy306, yymsp[-1].minor.yy111, yymsp[0].minor.yy322); }
+#line 2732 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 23: /* function_parameter ::= input_modifier datatype IDENTIFIER semantic interpolation_mod */
+#line 135 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, yymsp[-4].minor.yy75, yymsp[-3].minor.yy37, yymsp[-2].minor.yy0.string, yymsp[-1].minor.yy306, yymsp[0].minor.yy111, NULL); }
+#line 2737 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 24: /* function_parameter ::= input_modifier datatype IDENTIFIER semantic initializer */
+#line 136 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, yymsp[-4].minor.yy75, yymsp[-3].minor.yy37, yymsp[-2].minor.yy0.string, yymsp[-1].minor.yy306, MOJOSHADER_AST_INTERPMOD_NONE, yymsp[0].minor.yy322); }
+#line 2742 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 25: /* function_parameter ::= input_modifier datatype IDENTIFIER semantic */
+#line 137 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, yymsp[-3].minor.yy75, yymsp[-2].minor.yy37, yymsp[-1].minor.yy0.string, yymsp[0].minor.yy306, MOJOSHADER_AST_INTERPMOD_NONE, NULL); }
+#line 2747 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 26: /* function_parameter ::= input_modifier datatype IDENTIFIER interpolation_mod initializer */
+#line 138 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, yymsp[-4].minor.yy75, yymsp[-3].minor.yy37, yymsp[-2].minor.yy0.string, NULL, yymsp[-1].minor.yy111, yymsp[0].minor.yy322); }
+#line 2752 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 27: /* function_parameter ::= input_modifier datatype IDENTIFIER interpolation_mod */
+#line 139 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, yymsp[-3].minor.yy75, yymsp[-2].minor.yy37, yymsp[-1].minor.yy0.string, NULL, yymsp[0].minor.yy111, NULL); }
+#line 2757 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 28: /* function_parameter ::= input_modifier datatype IDENTIFIER initializer */
+#line 140 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, yymsp[-3].minor.yy75, yymsp[-2].minor.yy37, yymsp[-1].minor.yy0.string, NULL, MOJOSHADER_AST_INTERPMOD_NONE, yymsp[0].minor.yy322); }
+#line 2762 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 29: /* function_parameter ::= input_modifier datatype IDENTIFIER */
+#line 141 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, yymsp[-2].minor.yy75, yymsp[-1].minor.yy37, yymsp[0].minor.yy0.string, NULL, MOJOSHADER_AST_INTERPMOD_NONE, NULL); }
+#line 2767 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 30: /* function_parameter ::= datatype IDENTIFIER semantic interpolation_mod initializer */
+#line 142 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, MOJOSHADER_AST_INPUTMOD_NONE, yymsp[-4].minor.yy37, yymsp[-3].minor.yy0.string, yymsp[-2].minor.yy306, yymsp[-1].minor.yy111, yymsp[0].minor.yy322); }
+#line 2772 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 31: /* function_parameter ::= datatype IDENTIFIER semantic interpolation_mod */
+#line 143 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, MOJOSHADER_AST_INPUTMOD_NONE, yymsp[-3].minor.yy37, yymsp[-2].minor.yy0.string, yymsp[-1].minor.yy306, yymsp[0].minor.yy111, NULL); }
+#line 2777 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 32: /* function_parameter ::= datatype IDENTIFIER semantic initializer */
+#line 144 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, MOJOSHADER_AST_INPUTMOD_NONE, yymsp[-3].minor.yy37, yymsp[-2].minor.yy0.string, yymsp[-1].minor.yy306, MOJOSHADER_AST_INTERPMOD_NONE, yymsp[0].minor.yy322); }
+#line 2782 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 33: /* function_parameter ::= datatype IDENTIFIER semantic */
+#line 145 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, MOJOSHADER_AST_INPUTMOD_NONE, yymsp[-2].minor.yy37, yymsp[-1].minor.yy0.string, yymsp[0].minor.yy306, MOJOSHADER_AST_INTERPMOD_NONE, NULL); }
+#line 2787 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 34: /* function_parameter ::= datatype IDENTIFIER interpolation_mod initializer */
+#line 146 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, MOJOSHADER_AST_INPUTMOD_NONE, yymsp[-3].minor.yy37, yymsp[-2].minor.yy0.string, NULL, yymsp[-1].minor.yy111, yymsp[0].minor.yy322); }
+#line 2792 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 35: /* function_parameter ::= datatype IDENTIFIER interpolation_mod */
+#line 147 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, MOJOSHADER_AST_INPUTMOD_NONE, yymsp[-2].minor.yy37, yymsp[-1].minor.yy0.string, NULL, yymsp[0].minor.yy111, NULL); }
+#line 2797 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 36: /* function_parameter ::= datatype IDENTIFIER initializer */
+#line 148 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, MOJOSHADER_AST_INPUTMOD_NONE, yymsp[-2].minor.yy37, yymsp[-1].minor.yy0.string, NULL, MOJOSHADER_AST_INTERPMOD_NONE, yymsp[0].minor.yy322); }
+#line 2802 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 37: /* function_parameter ::= datatype IDENTIFIER */
+#line 149 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy307 = new_function_param(ctx, MOJOSHADER_AST_INPUTMOD_NONE, yymsp[-1].minor.yy37, yymsp[0].minor.yy0.string, NULL, MOJOSHADER_AST_INTERPMOD_NONE, NULL); }
+#line 2807 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 38: /* input_modifier ::= IN */
+#line 152 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy75 = MOJOSHADER_AST_INPUTMOD_IN; }
+#line 2812 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 39: /* input_modifier ::= INOUT */
+      case 41: /* input_modifier ::= IN OUT */ yytestcase(yyruleno==41);
+      case 42: /* input_modifier ::= OUT IN */ yytestcase(yyruleno==42);
+#line 153 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy75 = MOJOSHADER_AST_INPUTMOD_INOUT; }
+#line 2819 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 40: /* input_modifier ::= OUT */
+#line 154 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy75 = MOJOSHADER_AST_INPUTMOD_OUT; }
+#line 2824 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 43: /* input_modifier ::= UNIFORM */
+#line 157 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy75 = MOJOSHADER_AST_INPUTMOD_UNIFORM; }
+#line 2829 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 44: /* semantic ::= COLON IDENTIFIER */
+#line 160 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy306 = yymsp[0].minor.yy0.string; }
+#line 2834 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 45: /* interpolation_mod ::= LINEAR */
+#line 164 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy111 = MOJOSHADER_AST_INTERPMOD_LINEAR; }
+#line 2839 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 46: /* interpolation_mod ::= CENTROID */
+#line 165 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy111 = MOJOSHADER_AST_INTERPMOD_CENTROID; }
+#line 2844 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 47: /* interpolation_mod ::= NOINTERPOLATION */
+#line 166 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy111 = MOJOSHADER_AST_INTERPMOD_NOINTERPOLATION; }
+#line 2849 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 48: /* interpolation_mod ::= NOPERSPECTIVE */
+#line 167 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy111 = MOJOSHADER_AST_INTERPMOD_NOPERSPECTIVE; }
+#line 2854 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 49: /* interpolation_mod ::= SAMPLE */
+#line 168 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy111 = MOJOSHADER_AST_INTERPMOD_SAMPLE; }
+#line 2859 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 50: /* variable_declaration ::= variable_attribute_list datatype variable_declaration_details_list SEMICOLON */
+#line 171 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astVariableDeclaration, yymsp[-1].minor.yy24); yygotominor.yy24 = yymsp[-1].minor.yy24; yygotominor.yy24->attributes = yymsp[-3].minor.yy270; yygotominor.yy24->datatype = yymsp[-2].minor.yy37; }
+#line 2864 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 51: /* variable_declaration ::= datatype variable_declaration_details_list SEMICOLON */
+#line 172 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astVariableDeclaration, yymsp[-1].minor.yy24); yygotominor.yy24 = yymsp[-1].minor.yy24; yygotominor.yy24->datatype = yymsp[-2].minor.yy37; }
+#line 2869 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 52: /* variable_declaration ::= struct_declaration variable_declaration_details_list SEMICOLON */
+#line 174 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astVariableDeclaration, yymsp[-1].minor.yy24); yygotominor.yy24 = yymsp[-1].minor.yy24; yygotominor.yy24->anonymous_datatype = yymsp[-2].minor.yy249; }
+#line 2874 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 53: /* variable_attribute_list ::= variable_attribute */
+#line 177 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = yymsp[0].minor.yy270; }
+#line 2879 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 54: /* variable_attribute_list ::= variable_attribute_list variable_attribute */
+#line 178 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = yymsp[-1].minor.yy270 | yymsp[0].minor.yy270; }
+#line 2884 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 55: /* variable_attribute ::= EXTERN */
+#line 181 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_VARATTR_EXTERN; }
+#line 2889 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 56: /* variable_attribute ::= NOINTERPOLATION */
+#line 182 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_VARATTR_NOINTERPOLATION; }
+#line 2894 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 57: /* variable_attribute ::= SHARED */
+#line 183 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_VARATTR_SHARED; }
+#line 2899 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 58: /* variable_attribute ::= STATIC */
+#line 184 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_VARATTR_STATIC; }
+#line 2904 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 59: /* variable_attribute ::= UNIFORM */
+#line 185 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_VARATTR_UNIFORM; }
+#line 2909 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 60: /* variable_attribute ::= VOLATILE */
+#line 186 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_VARATTR_VOLATILE; }
+#line 2914 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 61: /* variable_attribute ::= CONST */
+#line 187 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_VARATTR_CONST; }
+#line 2919 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 62: /* variable_attribute ::= ROWMAJOR */
+#line 188 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_VARATTR_ROWMAJOR; }
+#line 2924 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 63: /* variable_attribute ::= COLUMNMAJOR */
+#line 189 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_VARATTR_COLUMNMAJOR; }
+#line 2929 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 64: /* variable_declaration_details_list ::= variable_declaration_details */
+#line 192 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = yymsp[0].minor.yy24; }
+#line 2934 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 65: /* variable_declaration_details_list ::= variable_declaration_details_list COMMA variable_declaration_details */
+#line 193 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = yymsp[0].minor.yy24; yygotominor.yy24->next = yymsp[-2].minor.yy24; }
+#line 2939 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 66: /* variable_declaration_details ::= scalar_or_array semantic annotations initializer variable_lowlevel */
+#line 196 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-4].minor.yy380, yymsp[-3].minor.yy306, yymsp[-2].minor.yy268, yymsp[-1].minor.yy322, yymsp[0].minor.yy82); }
+#line 2944 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 67: /* variable_declaration_details ::= scalar_or_array semantic annotations initializer */
+#line 197 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-3].minor.yy380, yymsp[-2].minor.yy306, yymsp[-1].minor.yy268, yymsp[0].minor.yy322, NULL); }
+#line 2949 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 68: /* variable_declaration_details ::= scalar_or_array semantic annotations variable_lowlevel */
+#line 198 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-3].minor.yy380, yymsp[-2].minor.yy306, yymsp[-1].minor.yy268, NULL, yymsp[0].minor.yy82); }
+#line 2954 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 69: /* variable_declaration_details ::= scalar_or_array semantic annotations */
+#line 199 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-2].minor.yy380, yymsp[-1].minor.yy306, yymsp[0].minor.yy268, NULL, NULL); }
+#line 2959 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 70: /* variable_declaration_details ::= scalar_or_array semantic initializer variable_lowlevel */
+#line 200 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-3].minor.yy380, yymsp[-2].minor.yy306, NULL, yymsp[-1].minor.yy322, yymsp[0].minor.yy82); }
+#line 2964 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 71: /* variable_declaration_details ::= scalar_or_array semantic initializer */
+#line 201 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-2].minor.yy380, yymsp[-1].minor.yy306, NULL, yymsp[0].minor.yy322, NULL); }
+#line 2969 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 72: /* variable_declaration_details ::= scalar_or_array semantic variable_lowlevel */
+#line 202 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-2].minor.yy380, yymsp[-1].minor.yy306, NULL, NULL, yymsp[0].minor.yy82); }
+#line 2974 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 73: /* variable_declaration_details ::= scalar_or_array semantic */
+#line 203 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-1].minor.yy380, yymsp[0].minor.yy306, NULL, NULL, NULL); }
+#line 2979 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 74: /* variable_declaration_details ::= scalar_or_array annotations initializer variable_lowlevel */
+#line 204 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-3].minor.yy380, NULL, yymsp[-2].minor.yy268, yymsp[-1].minor.yy322, yymsp[0].minor.yy82); }
+#line 2984 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 75: /* variable_declaration_details ::= scalar_or_array annotations initializer */
+#line 205 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-2].minor.yy380, NULL, yymsp[-1].minor.yy268, yymsp[0].minor.yy322, NULL); }
+#line 2989 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 76: /* variable_declaration_details ::= scalar_or_array annotations variable_lowlevel */
+#line 206 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-2].minor.yy380, NULL, yymsp[-1].minor.yy268, NULL, yymsp[0].minor.yy82); }
+#line 2994 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 77: /* variable_declaration_details ::= scalar_or_array annotations */
+#line 207 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-1].minor.yy380, NULL, yymsp[0].minor.yy268, NULL, NULL); }
+#line 2999 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 78: /* variable_declaration_details ::= scalar_or_array initializer variable_lowlevel */
+#line 208 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-2].minor.yy380, NULL, NULL, yymsp[-1].minor.yy322, yymsp[0].minor.yy82); }
+#line 3004 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 79: /* variable_declaration_details ::= scalar_or_array initializer */
+#line 209 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-1].minor.yy380, NULL, NULL, yymsp[0].minor.yy322, NULL); }
+#line 3009 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 80: /* variable_declaration_details ::= scalar_or_array variable_lowlevel */
+#line 210 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[-1].minor.yy380, NULL, NULL, NULL, yymsp[0].minor.yy82); }
+#line 3014 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 81: /* variable_declaration_details ::= scalar_or_array */
+#line 211 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy24 = new_variable_declaration(ctx, yymsp[0].minor.yy380, NULL, NULL, NULL, NULL); }
+#line 3019 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 82: /* struct_declaration ::= struct_intro LBRACE struct_member_list RBRACE */
+#line 217 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astStructMembers, yymsp[-1].minor.yy346); yygotominor.yy249 = new_struct_declaration(ctx, yymsp[-3].minor.yy306, yymsp[-1].minor.yy346); }
+#line 3024 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 83: /* struct_intro ::= STRUCT IDENTIFIER */
+#line 221 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy306 = yymsp[0].minor.yy0.string; push_usertype(ctx, yygotominor.yy306, &dt_none); }
+#line 3029 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 84: /* struct_member_list ::= struct_member */
+      case 87: /* struct_member ::= struct_member_details */ yytestcase(yyruleno==87);
+#line 224 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy346 = yymsp[0].minor.yy346; }
+#line 3035 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 85: /* struct_member_list ::= struct_member_list struct_member */
+#line 225 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy346 = yymsp[0].minor.yy346; MOJOSHADER_astStructMembers *i = yygotominor.yy346; while (i->next) { i = i->next; } i->next = yymsp[-1].minor.yy346; }
+#line 3040 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 86: /* struct_member ::= interpolation_mod struct_member_details */
+#line 228 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ MOJOSHADER_astStructMembers *i = yymsp[0].minor.yy346; yygotominor.yy346 = yymsp[0].minor.yy346; while (i) { i->interpolation_mod = yymsp[-1].minor.yy111; i = i->next; } }
+#line 3045 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 88: /* struct_member_details ::= datatype struct_member_item_list SEMICOLON */
+#line 232 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ MOJOSHADER_astStructMembers *i = yymsp[-1].minor.yy346; yygotominor.yy346 = yymsp[-1].minor.yy346; while (i) { i->datatype = yymsp[-2].minor.yy37; i = i->next; } }
+#line 3050 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 89: /* struct_member_item_list ::= scalar_or_array */
+#line 235 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy346 = new_struct_member(ctx, yymsp[0].minor.yy380, NULL); }
+#line 3055 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 90: /* struct_member_item_list ::= scalar_or_array semantic */
+#line 236 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy346 = new_struct_member(ctx, yymsp[-1].minor.yy380, yymsp[0].minor.yy306); }
+#line 3060 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 91: /* struct_member_item_list ::= struct_member_item_list COMMA IDENTIFIER */
+#line 237 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy346 = new_struct_member(ctx, new_scalar_or_array(ctx, yymsp[0].minor.yy0.string, 0, NULL), NULL); yygotominor.yy346->next = yymsp[-2].minor.yy346; yygotominor.yy346->semantic = yymsp[-2].minor.yy346->semantic; }
+#line 3065 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 92: /* variable_lowlevel ::= packoffset register */
+#line 240 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy82 = new_variable_lowlevel(ctx, yymsp[-1].minor.yy8, yymsp[0].minor.yy306); }
+#line 3070 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 93: /* variable_lowlevel ::= register packoffset */
+#line 241 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy82 = new_variable_lowlevel(ctx, yymsp[0].minor.yy8, yymsp[-1].minor.yy306); }
+#line 3075 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 94: /* variable_lowlevel ::= packoffset */
+#line 242 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy82 = new_variable_lowlevel(ctx, yymsp[0].minor.yy8, NULL); }
+#line 3080 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 95: /* variable_lowlevel ::= register */
+#line 243 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy82 = new_variable_lowlevel(ctx, NULL, yymsp[0].minor.yy306); }
+#line 3085 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 96: /* scalar_or_array ::= IDENTIFIER LBRACKET RBRACKET */
+#line 247 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy380 = new_scalar_or_array(ctx, yymsp[-2].minor.yy0.string, 1, NULL); }
+#line 3090 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 97: /* scalar_or_array ::= IDENTIFIER LBRACKET expression RBRACKET */
+#line 248 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy380 = new_scalar_or_array(ctx, yymsp[-3].minor.yy0.string, 1, yymsp[-1].minor.yy322); }
+#line 3095 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 98: /* scalar_or_array ::= IDENTIFIER */
+#line 249 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy380 = new_scalar_or_array(ctx, yymsp[0].minor.yy0.string, 0, NULL); }
+#line 3100 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 99: /* packoffset ::= COLON PACKOFFSET LPAREN IDENTIFIER DOT IDENTIFIER RPAREN */
+#line 252 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy8 = new_pack_offset(ctx, yymsp[-3].minor.yy0.string, yymsp[-1].minor.yy0.string); }
+#line 3105 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 100: /* packoffset ::= COLON PACKOFFSET LPAREN IDENTIFIER RPAREN */
+#line 253 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy8 = new_pack_offset(ctx, yymsp[-1].minor.yy0.string, NULL); }
+#line 3110 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 101: /* register ::= COLON REGISTER LPAREN IDENTIFIER RPAREN */
+#line 259 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy306 = yymsp[-1].minor.yy0.string; }
+#line 3115 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 102: /* annotations ::= LT annotation_list GT */
+#line 262 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astAnnotations, yymsp[-1].minor.yy268); yygotominor.yy268 = yymsp[-1].minor.yy268; }
+#line 3120 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 103: /* annotation_list ::= annotation */
+#line 265 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy268 = yymsp[0].minor.yy268; }
+#line 3125 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 104: /* annotation_list ::= annotation_list annotation */
+#line 266 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy268 = yymsp[0].minor.yy268; yygotominor.yy268->next = yymsp[-1].minor.yy268; }
+#line 3130 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 105: /* annotation ::= datatype_scalar initializer SEMICOLON */
+#line 270 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy268 = new_annotation(ctx, yymsp[-2].minor.yy37, yymsp[-1].minor.yy322); }
+#line 3135 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 106: /* initializer_block_list ::= expression */
+      case 110: /* initializer ::= ASSIGN initializer_block */ yytestcase(yyruleno==110);
+      case 111: /* initializer ::= ASSIGN expression */ yytestcase(yyruleno==111);
+      case 224: /* postfix_expr ::= primary_expr */ yytestcase(yyruleno==224);
+      case 235: /* unary_expr ::= postfix_expr */ yytestcase(yyruleno==235);
+      case 238: /* unary_expr ::= PLUS cast_expr */ yytestcase(yyruleno==238);
+      case 242: /* cast_expr ::= unary_expr */ yytestcase(yyruleno==242);
+      case 244: /* multiplicative_expr ::= cast_expr */ yytestcase(yyruleno==244);
+      case 248: /* additive_expr ::= multiplicative_expr */ yytestcase(yyruleno==248);
+      case 251: /* shift_expr ::= additive_expr */ yytestcase(yyruleno==251);
+      case 254: /* relational_expr ::= shift_expr */ yytestcase(yyruleno==254);
+      case 259: /* equality_expr ::= relational_expr */ yytestcase(yyruleno==259);
+      case 262: /* and_expr ::= equality_expr */ yytestcase(yyruleno==262);
+      case 264: /* exclusive_or_expr ::= and_expr */ yytestcase(yyruleno==264);
+      case 266: /* inclusive_or_expr ::= exclusive_or_expr */ yytestcase(yyruleno==266);
+      case 268: /* logical_and_expr ::= inclusive_or_expr */ yytestcase(yyruleno==268);
+      case 270: /* logical_or_expr ::= logical_and_expr */ yytestcase(yyruleno==270);
+      case 272: /* conditional_expr ::= logical_or_expr */ yytestcase(yyruleno==272);
+      case 274: /* assignment_expr ::= conditional_expr */ yytestcase(yyruleno==274);
+      case 286: /* expression ::= assignment_expr */ yytestcase(yyruleno==286);
+#line 273 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = yymsp[0].minor.yy322; }
+#line 3159 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 107: /* initializer_block_list ::= LBRACE initializer_block_list RBRACE */
+      case 109: /* initializer_block ::= LBRACE initializer_block_list RBRACE */ yytestcase(yyruleno==109);
+      case 223: /* primary_expr ::= LPAREN expression RPAREN */ yytestcase(yyruleno==223);
+#line 274 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = yymsp[-1].minor.yy322; }
+#line 3166 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 108: /* initializer_block_list ::= initializer_block_list COMMA initializer_block_list */
+      case 287: /* expression ::= expression COMMA assignment_expr */ yytestcase(yyruleno==287);
+#line 275 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_COMMA, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3172 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 112: /* intrinsic_datatype ::= datatype_vector */
+      case 113: /* intrinsic_datatype ::= datatype_matrix */ yytestcase(yyruleno==113);
+      case 114: /* intrinsic_datatype ::= datatype_scalar */ yytestcase(yyruleno==114);
+      case 115: /* intrinsic_datatype ::= datatype_sampler */ yytestcase(yyruleno==115);
+      case 116: /* intrinsic_datatype ::= datatype_buffer */ yytestcase(yyruleno==116);
+      case 117: /* datatype ::= intrinsic_datatype */ yytestcase(yyruleno==117);
+#line 285 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = yymsp[0].minor.yy37; }
+#line 3182 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 118: /* datatype ::= USERTYPE */
+#line 293 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = yymsp[0].minor.yy0.datatype; }
+#line 3187 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 119: /* datatype_sampler ::= SAMPLER */
+      case 121: /* datatype_sampler ::= SAMPLER2D */ yytestcase(yyruleno==121);
+#line 296 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_sampler2d; }
+#line 3193 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 120: /* datatype_sampler ::= SAMPLER1D */
+#line 297 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_sampler1d; }
+#line 3198 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 122: /* datatype_sampler ::= SAMPLER3D */
+#line 299 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_sampler3d; }
+#line 3203 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 123: /* datatype_sampler ::= SAMPLERCUBE */
+#line 300 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_samplercube; }
+#line 3208 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 124: /* datatype_sampler ::= SAMPLER_STATE */
+      case 125: /* datatype_sampler ::= SAMPLERSTATE */ yytestcase(yyruleno==125);
+#line 301 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_samplerstate; }
+#line 3214 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 126: /* datatype_sampler ::= SAMPLERCOMPARISONSTATE */
+#line 303 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_samplercompstate; }
+#line 3219 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 127: /* datatype_scalar ::= BOOL */
+#line 306 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_bool; }
+#line 3224 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 128: /* datatype_scalar ::= INT */
+#line 307 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_int; }
+#line 3229 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 129: /* datatype_scalar ::= UINT */
+#line 308 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_uint; }
+#line 3234 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 130: /* datatype_scalar ::= HALF */
+#line 309 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_half; }
+#line 3239 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 131: /* datatype_scalar ::= FLOAT */
+#line 310 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_float; }
+#line 3244 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 132: /* datatype_scalar ::= DOUBLE */
+#line 311 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_double; }
+#line 3249 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 133: /* datatype_scalar ::= STRING */
+#line 312 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_string; }
+#line 3254 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 134: /* datatype_scalar ::= SNORM FLOAT */
+#line 313 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_float_snorm; }
+#line 3259 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 135: /* datatype_scalar ::= UNORM FLOAT */
+#line 314 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_float_unorm; }
+#line 3264 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 136: /* datatype_buffer ::= BUFFER LT BOOL GT */
+#line 317 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_buf_bool; }
+#line 3269 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 137: /* datatype_buffer ::= BUFFER LT INT GT */
+#line 318 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_buf_int; }
+#line 3274 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 138: /* datatype_buffer ::= BUFFER LT UINT GT */
+#line 319 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_buf_uint; }
+#line 3279 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 139: /* datatype_buffer ::= BUFFER LT HALF GT */
+#line 320 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_buf_half; }
+#line 3284 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 140: /* datatype_buffer ::= BUFFER LT FLOAT GT */
+#line 321 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_buf_float; }
+#line 3289 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 141: /* datatype_buffer ::= BUFFER LT DOUBLE GT */
+#line 322 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_buf_double; }
+#line 3294 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 142: /* datatype_buffer ::= BUFFER LT SNORM FLOAT GT */
+#line 323 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_buf_float_snorm; }
+#line 3299 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 143: /* datatype_buffer ::= BUFFER LT UNORM FLOAT GT */
+#line 324 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = &dt_buf_float_unorm; }
+#line 3304 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 144: /* datatype_vector ::= VECTOR LT datatype_scalar COMMA INT_CONSTANT GT */
+#line 327 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = new_datatype_vector(ctx, yymsp[-3].minor.yy37, (int) yymsp[-1].minor.yy0.i64); }
+#line 3309 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 145: /* datatype_matrix ::= MATRIX LT datatype_scalar COMMA INT_CONSTANT COMMA INT_CONSTANT GT */
+#line 330 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy37 = new_datatype_matrix(ctx, yymsp[-5].minor.yy37, (int) yymsp[-3].minor.yy0.i64, (int) yymsp[-1].minor.yy0.i64); }
+#line 3314 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 146: /* statement_block ::= LBRACE RBRACE */
+#line 333 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_block_statement(ctx, NULL); }
+#line 3319 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 147: /* statement_block ::= LBRACE statement_list RBRACE */
+#line 334 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astStatement, yymsp[-1].minor.yy233); yygotominor.yy233 = new_block_statement(ctx, yymsp[-1].minor.yy233); }
+#line 3324 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 148: /* statement_list ::= statement */
+      case 172: /* statement ::= statement_block */ yytestcase(yyruleno==172);
+      case 173: /* statement ::= for_statement */ yytestcase(yyruleno==173);
+#line 337 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = yymsp[0].minor.yy233; }
+#line 3331 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 149: /* statement_list ::= statement_list statement */
+#line 338 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = yymsp[0].minor.yy233; yygotominor.yy233->next = yymsp[-1].minor.yy233; }
+#line 3336 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 150: /* statement_attribute ::= ISOLATE */
+      case 151: /* statement_attribute ::= MAXINSTRUCTIONCOUNT LPAREN INT_CONSTANT RPAREN */ yytestcase(yyruleno==151);
+      case 152: /* statement_attribute ::= NOEXPRESSIONOPTIMIZATIONS */ yytestcase(yyruleno==152);
+      case 153: /* statement_attribute ::= REMOVEUNUSEDINPUTS */ yytestcase(yyruleno==153);
+      case 154: /* statement_attribute ::= UNUSED */ yytestcase(yyruleno==154);
+      case 155: /* statement_attribute ::= XPS */ yytestcase(yyruleno==155);
+      case 176: /* while_intro ::= LBRACKET LOOP RBRACKET WHILE */ yytestcase(yyruleno==176);
+      case 181: /* for_intro ::= LBRACKET LOOP RBRACKET FOR */ yytestcase(yyruleno==181);
+      case 197: /* do_intro ::= LBRACKET LOOP RBRACKET DO */ yytestcase(yyruleno==197);
+#line 344 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = 0; }
+#line 3349 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 156: /* statement ::= BREAK SEMICOLON */
+#line 352 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_break_statement(ctx); }
+#line 3354 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 157: /* statement ::= CONTINUE SEMICOLON */
+#line 353 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_continue_statement(ctx); }
+#line 3359 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 158: /* statement ::= DISCARD SEMICOLON */
+#line 354 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_discard_statement(ctx); }
+#line 3364 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 159: /* statement ::= LBRACKET statement_attribute RBRACKET statement_block */
+#line 355 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = yymsp[0].minor.yy233; /* !!! FIXME: yygotominor.yy233->attributes = yymsp[-2].minor.yy270;*/ yymsp[-2].minor.yy270 = 0; }
+#line 3369 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 160: /* statement ::= variable_declaration */
+#line 356 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_vardecl_statement(ctx, yymsp[0].minor.yy24); }
+#line 3374 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 161: /* statement ::= struct_declaration SEMICOLON */
+#line 357 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_struct_statement(ctx, yymsp[-1].minor.yy249); }
+#line 3379 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 162: /* statement ::= do_intro statement WHILE LPAREN expression RPAREN SEMICOLON */
+#line 358 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_do_statement(ctx, yymsp[-6].minor.yy270, yymsp[-5].minor.yy233, yymsp[-2].minor.yy322); }
+#line 3384 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 163: /* statement ::= while_intro LPAREN expression RPAREN statement */
+#line 359 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_while_statement(ctx, yymsp[-4].minor.yy270, yymsp[-2].minor.yy322, yymsp[0].minor.yy233); }
+#line 3389 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 164: /* statement ::= if_intro LPAREN expression RPAREN statement */
+#line 360 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_if_statement(ctx, yymsp[-4].minor.yy270, yymsp[-2].minor.yy322, yymsp[0].minor.yy233, NULL); }
+#line 3394 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 165: /* statement ::= if_intro LPAREN expression RPAREN statement ELSE statement */
+#line 361 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_if_statement(ctx, yymsp[-6].minor.yy270, yymsp[-4].minor.yy322, yymsp[-2].minor.yy233, yymsp[0].minor.yy233); }
+#line 3399 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 166: /* statement ::= switch_intro LPAREN expression RPAREN LBRACE switch_case_list RBRACE */
+#line 362 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astSwitchCases, yymsp[-1].minor.yy165); yygotominor.yy233 = new_switch_statement(ctx, yymsp[-6].minor.yy270, yymsp[-4].minor.yy322, yymsp[-1].minor.yy165); }
+#line 3404 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 167: /* statement ::= typedef */
+#line 363 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_typedef_statement(ctx, yymsp[0].minor.yy71); }
+#line 3409 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 168: /* statement ::= SEMICOLON */
+#line 364 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_empty_statement(ctx); }
+#line 3414 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 169: /* statement ::= expression SEMICOLON */
+#line 365 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_expr_statement(ctx, yymsp[-1].minor.yy322); }
+#line 3419 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 170: /* statement ::= RETURN SEMICOLON */
+#line 366 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_return_statement(ctx, NULL); }
+#line 3424 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 171: /* statement ::= RETURN expression SEMICOLON */
+#line 367 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_return_statement(ctx, yymsp[-1].minor.yy322); }
+#line 3429 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 174: /* while_intro ::= LBRACKET UNROLL LPAREN INT_CONSTANT RPAREN RBRACKET WHILE */
+      case 179: /* for_intro ::= LBRACKET UNROLL LPAREN INT_CONSTANT RPAREN RBRACKET FOR */ yytestcase(yyruleno==179);
+#line 373 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = (yymsp[-3].minor.yy0.i64 < 0) ? 0 : yymsp[-3].minor.yy0.i64; }
+#line 3435 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 175: /* while_intro ::= LBRACKET UNROLL RBRACKET WHILE */
+      case 180: /* for_intro ::= LBRACKET UNROLL RBRACKET FOR */ yytestcase(yyruleno==180);
+      case 196: /* do_intro ::= LBRACKET UNROLL RBRACKET DO */ yytestcase(yyruleno==196);
+#line 374 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = -1; }
+#line 3442 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 177: /* while_intro ::= WHILE */
+      case 182: /* for_intro ::= FOR */ yytestcase(yyruleno==182);
+      case 198: /* do_intro ::= DO */ yytestcase(yyruleno==198);
+#line 376 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = -2; }
+#line 3449 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 178: /* for_statement ::= for_intro for_details */
+#line 379 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = yymsp[0].minor.yy233; ((MOJOSHADER_astForStatement *) yygotominor.yy233)->unroll = yymsp[-1].minor.yy270; }
+#line 3454 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 183: /* for_details ::= LPAREN expression SEMICOLON expression SEMICOLON expression RPAREN statement */
+#line 388 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, NULL, yymsp[-6].minor.yy322, yymsp[-4].minor.yy322, yymsp[-2].minor.yy322, yymsp[0].minor.yy233); }
+#line 3459 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 184: /* for_details ::= LPAREN SEMICOLON SEMICOLON RPAREN statement */
+#line 389 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, NULL, NULL, NULL, NULL, yymsp[0].minor.yy233); }
+#line 3464 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 185: /* for_details ::= LPAREN SEMICOLON SEMICOLON expression RPAREN statement */
+#line 390 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, NULL, NULL, NULL, yymsp[-2].minor.yy322, yymsp[0].minor.yy233); }
+#line 3469 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 186: /* for_details ::= LPAREN SEMICOLON expression SEMICOLON RPAREN statement */
+#line 391 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, NULL, NULL, yymsp[-3].minor.yy322, NULL, yymsp[0].minor.yy233); }
+#line 3474 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 187: /* for_details ::= LPAREN SEMICOLON expression SEMICOLON expression RPAREN statement */
+#line 392 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, NULL, NULL, yymsp[-4].minor.yy322, yymsp[-2].minor.yy322, yymsp[0].minor.yy233); }
+#line 3479 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 188: /* for_details ::= LPAREN expression SEMICOLON SEMICOLON RPAREN statement */
+#line 393 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, NULL, yymsp[-4].minor.yy322, NULL, NULL, yymsp[0].minor.yy233); }
+#line 3484 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 189: /* for_details ::= LPAREN expression SEMICOLON SEMICOLON expression RPAREN statement */
+#line 394 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, NULL, yymsp[-5].minor.yy322, NULL, yymsp[-2].minor.yy322, yymsp[0].minor.yy233); }
+#line 3489 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 190: /* for_details ::= LPAREN expression SEMICOLON expression SEMICOLON RPAREN statement */
+#line 395 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, NULL, yymsp[-5].minor.yy322, yymsp[-3].minor.yy322, NULL, yymsp[0].minor.yy233); }
+#line 3494 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 191: /* for_details ::= LPAREN variable_declaration expression SEMICOLON expression RPAREN statement */
+#line 396 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, yymsp[-5].minor.yy24, NULL, yymsp[-4].minor.yy322, yymsp[-2].minor.yy322, yymsp[0].minor.yy233); }
+#line 3499 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 192: /* for_details ::= LPAREN variable_declaration SEMICOLON RPAREN statement */
+#line 397 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, yymsp[-3].minor.yy24, NULL, NULL, NULL, yymsp[0].minor.yy233); }
+#line 3504 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 193: /* for_details ::= LPAREN variable_declaration SEMICOLON expression RPAREN statement */
+#line 398 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, yymsp[-4].minor.yy24, NULL, yymsp[-2].minor.yy322, NULL, yymsp[0].minor.yy233); }
+#line 3509 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 194: /* for_details ::= LPAREN variable_declaration expression SEMICOLON RPAREN statement */
+#line 399 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy233 = new_for_statement(ctx, yymsp[-4].minor.yy24, NULL, yymsp[-3].minor.yy322, NULL, yymsp[0].minor.yy233); }
+#line 3514 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 195: /* do_intro ::= LBRACKET UNROLL LPAREN INT_CONSTANT RPAREN RBRACKET DO */
+#line 402 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = (yymsp[-3].minor.yy0.i64 < 0) ? 0 : (int) yymsp[-3].minor.yy0.i64; }
+#line 3519 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 199: /* if_intro ::= LBRACKET BRANCH RBRACKET IF */
+#line 408 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_IFATTR_BRANCH; }
+#line 3524 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 200: /* if_intro ::= LBRACKET FLATTEN RBRACKET IF */
+#line 409 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_IFATTR_FLATTEN; }
+#line 3529 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 201: /* if_intro ::= LBRACKET IFALL RBRACKET IF */
+#line 410 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_IFATTR_IFALL; }
+#line 3534 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 202: /* if_intro ::= LBRACKET IFANY RBRACKET IF */
+#line 411 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_IFATTR_IFANY; }
+#line 3539 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 203: /* if_intro ::= LBRACKET PREDICATE RBRACKET IF */
+#line 412 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_IFATTR_PREDICATE; }
+#line 3544 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 204: /* if_intro ::= LBRACKET PREDICATEBLOCK RBRACKET IF */
+#line 413 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_IFATTR_PREDICATEBLOCK; }
+#line 3549 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 205: /* if_intro ::= IF */
+#line 414 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_IFATTR_NONE; }
+#line 3554 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 206: /* switch_intro ::= LBRACKET FLATTEN RBRACKET SWITCH */
+#line 417 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_SWITCHATTR_FLATTEN; }
+#line 3559 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 207: /* switch_intro ::= LBRACKET BRANCH RBRACKET SWITCH */
+#line 418 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_SWITCHATTR_BRANCH; }
+#line 3564 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 208: /* switch_intro ::= LBRACKET FORCECASE RBRACKET SWITCH */
+#line 419 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_SWITCHATTR_FORCECASE; }
+#line 3569 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 209: /* switch_intro ::= LBRACKET CALL RBRACKET SWITCH */
+#line 420 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_SWITCHATTR_CALL; }
+#line 3574 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 210: /* switch_intro ::= SWITCH */
+#line 421 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy270 = MOJOSHADER_AST_SWITCHATTR_NONE; }
+#line 3579 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 211: /* switch_case_list ::= switch_case */
+#line 424 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy165 = yymsp[0].minor.yy165; }
+#line 3584 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 212: /* switch_case_list ::= switch_case_list switch_case */
+#line 425 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy165 = yymsp[0].minor.yy165; yygotominor.yy165->next = yymsp[-1].minor.yy165; }
+#line 3589 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 213: /* switch_case ::= CASE expression COLON statement_list */
+#line 430 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astStatement, yymsp[0].minor.yy233); yygotominor.yy165 = new_switch_case(ctx, yymsp[-2].minor.yy322, yymsp[0].minor.yy233); }
+#line 3594 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 214: /* switch_case ::= CASE expression COLON */
+#line 431 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy165 = new_switch_case(ctx, yymsp[-1].minor.yy322, NULL); }
+#line 3599 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 215: /* switch_case ::= DEFAULT COLON statement_list */
+#line 432 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astStatement, yymsp[0].minor.yy233); yygotominor.yy165 = new_switch_case(ctx, NULL, yymsp[0].minor.yy233); }
+#line 3604 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 216: /* switch_case ::= DEFAULT COLON */
+#line 433 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy165 = new_switch_case(ctx, NULL, NULL); }
+#line 3609 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 217: /* primary_expr ::= IDENTIFIER */
+#line 437 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_identifier_expr(ctx, yymsp[0].minor.yy0.string); }
+#line 3614 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 218: /* primary_expr ::= INT_CONSTANT */
+#line 438 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_literal_int_expr(ctx, yymsp[0].minor.yy0.i64); }
+#line 3619 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 219: /* primary_expr ::= FLOAT_CONSTANT */
+#line 439 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_literal_float_expr(ctx, yymsp[0].minor.yy0.dbl); }
+#line 3624 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 220: /* primary_expr ::= STRING_LITERAL */
+#line 440 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_literal_string_expr(ctx, yymsp[0].minor.yy0.string); }
+#line 3629 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 221: /* primary_expr ::= TRUE */
+#line 441 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_literal_boolean_expr(ctx, 1); }
+#line 3634 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 222: /* primary_expr ::= FALSE */
+#line 442 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_literal_boolean_expr(ctx, 0); }
+#line 3639 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 225: /* postfix_expr ::= postfix_expr LBRACKET expression RBRACKET */
+#line 447 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_DEREF_ARRAY, yymsp[-3].minor.yy322, yymsp[-1].minor.yy322); }
+#line 3644 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 226: /* postfix_expr ::= IDENTIFIER arguments */
+#line 448 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_callfunc_expr(ctx, yymsp[-1].minor.yy0.string, yymsp[0].minor.yy26); }
+#line 3649 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 227: /* postfix_expr ::= datatype arguments */
+#line 449 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_constructor_expr(ctx, yymsp[-1].minor.yy37, yymsp[0].minor.yy26); }
+#line 3654 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 228: /* postfix_expr ::= postfix_expr DOT IDENTIFIER */
+#line 450 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_deref_struct_expr(ctx, yymsp[-2].minor.yy322, yymsp[0].minor.yy0.string); }
+#line 3659 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 229: /* postfix_expr ::= postfix_expr PLUSPLUS */
+#line 451 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_unary_expr(ctx, MOJOSHADER_AST_OP_POSTINCREMENT, yymsp[-1].minor.yy322); }
+#line 3664 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 230: /* postfix_expr ::= postfix_expr MINUSMINUS */
+#line 452 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_unary_expr(ctx, MOJOSHADER_AST_OP_POSTDECREMENT, yymsp[-1].minor.yy322); }
+#line 3669 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 231: /* arguments ::= LPAREN RPAREN */
+#line 455 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy26 = NULL; }
+#line 3674 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 232: /* arguments ::= LPAREN argument_list RPAREN */
+#line 456 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ REVERSE_LINKED_LIST(MOJOSHADER_astArguments, yymsp[-1].minor.yy26); yygotominor.yy26 = yymsp[-1].minor.yy26; }
+#line 3679 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 233: /* argument_list ::= assignment_expr */
+#line 459 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy26 = new_argument(ctx, yymsp[0].minor.yy322); }
+#line 3684 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 234: /* argument_list ::= argument_list COMMA assignment_expr */
+#line 460 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy26 = new_argument(ctx, yymsp[0].minor.yy322); yygotominor.yy26->next = yymsp[-2].minor.yy26; }
+#line 3689 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 236: /* unary_expr ::= PLUSPLUS unary_expr */
+#line 464 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_unary_expr(ctx, MOJOSHADER_AST_OP_PREINCREMENT, yymsp[0].minor.yy322); }
+#line 3694 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 237: /* unary_expr ::= MINUSMINUS unary_expr */
+#line 465 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_unary_expr(ctx, MOJOSHADER_AST_OP_PREDECREMENT, yymsp[0].minor.yy322); }
+#line 3699 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 239: /* unary_expr ::= MINUS cast_expr */
+#line 467 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_unary_expr(ctx, MOJOSHADER_AST_OP_NEGATE, yymsp[0].minor.yy322); }
+#line 3704 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 240: /* unary_expr ::= COMPLEMENT cast_expr */
+#line 468 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_unary_expr(ctx, MOJOSHADER_AST_OP_COMPLEMENT, yymsp[0].minor.yy322); }
+#line 3709 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 241: /* unary_expr ::= EXCLAMATION cast_expr */
+#line 469 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_unary_expr(ctx, MOJOSHADER_AST_OP_NOT, yymsp[0].minor.yy322); }
+#line 3714 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 243: /* cast_expr ::= LPAREN datatype RPAREN cast_expr */
+#line 473 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_cast_expr(ctx, yymsp[-2].minor.yy37, yymsp[0].minor.yy322); }
+#line 3719 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 245: /* multiplicative_expr ::= multiplicative_expr STAR cast_expr */
+#line 477 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_MULTIPLY, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3724 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 246: /* multiplicative_expr ::= multiplicative_expr SLASH cast_expr */
+#line 478 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_DIVIDE, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3729 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 247: /* multiplicative_expr ::= multiplicative_expr PERCENT cast_expr */
+#line 479 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_MODULO, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3734 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 249: /* additive_expr ::= additive_expr PLUS multiplicative_expr */
+#line 483 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_ADD, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3739 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 250: /* additive_expr ::= additive_expr MINUS multiplicative_expr */
+#line 484 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_SUBTRACT, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3744 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 252: /* shift_expr ::= shift_expr LSHIFT additive_expr */
+#line 488 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_LSHIFT, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3749 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 253: /* shift_expr ::= shift_expr RSHIFT additive_expr */
+#line 489 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_RSHIFT, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3754 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 255: /* relational_expr ::= relational_expr LT shift_expr */
+#line 493 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_LESSTHAN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3759 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 256: /* relational_expr ::= relational_expr GT shift_expr */
+#line 494 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_GREATERTHAN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3764 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 257: /* relational_expr ::= relational_expr LEQ shift_expr */
+#line 495 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_LESSTHANOREQUAL, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3769 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 258: /* relational_expr ::= relational_expr GEQ shift_expr */
+#line 496 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_GREATERTHANOREQUAL, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3774 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 260: /* equality_expr ::= equality_expr EQL relational_expr */
+#line 500 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_EQUAL, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3779 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 261: /* equality_expr ::= equality_expr NEQ relational_expr */
+#line 501 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_NOTEQUAL, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3784 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 263: /* and_expr ::= and_expr AND equality_expr */
+#line 505 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_BINARYAND, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3789 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 265: /* exclusive_or_expr ::= exclusive_or_expr XOR and_expr */
+#line 509 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_BINARYXOR, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3794 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 267: /* inclusive_or_expr ::= inclusive_or_expr OR exclusive_or_expr */
+#line 513 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_BINARYOR, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3799 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 269: /* logical_and_expr ::= logical_and_expr ANDAND inclusive_or_expr */
+#line 517 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_LOGICALAND, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3804 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 271: /* logical_or_expr ::= logical_or_expr OROR logical_and_expr */
+#line 521 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_LOGICALOR, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3809 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 273: /* conditional_expr ::= logical_or_expr QUESTION logical_or_expr COLON conditional_expr */
+#line 525 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_ternary_expr(ctx, MOJOSHADER_AST_OP_CONDITIONAL, yymsp[-4].minor.yy322, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3814 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 275: /* assignment_expr ::= unary_expr ASSIGN assignment_expr */
+#line 529 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_ASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3819 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 276: /* assignment_expr ::= unary_expr MULASSIGN assignment_expr */
+#line 530 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_MULASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3824 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 277: /* assignment_expr ::= unary_expr DIVASSIGN assignment_expr */
+#line 531 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_DIVASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3829 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 278: /* assignment_expr ::= unary_expr MODASSIGN assignment_expr */
+#line 532 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_MODASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3834 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 279: /* assignment_expr ::= unary_expr ADDASSIGN assignment_expr */
+#line 533 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_ADDASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3839 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 280: /* assignment_expr ::= unary_expr SUBASSIGN assignment_expr */
+#line 534 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_SUBASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3844 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 281: /* assignment_expr ::= unary_expr LSHIFTASSIGN assignment_expr */
+#line 535 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_LSHIFTASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3849 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 282: /* assignment_expr ::= unary_expr RSHIFTASSIGN assignment_expr */
+#line 536 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_RSHIFTASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3854 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 283: /* assignment_expr ::= unary_expr ANDASSIGN assignment_expr */
+#line 537 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_ANDASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3859 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 284: /* assignment_expr ::= unary_expr XORASSIGN assignment_expr */
+#line 538 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_XORASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3864 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      case 285: /* assignment_expr ::= unary_expr ORASSIGN assignment_expr */
+#line 539 "/root/repo/mojoshader_parser_hlsl.lemon"
+{ yygotominor.yy322 = new_binary_expr(ctx, MOJOSHADER_AST_OP_ORASSIGN, yymsp[-2].minor.yy322, yymsp[0].minor.yy322); }
+#line 3869 "/root/repo/mojoshader_parser_hlsl.h"
+        break;
+      default:
+        break;
+  };
+  yygoto = yyRuleInfo[yyruleno].lhs;
+  yysize = yyRuleInfo[yyruleno].nrhs;
+  yypParser->yyidx -= yysize;
+  yyact = yy_find_reduce_action(yymsp[-yysize].stateno,(YYCODETYPE)yygoto);
+  if( yyact < YYNSTATE ){
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+    /* If we are not debugging and the reduce action popped at least
+    ** one element off the stack, then we can push the new element back
+    ** onto the stack here, and skip the stack overflow test in yy_shift().
+    ** That gives a significant speed improvement. */
+    if( yysize ){
+      yypParser->yyidx++;
+      yymsp -= yysize-1;
+      yymsp->stateno = (YYACTIONTYPE)yyact;
+      yymsp->major = (YYCODETYPE)yygoto;
+      yymsp->minor = yygotominor;
+    }else
+#endif
+    {
+      yy_shift(yypParser,yyact,yygoto,&yygotominor);
+    }
+  }else{
+    assert( yyact == YYNSTATE + YYNRULE + 1 );
+    yy_accept(yypParser);
+  }
+}
+
+/*
+** The following code executes when the parse fails
+*/
+#ifndef YYNOERRORRECOVERY
+static void yy_parse_failed(
+  yyParser *yypParser           /* The parser */
+){
+  ParseHLSLARG_FETCH;
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+  if( yyTraceFILE ){
+    fprintf(yyTraceFILE,"%sFail!\n",yyTracePrompt);
+  }
+#endif
+  while( yypParser->yyidx>=0 ) yy_pop_parser_stack(yypParser);
+  /* Here code is inserted which will be executed whenever the
+  ** parser fails */
+#line 42 "/root/repo/mojoshader_parser_hlsl.lemon"
+
+    // !!! FIXME: make this a proper fail() function.
+    fail(ctx, "Giving up. Parser is hopelessly lost...");
+#line 3921 "/root/repo/mojoshader_parser_hlsl.h"
+  ParseHLSLARG_STORE; /* Suppress warning about unused %extra_argument variable */
+}
+#endif /* YYNOERRORRECOVERY */
+
+/*
+** The following code executes when a syntax error first occurs.
+*/
+static void yy_syntax_error(
+  yyParser *yypParser,           /* The parser */
+  int yymajor,                   /* The major type of the error token */
+  YYMINORTYPE yyminor            /* The minor type of the error token */
+){
+  ParseHLSLARG_FETCH;
+#define TOKEN (yyminor.yy0)
+#line 37 "/root/repo/mojoshader_parser_hlsl.lemon"
+
+    // !!! FIXME: make this a proper fail() function.
+    fail(ctx, "Syntax error");
+#line 3940 "/root/repo/mojoshader_parser_hlsl.h"
+  ParseHLSLARG_STORE; /* Suppress warning about unused %extra_argument variable */
+}
+
+/*
+** The following is executed when the parser accepts
+*/
+static void yy_accept(
+  yyParser *yypParser           /* The parser */
+){
+  ParseHLSLARG_FETCH;
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+  if( yyTraceFILE ){
+    fprintf(yyTraceFILE,"%sAccept!\n",yyTracePrompt);
+  }
+#endif
+  while( yypParser->yyidx>=0 ) yy_pop_parser_stack(yypParser);
+  /* Here code is inserted which will be executed whenever the
+  ** parser accepts */
+  ParseHLSLARG_STORE; /* Suppress warning about unused %extra_argument variable */
+}
+
+/* The main parser program.
+** The first argument is a pointer to a structure obtained from
+** "ParseHLSLAlloc" which describes the current state of the parser.
+** The second argument is the major token number.  The third is
+** the minor token.  The fourth optional argument is whatever the
+** user wants (and specified in the grammar) and is available for
+** use by the action routines.
+**
+** Inputs:
+** <ul>
+** <li> A pointer to the parser (an opaque structure.)
+** <li> The major token number.
+** <li> The minor token number.
+** <li> An option argument of a grammar-specified type.
+** </ul>
+**
+** Outputs:
+** None.
+*/
+#if __MOJOSHADER__
+static
+#endif
+void ParseHLSL(
+  void *yyp,                   /* The parser */
+  int yymajor,                 /* The major token code number */
+  ParseHLSLTOKENTYPE yyminor       /* The value for the token */
+  ParseHLSLARG_PDECL               /* Optional %extra_argument parameter */
+){
+  YYMINORTYPE yyminorunion;
+  int yyact;            /* The parser action. */
+  int yyendofinput;     /* True if we are at the end of input */
+#ifdef YYERRORSYMBOL
+  int yyerrorhit = 0;   /* True if yymajor has invoked an error */
+#endif
+  yyParser *yypParser;  /* The parser */
+
+  /* (re)initialize the parser, if necessary */
+  yypParser = (yyParser*)yyp;
+  if( yypParser->yyidx<0 ){
+#if YYSTACKDEPTH<=0
+    if( yypParser->yystksz <=0 ){
+      /*memset(&yyminorunion, 0, sizeof(yyminorunion));*/
+      yyminorunion = yyzerominor;
+      yyStackOverflow(yypParser, &yyminorunion);
+      return;
+    }
+#endif
+    yypParser->yyidx = 0;
+    yypParser->yyerrcnt = -1;
+    yypParser->yystack[0].stateno = 0;
+    yypParser->yystack[0].major = 0;
+  }
+  yyminorunion.yy0 = yyminor;
+  yyendofinput = (yymajor==0);
+  ParseHLSLARG_STORE;
+
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+  if( yyTraceFILE ){
+    fprintf(yyTraceFILE,"%sInput %s\n",yyTracePrompt,yyTokenName[yymajor]);
+  }
+#endif
+
+  do{
+    yyact = yy_find_shift_action(yypParser,(YYCODETYPE)yymajor);
+    if( yyact<YYNSTATE ){
+      assert( !yyendofinput );  /* Impossible to shift the $ token */
+      yy_shift(yypParser,yyact,yymajor,&yyminorunion);
+      yypParser->yyerrcnt--;
+      yymajor = YYNOCODE;
+    }else if( yyact < YYNSTATE + YYNRULE ){
+      yy_reduce(yypParser,yyact-YYNSTATE);
+    }else{
+      assert( yyact == YY_ERROR_ACTION );
+#ifdef YYERRORSYMBOL
+      int yymx;
+#endif
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+      if( yyTraceFILE ){
+        fprintf(yyTraceFILE,"%sSyntax Error!\n",yyTracePrompt);
+      }
+#endif
+#ifdef YYERRORSYMBOL
+      /* A syntax error has occurred.
+      ** The response to an error depends upon whether or not the
+      ** grammar defines an error token "ERROR".  
+      **
+      ** This is what we do if the grammar does define ERROR:
+      **
+      **  * Call the %syntax_error function.
+      **
+      **  * Begin popping the stack until we enter a state where
+      **    it is legal to shift the error symbol, then shift
+      **    the error symbol.
+      **
+      **  * Set the error count to three.
+      **
+      **  * Begin accepting and shifting new tokens.  No new error
+      **    processing will occur until three tokens have been
+      **    shifted successfully.
+      **
+      */
+      if( yypParser->yyerrcnt<0 ){
+        yy_syntax_error(yypParser,yymajor,yyminorunion);
+      }
+      yymx = yypParser->yystack[yypParser->yyidx].major;
+      if( yymx==YYERRORSYMBOL || yyerrorhit ){
+#if LEMON_SUPPORT_TRACING   /* __MOJOSHADER__ */
+        if( yyTraceFILE ){
+          fprintf(yyTraceFILE,"%sDiscard input token %s\n",
+             yyTracePrompt,yyTokenName[yymajor]);
+        }
+#endif
+        yy_destructor(yypParser, (YYCODETYPE)yymajor,&yyminorunion);
+        yymajor = YYNOCODE;
+      }else{
+         while(
+          yypParser->yyidx >= 0 &&
+          yymx != YYERRORSYMBOL &&
+          (yyact = yy_find_reduce_action(
+                        yypParser->yystack[yypParser->yyidx].stateno,
+                        YYERRORSYMBOL)) >= YYNSTATE
+        ){
+          yy_pop_parser_stack(yypParser);
+        }
+        if( yypParser->yyidx < 0 || yymajor==0 ){
+          yy_destructor(yypParser,(YYCODETYPE)yymajor,&yyminorunion);
+          yy_parse_failed(yypParser);
+          yymajor = YYNOCODE;
+        }else if( yymx!=YYERRORSYMBOL ){
+          YYMINORTYPE u2;
+          u2.YYERRSYMDT = 0;
+          yy_shift(yypParser,yyact,YYERRORSYMBOL,&u2);
+        }
+      }
+      yypParser->yyerrcnt = 3;
+      yyerrorhit = 1;
+#elif defined(YYNOERRORRECOVERY)
+      /* If the YYNOERRORRECOVERY macro is defined, then do not attempt to
+      ** do any kind of error recovery.  Instead, simply invoke the syntax
+      ** error routine and continue going as if nothing had happened.
+      **
+      ** Applications can set this macro (for example inside %include) if
+      ** they intend to abandon the parse upon the first syntax error seen.
+      */
+      yy_syntax_error(yypParser,yymajor,yyminorunion);
+      yy_destructor(yypParser,(YYCODETYPE)yymajor,&yyminorunion);
+      yymajor = YYNOCODE;
+      
+#else  /* YYERRORSYMBOL is not defined */
+      /* This is what we do if the grammar does not define ERROR:
+      **
+      **  * Report an error message, and throw away the input token.
+      **
+      **  * If the input token is $, then fail the parse.
+      **
+      ** As before, subsequent error messages are suppressed until
+      ** three input tokens have been successfully shifted.
+      */
+      if( yypParser->yyerrcnt<=0 ){
+        yy_syntax_error(yypParser,yymajor,yyminorunion);
+      }
+      yypParser->yyerrcnt = 3;
+      yy_destructor(yypParser,(YYCODETYPE)yymajor,&yyminorunion);
+      if( yyendofinput ){
+        yy_parse_failed(yypParser);
+      }
+      yymajor = YYNOCODE;
+#endif
+    }
+  }while( yymajor!=YYNOCODE && yypParser->yyidx>=0 );
+  return;
+}
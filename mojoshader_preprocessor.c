@@ -45,6 +45,7 @@ typedef struct Context
     int recursion_count;
     int asm_comments;
     int parsing_pragma;
+    int dependency_scan;
     Conditional *conditional_pool;
     IncludeState *include_stack;
     IncludeState *include_pool;
@@ -53,14 +54,62 @@ typedef struct Context
     Define *file_macro;
     Define *line_macro;
     StringCache *filename_cache;
+    const char *source_dir;  // in filename_cache, for include_cache_key().
+    StringMap *include_guards;
+    HashTable *guarded_files;
+    StringCache *token_strcache;
+    PreprocessorClassifier token_classifier;
+    StringMap *dependencies_seen;
+    Buffer *dependencies;
+    StringCache *macro_strcache;
+    Buffer *macro_text;
+    HideSet *hidesets;
     MOJOSHADER_includeOpen open_callback;
     MOJOSHADER_includeClose close_callback;
+    MOJOSHADER_includeCache *include_cache;
     MOJOSHADER_malloc malloc;
     MOJOSHADER_free free;
     void *malloc_data;
 } Context;
 
 
+// A token from a macro expansion. (token) points into a #define's
+//  definition, into the source we lexed it from, or into macro_text for
+//  tokens we built ourselves with the '#' and '##' operators.
+struct MacroToken
+{
+    Token tokenval;
+    const char *token;
+    unsigned int tokenlen;
+    const HideSet *hideset;
+};
+
+// The macros a token came out of, which it must not expand into again
+//  when we rescan it. These are immutable lists that share their tails,
+//  and they all live until release_expansions() throws them away.
+struct HideSet
+{
+    const char *identifier;  // in macro_strcache.
+    const HideSet *next;
+    HideSet *allocated_next;
+};
+
+typedef struct MacroTokenList
+{
+    MacroToken *tokens;
+    unsigned int count;
+    unsigned int allocated;
+} MacroTokenList;
+
+typedef struct MacroArg
+{
+    const char *identifier;
+    MacroTokenList expanded;  // object-like macros already replaced.
+    MacroTokenList original;  // as written, for '#' and '##'.
+    struct MacroArg *next;
+} MacroArg;
+
+
 // Convenience functions for allocators...
 
 static inline void out_of_memory(Context *ctx)
@@ -206,8 +255,12 @@ void MOJOSHADER_print_debug_token(const char *subsystem, const char *token,
 #include <windows.h>  // GL headers need this for WINGDIAPI definition.
 #else
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
 #endif
 
 int MOJOSHADER_internal_include_open(MOJOSHADER_includeType inctype,
@@ -292,9 +345,344 @@ void MOJOSHADER_internal_include_close(const char *data, MOJOSHADER_malloc m,
 {
     f((void *) data, d);
 } // MOJOSHADER_internal_include_close
+
+
+#ifndef _WIN32
+static size_t mmap_page_size(void)
+{
+    const long retval = sysconf(_SC_PAGESIZE);
+    return (retval > 0) ? ((size_t) retval) : 4096;
+} // mmap_page_size
+#endif
+
+// The lexer can look a few bytes past the end of its input, so a mapping
+//  that ends right on a page boundary would fault. We reserve a page on
+//  each side of the file: the one after it stays zero-filled, and the one
+//  before it remembers how big the whole reservation is, since the close
+//  callback only gets the data pointer.
+int MOJOSHADER_mmapIncludeOpen(MOJOSHADER_includeType inctype,
+                               const char *fname, const char *parent,
+                               const char **outdata, unsigned int *outbytes,
+                               MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+#ifdef _WIN32
+    // !!! FIXME: use CreateFileMapping()/MapViewOfFile() here, too.
+    return MOJOSHADER_internal_include_open(inctype, fname, parent, outdata,
+                                            outbytes, m, f, d);
+#else
+    struct stat statbuf;
+    const int fd = open(fname, O_RDONLY);
+    if (fd == -1)
+        return 0;
+    else if ( (fstat(fd, &statbuf) == -1) || (!S_ISREG(statbuf.st_mode)) ||
+              (((unsigned long long) statbuf.st_size) > 0xFFFFFFFFull) )
+    {
+        close(fd);
+        return 0;
+    } // else if
+
+    const size_t page = mmap_page_size();
+    const size_t len = (size_t) statbuf.st_size;
+    const size_t total = page + (((len + page - 1) / page) * page) + page;
+    uint8 *base = (uint8 *) mmap(NULL, total, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == (uint8 *) MAP_FAILED)
+    {
+        close(fd);
+        return 0;
+    } // if
+
+    *((size_t *) base) = total;
+
+    if (len > 0)
+    {
+        void *ptr = mmap(base + page, len, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+                         fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            munmap(base, total);
+            close(fd);
+            return 0;
+        } // if
+    } // if
+
+    close(fd);  // the mapping keeps the file alive.
+    *outdata = (const char *) (base + page);
+    *outbytes = (unsigned int) len;
+    return 1;
+#endif
+} // MOJOSHADER_mmapIncludeOpen
+
+
+void MOJOSHADER_mmapIncludeClose(const char *data, MOJOSHADER_malloc m,
+                                 MOJOSHADER_free f, void *d)
+{
+#ifdef _WIN32
+    MOJOSHADER_internal_include_close(data, m, f, d);
+#else
+    if (data != NULL)
+    {
+        uint8 *base = ((uint8 *) data) - mmap_page_size();
+        munmap(base, *((const size_t *) base));
+    } // if
+#endif
+} // MOJOSHADER_mmapIncludeClose
+
+#else  // MOJOSHADER_FORCE_INCLUDE_CALLBACKS
+
+// no filesystem access allowed, so these never find anything.
+int MOJOSHADER_mmapIncludeOpen(MOJOSHADER_includeType inctype,
+                               const char *fname, const char *parent,
+                               const char **outdata, unsigned int *outbytes,
+                               MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    return 0;
+} // MOJOSHADER_mmapIncludeOpen
+
+void MOJOSHADER_mmapIncludeClose(const char *data, MOJOSHADER_malloc m,
+                                 MOJOSHADER_free f, void *d)
+{
+} // MOJOSHADER_mmapIncludeClose
 #endif  // !MOJOSHADER_FORCE_INCLUDE_CALLBACKS
 
 
+// Include cache...
+
+// Each distinct file's bytes live in one IncludeBlob, shared by every name
+//  that resolved to the same contents.
+typedef struct IncludeBlob
+{
+    const char *data;
+    unsigned int len;
+    uint32 hash;
+    unsigned int id;  // never zero, for include_cache_key().
+} IncludeBlob;
+
+struct MOJOSHADER_includeCache
+{
+    Mutex *mutex;
+    HashTable *files;  // include_cache_key() -> IncludeBlob *
+    HashTable *blobs;  // IncludeBlob * -> IncludeBlob *, keyed by contents.
+    unsigned int blob_count;
+    MOJOSHADER_includeOpen open_callback;
+    MOJOSHADER_includeClose close_callback;
+    MOJOSHADER_malloc malloc;
+    MOJOSHADER_free free;
+    void *malloc_data;
+};
+
+static uint32 hash_hash_blob(const void *key, void *data)
+{
+    return ((const IncludeBlob *) key)->hash;
+} // hash_hash_blob
+
+static int hash_keymatch_blob(const void *a, const void *b, void *data)
+{
+    const IncludeBlob *blob1 = (const IncludeBlob *) a;
+    const IncludeBlob *blob2 = (const IncludeBlob *) b;
+    return ( (blob1->hash == blob2->hash) && (blob1->len == blob2->len) &&
+             (memcmp(blob1->data, blob2->data, blob1->len) == 0) );
+} // hash_keymatch_blob
+
+static void includecache_nuke_file(const void *key, const void *value,
+                                   void *data)
+{
+    MOJOSHADER_includeCache *cache = (MOJOSHADER_includeCache *) data;
+    cache->free((void *) key, cache->malloc_data);  // blob is owned by blobs.
+} // includecache_nuke_file
+
+static void includecache_nuke_blob(const void *key, const void *value,
+                                   void *data)
+{
+    MOJOSHADER_includeCache *cache = (MOJOSHADER_includeCache *) data;
+    IncludeBlob *blob = (IncludeBlob *) value;
+    cache->close_callback(blob->data, cache->malloc, cache->free,
+                          cache->malloc_data);
+    cache->free(blob, cache->malloc_data);
+} // includecache_nuke_blob
+
+MOJOSHADER_includeCache *MOJOSHADER_createIncludeCache(
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    if (!m) m = MOJOSHADER_internal_malloc;
+    if (!f) f = MOJOSHADER_internal_free;
+    if (!include_open) include_open = MOJOSHADER_internal_include_open;
+    if (!include_close) include_close = MOJOSHADER_internal_include_close;
+
+    MOJOSHADER_includeCache *cache;
+    cache = (MOJOSHADER_includeCache *) m(sizeof (*cache), d);
+    if (cache == NULL)
+        return NULL;
+
+    memset(cache, '\0', sizeof (*cache));
+    cache->open_callback = include_open;
+    cache->close_callback = include_close;
+    cache->malloc = m;
+    cache->free = f;
+    cache->malloc_data = d;
+
+    cache->mutex = mutex_create(m, f, d);
+    cache->files = hash_create(cache, hash_hash_string, hash_keymatch_string,
+                               includecache_nuke_file, 0, m, f, d);
+    cache->blobs = hash_create(cache, hash_hash_blob, hash_keymatch_blob,
+                               includecache_nuke_blob, 0, m, f, d);
+
+    if ((!cache->mutex) || (!cache->files) || (!cache->blobs))
+    {
+        MOJOSHADER_destroyIncludeCache(cache);
+        return NULL;
+    } // if
+
+    return cache;
+} // MOJOSHADER_createIncludeCache
+
+void MOJOSHADER_destroyIncludeCache(MOJOSHADER_includeCache *cache)
+{
+    if (cache == NULL)
+        return;
+
+    // files first: it only holds pointers to things that blobs owns.
+    if (cache->files != NULL)
+        hash_destroy(cache->files);
+    if (cache->blobs != NULL)
+        hash_destroy(cache->blobs);
+    mutex_destroy(cache->mutex);
+    cache->free(cache, cache->malloc_data);
+} // MOJOSHADER_destroyIncludeCache
+
+// Returns the cached bytes of an #include, loading them on first use.
+//  The data stays valid until the cache is destroyed, so there's no
+//  matching close call. (key) is from include_cache_key(), and (outid)
+//  gets the id that this file's own #includes should use in theirs.
+static int includecache_open(MOJOSHADER_includeCache *cache,
+                             const char *key, MOJOSHADER_includeType inctype,
+                             const char *fname, const char *parent,
+                             const char **outdata, unsigned int *outbytes,
+                             unsigned int *outid)
+{
+    const size_t keylen = strlen(key) + 1;
+    const void *value = NULL;
+    int retval = 0;
+
+    mutex_lock(cache->mutex);
+
+    if (hash_find(cache->files, key, &value))
+        retval = 1;
+    else
+    {
+        // we hold the lock while loading, so two threads missing on the same
+        //  file don't both read it. Misses should be rare.
+        const char *data = NULL;
+        unsigned int len = 0;
+        IncludeBlob *blob = NULL;
+        char *keycpy = NULL;
+
+        if ((cache->open_callback != NULL) && (cache->close_callback != NULL) &&
+            (cache->open_callback(inctype, fname, parent, &data, &len,
+                                  cache->malloc, cache->free,
+                                  cache->malloc_data)))
+        {
+            IncludeBlob tmp;
+            tmp.data = data;
+            tmp.len = len;
+            tmp.hash = hash_bytes(data, len);
+
+            if (hash_find(cache->blobs, &tmp, &value))  // same bytes as before?
+            {
+                cache->close_callback(data, cache->malloc, cache->free,
+                                      cache->malloc_data);
+                blob = (IncludeBlob *) value;
+            } // if
+            else
+            {
+                blob = (IncludeBlob *) cache->malloc(sizeof (IncludeBlob),
+                                                     cache->malloc_data);
+                if (blob != NULL)
+                {
+                    memcpy(blob, &tmp, sizeof (IncludeBlob));
+                    blob->id = ++cache->blob_count;
+                    if (hash_insert(cache->blobs, blob, blob) != 1)
+                    {
+                        cache->free(blob, cache->malloc_data);
+                        blob = NULL;
+                    } // if
+                } // if
+
+                if (blob == NULL)
+                {
+                    cache->close_callback(data, cache->malloc, cache->free,
+                                          cache->malloc_data);
+                } // if
+            } // else
+        } // if
+
+        if (blob != NULL)
+        {
+            keycpy = (char *) cache->malloc(keylen, cache->malloc_data);
+            if (keycpy != NULL)
+            {
+                memcpy(keycpy, key, keylen);
+                if (hash_insert(cache->files, keycpy, blob) != 1)
+                    cache->free(keycpy, cache->malloc_data);
+            } // if
+
+            // even if we couldn't remember the name, the blob is still valid
+            //  for the life of the cache, so this include can use it.
+            value = blob;
+            retval = 1;
+        } // if
+    } // else
+
+    mutex_unlock(cache->mutex);
+
+    if (retval)
+    {
+        const IncludeBlob *blob = (const IncludeBlob *) value;
+        *outdata = blob->data;
+        *outbytes = blob->len;
+        *outid = blob->id;
+    } // if
+
+    return retval;
+} // includecache_open
+
+
+// A guarded file's contents, and the macro that guards it. See
+//  add_include_guard().
+typedef struct GuardedFile
+{
+    const char *data;
+    unsigned int len;
+    uint32 hash;
+    const char *macro;  // in filename_cache. "" means "#pragma once".
+    int free_data;  // non-zero if (data) is our own copy.
+} GuardedFile;
+
+static uint32 hash_hash_guarded_file(const void *key, void *data)
+{
+    return ((const GuardedFile *) key)->hash;
+} // hash_hash_guarded_file
+
+static int hash_keymatch_guarded_file(const void *a, const void *b, void *data)
+{
+    const GuardedFile *file1 = (const GuardedFile *) a;
+    const GuardedFile *file2 = (const GuardedFile *) b;
+    return ( (file1->hash == file2->hash) && (file1->len == file2->len) &&
+             (memcmp(file1->data, file2->data, file1->len) == 0) );
+} // hash_keymatch_guarded_file
+
+static void nuke_guarded_file(const void *key, const void *value, void *data)
+{
+    Context *ctx = (Context *) data;
+    GuardedFile *file = (GuardedFile *) value;
+    if (file->free_data)
+        Free(ctx, (void *) file->data);
+    Free(ctx, file);
+} // nuke_guarded_file
+
+
 // !!! FIXME: maybe use these pool magic elsewhere?
 // !!! FIXME: maybe just get rid of this? (maybe the fragmentation isn't a big deal?)
 
@@ -378,7 +766,6 @@ static int add_define(Context *ctx, const char *sym, const char *val,
         return 0;
 
     bucket->definition = val;
-    bucket->original = NULL;
     bucket->identifier = sym;
     bucket->parameters = (const char **) parameters;
     bucket->paramcount = paramcount;
@@ -398,7 +785,7 @@ static void free_define(Context *ctx, Define *def)
         Free(ctx, (void *) def->parameters);
         Free(ctx, (void *) def->identifier);
         Free(ctx, (void *) def->definition);
-        Free(ctx, (void *) def->original);
+        Free(ctx, def->tokens);
         put_define(ctx, def);
     } // if
 } // free_define
@@ -451,12 +838,13 @@ static const Define *find_define(Context *ctx, const char *sym)
         const IncludeState *state = ctx->include_stack;
         const char *fname = state ? state->filename : "";
         const size_t len = strlen(fname) + 2;
-        char *str = (char *) Malloc(ctx, len);
+        char *str = (char *) Malloc(ctx, len + 1);
         if (!str)
             return NULL;
         str[0] = '\"';
         memcpy(str + 1, fname, len - 2);
         str[len - 1] = '\"';
+        str[len] = '\0';
         ctx->file_macro->definition = str;
         return ctx->file_macro;
     } // if
@@ -491,23 +879,19 @@ static const Define *find_define_by_token(Context *ctx)
 } // find_define_by_token
 
 
-static const Define *find_macro_arg(const IncludeState *state,
-                                    const Define *defines)
+static const MacroArg *find_macro_arg(const MacroToken *token,
+                                      const MacroArg *args)
 {
-    const Define *def = NULL;
-    char *sym = (char *) alloca(state->tokenlen + 1);
-    memcpy(sym, state->token, state->tokenlen);
-    sym[state->tokenlen] = '\0';
-
-    for (def = defines; def != NULL; def = def->next)
+    const MacroArg *arg = NULL;
+    for (arg = args; arg != NULL; arg = arg->next)
     {
-        assert(def->parameters == NULL);  // args can't have args!
-        assert(def->paramcount == 0);  // args can't have args!
-        if (strcmp(def->identifier, sym) == 0)
+        const char *ident = arg->identifier;
+        if ( (strlen(ident) == token->tokenlen) &&
+             (memcmp(ident, token->token, token->tokenlen) == 0) )
             break;
-    } // while
+    } // for
 
-    return def;
+    return arg;
 } // find_macro_arg
 
 
@@ -528,6 +912,264 @@ static void put_all_defines(Context *ctx)
 } // put_all_defines
 
 
+// Macro token lists...
+
+static int add_macro_token(Context *ctx, MacroTokenList *list,
+                           const Token tokenval, const char *token,
+                           const unsigned int tokenlen,
+                           const HideSet *hideset)
+{
+    if (list->count >= list->allocated)
+    {
+        const unsigned int allocated = list->allocated ? list->allocated*2 : 16;
+        MacroToken *tokens = (MacroToken *)
+                                Malloc(ctx, sizeof (MacroToken) * allocated);
+        if (tokens == NULL)
+            return 0;
+        if (list->count > 0)
+            memcpy(tokens, list->tokens, sizeof (MacroToken) * list->count);
+        Free(ctx, list->tokens);
+        list->tokens = tokens;
+        list->allocated = allocated;
+    } // if
+
+    MacroToken *item = &list->tokens[list->count++];
+    item->tokenval = tokenval;
+    item->token = token;
+    item->tokenlen = tokenlen;
+    item->hideset = hideset;
+    return 1;
+} // add_macro_token
+
+
+// Whitespace is a token here, so '#' can reproduce an argument as written.
+//  Like the lexer, we never report two in a row, and never report it first.
+static int add_macro_space(Context *ctx, MacroTokenList *list)
+{
+    if ( (list->count == 0) ||
+         (list->tokens[list->count-1].tokenval == ((Token) ' ')) )
+        return 1;
+    return add_macro_token(ctx, list, (Token) ' ', " ", 1, NULL);
+} // add_macro_space
+
+
+static void trim_macro_spaces(MacroTokenList *list)
+{
+    while ( (list->count > 0) &&
+            (list->tokens[list->count-1].tokenval == ((Token) ' ')) )
+        list->count--;
+} // trim_macro_spaces
+
+
+// This is the only place that text turns into macro tokens. (text) has to
+//  live as long as the tokens do.
+static int lex_macro_tokens(Context *ctx, MacroTokenList *list,
+                            const char *text, const unsigned int len,
+                            const int linestart, const HideSet *hideset)
+{
+    IncludeState state;
+    memset(&state, '\0', sizeof (IncludeState));
+    state.source_base = text;
+    state.source = text;
+    state.token = text;
+    state.tokenval = linestart ? ((Token) '\n') : TOKEN_UNKNOWN;
+    state.orig_length = len;
+    state.bytes_left = len;
+    state.report_whitespace = 1;
+    state.asm_comments = ctx->asm_comments;
+
+    while (1)
+    {
+        const Token token = preprocessor_lexer(&state);
+        if (token == TOKEN_EOI)
+            return 1;
+        else if (token == ((Token) ' '))
+        {
+            if (!add_macro_space(ctx, list))
+                return 0;
+        } // else if
+        else if (!add_macro_token(ctx, list, token, state.token,
+                                  state.tokenlen, hideset))
+        {
+            return 0;
+        } // else if
+    } // while
+
+    assert(0 && "shouldn't hit this code");
+    return 0;
+} // lex_macro_tokens
+
+
+// Text for tokens we make ourselves, which lives until release_expansions().
+static char *alloc_macro_text(Context *ctx, const unsigned int len)
+{
+    assert(len > 0);
+    return buffer_reserve(ctx->macro_text, len);
+} // alloc_macro_text
+
+
+// Object-like macros are lexed once and the tokens are kept with the
+//  Define. __FILE__ and __LINE__ change every time find_define() sees them,
+//  though, so they get lexed into (scratch), which the caller must free.
+static int get_macro_body(Context *ctx, const Define *_def,
+                          MacroTokenList *scratch,
+                          const MacroToken **_tokens, unsigned int *_count)
+{
+    Define *def = (Define *) _def;
+
+    if ((def == ctx->file_macro) || (def == ctx->line_macro))
+    {
+        const unsigned int len = (unsigned int) strlen(def->definition);
+        char *text = alloc_macro_text(ctx, len);
+        if (text == NULL)
+            return 0;
+        memcpy(text, def->definition, len);
+        if (!lex_macro_tokens(ctx, scratch, text, len, 1, NULL))
+            return 0;
+        *_tokens = scratch->tokens;
+        *_count = scratch->count;
+        return 1;
+    } // if
+
+    if ((def->tokens == NULL) && (*def->definition != '\0'))
+    {
+        MacroTokenList list;
+        memset(&list, '\0', sizeof (list));
+        if (!lex_macro_tokens(ctx, &list, def->definition,
+                              strlen(def->definition), 1, NULL))
+        {
+            Free(ctx, list.tokens);
+            return 0;
+        } // if
+        def->tokens = list.tokens;
+        def->tokencount = list.count;
+    } // if
+
+    *_tokens = def->tokens;
+    *_count = def->tokencount;
+    return 1;
+} // get_macro_body
+
+
+static int hideset_contains(const HideSet *hideset, const char *sym)
+{
+    for (; hideset != NULL; hideset = hideset->next)
+    {
+        if (strcmp(hideset->identifier, sym) == 0)
+            return 1;
+    } // for
+    return 0;
+} // hideset_contains
+
+
+static const HideSet *hideset_add_cached(Context *ctx,
+                                         const HideSet *hideset,
+                                         const char *cached)
+{
+    if (hideset_contains(hideset, cached))
+        return hideset;
+
+    HideSet *retval = (HideSet *) Malloc(ctx, sizeof (HideSet));
+    if (retval == NULL)
+        return NULL;
+
+    retval->identifier = cached;
+    retval->next = hideset;
+    retval->allocated_next = ctx->hidesets;
+    ctx->hidesets = retval;
+    return retval;
+} // hideset_add_cached
+
+
+// Returns NULL only if we ran out of memory.
+static const HideSet *hideset_add(Context *ctx, const HideSet *hideset,
+                                  const char *sym)
+{
+    if (hideset_contains(hideset, sym))
+        return hideset;
+
+    const char *cached = stringcache(ctx->macro_strcache, sym);
+    if (cached == NULL)
+        return NULL;
+    return hideset_add_cached(ctx, hideset, cached);
+} // hideset_add
+
+
+// Check ctx->out_of_memory, since NULL is also the empty set.
+static const HideSet *hideset_union(Context *ctx, const HideSet *a,
+                                    const HideSet *b)
+{
+    const HideSet *retval = b;
+    if ((a == NULL) || (a == b))
+        return b;
+    else if (b == NULL)
+        return a;
+
+    for (; a != NULL; a = a->next)
+    {
+        retval = hideset_add_cached(ctx, retval, a->identifier);
+        if (retval == NULL)
+            return NULL;
+    } // for
+    return retval;
+} // hideset_union
+
+
+static void free_hidesets(Context *ctx)
+{
+    HideSet *hideset = ctx->hidesets;
+    while (hideset != NULL)
+    {
+        HideSet *next = hideset->allocated_next;
+        Free(ctx, hideset);
+        hideset = next;
+    } // while
+    ctx->hidesets = NULL;
+} // free_hidesets
+
+
+// Hidesets and macro text only matter to tokens from macro expansions. Once
+//  the last expansion is off the include stack, nothing points at them (the
+//  caller is done with the last token we gave it by the time it asks for
+//  another), so we drop them all instead of holding them until the end.
+static void release_expansions(Context *ctx)
+{
+    const IncludeState *state = ctx->include_stack;
+    if ((state != NULL) && (state->tokens != NULL))
+        return;  // still in the middle of one.
+
+    free_hidesets(ctx);
+    if (buffer_size(ctx->macro_text) > 0)
+        buffer_empty(ctx->macro_text);
+} // release_expansions
+
+
+// the hideset of the token the lexer just gave us.
+static inline const HideSet *current_hideset(Context *ctx,
+                                             const IncludeState *state)
+{
+    return hideset_union(ctx, state->token_hideset, state->hideset);
+} // current_hideset
+
+
+static inline int is_hidden(const IncludeState *state, const char *sym)
+{
+    return ( (hideset_contains(state->token_hideset, sym)) ||
+             (hideset_contains(state->hideset, sym)) );
+} // is_hidden
+
+
+static int add_current_token(Context *ctx, MacroTokenList *list,
+                             const IncludeState *state)
+{
+    const HideSet *hideset = current_hideset(ctx, state);
+    if (ctx->out_of_memory)
+        return 0;
+    return add_macro_token(ctx, list, state->tokenval, state->token,
+                           state->tokenlen, hideset);
+} // add_current_token
+
+
 static int push_source(Context *ctx, const char *fname, const char *source,
                        unsigned int srclen, unsigned int linenum,
                        MOJOSHADER_includeClose close_callback)
@@ -565,6 +1207,45 @@ static int push_source(Context *ctx, const char *fname, const char *source,
 } // push_source
 
 
+// Push a macro expansion. Every token in it also gets (hideset).
+static int push_macro_tokens(Context *ctx, const MacroToken *tokens,
+                             const unsigned int count, const int free_tokens,
+                             const HideSet *hideset)
+{
+    if (count == 0)  // expands to nothing? Nothing to push, then.
+    {
+        if (free_tokens)
+            Free(ctx, (void *) tokens);
+        return 1;
+    } // if
+
+    IncludeState *parent = ctx->include_stack;
+    IncludeState *state = get_include(ctx);
+    if (state == NULL)
+    {
+        if (free_tokens)
+            Free(ctx, (void *) tokens);
+        return 0;
+    } // if
+
+    state->filename = parent->filename;  // already in filename_cache.
+    state->tokens = tokens;
+    state->tokencount = count;
+    state->free_tokens = free_tokens;
+    state->hideset = hideset;
+    state->tokenval = ((Token) '\n');
+    state->line = parent->line;
+    state->next = parent;
+    state->asm_comments = ctx->asm_comments;
+
+    print_debug_lexing_position(state);
+
+    ctx->include_stack = state;
+
+    return 1;
+} // push_macro_tokens
+
+
 static void pop_source(Context *ctx)
 {
     IncludeState *state = ctx->include_stack;
@@ -580,6 +1261,9 @@ static void pop_source(Context *ctx)
 
     // state->filename is a pointer to the filename cache; don't free it here!
 
+    if (state->free_tokens)
+        Free(ctx, (void *) state->tokens);
+
     Conditional *cond = state->conditional_stack;
     while (cond)
     {
@@ -607,6 +1291,7 @@ Preprocessor *preprocessor_start(const char *fname, const char *source,
                             unsigned int sourcelen,
                             MOJOSHADER_includeOpen open_callback,
                             MOJOSHADER_includeClose close_callback,
+                            MOJOSHADER_includeCache *include_cache,
                             const MOJOSHADER_preprocessorDefine *defines,
                             unsigned int define_count, int asm_comments,
                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
@@ -628,11 +1313,42 @@ Preprocessor *preprocessor_start(const char *fname, const char *source,
     ctx->malloc_data = d;
     ctx->open_callback = open_callback;
     ctx->close_callback = close_callback;
+    ctx->include_cache = include_cache;
     ctx->asm_comments = asm_comments;
 
     ctx->filename_cache = stringcache_create(MallocBridge, FreeBridge, ctx);
     okay = ((okay) && (ctx->filename_cache != NULL));
 
+    if ((okay) && (include_cache != NULL))
+    {
+        // everything up to the last path separator, if there is one.
+        unsigned int dirlen = 0;
+        for (i = 0; (fname != NULL) && (fname[i] != '\0'); i++)
+        {
+            if ((fname[i] == '/') || (fname[i] == '\\'))
+                dirlen = i + 1;
+        } // for
+        ctx->source_dir = stringcache_len(ctx->filename_cache,
+                                          dirlen ? fname : "", dirlen);
+        okay = (ctx->source_dir != NULL);
+    } // if
+
+    ctx->macro_strcache = stringcache_create(MallocBridge, FreeBridge, ctx);
+    okay = ((okay) && (ctx->macro_strcache != NULL));
+
+    ctx->macro_text = buffer_create(4096, MallocBridge, FreeBridge, ctx);
+    okay = ((okay) && (ctx->macro_text != NULL));
+
+    // keys and values both live in filename_cache, so don't copy them.
+    ctx->include_guards = stringmap_create(0, MallocBridge, FreeBridge, ctx);
+    okay = ((okay) && (ctx->include_guards != NULL));
+
+    ctx->guarded_files = hash_create(ctx, hash_hash_guarded_file,
+                                     hash_keymatch_guarded_file,
+                                     nuke_guarded_file, 0,
+                                     MallocBridge, FreeBridge, ctx);
+    okay = ((okay) && (ctx->guarded_files != NULL));
+
     ctx->file_macro = get_define(ctx);
     okay = ((okay) && (ctx->file_macro != NULL));
     if ((okay) && (ctx->file_macro))
@@ -696,9 +1412,28 @@ void preprocessor_end(Preprocessor *_ctx)
 
     put_all_defines(ctx);
 
+    if (ctx->include_guards != NULL)
+        stringmap_destroy(ctx->include_guards);
+
+    if (ctx->guarded_files != NULL)
+        hash_destroy(ctx->guarded_files);
+
+    if (ctx->dependencies_seen != NULL)
+        stringmap_destroy(ctx->dependencies_seen);
+
+    if (ctx->dependencies != NULL)
+        buffer_destroy(ctx->dependencies);
+
     if (ctx->filename_cache != NULL)
         stringcache_destroy(ctx->filename_cache);
 
+    free_hidesets(ctx);
+    if (ctx->macro_strcache != NULL)
+        stringcache_destroy(ctx->macro_strcache);
+
+    if (ctx->macro_text != NULL)
+        buffer_destroy(ctx->macro_text);
+
     free_define(ctx, ctx->file_macro);
     free_define(ctx, ctx->line_macro);
     free_define_pool(ctx);
@@ -726,12 +1461,38 @@ static inline void pushback(IncludeState *state)
 } // pushback
 
 
+// macro expansions were lexed already; we just walk their tokens.
+static Token macro_lexer(IncludeState *state)
+{
+    while (state->tokenpos < state->tokencount)
+    {
+        const MacroToken *item = &state->tokens[state->tokenpos++];
+        if ((item->tokenval == ((Token) ' ')) && (!state->report_whitespace))
+            continue;
+        state->token = item->token;
+        state->tokenlen = item->tokenlen;
+        state->tokenval = item->tokenval;
+        state->token_hideset = item->hideset;
+        return item->tokenval;
+    } // while
+
+    state->tokenlen = 0;
+    state->tokenval = TOKEN_EOI;
+    state->token_hideset = NULL;
+    return TOKEN_EOI;
+} // macro_lexer
+
+
 static Token lexer(IncludeState *state)
 {
-    if (!state->pushedback)
-        return preprocessor_lexer(state);
-    state->pushedback = 0;
-    return state->tokenval;
+    if (state->pushedback)
+    {
+        state->pushedback = 0;
+        return state->tokenval;
+    } // if
+    else if (state->tokens != NULL)
+        return macro_lexer(state);
+    return preprocessor_lexer(state);
 } // lexer
 
 
@@ -755,6 +1516,228 @@ static int token_to_int(IncludeState *state)
 } // token_to_int
 
 
+// Multiple-include optimization, like GCC's. If the only thing in an
+//  #included file is a single #ifndef/#endif block (comments and whitespace
+//  aside), we remember the #ifndef's macro, and later #includes of that file
+//  are dropped without opening it again, as long as the macro is defined.
+//  A file that says "#pragma once" is dropped unconditionally.
+//
+// The open callback decides which file an #include means, and it might
+//  resolve "common.h" differently for two headers in different directories.
+//  So an #include is identified by its include type and name, and by the
+//  #include that brought in the file doing the including, all the way up to
+//  the top-level source. Those are the ones that we can skip without
+//  opening. A file can be reached through more than one #include, though
+//  (from two headers in the same directory, say), so we also remember what
+//  each guarded file contains, and an #include that opens the same bytes
+//  again is dropped, too.
+typedef enum
+{
+    INCLUDEGUARD_START,    // haven't seen anything significant yet.
+    INCLUDEGUARD_INSIDE,   // inside the outermost #ifndef.
+    INCLUDEGUARD_CLOSED,   // saw the matching #endif.
+    INCLUDEGUARD_INVALID   // this file isn't guarded.
+} IncludeGuardState;
+
+
+// "common.h" from "a.h" from the top-level source is "L9:L:a.hcommon.h".
+//  The length keeps the parent's key and the name from running together.
+static const char *include_guard_key(Context *ctx,
+                                     const MOJOSHADER_includeType inctype,
+                                     const char *fname)
+{
+    const char ch = (inctype == MOJOSHADER_INCLUDETYPE_LOCAL) ? 'L' : 'S';
+    const char *parent = ctx->include_stack->guard_key;
+    const char *retval = NULL;
+
+    if (parent == NULL)  // #included from the top-level source?
+        retval = stringcache_fmt(ctx->filename_cache, "%c:%s", ch, fname);
+    else
+    {
+        retval = stringcache_fmt(ctx->filename_cache, "%c%u:%s%s", ch,
+                                 (unsigned int) strlen(parent), parent, fname);
+    } // else
+
+    if (retval == NULL)
+        out_of_memory(ctx);
+    return retval;
+} // include_guard_key
+
+
+// (state) is the guarded file, which is still open.
+static void add_include_guard(Context *ctx, const IncludeState *state,
+                              const char *macro)
+{
+    // an empty macro name means "#pragma once".
+    if (stringmap_insert(ctx->include_guards, state->guard_key, macro) < 0)
+    {
+        out_of_memory(ctx);
+        return;
+    } // if
+
+    GuardedFile tmp;
+    tmp.data = state->source_base;
+    tmp.len = state->orig_length;
+    tmp.hash = hash_bytes(tmp.data, tmp.len);
+    if (hash_find(ctx->guarded_files, &tmp, NULL))
+        return;  // same bytes as a file we already know about.
+
+    // cached data outlives us, but anything else is freed when it's popped.
+    GuardedFile *file = (GuardedFile *) Malloc(ctx, sizeof (GuardedFile));
+    if (file == NULL)
+        return;
+    memcpy(file, &tmp, sizeof (GuardedFile));
+    file->macro = macro;
+    file->free_data = (state->close_callback != NULL);
+    if (file->free_data)
+    {
+        char *data = (char *) Malloc(ctx, tmp.len + 1);
+        if (data == NULL)
+        {
+            Free(ctx, file);
+            return;
+        } // if
+        memcpy(data, tmp.data, tmp.len);
+        file->data = data;
+    } // if
+
+    if (hash_insert(ctx->guarded_files, file, file) != 1)
+    {
+        out_of_memory(ctx);
+        nuke_guarded_file(file, file, ctx);
+    } // if
+} // add_include_guard
+
+
+static int guard_is_defined(Context *ctx, const char *macro)
+{
+    return ((*macro == '\0') || (find_define(ctx, macro) != NULL));
+} // guard_is_defined
+
+
+static int include_is_guarded(Context *ctx, const char *key)
+{
+    const char *macro = NULL;
+    if (!stringmap_find(ctx->include_guards, key, &macro))
+        return 0;
+    return guard_is_defined(ctx, macro);
+} // include_is_guarded
+
+
+// An #include that include_is_guarded() didn't know about might still have
+//  opened a guarded file that we got to some other way.
+static int included_file_is_guarded(Context *ctx, const char *key,
+                                    const char *data, const unsigned int len)
+{
+    const void *value = NULL;
+    GuardedFile tmp;
+    tmp.data = data;
+    tmp.len = len;
+    tmp.hash = hash_bytes(data, len);
+    if (!hash_find(ctx->guarded_files, &tmp, &value))
+        return 0;
+
+    const GuardedFile *file = (const GuardedFile *) value;
+    if (!guard_is_defined(ctx, file->macro))
+        return 0;
+
+    // don't bother opening it the next time this #include comes up.
+    if (stringmap_insert(ctx->include_guards, key, file->macro) < 0)
+        out_of_memory(ctx);
+    return 1;
+} // included_file_is_guarded
+
+
+// The include cache can't know which file an #include resolves to, only
+//  what the open callback gets to decide that with: the include type, the
+//  name, and the contents of the file doing the #including. A cached
+//  parent's contents are its blob, so "common.h" from "a.h" is
+//  "L#3:common.h", where 3 is a.h's blob id, no matter which shader got to
+//  a.h. The top-level source is different for every shader, and the
+//  callback never sees its name, so the most it can go on is where the app
+//  keeps it: we key those #includes on the directory part of the name the
+//  app gave it. "common.h" from any shader in "fx/" is "L3:fx/common.h".
+static const char *include_cache_key(Context *ctx,
+                                     const MOJOSHADER_includeType inctype,
+                                     const char *fname)
+{
+    const char ch = (inctype == MOJOSHADER_INCLUDETYPE_LOCAL) ? 'L' : 'S';
+    const IncludeState *state = ctx->include_stack;
+    const char *dir = ctx->source_dir;
+    const char *retval = NULL;
+
+    if (state->cache_id != 0)
+    {
+        retval = stringcache_fmt(ctx->filename_cache, "%c#%u:%s", ch,
+                                 state->cache_id, fname);
+    } // if
+    else
+    {
+        retval = stringcache_fmt(ctx->filename_cache, "%c%u:%s%s", ch,
+                                 (unsigned int) strlen(dir), dir, fname);
+    } // else
+
+    if (retval == NULL)
+        out_of_memory(ctx);
+    return retval;
+} // include_cache_key
+
+
+// (key) is from include_guard_key(), so the same name from two different
+//  files is two dependencies. The file doing the #including is on top of
+//  the include stack; its own entry is this one's parent.
+static void add_dependency(Context *ctx, const MOJOSHADER_includeType inctype,
+                           const char *fname, const char *key)
+{
+    if (ctx->dependencies == NULL)
+        return;  // not scanning for dependencies.
+    else if (hash_find(ctx->dependencies_seen, key, NULL))
+        return;  // already have it.
+
+    // dependencies_seen maps keys to indices in (dependencies), which isn't
+    //  a string, so this goes around stringmap_insert().
+    const char *parentkey = ctx->include_stack->guard_key;
+    const size_t index = buffer_size(ctx->dependencies) /
+                            sizeof (MOJOSHADER_includeDependency);
+    const void *parent = NULL;
+    MOJOSHADER_includeDependency dep;
+    dep.filename = stringcache(ctx->filename_cache, fname);
+    dep.include_type = inctype;
+    dep.parent = -1;
+    if ((parentkey != NULL) &&
+        (hash_find(ctx->dependencies_seen, parentkey, &parent)))
+        dep.parent = (int) (size_t) parent;
+
+    if (dep.filename == NULL)
+        out_of_memory(ctx);
+    else if (hash_insert(ctx->dependencies_seen, key, (void *) index) != 1)
+        out_of_memory(ctx);
+    else if (!buffer_append(ctx->dependencies, &dep, sizeof (dep)))
+        out_of_memory(ctx);
+} // add_dependency
+
+
+// this is called after the lexer gave us a "#pragma" token.
+static void check_pragma_once(Context *ctx)
+{
+    IncludeState *state = ctx->include_stack;
+    if (state->guard_key == NULL)
+        return;  // not an #included file.
+
+    // peek ahead, then rewind, so the pragma still goes to the caller.
+    IncludeState saved;
+    memcpy(&saved, state, sizeof (IncludeState));
+    const int once = ( (lexer(state) == TOKEN_IDENTIFIER) &&
+                       (state->tokenlen == 4) &&
+                       (memcmp(state->token, "once", 4) == 0) &&
+                       (require_newline(state)) );
+    memcpy(state, &saved, sizeof (IncludeState));
+
+    if (once)
+        add_include_guard(ctx, state, "");
+} // check_pragma_once
+
+
 static void handle_pp_include(Context *ctx)
 {
     IncludeState *state = ctx->include_stack;
@@ -794,7 +1777,10 @@ static void handle_pp_include(Context *ctx)
     if (!bogus)
     {
         state->token++;  // skip '<' or '\"'...
-        const unsigned int len = ((unsigned int) (state->source-state->token));
+        // macro expansions don't have a (source), but we have the literal.
+        const unsigned int len = (token == TOKEN_STRING_LITERAL) ?
+                        (state->tokenlen - 1) :
+                        ((unsigned int) (state->source-state->token));
         filename = (char *) alloca(len);
         memcpy(filename, state->token, len-1);
         filename[len-1] = '\0';
@@ -807,28 +1793,68 @@ static void handle_pp_include(Context *ctx)
         return;
     } // else
 
+    const char *guardkey = include_guard_key(ctx, incltype, filename);
+    if (guardkey == NULL)
+        return;  // out of memory.
+    else if (include_is_guarded(ctx, guardkey))
+        return;  // would preprocess to nothing, so don't bother opening it.
+
     const char *newdata = NULL;
     unsigned int newbytes = 0;
-    if ((ctx->open_callback == NULL) || (ctx->close_callback == NULL))
-    {
-        fail(ctx, "Saw #include, but no include callbacks defined");
-        return;
+    const char *cachekey = NULL;
+    unsigned int cacheid = 0;
+    MOJOSHADER_includeClose callback = NULL;
+
+    if (ctx->include_cache != NULL)
+    {
+        // cached data belongs to the cache, so there's no close callback.
+        cachekey = include_cache_key(ctx, incltype, filename);
+        if (cachekey == NULL)
+            return;  // out of memory.
+        else if (!includecache_open(ctx->include_cache, cachekey, incltype,
+                                    filename, state->source_base,
+                                    &newdata, &newbytes, &cacheid))
+        {
+            fail(ctx, "Include callback failed");  // !!! FIXME: better error
+            return;
+        } // else if
     } // if
+    else
+    {
+        if ((ctx->open_callback == NULL) || (ctx->close_callback == NULL))
+        {
+            fail(ctx, "Saw #include, but no include callbacks defined");
+            return;
+        } // if
+
+        if (!ctx->open_callback(incltype, filename, state->source_base,
+                                &newdata, &newbytes, ctx->malloc,
+                                ctx->free, ctx->malloc_data))
+        {
+            fail(ctx, "Include callback failed");  // !!! FIXME: better error
+            return;
+        } // if
+        callback = ctx->close_callback;
+    } // else
 
-    if (!ctx->open_callback(incltype, filename, state->source_base,
-                            &newdata, &newbytes, ctx->malloc,
-                            ctx->free, ctx->malloc_data))
+    add_dependency(ctx, incltype, filename, guardkey);
+
+    if (included_file_is_guarded(ctx, guardkey, newdata, newbytes))
     {
-        fail(ctx, "Include callback failed");  // !!! FIXME: better error
-        return;
+        if (callback != NULL)
+            callback(newdata, ctx->malloc, ctx->free, ctx->malloc_data);
     } // if
-
-    MOJOSHADER_includeClose callback = ctx->close_callback;
-    if (!push_source(ctx, filename, newdata, newbytes, 1, callback))
+    else if (!push_source(ctx, filename, newdata, newbytes, 1, callback))
     {
         assert(ctx->out_of_memory);
-        ctx->close_callback(newdata, ctx->malloc, ctx->free, ctx->malloc_data);
-    } // if
+        if (callback != NULL)
+            callback(newdata, ctx->malloc, ctx->free, ctx->malloc_data);
+    } // else if
+    else
+    {
+        ctx->include_stack->guard_key = guardkey;
+        ctx->include_stack->cache_id = cacheid;
+    } // else
 } // handle_pp_include
 
 
@@ -1220,6 +2246,22 @@ static Conditional *_handle_pp_ifdef(Context *ctx, const Token type)
     conditional->chosen = chosen;
     conditional->next = parent;
     state->conditional_stack = conditional;
+
+    // first thing in an #included file? Might be an include guard.
+    if ((type == TOKEN_PP_IFNDEF) && (parent == NULL) &&
+        (state->guard_key != NULL) &&
+        (state->guard_state == INCLUDEGUARD_START))
+    {
+        state->guard_macro = stringcache(ctx->filename_cache, sym);
+        if (state->guard_macro != NULL)
+            state->guard_state = INCLUDEGUARD_INSIDE;
+        else
+        {
+            state->guard_state = INCLUDEGUARD_INVALID;
+            out_of_memory(ctx);
+        } // else
+    } // if
+
     return conditional;
 } // _handle_pp_ifdef
 
@@ -1236,127 +2278,281 @@ static inline void handle_pp_ifndef(Context *ctx)
 } // handle_pp_ifndef
 
 
-static int replace_and_push_macro(Context *ctx, const Define *def,
-                                  const Define *params)
+// skips whitespace, since it doesn't matter in a #define's replacement list.
+static const MacroToken *next_macro_token(const MacroToken *tokens,
+                                          const unsigned int count,
+                                          unsigned int *pos)
 {
-    char *final = NULL;
+    while (++(*pos) < count)
+    {
+        if (tokens[*pos].tokenval != ((Token) ' '))
+            return &tokens[*pos];
+    } // while
+    return NULL;
+} // next_macro_token
 
-    // We push the #define and lex it, building a buffer with argument
-    //  replacement, stringification, and concatenation.
-    Buffer *buffer = buffer_create(128, MallocBridge, FreeBridge, ctx);
-    if (buffer == NULL)
-        return 0;
 
-    IncludeState *state = ctx->include_stack;
-    if (!push_source(ctx, state->filename, def->definition,
-                     strlen(def->definition), state->line, NULL))
+// Append (src) to (dst). If (paste), the first token of (src) is glued to
+//  the last token of (dst) and lexed again, as the '##' operator wants.
+//  Whatever that produces gets (hideset).
+static int paste_macro_tokens(Context *ctx, MacroTokenList *dst,
+                              const MacroToken *src, const unsigned int count,
+                              const int paste, const HideSet *hideset)
+{
+    unsigned int i = 0;
+
+    if ((paste) && (count > 0) && (dst->count > 0))
     {
-        buffer_destroy(buffer);
-        return 0;
+        const MacroToken *last = &dst->tokens[dst->count-1];
+        if ( (last->tokenval != ((Token) ' ')) &&
+             (src->tokenval != ((Token) ' ')) )
+        {
+            const unsigned int len = last->tokenlen + src->tokenlen;
+            char *text = alloc_macro_text(ctx, len);
+            if (text == NULL)
+                return 0;
+            memcpy(text, last->token, last->tokenlen);
+            memcpy(text + last->tokenlen, src->token, src->tokenlen);
+
+            dst->count--;  // replace the last token with the pasted one(s).
+            if (!lex_macro_tokens(ctx, dst, text, len, dst->count == 0,
+                                  hideset))
+                return 0;
+            i++;
+        } // if
     } // if
 
-    state = ctx->include_stack;
-    while (lexer(state) != TOKEN_EOI)
+    for (; i < count; i++)
     {
-        int wantorig = 0;
-        const Define *arg = NULL;
-
-        // put a space between tokens if we're not concatenating.
-        if (state->tokenval == TOKEN_HASHHASH)  // concatenate?
+        if (src[i].tokenval == ((Token) ' '))
         {
-            wantorig = 1;
-            lexer(state);
-            assert(state->tokenval != TOKEN_EOI);
+            if (!add_macro_space(ctx, dst))
+                return 0;
         } // if
-        else
+        else if (!add_macro_token(ctx, dst, src[i].tokenval, src[i].token,
+                                  src[i].tokenlen, src[i].hideset))
         {
-            if (buffer_size(buffer) > 0)
-            {
-                if (!buffer_append(buffer, " ", 1))
-                    goto replace_and_push_macro_failed;
-            } // if
-        } // else
+            return 0;
+        } // else if
+    } // for
+
+    return 1;
+} // paste_macro_tokens
+
 
-        const char *data = state->token;
-        unsigned int len = state->tokenlen;
+// the '#' operator.
+static int stringify_macro_token(Context *ctx, MacroTokenList *dst,
+                                 const MacroToken *token,
+                                 const MacroArg *params, const int paste,
+                                 const HideSet *hideset)
+{
+    const MacroToken *items = token;
+    unsigned int count = 1;
+    unsigned int len = 2;  // the quotes.
+    unsigned int i;
+    MacroTokenList tokens;
+    int okay = 0;
 
-        if (state->tokenval == TOKEN_HASH)  // stringify?
+    if (token->tokenval == TOKEN_IDENTIFIER)
+    {
+        const MacroArg *arg = find_macro_arg(token, params);
+        if (arg != NULL)
         {
-            lexer(state);
-            assert(state->tokenval != TOKEN_EOI);  // we checked for this.
+            items = arg->original.tokens;
+            count = arg->original.count;
+        } // if
+    } // if
 
-            if (!buffer_append(buffer, "\"", 1))
-                goto replace_and_push_macro_failed;
+    for (i = 0; i < count; i++)
+        len += items[i].tokenlen;
 
-            if (state->tokenval == TOKEN_IDENTIFIER)
-            {
-                arg = find_macro_arg(state, params);
-                if (arg != NULL)
-                {
-                    data = arg->original;
-                    len = strlen(data);
-                } // if
-            } // if
+    char *text = alloc_macro_text(ctx, len);
+    if (text == NULL)
+        return 0;
 
-            if (!buffer_append(buffer, data, len))
-                goto replace_and_push_macro_failed;
+    char *ptr = text;
+    *(ptr++) = '\"';
+    for (i = 0; i < count; i++)
+    {
+        memcpy(ptr, items[i].token, items[i].tokenlen);
+        ptr += items[i].tokenlen;
+    } // for
+    *(ptr++) = '\"';
+    assert(ptr == (text + len));
 
-            if (!buffer_append(buffer, "\"", 1))
+    memset(&tokens, '\0', sizeof (tokens));
+    okay = lex_macro_tokens(ctx, &tokens, text, len, dst->count == 0,
+                            hideset) &&
+           paste_macro_tokens(ctx, dst, tokens.tokens, tokens.count, paste,
+                              hideset);
+    Free(ctx, tokens.tokens);
+    return okay;
+} // stringify_macro_token
+
+
+// (hideset) goes on every token that came from the #define itself.
+static int replace_and_push_macro(Context *ctx, const Define *def,
+                                  const MacroArg *params,
+                                  const HideSet *hideset)
+{
+    const MacroToken *body = NULL;
+    unsigned int count = 0;
+    unsigned int i;
+    MacroTokenList scratch;
+    MacroTokenList output;
+
+    memset(&scratch, '\0', sizeof (scratch));
+    memset(&output, '\0', sizeof (output));
+
+    // We walk the #define's tokens, building a new list with argument
+    //  replacement, stringification, and concatenation.
+    if (!get_macro_body(ctx, def, &scratch, &body, &count))
+        goto replace_and_push_macro_failed;
+
+    for (i = 0; i < count; i++)
+    {
+        const MacroToken *token = &body[i];
+        const MacroArg *arg = NULL;
+        int paste = 0;
+
+        if (token->tokenval == ((Token) ' '))
+            continue;
+
+        // put a space between tokens if we're not concatenating.
+        if (token->tokenval == TOKEN_HASHHASH)  // concatenate?
+        {
+            paste = 1;
+            token = next_macro_token(body, count, &i);
+            assert(token != NULL);  // handle_pp_define() checked for this.
+            if (token == NULL)
+                break;
+        } // if
+        else if (output.count > 0)
+        {
+            if (!add_macro_space(ctx, &output))
                 goto replace_and_push_macro_failed;
+        } // else if
 
+        if (token->tokenval == TOKEN_HASH)  // stringify?
+        {
+            token = next_macro_token(body, count, &i);
+            assert(token != NULL);  // we checked for this.
+            if (token == NULL)
+                break;
+            if (!stringify_macro_token(ctx, &output, token, params, paste,
+                                       hideset))
+                goto replace_and_push_macro_failed;
             continue;
         } // if
 
-        if (state->tokenval == TOKEN_IDENTIFIER)
+        if (token->tokenval == TOKEN_IDENTIFIER)
+            arg = find_macro_arg(token, params);
+
+        if (arg == NULL)
         {
-            arg = find_macro_arg(state, params);
-            if (arg != NULL)
+            MacroToken item;
+            memcpy(&item, token, sizeof (MacroToken));
+            item.hideset = hideset;
+            if (!paste_macro_tokens(ctx, &output, &item, 1, paste, hideset))
+                goto replace_and_push_macro_failed;
+        } // if
+        else
+        {
+            int wantorig = paste;
+            if (!wantorig)
             {
-                if (!wantorig)
-                {
-                    wantorig = (lexer(state) == TOKEN_HASHHASH);
-                    pushback(state);
-                } // if
-                data = wantorig ? arg->original : arg->definition;
-                len = strlen(data);
+                unsigned int peek = i;
+                const MacroToken *next = next_macro_token(body, count, &peek);
+                wantorig = ((next) && (next->tokenval == TOKEN_HASHHASH));
             } // if
-        } // if
 
-        if (!buffer_append(buffer, data, len))
-            goto replace_and_push_macro_failed;
-    } // while
+            const MacroTokenList *list;
+            list = wantorig ? &arg->original : &arg->expanded;
+            if (!paste_macro_tokens(ctx, &output, list->tokens,
+                                    list->count, paste, hideset))
+                goto replace_and_push_macro_failed;
+        } // else
+    } // for
+
+    // arguments keep their own hidesets, since they haven't been rescanned
+    //  yet, so this isn't pushed with a hideset for the whole list.
+    Free(ctx, scratch.tokens);
+    return push_macro_tokens(ctx, output.tokens, output.count, 1, NULL);
+
+replace_and_push_macro_failed:
+    Free(ctx, scratch.tokens);
+    Free(ctx, output.tokens);
+    return 0;
+} // replace_and_push_macro
+
+
+// Object-like macros in arguments get replaced up front, and the rest are
+//  handled when the expansion is rescanned.
+static int add_macro_body(Context *ctx, MacroTokenList *list,
+                          const IncludeState *state, const Define *def)
+{
+    const MacroToken *body = NULL;
+    unsigned int count = 0;
+    unsigned int i;
+    int okay = 0;
+    MacroTokenList scratch;
+
+    memset(&scratch, '\0', sizeof (scratch));
 
-    final = buffer_flatten(buffer);
-    if (!final)
-        goto replace_and_push_macro_failed;
+    const HideSet *hideset = current_hideset(ctx, state);
+    if (!ctx->out_of_memory)
+        hideset = hideset_add(ctx, hideset, def->identifier);
 
-    buffer_destroy(buffer);
-    pop_source(ctx);  // ditch the macro.
-    state = ctx->include_stack;
-    if (!push_source(ctx, state->filename, final, strlen(final), state->line,
-                     close_define_include))
+    if ((!ctx->out_of_memory) &&
+        (get_macro_body(ctx, def, &scratch, &body, &count)))
     {
-        Free(ctx, final);
-        return 0;
+        okay = 1;
+        for (i = 0; okay && (i < count); i++)
+        {
+            if (body[i].tokenval == ((Token) ' '))
+                okay = add_macro_space(ctx, list);
+            else
+            {
+                okay = add_macro_token(ctx, list, body[i].tokenval,
+                                       body[i].token, body[i].tokenlen,
+                                       hideset);
+            } // else
+        } // for
     } // if
 
-    return 1;
+    Free(ctx, scratch.tokens);
+    return okay;
+} // add_macro_body
 
-replace_and_push_macro_failed:
-    pop_source(ctx);
-    buffer_destroy(buffer);
-    return 0;
-} // replace_and_push_macro
+
+static void free_macro_args(Context *ctx, MacroArg *args)
+{
+    while (args)
+    {
+        MacroArg *next = args->next;
+        Free(ctx, args->expanded.tokens);
+        Free(ctx, args->original.tokens);
+        Free(ctx, args);
+        args = next;
+    } // while
+} // free_macro_args
 
 
 static int handle_macro_args(Context *ctx, const char *sym, const Define *def)
 {
     int retval = 0;
     IncludeState *state = ctx->include_stack;
-    Define *params = NULL;
+    MacroArg *params = NULL;
+    const HideSet *hideset = NULL;
+    MacroTokenList expanded;
+    MacroTokenList original;
     const int expected = (def->paramcount < 0) ? 0 : def->paramcount;
     int saw_params = 0;
     IncludeState saved;  // can't pushback, we need the original token.
+
+    memset(&expanded, '\0', sizeof (expanded));
+    memset(&original, '\0', sizeof (original));
+
     memcpy(&saved, state, sizeof (IncludeState));
     if (lexer(state) != ((Token) '('))
     {
@@ -1364,25 +2560,27 @@ static int handle_macro_args(Context *ctx, const char *sym, const Define *def)
         goto handle_macro_args_failed;  // gcc abandons replacement, too.
     } // if
 
+    // the expansion can't use this macro again, nor anything that the
+    //  macro's name itself came from.
+    hideset = hideset_union(ctx, saved.token_hideset, saved.hideset);
+    if (!ctx->out_of_memory)
+        hideset = hideset_add(ctx, hideset, def->identifier);
+    if (ctx->out_of_memory)
+        goto handle_macro_args_failed;
+
     state->report_whitespace = 1;
 
     int void_call = 0;
     int paren = 1;
     while (paren > 0)
     {
-        Buffer *buffer = buffer_create(128, MallocBridge, FreeBridge, ctx);
-        Buffer *origbuffer = buffer_create(128, MallocBridge, FreeBridge, ctx);
-
         Token t = lexer(state);
 
         assert(!void_call);
 
         while (1)
         {
-            const char *origexpr = state->token;
-            unsigned int origexprlen = state->tokenlen;
-            const char *expr = state->token;
-            unsigned int exprlen = state->tokenlen;
+            int okay = 1;
 
             if (t == ((Token) '('))
                 paren++;
@@ -1400,91 +2598,70 @@ static int handle_macro_args(Context *ctx, const char *sym, const Define *def)
                     break;
             } // else if
 
-            else if (t == ((Token) ' '))
+            else if ((t == TOKEN_INCOMPLETE_COMMENT) || (t == TOKEN_EOI))
+            {
+                pushback(state);
+                fail(ctx, "Unterminated macro list");
+                goto handle_macro_args_failed;
+            } // else if
+
+            if (t == ((Token) ' '))
             {
                 // don't add whitespace to the start, so we recognize
                 //  void calls correctly.
-                origexpr = expr = " ";
-                origexprlen = (buffer_size(origbuffer) == 0) ? 0 : 1;
-                exprlen = (buffer_size(buffer) == 0) ? 0 : 1;
-            } // else if
+                okay = add_macro_space(ctx, &expanded) &&
+                       add_macro_space(ctx, &original);
+            } // if
 
             else if (t == TOKEN_IDENTIFIER)
             {
                 const Define *def = find_define_by_token(ctx);
+                okay = add_current_token(ctx, &original, state);
                 // don't replace macros with arguments so they replace correctly, later.
-                if ((def) && (def->paramcount == 0))
-                {
-                    expr = def->definition;
-                    exprlen = strlen(def->definition);
-                } // if
+                if ( (okay) && (def) && (def->paramcount == 0) &&
+                     (!is_hidden(state, def->identifier)) )
+                    okay = add_macro_body(ctx, &expanded, state, def);
+                else if (okay)
+                    okay = add_current_token(ctx, &expanded, state);
             } // else if
 
-            else if ((t == TOKEN_INCOMPLETE_COMMENT) || (t == TOKEN_EOI))
+            else
             {
-                pushback(state);
-                fail(ctx, "Unterminated macro list");
-                goto handle_macro_args_failed;
-            } // else if
-
-            assert(expr != NULL);
-
-            if (!buffer_append(buffer, expr, exprlen))
-                goto handle_macro_args_failed;
+                okay = add_current_token(ctx, &expanded, state) &&
+                       add_current_token(ctx, &original, state);
+            } // else
 
-            if (!buffer_append(origbuffer, origexpr, origexprlen))
+            if (!okay)
                 goto handle_macro_args_failed;
 
             t = lexer(state);
         } // while
 
-        if (buffer_size(buffer) == 0)
+        trim_macro_spaces(&expanded);
+        trim_macro_spaces(&original);
+
+        if (expanded.count == 0)
             void_call = ((saw_params == 0) && (paren == 0));
 
         if (saw_params < expected)
         {
-            const int origdeflen = (int) buffer_size(origbuffer);
-            char *origdefinition = buffer_flatten(origbuffer);
-            const int deflen = (int) buffer_size(buffer);
-            char *definition = buffer_flatten(buffer);
-            Define *p = get_define(ctx);
-            if ((!origdefinition) || (!definition) || (!p))
-            {
-                Free(ctx, origdefinition);
-                Free(ctx, definition);
-                buffer_destroy(origbuffer);
-                buffer_destroy(buffer);
-                free_define(ctx, p);
+            MacroArg *arg = (MacroArg *) Malloc(ctx, sizeof (MacroArg));
+            if (arg == NULL)
                 goto handle_macro_args_failed;
-            } // if
-
-            // trim any whitespace from the end of the string...
-            int i;
-            for (i = deflen - 1; i >= 0; i--)
-            {
-                if (definition[i] == ' ')
-                    definition[i] = '\0';
-                else
-                    break;
-            } // for
-
-            for (i = origdeflen - 1; i >= 0; i--)
-            {
-                if (origdefinition[i] == ' ')
-                    origdefinition[i] = '\0';
-                else
-                    break;
-            } // for
 
-            p->identifier = def->parameters[saw_params];
-            p->definition = definition;
-            p->original = origdefinition;
-            p->next = params;
-            params = p;
+            arg->identifier = def->parameters[saw_params];
+            arg->expanded = expanded;
+            arg->original = original;
+            arg->next = params;
+            params = arg;
+            memset(&expanded, '\0', sizeof (expanded));
+            memset(&original, '\0', sizeof (original));
         } // if
+        else
+        {
+            expanded.count = original.count = 0;  // reuse these buffers.
+        } // else
 
-        buffer_destroy(buffer);
-        buffer_destroy(origbuffer);
         saw_params++;
     } // while
 
@@ -1505,17 +2682,12 @@ static int handle_macro_args(Context *ctx, const char *sym, const Define *def)
     } // if
 
     // this handles arg replacement and the '##' and '#' operators.
-    retval = replace_and_push_macro(ctx, def, params);
+    retval = replace_and_push_macro(ctx, def, params, hideset);
 
 handle_macro_args_failed:
-    while (params)
-    {
-        Define *next = params->next;
-        params->identifier = NULL;
-        free_define(ctx, params);
-        params = next;
-    } // while
-
+    Free(ctx, expanded.tokens);
+    Free(ctx, original.tokens);
+    free_macro_args(ctx, params);
     state->report_whitespace = 0;
     return retval;
 } // handle_macro_args
@@ -1530,8 +2702,6 @@ static int handle_pp_identifier(Context *ctx)
     } // if
 
     IncludeState *state = ctx->include_stack;
-    const char *fname = state->filename;
-    const unsigned int line = state->line;
     char *sym = (char *) alloca(state->tokenlen+1);
     memcpy(sym, state->token, state->tokenlen);
     sym[state->tokenlen] = '\0';
@@ -1540,11 +2710,29 @@ static int handle_pp_identifier(Context *ctx)
     const Define *def = find_define(ctx, sym);
     if (def == NULL)
         return 0;   // just send the token through unchanged.
+    else if (is_hidden(state, sym))
+        return 0;   // we're inside this macro's expansion; don't recurse.
     else if (def->paramcount != 0)
         return handle_macro_args(ctx, sym, def);
 
-    const size_t deflen = strlen(def->definition);
-    return push_source(ctx, fname, def->definition, deflen, line, NULL);
+    const MacroToken *tokens = NULL;
+    unsigned int count = 0;
+    MacroTokenList scratch;
+    memset(&scratch, '\0', sizeof (scratch));
+
+    const HideSet *hideset = current_hideset(ctx, state);
+    if (!ctx->out_of_memory)
+        hideset = hideset_add(ctx, hideset, sym);
+
+    if ( (ctx->out_of_memory) ||
+         (!get_macro_body(ctx, def, &scratch, &tokens, &count)) )
+    {
+        Free(ctx, scratch.tokens);
+        return 0;
+    } // if
+
+    const int free_tokens = ((tokens != NULL) && (tokens == scratch.tokens));
+    return push_macro_tokens(ctx, tokens, count, free_tokens, hideset);
 } // handle_pp_identifier
 
 
@@ -1992,11 +3180,61 @@ static void unterminated_pp_condition(Context *ctx)
 } // unterminated_pp_condition
 
 
+// watch the tokens of an #included file for the include guard pattern.
+static void update_include_guard(Context *ctx, const Token token)
+{
+    IncludeState *state = ctx->include_stack;
+    const Conditional *cond = state->conditional_stack;
+
+    if (state->guard_key == NULL)
+        return;  // not an #included file.
+    else if (state->guard_state == INCLUDEGUARD_INVALID)
+        return;  // already gave up on this one.
+
+    switch (token)
+    {
+        // these never disqualify a file.
+        case ((Token) '\n'):
+        case ((Token) ' '):
+        case TOKEN_SINGLE_COMMENT:
+        case TOKEN_MULTI_COMMENT:
+            return;
+
+        case TOKEN_EOI:
+            if ((state->guard_state == INCLUDEGUARD_CLOSED) && (cond == NULL))
+                add_include_guard(ctx, state, state->guard_macro);
+            return;
+
+        // _handle_pp_ifdef() moves us to INSIDE if this is a guard.
+        case TOKEN_PP_IFNDEF:
+            if (state->guard_state == INCLUDEGUARD_START)
+                return;
+            break;
+
+        // the outermost #ifndef can't have other branches.
+        case TOKEN_PP_ELSE:
+        case TOKEN_PP_ELIF:
+            if ((state->guard_state == INCLUDEGUARD_INSIDE) &&
+                (cond != NULL) && (cond->next == NULL))
+                state->guard_state = INCLUDEGUARD_INVALID;
+            return;
+
+        default: break;
+    } // switch
+
+    // anything else is fine inside the guard, but nowhere else.
+    if (state->guard_state != INCLUDEGUARD_INSIDE)
+        state->guard_state = INCLUDEGUARD_INVALID;
+} // update_include_guard
+
+
 static inline const char *_preprocessor_nexttoken(Preprocessor *_ctx,
                                              unsigned int *_len, Token *_token)
 {
     Context *ctx = (Context *) _ctx;
 
+    release_expansions(ctx);
+
     while (1)
     {
         if (ctx->isfail)
@@ -2019,8 +3257,9 @@ static inline const char *_preprocessor_nexttoken(Preprocessor *_ctx,
         const int skipping = ((cond != NULL) && (cond->skipping));
 
         #if !MATCH_MICROSOFT_PREPROCESSOR
-        state->report_whitespace = 1;
-        state->report_comments = 1;
+        // a dependency scan throws the text away, so don't bother.
+        state->report_whitespace = !ctx->dependency_scan;
+        state->report_comments = !ctx->dependency_scan;
         #endif
 
         const Token token = lexer(state);
@@ -2033,6 +3272,8 @@ static inline const char *_preprocessor_nexttoken(Preprocessor *_ctx,
         if (token != TOKEN_IDENTIFIER)
             ctx->recursion_count = 0;
 
+        update_include_guard(ctx, token);
+
         if (token == TOKEN_EOI)
         {
             assert(state->bytes_left == 0);
@@ -2079,6 +3320,9 @@ static inline const char *_preprocessor_nexttoken(Preprocessor *_ctx,
         else if (token == TOKEN_PP_ENDIF)
         {
             handle_pp_endif(ctx);
+            if ( (state->guard_state == INCLUDEGUARD_INSIDE) &&
+                 (state->conditional_stack == NULL) )
+                state->guard_state = INCLUDEGUARD_CLOSED;
             continue;  // get the next thing.
         } // else if
 
@@ -2124,9 +3368,18 @@ static inline const char *_preprocessor_nexttoken(Preprocessor *_ctx,
 
         else if (token == TOKEN_PP_PRAGMA)
         {
+            check_pragma_once(ctx);
             ctx->parsing_pragma = 1;
         } // else if
 
+        // only the directives matter to a dependency scan, so we don't
+        //  expand macros or hand back anything else.
+        if (ctx->dependency_scan)
+        {
+            ctx->parsing_pragma = 0;
+            continue;
+        } // if
+
         if (token == TOKEN_IDENTIFIER)
         {
             if (handle_pp_identifier(ctx))
@@ -2175,6 +3428,45 @@ const char *preprocessor_nexttoken(Preprocessor *ctx, unsigned int *len,
 } // preprocessor_nexttoken
 
 
+void preprocessor_set_token_classes(Preprocessor *_ctx, StringCache *strcache,
+                                    PreprocessorClassifier classify)
+{
+    Context *ctx = (Context *) _ctx;
+    assert(ctx->token_classifier == NULL);  // only set this once.
+    ctx->token_strcache = strcache;
+    ctx->token_classifier = classify;
+} // preprocessor_set_token_classes
+
+
+const char *preprocessor_nexttoken_classified(Preprocessor *_ctx,
+                                   unsigned int *len, Token *token,
+                                   const char **_interned, int *_tokenclass)
+{
+    Context *ctx = (Context *) _ctx;
+    const char *retval = preprocessor_nexttoken(_ctx, len, token);
+    const char *interned = NULL;
+    int tokenclass = 0;
+    int needtext = 1;
+
+    assert(ctx->token_classifier != NULL);
+
+    if (*token == TOKEN_IDENTIFIER)
+        tokenclass = ctx->token_classifier(retval, *len, &needtext);
+
+    if ( ((*token == TOKEN_IDENTIFIER) && ((tokenclass == 0) || (needtext))) ||
+         (*token == TOKEN_STRING_LITERAL) )
+    {
+        interned = stringcache_len(ctx->token_strcache, retval, *len);
+        if (interned == NULL)
+            out_of_memory(ctx);
+    } // if
+
+    *_interned = interned;
+    *_tokenclass = tokenclass;
+    return retval;
+} // preprocessor_nexttoken_classified
+
+
 const char *preprocessor_sourcepos(Preprocessor *_ctx, unsigned int *pos)
 {
     Context *ctx = (Context *) _ctx;
@@ -2215,14 +3507,14 @@ static const MOJOSHADER_preprocessData out_of_mem_data_preprocessor = {
 };
 
 
-// public API...
-
-const MOJOSHADER_preprocessData *MOJOSHADER_preprocess(const char *filename,
+static const MOJOSHADER_preprocessData *preprocess_internal(
+                             const char *filename,
                              const char *source, unsigned int sourcelen,
                              const MOJOSHADER_preprocessorDefine *defines,
                              unsigned int define_count,
                              MOJOSHADER_includeOpen include_open,
                              MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_includeCache *include_cache,
                              MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
 {
     MOJOSHADER_preprocessData *retval = NULL;
@@ -2251,7 +3543,7 @@ const MOJOSHADER_preprocessData *MOJOSHADER_preprocess(const char *filename,
     if (!include_close) include_close = MOJOSHADER_internal_include_close;
 
     pp = preprocessor_start(filename, source, sourcelen,
-                            include_open, include_close,
+                            include_open, include_close, include_cache,
                             defines, define_count, 0, m, f, d);
     if (pp == NULL)
         goto preprocess_out_of_mem;
@@ -2366,9 +3658,92 @@ preprocess_out_of_mem:
     errorlist_destroy(errors);
     preprocessor_end(pp);
     return &out_of_mem_data_preprocessor;
+} // preprocess_internal
+
+
+// public API...
+
+const MOJOSHADER_preprocessData *MOJOSHADER_preprocess(const char *filename,
+                             const char *source, unsigned int sourcelen,
+                             const MOJOSHADER_preprocessorDefine *defines,
+                             unsigned int define_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    return preprocess_internal(filename, source, sourcelen, defines,
+                               define_count, include_open, include_close,
+                               NULL, m, f, d);
 } // MOJOSHADER_preprocess
 
 
+const MOJOSHADER_preprocessData *MOJOSHADER_preprocessWithCache(
+                             const char *filename,
+                             const char *source, unsigned int sourcelen,
+                             const MOJOSHADER_preprocessorDefine *defines,
+                             unsigned int define_count,
+                             MOJOSHADER_includeCache *cache,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    assert(cache != NULL);
+    return preprocess_internal(filename, source, sourcelen, defines,
+                               define_count, NULL, NULL, cache, m, f, d);
+} // MOJOSHADER_preprocessWithCache
+
+
+const MOJOSHADER_preprocessData *MOJOSHADER_preprocessFile(
+                             const char *filename,
+                             const MOJOSHADER_preprocessorDefine *defines,
+                             unsigned int define_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    MOJOSHADER_preprocessData *retval = NULL;
+    const char *source = NULL;
+    unsigned int sourcelen = 0;
+
+    if ((include_open == NULL) && (include_close == NULL))
+    {
+        include_open = MOJOSHADER_mmapIncludeOpen;
+        include_close = MOJOSHADER_mmapIncludeClose;
+    } // if
+
+    if (!m) m = MOJOSHADER_internal_malloc;
+    if (!f) f = MOJOSHADER_internal_free;
+
+    if (MOJOSHADER_mmapIncludeOpen(MOJOSHADER_INCLUDETYPE_LOCAL, filename,
+                                   NULL, &source, &sourcelen, m, f, d))
+    {
+        const MOJOSHADER_preprocessData *data;
+        data = preprocess_internal(filename, source, sourcelen, defines,
+                                   define_count, include_open, include_close,
+                                   NULL, m, f, d);
+        MOJOSHADER_mmapIncludeClose(source, m, f, d);
+        return data;
+    } // if
+
+    retval = (MOJOSHADER_preprocessData *) m(sizeof (*retval), d);
+    if (retval == NULL)
+        return &out_of_mem_data_preprocessor;
+
+    memset(retval, '\0', sizeof (*retval));
+    retval->errors = errorlist_single(filename, MOJOSHADER_POSITION_NONE,
+                                      "Couldn't open file", m, f, d);
+    if (retval->errors == NULL)
+    {
+        f(retval, d);
+        return &out_of_mem_data_preprocessor;
+    } // if
+
+    retval->error_count = 1;
+    retval->malloc = m;
+    retval->free = f;
+    retval->malloc_data = d;
+    return retval;
+} // MOJOSHADER_preprocessFile
+
+
 void MOJOSHADER_freePreprocessData(const MOJOSHADER_preprocessData *_data)
 {
     MOJOSHADER_preprocessData *data = (MOJOSHADER_preprocessData *) _data;
@@ -2392,5 +3767,164 @@ void MOJOSHADER_freePreprocessData(const MOJOSHADER_preprocessData *_data)
 } // MOJOSHADER_freePreprocessData
 
 
+static const MOJOSHADER_dependencyData out_of_mem_data_dependencies = {
+    1, &MOJOSHADER_out_of_mem_error, 0, 0, 0, 0, 0
+};
+
+const MOJOSHADER_dependencyData *MOJOSHADER_scanDependencies(
+                             const char *filename,
+                             const char *source, unsigned int sourcelen,
+                             const MOJOSHADER_preprocessorDefine *defines,
+                             unsigned int define_count,
+                             MOJOSHADER_includeOpen include_open,
+                             MOJOSHADER_includeClose include_close,
+                             MOJOSHADER_malloc m, MOJOSHADER_free f, void *d)
+{
+    MOJOSHADER_dependencyData *retval = NULL;
+    MOJOSHADER_includeDependency *deps = NULL;
+    Preprocessor *pp = NULL;
+    Context *ctx = NULL;
+    ErrorList *errors = NULL;
+    Token token = TOKEN_UNKNOWN;
+    const char *tokstr = NULL;
+    unsigned int len = 0;
+    int depcount = 0;
+    int errcount = 0;
+    int i;
+
+    if (!m) m = MOJOSHADER_internal_malloc;
+    if (!f) f = MOJOSHADER_internal_free;
+    if (!include_open) include_open = MOJOSHADER_internal_include_open;
+    if (!include_close) include_close = MOJOSHADER_internal_include_close;
+
+    pp = preprocessor_start(filename, source, sourcelen,
+                            include_open, include_close, NULL,
+                            defines, define_count, 0, m, f, d);
+    if (pp == NULL)
+        goto scan_out_of_mem;
+
+    ctx = (Context *) pp;
+    ctx->dependency_scan = 1;
+    ctx->dependencies_seen = stringmap_create(0, MallocBridge, FreeBridge, ctx);
+    if (ctx->dependencies_seen == NULL)
+        goto scan_out_of_mem;
+
+    ctx->dependencies = buffer_create(256, MallocBridge, FreeBridge, ctx);
+    if (ctx->dependencies == NULL)
+        goto scan_out_of_mem;
+
+    errors = errorlist_create(MallocBridge, FreeBridge, pp);
+    if (errors == NULL)
+        goto scan_out_of_mem;
+
+    // the only things that come back from a dependency scan are errors.
+    while ((tokstr = preprocessor_nexttoken(pp, &len, &token)) != NULL)
+    {
+        if (preprocessor_outofmemory(pp))
+            goto scan_out_of_mem;
+
+        assert(token == TOKEN_PREPROCESSING_ERROR);
+        unsigned int pos = 0;
+        const char *fname = preprocessor_sourcepos(pp, &pos);
+        if (!errorlist_add(errors, fname, (int) pos, tokstr))
+            goto scan_out_of_mem;
+    } // while
+
+    if (preprocessor_outofmemory(pp))
+        goto scan_out_of_mem;
+
+    retval = (MOJOSHADER_dependencyData *) m(sizeof (*retval), d);
+    if (retval == NULL)
+        goto scan_out_of_mem;
+    memset(retval, '\0', sizeof (*retval));
+    retval->malloc = m;
+    retval->free = f;
+    retval->malloc_data = d;
+
+    depcount = (int) (buffer_size(ctx->dependencies) /
+                        sizeof (MOJOSHADER_includeDependency));
+    if (depcount > 0)
+    {
+        // these have filenames from filename_cache, which we'll copy.
+        const MOJOSHADER_includeDependency *found;
+        found = (const MOJOSHADER_includeDependency *)
+                    buffer_flatten(ctx->dependencies);
+        if (found == NULL)
+            goto scan_out_of_mem;
+
+        const size_t deplen = sizeof (MOJOSHADER_includeDependency) * depcount;
+        deps = (MOJOSHADER_includeDependency *) m(deplen, d);
+        if (deps != NULL)
+        {
+            memset(deps, '\0', deplen);
+            for (i = 0; i < depcount; i++)
+            {
+                char *str = (char *) m(strlen(found[i].filename) + 1, d);
+                if (str == NULL)
+                    break;
+                strcpy(str, found[i].filename);
+                deps[i].filename = str;
+                deps[i].include_type = found[i].include_type;
+                deps[i].parent = found[i].parent;
+            } // for
+        } // if
+
+        Free(ctx, (void *) found);
+
+        retval->dependency_count = depcount;
+        retval->dependencies = deps;
+        if ((deps == NULL) || (i < depcount))
+            goto scan_out_of_mem;
+    } // if
+
+    errcount = errorlist_count(errors);
+    if (errcount > 0)
+    {
+        retval->errors = errorlist_flatten(errors);
+        if (retval->errors == NULL)
+            goto scan_out_of_mem;
+        retval->error_count = errcount;
+    } // if
+
+    errorlist_destroy(errors);
+    preprocessor_end(pp);
+    return retval;
+
+scan_out_of_mem:
+    MOJOSHADER_freeDependencyData(retval);
+    errorlist_destroy(errors);
+    preprocessor_end(pp);
+    return &out_of_mem_data_dependencies;
+} // MOJOSHADER_scanDependencies
+
+
+void MOJOSHADER_freeDependencyData(const MOJOSHADER_dependencyData *_data)
+{
+    MOJOSHADER_dependencyData *data = (MOJOSHADER_dependencyData *) _data;
+    if ((data == NULL) || (data == &out_of_mem_data_dependencies))
+        return;
+
+    MOJOSHADER_free f = (data->free == NULL) ? MOJOSHADER_internal_free : data->free;
+    void *d = data->malloc_data;
+    int i;
+
+    if (data->dependencies != NULL)
+    {
+        for (i = 0; i < data->dependency_count; i++)
+            f((void *) data->dependencies[i].filename, d);
+        f(data->dependencies, d);
+    } // if
+
+    for (i = 0; i < data->error_count; i++)
+    {
+        f((void *) data->errors[i].error, d);
+        f((void *) data->errors[i].filename, d);
+    } // for
+    f(data->errors, d);
+
+    f(data, d);
+} // MOJOSHADER_freeDependencyData
+
+
 // end of mojoshader_preprocessor.c ...
 
@@ -0,0 +1,4 @@
+#ifndef SAME_NAME_H_DIR1
+#define SAME_NAME_H_DIR1
+same_name_from_dir1
+#endif
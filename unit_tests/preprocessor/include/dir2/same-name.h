@@ -0,0 +1,2 @@
+#pragma once
+same_name_from_dir2
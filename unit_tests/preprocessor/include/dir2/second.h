@@ -0,0 +1 @@
+#include "same-name.h"
@@ -0,0 +1,8 @@
+// comments before the guard are fine.
+#ifndef GUARDED_H
+#define GUARDED_H
+
+guarded_contents
+
+#endif  // GUARDED_H
+
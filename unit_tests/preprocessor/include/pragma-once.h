@@ -0,0 +1,2 @@
+#pragma once
+pragma_once_contents
@@ -0,0 +1,5 @@
+#ifndef UNGUARDED_H
+#define UNGUARDED_H
+inside_guard
+#endif
+after_guard
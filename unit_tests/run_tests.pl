@@ -49,6 +49,21 @@ sub compare_files {
     return (1);
 }
 
+# A compiler test can pick its profile with "// profile: hlsl_vs_3_0" on its
+#  first line; otherwise it gets the compiler's default.
+sub compiler_profile {
+    my $fname = shift;
+    my $retval = '';
+    if (open(SOURCE, '<', $fname)) {
+        my $first = <SOURCE>;
+        close(SOURCE);
+        if ((defined $first) and ($first =~ /\A\/\/\s*profile:\s*(\S+)/)) {
+            $retval = " -p '$1'";
+        }
+    }
+    return $retval;
+}
+
 my %tests = ();
 
 $tests{'output'} = sub {
@@ -61,6 +76,9 @@ $tests{'output'} = sub {
     # !!! FIXME: this should go elsewhere.
     if ($module eq 'preprocessor') {
         $cmd = "$binpath/mojoshader-compiler -P '$fname' -o '$output'";
+    } elsif ($module eq 'compiler') {
+        my $profile = compiler_profile($fname);
+        $cmd = "$binpath/mojoshader-compiler$profile -S '$fname' -o '$output'";
     } else {
         return (0, "Don't know how to do this module type");
     }
@@ -91,6 +109,9 @@ $tests{'errors'} = sub {
     # !!! FIXME: this should go elsewhere.
     if ($module eq 'preprocessor') {
         $cmd = "$binpath/mojoshader-compiler -P '$fname' -o '$output'";
+    } elsif ($module eq 'compiler') {
+        my $profile = compiler_profile($fname);
+        $cmd = "$binpath/mojoshader-compiler$profile -S '$fname' -o '$output'";
     } else {
         return (0, "Don't know how to do this module type");
     }
@@ -108,6 +129,422 @@ $tests{'errors'} = sub {
     return @retval;
 };
 
+$tests{'dependencies'} = sub {
+    my ($module, $fname) = @_;
+    my $output = 'unittest_tempoutput';
+    my $desired = $fname . '.correct';
+    my $cmd = undef;
+    my $endlines = 1;
+
+    # !!! FIXME: this should go elsewhere.
+    if ($module eq 'preprocessor') {
+        $cmd = "$binpath/mojoshader-compiler -M '$fname' -o '$output'";
+    } else {
+        return (0, "Don't know how to do this module type");
+    }
+    $cmd .= ' 2>/dev/null 1>/dev/null';
+
+    print("$cmd\n") if ($GPrintCmds);
+
+    if (system($cmd) != 0) {
+        unlink($output) if (-f $output);
+        return (0, "External program reported error");
+    }
+
+    if (not -f $output) { return (0, "Didn't get any output file"); }
+
+    my @retval = compare_files($desired, $output, $endlines);
+    unlink($output);
+    return @retval;
+};
+
+# Builds bytecode with -C and checks what testparse makes of it, which covers
+#  the CTAB the assembler builds from our uniforms. testparse's banner says
+#  which build it is, so everything up to the shader's name is left out.
+$tests{'ctab'} = sub {
+    my ($module, $fname) = @_;
+    my $output = 'unittest_tempoutput';
+    my $parsed = 'unittest_tempparsed';
+    my $desired = $fname . '.correct';
+    my $endlines = 1;
+
+    if ($module ne 'compiler') {
+        return (0, "Don't know how to do this module type");
+    }
+
+    my $profile = compiler_profile($fname);
+    my $cmd = "$binpath/mojoshader-compiler$profile -C '$fname' -o '$output'";
+    $cmd .= ' 2>/dev/null 1>/dev/null';
+
+    print("$cmd\n") if ($GPrintCmds);
+
+    if (system($cmd) != 0) {
+        unlink($output) if (-f $output);
+        return (0, "External program reported error");
+    }
+
+    if (not -f $output) { return (0, "Didn't get any output file"); }
+
+    $cmd = "$binpath/testparse d3d '$output' 2>/dev/null";
+    print("$cmd\n") if ($GPrintCmds);
+    my @lines = `$cmd`;
+    unlink($output);
+    if ($? != 0) { return (0, "testparse reported error"); }
+
+    while ((scalar(@lines) > 0) and ($lines[0] !~ /\ASHADER: /)) { shift(@lines); }
+    shift(@lines);
+    if (scalar(@lines) == 0) { return (0, "testparse didn't parse anything"); }
+
+    if (not open(PARSED, '>', $parsed)) {
+        return (0, "Couldn't open '$parsed' for writing");
+    }
+    print PARSED @lines;
+    close(PARSED);
+
+    my @retval = compare_files($desired, $parsed, $endlines);
+    unlink($parsed);
+    return @retval;
+};
+
+# Compiles through an AST cache: once to fill it, once to use it, then with
+#  the cache file truncated and with it damaged, which have to be rejected.
+#  Every one of these has to produce exactly what a plain compile does.
+$tests{'astcache'} = sub {
+    my ($module, $fname) = @_;
+    my $output = 'unittest_tempoutput';
+    my $messages = 'unittest_tempmessages';
+    my $cache = 'unittest_tempastcache';
+    my $desired = $fname . '.correct';
+    my $endlines = 1;
+    my $cachelen = 0;
+
+    if ($module ne 'compiler') {
+        return (0, "Don't know how to do this module type");
+    }
+
+    unlink($cache) if (-f $cache);
+
+    foreach my $run ('fill', 'use', 'truncated', 'damaged') {
+        if ($run eq 'use') {
+            $cachelen = -s $cache;
+            if (not $cachelen) { return (0, "Didn't get an AST cache file"); }
+        } elsif ($run eq 'truncated') {
+            truncate($cache, int($cachelen / 2));
+        } elsif ($run eq 'damaged') {
+            # the first run wrote a good cache again; flip its last byte.
+            open(CACHE, '+<', $cache) or return (0, "Couldn't open '$cache'");
+            binmode(CACHE);
+            my $ch = undef;
+            seek(CACHE, -1, 2);
+            read(CACHE, $ch, 1);
+            seek(CACHE, -1, 2);
+            print CACHE chr(ord($ch) ^ 0xFF);
+            close(CACHE);
+        }
+
+        my $cmd = "$binpath/mojoshader-compiler --ast-cache '$cache' -S '$fname' -o '$output'";
+        $cmd .= " 2>/dev/null 1>$messages";
+
+        print("$cmd\n") if ($GPrintCmds);
+
+        if (system($cmd) != 0) {
+            unlink($output) if (-f $output);
+            unlink($messages, $cache);
+            return (0, "External program reported error ($run)");
+        }
+
+        my $rejected = 0;
+        if (open(MESSAGES, '<', $messages)) {
+            while (<MESSAGES>) { $rejected = 1 if (/ignoring bad AST cache/); }
+            close(MESSAGES);
+        }
+        unlink($messages);
+
+        my $damaged = (($run eq 'truncated') or ($run eq 'damaged'));
+        if ($rejected != $damaged) {
+            unlink($output) if (-f $output);
+            unlink($cache);
+            return (0, $damaged ? "Didn't reject the $run cache" :
+                                  "Rejected a good cache ($run)");
+        }
+
+        if (($run eq 'use') and ((-s $cache) != $cachelen)) {
+            unlink($output) if (-f $output);
+            unlink($cache);
+            return (0, "Compiled again instead of using the cache");
+        }
+
+        if (not -f $output) {
+            unlink($cache);
+            return (0, "Didn't get any output file ($run)");
+        }
+
+        my @retval = compare_files($desired, $output, $endlines);
+        unlink($output);
+        if (not $retval[0]) {
+            unlink($cache);
+            return (0, "$retval[1] ($run)");
+        }
+    }
+
+    unlink($cache);
+    return (1);
+};
+
+# Checks what each IR optimizer pass did, with --ir-stats, and the code that
+#  came out of it. The .correct file has the stats, without the filename,
+#  then the assembly.
+$tests{'optimize'} = sub {
+    my ($module, $fname) = @_;
+    my $output = 'unittest_tempoutput';
+    my $stats = 'unittest_tempstats';
+    my $combined = 'unittest_tempcombined';
+    my $desired = $fname . '.correct';
+    my $endlines = 1;
+
+    if ($module ne 'compiler') {
+        return (0, "Don't know how to do this module type");
+    }
+
+    my $profile = compiler_profile($fname);
+    my $cmd = "$binpath/mojoshader-compiler$profile --ir-stats -S '$fname' -o '$output'";
+    $cmd .= " 2>$stats 1>/dev/null";
+
+    print("$cmd\n") if ($GPrintCmds);
+
+    if (system($cmd) != 0) {
+        unlink($output) if (-f $output);
+        unlink($stats);
+        return (0, "External program reported error");
+    }
+
+    if (not -f $output) {
+        unlink($stats);
+        return (0, "Didn't get any output file");
+    }
+
+    if (not open(COMBINED, '>', $combined)) {
+        unlink($output, $stats);
+        return (0, "Couldn't open '$combined' for writing");
+    }
+    if (open(STATS, '<', $stats)) {
+        while (<STATS>) {
+            s/\A\Q$fname\E: //;
+            print COMBINED $_;
+        }
+        close(STATS);
+    }
+    if (open(OUTPUT, '<', $output)) {
+        print COMBINED $_ while (<OUTPUT>);
+        close(OUTPUT);
+    }
+    close(COMBINED);
+    unlink($output, $stats);
+
+    my @retval = compare_files($desired, $combined, $endlines);
+    unlink($combined);
+    return @retval;
+};
+
+# Error lines from several compiles at once start with "[index] ". This
+#  pulls out the ones for (index), without that, and without the filename,
+#  since a session compiles every version under the first one's name.
+sub numbered_errors {
+    my ($fname, $index) = @_;
+    my @retval = ();
+    if (open(ERRORS, '<', $fname)) {
+        while (<ERRORS>) {
+            s/[\r\n]//g;
+            next if (not s/\A\[$index\] //);
+            s/\A[^:]*://;
+            push(@retval, $_);
+        }
+        close(ERRORS);
+    }
+    return join("\n", @retval);
+}
+
+sub plain_errors {
+    my ($fname) = @_;
+    my @retval = ();
+    if (open(ERRORS, '<', $fname)) {
+        while (<ERRORS>) {
+            s/[\r\n]//g;
+            s/\A[^:]*://;
+            push(@retval, $_);
+        }
+        close(ERRORS);
+    }
+    return join("\n", @retval);
+}
+
+# Checks result (index) of several compiles at once against what a plain
+#  compile, (cmd), produces: the same output, or the same errors.
+sub compare_numbered {
+    my ($cmd, $output, $error_output, $index) = @_;
+    my $single = 'unittest_tempsingle';
+    my $single_errors = 'unittest_tempsingleerrors';
+    my $numbered = "$output.$index";
+    my @retval = (1);
+
+    $cmd .= " -o '$single' 2>$single_errors 1>/dev/null";
+    print("$cmd\n") if ($GPrintCmds);
+    my $failed = (system($cmd) != 0);
+
+    if (numbered_errors($error_output, $index) ne plain_errors($single_errors)) {
+        @retval = (0, "Errors for #$index don't match a plain compile");
+    } elsif ($failed) {
+        if (-f $numbered) {
+            @retval = (0, "Got output for #$index, which shouldn't compile");
+        }
+    } elsif (not -f $numbered) {
+        @retval = (0, "Didn't get any output for #$index");
+    } else {
+        @retval = compare_files($single, $numbered, 0);
+        $retval[1] .= " (#$index)" if (not $retval[0]);
+    }
+
+    unlink($single, $single_errors, $numbered);
+    return @retval;
+}
+
+# MOJOSHADER_assembleBatch() has to give each shader exactly what
+#  MOJOSHADER_assemble() does, while opening each shared #include once.
+#  Each of these tests is a directory of shaders, "0", "1", "2" and so on,
+#  and "0" says how many files the whole batch should open, in a comment
+#  like "; include opens: 1".
+sub assemble_batch {
+    my ($dname) = @_;
+    my $output = 'unittest_tempoutput';
+    my $error_output = 'unittest_temperroutput';
+    my $opens_output = 'unittest_tempopens';
+    my $opens = undef;
+    my @jobs = ();
+
+    opendir(JOBS, $dname) or return (0, "Couldn't open '$dname'");
+    @jobs = sort { $a <=> $b } grep(/\A\d+\Z/, readdir(JOBS));
+    closedir(JOBS);
+    if (scalar(@jobs) < 2) { return (0, "Need at least two shaders"); }
+
+    open(SOURCE, '<', "$dname/$jobs[0]") or return (0, "Couldn't open '$dname/$jobs[0]'");
+    while (<SOURCE>) {
+        $opens = $1 if (/include opens:\s*(\d+)/);
+    }
+    close(SOURCE);
+    if (not defined $opens) { return (0, "No include open count"); }
+
+    my $cmd = "$binpath/mojoshader-compiler -A --include-opens -o '$output'";
+    $cmd .= " '$dname/$_'" foreach (@jobs);
+    $cmd .= " 2>$error_output 1>$opens_output";
+    print("$cmd\n") if ($GPrintCmds);
+    system($cmd);
+
+    my $reported = undef;
+    if (open(OPENS, '<', $opens_output)) {
+        while (<OPENS>) {
+            $reported = $1 if (/\Ainclude files opened: (\d+)/);
+        }
+        close(OPENS);
+    }
+    unlink($opens_output);
+
+    my @retval = (1);
+    if (not defined $reported) {
+        @retval = (0, "Didn't get an include open count");
+    } elsif ($reported != $opens) {
+        @retval = (0, "Opened $reported include files, not $opens");
+    }
+
+    for (my $i = 0; $i < scalar(@jobs); $i++) {
+        my $single = "$binpath/mojoshader-compiler -A '$dname/$jobs[$i]'";
+        my @result = compare_numbered($single, $output, $error_output, $i);
+        @retval = @result if (($retval[0]) and (not $result[0]));
+    }
+
+    unlink($error_output);
+    unlink("$output.$_") foreach (0..$#jobs);
+    return @retval;
+}
+
+# MOJOSHADER_compileBatch() has to give each permutation exactly what
+#  MOJOSHADER_compile() does. The test lists its permutations in comments,
+#  like "// permutation: LIGHTS=2 SHADOWS", one per line.
+$tests{'batch'} = sub {
+    my ($module, $fname) = @_;
+    my $output = 'unittest_tempoutput';
+    my $error_output = 'unittest_temperroutput';
+    my @permutations = ();
+
+    if ($module eq 'assembler') {
+        return assemble_batch($fname);
+    } elsif ($module ne 'compiler') {
+        return (0, "Don't know how to do this module type");
+    }
+
+    open(SOURCE, '<', $fname) or return (0, "Couldn't open '$fname'");
+    while (<SOURCE>) {
+        push(@permutations, $1) if (/\A\/\/ permutation:\s*(.*?)\s*\Z/);
+    }
+    close(SOURCE);
+    if (not @permutations) { return (0, "No permutations to compile"); }
+
+    my $cmd = "$binpath/mojoshader-compiler -S '$fname' -o '$output'";
+    $cmd .= " --permutation '$_'" foreach (@permutations);
+    $cmd .= " 2>$error_output 1>/dev/null";
+    print("$cmd\n") if ($GPrintCmds);
+    system($cmd);
+
+    my @retval = (1);
+    for (my $i = 0; $i < scalar(@permutations); $i++) {
+        my $single = "$binpath/mojoshader-compiler -S '$fname'";
+        $single .= " '-D$_'" foreach (split(' ', $permutations[$i]));
+        my @result = compare_numbered($single, $output, $error_output, $i);
+        @retval = @result if (($retval[0]) and (not $result[0]));
+    }
+
+    unlink($error_output);
+    unlink("$output.$_") foreach (0..$#permutations);
+    return @retval;
+};
+
+# A compile session has to give every version of a shader exactly what
+#  MOJOSHADER_compile() does. Each of these tests is a directory of
+#  versions, "0", "1", "2" and so on, compiled in that order in one session.
+$tests{'session'} = sub {
+    my ($module, $dname) = @_;
+    my $output = 'unittest_tempoutput';
+    my $error_output = 'unittest_temperroutput';
+    my @versions = ();
+
+    if ($module ne 'compiler') {
+        return (0, "Don't know how to do this module type");
+    }
+
+    opendir(VERSIONS, $dname) or return (0, "Couldn't open '$dname'");
+    @versions = sort { $a <=> $b } grep(/\A\d+\Z/, readdir(VERSIONS));
+    closedir(VERSIONS);
+    if (scalar(@versions) < 2) { return (0, "Need at least two versions"); }
+
+    my $first = shift(@versions);
+    my $cmd = "$binpath/mojoshader-compiler -S '$dname/$first' -o '$output'";
+    $cmd .= " --session-edit '$dname/$_'" foreach (@versions);
+    $cmd .= " 2>$error_output 1>/dev/null";
+    print("$cmd\n") if ($GPrintCmds);
+    system($cmd);
+
+    unshift(@versions, $first);
+    my @retval = (1);
+    for (my $i = 0; $i < scalar(@versions); $i++) {
+        my $single = "$binpath/mojoshader-compiler -S '$dname/$versions[$i]'";
+        my @result = compare_numbered($single, $output, $error_output, $i);
+        @retval = @result if (($retval[0]) and (not $result[0]));
+    }
+
+    unlink($error_output);
+    unlink("$output.$_") foreach (0..$#versions);
+    return @retval;
+};
+
 my $totaltests = 0;
 my $pass = 0;
 my $fail = 0;
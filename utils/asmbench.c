@@ -0,0 +1,242 @@
+/**
+ * MojoShader; generate shader programs from bytecode of compiled
+ *  Direct3D shaders.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by Ryan C. Gordon.
+ */
+
+// Measures how fast MOJOSHADER_assemble() gets through assembly source.
+//  Real .vsh/.psh files are tiny, so this repeats everything after the
+//  version line until the source is a useful size, then assembles it over
+//  and over. Compare MB/s between builds. With "-j threads", each file's
+//  iterations go through MOJOSHADER_assembleBatch() as one batch instead.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+#endif
+
+#include "mojoshader.h"
+
+// wall clock time, since clock() adds up every thread's CPU time.
+static double now_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return ((double) count.QuadPart) / ((double) freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+#endif
+} // now_seconds
+
+// Keep the first line (the version token) once, then append the rest of the
+//  file "repeat" times. Preprocessor lines and declarations are only kept the
+//  first time, since redefining or redeclaring things is an error.
+static int first_copy_only(const char *line, const char *eol)
+{
+    while ((line < eol) && ((*line == ' ') || (*line == '\t')))
+        line++;
+    if ((line < eol) && (*line == '#'))
+        return 1;
+    else if ((eol - line) < 4)
+        return 0;
+    else if ((line[0] | 0x20) != 'd')
+        return 0;
+
+    const char a = line[1] | 0x20;
+    const char b = line[2] | 0x20;
+    const char c = line[3];
+    if ((a == 'c') && (b == 'l'))  // "dcl_*"
+        return 1;
+    return ( (a == 'e') && (b == 'f') &&  // "def", "defb", "defi"
+             ((c == ' ') || (c == '\t') || ((c | 0x20) == 'b') ||
+              ((c | 0x20) == 'i')) );
+} // first_copy_only
+
+
+static char *scale_source(const char *buf, const long len, const int repeat,
+                          long *_outlen)
+{
+    const char *body = memchr(buf, '\n', len);
+    body = (body == NULL) ? (buf + len) : (body + 1);
+    const long headlen = (long) (body - buf);
+    const long bodylen = len - headlen;
+
+    char *retval = (char *) malloc(headlen + (bodylen * repeat) + 1);
+    if (retval == NULL)
+        return NULL;
+
+    memcpy(retval, buf, headlen);
+    char *ptr = retval + headlen;
+
+    int i;
+    for (i = 0; i < repeat; i++)
+    {
+        const char *line = body;
+        const char *end = buf + len;
+        while (line < end)
+        {
+            const char *eol = memchr(line, '\n', end - line);
+            eol = (eol == NULL) ? end : (eol + 1);
+            if ((i == 0) || (!first_copy_only(line, eol)))
+            {
+                memcpy(ptr, line, eol - line);
+                ptr += eol - line;
+            } // if
+            line = eol;
+        } // while
+    } // for
+
+    *ptr = '\0';
+    *_outlen = (long) (ptr - retval);
+    return retval;
+} // scale_source
+
+
+static int bench_file(const char *fname, const int repeat, const int iterations,
+                      const int threads)
+{
+    FILE *io = fopen(fname, "rb");
+    if (io == NULL)
+    {
+        fprintf(stderr, "%s: failed to open\n", fname);
+        return 0;
+    } // if
+
+    fseek(io, 0, SEEK_END);
+    const long fsize = ftell(io);
+    fseek(io, 0, SEEK_SET);
+    char *buf = (char *) malloc(fsize > 0 ? fsize : 1);
+    if ((buf == NULL) || ((fsize > 0) && (fread(buf, fsize, 1, io) != 1)))
+    {
+        fprintf(stderr, "%s: failed to read\n", fname);
+        fclose(io);
+        free(buf);
+        return 0;
+    } // if
+    fclose(io);
+
+    long srclen = 0;
+    char *src = scale_source(buf, fsize, repeat, &srclen);
+    free(buf);
+    if (src == NULL)
+    {
+        fprintf(stderr, "%s: out of memory\n", fname);
+        return 0;
+    } // if
+
+    int errors = 0;
+    int output_len = 0;
+    int i;
+    double start, end;
+
+    if (threads > 0)
+    {
+        MOJOSHADER_assembleJob *jobs = (MOJOSHADER_assembleJob *)
+                            calloc(iterations, sizeof (MOJOSHADER_assembleJob));
+        const MOJOSHADER_parseData **results = (const MOJOSHADER_parseData **)
+                            calloc(iterations, sizeof (MOJOSHADER_parseData *));
+        if ((jobs == NULL) || (results == NULL))
+        {
+            fprintf(stderr, "%s: out of memory\n", fname);
+            free(jobs);
+            free(results);
+            free(src);
+            return 0;
+        } // if
+
+        for (i = 0; i < iterations; i++)
+        {
+            jobs[i].filename = fname;
+            jobs[i].source = src;
+            jobs[i].sourcelen = (unsigned int) srclen;
+        } // for
+
+        start = now_seconds();
+        MOJOSHADER_assembleBatch(jobs, iterations, threads, NULL, NULL,
+                                 results, NULL, NULL, NULL);
+        end = now_seconds();
+
+        for (i = 0; i < iterations; i++)
+        {
+            errors = results[i]->error_count;
+            output_len = results[i]->output_len;
+            MOJOSHADER_freeParseData(results[i]);
+        } // for
+
+        free(results);
+        free(jobs);
+    } // if
+
+    else
+    {
+        start = now_seconds();
+        for (i = 0; i < iterations; i++)
+        {
+            const MOJOSHADER_parseData *pd;
+            pd = MOJOSHADER_assemble(fname, src, (unsigned int) srclen,
+                                     NULL, 0, NULL, 0, NULL, 0, NULL, NULL,
+                                     NULL, NULL, NULL);
+            errors = pd->error_count;
+            output_len = pd->output_len;
+            MOJOSHADER_freeParseData(pd);
+        } // for
+        end = now_seconds();
+    } // else
+
+    free(src);
+
+    const double secs = end - start;
+    const double mb = (((double) srclen) * iterations) / (1024.0 * 1024.0);
+    printf("%s: %ld bytes (x%d), %d bytecode bytes, %d errors, "
+           "%d iterations, %.3f sec, %.1f MB/s\n",
+           fname, srclen, repeat, output_len, errors, iterations, secs,
+           (secs > 0.0) ? (mb / secs) : 0.0);
+    return 1;
+} // bench_file
+
+
+int main(int argc, char **argv)
+{
+    int iterations = 20;
+    int repeat = 1000;
+    int threads = 0;
+    int retval = 0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-n") == 0) && (argv[i+1] != NULL))
+            iterations = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-r") == 0) && (argv[i+1] != NULL))
+            repeat = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-j") == 0) && (argv[i+1] != NULL))
+            threads = atoi(argv[++i]);
+        else if (!bench_file(argv[i], (repeat > 0) ? repeat : 1,
+                             (iterations > 0) ? iterations : 1, threads))
+            retval = 1;
+    } // for
+
+    if (argc < 2)
+    {
+        fprintf(stderr,
+                "USAGE: %s [-n iterations] [-r repeat] [-j threads] <file1> ...\n",
+                argv[0]);
+        retval = 1;
+    } // if
+
+    return retval;
+} // main
+
+// end of asmbench.c ...
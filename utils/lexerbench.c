@@ -0,0 +1,130 @@
+/**
+ * MojoShader; generate shader programs from bytecode of compiled
+ *  Direct3D shaders.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by Ryan C. Gordon.
+ */
+
+// Measures how fast preprocessor_lexer() chews through source files, with
+//  nothing else from the preprocessor in the way. Run it on some big HLSL
+//  files (or a generated header or two) and compare MB/s between builds.
+//  With "-p", each file goes through MOJOSHADER_parseAst() instead, which
+//  adds the preprocessor, keyword classification and the parser; the
+//  tokens/sec figure still counts what the bare lexer saw.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define __MOJOSHADER_INTERNAL__ 1
+#include "mojoshader_internal.h"
+
+static unsigned int lex_buffer(const char *buf, const unsigned int len)
+{
+    unsigned int tokens = 0;
+    IncludeState state;
+    memset(&state, '\0', sizeof (state));
+    state.source_base = buf;
+    state.source = buf;
+    state.token = buf;
+    state.tokenval = ((Token) '\n');
+    state.orig_length = len;
+    state.bytes_left = len;
+    state.line = 1;
+
+    // the preprocessor asks for these, so we do too.
+    state.report_whitespace = 1;
+    state.report_comments = 1;
+
+    while (preprocessor_lexer(&state) != TOKEN_EOI)
+        tokens++;
+    return tokens;
+} // lex_buffer
+
+
+static int bench_file(const char *fname, const int iterations, const int parse)
+{
+    FILE *io = fopen(fname, "rb");
+    if (io == NULL)
+    {
+        fprintf(stderr, "%s: failed to open\n", fname);
+        return 0;
+    } // if
+
+    fseek(io, 0, SEEK_END);
+    const long fsize = ftell(io);
+    fseek(io, 0, SEEK_SET);
+    char *buf = (char *) malloc(fsize > 0 ? fsize : 1);
+    if ((buf == NULL) || ((fsize > 0) && (fread(buf, fsize, 1, io) != 1)))
+    {
+        fprintf(stderr, "%s: failed to read\n", fname);
+        fclose(io);
+        free(buf);
+        return 0;
+    } // if
+    fclose(io);
+
+    unsigned int tokens = lex_buffer(buf, (unsigned int) fsize);
+    int errors = 0;
+    int i;
+    const clock_t start = clock();
+    for (i = 0; i < iterations; i++)
+    {
+        if (!parse)
+            tokens = lex_buffer(buf, (unsigned int) fsize);
+        else
+        {
+            const MOJOSHADER_astData *ad;
+            ad = MOJOSHADER_parseAst(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_1,
+                                     fname, buf, (unsigned int) fsize,
+                                     NULL, 0, NULL, NULL, NULL, NULL, NULL);
+            errors = ad->error_count;
+            MOJOSHADER_freeAstData(ad);
+        } // else
+    } // for
+    const clock_t end = clock();
+    free(buf);
+
+    const double secs = ((double) (end - start)) / CLOCKS_PER_SEC;
+    const double mb = (((double) fsize) * iterations) / (1024.0 * 1024.0);
+    const double toks = ((double) tokens) * iterations;
+    printf("%s: %ld bytes, %u tokens, %d errors, %d iterations, %.3f sec, "
+           "%.1f MB/s, %.0f tokens/sec\n",
+           fname, fsize, tokens, errors, iterations, secs,
+           (secs > 0.0) ? (mb / secs) : 0.0,
+           (secs > 0.0) ? (toks / secs) : 0.0);
+    return 1;
+} // bench_file
+
+
+int main(int argc, char **argv)
+{
+    int iterations = 100;
+    int parse = 0;
+    int retval = 0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-n") == 0) && (argv[i+1] != NULL))
+            iterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0)
+            parse = 1;
+        else if (!bench_file(argv[i], (iterations > 0) ? iterations : 1, parse))
+            retval = 1;
+    } // for
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "USAGE: %s [-n iterations] [-p] <file1> [file2] ...\n",
+                argv[0]);
+        retval = 1;
+    } // if
+
+    return retval;
+} // main
+
+// end of lexerbench.c ...
@@ -20,6 +20,11 @@
 
 static const char **include_paths = NULL;
 static unsigned int include_path_count = 0;
+static const char *source_profile = MOJOSHADER_SRC_PROFILE_HLSL_PS_2_0;
+static const char *ast_cache_file = NULL;
+static int ir_stats = 0;
+static int include_opens = 0;  // how many times open_include() succeeded.
+static int report_include_opens = 0;
 
 #define MOJOSHADER_DEBUG_MALLOC 0
 
@@ -733,32 +738,125 @@ static void print_ast(FILE *io, const int substmt, const void *_ast)
 } // print_ast
 
 
-static int open_include(MOJOSHADER_includeType inctype, const char *fname,
-                        const char *parent, const char **outdata,
-                        unsigned int *outbytes, MOJOSHADER_malloc m,
-                        MOJOSHADER_free f, void *d)
+// The directory that each file we've loaded came from, so an
+//  #include "blah.h" in it can look next to it first, like a C compiler
+//  does. MojoShader only hands open_include() the contents of the file
+//  doing the #including, so this maps those back to where they were.
+//  Batches load their #includes through an include cache, which only
+//  calls open_include() on one thread at a time.
+typedef struct LoadedFile
+{
+    const char *data;
+    char *dir;  // NULL for the current directory.
+    struct LoadedFile *next;
+} LoadedFile;
+
+static LoadedFile *loaded_files = NULL;
+
+// (path)'s directory, or NULL if it doesn't have one. free() it when done.
+static char *dir_of(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    char *retval = NULL;
+    if (slash != NULL)
+    {
+        retval = (char *) malloc((slash - path) + 1);
+        if (retval != NULL)
+        {
+            memcpy(retval, path, slash - path);
+            retval[slash - path] = '\0';
+        } // if
+    } // if
+    return retval;
+} // dir_of
+
+static void remember_file(const char *data, const char *path)
+{
+    LoadedFile *file = (LoadedFile *) malloc(sizeof (LoadedFile));
+    if (file != NULL)
+    {
+        file->data = data;
+        file->dir = dir_of(path);
+        file->next = loaded_files;
+        loaded_files = file;
+    } // if
+} // remember_file
+
+static void forget_file(const char *data)
+{
+    LoadedFile **prev = &loaded_files;
+    LoadedFile *file;
+    for (file = loaded_files; file != NULL; file = file->next)
+    {
+        if (file->data == data)
+        {
+            *prev = file->next;
+            free(file->dir);
+            free(file);
+            return;
+        } // if
+        prev = &file->next;
+    } // for
+} // forget_file
+
+static const char *loaded_file_dir(const char *data)
+{
+    const LoadedFile *file;
+    for (file = loaded_files; file != NULL; file = file->next)
+    {
+        if (file->data == data)
+            return file->dir;
+    } // for
+    return NULL;
+} // loaded_file_dir
+
+
+// (dir) is searched before the include paths, unless it's NULL.
+//  If (_path) isn't NULL, it gets the path we found. free() it when done.
+static FILE *find_include(const char *fname, const char *dir, char **_path)
 {
     int i;
-    for (i = 0; i < include_path_count; i++)
+    for (i = (dir == NULL) ? 0 : -1; i < (int) include_path_count; i++)
     {
-        const char *path = include_paths[i];
+        const char *path = (i < 0) ? dir : include_paths[i];
         const size_t len = strlen(path) + strlen(fname) + 2;
-        char *buf = (char *) m(len, d);
+        char *buf = (char *) malloc(len);
         if (buf == NULL)
-            return 0;
+            return NULL;
 
         snprintf(buf, len, "%s/%s", path, fname);
         FILE *io = fopen(buf, "rb");
-        f(buf, d);
-        if (io == NULL)
-            continue;
+        if ((io == NULL) || (_path == NULL))
+            free(buf);
+        else
+            *_path = buf;
 
+        if (io != NULL)
+            return io;
+    } // for
+
+    return NULL;
+} // find_include
+
+
+static int open_include(MOJOSHADER_includeType inctype, const char *fname,
+                        const char *parent, const char **outdata,
+                        unsigned int *outbytes, MOJOSHADER_malloc m,
+                        MOJOSHADER_free f, void *d)
+{
+    const int local = (inctype == MOJOSHADER_INCLUDETYPE_LOCAL);
+    char *path = NULL;
+    FILE *io = find_include(fname, local ? loaded_file_dir(parent) : NULL,
+                            &path);
+    if (io != NULL)
+    {
         if (fseek(io, 0, SEEK_END) != -1)
         {
             const long fsize = ftell(io);
             if ((fsize == -1) || (fseek(io, 0, SEEK_SET) == -1))
             {
                 fclose(io);
+                free(path);
                 return 0;
             } // if
 
@@ -766,6 +864,7 @@ static int open_include(MOJOSHADER_includeType inctype, const char *fname,
             if (data == NULL)
             {
                 fclose(io);
+                free(path);
                 return 0;
             } // if
 
@@ -773,16 +872,22 @@ static int open_include(MOJOSHADER_includeType inctype, const char *fname,
             {
                 f(data, d);
                 fclose(io);
+                free(path);
                 return 0;
             } // if
 
             fclose(io);
+            remember_file(data, path);
+            free(path);
+            include_opens++;
             *outdata = data;
             *outbytes = (unsigned int) fsize;
             return 1;
         } // if
-    } // for
+        fclose(io);
+    } // if
 
+    free(path);
     return 0;
 } // open_include
 
@@ -790,6 +895,7 @@ static int open_include(MOJOSHADER_includeType inctype, const char *fname,
 static void close_include(const char *data, MOJOSHADER_malloc m,
                           MOJOSHADER_free f, void *d)
 {
+    forget_file(data);
     f((void *) data, d);
 } // close_include
 
@@ -835,24 +941,19 @@ static int preprocess(const char *fname, const char *buf, int len,
 } // preprocess
 
 
-static int assemble(const char *fname, const char *buf, int len,
-                    const char *outfile,
-                    const MOJOSHADER_preprocessorDefine *defs,
-                    unsigned int defcount, FILE *io)
+// Reports (pd)'s errors, each line starting with (prefix), or writes its
+//  bytecode to (io). This frees (pd).
+static int write_parse_data(const MOJOSHADER_parseData *pd,
+                            const char *prefix, const char *outfile, FILE *io)
 {
-    const MOJOSHADER_parseData *pd;
     int retval = 0;
 
-    pd = MOJOSHADER_assemble(fname, buf, len, NULL, 0, NULL, 0,
-                             defs, defcount, open_include, close_include,
-                             Malloc, Free, NULL);
-
     if (pd->error_count > 0)
     {
         int i;
         for (i = 0; i < pd->error_count; i++)
         {
-            fprintf(stderr, "%s:%d: ERROR: %s\n",
+            fprintf(stderr, "%s%s:%d: ERROR: %s\n", prefix,
                     pd->errors[i].filename ? pd->errors[i].filename : "???",
                     pd->errors[i].error_position,
                     pd->errors[i].error);
@@ -874,8 +975,99 @@ static int assemble(const char *fname, const char *buf, int len,
     MOJOSHADER_freeParseData(pd);
 
     return retval;
+} // write_parse_data
+
+static int assemble(const char *fname, const char *buf, int len,
+                    const char *outfile,
+                    const MOJOSHADER_preprocessorDefine *defs,
+                    unsigned int defcount, FILE *io)
+{
+    const MOJOSHADER_parseData *pd;
+    pd = MOJOSHADER_assemble(fname, buf, len, NULL, 0, NULL, 0,
+                             defs, defcount, open_include, close_include,
+                             Malloc, Free, NULL);
+    return write_parse_data(pd, "", outfile, io);
 } // assemble
 
+// Assembles each of (fnames) with MOJOSHADER_assembleBatch(), on a few
+//  threads. Result (i) goes to "(outfile).(i)", or to stdout if there's no
+//  (outfile), and its errors start with "[i] ".
+static int assemble_batch(const char **fnames, const unsigned int count,
+                          const char *outfile,
+                          const MOJOSHADER_preprocessorDefine *defs,
+                          unsigned int defcount)
+{
+    MOJOSHADER_assembleJob *jobs;
+    const MOJOSHADER_parseData **results;
+    int retval = 1;
+    unsigned int i;
+
+    jobs = (MOJOSHADER_assembleJob *) calloc(count, sizeof (*jobs));
+    results = (const MOJOSHADER_parseData **) calloc(count, sizeof (*results));
+    if ((jobs == NULL) || (results == NULL))
+        fail("out of memory");
+
+    for (i = 0; i < count; i++)
+    {
+        FILE *io = fopen(fnames[i], "rb");
+        if (io == NULL)
+            fail("failed to open input file");
+        fseek(io, 0, SEEK_END);
+        const long len = ftell(io);
+        fseek(io, 0, SEEK_SET);
+        char *buf = (char *) malloc(len + 1);
+        if ((buf == NULL) || ((len > 0) && (fread(buf, len, 1, io) != 1)))
+            fail("failed to read input file");
+        fclose(io);
+        remember_file(buf, fnames[i]);
+
+        jobs[i].filename = fnames[i];
+        jobs[i].source = buf;
+        jobs[i].sourcelen = (unsigned int) len;
+        jobs[i].defines = defs;
+        jobs[i].define_count = defcount;
+    } // for
+
+    MOJOSHADER_assembleBatch(jobs, count, 4, open_include, close_include,
+                             results, Malloc, Free, NULL);
+
+    for (i = 0; i < count; i++)
+    {
+        char prefix[32];
+        char *numbered = NULL;
+        FILE *io = stdout;
+
+        snprintf(prefix, sizeof (prefix), "[%u] ", i);
+        if ((outfile != NULL) && (results[i]->error_count == 0))
+        {
+            numbered = (char *) malloc(strlen(outfile) + 32);
+            sprintf(numbered, "%s.%u", outfile, i);
+            io = fopen(numbered, "wb");
+        } // if
+
+        if (io == NULL)
+        {
+            printf(" ... fopen('%s') failed.\n", numbered);
+            MOJOSHADER_freeParseData(results[i]);
+            retval = 0;
+        } // if
+        else if (!write_parse_data(results[i], prefix, numbered, io))
+        {
+            if (numbered != NULL)
+                remove(numbered);
+            retval = 0;
+        } // else if
+        free(numbered);
+
+        forget_file(jobs[i].source);
+        free((void *) jobs[i].source);
+    } // for
+
+    free(results);
+    free(jobs);
+    return retval;
+} // assemble_batch
+
 static int ast(const char *fname, const char *buf, int len,
                const char *outfile, const MOJOSHADER_preprocessorDefine *defs,
                unsigned int defcount, FILE *io)
@@ -883,7 +1075,7 @@ static int ast(const char *fname, const char *buf, int len,
     const MOJOSHADER_astData *ad;
     int retval = 0;
 
-    ad = MOJOSHADER_parseAst(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_1,  // !!! FIXME
+    ad = MOJOSHADER_parseAst(source_profile,
                         fname, buf, len, defs, defcount,
                         open_include, close_include, Malloc, Free, NULL);
     
@@ -911,30 +1103,395 @@ static int ast(const char *fname, const char *buf, int len,
     return retval;
 } // ast
 
+// Loads (fname) into a new AST cache. A missing file is just an empty cache.
+static MOJOSHADER_astCache *load_ast_cache(const char *fname)
+{
+    MOJOSHADER_astCache *cache = MOJOSHADER_createAstCache(Malloc, Free, NULL);
+    if (cache == NULL)
+        fail("out of memory");
+
+    FILE *io = fopen(fname, "rb");
+    if (io == NULL)
+        return cache;
+
+    fseek(io, 0, SEEK_END);
+    const long len = ftell(io);
+    fseek(io, 0, SEEK_SET);
+    char *buf = (len > 0) ? (char *) malloc(len) : NULL;
+    if ((buf != NULL) && (fread(buf, len, 1, io) == 1))
+    {
+        if (MOJOSHADER_loadAstCache(cache, buf, (unsigned int) len) < 0)
+            printf(" ... ignoring bad AST cache '%s'.\n", fname);
+    } // if
+    free(buf);
+    fclose(io);
+    return cache;
+} // load_ast_cache
+
+static void save_ast_cache(MOJOSHADER_astCache *cache, const char *fname)
+{
+    unsigned int len = 0;
+    void *buf = MOJOSHADER_saveAstCache(cache, &len);
+    FILE *io = (buf != NULL) ? fopen(fname, "wb") : NULL;
+    if (io == NULL)
+        printf(" ... failed to save AST cache '%s'.\n", fname);
+    else
+    {
+        if ((fwrite(buf, len, 1, io) != 1) || (fclose(io) == EOF))
+            printf(" ... failed to save AST cache '%s'.\n", fname);
+    } // else
+#if MOJOSHADER_DEBUG_MALLOC
+    if (buf != NULL)
+        Free(buf, NULL);
+#else
+    free(buf);  // the cache uses the default allocator.
+#endif
+} // save_ast_cache
+
+// Reports (cd)'s warnings and errors, each line starting with (prefix),
+//  and writes its output to (io) if it worked. (assembly) writes the D3D
+//  assembly source instead of the bytecode. This frees (cd).
+static int write_compile_data(const MOJOSHADER_compileData *cd,
+                              const char *prefix, const char *outfile,
+                              FILE *io, const int assembly)
+{
+    int retval = 0;
+    int i;
+
+    for (i = 0; i < cd->warning_count; i++)
+    {
+        fprintf(stderr, "%s%s:%d: WARNING: %s\n", prefix,
+                cd->warnings[i].filename ? cd->warnings[i].filename : "???",
+                cd->warnings[i].error_position,
+                cd->warnings[i].error);
+    } // for
+
+    if (cd->error_count > 0)
+    {
+        for (i = 0; i < cd->error_count; i++)
+        {
+            fprintf(stderr, "%s%s:%d: ERROR: %s\n", prefix,
+                    cd->errors[i].filename ? cd->errors[i].filename : "???",
+                    cd->errors[i].error_position,
+                    cd->errors[i].error);
+        } // for
+    } // if
+    else if ((assembly) && (cd->output != NULL))
+    {
+        const int len = cd->output_len;
+        if ((len) && (fwrite(cd->output, len, 1, io) != 1))
+            printf(" ... fwrite('%s') failed.\n", outfile);
+        else if ((outfile != NULL) && (fclose(io) == EOF))
+            printf(" ... fclose('%s') failed.\n", outfile);
+        else
+            retval = 1;
+    } // else if
+    else if ((!assembly) && (cd->bytecode != NULL))
+    {
+        const int len = cd->bytecode_len;
+        if ((len) && (fwrite(cd->bytecode, len, 1, io) != 1))
+            printf(" ... fwrite('%s') failed.\n", outfile);
+        else if ((outfile != NULL) && (fclose(io) == EOF))
+            printf(" ... fclose('%s') failed.\n", outfile);
+        else
+            retval = 1;
+    } // else if
+    MOJOSHADER_freeCompileData(cd);
+
+    return retval;
+} // write_compile_data
+
+// (assembly) writes the D3D assembly source instead of the bytecode.
 static int compile(const char *fname, const char *buf, int len,
                     const char *outfile,
                     const MOJOSHADER_preprocessorDefine *defs,
-                    unsigned int defcount, FILE *io)
+                    unsigned int defcount, FILE *io, const int assembly)
 {
-    // !!! FIXME: write me.
-    //const MOJOSHADER_parseData *pd;
-    //int retval = 0;
+    const MOJOSHADER_compileData *cd;
+    int i;
 
-    MOJOSHADER_compile(MOJOSHADER_SRC_PROFILE_HLSL_PS_1_1,  // !!! FIXME
-                        fname, buf, len, defs, defcount,
-                             open_include, close_include,
-                             Malloc, Free, NULL);
-    return 1;
+    if (ir_stats)
+    {
+        cd = MOJOSHADER_compileWithIrStats(source_profile, fname, buf, len,
+                                           defs, defcount, open_include,
+                                           close_include, Malloc, Free, NULL);
+    } // if
+    else if (ast_cache_file == NULL)
+    {
+        cd = MOJOSHADER_compile(source_profile, fname, buf, len, defs,
+                                defcount, open_include, close_include,
+                                Malloc, Free, NULL);
+    } // else if
+    else
+    {
+        MOJOSHADER_astCache *cache = load_ast_cache(ast_cache_file);
+        cd = MOJOSHADER_compileWithAstCache(source_profile, fname, buf, len,
+                                            defs, defcount, open_include,
+                                            close_include, cache,
+                                            Malloc, Free, NULL);
+        save_ast_cache(cache, ast_cache_file);
+        MOJOSHADER_destroyAstCache(cache);
+    } // else
+
+    for (i = 0; i < cd->ir_pass_count; i++)
+    {
+        const MOJOSHADER_irPassStats *pass = &cd->ir_passes[i];
+        fprintf(stderr, "%s: IR %s: %d -> %d instructions, %d -> %d nodes,"
+                " %d -> %d temps, %d changes\n", fname, pass->name,
+                pass->instructions_before, pass->instructions_after,
+                pass->nodes_before, pass->nodes_after,
+                pass->temps_before, pass->temps_after, pass->changes);
+    } // for
+
+    return write_compile_data(cd, "", outfile, io, assembly);
 } // compile
 
+// Writes result (index) of a batch or session to "(outfile).(index)", or
+//  to stdout if there's no (outfile). Errors and warnings start with
+//  "[index] ", so you can tell the results apart.
+static int write_numbered_compile_data(const MOJOSHADER_compileData *cd,
+                                       const int index, const char *outfile,
+                                       const int assembly)
+{
+    char prefix[32];
+    char *numbered = NULL;
+    FILE *io = stdout;
+    int retval;
+
+    snprintf(prefix, sizeof (prefix), "[%d] ", index);
+    if ((outfile != NULL) && (cd->error_count == 0))
+    {
+        numbered = (char *) malloc(strlen(outfile) + 32);
+        sprintf(numbered, "%s.%d", outfile, index);
+        io = fopen(numbered, "wb");
+        if (io == NULL)
+        {
+            printf(" ... fopen('%s') failed.\n", numbered);
+            MOJOSHADER_freeCompileData(cd);
+            free(numbered);
+            return 0;
+        } // if
+    } // if
+
+    retval = write_compile_data(cd, prefix, numbered, io, assembly);
+    if ((!retval) && (numbered != NULL))
+        remove(numbered);
+    free(numbered);
+    return retval;
+} // write_numbered_compile_data
+
+// Compiles (buf) once for each set of #defines in (perms), with
+//  MOJOSHADER_compileBatch(), on a few threads.
+static int compile_batch(const char *fname, const char *buf, int len,
+                         const char *outfile,
+                         const MOJOSHADER_compilePermutation *perms,
+                         unsigned int permcount, const int assembly)
+{
+    const MOJOSHADER_compileData **results;
+    int retval = 1;
+    unsigned int i;
+
+    results = (const MOJOSHADER_compileData **)
+                    malloc(sizeof (MOJOSHADER_compileData *) * permcount);
+    if (results == NULL)
+        fail("out of memory");
+
+    MOJOSHADER_compileBatch(source_profile, fname, buf, len, perms,
+                            permcount, 4, open_include, close_include,
+                            results, Malloc, Free, NULL);
+
+    for (i = 0; i < permcount; i++)
+    {
+        if (!write_numbered_compile_data(results[i], i, outfile, assembly))
+            retval = 0;
+    } // for
+
+    free(results);
+    return retval;
+} // compile_batch
+
+// Compiles (buf) in a compile session, and then the contents of each file
+//  in (edits), in order, in that same session. Everything is compiled under
+//  (fname), since that's the file the session is working on.
+static int compile_session(const char *fname, const char *buf, int len,
+                           const char *outfile,
+                           const MOJOSHADER_preprocessorDefine *defs,
+                           unsigned int defcount, const char **edits,
+                           unsigned int editcount, const int assembly)
+{
+    MOJOSHADER_compileSession *session;
+    int retval = 1;
+    unsigned int i;
+
+    session = MOJOSHADER_createCompileSession(source_profile, fname, defs,
+                                              defcount, open_include,
+                                              close_include, Malloc, Free,
+                                              NULL);
+    if (session == NULL)
+        fail("out of memory");
+
+    for (i = 0; i <= editcount; i++)
+    {
+        const MOJOSHADER_compileData *cd;
+        char *editbuf = NULL;
+        long editlen = len;
+
+        if (i > 0)
+        {
+            FILE *io = fopen(edits[i-1], "rb");
+            if (io == NULL)
+                fail("failed to open session edit file");
+            fseek(io, 0, SEEK_END);
+            editlen = ftell(io);
+            fseek(io, 0, SEEK_SET);
+            editbuf = (char *) malloc(editlen + 1);
+            if ((editlen > 0) && (fread(editbuf, editlen, 1, io) != 1))
+                fail("failed to read session edit file");
+            fclose(io);
+        } // if
+
+        cd = MOJOSHADER_compileWithSession(session, (i > 0) ? editbuf : buf,
+                                           (unsigned int) editlen);
+        if (!write_numbered_compile_data(cd, i, outfile, assembly))
+            retval = 0;
+        free(editbuf);
+    } // for
+
+    MOJOSHADER_destroyCompileSession(session);
+    return retval;
+} // compile_session
+
+static int dependencies(const char *fname, const char *buf, int len,
+                        const char *outfile,
+                        const MOJOSHADER_preprocessorDefine *defs,
+                        unsigned int defcount, FILE *io)
+{
+    const MOJOSHADER_dependencyData *dd;
+    int retval = 0;
+    int i;
+
+    dd = MOJOSHADER_scanDependencies(fname, buf, len, defs, defcount,
+                                     open_include, close_include,
+                                     Malloc, Free, NULL);
+
+    if (dd->error_count > 0)
+    {
+        for (i = 0; i < dd->error_count; i++)
+        {
+            fprintf(stderr, "%s:%d: ERROR: %s\n",
+                    dd->errors[i].filename ? dd->errors[i].filename : "???",
+                    dd->errors[i].error_position,
+                    dd->errors[i].error);
+        } // for
+    } // if
+    else
+    {
+        // write a makefile rule, like "gcc -M" does: "shader.o: shader.fx"
+        const char *base = strrchr(fname, '/');
+        base = base ? base + 1 : fname;
+        const char *ext = strrchr(base, '.');
+        const int baselen = ext ? (int) (ext - base) : (int) strlen(base);
+        fprintf(io, "%.*s.o: %s", baselen, base, fname);
+
+        // report the paths that open_include() actually used, which
+        //  depend on where each file's parent was. Each path only once.
+        char **paths = (char **) calloc(dd->dependency_count + 1,
+                                        sizeof (char *));
+        for (i = 0; (paths != NULL) && (i < dd->dependency_count); i++)
+        {
+            const MOJOSHADER_includeDependency *dep = &dd->dependencies[i];
+            const char *parent = (dep->parent < 0) ? fname : paths[dep->parent];
+            const int local = (dep->include_type == MOJOSHADER_INCLUDETYPE_LOCAL);
+            char *dir = local ? dir_of(parent) : NULL;
+            FILE *depio = find_include(dep->filename, dir, &paths[i]);
+            int j;
+
+            free(dir);
+            if (depio != NULL)
+                fclose(depio);
+            if (paths[i] == NULL)
+                paths[i] = strdup(dep->filename);
+
+            for (j = 0; j < i; j++)
+            {
+                if (strcmp(paths[i], paths[j]) == 0)
+                    break;
+            } // for
+            if (j == i)
+                fprintf(io, " \\\n  %s", paths[i]);
+        } // for
+        fprintf(io, "\n");
+
+        for (i = 0; (paths != NULL) && (i < dd->dependency_count); i++)
+            free(paths[i]);
+        free(paths);
+
+        if ((outfile != NULL) && (fclose(io) == EOF))
+            printf(" ... fclose('%s') failed.\n", outfile);
+        else
+            retval = 1;
+    } // else
+    MOJOSHADER_freeDependencyData(dd);
+
+    return retval;
+} // dependencies
+
+
+// A permutation for --permutation is the -D defines, plus the
+//  space-separated "NAME" or "NAME=VALUE" defines in (str).
+static MOJOSHADER_preprocessorDefine *parse_permutation(const char *str,
+                            const MOJOSHADER_preprocessorDefine *defs,
+                            const unsigned int defcount, unsigned int *_count)
+{
+    MOJOSHADER_preprocessorDefine *retval = NULL;
+    unsigned int count = 0;
+    unsigned int i;
+    char *ptr;
+
+    retval = (MOJOSHADER_preprocessorDefine *)
+                malloc((defcount + 1) * sizeof (MOJOSHADER_preprocessorDefine));
+    for (i = 0; i < defcount; i++)
+    {
+        retval[count].identifier = strdup(defs[i].identifier);
+        retval[count].definition = defs[i].definition;
+        count++;
+    } // for
+
+    char *copy = strdup(str);
+    for (ptr = strtok(copy, " "); ptr != NULL; ptr = strtok(NULL, " "))
+    {
+        char *ident = strdup(ptr);
+        char *eq = strchr(ident, '=');
+        const char *val = "";
+        if (eq)
+        {
+            *eq = '\0';
+            val = eq+1;
+        } // if
+
+        retval = (MOJOSHADER_preprocessorDefine *) realloc(retval,
+                       (count+1) * sizeof (MOJOSHADER_preprocessorDefine));
+        retval[count].identifier = ident;
+        retval[count].definition = val;
+        count++;
+    } // for
+    free(copy);
+
+    *_count = count;
+    return retval;
+} // parse_permutation
+
+
 typedef enum
 {
     ACTION_UNKNOWN,
     ACTION_VERSION,
+    ACTION_DEPENDENCIES,
     ACTION_PREPROCESS,
     ACTION_ASSEMBLE,
     ACTION_AST,
     ACTION_COMPILE,
+    ACTION_COMPILE_ASSEMBLY,
 } Action;
 
 
@@ -948,6 +1505,12 @@ int main(int argc, char **argv)
 
     MOJOSHADER_preprocessorDefine *defs = NULL;
     unsigned int defcount = 0;
+    const char **permstrs = NULL;
+    unsigned int permcount = 0;
+    const char **edits = NULL;
+    unsigned int editcount = 0;
+    const char **infiles = NULL;
+    unsigned int infilecount = 0;
 
     include_paths = (const char **) malloc(sizeof (char *));
     include_paths[0] = ".";
@@ -965,6 +1528,13 @@ int main(int argc, char **argv)
             action = ACTION_PREPROCESS;
         } // if
 
+        else if (strcmp(arg, "-M") == 0)
+        {
+            if ((action != ACTION_UNKNOWN) && (action != ACTION_DEPENDENCIES))
+                fail("Multiple actions specified");
+            action = ACTION_DEPENDENCIES;
+        } // else if
+
         else if (strcmp(arg, "-A") == 0)
         {
             if ((action != ACTION_UNKNOWN) && (action != ACTION_ASSEMBLE))
@@ -986,6 +1556,13 @@ int main(int argc, char **argv)
             action = ACTION_COMPILE;
         } // else if
 
+        else if (strcmp(arg, "-S") == 0)
+        {
+            if ((action != ACTION_UNKNOWN) && (action != ACTION_COMPILE_ASSEMBLY))
+                fail("Multiple actions specified");
+            action = ACTION_COMPILE_ASSEMBLY;
+        } // else if
+
         else if ((strcmp(arg, "-V") == 0) || (strcmp(arg, "--version") == 0))
         {
             if ((action != ACTION_UNKNOWN) && (action != ACTION_VERSION))
@@ -993,6 +1570,48 @@ int main(int argc, char **argv)
             action = ACTION_VERSION;
         } // else if
 
+        else if (strcmp(arg, "-p") == 0)
+        {
+            arg = argv[++i];
+            if (arg == NULL)
+                fail("no profile after '-p'");
+            source_profile = arg;
+        } // else if
+
+        else if (strcmp(arg, "--ast-cache") == 0)
+        {
+            arg = argv[++i];
+            if (arg == NULL)
+                fail("no filename after '--ast-cache'");
+            ast_cache_file = arg;
+        } // else if
+
+        else if (strcmp(arg, "--ir-stats") == 0)
+            ir_stats = 1;
+
+        else if (strcmp(arg, "--include-opens") == 0)
+            report_include_opens = 1;
+
+        else if (strcmp(arg, "--permutation") == 0)
+        {
+            arg = argv[++i];
+            if (arg == NULL)
+                fail("no defines after '--permutation'");
+            permstrs = (const char **) realloc(permstrs,
+                       (permcount+1) * sizeof (char *));
+            permstrs[permcount++] = arg;
+        } // else if
+
+        else if (strcmp(arg, "--session-edit") == 0)
+        {
+            arg = argv[++i];
+            if (arg == NULL)
+                fail("no filename after '--session-edit'");
+            edits = (const char **) realloc(edits,
+                       (editcount+1) * sizeof (char *));
+            edits[editcount++] = arg;
+        } // else if
+
         else if (strcmp(arg, "-o") == 0)
         {
             if (outfile != NULL)
@@ -1037,15 +1656,33 @@ int main(int argc, char **argv)
 
         else
         {
-            if (infile != NULL)
-                fail("multiple input files specified");
-            infile = arg;
+            infiles = (const char **) realloc(infiles,
+                       (infilecount+1) * sizeof (char *));
+            infiles[infilecount++] = arg;
+            infile = infiles[0];
         } // else
     } // for
 
     if (action == ACTION_UNKNOWN)
         action = ACTION_ASSEMBLE;
 
+    if ((ir_stats) && (ast_cache_file != NULL))
+        fail("can't use '--ir-stats' with '--ast-cache'");
+
+    const int multiple = ((permcount > 0) || (editcount > 0));
+    if ((permcount > 0) && (editcount > 0))
+        fail("can't use '--permutation' with '--session-edit'");
+    else if ((multiple) && (ir_stats || (ast_cache_file != NULL)))
+        fail("can't use '--ir-stats' or '--ast-cache' with several compiles");
+    else if ( (multiple) && (action != ACTION_COMPILE) &&
+              (action != ACTION_COMPILE_ASSEMBLY) )
+        fail("'--permutation' and '--session-edit' only work with -C and -S");
+
+    // several files to assemble go through MOJOSHADER_assembleBatch().
+    const int numbered = ((multiple) || (infilecount > 1));
+    if ((infilecount > 1) && ((multiple) || (action != ACTION_ASSEMBLE)))
+        fail("multiple input files only work with -A");
+
     if (action == ACTION_VERSION)
     {
         printf("mojoshader-compiler, changeset %s\n", MOJOSHADER_CHANGESET);
@@ -1069,29 +1706,77 @@ int main(int argc, char **argv)
     fclose(io);
     if (rc == EOF)
         fail("failed to read input file");
+    remember_file(buf, infile);  // so its #includes look next to it first.
 
-    FILE *outio = outfile ? fopen(outfile, "wb") : stdout;
+    // several compiles write "outfile.0", "outfile.1", etc instead.
+    FILE *outio = (outfile && !numbered) ? fopen(outfile, "wb") : stdout;
     if (outio == NULL)
         fail("failed to open output file");
 
 
-    if (action == ACTION_PREPROCESS)
+    if (infilecount > 1)
+    {
+        retval = (!assemble_batch(infiles, infilecount, outfile,
+                                  defs, defcount));
+    } // if
+    else if (permcount > 0)
+    {
+        MOJOSHADER_compilePermutation *perms;
+        perms = (MOJOSHADER_compilePermutation *)
+                    malloc(permcount * sizeof (MOJOSHADER_compilePermutation));
+        for (i = 0; i < permcount; i++)
+        {
+            perms[i].defines = parse_permutation(permstrs[i], defs, defcount,
+                                                 &perms[i].define_count);
+        } // for
+
+        const int assembly = (action == ACTION_COMPILE_ASSEMBLY);
+        retval = (!compile_batch(infile, buf, rc, outfile, perms, permcount,
+                                 assembly));
+
+        for (i = 0; i < permcount; i++)
+        {
+            unsigned int j;
+            for (j = 0; j < perms[i].define_count; j++)
+                free((void *) perms[i].defines[j].identifier);
+            free((void *) perms[i].defines);
+        } // for
+        free(perms);
+    } // else if
+    else if (editcount > 0)
+    {
+        const int assembly = (action == ACTION_COMPILE_ASSEMBLY);
+        retval = (!compile_session(infile, buf, rc, outfile, defs, defcount,
+                                   edits, editcount, assembly));
+    } // else if
+    else if (action == ACTION_DEPENDENCIES)
+        retval = (!dependencies(infile, buf, rc, outfile, defs, defcount, outio));
+    else if (action == ACTION_PREPROCESS)
         retval = (!preprocess(infile, buf, rc, outfile, defs, defcount, outio));
     else if (action == ACTION_ASSEMBLE)
         retval = (!assemble(infile, buf, rc, outfile, defs, defcount, outio));
     else if (action == ACTION_AST)
         retval = (!ast(infile, buf, rc, outfile, defs, defcount, outio));
     else if (action == ACTION_COMPILE)
-        retval = (!compile(infile, buf, rc, outfile, defs, defcount, outio));
+        retval = (!compile(infile, buf, rc, outfile, defs, defcount, outio, 0));
+    else if (action == ACTION_COMPILE_ASSEMBLY)
+        retval = (!compile(infile, buf, rc, outfile, defs, defcount, outio, 1));
 
-    if ((retval != 0) && (outfile != NULL))
+    if ((retval != 0) && (outfile != NULL) && (!numbered))
         remove(outfile);
 
+    forget_file(buf);
     free(buf);
 
+    if (report_include_opens)
+        printf("include files opened: %d\n", include_opens);
+
     for (i = 0; i < defcount; i++)
         free((void *) defs[i].identifier);
     free(defs);
+    free(permstrs);
+    free(edits);
+    free(infiles);
 
     free(include_paths);
 